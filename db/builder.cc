@@ -23,6 +23,7 @@
 #include "db/event_helpers.h"
 #include "db/filename.h"
 #include "db/internal_stats.h"
+#include "db/merge_helper.h"
 #include "db/table_cache.h"
 #include "db/version_edit.h"
 #include "vidardb/db.h"
@@ -75,7 +76,8 @@ Status BuildTable(
     const CompressionOptions& compression_opts, bool paranoid_file_checks,
     InternalStats* internal_stats, TableFileCreationReason reason,
     EventLogger* event_logger, int job_id, const Env::IOPriority io_priority,
-    TableProperties* table_properties, int level) {
+    TableProperties* table_properties, int level,
+    RangeDelAggregator* range_del_agg) {
   assert((column_family_id ==
           TablePropertiesCollectorFactory::Context::kUnknownColumnFamily) ==
          column_family_name.empty());
@@ -93,7 +95,8 @@ Status BuildTable(
 #endif  // !VIDARDB_LITE
   TableProperties tp;
 
-  if (iter->Valid()) {
+  if (iter->Valid() ||
+      (range_del_agg != nullptr && !range_del_agg->empty())) {  // Shichao
     TableBuilder* builder;
     unique_ptr<WritableFileWriter> file_writer;
     {
@@ -107,7 +110,9 @@ Status BuildTable(
       }
       file->SetIOPriority(io_priority);
 
-      file_writer.reset(new WritableFileWriter(std::move(file), env_options));
+      file_writer.reset(new WritableFileWriter(std::move(file), env_options,
+                                               ioptions.rate_limiter,
+                                               ioptions.statistics));
 
       builder = NewTableBuilder(
           ioptions, internal_comparator, int_tbl_prop_collector_factories,
@@ -115,10 +120,19 @@ Status BuildTable(
           compression_opts, env_options);  // Shichao
     }
 
+    MergeHelper merge(env, internal_comparator.user_comparator(),
+                      ioptions.merge_operator, ioptions.info_log,
+                      true /* internal key corruption is not ok */,
+                      ioptions.statistics);
+
     CompactionIterator c_iter(iter, internal_comparator.user_comparator(),
                               kMaxSequenceNumber, &snapshots,
                               earliest_write_conflict_snapshot,
-                              true /* internal key corruption is not ok */);
+                              true /* internal key corruption is not ok */,
+                              &merge, nullptr /* compaction */,
+                              nullptr /* compaction_filter */,
+                              nullptr /* splitter */, env,
+                              range_del_agg);  // Shichao
     c_iter.SeekToFirst();
     for (; c_iter.Valid(); c_iter.Next()) {
       const Slice& key = c_iter.key();
@@ -134,6 +148,17 @@ Status BuildTable(
       }
     }
 
+    /***************************** Shichao ******************************/
+    // the tombstones follow the last point entry
+    if (range_del_agg != nullptr) {
+      auto range_del_list = range_del_agg->GetCompactionOutput(false);
+      if (range_del_list != nullptr) {
+        RangeDelAggregator::AddToBuilder(*range_del_list, nullptr, nullptr,
+                                         internal_comparator, builder, meta);
+      }
+    }
+    /***************************** Shichao ******************************/
+
     // Finish and check for builder errors
     bool empty = builder->NumEntries() == 0;
     s = c_iter.status();
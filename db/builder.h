@@ -40,6 +40,7 @@ class TableBuilder;
 class WritableFileWriter;
 class InternalStats;
 class InternalIterator;
+class RangeDelAggregator;  // Shichao
 
 // @param column_family_name Name of the column family that is also identified
 //    by column_family_id, or empty string if unknown. It must outlive the
@@ -62,6 +63,8 @@ TableBuilder* NewTableBuilder(
 // *meta will be filled with metadata about the generated table.
 // If no data is present in *iter, meta->file_size will be set to
 // zero, and no Table file will be produced.
+// The range tombstones of *range_del_agg, if not nullptr, are written to the
+// file too, and the entries they cover in the same snapshot are dropped.
 //
 // @param column_family_name Name of the column family that is also identified
 //    by column_family_id, or empty string if unknown.
@@ -80,6 +83,7 @@ extern Status BuildTable(
     InternalStats* internal_stats, TableFileCreationReason reason,
     EventLogger* event_logger = nullptr, int job_id = 0,
     const Env::IOPriority io_priority = Env::IO_HIGH,
-    TableProperties* table_properties = nullptr, int level = -1);
+    TableProperties* table_properties = nullptr, int level = -1,
+    RangeDelAggregator* range_del_agg = nullptr);  // Shichao
 
 }  // namespace vidardb
@@ -28,6 +28,7 @@
 #include "db/write_controller.h"
 #include "db/writebuffer.h"
 #include "util/compression.h"
+#include "vidardb/memtablerep.h"  // Shichao
 #include "util/options_helper.h"
 #include "util/thread_status_util.h"
 
@@ -151,6 +152,11 @@ ColumnFamilyOptions SanitizeOptions(const DBOptions& db_options,
   result.min_write_buffer_number_to_merge =
       std::min(result.min_write_buffer_number_to_merge,
                result.max_write_buffer_number - 1);
+  /***************************** Shichao ******************************/
+  if (!(result.background_job_weight > 0)) {
+    result.background_job_weight = 1.0;
+  }
+  /***************************** Shichao ******************************/
   if (result.num_levels < 1) {
     result.num_levels = 1;
   }
@@ -178,6 +184,16 @@ ColumnFamilyOptions SanitizeOptions(const DBOptions& db_options,
     result.level0_file_num_compaction_trigger = 1;
   }
 
+  /***************************** Shichao ******************************/
+  if (result.prefix_extractor == nullptr &&
+      result.memtable_factory->IsPrefixExtractorRequired()) {
+    Warn(db_options.info_log.get(),
+         "%s needs a prefix_extractor, using SkipListFactory instead",
+         result.memtable_factory->Name());
+    result.memtable_factory = std::make_shared<SkipListFactory>();
+  }
+  /***************************** Shichao ******************************/
+
   return result;
 }
 
@@ -272,6 +288,7 @@ ColumnFamilyData::ColumnFamilyData(
       column_family_set_(column_family_set),
       pending_flush_(false),
       pending_compaction_(false),
+      compaction_vtime_(0),  // Shichao
       prev_compaction_needed_bytes_(0) {
   Ref();
 
@@ -282,7 +299,8 @@ ColumnFamilyData::ColumnFamilyData(
   if (_dummy_versions != nullptr) {
     internal_stats_.reset(
         new InternalStats(ioptions_.num_levels, db_options->env, this));
-    table_cache_.reset(new TableCache(ioptions_, env_options, _table_cache));
+    table_cache_.reset(new TableCache(ioptions_, env_options, _table_cache,
+        column_family_set->table_open_state()));  // Shichao
     if (ioptions_.compaction_style == kCompactionStyleLevel) {
       compaction_picker_.reset(
           new LevelCompactionPicker(ioptions_, &internal_comparator_));
@@ -694,7 +712,8 @@ ColumnFamilySet::ColumnFamilySet(const std::string& dbname,
                                  const EnvOptions& env_options,
                                  Cache* table_cache,
                                  WriteBuffer* write_buffer,
-                                 WriteController* write_controller)
+                                 WriteController* write_controller,
+                                 TableOpenState* table_open_state)
     : max_column_family_(0),
       dummy_cfd_(new ColumnFamilyData(0, "", nullptr, nullptr, nullptr,
                                       ColumnFamilyOptions(), db_options,
@@ -705,7 +724,8 @@ ColumnFamilySet::ColumnFamilySet(const std::string& dbname,
       env_options_(env_options),
       table_cache_(table_cache),
       write_buffer_(write_buffer),
-      write_controller_(write_controller) {
+      write_controller_(write_controller),
+      table_open_state_(table_open_state) {  // Shichao
   // initialize linked list
   dummy_cfd_->prev_ = dummy_cfd_;
   dummy_cfd_->next_ = dummy_cfd_;
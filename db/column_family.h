@@ -41,6 +41,7 @@ class DBImpl;
 class LogBuffer;
 class InstrumentedMutex;
 class InstrumentedMutexLock;
+class TableOpenState;  // Shichao
 
 extern const double kSlowdownRatio;
 
@@ -310,6 +311,13 @@ class ColumnFamilyData {
   void set_pending_compaction(bool value) { pending_compaction_ = value; }
   bool pending_flush() { return pending_flush_; }
   bool pending_compaction() { return pending_compaction_; }
+  /***************************** Shichao ******************************/
+  // The virtual time of the column family in the fair pick of
+  // DBImpl::compaction_queue_: the compaction input bytes served to it so
+  // far, divided by its background_job_weight.
+  double compaction_vtime() const { return compaction_vtime_; }
+  void set_compaction_vtime(double value) { compaction_vtime_ = value; }
+  /***************************** Shichao ******************************/
 
   // Recalculate some small conditions, which are changed only during
   // compaction, adding new memtable and/or
@@ -389,6 +397,8 @@ class ColumnFamilyData {
   // DBImpl::compaction_queue_
   bool pending_compaction_;
 
+  double compaction_vtime_;  // Shichao
+
   uint64_t prev_compaction_needed_bytes_;
 };
 
@@ -438,7 +448,8 @@ class ColumnFamilySet {
 
   ColumnFamilySet(const std::string& dbname, const DBOptions* db_options,
                   const EnvOptions& env_options, Cache* table_cache,
-                  WriteBuffer* write_buffer, WriteController* write_controller);
+                  WriteBuffer* write_buffer, WriteController* write_controller,
+                  TableOpenState* table_open_state = nullptr);  // Shichao
   ~ColumnFamilySet();
 
   ColumnFamilyData* GetDefault() const;
@@ -467,6 +478,8 @@ class ColumnFamilySet {
 
   Cache* get_table_cache() { return table_cache_; }
 
+  TableOpenState* table_open_state() { return table_open_state_; }  // Shichao
+
  private:
   friend class ColumnFamilyData;
   // helper function that gets called from cfd destructor
@@ -497,6 +510,7 @@ class ColumnFamilySet {
   Cache* table_cache_;
   WriteBuffer* write_buffer_;
   WriteController* write_controller_;
+  TableOpenState* table_open_state_;  // Shichao
 };
 
 // We use ColumnFamilyMemTablesImpl to provide WriteBatch a way to access
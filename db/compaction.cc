@@ -419,12 +419,35 @@ bool Compaction::IsOutputLevelEmpty() const {
   return inputs_.back().level != output_level_ || inputs_.back().empty();
 }
 
+/***************************** Shichao ******************************/
+std::unique_ptr<CompactionFilter> Compaction::CreateCompactionFilter() const {
+  if (!cfd_->ioptions()->compaction_filter_factory) {
+    return nullptr;
+  }
+
+  CompactionFilter::Context context;
+  context.is_full_compaction = is_full_compaction_;
+  context.is_manual_compaction = is_manual_compaction_;
+  context.column_family_id = cfd_->GetID();
+  return cfd_->ioptions()->compaction_filter_factory->CreateCompactionFilter(
+      context);
+}
+/***************************** Shichao ******************************/
+
 bool Compaction::ShouldFormSubcompactions() const {
   if (mutable_cf_options_.max_subcompactions <= 1 || cfd_ == nullptr) {
     return false;
   }
   if (cfd_->ioptions()->compaction_style == kCompactionStyleLevel) {
-    return start_level_ == 0 && !IsOutputLevelEmpty();
+    if (start_level_ == 0 && !IsOutputLevelEmpty()) {
+      return true;
+    }
+    /****************************** Shichao ****************************/
+    // Row to column conversions rewrite every column file of the output, so
+    // they deserve to run in parallel as well.
+    int knob = cfd_->ioptions()->table_factory->GetKnob();
+    return knob >= 0 && start_level_ < knob && output_level_ >= knob;
+    /****************************** Shichao ****************************/
   } else {
     return false;
   }
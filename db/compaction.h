@@ -227,6 +227,9 @@ class Compaction {
     return max_grandparent_overlap_bytes_;
   }
 
+  // Create a CompactionFilter from compaction_filter_factory
+  std::unique_ptr<CompactionFilter> CreateCompactionFilter() const;  // Shichao
+
  private:
   // mark (or clear) all files that are being compacted
   void MarkFilesBeingCompacted(bool mark_as_compacted);
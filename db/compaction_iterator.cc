@@ -12,6 +12,7 @@
 
 #include "db/compaction_iterator.h"
 #include "table/internal_iterator.h"
+#include "util/stop_watch.h"  // Shichao
 
 namespace vidardb {
 
@@ -19,13 +20,21 @@ CompactionIterator::CompactionIterator(
     InternalIterator* input, const Comparator* cmp,
     SequenceNumber last_sequence, std::vector<SequenceNumber>* snapshots,
     SequenceNumber earliest_write_conflict_snapshot,
-    bool expect_valid_internal_key, const Compaction* compaction)
+    bool expect_valid_internal_key, MergeHelper* merge_helper,
+    const Compaction* compaction, const CompactionFilter* compaction_filter,
+    const Splitter* splitter, Env* env, RangeDelAggregator* range_del_agg)
     : input_(input),
       cmp_(cmp),
       snapshots_(snapshots),
       earliest_write_conflict_snapshot_(earliest_write_conflict_snapshot),
       expect_valid_internal_key_(expect_valid_internal_key),
-      compaction_(compaction) {
+      merge_helper_(merge_helper),
+      compaction_(compaction),
+      compaction_filter_(compaction_filter),  // Shichao
+      splitter_(splitter),                    // Shichao
+      env_(env),                              // Shichao
+      range_del_agg_(range_del_agg),          // Shichao
+      merge_out_iter_(merge_helper_) {
   bottommost_level_ =
       compaction_ == nullptr ? false : compaction_->bottommost_level();
   if (compaction_ != nullptr) {
@@ -45,6 +54,47 @@ CompactionIterator::CompactionIterator(
   ignore_snapshots_ = false;
 }
 
+/***************************** Shichao ******************************/
+void CompactionIterator::InvokeFilter() {
+  // If the user has specified a compaction filter and the sequence
+  // number is greater than any external snapshot, then invoke the
+  // filter. If the return value of the compaction filter is true,
+  // replace the entry with a deletion marker.
+  bool value_changed = false;
+  bool to_delete = false;
+  const int level = compaction_ == nullptr ? 0 : compaction_->level();
+  const uint32_t column = compaction_filter_->FilteredColumn();
+  {
+    StopWatchNano timer(env_, env_ != nullptr);
+    if (column == 0) {
+      compaction_filter_value_.clear();
+      to_delete = compaction_filter_->Filter(level, ikey_.user_key, value_,
+                                             &compaction_filter_value_,
+                                             &value_changed);
+    } else if (splitter_ != nullptr) {
+      // the split columns point into the row, nothing is copied
+      splitter_->Split(value_, filter_columns_);
+      if (column <= filter_columns_.size()) {
+        to_delete = compaction_filter_->FilterColumn(
+            level, ikey_.user_key, filter_columns_[column - 1]);
+      }
+    }
+    iter_stats_.total_filter_time += env_ != nullptr ? timer.ElapsedNanos() : 0;
+  }
+
+  if (to_delete) {
+    // convert the current key to a delete
+    ikey_.type = kTypeDeletion;
+    current_key_.UpdateInternalKey(ikey_.sequence, kTypeDeletion);
+    // no value associated with delete
+    value_.clear();
+    iter_stats_.num_record_drop_user++;
+  } else if (value_changed) {
+    value_ = compaction_filter_value_;
+  }
+}
+/***************************** Shichao ******************************/
+
 void CompactionIterator::ResetRecordCounts() {
   iter_stats_.num_record_drop_user = 0;
   iter_stats_.num_record_drop_hidden = 0;
@@ -59,12 +109,26 @@ void CompactionIterator::SeekToFirst() {
 void CompactionIterator::Next() {
   // If there is a merge output, return it before continuing to process the
   // input.
+  if (merge_out_iter_.Valid()) {
+    merge_out_iter_.Next();
+
+    // Check if we returned all records of the merge output.
+    if (merge_out_iter_.Valid()) {
+      SetMergeOutput();
+    } else {
+      // MergeHelper moves the iterator to the first record after the merged
+      // records, so even though we reached the end of the merge output, we do
+      // not want to advance the iterator.
+      NextFromInput();
+    }
+  } else {
     // Only advance the input iterator if there is no merge output and the
     // iterator is not already at the next record.
     if (!at_next_) {
       input_->Next();
     }
     NextFromInput();
+  }
 
   if (valid_) {
     // Record that we've ouputted a record for the current key.
@@ -120,6 +184,14 @@ void CompactionIterator::NextFromInput() {
       has_outputted_key_ = false;
       current_user_key_sequence_ = kMaxSequenceNumber;
       current_user_key_snapshot_ = 0;
+      /***************************** Shichao ******************************/
+      // apply the compaction filter to the first occurrence of the user key
+      if (compaction_filter_ != nullptr && ikey_.type == kTypeValue &&
+          (visible_at_tip_ || ikey_.sequence > latest_snapshot_ ||
+           ignore_snapshots_)) {
+        InvokeFilter();
+      }
+      /***************************** Shichao ******************************/
     } else {
       // Update the current key to reflect the new sequence number/type without
       // copying the user key.
@@ -278,6 +350,16 @@ void CompactionIterator::NextFromInput() {
       assert(last_sequence >= current_user_key_sequence_);
       ++iter_stats_.num_record_drop_hidden;  // (A)
       input_->Next();
+    /***************************** Shichao ******************************/
+    } else if ((ikey_.type == kTypeValue || ikey_.type == kTypeMerge) &&
+               range_del_agg_ != nullptr && !range_del_agg_->empty() &&
+               range_del_agg_->ShouldDelete(ikey_)) {
+      // Covered by a range tombstone of the same snapshot stripe, which the
+      // output keeps unless nothing older is left to delete. The older
+      // entries of the stripe are then hidden by (A).
+      ++iter_stats_.num_record_drop_hidden;
+      input_->Next();
+    /***************************** Shichao ******************************/
     } else if (compaction_ != nullptr && ikey_.type == kTypeDeletion &&
                ikey_.sequence <= earliest_snapshot_ &&
                compaction_->KeyNotExistsBeyondOutputLevel(ikey_.user_key,
@@ -298,12 +380,50 @@ void CompactionIterator::NextFromInput() {
       // write-conflict checking since it is earlier than any snapshot.
       ++iter_stats_.num_record_drop_obsolete;
       input_->Next();
+    } else if (ikey_.type == kTypeMerge) {
+      if (merge_helper_ == nullptr || !merge_helper_->HasOperator()) {
+        status_ = Status::InvalidArgument(
+            "merge_operator is not properly initialized.");
+        return;
+      }
+
+      // We know the merge type entry is not hidden, otherwise we would
+      // have hit (A)
+      // We encapsulate the merge related state machine in a different
+      // object to minimize change to the existing flow.
+      Status s = merge_helper_->MergeUntil(input_, prev_snapshot,
+                                           bottommost_level_,
+                                           range_del_agg_);  // Shichao
+      if (!s.ok() && !s.IsMergeInProgress()) {
+        status_ = s;
+        return;
+      }
+      merge_out_iter_.SeekToFirst();
+
+      // NOTE: key, value, and ikey_ refer to old entries.
+      //       These will be correctly set below.
+      assert(merge_out_iter_.Valid());
+      SetMergeOutput();
     } else {
       valid_ = true;
     }
   }
 }
 
+void CompactionIterator::SetMergeOutput() {
+  key_ = merge_out_iter_.key();
+  value_ = merge_out_iter_.value();
+  bool valid_key __attribute__((__unused__)) = ParseInternalKey(key_, &ikey_);
+  // MergeUntil stops when it encounters a corrupt key and does not
+  // include them in the result, so we expect the keys here to be valid.
+  assert(valid_key);
+  // Keep current_key_ in sync.
+  current_key_.UpdateInternalKey(ikey_.sequence, ikey_.type);
+  key_ = current_key_.GetKey();
+  ikey_.user_key = current_key_.GetUserKey();
+  valid_ = true;
+}
+
 void CompactionIterator::PrepareOutput() {
   // Zeroing out the sequence number leads to better compression.
   // If this is the bottommost level (no files in lower levels)
@@ -313,7 +433,8 @@ void CompactionIterator::PrepareOutput() {
 
   // This is safe for TransactionDB write-conflict checking since transactions
   // only care about sequence number larger than any active snapshots.
-  if (bottommost_level_ && valid_ && ikey_.sequence < earliest_snapshot_
+  if (bottommost_level_ && valid_ && ikey_.sequence < earliest_snapshot_ &&
+      ikey_.type != kTypeMerge
       /* && !cmp_->Equal(compaction_->GetLargestUserKey(), ikey_.user_key)*/) {  // Shichao, conflict
     assert(ikey_.type != kTypeDeletion && ikey_.type != kTypeSingleDeletion);
     ikey_.sequence = 0;
@@ -12,6 +12,10 @@
 #include <vector>
 
 #include "db/compaction.h"
+#include "db/merge_helper.h"
+#include "db/range_del_aggregator.h"  // Shichao
+#include "vidardb/compaction_filter.h"  // Shichao
+#include "vidardb/splitter.h"           // Shichao
 #include "util/log_buffer.h"
 
 namespace vidardb {
@@ -40,7 +44,12 @@ class CompactionIterator {
                      std::vector<SequenceNumber>* snapshots,
                      SequenceNumber earliest_write_conflict_snapshot,
                      bool expect_valid_internal_key,
-                     const Compaction* compaction = nullptr);
+                     MergeHelper* merge_helper = nullptr,
+                     const Compaction* compaction = nullptr,
+                     const CompactionFilter* compaction_filter = nullptr,
+                     const Splitter* splitter = nullptr,
+                     Env* env = nullptr,
+                     RangeDelAggregator* range_del_agg = nullptr);
 
   void ResetRecordCounts();
 
@@ -72,6 +81,13 @@ class CompactionIterator {
   // compression.
   void PrepareOutput();
 
+  // Point the output at the current record of merge_out_iter_.
+  void SetMergeOutput();
+
+  // Invoke compaction_filter_ on the current value, which may turn the
+  // current key into a deletion or replace the value.
+  void InvokeFilter();  // Shichao
+
   // Given a sequence number, return the sequence number of the
   // earliest snapshot that this sequence number is visible in.
   // The snapshots themselves are arranged in ascending order of
@@ -86,7 +102,15 @@ class CompactionIterator {
   const std::vector<SequenceNumber>* snapshots_;
   const SequenceNumber earliest_write_conflict_snapshot_;
   bool expect_valid_internal_key_;
+  MergeHelper* merge_helper_;
   const Compaction* compaction_;
+  /***************************** Shichao ******************************/
+  const CompactionFilter* compaction_filter_;
+  const Splitter* splitter_;  // splits the rows for a column-aware filter
+  Env* env_;
+  // the range tombstones of the input, whose covered entries are dropped
+  RangeDelAggregator* range_del_agg_;
+  /***************************** Shichao ******************************/
   bool bottommost_level_;
   bool valid_ = false;
   SequenceNumber visible_at_tip_;
@@ -128,6 +152,9 @@ class CompactionIterator {
   bool clear_and_output_next_key_ = false;
 
   std::string compaction_filter_value_;
+  std::vector<Slice> filter_columns_;  // the split row, reused  // Shichao
+  // Iterates over the output of the last MergeUntil() call.
+  MergeOutputIterator merge_out_iter_;
   // "level_ptrs" holds indices that remember which file of an associated
   // level we were last checking during the last call to compaction->
   // KeyNotExistsBeyondOutputLevel(). This allows future calls to the function
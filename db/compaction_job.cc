@@ -36,8 +36,10 @@
 #include "db/filename.h"
 #include "db/log_reader.h"
 #include "db/log_writer.h"
+#include "db/merge_helper.h"
 #include "memtable/memtable.h"
 #include "memtable/memtable_list.h"
+#include "db/table_cache.h"
 #include "db/version_set.h"
 #include "port/likely.h"
 #include "port/port.h"
@@ -50,6 +52,7 @@
 #include "table/block_based_table_factory.h"
 #include "table/merger.h"
 #include "table/table_builder.h"
+#include "table/table_reader.h"
 #include "table/adaptive_table_factory.h"  // Shichao
 #include "util/coding.h"
 #include "util/file_reader_writer.h"
@@ -66,6 +69,24 @@
 
 namespace vidardb {
 
+/***************************** Shichao ******************************/
+namespace {
+// Whether a range tombstone of list intersects [start, end), nullptr meaning
+// unbounded.
+bool RangeTombstonesOverlap(const FragmentedRangeTombstoneList& list,
+                            const Comparator* ucmp, const Slice* start,
+                            const Slice* end) {
+  for (const auto& fragment : list.fragments()) {
+    if ((start == nullptr || ucmp->Compare(fragment.end_key, *start) > 0) &&
+        (end == nullptr || ucmp->Compare(fragment.start_key, *end) < 0)) {
+      return true;
+    }
+  }
+  return false;
+}
+}  // anonymous namespace
+/***************************** Shichao ******************************/
+
 // Maintains state for each sub-compaction
 struct CompactionJob::SubcompactionState {
   const Compaction* compaction;
@@ -109,6 +130,7 @@ struct CompactionJob::SubcompactionState {
   uint64_t num_output_records;
   CompactionJobStats compaction_job_stats;
   uint64_t approx_size;
+  uint64_t elapsed_micros;
   // An index that used to speed up ShouldStopBefore().
   size_t grandparent_index = 0;
   // The number of bytes overlapping between the current output and
@@ -117,6 +139,9 @@ struct CompactionJob::SubcompactionState {
   // A flag determine whether the key has been seen in ShouldStopBefore()
   bool seen_key = false;
   std::string compression_dict;
+  // The range tombstones written to the outputs, each file taking those
+  // between its first key and the first key of the next one.
+  std::shared_ptr<const FragmentedRangeTombstoneList> range_del_out;  // Shichao
 
   SubcompactionState(Compaction* c, Slice* _start, Slice* _end,
                      uint64_t size = 0)
@@ -129,6 +154,7 @@ struct CompactionJob::SubcompactionState {
         num_input_records(0),
         num_output_records(0),
         approx_size(size),
+        elapsed_micros(0),
         grandparent_index(0),
         overlapped_bytes(0),
         seen_key(false),
@@ -151,10 +177,12 @@ struct CompactionJob::SubcompactionState {
     num_output_records = std::move(o.num_output_records);
     compaction_job_stats = std::move(o.compaction_job_stats);
     approx_size = std::move(o.approx_size);
+    elapsed_micros = std::move(o.elapsed_micros);
     grandparent_index = std::move(o.grandparent_index);
     overlapped_bytes = std::move(o.overlapped_bytes);
     seen_key = std::move(o.seen_key);
     compression_dict = std::move(o.compression_dict);
+    range_del_out = std::move(o.range_del_out);  // Shichao
     return *this;
   }
 
@@ -256,6 +284,14 @@ void CompactionJob::AggregateStatistics() {
   if (compaction_job_stats_) {
     for (SubcompactionState& sc : compact_->sub_compact_states) {
       compaction_job_stats_->Add(sc.compaction_job_stats);
+      SubcompactionJobStats sub_stats;
+      sub_stats.approx_input_bytes = sc.approx_size;
+      sub_stats.elapsed_micros = sc.elapsed_micros;
+      sub_stats.num_input_records = sc.num_input_records;
+      sub_stats.num_output_records = sc.num_output_records;
+      sub_stats.num_output_files = sc.outputs.size();
+      sub_stats.total_output_bytes = sc.total_bytes;
+      compaction_job_stats_->subcompactions.push_back(sub_stats);
     }
   }
 }
@@ -341,6 +377,8 @@ void CompactionJob::ReportStartedCompaction(
       ThreadStatus::COMPACTION_BYTES_WRITTEN, 0);
   ThreadStatusUtil::SetThreadOperationProperty(
       ThreadStatus::COMPACTION_BYTES_READ, 0);
+  ThreadStatusUtil::SetThreadOperationProperty(  // Shichao
+      ThreadStatus::COMPACTION_CPU_MICROS, 0);
 
   // Set the thread operation after operation properties
   // to ensure GetThreadList() can always show them all together.
@@ -386,128 +424,103 @@ void CompactionJob::Prepare() {
   }
 }
 
-struct RangeWithSize {
-  Range range;
-  uint64_t size;
-
-  RangeWithSize(const Slice& a, const Slice& b, uint64_t s = 0)
-      : range(a, b), size(s) {}
-};
-
 // Generates a histogram representing potential divisions of key ranges from
-// the input. It adds the starting and/or ending keys of certain input files
-// to the working set and then finds the approximate size of data in between
-// each consecutive pair of slices. Then it divides these ranges into
+// the input. Every input table is asked for key anchors sampled from its
+// index, each of which carries the approximate size of the data between it and
+// the previous anchor of the same table. The sizes span all the files of a
+// table, so the sub column files of column tables are accounted for. The
+// anchors of all input tables are merged in key order and cut into
 // consecutive groups such that each group has a similar size.
 void CompactionJob::GenSubcompactionBoundaries() {
   auto* c = compact_->compaction;
   auto* cfd = c->column_family_data();
   const Comparator* cfd_comparator = cfd->user_comparator();
-  std::vector<Slice> bounds;
   int start_lvl = c->start_level();
   int out_lvl = c->output_level();
 
-  // Add the starting and/or ending key of certain input files as a potential
-  // boundary
+  std::vector<TableReader::Anchor> anchors;
   for (size_t lvl_idx = 0; lvl_idx < c->num_input_levels(); lvl_idx++) {
     int lvl = c->level(lvl_idx);
-    if (lvl >= start_lvl && lvl <= out_lvl) {
-      const LevelFilesBrief* flevel = c->input_levels(lvl_idx);
-      size_t num_files = flevel->num_files;
-
-      if (num_files == 0) {
-        continue;
+    if (lvl < start_lvl || lvl > out_lvl) {
+      continue;
+    }
+    const LevelFilesBrief* flevel = c->input_levels(lvl_idx);
+    for (size_t i = 0; i < flevel->num_files; i++) {
+      const FdWithKeyRange& f = flevel->files[i];
+      const size_t num_anchors = anchors.size();
+      Cache::Handle* handle = nullptr;
+      Status s = cfd->table_cache()->FindTable(
+          env_options_, cfd->internal_comparator(), f.fd, &handle);
+      if (s.ok()) {
+        TableReader* table_reader =
+            cfd->table_cache()->GetTableReaderFromHandle(handle);
+        s = table_reader->ApproximateKeyAnchors(ReadOptions(), anchors);
+        cfd->table_cache()->ReleaseHandle(handle);
       }
-
-      if (lvl == 0) {
-        // For level 0 add the starting and ending key of each file since the
-        // files may have greatly differing key ranges (not range-partitioned)
-        for (size_t i = 0; i < num_files; i++) {
-          bounds.emplace_back(flevel->files[i].smallest_key);
-          bounds.emplace_back(flevel->files[i].largest_key);
-        }
-      } else {
-        // For all other levels add the smallest/largest key in the level to
-        // encompass the range covered by that level
-        bounds.emplace_back(flevel->files[0].smallest_key);
-        bounds.emplace_back(flevel->files[num_files - 1].largest_key);
-        if (lvl == out_lvl) {
-          // For the last level include the starting keys of all files since
-          // the last level is the largest and probably has the widest key
-          // range. Since it's range partitioned, the ending key of one file
-          // and the starting key of the next are very close (or identical).
-          for (size_t i = 1; i < num_files; i++) {
-            bounds.emplace_back(flevel->files[i].smallest_key);
-          }
-        }
+      if (!s.ok() || anchors.size() == num_anchors) {
+        // The table cannot be sampled, treat it as one range ending at its
+        // largest key.
+        anchors.erase(anchors.begin() + num_anchors, anchors.end());
+        anchors.emplace_back(ExtractUserKey(f.largest_key),
+                             std::max(f.fd.GetFileSizeTotal(),
+                                      f.fd.GetFileSize()));
       }
     }
   }
 
-  std::sort(bounds.begin(), bounds.end(),
-    [cfd_comparator] (const Slice& a, const Slice& b) -> bool {
-      return cfd_comparator->Compare(ExtractUserKey(a), ExtractUserKey(b)) < 0;
+  std::stable_sort(anchors.begin(), anchors.end(),
+    [cfd_comparator] (const TableReader::Anchor& a,
+                      const TableReader::Anchor& b) -> bool {
+      return cfd_comparator->Compare(a.user_key, b.user_key) < 0;
     });
-  // Remove duplicated entries from bounds
-  bounds.erase(std::unique(bounds.begin(), bounds.end(),
-    [cfd_comparator] (const Slice& a, const Slice& b) -> bool {
-      return cfd_comparator->Compare(ExtractUserKey(a), ExtractUserKey(b)) == 0;
-    }), bounds.end());
-
-  // Combine consecutive pairs of boundaries into ranges with an approximate
-  // size of data covered by keys in that range
-  uint64_t sum = 0;
-  std::vector<RangeWithSize> ranges;
-  auto* v = cfd->current();
-  for (auto it = bounds.begin();;) {
-    const Slice a = *it;
-    it++;
-
-    if (it == bounds.end()) {
-      break;
-    }
 
-    const Slice b = *it;
-    uint64_t size = versions_->ApproximateSize(v, a, b, start_lvl, out_lvl + 1);
-    ranges.emplace_back(a, b, size);
-    sum += size;
+  uint64_t sum = 0;
+  for (const auto& anchor : anchors) {
+    sum += anchor.range_size;
   }
 
-  // Group the ranges into subcompactions
+  // Group the anchors into subcompactions
   const double min_file_fill_percent = 4.0 / 5;
   uint64_t max_output_files = static_cast<uint64_t>(
       std::ceil(sum / min_file_fill_percent /
                 c->mutable_cf_options()->MaxFileSizeForLevel(out_lvl)));
   uint64_t subcompactions =
-      std::min({static_cast<uint64_t>(ranges.size()),
+      std::min({static_cast<uint64_t>(anchors.size()),
                 static_cast<uint64_t>(db_options_.max_subcompactions),
                 max_output_files});
 
-  double mean = sum * 1.0 / subcompactions;
-
   if (subcompactions > 1) {
-    // Greedily add ranges to the subcompaction until the sum of the ranges'
-    // sizes becomes >= the expected mean size of a subcompaction
-    sum = 0;
-    for (size_t i = 0; i < ranges.size() - 1; i++) {
-      sum += ranges[i].size;
-      if (subcompactions == 1) {
-        // If there's only one left to schedule then it goes to the end so no
-        // need to put an end boundary
+    // Cut where the running sum crosses the next multiple of the mean, which
+    // does not let rounding errors of earlier groups accumulate. A boundary
+    // must be strictly greater than the previous one, so that all versions of
+    // a user key go to the same subcompaction.
+    const double mean = sum * 1.0 / subcompactions;
+    uint64_t running = 0, last_cut = 0;
+    for (size_t i = 0; i + 1 < anchors.size() &&
+                       boundary_keys_.size() + 1 < subcompactions; i++) {
+      running += anchors[i].range_size;
+      if (running < mean * (boundary_keys_.size() + 1)) {
         continue;
       }
-      if (sum >= mean) {
-        boundaries_.emplace_back(ExtractUserKey(ranges[i].range.limit));
-        sizes_.emplace_back(sum);
-        subcompactions--;
-        sum = 0;
+      if (!boundary_keys_.empty() &&
+          cfd_comparator->Compare(anchors[i].user_key,
+                                  boundary_keys_.back()) <= 0) {
+        continue;
       }
+      boundary_keys_.emplace_back(anchors[i].user_key);
+      sizes_.emplace_back(running - last_cut);
+      last_cut = running;
     }
-    sizes_.emplace_back(sum + ranges.back().size);
+    sizes_.emplace_back(sum - last_cut);
   } else {
     // Only one range so its size is the total sum of sizes computed above
     sizes_.emplace_back(sum);
   }
+
+  // boundary_keys_ no longer changes, so the slices stay valid
+  for (const auto& key : boundary_keys_) {
+    boundaries_.emplace_back(key);
+  }
 }
 
 Status CompactionJob::Run() {
@@ -568,6 +581,15 @@ Status CompactionJob::Run() {
   AggregateStatistics();
   UpdateCompactionStats();
   RecordCompactionIOStats();
+  /***************************** Shichao ******************************/
+  // the CPU time of all the subcompaction threads
+  uint64_t cpu_micros = 0;
+  for (const auto& state : compact_->sub_compact_states) {
+    cpu_micros += state.compaction_job_stats.cpu_micros;
+  }
+  ThreadStatusUtil::SetThreadOperationProperty(
+      ThreadStatus::COMPACTION_CPU_MICROS, cpu_micros);
+  /***************************** Shichao ******************************/
   LogFlush(db_options_.info_log);
   TEST_SYNC_POINT("CompactionJob::Run():End");
 
@@ -627,6 +649,11 @@ Status CompactionJob::Install(const MutableCFOptions& mutable_cf_options) {
          << "num_input_records" << compact_->num_input_records
          << "num_output_records" << compact_->num_output_records
          << "num_subcompactions" << compact_->sub_compact_states.size();
+  /***************************** Shichao ******************************/
+  if (compaction_job_stats_ != nullptr) {
+    stream << "cpu_micros" << compaction_job_stats_->cpu_micros;
+  }
+  /***************************** Shichao ******************************/
 
   if (measure_io_stats_ && compaction_job_stats_ != nullptr) {
     stream << "file_write_nanos" << compaction_job_stats_->file_write_nanos;
@@ -650,8 +677,35 @@ Status CompactionJob::Install(const MutableCFOptions& mutable_cf_options) {
 
 void CompactionJob::ProcessKeyValueCompaction(SubcompactionState* sub_compact) {
   assert(sub_compact != nullptr);
+  const uint64_t start_micros = env_->NowMicros();
+  const uint64_t start_cpu_nanos = env_->NowCPUNanos();  // Shichao
+  ColumnFamilyData* cfd = sub_compact->compaction->column_family_data();
+  /***************************** Shichao ******************************/
+  // Gather the range tombstones of all the input files first, so that the
+  // files they cover entirely are not even read.
+  RangeDelAggregator range_del_agg(cfd->user_comparator(), kMaxSequenceNumber,
+                                   existing_snapshots_);
+  Status status;
+  const Compaction* c = sub_compact->compaction;
+  for (size_t which = 0; status.ok() && which < c->num_input_levels();
+       which++) {
+    for (size_t i = 0; status.ok() && i < c->num_input_files(which); i++) {
+      std::shared_ptr<const FragmentedRangeTombstoneList> range_del_list;
+      status = cfd->table_cache()->GetRangeTombstoneList(
+          env_options_, cfd->internal_comparator(), c->input(which, i)->fd,
+          &range_del_list);
+      range_del_agg.AddTombstones(range_del_list);
+    }
+  }
+  if (!status.ok()) {
+    sub_compact->status = status;
+    return;
+  }
+  sub_compact->range_del_out =
+      range_del_agg.GetCompactionOutput(bottommost_level_);
+  /***************************** Shichao ******************************/
   std::unique_ptr<InternalIterator> input(
-      versions_->MakeInputIterator(sub_compact->compaction));
+      versions_->MakeInputIterator(sub_compact->compaction, &range_del_agg));
 
   AutoThreadOperationStageUpdater stage_updater(
       ThreadStatus::STAGE_COMPACTION_PROCESS_KV);
@@ -672,7 +726,6 @@ void CompactionJob::ProcessKeyValueCompaction(SubcompactionState* sub_compact) {
     prev_prepare_write_nanos = IOSTATS(prepare_write_nanos);
   }
 
-  ColumnFamilyData* cfd = sub_compact->compaction->column_family_data();
   const MutableCFOptions* mutable_cf_options =
       sub_compact->compaction->mutable_cf_options();
 
@@ -710,11 +763,25 @@ void CompactionJob::ProcessKeyValueCompaction(SubcompactionState* sub_compact) {
     input->SeekToFirst();
   }
 
-  Status status;
+  MergeHelper merge(env_, cfd->user_comparator(),
+                    cfd->ioptions()->merge_operator, db_options_.info_log.get(),
+                    false /* internal key corruption is expected */, stats_);
+
+  /***************************** Shichao ******************************/
+  std::unique_ptr<CompactionFilter> compaction_filter_from_factory = nullptr;
+  auto compaction_filter = cfd->ioptions()->compaction_filter;
+  if (compaction_filter == nullptr) {
+    compaction_filter_from_factory =
+        sub_compact->compaction->CreateCompactionFilter();
+    compaction_filter = compaction_filter_from_factory.get();
+  }
+  /***************************** Shichao ******************************/
+
   sub_compact->c_iter.reset(new CompactionIterator(
       input.get(), cfd->user_comparator(), versions_->LastSequence(),
-      &existing_snapshots_, earliest_write_conflict_snapshot_, false,
-      sub_compact->compaction));
+      &existing_snapshots_, earliest_write_conflict_snapshot_, false, &merge,
+      sub_compact->compaction, compaction_filter, cfd->ioptions()->splitter,
+      env_, &range_del_agg));  // Shichao
   auto c_iter = sub_compact->c_iter.get();
   c_iter->SeekToFirst();
   const auto& c_iter_stats = c_iter->iter_stats();
@@ -724,6 +791,9 @@ void CompactionJob::ProcessKeyValueCompaction(SubcompactionState* sub_compact) {
   size_t data_begin_offset = 0;
   std::string compression_dict;
   compression_dict.reserve(cfd->ioptions()->compression_opts.max_dict_bytes);
+  // A full output file is closed before the next key, which bounds its
+  // range tombstones.
+  bool output_full = false;  // Shichao
 
   // TODO(noetzli): check whether we could check !shutting_down_->... only
   // only occasionally (see diff D42687)
@@ -739,9 +809,18 @@ void CompactionJob::ProcessKeyValueCompaction(SubcompactionState* sub_compact) {
     if (end != nullptr &&
         cfd->user_comparator()->Compare(c_iter->user_key(), *end) >= 0) {
       break;
-    } else if (sub_compact->ShouldStopBefore(key) &&
+    } else if ((sub_compact->ShouldStopBefore(key) || output_full) &&
                sub_compact->builder != nullptr) {
-      status = FinishCompactionOutputFile(input->status(), sub_compact);
+      /***************************** Shichao ******************************/
+      status = FinishCompactionOutputFile(input->status(), sub_compact,
+                                          &c_iter->user_key());
+      if (output_full && sub_compact->outputs.size() == 1) {
+        // Use dictionary from first output file for compression of subsequent
+        // files.
+        sub_compact->compression_dict = std::move(compression_dict);
+      }
+      output_full = false;
+      /***************************** Shichao ******************************/
       if (!status.ok()) {
         break;
       }
@@ -752,6 +831,9 @@ void CompactionJob::ProcessKeyValueCompaction(SubcompactionState* sub_compact) {
       RecordDroppedKeys(c_iter_stats, &sub_compact->compaction_job_stats);
       c_iter->ResetRecordCounts();
       RecordCompactionIOStats();
+      ThreadStatusUtil::SetThreadOperationProperty(  // Shichao
+          ThreadStatus::COMPACTION_CPU_MICROS,
+          (env_->NowCPUNanos() - start_cpu_nanos) / 1000);
     }
 
     // Open output file if necessary
@@ -825,12 +907,7 @@ void CompactionJob::ProcessKeyValueCompaction(SubcompactionState* sub_compact) {
     // and 0.6MB instead of 1MB and 0.2MB)
     if (sub_compact->builder->FileSizeTotal() >=                     // Shichao
         sub_compact->compaction->max_output_file_size()) {
-      status = FinishCompactionOutputFile(input->status(), sub_compact);
-      if (sub_compact->outputs.size() == 1) {
-        // Use dictionary from first output file for compression of subsequent
-        // files.
-        sub_compact->compression_dict = std::move(compression_dict);
-      }
+      output_full = true;  // Shichao
     }
     c_iter->Next();
   }
@@ -855,6 +932,20 @@ void CompactionJob::ProcessKeyValueCompaction(SubcompactionState* sub_compact) {
     status = Status::ShutdownInProgress(
         "Database shutdown or Column family drop during compaction");
   }
+  if (status.ok()) {
+    status = c_iter->status();
+  }
+  /***************************** Shichao ******************************/
+  // The range tombstones still need a file when no entry is left
+  if (status.ok() && sub_compact->builder == nullptr &&
+      sub_compact->range_del_out != nullptr &&
+      sub_compact->outputs.empty() &&
+      RangeTombstonesOverlap(*sub_compact->range_del_out,
+                             cfd->user_comparator(), sub_compact->start,
+                             sub_compact->end)) {
+    status = OpenCompactionOutputFile(sub_compact);
+  }
+  /***************************** Shichao ******************************/
   if (status.ok() && sub_compact->builder != nullptr) {
     status = FinishCompactionOutputFile(input->status(), sub_compact);
   }
@@ -879,6 +970,9 @@ void CompactionJob::ProcessKeyValueCompaction(SubcompactionState* sub_compact) {
   sub_compact->c_iter.reset();
   input.reset();
   sub_compact->status = status;
+  sub_compact->elapsed_micros = env_->NowMicros() - start_micros;
+  sub_compact->compaction_job_stats.cpu_micros +=  // Shichao
+      (env_->NowCPUNanos() - start_cpu_nanos) / 1000;
 }
 
 void CompactionJob::RecordDroppedKeys(
@@ -907,7 +1001,8 @@ void CompactionJob::RecordDroppedKeys(
 }
 
 Status CompactionJob::FinishCompactionOutputFile(
-    const Status& input_status, SubcompactionState* sub_compact) {
+    const Status& input_status, SubcompactionState* sub_compact,
+    const Slice* next_user_key) {
   AutoThreadOperationStageUpdater stage_updater(
       ThreadStatus::STAGE_COMPACTION_SYNC_FILE);
   assert(sub_compact != nullptr);
@@ -922,6 +1017,26 @@ Status CompactionJob::FinishCompactionOutputFile(
   // Check for iterator errors
   Status s = input_status;
   auto meta = &sub_compact->current_output()->meta;
+  /***************************** Shichao ******************************/
+  // The tombstones follow the last point entry, clipped to the range of the
+  // file, from its first key, or the start of the subcompaction for the
+  // first file, to the first key of the next one.
+  if (s.ok() && sub_compact->range_del_out != nullptr) {
+    std::string lower_key;
+    if (sub_compact->outputs.size() > 1) {
+      lower_key = meta->smallest.user_key().ToString();
+    }
+    Slice lower_slice(lower_key);
+    const Slice* lower =
+        sub_compact->outputs.size() > 1 ? &lower_slice : sub_compact->start;
+    const Slice* upper =
+        next_user_key != nullptr ? next_user_key : sub_compact->end;
+    RangeDelAggregator::AddToBuilder(
+        *sub_compact->range_del_out, lower, upper,
+        sub_compact->compaction->column_family_data()->internal_comparator(),
+        sub_compact->builder.get(), meta);
+  }
+  /***************************** Shichao ******************************/
   const uint64_t current_entries = sub_compact->builder->NumEntries();
   meta->marked_for_compaction = sub_compact->builder->NeedCompact();
   if (s.ok()) {
@@ -1099,7 +1214,9 @@ Status CompactionJob::OpenCompactionOutputFile(
   writable_file->SetPreallocationBlockSize(static_cast<size_t>(
       sub_compact->compaction->OutputFilePreallocationSize()));
   sub_compact->outfile.reset(
-      new WritableFileWriter(std::move(writable_file), env_options_));
+      new WritableFileWriter(std::move(writable_file), env_options_,
+                             db_options_.rate_limiter.get(),
+                             db_options_.statistics.get()));  // Shichao
 
   /****************************** Shichao ********************************/
   if (std::string(cfd->ioptions()->table_factory->Name()) ==
@@ -15,7 +15,9 @@
 
 #include <inttypes.h>
 #include <algorithm>
+#include <map>
 #include <string>
+#include <unordered_set>
 #include <stdint.h>
 #include "db/db_impl.h"
 #include "db/filename.h"
@@ -141,6 +143,32 @@ Status DBImpl::GetLiveFiles(std::vector<std::string>& ret,
   *manifest_file_size = versions_->manifest_file_size();
 
   mutex_.Unlock();
+
+  /***************************** Shichao ******************************/
+  // The sub-column files of the live column tables. How many a table has
+  // depends on the table factory which wrote it, so they are found by
+  // listing the paths of the tables out of the mutex.
+  std::map<uint32_t, std::unordered_set<uint64_t>> live_numbers;
+  for (const auto& live_file : live) {
+    live_numbers[live_file.GetPathId()].insert(live_file.GetNumber());
+  }
+  for (const auto& path : live_numbers) {
+    std::vector<std::string> children;
+    Status s = env_->GetChildren(db_options_.db_paths[path.first].path,
+                                 &children);
+    if (!s.ok()) {
+      return s;
+    }
+    for (const auto& child : children) {
+      uint64_t number;
+      FileType type;
+      if (ParseFileName(child, &number, &type) && type == kTableSubFile &&
+          path.second.count(number) > 0) {
+        ret.push_back("/" + child);
+      }
+    }
+  }
+  /***************************** Shichao ******************************/
   return Status::OK();
 }
 
@@ -53,6 +53,10 @@
 #include "db/job_context.h"
 #include "db/log_reader.h"
 #include "db/log_writer.h"
+#include "db/merge_context.h"
+#include "db/merge_helper.h"
+#include "db/perf_sampler.h"  // Shichao
+#include "db/pinned_iterators_manager.h"  // Shichao
 #include "memtable/memtable.h"
 #include "memtable/memtable_list.h"
 #include "db/table_cache.h"
@@ -60,12 +64,14 @@
 #include "db/transaction_log_impl.h"
 #include "db/version_set.h"
 #include "db/write_batch_internal.h"
+#include "db/write_callback.h"
 #include "db/writebuffer.h"
 #include "port/likely.h"
 #include "port/port.h"
 #include "vidardb/cache.h"
 #include "vidardb/db.h"
 #include "vidardb/env.h"
+#include "vidardb/rate_limiter.h"  // Shichao
 #include "vidardb/sst_file_writer.h"
 #include "vidardb/statistics.h"
 #include "vidardb/status.h"
@@ -159,6 +165,14 @@ DBOptions SanitizeOptions(const std::string& dbname, const DBOptions& src) {
     result.recycle_log_file_num = false;
   }
 
+  /***************************** Shichao ******************************/
+  // sync in steps, or the throttled writes pile up in the page cache and hit
+  // the disk at once
+  if (result.rate_limiter.get() != nullptr && result.bytes_per_sync == 0) {
+    result.bytes_per_sync = 1024 * 1024;
+  }
+  /***************************** Shichao ******************************/
+
   if (result.recycle_log_file_num &&
       (result.wal_recovery_mode == WALRecoveryMode::kPointInTimeRecovery ||
        result.wal_recovery_mode == WALRecoveryMode::kAbsoluteConsistency)) {
@@ -270,6 +284,8 @@ void DumpSupportInfo(Logger* logger) {
   Log(InfoLogLevel::INFO_LEVEL, logger, "\tLZ4 supported: %d", LZ4_Supported());
   Log(InfoLogLevel::INFO_LEVEL, logger, "Fast CRC32 supported: %d",
       crc32c::IsFastCrc32Supported());
+  Log(InfoLogLevel::INFO_LEVEL, logger, "3-way CRC32 supported: %d",
+      crc32c::IsThreeWayCrc32Supported());  // Shichao
 }
 
 }  // namespace
@@ -295,6 +311,8 @@ DBImpl::DBImpl(const DBOptions& options, const std::string& dbname)
       write_thread_(0, options.write_thread_slow_yield_usec),
       write_controller_(options.delayed_write_rate),
       last_batch_group_size_(0),
+      compaction_vtime_(0),        // Shichao
+      time_slice_cv_(&mutex_),     // Shichao
       unscheduled_flushes_(0),
       unscheduled_compactions_(0),
       bg_compaction_scheduled_(0),
@@ -326,12 +344,27 @@ DBImpl::DBImpl(const DBOptions& options, const std::string& dbname)
   table_cache_ =
       NewLRUCache(table_cache_size, db_options_.table_cache_numshardbits);
 
+  /***************************** Shichao ******************************/
+  if (db_options_.persist_table_open_state) {
+    table_open_state_.reset(
+        new TableOpenState(env_, db_options_.statistics.get()));
+  }
+  /***************************** Shichao ******************************/
+
   versions_.reset(new VersionSet(dbname_, &db_options_, env_options_,
                                  table_cache_.get(), &write_buffer_,
-                                 &write_controller_));
+                                 &write_controller_,
+                                 table_open_state_.get()));  // Shichao
   column_family_memtables_.reset(
       new ColumnFamilyMemTablesImpl(versions_->GetColumnFamilySet()));
 
+  /***************************** Shichao ******************************/
+  if (db_options_.background_time_slice_micros > 0) {
+    time_slice_thread_.reset(
+        new std::thread(&DBImpl::BackgroundTimeSlice, this));
+  }
+  /***************************** Shichao ******************************/
+
   DumpVidarDBBuildVersion(db_options_.info_log.get());
   DumpDBFileSummary(db_options_, dbname_);
   db_options_.Dump(db_options_.info_log.get());
@@ -343,6 +376,7 @@ void DBImpl::CancelAllBackgroundWork(bool wait) {
   InstrumentedMutexLock l(&mutex_);
   shutting_down_.store(true, std::memory_order_release);
   bg_cv_.SignalAll();
+  time_slice_cv_.SignalAll();  // Shichao
   if (!wait) {
     return;
   }
@@ -373,6 +407,11 @@ DBImpl::~DBImpl() {
   // marker. After this we do a variant of the waiting and unschedule work
   // (to consider: moving all the waiting into CancelAllBackgroundWork(true))
   CancelAllBackgroundWork(false);
+  /***************************** Shichao ******************************/
+  if (time_slice_thread_) {
+    time_slice_thread_->join();
+  }
+  /***************************** Shichao ******************************/
   int compactions_unscheduled = env_->UnSchedule(this, Env::Priority::LOW);
   int flushes_unscheduled = env_->UnSchedule(this, Env::Priority::HIGH);
   mutex_.Lock();
@@ -462,6 +501,16 @@ DBImpl::~DBImpl() {
   // versions need to be destroyed before table_cache since it can hold
   // references to table_cache.
   versions_.reset();
+
+  /***************************** Shichao ******************************/
+  if (table_open_state_ && opened_successfully_) {
+    Status s = table_open_state_->Save(TableOpenStateFileName(dbname_));
+    if (!s.ok()) {
+      Log(InfoLogLevel::WARN_LEVEL, db_options_.info_log,
+          "Failed to save table open state: %s", s.ToString().c_str());
+    }
+  }
+  /***************************** Shichao ******************************/
   mutex_.Unlock();
   if (db_lock_ != nullptr) {
     env_->UnlockFile(db_lock_);
@@ -599,6 +648,15 @@ void DBImpl::MaybeDumpStats() {
       }
       default_cf_internal_stats_->GetStringProperty(
           *db_property_info, DB::Properties::kDBStats, &stats);
+      /***************************** Shichao ******************************/
+      if (db_options_.perf_sample_rate > 0) {
+        const DBPropertyInfo* sampled_property_info =
+            GetPropertyInfo(DB::Properties::kSampledPerfStats);
+        assert(sampled_property_info != nullptr);
+        default_cf_internal_stats_->GetStringProperty(
+            *sampled_property_info, DB::Properties::kSampledPerfStats, &stats);
+      }
+      /***************************** Shichao ******************************/
     }
     if (db_options_.dump_malloc_stats) {
       DumpMallocStats(&stats);
@@ -963,6 +1021,7 @@ void DBImpl::PurgeObsoleteFiles(const JobContext& state) {
       case kIdentityFile:
       case kMetaDatabase:
       case kOptionsFile:
+      case kTableOpenStateFile:  // Shichao
         keep = true;
         break;
     }
@@ -1184,6 +1243,16 @@ Status DBImpl::Recover(
     }
   }
 
+  /***************************** Shichao ******************************/
+  if (table_open_state_) {
+    Status load = table_open_state_->Load(TableOpenStateFileName(dbname_));
+    if (!load.ok() && !load.IsNotFound() && !load.IsIOError()) {
+      Log(InfoLogLevel::WARN_LEVEL, db_options_.info_log,
+          "Ignored table open state: %s", load.ToString().c_str());
+    }
+  }
+  /***************************** Shichao ******************************/
+
   Status s = versions_->Recover(column_families, read_only);
   if (db_options_.paranoid_checks && s.ok()) {
     s = CheckConsistency();
@@ -1553,6 +1622,11 @@ Status DBImpl::WriteLevel0TableForRecovery(int job_id, ColumnFamilyData* cfd,
       SequenceNumber earliest_write_conflict_snapshot;
       std::vector<SequenceNumber> snapshot_seqs =
           snapshots_.GetAll(&earliest_write_conflict_snapshot);
+      /***************************** Shichao ******************************/
+      RangeDelAggregator range_del_agg(cfd->user_comparator(),
+                                       kMaxSequenceNumber, snapshot_seqs);
+      range_del_agg.AddTombstones(mem->GetRangeTombstoneList());
+      /***************************** Shichao ******************************/
 
       s = BuildTable(
           dbname_, env_, *cfd->ioptions(), mutable_cf_options, env_options_,
@@ -1562,7 +1636,8 @@ Status DBImpl::WriteLevel0TableForRecovery(int job_id, ColumnFamilyData* cfd,
           GetCompressionFlush(*cfd->ioptions(), mutable_cf_options),
           cfd->ioptions()->compression_opts, paranoid_file_checks,
           cfd->internal_stats(), TableFileCreationReason::kRecovery,
-          &event_logger_, job_id);
+          &event_logger_, job_id, Env::IO_HIGH, nullptr /* table_properties */,
+          -1 /* level */, &range_del_agg);  // Shichao
       LogFlush(db_options_.info_log);
       Log(InfoLogLevel::DEBUG_LEVEL, db_options_.info_log,
           "[%s] [WriteLevel0TableForRecovery]"
@@ -1740,7 +1815,21 @@ Status DBImpl::CompactRange(const CompactRangeOptions& options,
     if (cfd->ioptions()->compaction_style == kCompactionStyleFIFO) {
       output_level = level;
     } else if (level == max_level_with_files && level > 0) {
-      continue;
+      /***************************** Shichao ******************************/
+      if (options.bottommost_level_compaction ==
+          BottommostLevelCompaction::kSkip) {
+        // Skip bottommost level compaction
+        continue;
+      } else if (options.bottommost_level_compaction ==
+                     BottommostLevelCompaction::kIfHaveCompactionFilter &&
+                 cfd->ioptions()->compaction_filter == nullptr &&
+                 cfd->ioptions()->compaction_filter_factory == nullptr) {
+        // Skip bottommost level compaction since we don't have a compaction
+        // filter
+        continue;
+      }
+      output_level = level;
+      /***************************** Shichao ******************************/
     } else {
       output_level = level + 1;
     }
@@ -2681,24 +2770,85 @@ void DBImpl::MaybeScheduleFlushOrCompaction() {
 }
 
 int DBImpl::BGCompactionsAllowed() const {
-  if (write_controller_.NeedSpeedupCompaction()) {
-    return db_options_.max_background_compactions;
-  } else {
-    return db_options_.base_background_compactions;
+  /***************************** Shichao ******************************/
+  int allowed = write_controller_.NeedSpeedupCompaction()
+                    ? db_options_.max_background_compactions
+                    : db_options_.base_background_compactions;
+  // the compactions over their time slice do not hold a slot, up to twice
+  // the slots
+  if (db_options_.background_time_slice_micros > 0) {
+    allowed += std::min(NumCompactionsOverTimeSlice(), allowed);
   }
+  return allowed;
+  /***************************** Shichao ******************************/
 }
 
+/***************************** Shichao ******************************/
+int DBImpl::NumCompactionsOverTimeSlice() const {
+  const uint64_t now = env_->NowMicros();
+  int num = 0;
+  for (uint64_t start : running_compaction_starts_) {
+    if (now > start + db_options_.background_time_slice_micros) {
+      num++;
+    }
+  }
+  return num;
+}
+
+void DBImpl::BackgroundTimeSlice() {
+  const uint64_t slice = db_options_.background_time_slice_micros;
+  InstrumentedMutexLock l(&mutex_);
+  // the time slices ending up to checked have been handled
+  uint64_t checked = env_->NowMicros();
+  while (!shutting_down_.load(std::memory_order_acquire)) {
+    const uint64_t now = env_->NowMicros();
+    bool expired = false;
+    uint64_t next = 0;
+    for (uint64_t start : running_compaction_starts_) {
+      uint64_t end = start + slice;
+      if (end > now) {
+        next = (next == 0) ? end : std::min(next, end);
+      } else if (end > checked) {
+        expired = true;
+      }
+    }
+    checked = now;
+    if (expired) {
+      // the compaction over its time slice frees its slot
+      MaybeScheduleFlushOrCompaction();
+    }
+    if (next == 0) {
+      time_slice_cv_.Wait();
+    } else {
+      time_slice_cv_.TimedWait(next);
+    }
+  }
+}
+/***************************** Shichao ******************************/
+
 void DBImpl::AddToCompactionQueue(ColumnFamilyData* cfd) {
   assert(!cfd->pending_compaction());
   cfd->Ref();
   compaction_queue_.push_back(cfd);
   cfd->set_pending_compaction(true);
+  cfd->set_compaction_vtime(  // Shichao
+      std::max(cfd->compaction_vtime(), compaction_vtime_));
 }
 
 ColumnFamilyData* DBImpl::PopFirstFromCompactionQueue() {
   assert(!compaction_queue_.empty());
-  auto cfd = *compaction_queue_.begin();
-  compaction_queue_.pop_front();
+  /***************************** Shichao ******************************/
+  // the least served column family, weighted, rather than the first one
+  auto it = compaction_queue_.begin();
+  for (auto i = it + 1; i != compaction_queue_.end(); ++i) {
+    if ((*i)->compaction_vtime() < (*it)->compaction_vtime()) {
+      it = i;
+    }
+  }
+  auto cfd = *it;
+  compaction_queue_.erase(it);
+  compaction_vtime_ = std::max(compaction_vtime_, cfd->compaction_vtime());
+  /***************************** Shichao ******************************/
   assert(cfd->pending_compaction());
   cfd->set_pending_compaction(false);
   return cfd;
@@ -3056,6 +3206,13 @@ Status DBImpl::BackgroundCompaction(bool* made_progress,
       // until we make a copy in the following code
       c.reset(cfd->PickCompaction(*mutable_cf_options, log_buffer));
       if (c != nullptr) {
+        /***************************** Shichao ******************************/
+        // charge the column family for the compaction before it can be
+        // queued again below
+        const double charge = c->CalculateTotalInputSize() /
+                              cfd->options()->background_job_weight;
+        cfd->set_compaction_vtime(cfd->compaction_vtime() + charge);
+        /***************************** Shichao ******************************/
         // update statistics
         MeasureTime(stats_, NUM_FILES_IN_SINGLE_COMPACTION,
                     c->inputs(0)->size());
@@ -3188,11 +3345,17 @@ Status DBImpl::BackgroundCompaction(bool* made_progress,
         c->mutable_cf_options()->report_bg_io_stats, dbname_,
         &compaction_job_stats);
     compaction_job.Prepare();
+    /***************************** Shichao ******************************/
+    auto running_start = running_compaction_starts_.insert(
+        running_compaction_starts_.end(), env_->NowMicros());
+    time_slice_cv_.SignalAll();
+    /***************************** Shichao ******************************/
 
     mutex_.Unlock();
     compaction_job.Run();
     TEST_SYNC_POINT("DBImpl::BackgroundCompaction:NonTrivial:AfterRun");
     mutex_.Lock();
+    running_compaction_starts_.erase(running_start);  // Shichao
 
     status = compaction_job.Install(*c->mutable_cf_options());
     if (status.ok()) {
@@ -3380,10 +3543,10 @@ static void CleanupIteratorState(void* arg1, void* arg2) {
 }
 }  // namespace
 
-InternalIterator* DBImpl::NewInternalIterator(const ReadOptions& read_options,
-                                              ColumnFamilyData* cfd,
-                                              SuperVersion* super_version,
-                                              Arena* arena) {
+InternalIterator* DBImpl::NewInternalIterator(
+    const ReadOptions& read_options, ColumnFamilyData* cfd,
+    SuperVersion* super_version, Arena* arena,
+    RangeDelAggregator* range_del_agg) {
   InternalIterator* internal_iter;
   assert(arena != nullptr);
   // Need to create internal iterator from the arena.
@@ -3393,9 +3556,16 @@ InternalIterator* DBImpl::NewInternalIterator(const ReadOptions& read_options,
       super_version->mem->NewIterator(read_options, arena));
   // Collect all needed child iterators for immutable memtables
   super_version->imm->AddIterators(read_options, &merge_iter_builder);
+  /***************************** Shichao ******************************/
+  // Collect the range tombstones of the memtables
+  if (range_del_agg != nullptr) {
+    range_del_agg->AddTombstones(super_version->mem->GetRangeTombstoneList());
+    super_version->imm->AddRangeTombstones(range_del_agg);
+  }
+  /***************************** Shichao ******************************/
   // Collect iterators for files in L0 - Ln
   super_version->current->AddIterators(read_options, env_options_,
-                                       &merge_iter_builder);
+                                       &merge_iter_builder, range_del_agg);
   internal_iter = merge_iter_builder.Finish();
   IterState* cleanup = new IterState(this, &mutex_, super_version);
   internal_iter->RegisterCleanup(CleanupIteratorState, cleanup, nullptr);
@@ -3456,6 +3626,21 @@ SuperVersion* DBImpl::InstallSuperVersionAndScheduleWork(
   SchedulePendingCompaction(cfd);
   MaybeScheduleFlushOrCompaction();
 
+  /***************************** Shichao ******************************/
+  // an auto-tuned rate limiter follows the compaction debt of the DB
+  if (db_options_.rate_limiter != nullptr) {
+    uint64_t pending_compaction_bytes = 0;
+    for (auto cfd_iter : *versions_->GetColumnFamilySet()) {
+      if (!cfd_iter->IsDropped() && cfd_iter->current() != nullptr) {
+        pending_compaction_bytes += cfd_iter->current()
+                                        ->storage_info()
+                                        ->estimated_compaction_needed_bytes();
+      }
+    }
+    db_options_.rate_limiter->Tune(pending_compaction_bytes);
+  }
+  /***************************** Shichao ******************************/
+
   // Update max_total_in_memory_state_
   max_total_in_memory_state_ =
       max_total_in_memory_state_ - old_memtable_size +
@@ -3467,6 +3652,9 @@ SuperVersion* DBImpl::InstallSuperVersionAndScheduleWork(
 Status DBImpl::GetImpl(ReadOptions& read_options,
                        ColumnFamilyHandle* column_family, const Slice& key,
                        std::string* value, bool* value_found) {
+  PerfSampler sampler(default_cf_internal_stats_,
+                      db_options_.perf_sample_rate,
+                      InternalStats::kSampledGet);  // Shichao
   StopWatch sw(env_, stats_, DB_GET);
   PERF_TIMER_GUARD(get_snapshot_time);
 
@@ -3483,6 +3671,9 @@ Status DBImpl::GetImpl(ReadOptions& read_options,
   // Acquire SuperVersion
   SuperVersion* sv = GetAndRefSuperVersion(cfd);
 
+  // Prepare to store a list of merge operations if merge occurs.
+  MergeContext merge_context;
+
   Status s;
   // First look in the memtable, then in the immutable memtable (if any).
   // s is both in/out. When in, s could either be OK or MergeInProgress.
@@ -3493,18 +3684,29 @@ Status DBImpl::GetImpl(ReadOptions& read_options,
   bool skip_memtable =
       (read_options.read_tier == kPersistedTier && has_unpersisted_data_);
   bool done = false;
+  // the newest range tombstone covering the key met so far
+  SequenceNumber max_covering_tombstone_seq = 0;  // Shichao
   if (!skip_memtable) {
-    if (sv->mem->Get(read_options, lkey, value, &s)) {
+    if (sv->mem->Get(read_options, lkey, value, &s, &merge_context,
+                     &max_covering_tombstone_seq)) {
       done = true;
       RecordTick(stats_, MEMTABLE_HIT);
-    } else if (sv->imm->Get(read_options, lkey, value, &s)) {
+    } else if ((s.ok() || s.IsMergeInProgress()) &&
+               sv->imm->Get(read_options, lkey, value, &s, &merge_context,
+                            &max_covering_tombstone_seq)) {
       done = true;
       RecordTick(stats_, MEMTABLE_HIT);
     }
+    if (!done && !s.ok() && !s.IsMergeInProgress()) {
+      ReturnAndCleanupSuperVersion(cfd, sv);
+      return s;
+    }
   }
   if (!done) {
     PERF_TIMER_GUARD(get_from_output_files_time);
-    sv->current->Get(read_options, lkey, value, &s, value_found);
+    sv->current->Get(read_options, lkey, value, &s, &merge_context,
+                     value_found, nullptr /* key_exists */,
+                     nullptr /* seq */, &max_covering_tombstone_seq);
     RecordTick(stats_, MEMTABLE_MISS);
   }
 
@@ -3521,9 +3723,75 @@ Status DBImpl::GetImpl(ReadOptions& read_options,
 }
 
 /***************************** Shichao ******************************/
+namespace {
+// The range query keeps the newest entry of each user key, which is only an
+// operand for a merged key, so the merged keys are resolved by a point lookup
+// at the same snapshot. They are few in general and the lookups are served
+// by the blocks the range query just read.
+Status ResolveRangeQueryMerges(ReadOptions& read_options, RangeQueryMeta* meta,
+                               bool skip_memtable) {
+  if (meta->column_family_data->ioptions()->merge_operator == nullptr) {
+    return Status::OK();
+  }
+  const auto& columns = read_options.columns;
+  if (columns.size() == 1 && columns[0] == 0) {
+    return Status::OK();  // only query the user keys
+  }
+
+  SuperVersion* sv = meta->super_version;
+  for (auto& it : *(meta->map_res)) {
+    if (it.second.type_ != kTypeMerge) {
+      continue;
+    }
+
+    MergeContext merge_context;
+    LookupKey lkey(it.first, meta->snapshot);
+    std::string value;
+    Status s;
+    bool done = false;
+    SequenceNumber max_covering_tombstone_seq = 0;
+    if (!skip_memtable) {
+      done = sv->mem->Get(read_options, lkey, &value, &s, &merge_context,
+                          &max_covering_tombstone_seq) ||
+             ((s.ok() || s.IsMergeInProgress()) &&
+              sv->imm->Get(read_options, lkey, &value, &s, &merge_context,
+                           &max_covering_tombstone_seq));
+    }
+    if (!done && (s.ok() || s.IsMergeInProgress())) {
+      sv->current->Get(read_options, lkey, &value, &s, &merge_context,
+                       nullptr /* value_found */, nullptr /* key_exists */,
+                       nullptr /* seq */, &max_covering_tombstone_seq);
+    }
+    if (!s.ok()) {
+      return s;
+    }
+
+    RangeQueryKeyVal& kv = *(it.second.iter_);
+    assert(read_options.result_val_size >= kv.value().size());
+    read_options.result_val_size -= kv.value().size();
+    kv.SetValue(value);
+    read_options.result_val_size += kv.value().size();
+  }
+  return Status::OK();
+}
+
+void ReleaseRangeQueryPins(void* arg1, void* arg2) {
+  PinnedIteratorsManager* pinned_iters_mgr =
+      reinterpret_cast<PinnedIteratorsManager*>(arg1);
+  pinned_iters_mgr->ReleasePinnedIterators();
+  delete pinned_iters_mgr;
+}
+}  // namespace
+
 bool DBImpl::RangeQuery(ReadOptions& read_options,
                         ColumnFamilyHandle* column_family, const Range& range,
                         std::list<RangeQueryKeyVal>& res, Status* s) {
+  PerfSampler sampler(default_cf_internal_stats_,
+                      db_options_.perf_sample_rate,
+                      InternalStats::kSampledRangeQuery);
+  StopWatch sw(env_, stats_, DB_RANGE_QUERY);
+  PERF_COUNTER_ADD(range_query_count, 1);
+  RecordTick(stats_, NUMBER_RANGE_QUERY);
   res.clear();
   read_options.result_key_size = 0;
   read_options.result_val_size = 0;
@@ -3547,10 +3815,31 @@ bool DBImpl::RangeQuery(ReadOptions& read_options,
     RangeQueryMeta* meta =
         static_cast<RangeQueryMeta*>(read_options.range_query_meta);
     meta->next_start_key.assign(range.start.data_, range.start.size_);
+    /***************************** Shichao ******************************/
+    // The tombstones of the memtables are collected once, those of the
+    // tables as they are read.
+    meta->range_del_agg =
+        new RangeDelAggregator(cfd->user_comparator(), snapshot);
+    if (read_options.read_tier != kPersistedTier || !has_unpersisted_data_) {
+      meta->range_del_agg->AddTombstones(sv->mem->GetRangeTombstoneList());
+      sv->imm->AddRangeTombstones(meta->range_del_agg);
+    }
+    /***************************** Shichao ******************************/
   }
 
   RangeQueryMeta* meta =
       static_cast<RangeQueryMeta*>(read_options.range_query_meta);
+  /***************************** Shichao ******************************/
+  // The table blocks read by this call stay pinned until the last result
+  // referencing them is released.
+  if (read_options.pin_data) {
+    meta->pinned_iters_mgr = new PinnedIteratorsManager();
+    meta->pinned_iters_mgr->StartPinning();
+    meta->pins = std::make_shared<Cleanable>();
+    meta->pins->RegisterCleanup(&ReleaseRangeQueryPins,
+                                meta->pinned_iters_mgr, nullptr);
+  }
+  /***************************** Shichao ******************************/
 
   // Create lookup key range
   LookupKey start_lookup_key(meta->next_start_key, meta->snapshot);
@@ -3567,20 +3856,31 @@ bool DBImpl::RangeQuery(ReadOptions& read_options,
   // First look in the memtable, then in the immutable memtable (if any).
   // s is both in/out. When in, s could be OK.
   if (!skip_memtable) {
-    if (!sv->mem->RangeQuery(read_options, lookup_range, res, s)) {
-      return false;
+    {
+      PERF_TIMER_GUARD(range_query_memtable_time);
+      if (!sv->mem->RangeQuery(read_options, lookup_range, res, s)) {
+        return false;
+      }
     }
-    if (!sv->imm->RangeQuery(read_options, lookup_range, res, s)) {
-      return false;
+    {
+      PERF_TIMER_GUARD(range_query_immutable_time);
+      if (!sv->imm->RangeQuery(read_options, lookup_range, res, s)) {
+        return false;
+      }
     }
   }
 
   *s = Status::OK();
-  sv->current->RangeQuery(read_options, lookup_range, res, s);
+  {
+    PERF_TIMER_GUARD(range_query_sst_time);
+    sv->current->RangeQuery(read_options, lookup_range, res, s);
+  }
   if (!s->ok()) {
     return false;
   }
 
+  PERF_TIMER_GUARD(range_query_post_process_time);
+
   // Update the next range query
   delete meta->current_limit_key;
   meta->current_limit_key = nullptr;
@@ -3593,7 +3893,7 @@ bool DBImpl::RangeQuery(ReadOptions& read_options,
     meta->next_start_key = std::move(it->first);
     // Not include the next start key
     size_t delta_key_size = it->second.iter_->user_key.size();
-    size_t delta_val_size = it->second.iter_->user_val.size();
+    size_t delta_val_size = it->second.iter_->value().size();
     res.erase(it->second.iter_);
     assert(read_options.result_key_size >= delta_key_size);
     assert(read_options.result_val_size >= delta_val_size);
@@ -3603,13 +3903,41 @@ bool DBImpl::RangeQuery(ReadOptions& read_options,
       meta->del_keys.erase(it->second.seq_);
     }
     meta->map_res->erase(it);
+    meta->trimmed_rows++;
+  }
+  PERF_COUNTER_ADD(range_query_trimmed_count, meta->trimmed_rows);
+  RecordTick(stats_, RANGE_QUERY_ROWS_TRIMMED, meta->trimmed_rows);
+  default_cf_internal_stats_->AddDBStats(
+      InternalStats::kIntStatsRangeQueryRowsTrimmed, meta->trimmed_rows);
+  meta->trimmed_rows = 0;
+
+  /***************************** Shichao ******************************/
+  // The newest entry of a user key covered by a range tombstone turns into
+  // a deletion. It is not kept in del_keys, the sequence numbers zeroed by
+  // the compactions are not unique.
+  std::vector<std::list<RangeQueryKeyVal>::iterator> range_del_keys;
+  if (!meta->range_del_agg->empty()) {
+    for (auto& it : *(meta->map_res)) {
+      SeqTypeVal& stv = it.second;
+      if (stv.type_ != kTypeDeletion &&
+          meta->range_del_agg->ShouldDelete(it.first, stv.seq_)) {
+        stv.type_ = kTypeDeletion;
+        range_del_keys.push_back(stv.iter_);
+      }
+    }
+  }
+  /***************************** Shichao ******************************/
+
+  *s = ResolveRangeQueryMerges(read_options, meta, skip_memtable);
+  if (!s->ok()) {
+    return false;
   }
   meta->map_res->clear();
 
   // Hide deleted keys from users, erase them in list
   for (const auto& it : meta->del_keys) {
     size_t delta_key_size = it.second->user_key.size();
-    size_t delta_val_size = it.second->user_val.size();
+    size_t delta_val_size = it.second->value().size();
     res.erase(it.second);
     assert(read_options.result_key_size >= delta_key_size);
     assert(read_options.result_val_size >= delta_val_size);
@@ -3617,6 +3945,33 @@ bool DBImpl::RangeQuery(ReadOptions& read_options,
     read_options.result_val_size -= delta_val_size;
   }
   meta->del_keys.clear();
+  /***************************** Shichao ******************************/
+  for (const auto& it : range_del_keys) {
+    assert(read_options.result_key_size >= it->user_key.size());
+    assert(read_options.result_val_size >= it->value().size());
+    read_options.result_key_size -= it->user_key.size();
+    read_options.result_val_size -= it->value().size();
+    res.erase(it);
+  }
+  /***************************** Shichao ******************************/
+
+  size_t result_size =
+      read_options.result_key_size + read_options.result_val_size;
+  RecordTick(stats_, NUMBER_RANGE_QUERY_KEYS_READ, res.size());
+  RecordTick(stats_, RANGE_QUERY_BYTES_READ, result_size);
+  MeasureTime(stats_, BYTES_PER_RANGE_QUERY, result_size);
+  auto internal_stats = default_cf_internal_stats_;
+  internal_stats->AddDBStats(InternalStats::kIntStatsRangeQueryBatches, 1);
+  internal_stats->AddDBStats(InternalStats::kIntStatsRangeQueryKeysRead,
+                             res.size());
+  internal_stats->AddDBStats(InternalStats::kIntStatsRangeQueryBytesRead,
+                             result_size);
+
+  /***************************** Shichao ******************************/
+  // The results hold the pins from now on
+  meta->pins.reset();
+  meta->pinned_iters_mgr = nullptr;
+  /***************************** Shichao ******************************/
 
   // Check if have the next range query
   bool next_query = true;
@@ -4043,7 +4398,10 @@ Iterator* DBImpl::NewIterator(const ReadOptions& read_options,
     auto iter = new ForwardIterator(this, read_options, cfd, sv);
     return NewDBIterator(env_, *cfd->ioptions(), cfd->user_comparator(), iter,
                          kMaxSequenceNumber, sv->version_number,
-                         read_options.pin_data);
+                         read_options.iterate_upper_bound,
+                         read_options.iterate_lower_bound,
+                         read_options.pin_data,
+                         iter->GetRangeDelAggregator());  // Shichao
 #endif
   } else {
     SequenceNumber latest_snapshot = versions_->LastSequence();
@@ -4099,11 +4457,15 @@ Iterator* DBImpl::NewIterator(const ReadOptions& read_options,
     // that they are likely to be in the same cache line and/or page.
     ArenaWrappedDBIter* db_iter = NewArenaWrappedDbIterator(
         env_, *cfd->ioptions(), cfd->user_comparator(), snapshot,
-        sv->version_number, read_options.pin_data);
+        sv->version_number, read_options.iterate_upper_bound,
+        read_options.iterate_lower_bound, read_options.pin_data);
 
     InternalIterator* internal_iter =
-        NewInternalIterator(read_options, cfd, sv, db_iter->GetArena());
+        NewInternalIterator(read_options, cfd, sv, db_iter->GetArena(),
+                            db_iter->GetRangeDelAggregator());  // Shichao
     db_iter->SetIterUnderDBIter(internal_iter);
+    db_iter->SetPerfSampling(default_cf_internal_stats_,
+                             db_options_.perf_sample_rate);  // Shichao
 
     return db_iter;
   }
@@ -4154,6 +4516,26 @@ Status DBImpl::Delete(const WriteOptions& write_options,
   return DB::Delete(write_options, column_family, key);
 }
 
+/***************************** Shichao ******************************/
+Status DBImpl::DeleteRange(const WriteOptions& write_options,
+                           ColumnFamilyHandle* column_family,
+                           const Slice& begin_key, const Slice& end_key) {
+  WriteBatch batch;
+  batch.DeleteRange(column_family, begin_key, end_key);
+  return Write(write_options, &batch);
+}
+/***************************** Shichao ******************************/
+
+Status DBImpl::Merge(const WriteOptions& o, ColumnFamilyHandle* column_family,
+                     const Slice& key, const Slice& val) {
+  auto cfh = reinterpret_cast<ColumnFamilyHandleImpl*>(column_family);
+  if (!cfh->cfd()->ioptions()->merge_operator) {
+    return Status::NotSupported("Provide a merge_operator when opening DB");
+  } else {
+    return DB::Merge(o, column_family, key, val);
+  }
+}
+
 Status DBImpl::Write(const WriteOptions& write_options, WriteBatch* my_batch) {
   return WriteImpl(write_options, my_batch, nullptr, nullptr);
 }
@@ -4168,9 +4550,13 @@ Status DBImpl::WriteImpl(const WriteOptions& write_options,
 
   Status status;
 
+  PerfSampler sampler(default_cf_internal_stats_,
+                      db_options_.perf_sample_rate,
+                      InternalStats::kSampledWrite);  // Shichao
   PERF_TIMER_GUARD(write_pre_and_post_process_time);
   WriteThread::Writer w;
   w.batch = my_batch;
+  w.callback = callback;
   w.sync = write_options.sync;
   w.disableWAL = write_options.disableWAL;
   w.disable_memtable = disable_memtable;
@@ -4357,6 +4743,15 @@ Status DBImpl::WriteImpl(const WriteOptions& write_options,
   last_batch_group_size_ =
       write_thread_.EnterAsBatchGroupLeader(&w, &last_writer, &write_group);
 
+  bool callback_failed = false;
+  if (status.ok() && callback != nullptr) {
+    // The write is alone in its group, validate it on the write thread
+    // before anything is logged or inserted.
+    assert(write_group.size() == 1);
+    status = callback->Callback(this);
+    callback_failed = !status.ok();
+  }
+
   if (status.ok()) {
     // Rules for when we can update the memtable concurrently
     // 1. supported by memtable
@@ -4551,7 +4946,8 @@ Status DBImpl::WriteImpl(const WriteOptions& write_options,
   }
   PERF_TIMER_START(write_pre_and_post_process_time);
 
-  if (db_options_.paranoid_checks && !status.ok() && !status.IsBusy()) {
+  if (db_options_.paranoid_checks && !status.ok() && !callback_failed &&
+      !status.IsBusy()) {
     mutex_.Lock();
     if (bg_error_.ok()) {
       bg_error_ = status;  // stop compaction & fail any further writes
@@ -5339,6 +5735,13 @@ Status DB::Delete(const WriteOptions& opt, ColumnFamilyHandle* column_family,
   return Write(opt, &batch);
 }
 
+Status DB::Merge(const WriteOptions& opt, ColumnFamilyHandle* column_family,
+                 const Slice& key, const Slice& value) {
+  WriteBatch batch;
+  batch.Merge(column_family, key, value);
+  return Write(opt, &batch);
+}
+
 // Default implementation -- returns not supported status
 Status DB::CreateColumnFamily(const ColumnFamilyOptions& cf_options,
                               const std::string& column_family_name,
@@ -5826,17 +6229,20 @@ Status DBImpl::GetLatestSequenceForKey(ReadOptions& options, SuperVersion* sv,
                                        SequenceNumber* seq,
                                        bool* found_record_for_key) {
   Status s;
+  MergeContext merge_context;
 
   SequenceNumber current_seq = versions_->LastSequence();
   LookupKey lkey(key, current_seq);
 
   *seq = kMaxSequenceNumber;
   *found_record_for_key = false;
+  SequenceNumber max_covering_tombstone_seq = 0;  // Shichao
 
   // Check if there is a record for this key in the latest memtable
-  sv->mem->Get(options, lkey, nullptr, &s, seq);
+  sv->mem->Get(options, lkey, nullptr, &s, &merge_context,
+               &max_covering_tombstone_seq, seq);
 
-  if (!(s.ok() || s.IsNotFound())) {
+  if (!(s.ok() || s.IsMergeInProgress() || s.IsNotFound())) {
     // unexpected error reading memtable.
     Log(InfoLogLevel::ERROR_LEVEL, db_options_.info_log,
         "Unexpected status returned from MemTable::Get: %s\n",
@@ -5852,9 +6258,10 @@ Status DBImpl::GetLatestSequenceForKey(ReadOptions& options, SuperVersion* sv,
   }
 
   // Check if there is a record for this key in the immutable memtables
-  sv->imm->Get(options, lkey, nullptr, &s, seq);
+  sv->imm->Get(options, lkey, nullptr, &s, &merge_context,
+               &max_covering_tombstone_seq, seq);
 
-  if (!(s.ok() || s.IsNotFound())) {
+  if (!(s.ok() || s.IsMergeInProgress() || s.IsNotFound())) {
     // unexpected error reading memtable.
     Log(InfoLogLevel::ERROR_LEVEL, db_options_.info_log,
         "Unexpected status returned from MemTableList::Get: %s\n",
@@ -5870,9 +6277,10 @@ Status DBImpl::GetLatestSequenceForKey(ReadOptions& options, SuperVersion* sv,
   }
 
   // Check if there is a record for this key in the immutable memtables
-  sv->imm->GetFromHistory(options, lkey, nullptr, &s, seq);
+  sv->imm->GetFromHistory(options, lkey, nullptr, &s, &merge_context,
+                          &max_covering_tombstone_seq, seq);
 
-  if (!(s.ok() || s.IsNotFound())) {
+  if (!(s.ok() || s.IsMergeInProgress() || s.IsNotFound())) {
     // unexpected error reading memtable.
     Log(InfoLogLevel::ERROR_LEVEL, db_options_.info_log,
         "Unexpected status returned from MemTableList::GetFromHistory: %s\n",
@@ -5893,10 +6301,11 @@ Status DBImpl::GetLatestSequenceForKey(ReadOptions& options, SuperVersion* sv,
     // Check tables
     ReadOptions read_options;
 
-    sv->current->Get(read_options, lkey, nullptr, &s, nullptr /* value_found */,
-                     found_record_for_key, seq);
+    sv->current->Get(read_options, lkey, nullptr, &s, &merge_context,
+                     nullptr /* value_found */, found_record_for_key, seq,
+                     &max_covering_tombstone_seq);
 
-    if (!(s.ok() || s.IsNotFound())) {
+    if (!(s.ok() || s.IsMergeInProgress() || s.IsNotFound())) {
       // unexpected error reading SST files
       Log(InfoLogLevel::ERROR_LEVEL, db_options_.info_log,
           "Unexpected status returned from Version::Get: %s\n",
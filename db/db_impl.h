@@ -21,6 +21,7 @@
 #include <queue>
 #include <set>
 #include <string>
+#include <thread>  // Shichao
 #include <utility>
 #include <vector>
 
@@ -44,6 +45,7 @@
 #include "vidardb/memtablerep.h"
 #include "vidardb/transaction_log.h"
 #include "table/scoped_arena_iterator.h"
+#include "table/table_open_state.h"  // Shichao
 #include "util/event_logger.h"
 #include "util/hash.h"
 #include "util/instrumented_mutex.h"
@@ -77,6 +79,15 @@ class DBImpl : public DB {
   virtual Status Delete(const WriteOptions& options,
                         ColumnFamilyHandle* column_family,
                         const Slice& key) override;
+  using DB::DeleteRange;
+  virtual Status DeleteRange(const WriteOptions& options,
+                             ColumnFamilyHandle* column_family,
+                             const Slice& begin_key,
+                             const Slice& end_key) override;  // Shichao
+  using DB::Merge;
+  virtual Status Merge(const WriteOptions& options,
+                       ColumnFamilyHandle* column_family, const Slice& key,
+                       const Slice& value) override;
   using DB::Write;
   virtual Status Write(const WriteOptions& options,
                        WriteBatch* updates) override;
@@ -339,6 +350,17 @@ class DBImpl : public DB {
   // compaction status.
   int BGCompactionsAllowed() const;
 
+  // The number of running compactions over
+  // db_options_.background_time_slice_micros.
+  // REQUIRES: mutex locked
+  int NumCompactionsOverTimeSlice() const;  // Shichao
+
+  // Shichao, run by time_slice_thread_ until shutdown: calls
+  // MaybeScheduleFlushOrCompaction() as each running compaction passes
+  // db_options_.background_time_slice_micros, since no flush or compaction
+  // finishing may call it then.
+  void BackgroundTimeSlice();
+
   // Returns the list of live files in 'live' and the list
   // of all files in the filesystem in 'candidate_files'.
   // If force == false and the last call was less than
@@ -474,10 +496,10 @@ class DBImpl : public DB {
   std::unordered_map<std::string, RecoveredTransaction*>
       recovered_transactions_;
 
-  InternalIterator* NewInternalIterator(const ReadOptions&,
-                                        ColumnFamilyData* cfd,
-                                        SuperVersion* super_version,
-                                        Arena* arena);
+  // The range tombstones met are added to *range_del_agg, if not nullptr.
+  InternalIterator* NewInternalIterator(
+      const ReadOptions&, ColumnFamilyData* cfd, SuperVersion* super_version,
+      Arena* arena, RangeDelAggregator* range_del_agg = nullptr);  // Shichao
 
   // Except in DB::Open(), WriteOptionsFile can only be called when:
   // 1. WriteThread::Writer::EnterUnbatched() is used.
@@ -519,11 +541,13 @@ class DBImpl : public DB {
   friend class DB;
   friend class InternalStats;
   friend class TransactionImpl;
+  friend class OptimisticTransactionImpl;
 #ifndef VIDARDB_LITE
   friend class ForwardIterator;
 #endif
   friend struct SuperVersion;
   friend class CompactedDBImpl;
+  friend class DBImplSecondary;  // Shichao
 #ifndef NDEBUG
   friend class XFTransactionWriteHandler;
 #endif
@@ -651,6 +675,10 @@ class DBImpl : public DB {
 
   const Snapshot* GetSnapshotImpl(bool is_write_conflict_boundary);
 
+  // Outlives table_cache_, whose table readers may open sub-column files
+  // through it. nullptr unless db_options_.persist_table_open_state.
+  std::unique_ptr<TableOpenState> table_open_state_;  // Shichao
+
   // table_cache_ provides its own synchronization
   std::shared_ptr<Cache> table_cache_;
 
@@ -816,6 +844,21 @@ class DBImpl : public DB {
   // invariant(column family present in compaction_queue_ <==>
   // ColumnFamilyData::pending_compaction_ == true)
   std::deque<ColumnFamilyData*> compaction_queue_;
+  /***************************** Shichao ******************************/
+  // The compaction queue is served in start-time fair order: the column
+  // family with the least ColumnFamilyData::compaction_vtime() is picked,
+  // the oldest on a tie. compaction_vtime_ is the one of the column family
+  // picked last; a column family joining the queue starts from at least it,
+  // so it can not claim the service it did not need while idle.
+  double compaction_vtime_;
+  // The start times of the running compactions, see
+  // NumCompactionsOverTimeSlice().
+  std::list<uint64_t> running_compaction_starts_;
+  // Signaled when a compaction starts and on shutdown, see
+  // BackgroundTimeSlice().
+  InstrumentedCondVar time_slice_cv_;
+  std::unique_ptr<std::thread> time_slice_thread_;
+  /***************************** Shichao ******************************/
   int unscheduled_flushes_;
   int unscheduled_compactions_;
 
@@ -8,6 +8,7 @@
 
 #include "db/db_impl.h"
 #include "db/db_iter.h"
+#include "db/merge_context.h"
 #include "util/perf_context_imp.h"
 
 namespace vidardb {
@@ -33,11 +34,16 @@ Status DBImplReadOnly::Get(ReadOptions& read_options,
   auto cfh = reinterpret_cast<ColumnFamilyHandleImpl*>(column_family);
   auto cfd = cfh->cfd();
   SuperVersion* super_version = cfd->GetSuperVersion();
+  MergeContext merge_context;
   LookupKey lkey(key, snapshot);
-  if (super_version->mem->Get(read_options, lkey, value, &s)) {
+  SequenceNumber max_covering_tombstone_seq = 0;  // Shichao
+  if (super_version->mem->Get(read_options, lkey, value, &s, &merge_context,
+                              &max_covering_tombstone_seq)) {
   } else {
     PERF_TIMER_GUARD(get_from_output_files_time);
-    super_version->current->Get(read_options, lkey, value, &s);
+    super_version->current->Get(read_options, lkey, value, &s, &merge_context,
+                                nullptr, nullptr, nullptr,
+                                &max_covering_tombstone_seq);
   }
   return s;
 }
@@ -54,9 +60,11 @@ Iterator* DBImplReadOnly::NewIterator(const ReadOptions& read_options,
            ? reinterpret_cast<const SnapshotImpl*>(read_options.snapshot)
                  ->number_
            : latest_snapshot),
-      super_version->version_number);
+      super_version->version_number, read_options.iterate_upper_bound,
+      read_options.iterate_lower_bound, read_options.pin_data);
   auto internal_iter = NewInternalIterator(
-      read_options, cfd, super_version, db_iter->GetArena());
+      read_options, cfd, super_version, db_iter->GetArena(),
+      db_iter->GetRangeDelAggregator());  // Shichao
   db_iter->SetIterUnderDBIter(internal_iter);
   return db_iter;
 }
@@ -0,0 +1,372 @@
+//  Copyright (c) 2020-present, VidarDB, Inc.  All rights reserved.
+//  This source code is licensed under the BSD-style license found in the
+//  LICENSE file in the root directory of this source tree. An additional grant
+//  of patent rights can be found in the PATENTS file in the same directory.
+
+#include "db/db_impl_secondary.h"
+
+#ifndef __STDC_FORMAT_MACROS
+#define __STDC_FORMAT_MACROS
+#endif
+
+#include <inttypes.h>
+#include <algorithm>
+#include <limits>
+#include <unordered_set>
+
+#include "db/auto_roll_logger.h"
+#include "db/column_family.h"
+#include "db/filename.h"
+#include "db/log_reader.h"
+#include "db/table_cache.h"
+#include "db/version_set.h"
+#include "db/write_batch_internal.h"
+#include "util/file_reader_writer.h"
+#include "util/logging.h"
+#include "util/statistics.h"
+
+namespace vidardb {
+
+#ifndef VIDARDB_LITE
+
+DBImplSecondary::DBImplSecondary(const DBOptions& db_options,
+                                 const std::string& dbname)
+    : DBImplReadOnly(db_options, dbname), catch_up_in_progress_(false) {
+  // the versions replaced only lose their files in the view of this
+  // instance, the primary deletes them
+  disable_delete_obsolete_files_ = 1;
+  Log(InfoLogLevel::INFO_LEVEL, db_options_.info_log,
+      "Opening the db as a secondary instance");
+  LogFlush(db_options_.info_log);
+}
+
+DBImplSecondary::~DBImplSecondary() {
+}
+
+Status DBImplSecondary::Get(ReadOptions& read_options,
+                            ColumnFamilyHandle* column_family,
+                            const Slice& key, std::string* value) {
+  return DBImpl::Get(read_options, column_family, key, value);
+}
+
+Iterator* DBImplSecondary::NewIterator(const ReadOptions& read_options,
+                                       ColumnFamilyHandle* column_family) {
+  return DBImpl::NewIterator(read_options, column_family);
+}
+
+Status DBImplSecondary::Recover(
+    const std::vector<ColumnFamilyDescriptor>& column_families) {
+  mutex_.AssertHeld();
+
+  Status s = versions_->Recover(column_families, true /* read only */);
+  if (db_options_.paranoid_checks && s.ok()) {
+    s = CheckConsistency();
+  }
+  if (!s.ok()) {
+    return s;
+  }
+  default_cf_handle_ = new ColumnFamilyHandleImpl(
+      versions_->GetColumnFamilySet()->GetDefault(), this, &mutex_);
+  default_cf_internal_stats_ = default_cf_handle_->cfd()->internal_stats();
+  single_column_family_mode_ =
+      versions_->GetColumnFamilySet()->NumberOfColumnFamilies() == 1;
+
+  s = CatchUpWithLogs();
+  SetTickerCount(stats_, SEQUENCE_NUMBER, versions_->LastSequence());
+  return s;
+}
+
+bool DBImplSecondary::MemtablesOutdated() const {
+  for (auto cfd : *versions_->GetColumnFamilySet()) {
+    if (cfd->IsDropped()) {
+      continue;
+    }
+    auto it = memtable_log_numbers_.find(cfd->GetID());
+    if (it == memtable_log_numbers_.end() ||
+        it->second != cfd->GetLogNumber()) {
+      return true;
+    }
+  }
+  return false;
+}
+
+Status DBImplSecondary::CatchUpWithLogs() {
+  struct LogReporter : public log::Reader::Reporter {
+    Logger* info_log;
+    const char* fname;
+    Status* status;  // nullptr if db_options_.paranoid_checks==false
+    virtual void Corruption(size_t bytes, const Status& s) override {
+      Log(InfoLogLevel::WARN_LEVEL,
+          info_log, "%s%s: dropping %d bytes; %s",
+          (this->status == nullptr ? "(ignoring error) " : ""),
+          fname, static_cast<int>(bytes), s.ToString().c_str());
+      if (this->status != nullptr && this->status->ok()) {
+        *this->status = s;
+      }
+    }
+  };
+
+  mutex_.AssertHeld();
+
+  // The data of the logs older than the log number of a column family is in
+  // its tables, so its memtable is recreated when the primary has flushed.
+  if (MemtablesOutdated()) {
+    memtable_log_numbers_.clear();
+    for (auto cfd : *versions_->GetColumnFamilySet()) {
+      if (cfd->IsDropped()) {
+        continue;
+      }
+      cfd->CreateNewMemtable(*cfd->GetLatestMutableCFOptions(),
+                             kMaxSequenceNumber);
+      memtable_log_numbers_[cfd->GetID()] = cfd->GetLogNumber();
+    }
+    log_offsets_.clear();
+  }
+
+  std::vector<std::string> filenames;
+  Status status = env_->GetChildren(db_options_.wal_dir, &filenames);
+  if (!status.ok()) {
+    return status;
+  }
+  uint64_t min_log_number = versions_->MinLogNumber();
+  std::vector<uint64_t> logs;
+  for (const auto& filename : filenames) {
+    uint64_t number;
+    FileType type;
+    if (ParseFileName(filename, &number, &type) && type == kLogFile &&
+        number >= min_log_number) {
+      logs.push_back(number);
+    }
+  }
+  std::sort(logs.begin(), logs.end());
+  log_offsets_.erase(log_offsets_.begin(),
+                     log_offsets_.lower_bound(min_log_number));
+
+  SequenceNumber last_sequence = versions_->LastSequence();
+  for (auto log_number : logs) {
+    std::string fname = LogFileName(db_options_.wal_dir, log_number);
+    unique_ptr<SequentialFileReader> file_reader;
+    {
+      unique_ptr<SequentialFile> file;
+      status = env_->NewSequentialFile(fname, &file, env_options_);
+      if (!status.ok()) {
+        if (env_->FileExists(fname).IsNotFound()) {
+          // archived or deleted by the primary in the meantime
+          status = Status::OK();
+          continue;
+        }
+        return status;
+      }
+      file_reader.reset(new SequentialFileReader(std::move(file)));
+    }
+
+    LogReporter reporter;
+    reporter.info_log = db_options_.info_log.get();
+    reporter.fname = fname.c_str();
+    reporter.status = db_options_.paranoid_checks ? &status : nullptr;
+    uint64_t& offset = log_offsets_[log_number];
+    log::Reader reader(db_options_.info_log, std::move(file_reader), &reporter,
+                       true /*checksum*/, offset, log_number);
+
+    // The last record of a log being written may be incomplete, the reader
+    // of the next call is opened past the last record read, and reads it
+    // again.
+    std::string scratch;
+    Slice record;
+    WriteBatch batch;
+    while (reader.ReadRecord(&record, &scratch,
+                             WALRecoveryMode::kTolerateCorruptedTailRecords) &&
+           status.ok()) {
+      offset = reader.LastRecordOffset() + 1;
+      if (record.size() < WriteBatchInternal::kHeader) {
+        reporter.Corruption(record.size(),
+                            Status::Corruption("log record too small"));
+        continue;
+      }
+      WriteBatchInternal::SetContents(&batch, record);
+
+      // The column families flushed after the record are skipped
+      SequenceNumber next_sequence = kMaxSequenceNumber;
+      status = WriteBatchInternal::InsertInto(
+          &batch, column_family_memtables_.get(), &flush_scheduler_, true,
+          log_number, this, false, &next_sequence);
+      MaybeIgnoreError(&status);
+      if (!status.ok()) {
+        reporter.Corruption(record.size(), status);
+        continue;
+      }
+      if (next_sequence > 0 && next_sequence - 1 > last_sequence) {
+        last_sequence = next_sequence - 1;
+      }
+    }
+    // the memtables are never flushed by this instance
+    flush_scheduler_.Clear();
+    if (!status.ok()) {
+      return status;
+    }
+  }
+
+  if (last_sequence > versions_->LastSequence()) {
+    versions_->SetLastSequence(last_sequence);
+  }
+  return status;
+}
+
+void DBImplSecondary::ReleaseObsoleteFiles() {
+  mutex_.AssertHeld();
+  std::vector<FileMetaData*> files;
+  std::vector<std::string> manifests;
+  versions_->GetObsoleteFiles(&files, &manifests,
+                              std::numeric_limits<uint64_t>::max());
+  if (files.empty()) {
+    return;
+  }
+
+  // a table rebuilt from a new MANIFEST is still live
+  std::vector<FileDescriptor> live;
+  versions_->AddLiveFiles(&live);
+  std::unordered_set<uint64_t> live_numbers;
+  for (const auto& fd : live) {
+    live_numbers.insert(fd.GetNumber());
+  }
+  for (auto f : files) {
+    if (live_numbers.count(f->fd.GetNumber()) == 0) {
+      TableCache::Evict(table_cache_.get(), f->fd.GetNumber());
+    }
+    delete f;
+  }
+}
+
+Status DBImplSecondary::TryCatchUpWithPrimary() {
+  InstrumentedMutexLock l(&mutex_);
+  while (catch_up_in_progress_) {
+    bg_cv_.Wait();
+  }
+  catch_up_in_progress_ = true;
+
+  std::unordered_set<ColumnFamilyData*> cfds_changed;
+  Status s = versions_->TailManifest(&mutex_, &cfds_changed);
+  // The primary deletes a log once its memtable is flushed, which may be
+  // after the manifest is read, so the records missed are read from the
+  // tables of the flush, found by reading the manifest again.
+  while (s.ok()) {
+    s = CatchUpWithLogs();
+    if (s.ok()) {
+      s = versions_->TailManifest(&mutex_, &cfds_changed);
+    }
+    if (!MemtablesOutdated()) {
+      break;
+    }
+  }
+
+  // the new reads see the new versions and memtables
+  for (auto cfd : *versions_->GetColumnFamilySet()) {
+    if (!cfd->IsDropped()) {
+      delete cfd->InstallSuperVersion(new SuperVersion(), &mutex_);
+    }
+  }
+  ReleaseObsoleteFiles();
+  catch_up_in_progress_ = false;
+  bg_cv_.SignalAll();
+
+  Log(InfoLogLevel::INFO_LEVEL, db_options_.info_log,
+      "Caught up with the primary: %" VIDARDB_PRIszt
+      " column families changed, last sequence %" PRIu64 ", %s",
+      cfds_changed.size(), versions_->LastSequence(), s.ToString().c_str());
+  return s;
+}
+
+Status DB::OpenAsSecondary(const Options& options, const std::string& dbname,
+                           const std::string& secondary_path, DB** dbptr) {
+  *dbptr = nullptr;
+
+  DBOptions db_options(options);
+  ColumnFamilyOptions cf_options(options);
+  std::vector<ColumnFamilyDescriptor> column_families;
+  column_families.push_back(
+      ColumnFamilyDescriptor(kDefaultColumnFamilyName, cf_options));
+  std::vector<ColumnFamilyHandle*> handles;
+
+  Status s = DB::OpenAsSecondary(db_options, dbname, secondary_path,
+                                 column_families, &handles, dbptr);
+  if (s.ok()) {
+    assert(handles.size() == 1);
+    // i can delete the handle since DBImpl is always holding a
+    // reference to default column family
+    delete handles[0];
+  }
+  return s;
+}
+
+Status DB::OpenAsSecondary(
+    const DBOptions& db_options, const std::string& dbname,
+    const std::string& secondary_path,
+    const std::vector<ColumnFamilyDescriptor>& column_families,
+    std::vector<ColumnFamilyHandle*>* handles, DB** dbptr) {
+  *dbptr = nullptr;
+  handles->clear();
+
+  // the info log of the primary is left alone
+  DBOptions secondary_options(db_options);
+  if (secondary_options.info_log == nullptr) {
+    Status s = CreateLoggerFromOptions(secondary_path, secondary_options,
+                                       &secondary_options.info_log);
+    if (!s.ok()) {
+      return s;
+    }
+  }
+
+  DBImplSecondary* impl = new DBImplSecondary(secondary_options, dbname);
+  impl->mutex_.Lock();
+  Status s = impl->Recover(column_families);
+  if (s.ok()) {
+    // set column family handles
+    for (auto cf : column_families) {
+      auto cfd =
+          impl->versions_->GetColumnFamilySet()->GetColumnFamily(cf.name);
+      if (cfd == nullptr) {
+        s = Status::InvalidArgument("Column family not found: ", cf.name);
+        break;
+      }
+      handles->push_back(new ColumnFamilyHandleImpl(cfd, impl, &impl->mutex_));
+    }
+  }
+  if (s.ok()) {
+    for (auto cfd : *impl->versions_->GetColumnFamilySet()) {
+      delete cfd->InstallSuperVersion(new SuperVersion(), &impl->mutex_);
+    }
+  }
+  impl->mutex_.Unlock();
+  if (s.ok()) {
+    *dbptr = impl;
+    for (auto* h : *handles) {
+      impl->NewThreadStatusCfInfo(
+          reinterpret_cast<ColumnFamilyHandleImpl*>(h)->cfd());
+    }
+  } else {
+    for (auto h : *handles) {
+      delete h;
+    }
+    handles->clear();
+    delete impl;
+  }
+  return s;
+}
+
+#else  // !VIDARDB_LITE
+
+Status DB::OpenAsSecondary(const Options& options, const std::string& dbname,
+                           const std::string& secondary_path, DB** dbptr) {
+  return Status::NotSupported("Not supported in VIDARDB_LITE.");
+}
+
+Status DB::OpenAsSecondary(
+    const DBOptions& db_options, const std::string& dbname,
+    const std::string& secondary_path,
+    const std::vector<ColumnFamilyDescriptor>& column_families,
+    std::vector<ColumnFamilyHandle*>* handles, DB** dbptr) {
+  return Status::NotSupported("Not supported in VIDARDB_LITE.");
+}
+#endif  // !VIDARDB_LITE
+
+}  // namespace vidardb
@@ -0,0 +1,81 @@
+//  Copyright (c) 2020-present, VidarDB, Inc.  All rights reserved.
+//  This source code is licensed under the BSD-style license found in the
+//  LICENSE file in the root directory of this source tree. An additional grant
+//  of patent rights can be found in the PATENTS file in the same directory.
+
+#pragma once
+
+#ifndef VIDARDB_LITE
+
+#include <map>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "db/db_impl_readonly.h"
+
+namespace vidardb {
+
+// A read only instance which follows the primary writing in the same
+// directory: TryCatchUpWithPrimary() applies the new MANIFEST edits and
+// replays the WAL records written since into its own memtables. It neither
+// flushes nor compacts, and never deletes a file of the primary.
+class DBImplSecondary : public DBImplReadOnly {
+ public:
+  DBImplSecondary(const DBOptions& options, const std::string& dbname);
+  virtual ~DBImplSecondary();
+
+  // The reads reference their super versions, which are replaced by the
+  // catch-ups.
+  using DB::Get;
+  virtual Status Get(ReadOptions& options, ColumnFamilyHandle* column_family,
+                     const Slice& key, std::string* value) override;
+
+  using DBImpl::NewIterator;
+  virtual Iterator* NewIterator(const ReadOptions&,
+                                ColumnFamilyHandle* column_family) override;
+
+  virtual Status TryCatchUpWithPrimary() override;
+
+ private:
+  friend class DB;
+
+  // Recover the versions of the MANIFEST and replay the WAL.
+  Status Recover(const std::vector<ColumnFamilyDescriptor>& column_families);
+
+  // Whether the primary has flushed a column family since its memtable was
+  // created.
+  // REQUIRES: mutex_ is held.
+  bool MemtablesOutdated() const;
+
+  // Replay the WAL records written since the last call into the memtables.
+  // If the primary has flushed, the memtables are recreated and the live WAL
+  // files are replayed again from their start.
+  // REQUIRES: mutex_ is held.
+  Status CatchUpWithLogs();
+
+  // Free the file metadata of the versions replaced, and evict their tables
+  // if no live version has them any more.
+  // REQUIRES: mutex_ is held.
+  void ReleaseObsoleteFiles();
+
+  // The offset past the last record replayed, of each WAL file.
+  std::map<uint64_t, uint64_t> log_offsets_;
+
+  // The log number of each column family when its memtable was created.
+  std::unordered_map<uint32_t, uint64_t> memtable_log_numbers_;
+
+  // Whether a TryCatchUpWithPrimary() is running. The catch-ups release
+  // mutex_ while they open the new tables, and one starting from the same
+  // MANIFEST offset could install an older version after a later one. The
+  // others wait on bg_cv_ until it is cleared.
+  bool catch_up_in_progress_;
+
+  // No copying allowed
+  DBImplSecondary(const DBImplSecondary&);
+  void operator=(const DBImplSecondary&);
+};
+
+}  // namespace vidardb
+
+#endif  // !VIDARDB_LITE
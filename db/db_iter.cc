@@ -15,7 +15,11 @@
 
 #include "db/dbformat.h"
 #include "db/filename.h"
+#include "db/merge_context.h"
+#include "db/merge_helper.h"
+#include "db/perf_sampler.h"  // Shichao
 #include "db/pinned_iterators_manager.h"
+#include "db/range_del_aggregator.h"  // Shichao
 #include "port/port.h"
 #include "vidardb/env.h"
 #include "vidardb/iterator.h"
@@ -100,11 +104,14 @@ class DBIter: public Iterator {
 
   DBIter(Env* env, const ImmutableCFOptions& ioptions, const Comparator* cmp,
          InternalIterator* iter, SequenceNumber s, bool arena_mode,
-         uint64_t version_number, bool pin_data = false)
+         uint64_t version_number, const Slice* iterate_upper_bound = nullptr,
+         const Slice* iterate_lower_bound = nullptr, bool pin_data = false,
+         RangeDelAggregator* range_del_agg = nullptr)
       : arena_mode_(arena_mode),
         env_(env),
         logger_(ioptions.info_log),
         user_comparator_(cmp),
+        user_merge_operator_(ioptions.merge_operator),
         iter_(iter),
         sequence_(s),
         direction_(kForward),
@@ -112,7 +119,10 @@ class DBIter: public Iterator {
         current_entry_is_merged_(false),
         statistics_(ioptions.statistics),
         version_number_(version_number),
-        pin_thru_lifetime_(pin_data) {
+        iterate_upper_bound_(iterate_upper_bound),  // Shichao
+        iterate_lower_bound_(iterate_lower_bound),  // Shichao
+        pin_thru_lifetime_(pin_data),
+        range_del_agg_(range_del_agg) {  // Shichao
     RecordTick(statistics_, NO_ITERATORS);
     if (pin_thru_lifetime_) {
       pinned_iters_mgr_.StartPinning();
@@ -198,6 +208,19 @@ class DBIter: public Iterator {
   inline void FindNextUserEntry(bool skipping);
   void FindNextUserEntryInternal(bool skipping);
   bool ParseKey(ParsedInternalKey* key);
+  void MergeValuesNewToOld();
+  /***************************** Shichao ******************************/
+  // Return the type of ikey seen through the range tombstones: a value or
+  // a merge operand they cover reads as a deletion.
+  ValueType VisibleType(const ParsedInternalKey& ikey) const {
+    if ((ikey.type == kTypeValue || ikey.type == kTypeMerge) &&
+        range_del_agg_ != nullptr && !range_del_agg_->empty() &&
+        range_del_agg_->ShouldDelete(ikey)) {
+      return kTypeDeletion;
+    }
+    return ikey.type;
+  }
+  /***************************** Shichao ******************************/
 
   // Temporarily pin the blocks that we encounter until ReleaseTempPinnedData()
   // is called
@@ -227,6 +250,7 @@ class DBIter: public Iterator {
   Env* const env_;
   Logger* logger_;
   const Comparator* const user_comparator_;
+  const MergeOperator* const user_merge_operator_;
   InternalIterator* iter_;
   SequenceNumber const sequence_;
 
@@ -239,10 +263,21 @@ class DBIter: public Iterator {
   bool current_entry_is_merged_;
   Statistics* statistics_;
   uint64_t version_number_;
+  /***************************** Shichao ******************************/
+  const Slice* iterate_upper_bound_;  // exclusive
+  const Slice* iterate_lower_bound_;  // inclusive
+  /***************************** Shichao ******************************/
   // Means that we will pin all data blocks we read as long the Iterator
   // is not deleted, will be true if ReadOptions::pin_data is true
   const bool pin_thru_lifetime_;
+  /***************************** Shichao ******************************/
+  // The range tombstones of the memtables and tables read, not owned
+  RangeDelAggregator* range_del_agg_;
+  /***************************** Shichao ******************************/
   // List of operands for merge operator.
+  MergeContext merge_context_;
+  // Value of the current key in reverse direction
+  std::string reverse_value_;
   LocalStatistics local_stats_;
   PinnedIteratorsManager pinned_iters_mgr_;
 
@@ -328,13 +363,21 @@ void DBIter::FindNextUserEntryInternal(bool skipping) {
     ParsedInternalKey ikey;
 
     if (ParseKey(&ikey)) {
+      /***************************** Shichao ******************************/
+      if (iterate_upper_bound_ != nullptr &&
+          user_comparator_->Compare(ikey.user_key,
+                                    *iterate_upper_bound_) >= 0) {
+        break;
+      }
+      /***************************** Shichao ******************************/
       if (ikey.sequence <= sequence_) {
         if (skipping &&
            user_comparator_->Compare(ikey.user_key, saved_key_.GetKey()) <= 0) {
           PERF_COUNTER_ADD(internal_key_skipped_count, 1);
         } else {
-          switch (ikey.type) {
+          switch (VisibleType(ikey)) {  // Shichao
             case kTypeDeletion:
+            case kTypeSingleDeletion:
               // Arrange to skip all upcoming entries for this key since
               // they are hidden by this deletion.
               saved_key_.SetKey(
@@ -349,6 +392,15 @@ void DBIter::FindNextUserEntryInternal(bool skipping) {
                   ikey.user_key,
                   !iter_->IsKeyPinned() || !pin_thru_lifetime_ /* copy */);
               return;
+            case kTypeMerge:
+              saved_key_.SetKey(
+                  ikey.user_key,
+                  !iter_->IsKeyPinned() || !pin_thru_lifetime_ /* copy */);
+              // By now, we are sure the current ikey is going to yield a value
+              current_entry_is_merged_ = true;
+              valid_ = true;
+              MergeValuesNewToOld();  // Go to a different state machine
+              return;
             default:
               assert(false);
               break;
@@ -362,6 +414,74 @@ void DBIter::FindNextUserEntryInternal(bool skipping) {
   valid_ = false;
 }
 
+// Merge values of the same user key starting from the current iter_ position
+// Scan from the newer entries to older entries.
+// PRE: iter_->key() points to the first merge type entry
+//      saved_key_ stores the user key
+// POST: saved_value_ has the merged value for the user key
+//       iter_ points to the next entry (or invalid)
+void DBIter::MergeValuesNewToOld() {
+  if (!user_merge_operator_) {
+    Log(InfoLogLevel::ERROR_LEVEL,
+        logger_, "Options::merge_operator is null.");
+    status_ = Status::InvalidArgument("user_merge_operator_ must be set.");
+    valid_ = false;
+    return;
+  }
+
+  // Start the merge process by pushing the first operand
+  merge_context_.Clear();
+  merge_context_.PushOperand(iter_->value());
+
+  ParsedInternalKey ikey;
+  const Slice* base_value = nullptr;
+  Slice val;
+  for (iter_->Next(); iter_->Valid(); iter_->Next()) {
+    if (!ParseKey(&ikey)) {
+      // skip corrupted key
+      continue;
+    }
+
+    const ValueType type = VisibleType(ikey);  // Shichao
+    if (!user_comparator_->Equal(ikey.user_key, saved_key_.GetKey())) {
+      // hit the next user key, stop right here
+      break;
+    } else if (kTypeDeletion == type || kTypeSingleDeletion == type) {
+      // hit a delete with the same user key, stop right here
+      // iter_ is positioned after delete
+      iter_->Next();
+      break;
+    } else if (kTypeValue == type) {
+      // hit a put, merge the put value with operands and store the
+      // final result in saved_value_. We are done!
+      val = iter_->value();
+      base_value = &val;
+      break;
+    } else if (kTypeMerge == type) {
+      // hit a merge, add the value as an operand and continue.
+      merge_context_.PushOperand(iter_->value());
+    } else {
+      assert(false);
+    }
+  }
+
+  // we either exhausted all internal keys under this user key, hit a put, or
+  // hit a deletion marker. Without a put, null is fed as the existing value
+  // to the merge operator, such that client can differentiate this scenario
+  // and do things accordingly.
+  Status s = MergeHelper::TimedFullMerge(
+      saved_key_.GetKey(), base_value, merge_context_.GetOperands(),
+      user_merge_operator_, statistics_, env_, logger_, &saved_value_);
+  if (base_value != nullptr) {
+    // iter_ is positioned after put
+    iter_->Next();
+  }
+  if (!s.ok()) {
+    status_ = s;
+    valid_ = false;
+  }
+}
+
 void DBIter::Prev() {
   assert(valid_);
   if (direction_ == kForward) {
@@ -416,6 +536,15 @@ void DBIter::PrevInternal() {
   while (iter_->Valid()) {
     saved_key_.SetKey(ExtractUserKey(iter_->key()),
                       !iter_->IsKeyPinned() || !pin_thru_lifetime_ /* copy */);
+    /***************************** Shichao ******************************/
+    if (iterate_lower_bound_ != nullptr &&
+        user_comparator_->Compare(saved_key_.GetKey(),
+                                  *iterate_lower_bound_) < 0) {
+      // the remaining keys are all before the lower bound
+      valid_ = false;
+      return;
+    }
+    /***************************** Shichao ******************************/
     if (FindValueForCurrentKey()) {
       valid_ = true;
       if (!iter_->Valid()) {
@@ -445,8 +574,10 @@ void DBIter::PrevInternal() {
 bool DBIter::FindValueForCurrentKey() {
   assert(iter_->Valid());
   current_entry_is_merged_ = false;
+  merge_context_.Clear();
   // last entry before merge (could be kTypeDeletion, kTypeSingleDeletion or
   // kTypeValue)
+  ValueType last_not_merge_type = kTypeDeletion;
   ValueType last_key_entry_type = kTypeDeletion;
 
   ParsedInternalKey ikey;
@@ -454,16 +585,28 @@ bool DBIter::FindValueForCurrentKey() {
 
   while (iter_->Valid() && ikey.sequence <= sequence_ &&
          user_comparator_->Equal(ikey.user_key, saved_key_.GetKey())) {
-    last_key_entry_type = ikey.type;
+    last_key_entry_type = VisibleType(ikey);  // Shichao
     switch (last_key_entry_type) {
       case kTypeValue:
+        merge_context_.Clear();
         ReleaseTempPinnedData();
         TempPinData();
-        pinned_value_ = iter_->value();
+        // ColumnTable iterators stitch the value into their own buffer,
+        // which is overwritten once moved, so the value is kept as a copy
+        reverse_value_.assign(iter_->value().data(), iter_->value().size());
+        pinned_value_ = reverse_value_;
+        last_not_merge_type = kTypeValue;
         break;
       case kTypeDeletion:
+      case kTypeSingleDeletion:
+        merge_context_.Clear();
+        last_not_merge_type = last_key_entry_type;
         PERF_COUNTER_ADD(internal_delete_skipped_count, 1);
         break;
+      case kTypeMerge:
+        // The entries are met from the oldest to the newest here
+        merge_context_.PushOperandBack(iter_->value());
+        break;
       default:
         assert(false);
     }
@@ -474,10 +617,34 @@ bool DBIter::FindValueForCurrentKey() {
     FindParseableKey(&ikey, kReverse);
   }
 
+  Status s;
   switch (last_key_entry_type) {
     case kTypeDeletion:
+    case kTypeSingleDeletion:
       valid_ = false;
       return false;
+    case kTypeMerge:
+      current_entry_is_merged_ = true;
+      if (!user_merge_operator_) {
+        status_ = Status::InvalidArgument("user_merge_operator_ must be set.");
+        valid_ = false;
+        return false;
+      }
+      if (last_not_merge_type == kTypeValue) {
+        s = MergeHelper::TimedFullMerge(
+            saved_key_.GetKey(), &pinned_value_, merge_context_.GetOperands(),
+            user_merge_operator_, statistics_, env_, logger_, &saved_value_);
+      } else {
+        s = MergeHelper::TimedFullMerge(
+            saved_key_.GetKey(), nullptr, merge_context_.GetOperands(),
+            user_merge_operator_, statistics_, env_, logger_, &saved_value_);
+      }
+      if (!s.ok()) {
+        status_ = s;
+        valid_ = false;
+        return false;
+      }
+      break;
     case kTypeValue:
       // do nothing - we've already has value in saved_value_
       break;
@@ -538,7 +705,14 @@ void DBIter::Seek(const Slice& target) {
   ReleaseTempPinnedData();
   saved_key_.Clear();
   // now savved_key is used to store internal key.
-  saved_key_.SetInternalKey(target, sequence_);
+  /***************************** Shichao ******************************/
+  if (iterate_lower_bound_ != nullptr &&
+      user_comparator_->Compare(target, *iterate_lower_bound_) < 0) {
+    saved_key_.SetInternalKey(*iterate_lower_bound_, sequence_);
+  } else {
+    saved_key_.SetInternalKey(target, sequence_);
+  }
+  /***************************** Shichao ******************************/
 
   {
     PERF_TIMER_GUARD(seek_internal_seek_time);
@@ -570,7 +744,15 @@ void DBIter::SeekToFirst() {
 
   {
     PERF_TIMER_GUARD(seek_internal_seek_time);
-    iter_->SeekToFirst();
+    /***************************** Shichao ******************************/
+    if (iterate_lower_bound_ != nullptr) {
+      saved_key_.Clear();
+      saved_key_.SetInternalKey(*iterate_lower_bound_, sequence_);
+      iter_->Seek(saved_key_.GetKey());
+    } else {
+      iter_->SeekToFirst();
+    }
+    /***************************** Shichao ******************************/
   }
 
   RecordTick(statistics_, NUMBER_DB_SEEK);
@@ -596,7 +778,22 @@ void DBIter::SeekToLast() {
 
   {
     PERF_TIMER_GUARD(seek_internal_seek_time);
-    iter_->SeekToLast();
+    /***************************** Shichao ******************************/
+    if (iterate_upper_bound_ != nullptr) {
+      // the newest entry of the bound sorts first among its entries, so the
+      // entry before it is the last one before the bound
+      saved_key_.Clear();
+      saved_key_.SetInternalKey(*iterate_upper_bound_, kMaxSequenceNumber);
+      iter_->Seek(saved_key_.GetKey());
+      if (iter_->Valid()) {
+        iter_->Prev();
+      } else {
+        iter_->SeekToLast();
+      }
+    } else {
+      iter_->SeekToLast();
+    }
+    /***************************** Shichao ******************************/
   }
   PrevInternal();
   if (statistics_ != nullptr) {
@@ -612,10 +809,13 @@ Iterator* NewDBIterator(Env* env, const ImmutableCFOptions& ioptions,
                         const Comparator* user_key_comparator,
                         InternalIterator* internal_iter,
                         const SequenceNumber& sequence, uint64_t version_number,
-                        bool pin_data) {
+                        const Slice* iterate_upper_bound,
+                        const Slice* iterate_lower_bound, bool pin_data,
+                        RangeDelAggregator* range_del_agg) {
   DBIter* db_iter =
       new DBIter(env, ioptions, user_key_comparator, internal_iter, sequence,
-                 false, version_number, /*iterate_upper_bound,*/ pin_data);
+                 false, version_number, iterate_upper_bound,
+                 iterate_lower_bound, pin_data, range_del_agg);
   return db_iter;
 }
 
@@ -631,9 +831,15 @@ inline bool ArenaWrappedDBIter::Valid() const { return db_iter_->Valid(); }
 inline void ArenaWrappedDBIter::SeekToFirst() { db_iter_->SeekToFirst(); }
 inline void ArenaWrappedDBIter::SeekToLast() { db_iter_->SeekToLast(); }
 inline void ArenaWrappedDBIter::Seek(const Slice& target) {
+  PerfSampler sampler(sampled_stats_, perf_sample_rate_,
+                      InternalStats::kSampledIterSeek);  // Shichao
   db_iter_->Seek(target);
 }
-inline void ArenaWrappedDBIter::Next() { db_iter_->Next(); }
+inline void ArenaWrappedDBIter::Next() {
+  PerfSampler sampler(sampled_stats_, perf_sample_rate_,
+                      InternalStats::kSampledIterNext);  // Shichao
+  db_iter_->Next();
+}
 inline void ArenaWrappedDBIter::Prev() { db_iter_->Prev(); }
 inline Slice ArenaWrappedDBIter::key() const { return db_iter_->key(); }
 inline Slice ArenaWrappedDBIter::value() const { return db_iter_->value(); }
@@ -650,13 +856,21 @@ void ArenaWrappedDBIter::RegisterCleanup(CleanupFunction function, void* arg1,
 ArenaWrappedDBIter* NewArenaWrappedDbIterator(
     Env* env, const ImmutableCFOptions& ioptions,
     const Comparator* user_key_comparator, const SequenceNumber& sequence,
-    uint64_t version_number, bool pin_data) {
+    uint64_t version_number, const Slice* iterate_upper_bound,
+    const Slice* iterate_lower_bound, bool pin_data) {
   ArenaWrappedDBIter* iter = new ArenaWrappedDBIter();
   Arena* arena = iter->GetArena();
+  /***************************** Shichao ******************************/
+  // the tombstones newer than the iterator's sequence are not visible
+  iter->range_del_agg_.reset(
+      new RangeDelAggregator(user_key_comparator, sequence));
+  /***************************** Shichao ******************************/
   auto mem = arena->AllocateAligned(sizeof(DBIter));
   DBIter* db_iter =
       new (mem) DBIter(env, ioptions, user_key_comparator, nullptr, sequence,
-                       true, version_number, pin_data);
+                       true, version_number, iterate_upper_bound,
+                       iterate_lower_bound, pin_data,
+                       iter->range_del_agg_.get());
 
   iter->SetDBIter(db_iter);
 
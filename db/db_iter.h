@@ -9,10 +9,12 @@
 
 #pragma once
 #include <stdint.h>
+#include <memory>
 #include <string>
 #include "vidardb/db.h"
 #include "vidardb/iterator.h"
 #include "db/dbformat.h"
+#include "db/range_del_aggregator.h"  // Shichao
 #include "util/arena.h"
 
 namespace vidardb {
@@ -20,15 +22,23 @@ namespace vidardb {
 class Arena;
 class DBIter;
 class InternalIterator;
+class InternalStats;  // Shichao
 
 // Return a new iterator that converts internal keys (yielded by
 // "*internal_iter") that were live at the specified "sequence" number
-// into appropriate user keys.
+// into appropriate user keys. The iterator stops before the user key
+// "*iterate_upper_bound" and after "*iterate_lower_bound", if not nullptr.
+// The entries covered by the range tombstones of "*range_del_agg" are
+// skipped, if not nullptr.
 extern Iterator* NewDBIterator(Env* env, const ImmutableCFOptions& options,
                                const Comparator* user_key_comparator,
                                InternalIterator* internal_iter,
                                const SequenceNumber& sequence,
-                               uint64_t version_number, bool pin_data = false);
+                               uint64_t version_number,
+                               const Slice* iterate_upper_bound = nullptr,
+                               const Slice* iterate_lower_bound = nullptr,
+                               bool pin_data = false,
+                               RangeDelAggregator* range_del_agg = nullptr);
 
 // A wrapper iterator which wraps DB Iterator and the arena, with which the DB
 // iterator is supposed be allocated. This class is used as an entry point of
@@ -37,6 +47,10 @@ extern Iterator* NewDBIterator(Env* env, const ImmutableCFOptions& options,
 // to allocate.
 class ArenaWrappedDBIter : public Iterator {
  public:
+  /***************************** Shichao ******************************/
+  ArenaWrappedDBIter()
+      : db_iter_(nullptr), sampled_stats_(nullptr), perf_sample_rate_(0) {}
+  /***************************** Shichao ******************************/
   virtual ~ArenaWrappedDBIter();
 
   // Get the arena to be used to allocate memory for DBIter to be wrapped,
@@ -50,6 +64,20 @@ class ArenaWrappedDBIter : public Iterator {
   // Set the internal iterator wrapped inside the DB Iterator. Usually it is
   // a merging iterator.
   virtual void SetIterUnderDBIter(InternalIterator* iter);
+
+  /***************************** Shichao ******************************/
+  // The aggregator the range tombstones of the memtables and tables under
+  // the DB Iterator are to be added to.
+  RangeDelAggregator* GetRangeDelAggregator() { return range_del_agg_.get(); }
+  /***************************** Shichao ******************************/
+
+  /***************************** Shichao ******************************/
+  // Profile 1 in sample_rate Seek() and Next() into stats.
+  void SetPerfSampling(InternalStats* stats, uint32_t sample_rate) {
+    sampled_stats_ = stats;
+    perf_sample_rate_ = sample_rate;
+  }
+  /***************************** Shichao ******************************/
   virtual bool Valid() const override;
   virtual void SeekToFirst() override;
   virtual void SeekToLast() override;
@@ -66,12 +94,22 @@ class ArenaWrappedDBIter : public Iterator {
  private:
   DBIter* db_iter_;
   Arena arena_;
+  InternalStats* sampled_stats_;  // Shichao
+  uint32_t perf_sample_rate_;     // Shichao
+  std::unique_ptr<RangeDelAggregator> range_del_agg_;  // Shichao
+
+  friend ArenaWrappedDBIter* NewArenaWrappedDbIterator(
+      Env* env, const ImmutableCFOptions& options,
+      const Comparator* user_key_comparator, const SequenceNumber& sequence,
+      uint64_t version_number, const Slice* iterate_upper_bound,
+      const Slice* iterate_lower_bound, bool pin_data);
 };
 
 // Generate the arena wrapped iterator class.
 extern ArenaWrappedDBIter* NewArenaWrappedDbIterator(
     Env* env, const ImmutableCFOptions& options,
     const Comparator* user_key_comparator, const SequenceNumber& sequence,
-    uint64_t version_number, bool pin_data = false);
+    uint64_t version_number, const Slice* iterate_upper_bound = nullptr,
+    const Slice* iterate_lower_bound = nullptr, bool pin_data = false);
 
 }  // namespace vidardb
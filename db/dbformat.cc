@@ -14,6 +14,7 @@
 
 #include <inttypes.h>
 #include <stdio.h>
+#include "db/range_del_aggregator.h"  // Shichao
 #include "port/port.h"
 #include "util/coding.h"
 #include "util/perf_context_imp.h"
@@ -172,7 +173,9 @@ const Slice ReformatUserValue(const Slice& user_value,
 
   std::vector<Slice> result;
   result.reserve(columns.size());
+  PERF_TIMER_GUARD(splitter_split_time);
   std::vector<Slice> user_vals(splitter->Split(user_value));
+  PERF_TIMER_STOP(splitter_split_time);
   for (auto index : columns) {  // from 0 to MAX_COLUMN_INDEX
     assert(index <= user_vals.size());
     if (index > 0) {  // only process the value columns
@@ -180,7 +183,15 @@ const Slice ReformatUserValue(const Slice& user_value,
     }
   }
 
+  PERF_TIMER_GUARD(splitter_stitch_time);
   return splitter->Stitch(result, buf);
 }
 
+/***************************** Shichao ******************************/
+RangeQueryMeta::~RangeQueryMeta() {
+  delete map_res;
+  delete range_del_agg;
+}
+/***************************** Shichao ******************************/
+
 }  // namespace vidardb
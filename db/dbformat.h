@@ -20,6 +20,7 @@
 
 #include "util/coding.h"
 #include "util/logging.h"
+#include "util/perf_context_imp.h"
 #include "vidardb/comparator.h"
 #include "vidardb/db.h"
 #include "vidardb/slice.h"
@@ -32,6 +33,8 @@ namespace vidardb {
 class InternalKey;
 struct SuperVersion;
 class ColumnFamilyData;
+class RangeDelAggregator;  // Shichao
+class PinnedIteratorsManager;  // Shichao
 
 // Value types encoded as the last component of internal keys.
 // DO NOT CHANGE THESE ENUM VALUES: they are embedded in the on-disk
@@ -41,15 +44,21 @@ class ColumnFamilyData;
 enum ValueType : unsigned char {
   kTypeDeletion = 0x0,
   kTypeValue = 0x1,
+  kTypeMerge = 0x2,
   kTypeLogData = 0x3,               // WAL only.
   kTypeColumnFamilyDeletion = 0x4,  // WAL only.
   kTypeColumnFamilyValue = 0x5,     // WAL only.
+  kTypeColumnFamilyMerge = 0x6,     // WAL only.
   kTypeSingleDeletion = 0x7,
   kTypeBeginPrepareXID = 0x9,             // WAL only.
   kTypeEndPrepareXID = 0xA,               // WAL only.
   kTypeCommitXID = 0xB,                   // WAL only.
   kTypeRollbackXID = 0xC,                 // WAL only.
   kTypeNoop = 0xD,                        // WAL only.
+  /***************************** Shichao ******************************/
+  kTypeColumnFamilyRangeDeletion = 0xE,   // WAL only.
+  kTypeRangeDeletion = 0xF,               // meta block
+  /***************************** Shichao ******************************/
   kMaxValue = 0x7F                        // Not used for storing records.
 };
 
@@ -64,7 +73,8 @@ static const ValueType kValueTypeForSeek = kTypeSingleDeletion;
 // Checks whether a type is a value type (i.e. a type used in memtables and sst
 // files).
 inline bool IsValueType(ValueType t) {
-  return t < kTypeLogData || t == kTypeSingleDeletion;
+  return t < kTypeLogData || t == kTypeSingleDeletion ||
+         t == kTypeRangeDeletion;  // Shichao
 }
 
 // We leave eight bits empty at the bottom so a type and sequence#
@@ -382,17 +392,28 @@ struct RangeQueryMeta {
   std::map<std::string, SeqTypeVal, MapKeyComparator>* map_res; // Temp map
   std::unordered_map<SequenceNumber,
       std::list<RangeQueryKeyVal>::iterator> del_keys;  // store delete keys
+  uint64_t trimmed_rows;  // rows trimmed by the batch capacity in a batch
+  // the range tombstones met by the query, owned
+  RangeDelAggregator* range_del_agg;  // Shichao
+  /***************************** Shichao ******************************/
+  // With ReadOptions::pin_data, the table iterators of the current call are
+  // pinned in pinned_iters_mgr, which is released with the last result
+  // holding pins.
+  PinnedIteratorsManager* pinned_iters_mgr;
+  std::shared_ptr<Cleanable> pins;
+  /***************************** Shichao ******************************/
 
   RangeQueryMeta(ColumnFamilyData* cfd, SuperVersion* sv, SequenceNumber snap,
                  LookupKey* limit_key = nullptr, SequenceNumber limit_seq = 0,
                  const Comparator* comparator = nullptr):
     column_family_data(cfd), super_version(sv), snapshot(snap),
-    current_limit_key(limit_key), limit_sequence(limit_seq) {
+    current_limit_key(limit_key), limit_sequence(limit_seq), trimmed_rows(0),
+    range_del_agg(nullptr), pinned_iters_mgr(nullptr) {
     map_res = new std::map<std::string, SeqTypeVal, MapKeyComparator>(
         MapKeyComparator(comparator));
   }
 
-  ~RangeQueryMeta() { delete map_res; }
+  ~RangeQueryMeta();
 };
 
 // Ensure the result size is no more than the expected capacity which
@@ -411,7 +432,7 @@ inline std::vector<SequenceNumber> CompressResultList(
   // not include the next start kv size
   auto next = --(meta->map_res->end());
   size_t next_total_size =
-      next->second.iter_->user_key.size() + next->second.iter_->user_val.size();
+      next->second.iter_->user_key.size() + next->second.iter_->value().size();
   size_t result_total_size =
       read_options.result_key_size + read_options.result_val_size;
   assert(result_total_size >= next_total_size);
@@ -419,11 +440,12 @@ inline std::vector<SequenceNumber> CompressResultList(
     return {};
   }
 
+  PERF_TIMER_GUARD(range_query_trim_time);
   std::vector<SequenceNumber> deleted_sequence_numbers;
   for (; result_total_size - next_total_size > read_options.batch_capacity;) {
     auto it = --(meta->map_res->end());  // get the next start kv
     size_t delta_key_size = it->second.iter_->user_key.size();
-    size_t delta_val_size = it->second.iter_->user_val.size();
+    size_t delta_val_size = it->second.iter_->value().size();
     res->erase(it->second.iter_);  // remove from list
     assert(read_options.result_key_size >= delta_key_size);
     assert(read_options.result_val_size >= delta_val_size);
@@ -435,10 +457,11 @@ inline std::vector<SequenceNumber> CompressResultList(
     }
     deleted_sequence_numbers.emplace_back(it->second.seq_);
     meta->map_res->erase(it);  // remove from map
+    meta->trimmed_rows++;
 
     next = --(meta->map_res->end());  // get the next start kv
     next_total_size = next->second.iter_->user_key.size() +
-                      next->second.iter_->user_val.size();
+                      next->second.iter_->value().size();
     result_total_size =
         read_options.result_key_size + read_options.result_val_size;
     assert(result_total_size >= next_total_size);
@@ -228,8 +228,15 @@ std::string IdentityFileName(const std::string& dbname) {
   return dbname + "/IDENTITY";
 }
 
+/***************************** Shichao ******************************/
+std::string TableOpenStateFileName(const std::string& dbname) {
+  return dbname + "/TABLE_OPEN_STATE";
+}
+/***************************** Shichao ******************************/
+
 // Owned filenames have the form:
 //    dbname/IDENTITY
+//    dbname/TABLE_OPEN_STATE
 //    dbname/CURRENT
 //    dbname/LOCK
 //    dbname/<info_log_name_prefix>
@@ -257,6 +264,9 @@ bool ParseFileName(const std::string& fname, uint64_t* number,
   if (rest == "IDENTITY") {
     *number = 0;
     *type = kIdentityFile;
+  } else if (rest == "TABLE_OPEN_STATE") {  // Shichao
+    *number = 0;
+    *type = kTableOpenStateFile;
   } else if (rest == "CURRENT") {
     *number = 0;
     *type = kCurrentFile;
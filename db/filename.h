@@ -43,7 +43,8 @@ enum FileType {
   kInfoLogFile,  // Either the current one, or an old one
   kMetaDatabase,
   kIdentityFile,
-  kOptionsFile
+  kOptionsFile,
+  kTableOpenStateFile  // Shichao
 };
 
 // Return the name of the log file with the specified number
@@ -146,6 +147,12 @@ extern std::string MetaDatabaseName(const std::string& dbname,
 // either from a backup-image or empty
 extern std::string IdentityFileName(const std::string& dbname);
 
+/***************************** Shichao ******************************/
+// Return the name of the file persisting the footers and meta blocks of the
+// table files, see DBOptions::persist_table_open_state
+extern std::string TableOpenStateFileName(const std::string& dbname);
+/***************************** Shichao ******************************/
+
 // If filename is a vidardb file, store the type of the file in *type.
 // The number encoded in the filename is stored in *number.  If the
 // filename was successfully parsed, returns true.  Else return false.
@@ -88,7 +88,8 @@ FlushJob::FlushJob(const std::string& dbname, ColumnFamilyData* cfd,
       output_compression_(output_compression),
       stats_(stats),
       event_logger_(event_logger),
-      measure_io_stats_(measure_io_stats) {
+      measure_io_stats_(measure_io_stats),
+      start_cpu_nanos_(0) {  // Shichao
   // Update the thread status to indicate flush.
   ReportStartedFlush();
   TEST_SYNC_POINT("FlushJob::FlushJob()");
@@ -106,6 +107,7 @@ void FlushJob::ReportStartedFlush() {
       ThreadStatus::COMPACTION_JOB_ID,
       job_context_->job_id);
   IOSTATS_RESET(bytes_written);
+  start_cpu_nanos_ = db_options_.env->NowCPUNanos();  // Shichao
 }
 
 void FlushJob::ReportFlushInputSize(const std::vector<MemTable*>& mems) {
@@ -123,6 +125,9 @@ void FlushJob::RecordFlushIOStats() {
   ThreadStatusUtil::IncreaseThreadOperationProperty(
       ThreadStatus::FLUSH_BYTES_WRITTEN, IOSTATS(bytes_written));
   IOSTATS_RESET(bytes_written);
+  ThreadStatusUtil::SetThreadOperationProperty(  // Shichao
+      ThreadStatus::FLUSH_CPU_MICROS,
+      (db_options_.env->NowCPUNanos() - start_cpu_nanos_) / 1000);
 }
 
 Status FlushJob::Run(FileMetaData* file_meta) {
@@ -241,11 +246,16 @@ Status FlushJob::WriteLevel0Table(const std::vector<MemTable*>& mems,
     Arena arena;
     uint64_t total_num_entries = 0, total_num_deletes = 0;
     size_t total_memory_usage = 0;
+    // the tombstones cover the entries of the same snapshot stripe only
+    RangeDelAggregator range_del_agg(cfd_->user_comparator(),
+                                     kMaxSequenceNumber,
+                                     existing_snapshots_);  // Shichao
     for (MemTable* m : mems) {
       Log(InfoLogLevel::INFO_LEVEL, db_options_.info_log,
           "[%s] [JOB %d] Flushing memtable with next log file: %" PRIu64 "\n",
           cfd_->GetName().c_str(), job_context_->job_id, m->GetNextLogNumber());
       memtables.push_back(m->NewIterator(ro, &arena));
+      range_del_agg.AddTombstones(m->GetRangeTombstoneList());  // Shichao
       total_num_entries += m->num_entries();
       total_num_deletes += m->num_deletes();
       total_memory_usage += m->ApproximateMemoryUsage();
@@ -277,7 +287,8 @@ Status FlushJob::WriteLevel0Table(const std::vector<MemTable*>& mems,
           cfd_->ioptions()->compression_opts,
           mutable_cf_options_.paranoid_file_checks, cfd_->internal_stats(),
           TableFileCreationReason::kFlush, event_logger_, job_context_->job_id,
-          Env::IO_HIGH, &table_properties_, 0 /* level */);
+          Env::IO_HIGH, &table_properties_, 0 /* level */,
+          &range_del_agg);  // Shichao
       LogFlush(db_options_.info_log);
     }
     Log(InfoLogLevel::INFO_LEVEL, db_options_.info_log,
@@ -93,6 +93,7 @@ class FlushJob {
   EventLogger* event_logger_;
   TableProperties table_properties_;
   bool measure_io_stats_;
+  uint64_t start_cpu_nanos_;  // Shichao
 };
 
 }  // namespace vidardb
@@ -32,9 +32,11 @@ class LevelIterator : public InternalIterator {
  public:
   LevelIterator(const ColumnFamilyData* const cfd,
       const ReadOptions& read_options,
-      const std::vector<FileMetaData*>& files)
+      const std::vector<FileMetaData*>& files,
+      RangeDelAggregator* range_del_agg)  // Shichao
     : cfd_(cfd), read_options_(read_options), files_(files), valid_(false),
-      file_index_(std::numeric_limits<uint32_t>::max()) {}
+      file_index_(std::numeric_limits<uint32_t>::max()),
+      range_del_agg_(range_del_agg) {}  // Shichao
 
   void SetFileIndex(uint32_t file_index) {
     assert(file_index < files_.size());
@@ -49,7 +51,8 @@ class LevelIterator : public InternalIterator {
     file_iter_.reset(cfd_->table_cache()->NewIterator(
         read_options_, *(cfd_->soptions()), cfd_->internal_comparator(),
         files_[file_index_]->fd, nullptr /* table_reader_ptr */, nullptr,
-        false));
+        false, nullptr /* arena */, -1 /* level */, true /* os_cache */,
+        range_del_agg_));  // Shichao
   }
   void SeekToLast() override {
     status_ = Status::NotSupported("LevelIterator::SeekToLast()");
@@ -84,6 +87,16 @@ class LevelIterator : public InternalIterator {
         valid_ = false;
         return;
       }
+      /***************************** Shichao ******************************/
+      if (read_options_.iterate_upper_bound != nullptr &&
+          cfd_->internal_comparator().user_comparator()->Compare(
+              files_[file_index_ + 1]->smallest.user_key(),
+              *read_options_.iterate_upper_bound) >= 0) {
+        // don't open the next file, it is entirely beyond the bound
+        valid_ = false;
+        return;
+      }
+      /***************************** Shichao ******************************/
       SetFileIndex(file_index_ + 1);
       file_iter_->SeekToFirst();
     }
@@ -114,6 +127,7 @@ class LevelIterator : public InternalIterator {
   uint32_t file_index_;
   Status status_;
   std::unique_ptr<InternalIterator> file_iter_;
+  RangeDelAggregator* range_del_agg_;  // Shichao
 };
 
 ForwardIterator::ForwardIterator(DBImpl* db, const ReadOptions& read_options,
@@ -131,7 +145,8 @@ ForwardIterator::ForwardIterator(DBImpl* db, const ReadOptions& read_options,
       status_(Status::OK()),
       immutable_status_(Status::OK()),
       is_prev_set_(false),
-      is_prev_inclusive_(false) {
+      is_prev_inclusive_(false),
+      range_del_agg_(cfd->user_comparator(), kMaxSequenceNumber) {  // Shichao
   if (sv_) {
     RebuildIterators(false);
   }
@@ -318,7 +333,10 @@ void ForwardIterator::SeekInternal(const Slice& internal_key,
       }
 
       // Seek
-      if (f_idx < level_files.size()) {
+      if (f_idx < level_files.size() &&
+          sv_->current->FileOverlapsBounds(
+              read_options_, level_files[f_idx]->smallest.Encode(),
+              level_files[f_idx]->largest.Encode())) {  // Shichao
         level_iters_[level - 1]->SetFileIndex(f_idx);
         seek_to_first ? level_iters_[level - 1]->SeekToFirst() :
                         level_iters_[level - 1]->Seek(internal_key);
@@ -429,13 +447,27 @@ void ForwardIterator::RebuildIterators(bool refresh_sv) {
   }
   mutable_iter_ = sv_->mem->NewIterator(read_options_, &arena_);
   sv_->imm->AddIterators(read_options_, &imm_iters_, &arena_);
+  /***************************** Shichao ******************************/
+  range_del_agg_.Clear();
+  range_del_agg_.AddTombstones(sv_->mem->GetRangeTombstoneList());
+  sv_->imm->AddRangeTombstones(&range_del_agg_);
+  /***************************** Shichao ******************************/
 
   const auto* vstorage = sv_->current->storage_info();
   const auto& l0_files = vstorage->LevelFiles(0);
   l0_iters_.reserve(l0_files.size());
   for (const auto* l0 : l0_files) {
+    /***************************** Shichao ******************************/
+    if (!sv_->current->FileOverlapsBounds(read_options_, l0->smallest.Encode(),
+                                          l0->largest.Encode())) {
+      l0_iters_.push_back(nullptr);
+      continue;
+    }
+    /***************************** Shichao ******************************/
     l0_iters_.push_back(cfd_->table_cache()->NewIterator(
-        read_options_, *cfd_->soptions(), cfd_->internal_comparator(), l0->fd));
+        read_options_, *cfd_->soptions(), cfd_->internal_comparator(), l0->fd,
+        nullptr, nullptr, false, nullptr, -1, true,
+        &range_del_agg_));  // Shichao
   }
   BuildLevelIterators(vstorage);
   current_ = nullptr;
@@ -457,6 +489,12 @@ void ForwardIterator::RenewIterators() {
 
   mutable_iter_ = svnew->mem->NewIterator(read_options_, &arena_);
   svnew->imm->AddIterators(read_options_, &imm_iters_, &arena_);
+  /***************************** Shichao ******************************/
+  // the tombstones of the files no longer in the new version are dropped
+  range_del_agg_.Clear();
+  range_del_agg_.AddTombstones(svnew->mem->GetRangeTombstoneList());
+  svnew->imm->AddRangeTombstones(&range_del_agg_);
+  /***************************** Shichao ******************************/
 
   const auto* vstorage = sv_->current->storage_info();
   const auto& l0_files = vstorage->LevelFiles(0);
@@ -482,13 +520,33 @@ void ForwardIterator::RenewIterators() {
       } else {
         l0_iters_new.push_back(l0_iters_[iold]);
         l0_iters_[iold] = nullptr;
+        /***************************** Shichao ******************************/
+        std::shared_ptr<const FragmentedRangeTombstoneList> range_del_list;
+        if (cfd_->table_cache()
+                ->GetRangeTombstoneList(*cfd_->soptions(),
+                                        cfd_->internal_comparator(),
+                                        l0_files_new[inew]->fd,
+                                        &range_del_list)
+                .ok()) {
+          range_del_agg_.AddTombstones(range_del_list);
+        }
+        /***************************** Shichao ******************************/
         TEST_SYNC_POINT_CALLBACK("ForwardIterator::RenewIterators:Copy", this);
       }
       continue;
     }
+    /***************************** Shichao ******************************/
+    const auto* l0 = l0_files_new[inew];
+    if (!svnew->current->FileOverlapsBounds(
+            read_options_, l0->smallest.Encode(), l0->largest.Encode())) {
+      l0_iters_new.push_back(nullptr);
+      continue;
+    }
+    /***************************** Shichao ******************************/
     l0_iters_new.push_back(cfd_->table_cache()->NewIterator(
         read_options_, *cfd_->soptions(), cfd_->internal_comparator(),
-        l0_files_new[inew]->fd));
+        l0_files_new[inew]->fd, nullptr, nullptr, false, nullptr, -1, true,
+        &range_del_agg_));  // Shichao
   }
 
   for (auto* f : l0_iters_) {
@@ -515,8 +573,8 @@ void ForwardIterator::BuildLevelIterators(const VersionStorageInfo* vstorage) {
     if (level_files.empty()) {
       level_iters_.push_back(nullptr);
     } else {
-      level_iters_.push_back(
-          new LevelIterator(cfd_, read_options_, level_files));
+      level_iters_.push_back(new LevelIterator(
+          cfd_, read_options_, level_files, &range_del_agg_));  // Shichao
     }
   }
 }
@@ -531,7 +589,8 @@ void ForwardIterator::ResetIncompleteIterators() {
     delete l0_iters_[i];
     l0_iters_[i] = cfd_->table_cache()->NewIterator(
         read_options_, *cfd_->soptions(), cfd_->internal_comparator(),
-        l0_files[i]->fd);
+        l0_files[i]->fd, nullptr, nullptr, false, nullptr, -1, true,
+        &range_del_agg_);  // Shichao
   }
 
   for (auto* level_iter : level_iters_) {
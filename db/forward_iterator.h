@@ -14,6 +14,7 @@
 #include "vidardb/iterator.h"
 #include "vidardb/options.h"
 #include "db/dbformat.h"
+#include "db/range_del_aggregator.h"  // Shichao
 #include "table/internal_iterator.h"
 #include "util/arena.h"
 
@@ -75,6 +76,12 @@ class ForwardIterator : public InternalIterator {
 
   bool TEST_CheckDeletedIters(int* deleted_iters, int* num_iters);
 
+  /***************************** Shichao ******************************/
+  // The range tombstones of the memtables and files the iterator reads,
+  // renewed along with the iterators.
+  RangeDelAggregator* GetRangeDelAggregator() { return &range_del_agg_; }
+  /***************************** Shichao ******************************/
+
  private:
   void Cleanup(bool release_sv);
   void SVCleanup();
@@ -118,6 +125,7 @@ class ForwardIterator : public InternalIterator {
   bool is_prev_set_;
   bool is_prev_inclusive_;
 
+  RangeDelAggregator range_del_agg_;  // Shichao
   Arena arena_;
 };
 
@@ -147,6 +147,8 @@ static const std::string aggregated_table_properties_at_level =
     aggregated_table_properties + "-at-level";
 static const std::string num_running_compactions = "num-running-compactions";
 static const std::string num_running_flushes = "num-running-flushes";
+static const std::string range_query_stats = "range-query-stats";
+static const std::string sampled_perf_stats = "sampled-perf-stats";
 
 const std::string DB::Properties::kNumFilesAtLevelPrefix =
                       vidardb_prefix + num_files_at_level_prefix;
@@ -210,6 +212,10 @@ const std::string DB::Properties::kAggregatedTableProperties =
     vidardb_prefix + aggregated_table_properties;
 const std::string DB::Properties::kAggregatedTablePropertiesAtLevel =
     vidardb_prefix + aggregated_table_properties_at_level;
+const std::string DB::Properties::kRangeQueryStats =
+    vidardb_prefix + range_query_stats;
+const std::string DB::Properties::kSampledPerfStats =
+    vidardb_prefix + sampled_perf_stats;
 
 const std::unordered_map<std::string,
                          DBPropertyInfo> InternalStats::ppt_name_to_info = {
@@ -222,6 +228,10 @@ const std::unordered_map<std::string,
     {DB::Properties::kStats, {false, &InternalStats::HandleStats, nullptr}},
     {DB::Properties::kCFStats, {false, &InternalStats::HandleCFStats, nullptr}},
     {DB::Properties::kDBStats, {false, &InternalStats::HandleDBStats, nullptr}},
+    {DB::Properties::kRangeQueryStats,
+     {false, &InternalStats::HandleRangeQueryStats, nullptr}},
+    {DB::Properties::kSampledPerfStats,
+     {false, &InternalStats::HandleSampledPerfStats, nullptr}},
     {DB::Properties::kSSTables,
      {false, &InternalStats::HandleSsTables, nullptr}},
     {DB::Properties::kAggregatedTableProperties,
@@ -380,6 +390,16 @@ bool InternalStats::HandleDBStats(std::string* value, Slice suffix) {
   return true;
 }
 
+bool InternalStats::HandleRangeQueryStats(std::string* value, Slice suffix) {
+  DumpRangeQueryStats(value);
+  return true;
+}
+
+bool InternalStats::HandleSampledPerfStats(std::string* value, Slice suffix) {
+  DumpSampledPerfStats(value);
+  return true;
+}
+
 bool InternalStats::HandleSsTables(std::string* value, Slice suffix) {
   auto* current = cfd_->current();
   *value = current->DebugString();
@@ -611,6 +631,12 @@ void InternalStats::DumpDBStats(std::string* value) {
   uint64_t write_with_wal = GetDBStats(InternalStats::kIntStatsWriteWithWal);
   uint64_t write_stall_micros =
       GetDBStats(InternalStats::kIntStatsWriteStallMicros);
+  uint64_t range_query_batches =
+      GetDBStats(InternalStats::kIntStatsRangeQueryBatches);
+  uint64_t range_query_keys_read =
+      GetDBStats(InternalStats::kIntStatsRangeQueryKeysRead);
+  uint64_t range_query_bytes_read =
+      GetDBStats(InternalStats::kIntStatsRangeQueryBytesRead);
 
   const int kHumanMicrosLen = 32;
   char human_micros[kHumanMicrosLen];
@@ -650,6 +676,15 @@ void InternalStats::DumpDBStats(std::string* value) {
            // 10000 = divide by 1M to get secs, then multiply by 100 for pct
            write_stall_micros / 10000.0 / std::max(seconds_up, 0.001));
   value->append(buf);
+  // Range query
+  snprintf(buf, sizeof(buf),
+           "Cumulative range queries: %s batches, %s keys, "
+           "read: %.2f GB, %.2f MB/s\n",
+           NumberToHumanString(range_query_batches).c_str(),
+           NumberToHumanString(range_query_keys_read).c_str(),
+           range_query_bytes_read / kGB,
+           range_query_bytes_read / kMB / seconds_up);
+  value->append(buf);
 
   // Interval
   uint64_t interval_write_other = write_other - db_stats_snapshot_.write_other;
@@ -698,6 +733,21 @@ void InternalStats::DumpDBStats(std::string* value) {
                10000.0 / std::max(interval_seconds_up, 0.001));
   value->append(buf);
 
+  // Range query
+  uint64_t interval_range_query_bytes_read =
+      range_query_bytes_read - db_stats_snapshot_.range_query_bytes_read;
+  snprintf(buf, sizeof(buf),
+           "Interval range queries: %s batches, %s keys, "
+           "read: %.2f MB, %.2f MB/s\n",
+           NumberToHumanString(range_query_batches -
+                               db_stats_snapshot_.range_query_batches).c_str(),
+           NumberToHumanString(range_query_keys_read -
+                               db_stats_snapshot_.range_query_keys_read).c_str(),
+           interval_range_query_bytes_read / kMB,
+           interval_range_query_bytes_read / kMB /
+               std::max(interval_seconds_up, 0.001));
+  value->append(buf);
+
   for (int level = 0; level < number_levels_; level++) {
     if (!file_read_latency_[level].Empty()) {
       char buf2[5000];
@@ -717,6 +767,63 @@ void InternalStats::DumpDBStats(std::string* value) {
   db_stats_snapshot_.wal_synced = wal_synced;
   db_stats_snapshot_.write_with_wal = write_with_wal;
   db_stats_snapshot_.write_stall_micros = write_stall_micros;
+  db_stats_snapshot_.range_query_batches = range_query_batches;
+  db_stats_snapshot_.range_query_keys_read = range_query_keys_read;
+  db_stats_snapshot_.range_query_bytes_read = range_query_bytes_read;
+}
+
+void InternalStats::DumpSampledPerfStats(std::string* value) {
+  static const char* kOpNames[kSampledOpMax] = {"Get", "RangeQuery", "Write",
+                                                "IterSeek", "IterNext"};
+  static const char* kPerfNames[kSampledPerfMax] = {
+      "total", "memtable", "tablefiles", "blockread", "fileio", "wal",
+      "mutex"};
+
+  char buf[1000];
+  // DB-level stats, only available from default column family
+  value->append("\n** Sampled Perf Stats (nanos) **\n");
+  for (int op = 0; op < kSampledOpMax; op++) {
+    const HistogramImpl* hists = sampled_perf_[op];
+    if (hists[kSampledTotal].Empty()) {
+      continue;
+    }
+    snprintf(buf, sizeof(buf), "%s: %" PRIu64 " samples\n", kOpNames[op],
+             hists[kSampledTotal].num());
+    value->append(buf);
+    for (int i = 0; i < kSampledPerfMax; i++) {
+      snprintf(buf, sizeof(buf),
+               "  %-10s avg %12.1f  P50 %12.1f  P99 %12.1f  max %12" PRIu64
+               "\n",
+               kPerfNames[i], hists[i].Average(), hists[i].Median(),
+               hists[i].Percentile(99), hists[i].max());
+      value->append(buf);
+    }
+  }
+}
+
+void InternalStats::DumpRangeQueryStats(std::string* value) {
+  char buf[1000];
+  // DB-level stats, only available from default column family
+  uint64_t batches = GetDBStats(InternalStats::kIntStatsRangeQueryBatches);
+  uint64_t keys_read = GetDBStats(InternalStats::kIntStatsRangeQueryKeysRead);
+  uint64_t bytes_read =
+      GetDBStats(InternalStats::kIntStatsRangeQueryBytesRead);
+  uint64_t rows_trimmed =
+      GetDBStats(InternalStats::kIntStatsRangeQueryRowsTrimmed);
+
+  // batches: number of DB::RangeQuery() calls
+  // rows trimmed: rows dropped to keep a batch within its batch_capacity,
+  //               which are queried again by the next batch
+  snprintf(buf, sizeof(buf),
+           "Range queries: %" PRIu64 " batches, %" PRIu64 " keys, "
+           "%.1f keys per batch, read: %.2f MB, %" PRIu64 " rows trimmed, "
+           "%.1f percent\n",
+           batches, keys_read,
+           keys_read / static_cast<double>(std::max<uint64_t>(batches, 1)),
+           bytes_read / kMB, rows_trimmed,
+           100.0 * rows_trimmed /
+               std::max<uint64_t>(keys_read + rows_trimmed, 1));
+  value->append(buf);
 }
 
 void InternalStats::DumpCFStats(std::string* value) {
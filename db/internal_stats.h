@@ -71,9 +71,36 @@ class InternalStats {
     kIntStatsWriteDoneBySelf,
     kIntStatsWriteWithWal,
     kIntStatsWriteStallMicros,
+    kIntStatsRangeQueryBatches,      // Shichao
+    kIntStatsRangeQueryKeysRead,     // Shichao
+    kIntStatsRangeQueryBytesRead,    // Shichao
+    kIntStatsRangeQueryRowsTrimmed,  // Shichao
     kIntStatsNumMax,
   };
 
+  // Operations profiled 1 in DBOptions::perf_sample_rate times
+  enum SampledOpType {
+    kSampledGet,
+    kSampledRangeQuery,
+    kSampledWrite,
+    kSampledIterSeek,
+    kSampledIterNext,
+    kSampledOpMax,
+  };
+
+  // Where the time of a sampled operation goes, in nanos. The parts may
+  // overlap, e.g. block reads are part of the time in table files.
+  enum SampledPerfType {
+    kSampledTotal,
+    kSampledMemtable,
+    kSampledTableFiles,
+    kSampledBlockRead,
+    kSampledFileIO,
+    kSampledWal,
+    kSampledMutex,
+    kSampledPerfMax,
+  };
+
   InternalStats(int num_levels, Env* env, ColumnFamilyData* cfd)
       : db_stats_{},
         cf_stats_value_{},
@@ -222,6 +249,13 @@ class InternalStats {
     return db_stats_[type].load(std::memory_order_relaxed);
   }
 
+  // Thread safe, sampled operations are recorded without the DB mutex.
+  void AddSampledPerf(SampledOpType op, const uint64_t* nanos) {
+    for (int i = 0; i < kSampledPerfMax; i++) {
+      sampled_perf_[op][i].Add(nanos[i]);
+    }
+  }
+
   HistogramImpl* GetFileReadHist(int level) {
     return &file_read_latency_[level];
   }
@@ -246,6 +280,8 @@ class InternalStats {
  private:
   void DumpDBStats(std::string* value);
   void DumpCFStats(std::string* value);
+  void DumpRangeQueryStats(std::string* value);
+  void DumpSampledPerfStats(std::string* value);
 
   // Per-DB stats
   std::atomic<uint64_t> db_stats_[kIntStatsNumMax];
@@ -255,6 +291,8 @@ class InternalStats {
   // Per-ColumnFamily/level compaction stats
   std::vector<CompactionStats> comp_stats_;
   std::vector<HistogramImpl> file_read_latency_;
+  // Per-DB sampled operation profiles, see DBOptions::perf_sample_rate
+  HistogramImpl sampled_perf_[kSampledOpMax][kSampledPerfMax];
 
   // Used to compute per-interval statistics
   struct CFStatsSnapshot {
@@ -295,6 +333,10 @@ class InternalStats {
     uint64_t num_keys_written;
     // Total time writes delayed by stalls.
     uint64_t write_stall_micros;
+    // Range query batches, and the keys and bytes they returned.
+    uint64_t range_query_batches;
+    uint64_t range_query_keys_read;
+    uint64_t range_query_bytes_read;
     double seconds_up;
 
     DBStatsSnapshot()
@@ -306,6 +348,9 @@ class InternalStats {
           write_self(0),
           num_keys_written(0),
           write_stall_micros(0),
+          range_query_batches(0),
+          range_query_keys_read(0),
+          range_query_bytes_read(0),
           seconds_up(0) {}
   } db_stats_snapshot_;
 
@@ -317,6 +362,8 @@ class InternalStats {
   bool HandleStats(std::string* value, Slice suffix);
   bool HandleCFStats(std::string* value, Slice suffix);
   bool HandleDBStats(std::string* value, Slice suffix);
+  bool HandleRangeQueryStats(std::string* value, Slice suffix);
+  bool HandleSampledPerfStats(std::string* value, Slice suffix);
   bool HandleSsTables(std::string* value, Slice suffix);
   bool HandleAggregatedTableProperties(std::string* value, Slice suffix);
   bool HandleAggregatedTablePropertiesAtLevel(std::string* value, Slice suffix);
@@ -400,9 +447,33 @@ class InternalStats {
     kIntStatsWriteDoneBySelf,
     kIntStatsWriteWithWal,
     kIntStatsWriteStallMicros,
+    kIntStatsRangeQueryBatches,      // Shichao
+    kIntStatsRangeQueryKeysRead,     // Shichao
+    kIntStatsRangeQueryBytesRead,    // Shichao
+    kIntStatsRangeQueryRowsTrimmed,  // Shichao
     kIntStatsNumMax,
   };
 
+  enum SampledOpType {
+    kSampledGet,
+    kSampledRangeQuery,
+    kSampledWrite,
+    kSampledIterSeek,
+    kSampledIterNext,
+    kSampledOpMax,
+  };
+
+  enum SampledPerfType {
+    kSampledTotal,
+    kSampledMemtable,
+    kSampledTableFiles,
+    kSampledBlockRead,
+    kSampledFileIO,
+    kSampledWal,
+    kSampledMutex,
+    kSampledPerfMax,
+  };
+
   InternalStats(int num_levels, Env* env, ColumnFamilyData* cfd) {}
 
   struct CompactionStats {
@@ -435,6 +506,8 @@ class InternalStats {
 
   void AddDBStats(InternalDBStatsType type, uint64_t value) {}
 
+  void AddSampledPerf(SampledOpType op, const uint64_t* nanos) {}
+
   HistogramImpl* GetFileReadHist(int level) { return nullptr; }
 
   uint64_t GetBackgroundErrorCount() const { return 0; }
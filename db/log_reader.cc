@@ -36,6 +36,7 @@ Reader::Reader(std::shared_ptr<Logger> info_log,
       last_record_offset_(0),
       end_of_buffer_offset_(0),
       initial_offset_(initial_offset),
+      resyncing_(initial_offset > 0),  // Shichao
       log_number_(log_num),
       recycled_(false) {}
 
@@ -93,6 +94,20 @@ bool Reader::ReadRecord(Slice* record, std::string* scratch,
     uint64_t physical_record_offset = end_of_buffer_offset_ - buffer_.size();
     size_t drop_size = 0;
     const unsigned int record_type = ReadPhysicalRecord(&fragment, &drop_size);
+    /***************************** Shichao ******************************/
+    if (resyncing_) {
+      if (record_type == kBadRecord || record_type == kMiddleType ||
+          record_type == kRecyclableMiddleType) {
+        continue;
+      } else if (record_type == kLastType ||
+                 record_type == kRecyclableLastType) {
+        resyncing_ = false;
+        continue;
+      } else {
+        resyncing_ = false;
+      }
+    }
+    /***************************** Shichao ******************************/
     switch (record_type) {
       case kFullType:
       case kRecyclableFullType:
@@ -110,6 +110,11 @@ class Reader {
   // Offset at which to start looking for the first record to return
   uint64_t const initial_offset_;
 
+  // Whether the fragments of a record starting before initial_offset_ are
+  // still being skipped, so a reader can be reopened past the last record
+  // it returned to tail a file.
+  bool resyncing_;  // Shichao
+
   // which log number this is
   uint64_t const log_number_;
 
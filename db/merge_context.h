@@ -0,0 +1,61 @@
+// Copyright (c) 2019-present, VidarDB, Inc.  All rights reserved.
+// This source code is licensed under the BSD-style license found in the
+// LICENSE file in the root directory of this source tree. An additional grant
+// of patent rights can be found in the PATENTS file in the same directory.
+//
+// Copyright (c) 2011-present, Facebook, Inc.  All rights reserved.
+// This source code is licensed under the BSD-style license found in the
+// LICENSE file in the root directory of this source tree. An additional grant
+// of patent rights can be found in the PATENTS file in the same directory.
+
+#pragma once
+
+#include <deque>
+#include <string>
+
+#include "vidardb/slice.h"
+
+namespace vidardb {
+
+// The merge context for merging a user key.
+// When doing a Get(), DB will create such a class and pass it when
+// issuing Get() operation to memtables and version_set. The operands
+// will be fetched from the context when issuing partial or full merge.
+class MergeContext {
+ public:
+  // Clear all the operands
+  void Clear() { operand_list_.clear(); }
+
+  // Replace all operands with merge_result, which are expected to be the
+  // merge result of them.
+  void PushPartialMergeResult(std::string& merge_result) {
+    operand_list_.clear();
+    operand_list_.push_front(std::move(merge_result));
+  }
+
+  // Push a merge operand. Operands are met from the newest to the oldest,
+  // so they are kept front() first, which is the order FullMerge expects.
+  void PushOperand(const Slice& operand_slice) {
+    operand_list_.push_front(operand_slice.ToString());
+  }
+
+  // Push back a merge operand, for the operands met from the oldest to the
+  // newest.
+  void PushOperandBack(const Slice& operand_slice) {
+    operand_list_.push_back(operand_slice.ToString());
+  }
+
+  // Return total number of operands in the list
+  size_t GetNumOperands() const { return operand_list_.size(); }
+
+  // Get the operand at the index.
+  Slice GetOperand(int index) const { return operand_list_[index]; }
+
+  // Return all the operands.
+  const std::deque<std::string>& GetOperands() const { return operand_list_; }
+
+ private:
+  std::deque<std::string> operand_list_;
+};
+
+}  // namespace vidardb
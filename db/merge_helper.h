@@ -0,0 +1,136 @@
+// Copyright (c) 2019-present, VidarDB, Inc.  All rights reserved.
+// This source code is licensed under the BSD-style license found in the
+// LICENSE file in the root directory of this source tree. An additional grant
+// of patent rights can be found in the PATENTS file in the same directory.
+//
+// Copyright (c) 2011-present, Facebook, Inc.  All rights reserved.
+// This source code is licensed under the BSD-style license found in the
+// LICENSE file in the root directory of this source tree. An additional grant
+// of patent rights can be found in the PATENTS file in the same directory.
+
+#pragma once
+
+#include <deque>
+#include <string>
+
+#include "db/dbformat.h"
+#include "vidardb/env.h"
+#include "vidardb/slice.h"
+
+namespace vidardb {
+
+class Comparator;
+class InternalIterator;
+class Logger;
+class MergeOperator;
+class RangeDelAggregator;  // Shichao
+class Statistics;
+
+class MergeHelper {
+ public:
+  MergeHelper(Env* env, const Comparator* user_comparator,
+              const MergeOperator* user_merge_operator, Logger* logger,
+              bool assert_valid_internal_key, Statistics* stats = nullptr)
+      : env_(env),
+        user_comparator_(user_comparator),
+        user_merge_operator_(user_merge_operator),
+        logger_(logger),
+        assert_valid_internal_key_(assert_valid_internal_key),
+        stats_(stats) {
+    assert(user_comparator_ != nullptr);
+  }
+
+  // Wrapper around MergeOperator::FullMerge() that records perf statistics.
+  // Result of merge will be written to result if status returned is OK.
+  // If operands is empty, the value will simply be copied to result.
+  // Returns one of the following statuses:
+  // - OK: Entries were successfully merged.
+  // - Corruption: Merge operator reported unsuccessful merge.
+  // - NotSupported: Merge operator is missing.
+  static Status TimedFullMerge(const Slice& key, const Slice* value,
+                               const std::deque<std::string>& operands,
+                               const MergeOperator* merge_operator,
+                               Statistics* statistics, Env* env,
+                               Logger* logger, std::string* result);
+
+  // Merge entries until we hit
+  //     - a corrupted key
+  //     - a Put/Delete,
+  //     - a different user key,
+  //     - a specific sequence number (snapshot boundary),
+  //  or - the end of iteration
+  // iter: (IN)  points to the first merge type entry
+  //       (OUT) points to the first entry not included in the merge process
+  // stop_before: (IN) a sequence number that merge should not cross.
+  //                   0 means no restriction
+  // at_bottom:   (IN) true if the iterator covers the bottem level, which means
+  //                   we could reach the start of the history of this user key.
+  //
+  // Returns one of the following statuses:
+  // - OK: Entries were successfully merged.
+  // - MergeInProgress: Put/Delete not encountered and unable to merge operands.
+  // - Corruption: Merge operator reported unsuccessful merge or a corrupted
+  //   key has been encountered and not expected (applies only when compiling
+  //   with asserts removed).
+  //
+  // REQUIRED: The first key in the input is not corrupted.
+  //
+  // The entries covered by the range tombstones of range_del_agg, if not
+  // nullptr, are merged like deletions.
+  Status MergeUntil(InternalIterator* iter, const SequenceNumber stop_before = 0,
+                    const bool at_bottom = false,
+                    const RangeDelAggregator* range_del_agg = nullptr);
+
+  // The result of the last MergeUntil call, valid until the next one.
+  //
+  // If the merge succeeded, keys() holds one internal key, with the latest
+  // sequence number of the merged entries, and values() the merged value. The
+  // key type may have changed:
+  //     Put/Delete + Merge + ... + Merge => Put
+  //     Merge + ... + Merge => Merge
+  //
+  // If it did not, because no Put/Delete was found and the operands could not
+  // be merged, keys() holds the internal keys of the merge operands seen, all
+  // of the same user key, and values() the operands, in parallel. Both are in
+  // reverse order of iteration: keys().back() is the first key seen.
+  const std::deque<std::string>& keys() const { return keys_; }
+  const std::deque<std::string>& values() const { return operands_; }
+  bool HasOperator() const { return user_merge_operator_ != nullptr; }
+
+ private:
+  Env* env_;
+  const Comparator* user_comparator_;
+  const MergeOperator* user_merge_operator_;
+  Logger* logger_;
+  bool assert_valid_internal_key_;  // enforce no internal key corruption?
+
+  // the scratch area that holds the result of MergeUntil
+  // valid up to the next MergeUntil call
+  std::deque<std::string> keys_;     // Keeps track of the sequence of keys seen
+  std::deque<std::string> operands_;  // Parallel with keys_; stores the values
+
+  Statistics* stats_;
+};
+
+// MergeOutputIterator can be used to iterate over the result of a merge.
+class MergeOutputIterator {
+ public:
+  // The MergeOutputIterator is bound to a MergeHelper instance.
+  explicit MergeOutputIterator(const MergeHelper* merge_helper);
+
+  // Seeks to the first record in the output.
+  void SeekToFirst();
+  // Advances to the next record in the output.
+  void Next();
+
+  Slice key() { return Slice(*it_keys_); }
+  Slice value() { return Slice(*it_values_); }
+  bool Valid() { return it_keys_ != merge_helper_->keys().rend(); }
+
+ private:
+  const MergeHelper* merge_helper_;
+  std::deque<std::string>::const_reverse_iterator it_keys_;
+  std::deque<std::string>::const_reverse_iterator it_values_;
+};
+
+}  // namespace vidardb
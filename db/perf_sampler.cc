@@ -0,0 +1,72 @@
+// Copyright (c) 2019-present, VidarDB, Inc.  All rights reserved.
+// This source code is licensed under the BSD-style license found in the
+// LICENSE file in the root directory of this source tree. An additional grant
+// of patent rights can be found in the PATENTS file in the same directory.
+
+#include "db/perf_sampler.h"
+
+#include "util/iostats_context_imp.h"
+#include "util/perf_context_imp.h"
+#include "util/random.h"
+#include "vidardb/env.h"
+
+namespace vidardb {
+
+PerfSampler::PerfSampler(InternalStats* stats, uint32_t sample_rate,
+                         InternalStats::SampledOpType op)
+    : stats_(stats), op_(op), sampled_(false), prev_level_(kDisable) {
+  if (sample_rate == 0 || stats_ == nullptr ||
+      !Random::GetTLSInstance()->OneIn(static_cast<int>(sample_rate))) {
+    return;
+  }
+  sampled_ = true;
+  prev_level_ = GetPerfLevel();
+  if (prev_level_ < kEnableTime) {
+    SetPerfLevel(kEnableTime);
+  }
+  Snapshot(start_);
+}
+
+PerfSampler::~PerfSampler() {
+  if (!sampled_) {
+    return;
+  }
+  uint64_t nanos[InternalStats::kSampledPerfMax];
+  Snapshot(nanos);
+  for (int i = 0; i < InternalStats::kSampledPerfMax; i++) {
+    // counters reset by the user in the middle of the operation
+    nanos[i] = nanos[i] >= start_[i] ? nanos[i] - start_[i] : 0;
+  }
+  stats_->AddSampledPerf(op_, nanos);
+  SetPerfLevel(prev_level_);
+}
+
+void PerfSampler::Snapshot(uint64_t* nanos) const {
+  nanos[InternalStats::kSampledTotal] = Env::Default()->NowNanos();
+#if !defined(NPERF_CONTEXT) && !defined(IOS_CROSS_COMPILE)
+  nanos[InternalStats::kSampledMemtable] =
+      perf_context.get_from_memtable_time +
+      perf_context.seek_on_memtable_time + perf_context.write_memtable_time +
+      perf_context.range_query_memtable_time +
+      perf_context.range_query_immutable_time;
+  nanos[InternalStats::kSampledTableFiles] =
+      perf_context.get_from_output_files_time +
+      perf_context.range_query_sst_time + perf_context.block_seek_nanos;
+  nanos[InternalStats::kSampledBlockRead] =
+      perf_context.block_read_time + perf_context.block_checksum_time +
+      perf_context.block_decompress_time;
+  nanos[InternalStats::kSampledFileIO] =
+      iostats_context.read_nanos + iostats_context.write_nanos +
+      iostats_context.fsync_nanos + iostats_context.range_sync_nanos;
+  nanos[InternalStats::kSampledWal] = perf_context.write_wal_time;
+  nanos[InternalStats::kSampledMutex] =
+      perf_context.db_mutex_lock_nanos + perf_context.db_condition_wait_nanos;
+#else
+  for (int i = InternalStats::kSampledMemtable;
+       i < InternalStats::kSampledPerfMax; i++) {
+    nanos[i] = 0;
+  }
+#endif
+}
+
+}  // namespace vidardb
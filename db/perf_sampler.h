@@ -0,0 +1,41 @@
+// Copyright (c) 2019-present, VidarDB, Inc.  All rights reserved.
+// This source code is licensed under the BSD-style license found in the
+// LICENSE file in the root directory of this source tree. An additional grant
+// of patent rights can be found in the PATENTS file in the same directory.
+
+#pragma once
+
+#include <stdint.h>
+
+#include "db/internal_stats.h"
+#include "vidardb/perf_level.h"
+
+namespace vidardb {
+
+// PerfSampler profiles 1 in sample_rate operations of the enclosing scope.
+// A sampled operation runs with perf level kEnableTime, the PerfContext and
+// IOStatsContext counters it adds are recorded into the per-op histograms of
+// InternalStats when the sampler goes out of scope. The user's own perf
+// context is not reset, only the deltas are taken. An operation that is not
+// sampled costs one thread local random number.
+class PerfSampler {
+ public:
+  PerfSampler(InternalStats* stats, uint32_t sample_rate,
+              InternalStats::SampledOpType op);
+  ~PerfSampler();
+
+  // No copying allowed
+  PerfSampler(const PerfSampler&) = delete;
+  PerfSampler& operator=(const PerfSampler&) = delete;
+
+ private:
+  void Snapshot(uint64_t* nanos) const;
+
+  InternalStats* stats_;
+  InternalStats::SampledOpType op_;
+  bool sampled_;
+  PerfLevel prev_level_;
+  uint64_t start_[InternalStats::kSampledPerfMax];
+};
+
+}  // namespace vidardb
@@ -0,0 +1,339 @@
+//  Copyright (c) 2020-present, VidarDB, Inc.  All rights reserved.
+//  This source code is licensed under the BSD-style license found in the
+//  LICENSE file in the root directory of this source tree. An additional grant
+//  of patent rights can be found in the PATENTS file in the same directory.
+
+#include "db/range_del_aggregator.h"
+
+#include <algorithm>
+#include <functional>
+#include <utility>
+
+#include "db/version_edit.h"
+#include "table/internal_iterator.h"
+#include "table/table_builder.h"
+
+namespace vidardb {
+
+FragmentedRangeTombstoneList::FragmentedRangeTombstoneList(
+    const std::vector<RangeTombstone>& tombstones, const Comparator* ucmp)
+    : ucmp_(ucmp), num_tombstones_(0) {
+  auto less = [ucmp](const Slice& a, const Slice& b) {
+    return ucmp->Compare(a, b) < 0;
+  };
+
+  std::vector<const RangeTombstone*> sorted;
+  std::vector<Slice> bounds;
+  for (const auto& t : tombstones) {
+    if (ucmp->Compare(t.start_key, t.end_key) >= 0) {
+      continue;  // empty range
+    }
+    sorted.push_back(&t);
+    bounds.push_back(t.start_key);
+    bounds.push_back(t.end_key);
+  }
+  num_tombstones_ = sorted.size();
+  if (sorted.empty()) {
+    return;
+  }
+  std::sort(bounds.begin(), bounds.end(), less);
+  bounds.erase(std::unique(bounds.begin(), bounds.end(),
+                           [ucmp](const Slice& a, const Slice& b) {
+                             return ucmp->Equal(a, b);
+                           }),
+               bounds.end());
+  std::sort(sorted.begin(), sorted.end(),
+            [&less](const RangeTombstone* a, const RangeTombstone* b) {
+              return less(a->start_key, b->start_key);
+            });
+
+  // Sweep the boundaries, the active tombstones between two of them cover
+  // the whole interval. The fragments refer to the boundaries by index
+  // until keys_ is built.
+  struct Interval {
+    size_t begin, end, seq_begin, seq_end;
+  };
+  std::vector<Interval> intervals;
+  std::vector<std::pair<Slice, SequenceNumber>> active;  // end key, seq
+  std::vector<SequenceNumber> covering;
+  size_t next = 0;
+  for (size_t i = 0; i + 1 < bounds.size(); i++) {
+    const Slice& bound = bounds[i];
+    active.erase(std::remove_if(active.begin(), active.end(),
+                                [&](const std::pair<Slice, SequenceNumber>& a) {
+                                  return ucmp->Compare(a.first, bound) <= 0;
+                                }),
+                 active.end());
+    while (next < sorted.size() &&
+           ucmp->Compare(sorted[next]->start_key, bound) <= 0) {
+      active.emplace_back(sorted[next]->end_key, sorted[next]->seq);
+      next++;
+    }
+    if (active.empty()) {
+      continue;
+    }
+
+    covering.clear();
+    for (const auto& a : active) {
+      covering.push_back(a.second);
+    }
+    std::sort(covering.begin(), covering.end(),
+              std::greater<SequenceNumber>());
+    covering.erase(std::unique(covering.begin(), covering.end()),
+                   covering.end());
+
+    if (!intervals.empty() && intervals.back().end == i &&
+        intervals.back().seq_end - intervals.back().seq_begin ==
+            covering.size() &&
+        std::equal(covering.begin(), covering.end(),
+                   seqs_.begin() + intervals.back().seq_begin)) {
+      intervals.back().end = i + 1;  // covered by the same tombstones
+      continue;
+    }
+    intervals.push_back({i, i + 1, seqs_.size(),
+                         seqs_.size() + covering.size()});
+    seqs_.insert(seqs_.end(), covering.begin(), covering.end());
+  }
+
+  // keys_ is not resized anymore, the fragments can point into it
+  keys_.reserve(bounds.size());
+  for (const auto& bound : bounds) {
+    keys_.emplace_back(bound.data(), bound.size());
+  }
+  fragments_.reserve(intervals.size());
+  for (const auto& interval : intervals) {
+    fragments_.push_back({keys_[interval.begin], keys_[interval.end],
+                          interval.seq_begin, interval.seq_end});
+  }
+}
+
+std::shared_ptr<const FragmentedRangeTombstoneList>
+FragmentedRangeTombstoneList::Create(InternalIterator* iter,
+                                     const Comparator* ucmp, Status* status) {
+  // the iterator may reuse its buffers, so the keys are copied
+  std::vector<std::string> keys;
+  std::vector<SequenceNumber> seqs;
+  for (iter->SeekToFirst(); iter->Valid(); iter->Next()) {
+    ParsedInternalKey ikey;
+    if (!ParseInternalKey(iter->key(), &ikey) ||
+        ikey.type != kTypeRangeDeletion) {
+      *status = Status::Corruption("bad range tombstone");
+      return nullptr;
+    }
+    keys.push_back(ikey.user_key.ToString());
+    keys.push_back(iter->value().ToString());
+    seqs.push_back(ikey.sequence);
+  }
+  *status = iter->status();
+  if (!status->ok()) {
+    return nullptr;
+  }
+
+  std::vector<RangeTombstone> tombstones;
+  tombstones.reserve(seqs.size());
+  for (size_t i = 0; i < seqs.size(); i++) {
+    tombstones.emplace_back(keys[2 * i], keys[2 * i + 1], seqs[i]);
+  }
+  return std::make_shared<const FragmentedRangeTombstoneList>(tombstones,
+                                                              ucmp);
+}
+
+const FragmentedRangeTombstoneList::Fragment*
+FragmentedRangeTombstoneList::FindFragment(const Slice& user_key) const {
+  auto it = std::upper_bound(
+      fragments_.begin(), fragments_.end(), user_key,
+      [this](const Slice& key, const Fragment& fragment) {
+        return ucmp_->Compare(key, fragment.start_key) < 0;
+      });
+  if (it == fragments_.begin()) {
+    return nullptr;
+  }
+  --it;
+  if (ucmp_->Compare(user_key, it->end_key) >= 0) {
+    return nullptr;
+  }
+  return &*it;
+}
+
+SequenceNumber FragmentedRangeTombstoneList::MaxCoveringTombstoneSeqnum(
+    const Slice& user_key, SequenceNumber upper_bound) const {
+  const Fragment* fragment = FindFragment(user_key);
+  if (fragment == nullptr) {
+    return 0;
+  }
+  // the sequence numbers are in descending order
+  auto begin = seqs_.begin() + fragment->seq_begin;
+  auto end = seqs_.begin() + fragment->seq_end;
+  auto it = std::lower_bound(begin, end, upper_bound,
+                             std::greater<SequenceNumber>());
+  return it == end ? 0 : *it;
+}
+
+SequenceNumber FragmentedRangeTombstoneList::MinCoveringTombstoneSeqnum(
+    const Slice& user_key, SequenceNumber seq) const {
+  const Fragment* fragment = FindFragment(user_key);
+  return fragment == nullptr ? 0 : MinCoveringTombstoneSeqnum(*fragment, seq);
+}
+
+SequenceNumber FragmentedRangeTombstoneList::MinCoveringTombstoneSeqnum(
+    const Fragment& fragment, SequenceNumber seq) const {
+  auto begin = seqs_.begin() + fragment.seq_begin;
+  auto end = seqs_.begin() + fragment.seq_end;
+  // the first one not newer than seq, the one before it is the answer
+  auto it = std::lower_bound(begin, end, seq, std::greater<SequenceNumber>());
+  return it == begin ? 0 : *(it - 1);
+}
+
+RangeDelAggregator::RangeDelAggregator(
+    const Comparator* ucmp, SequenceNumber upper_bound,
+    const std::vector<SequenceNumber>& snapshots)
+    : ucmp_(ucmp), upper_bound_(upper_bound), snapshots_(snapshots) {
+  assert(std::is_sorted(snapshots_.begin(), snapshots_.end()));
+}
+
+void RangeDelAggregator::AddTombstones(
+    std::shared_ptr<const FragmentedRangeTombstoneList> list) {
+  if (list == nullptr || list->empty()) {
+    return;
+  }
+  for (const auto& it : lists_) {
+    if (it == list) {
+      return;
+    }
+  }
+  lists_.push_back(std::move(list));
+  combined_.reset();
+}
+
+void RangeDelAggregator::Clear() {
+  lists_.clear();
+  combined_.reset();
+}
+
+size_t RangeDelAggregator::GetStripe(SequenceNumber seq) const {
+  return std::lower_bound(snapshots_.begin(), snapshots_.end(), seq) -
+         snapshots_.begin();
+}
+
+bool RangeDelAggregator::ShouldDelete(const Slice& user_key,
+                                      SequenceNumber seq) const {
+  // The oldest tombstone newer than the entry decides: the newer ones are
+  // at most as visible, and in later stripes if it is not in the entry's.
+  SequenceNumber oldest = 0;
+  for (const auto& list : lists_) {
+    SequenceNumber t = list->MinCoveringTombstoneSeqnum(user_key, seq);
+    if (t != 0 && (oldest == 0 || t < oldest)) {
+      oldest = t;
+    }
+  }
+  return oldest != 0 && oldest <= upper_bound_ &&
+         (snapshots_.empty() || GetStripe(oldest) == GetStripe(seq));
+}
+
+const FragmentedRangeTombstoneList* RangeDelAggregator::GetCombined() {
+  if (combined_ == nullptr) {
+    std::vector<RangeTombstone> tombstones;
+    for (const auto& list : lists_) {
+      for (const auto& fragment : list->fragments()) {
+        for (size_t i = fragment.seq_begin; i < fragment.seq_end; i++) {
+          tombstones.emplace_back(fragment.start_key, fragment.end_key,
+                                  list->seq(i));
+        }
+      }
+    }
+    combined_.reset(new FragmentedRangeTombstoneList(tombstones, ucmp_));
+  }
+  return combined_.get();
+}
+
+bool RangeDelAggregator::IsRangeCovered(const Slice& smallest_user_key,
+                                        const Slice& largest_user_key,
+                                        SequenceNumber smallest_seqno,
+                                        SequenceNumber largest_seqno) {
+  if (lists_.empty()) {
+    return false;
+  }
+  const FragmentedRangeTombstoneList* combined = GetCombined();
+  const auto& fragments = combined->fragments();
+  const auto* first = combined->FindFragment(smallest_user_key);
+  if (first == nullptr) {
+    return false;
+  }
+
+  const size_t stripe = GetStripe(smallest_seqno);
+  for (size_t i = first - fragments.data(); i < fragments.size(); i++) {
+    const auto& fragment = fragments[i];
+    if (&fragment != first &&
+        !ucmp_->Equal(fragment.start_key, fragments[i - 1].end_key)) {
+      return false;  // a gap between the fragments
+    }
+    SequenceNumber t =
+        combined->MinCoveringTombstoneSeqnum(fragment, largest_seqno);
+    if (t == 0 || t > upper_bound_ || GetStripe(t) != stripe) {
+      return false;
+    }
+    if (ucmp_->Compare(largest_user_key, fragment.end_key) < 0) {
+      return true;
+    }
+  }
+  return false;
+}
+
+std::shared_ptr<const FragmentedRangeTombstoneList>
+RangeDelAggregator::GetCompactionOutput(bool bottommost) {
+  if (lists_.empty()) {
+    return nullptr;
+  }
+  const FragmentedRangeTombstoneList* combined = GetCombined();
+  std::vector<RangeTombstone> tombstones;
+  for (const auto& fragment : combined->fragments()) {
+    size_t last_stripe = 0;
+    for (size_t i = fragment.seq_begin; i < fragment.seq_end; i++) {
+      const SequenceNumber t = combined->seq(i);
+      const size_t stripe = GetStripe(t);
+      if (i != fragment.seq_begin && stripe == last_stripe) {
+        continue;  // hidden by a newer one of the same stripe
+      }
+      last_stripe = stripe;
+      if (bottommost && stripe == 0) {
+        continue;
+      }
+      tombstones.emplace_back(fragment.start_key, fragment.end_key, t);
+    }
+  }
+  if (tombstones.empty()) {
+    return nullptr;
+  }
+  return std::make_shared<const FragmentedRangeTombstoneList>(tombstones,
+                                                              ucmp_);
+}
+
+void RangeDelAggregator::AddToBuilder(const FragmentedRangeTombstoneList& list,
+                                      const Slice* lower, const Slice* upper,
+                                      const InternalKeyComparator& icmp,
+                                      TableBuilder* builder,
+                                      FileMetaData* meta) {
+  const Comparator* ucmp = icmp.user_comparator();
+  for (const auto& fragment : list.fragments()) {
+    Slice start = fragment.start_key;
+    Slice end = fragment.end_key;
+    if (lower != nullptr && ucmp->Compare(start, *lower) < 0) {
+      start = *lower;
+    }
+    if (upper != nullptr && ucmp->Compare(end, *upper) > 0) {
+      end = *upper;
+    }
+    if (ucmp->Compare(start, end) >= 0) {
+      continue;
+    }
+    // the end is exclusive, so the file ends right before its user key
+    InternalKey largest(end, kMaxSequenceNumber, kTypeRangeDeletion);
+    for (size_t i = fragment.seq_begin; i < fragment.seq_end; i++) {
+      InternalKey smallest(start, list.seq(i), kTypeRangeDeletion);
+      builder->Add(smallest.Encode(), end);
+      meta->UpdateRangeBoundaries(smallest, largest, list.seq(i), icmp);
+    }
+  }
+}
+
+}  // namespace vidardb
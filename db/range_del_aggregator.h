@@ -0,0 +1,154 @@
+//  Copyright (c) 2020-present, VidarDB, Inc.  All rights reserved.
+//  This source code is licensed under the BSD-style license found in the
+//  LICENSE file in the root directory of this source tree. An additional grant
+//  of patent rights can be found in the PATENTS file in the same directory.
+
+#pragma once
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "db/dbformat.h"
+#include "vidardb/comparator.h"
+#include "vidardb/slice.h"
+#include "vidardb/status.h"
+#include "vidardb/types.h"
+
+namespace vidardb {
+
+class InternalIterator;
+class TableBuilder;
+struct FileMetaData;
+
+// A range tombstone deletes the user keys in [start_key, end_key) written
+// before seq. It is stored as the internal key (start_key, seq,
+// kTypeRangeDeletion) with end_key as the value.
+struct RangeTombstone {
+  Slice start_key;
+  Slice end_key;
+  SequenceNumber seq;
+
+  RangeTombstone(const Slice& start, const Slice& end, SequenceNumber s)
+      : start_key(start), end_key(end), seq(s) {}
+};
+
+// FragmentedRangeTombstoneList cuts overlapping range tombstones at all of
+// their boundaries into sorted and disjoint fragments, each one holding the
+// sequence numbers of the tombstones covering it, newest first. A lookup is
+// then a binary search over the fragments instead of a scan of the
+// tombstones. Adjacent fragments covered by the same tombstones are merged.
+// The list owns its keys and is immutable once built, so it is shared by
+// the readers of a memtable or a table without any lock.
+class FragmentedRangeTombstoneList {
+ public:
+  struct Fragment {
+    Slice start_key;
+    Slice end_key;
+    size_t seq_begin;  // [seq_begin, seq_end) of the sequence numbers
+    size_t seq_end;
+  };
+
+  FragmentedRangeTombstoneList(const std::vector<RangeTombstone>& tombstones,
+                               const Comparator* ucmp);
+
+  // Build from the entries of iter, keyed by the internal keys of the
+  // tombstones with their end keys as the values.
+  static std::shared_ptr<const FragmentedRangeTombstoneList> Create(
+      InternalIterator* iter, const Comparator* ucmp, Status* status);
+
+  // No copying allowed, the fragments point into keys_
+  FragmentedRangeTombstoneList(const FragmentedRangeTombstoneList&) = delete;
+  FragmentedRangeTombstoneList& operator=(
+      const FragmentedRangeTombstoneList&) = delete;
+
+  bool empty() const { return fragments_.empty(); }
+  uint64_t num_tombstones() const { return num_tombstones_; }
+  const std::vector<Fragment>& fragments() const { return fragments_; }
+  SequenceNumber seq(size_t i) const { return seqs_[i]; }
+
+  // Return the fragment covering user_key, or nullptr.
+  const Fragment* FindFragment(const Slice& user_key) const;
+
+  // Return the newest tombstone covering user_key that is visible at
+  // upper_bound, 0 if none.
+  SequenceNumber MaxCoveringTombstoneSeqnum(const Slice& user_key,
+                                            SequenceNumber upper_bound) const;
+
+  // Return the oldest tombstone covering user_key that is newer than seq,
+  // 0 if none. It is the one deciding whether an entry written at seq is
+  // deleted in the presence of snapshots.
+  SequenceNumber MinCoveringTombstoneSeqnum(const Slice& user_key,
+                                            SequenceNumber seq) const;
+  SequenceNumber MinCoveringTombstoneSeqnum(const Fragment& fragment,
+                                            SequenceNumber seq) const;
+
+ private:
+  const Comparator* ucmp_;
+  std::vector<std::string> keys_;  // the sorted distinct boundaries
+  std::vector<Fragment> fragments_;
+  std::vector<SequenceNumber> seqs_;
+  uint64_t num_tombstones_;
+};
+
+// RangeDelAggregator gathers the tombstone lists of the memtables and tables
+// a read or a compaction goes through, and decides whether an entry is
+// deleted by one of them. The tombstones newer than upper_bound are not
+// visible. In a compaction, a tombstone only deletes the entries of the same
+// snapshot stripe, i.e. those no snapshot tells apart from it.
+class RangeDelAggregator {
+ public:
+  RangeDelAggregator(const Comparator* ucmp, SequenceNumber upper_bound,
+                     const std::vector<SequenceNumber>& snapshots = {});
+
+  // Lists are shared, adding the same list twice is a noop.
+  void AddTombstones(std::shared_ptr<const FragmentedRangeTombstoneList> list);
+
+  // Drop all the lists, e.g. when the reader moves to another version.
+  void Clear();
+
+  bool empty() const { return lists_.empty(); }
+
+  // Return true if the entry of user_key written at seq is deleted.
+  bool ShouldDelete(const Slice& user_key, SequenceNumber seq) const;
+  bool ShouldDelete(const ParsedInternalKey& ikey) const {
+    return ShouldDelete(ikey.user_key, ikey.sequence);
+  }
+
+  // Return true if a single stripe of tombstones deletes all the entries of
+  // [smallest_user_key, largest_user_key] written from smallest_seqno to
+  // largest_seqno, so that a file with those bounds can be skipped whole.
+  bool IsRangeCovered(const Slice& smallest_user_key,
+                      const Slice& largest_user_key,
+                      SequenceNumber smallest_seqno,
+                      SequenceNumber largest_seqno);
+
+  // Return the tombstones a compaction keeps: the newest one of each
+  // snapshot stripe. A bottommost compaction drops the ones older than all
+  // the snapshots, the entries they deleted are gone. nullptr if none.
+  std::shared_ptr<const FragmentedRangeTombstoneList> GetCompactionOutput(
+      bool bottommost);
+
+  // Add the tombstones of list clipped to [lower, upper) to builder, nullptr
+  // meaning unbounded, and extend the key range and sequence numbers of meta
+  // accordingly. Called after the last point entry of the file.
+  static void AddToBuilder(const FragmentedRangeTombstoneList& list,
+                           const Slice* lower, const Slice* upper,
+                           const InternalKeyComparator& icmp,
+                           TableBuilder* builder, FileMetaData* meta);
+
+ private:
+  // Index of the first snapshot seeing seq.
+  size_t GetStripe(SequenceNumber seq) const;
+
+  // The fragmented union of all the lists.
+  const FragmentedRangeTombstoneList* GetCombined();
+
+  const Comparator* ucmp_;
+  const SequenceNumber upper_bound_;
+  const std::vector<SequenceNumber> snapshots_;  // ascending
+  std::vector<std::shared_ptr<const FragmentedRangeTombstoneList>> lists_;
+  std::unique_ptr<FragmentedRangeTombstoneList> combined_;
+};
+
+}  // namespace vidardb
@@ -296,6 +296,9 @@ class Repairer {
       ro.total_order_seek = true;
       Arena arena;
       ScopedArenaIterator iter(mem->NewIterator(ro, &arena));
+      RangeDelAggregator range_del_agg(icmp_.user_comparator(),
+                                       kMaxSequenceNumber);  // Shichao
+      range_del_agg.AddTombstones(mem->GetRangeTombstoneList());  // Shichao
       MutableCFOptions mutable_cf_options(options_, ioptions_);
       status = BuildTable(
           dbname_, env_, ioptions_, mutable_cf_options, env_options_,
@@ -304,7 +307,10 @@ class Repairer {
           TablePropertiesCollectorFactory::Context::kUnknownColumnFamily,
           std::string() /* column_family_name */, {}, kMaxSequenceNumber,
           kNoCompression, CompressionOptions(), false,
-          nullptr /* internal_stats */, TableFileCreationReason::kRecovery);
+          nullptr /* internal_stats */, TableFileCreationReason::kRecovery,
+          nullptr /* event_logger */, 0 /* job_id */, Env::IO_HIGH,
+          nullptr /* table_properties */, -1 /* level */,
+          &range_del_agg);  // Shichao
     }
     delete mem->Unref();
     delete cf_mems_default;
@@ -383,6 +389,28 @@ class Repairer {
       }
       delete iter;
     }
+    /***************************** Shichao ******************************/
+    // the range tombstones extend the key range of the table
+    std::shared_ptr<const FragmentedRangeTombstoneList> range_del_list;
+    if (status.ok()) {
+      status = table_cache_->GetRangeTombstoneList(
+          env_options_, icmp_, t->meta.fd, &range_del_list);
+    }
+    if (status.ok() && range_del_list != nullptr) {
+      for (const auto& fragment : range_del_list->fragments()) {
+        InternalKey end(fragment.end_key, kMaxSequenceNumber,
+                        kTypeRangeDeletion);
+        for (size_t i = fragment.seq_begin; i < fragment.seq_end; i++) {
+          const SequenceNumber seq = range_del_list->seq(i);
+          t->meta.UpdateRangeBoundaries(
+              InternalKey(fragment.start_key, seq, kTypeRangeDeletion), end,
+              seq, icmp_);
+          t->max_sequence = std::max(t->max_sequence, seq);
+          counter++;
+        }
+      }
+    }
+    /***************************** Shichao ******************************/
     Log(InfoLogLevel::INFO_LEVEL,
         options_.info_log, "Table #%" PRIu64 ": %d entries %s",
         t->meta.fd.GetNumber(), counter, status.ToString().c_str());
@@ -0,0 +1,201 @@
+//  Copyright (c) 2020-present, VidarDB, Inc.  All rights reserved.
+//  This source code is licensed under the BSD-style license found in the
+//  LICENSE file in the root directory of this source tree. An additional grant
+//  of patent rights can be found in the PATENTS file in the same directory.
+
+#include "db/row_cache_entry.h"
+
+#include <algorithm>
+
+#include "table/get_context.h"
+#include "util/coding.h"
+
+namespace vidardb {
+
+namespace {
+bool HasValue(ValueType type) {
+  return type == kTypeValue || type == kTypeMerge;
+}
+}  // anonymous namespace
+
+RowCacheEntry::Projection::Projection(const std::vector<uint32_t>& read_columns,
+                                      const Splitter* splitter)
+    : whole(read_columns.empty() || splitter == nullptr) {
+  if (whole) {
+    return;
+  }
+  for (auto column : read_columns) {
+    if (column > 0) {  // only the value columns, 0 is the key
+      columns.push_back(column);
+    }
+  }
+}
+
+std::vector<uint32_t> RowCacheEntry::Projection::ReadColumns() const {
+  if (whole) {
+    return {};
+  }
+  if (columns.empty()) {
+    return {0};  // only the keys
+  }
+  return columns;
+}
+
+bool RowCacheEntry::AddReplayLog(const Slice& replay_log,
+                                 const Projection& projection,
+                                 const Splitter* splitter) {
+  std::vector<std::pair<ValueType, Slice>> records;
+  Slice s = replay_log;
+  while (s.size()) {
+    auto type = static_cast<ValueType>(*s.data());
+    s.remove_prefix(1);
+    Slice value;
+    if (!GetLengthPrefixedSlice(&s, &value)) {
+      return false;
+    }
+    records.emplace_back(type, value);
+  }
+  if (records.empty()) {
+    return false;
+  }
+  if (!ops_.empty()) {
+    // the reads of another projection go through the same operations
+    if (records.size() != ops_.size()) {
+      return false;
+    }
+    for (size_t i = 0; i < records.size(); i++) {
+      if (records[i].first != ops_[i].type) {
+        return false;
+      }
+    }
+  }
+
+  // Split all the values before changing anything
+  std::vector<std::vector<Slice>> parts(records.size());
+  if (!projection.whole && !projection.columns.empty()) {
+    for (size_t i = 0; i < records.size(); i++) {
+      if (!HasValue(records[i].first)) {
+        continue;
+      }
+      splitter->Split(records[i].second, parts[i]);
+      if (parts[i].size() != projection.columns.size()) {
+        return false;
+      }
+    }
+  }
+
+  if (ops_.empty()) {
+    ops_.resize(records.size());
+    for (size_t i = 0; i < records.size(); i++) {
+      ops_[i].type = records[i].first;
+    }
+  }
+  for (size_t i = 0; i < records.size(); i++) {
+    if (!HasValue(records[i].first)) {
+      continue;
+    }
+    Operation& op = ops_[i];
+    if (projection.whole) {
+      op.value = records[i].second.ToString();
+      continue;
+    }
+    for (size_t j = 0; j < projection.columns.size(); j++) {
+      uint32_t column = projection.columns[j];
+      if (op.columns.size() < column) {
+        op.columns.resize(column);
+      }
+      op.columns[column - 1] = parts[i][j].ToString();
+    }
+  }
+
+  if (projection.whole) {
+    whole_ = true;
+  }
+  for (auto column : projection.columns) {
+    if (filled_.size() < column) {
+      filled_.resize(column, false);
+    }
+    filled_[column - 1] = true;
+  }
+  return true;
+}
+
+bool RowCacheEntry::Missing(const Projection& projection,
+                            Projection* missing) const {
+  missing->whole = projection.whole && !whole_;
+  missing->columns.clear();
+  if (projection.whole || whole_) {
+    return missing->whole;
+  }
+  for (auto column : projection.columns) {
+    if (!Held(column) &&
+        std::find(missing->columns.begin(), missing->columns.end(), column) ==
+            missing->columns.end()) {
+      missing->columns.push_back(column);
+    }
+  }
+  return !missing->columns.empty();
+}
+
+bool RowCacheEntry::Replay(const Projection& projection, const Slice& user_key,
+                           const Splitter* splitter,
+                           GetContext* get_context) const {
+  // project all the values first, so nothing is saved on a bad column
+  std::vector<std::string> values(ops_.size());
+  std::string buf;
+  std::vector<Slice> whole_parts;
+  std::vector<Slice> parts;
+  for (size_t i = 0; i < ops_.size(); i++) {
+    const Operation& op = ops_[i];
+    if (!HasValue(op.type)) {
+      continue;
+    }
+    if (projection.whole) {
+      assert(whole_);
+      values[i] = op.value;
+    } else if (!projection.columns.empty()) {
+      whole_parts.clear();
+      parts.clear();
+      for (auto column : projection.columns) {
+        if (Held(column)) {
+          parts.emplace_back(op.columns[column - 1]);
+          continue;
+        }
+        if (!whole_) {
+          return false;
+        }
+        if (whole_parts.empty()) {
+          splitter->Split(op.value, whole_parts);
+        }
+        if (column < 1 || column > whole_parts.size()) {
+          return false;
+        }
+        parts.push_back(whole_parts[column - 1]);
+      }
+      values[i] = splitter->Stitch(parts, buf).ToString();
+    }
+  }
+
+  for (size_t i = 0; i < ops_.size(); i++) {
+    // Since SequenceNumber is not stored and unknown, we will use
+    // kMaxSequenceNumber.
+    get_context->SaveValue(
+        ParsedInternalKey(user_key, kMaxSequenceNumber, ops_[i].type),
+        values[i]);
+  }
+  return true;
+}
+
+size_t RowCacheEntry::ApproximateMemoryUsage() const {
+  size_t usage = sizeof(*this) + filled_.capacity() / 8;
+  for (const auto& op : ops_) {
+    usage += sizeof(op) + op.value.size() +
+             op.columns.size() * sizeof(std::string);
+    for (const auto& column : op.columns) {
+      usage += column.size();
+    }
+  }
+  return usage;
+}
+
+}  // namespace vidardb
@@ -0,0 +1,80 @@
+//  Copyright (c) 2020-present, VidarDB, Inc.  All rights reserved.
+//  This source code is licensed under the BSD-style license found in the
+//  LICENSE file in the root directory of this source tree. An additional grant
+//  of patent rights can be found in the PATENTS file in the same directory.
+
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "db/dbformat.h"
+#include "vidardb/slice.h"
+#include "vidardb/splitter.h"
+
+namespace vidardb {
+
+class GetContext;
+
+// RowCacheEntry is a row of Options::row_cache: the operations a table
+// replays into a GetContext for a key, with their values kept per column so
+// that the reads projecting different columns share it. A read of columns
+// {2,5} hits an entry filled by a read of {2,5,7}; a read of {2,8} reads
+// column 8 alone from the table, then inserts a copy holding {2,5,7,8}.
+// Entries are immutable once in the cache.
+class RowCacheEntry {
+ public:
+  // The value columns a read returns, from ReadOptions::columns. The read
+  // returns whole values if whole, else the columns numbered from 1 in its
+  // order, nothing but the keys if they are empty.
+  struct Projection {
+    bool whole;
+    std::vector<uint32_t> columns;
+
+    Projection() : whole(false) {}
+    Projection(const std::vector<uint32_t>& read_columns,
+               const Splitter* splitter);
+
+    // The ReadOptions::columns of a read returning this projection.
+    std::vector<uint32_t> ReadColumns() const;
+  };
+
+  RowCacheEntry() : whole_(false) {}
+
+  // Add the values of a read of projection from its replay log, see
+  // GetContext::SetReplayLog(). The first log sets the operations, the next
+  // ones must replay the same. Return false, leaving the entry unchanged, if
+  // they do not or if the values do not split into the projected columns.
+  bool AddReplayLog(const Slice& replay_log, const Projection& projection,
+                    const Splitter* splitter);
+
+  // Return true and set *missing to what a read has to add to serve
+  // projection, false if the entry serves it already.
+  bool Missing(const Projection& projection, Projection* missing) const;
+
+  // Replay the operations projected into get_context like
+  // replayGetContextLog(), the entry must serve projection. Return false,
+  // leaving get_context unchanged, if projection names a column some stored
+  // value does not have, so the caller reads the table instead.
+  bool Replay(const Projection& projection, const Slice& user_key,
+              const Splitter* splitter, GetContext* get_context) const;
+
+  size_t ApproximateMemoryUsage() const;
+
+ private:
+  struct Operation {
+    ValueType type;
+    std::string value;  // the whole value if whole_
+    std::vector<std::string> columns;  // by column number - 1
+  };
+
+  bool Held(uint32_t column) const {
+    return column >= 1 && column <= filled_.size() && filled_[column - 1];
+  }
+
+  std::vector<Operation> ops_;
+  bool whole_;
+  std::vector<bool> filled_;  // the columns held, by column number - 1
+};
+
+}  // namespace vidardb
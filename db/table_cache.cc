@@ -16,6 +16,7 @@
 
 #include "db/dbformat.h"
 #include "db/filename.h"
+#include "db/range_del_aggregator.h"  // Shichao
 #include "db/version_edit.h"
 
 #include "vidardb/statistics.h"
@@ -23,6 +24,7 @@
 #include "table/iterator_wrapper.h"
 #include "table/table_builder.h"
 #include "table/table_reader.h"
+#include "table/table_open_state.h"  // Shichao
 #include "table/get_context.h"
 #include "util/coding.h"
 #include "util/file_reader_writer.h"
@@ -69,8 +71,12 @@ void AppendVarint64(IterKey* key, uint64_t v) {
 }  // namespace
 
 TableCache::TableCache(const ImmutableCFOptions& ioptions,
-                       const EnvOptions& env_options, Cache* const cache)
-    : ioptions_(ioptions), env_options_(env_options), cache_(cache) {
+                       const EnvOptions& env_options, Cache* const cache,
+                       TableOpenState* table_open_state)
+    : ioptions_(ioptions),
+      env_options_(env_options),
+      cache_(cache),
+      table_open_state_(table_open_state) {  // Shichao
   if (ioptions_.row_cache) {
     // If the same cache is shared by multiple instances, we need to
     // disambiguate its entries.
@@ -117,16 +123,33 @@ Status TableCache::GetTableReader(
     if (!sequential_mode && ioptions_.advise_random_on_open) {
       file->Hint(RandomAccessFile::RANDOM);
     }
+    /***************************** Shichao ******************************/
+    TableOpenState::File* state_file = nullptr;
+    if (table_open_state_ != nullptr) {
+      auto wrapped = table_open_state_->NewFile(fname, fd.GetFileSize(),
+                                                std::move(file));
+      state_file = wrapped.get();
+      file = std::move(wrapped);
+    }
+    /***************************** Shichao ******************************/
     StopWatch sw(ioptions_.env, ioptions_.statistics, TABLE_OPEN_IO_MICROS);
     std::unique_ptr<RandomAccessFileReader> file_reader(
         new RandomAccessFileReader(std::move(file), ioptions_.env,
                                    ioptions_.statistics, record_read_stats,
-                                   file_read_hist));
+                                   file_read_hist, ioptions_.rate_limiter));
 
+    /***************************** Shichao ******************************/
+    TableReaderOptions table_reader_options(ioptions_,
+        os_cache? env_options: eo, internal_comparator, level, cols);
+    table_reader_options.open_state = table_open_state_;
     s = ioptions_.table_factory->NewTableReader(
-        TableReaderOptions(ioptions_, os_cache? env_options: eo,  // Shichao
-            internal_comparator, level, cols),      // Shichao
-        std::move(file_reader), fd.GetFileSize(), table_reader);
+        table_reader_options, std::move(file_reader), fd.GetFileSize(),
+        table_reader);
+    // the file is gone with the table reader on failure
+    if (s.ok() && state_file != nullptr) {
+      state_file->Finish();
+    }
+    /***************************** Shichao ******************************/
     TEST_SYNC_POINT("TableCache::GetTableReader:0");
   }
   return s;
@@ -182,7 +205,8 @@ InternalIterator* TableCache::NewIterator(
     const ReadOptions& options, const EnvOptions& env_options,
     const InternalKeyComparator& icomparator, const FileDescriptor& fd,
     TableReader** table_reader_ptr, HistogramImpl* file_read_hist,
-    bool for_compaction, Arena* arena, int level, bool os_cache) {  // Shichao
+    bool for_compaction, Arena* arena, int level, bool os_cache,  // Shichao
+    RangeDelAggregator* range_del_agg) {  // Shichao
   PERF_TIMER_GUARD(new_table_iterator_nanos);
 
   if (table_reader_ptr != nullptr) {
@@ -235,6 +259,9 @@ InternalIterator* TableCache::NewIterator(
 
   InternalIterator* result =
       table_reader->NewIterator(options, arena);
+  if (range_del_agg != nullptr) {  // Shichao
+    range_del_agg->AddTombstones(table_reader->GetRangeTombstoneList());
+  }
 
   if (create_new_table_reader) {
     assert(handle == nullptr);
@@ -262,6 +289,19 @@ Status TableCache::Get(const ReadOptions& options,
   Status s;
   Cache::Handle* handle = nullptr;
   std::string* row_cache_entry = nullptr;
+  /***************************** Shichao ******************************/
+  // the columns the read projects, and a copy of the cached row missing
+  // some of them, filled by the read
+  RowCacheEntry::Projection projection;
+  RowCacheEntry::Projection missing;
+  std::unique_ptr<RowCacheEntry> row_cache_fill;
+
+  SequenceNumber* max_covering_tombstone_seq =
+      get_context->max_covering_tombstone_seq();
+  // The cached entries do not know the tombstones of the newer files
+  const bool covered = max_covering_tombstone_seq != nullptr &&
+                       *max_covering_tombstone_seq > 0;
+  /***************************** Shichao ******************************/
 
 #ifndef VIDARDB_LITE
   IterKey row_cache_key;
@@ -269,7 +309,8 @@ Status TableCache::Get(const ReadOptions& options,
 
   // Check row cache if enabled. Since row cache does not currently store
   // sequence numbers, we cannot use it if we need to fetch the sequence.
-  if (ioptions_.row_cache && !get_context->NeedToReadSequence()) {
+  if (ioptions_.row_cache && !get_context->NeedToReadSequence() &&
+      !covered) {  // Shichao
     uint64_t fd_number = fd.GetNumber();
     auto user_key = ExtractUserKey(k);
     // We use the user key as cache key instead of the internal key,
@@ -288,18 +329,36 @@ Status TableCache::Get(const ReadOptions& options,
     row_cache_key.TrimAppend(row_cache_key.Size(), user_key.data(),
                              user_key.size());
 
+    /***************************** Shichao ******************************/
+    // The cached rows hold the values per column, so the reads projecting
+    // other columns share them, and only read the columns they miss.
+    projection = RowCacheEntry::Projection(options.columns,
+                                           ioptions_.splitter);
     if (auto row_handle = ioptions_.row_cache->Lookup(row_cache_key.GetKey())) {
-      auto found_row_cache_entry = static_cast<const std::string*>(
+      auto found_row_cache_entry = static_cast<const RowCacheEntry*>(
           ioptions_.row_cache->Value(row_handle));
-      replayGetContextLog(*found_row_cache_entry, user_key, get_context);
+      bool missed = found_row_cache_entry->Missing(projection, &missing);
+      if (!missed &&
+          found_row_cache_entry->Replay(projection, user_key,
+                                        ioptions_.splitter, get_context)) {
+        ioptions_.row_cache->Release(row_handle);
+        RecordTick(ioptions_.statistics, ROW_CACHE_HIT);
+        return Status::OK();
+      }
+      if (missed) {
+        row_cache_fill.reset(new RowCacheEntry(*found_row_cache_entry));
+        RecordTick(ioptions_.statistics, ROW_CACHE_PARTIAL_HIT);
+      } else {
+        // a column past the end of the cached values, read the table
+        RecordTick(ioptions_.statistics, ROW_CACHE_MISS);
+      }
       ioptions_.row_cache->Release(row_handle);
-      RecordTick(ioptions_.statistics, ROW_CACHE_HIT);
-      return Status::OK();
+    } else {
+      // Not found, setting up the replay log.
+      RecordTick(ioptions_.statistics, ROW_CACHE_MISS);
     }
-
-    // Not found, setting up the replay log.
-    RecordTick(ioptions_.statistics, ROW_CACHE_MISS);
     row_cache_entry = &row_cache_entry_buffer;
+    /***************************** Shichao ******************************/
   }
 #endif  // VIDARDB_LITE
 
@@ -312,9 +371,31 @@ Status TableCache::Get(const ReadOptions& options,
     }
   }
   if (s.ok()) {
-    get_context->SetReplayLog(row_cache_entry);  // nullptr if no cache.
-    s = t->Get(options, k, get_context);
-    get_context->SetReplayLog(nullptr);
+    /***************************** Shichao ******************************/
+    auto range_del_list = t->GetRangeTombstoneList();
+    if (range_del_list != nullptr) {
+      if (max_covering_tombstone_seq != nullptr) {
+        *max_covering_tombstone_seq = std::max(
+            *max_covering_tombstone_seq,
+            range_del_list->MaxCoveringTombstoneSeqnum(
+                ExtractUserKey(k), GetInternalKeySeqno(k)));
+      }
+      row_cache_entry = nullptr;  // the entries depend on the tombstones
+      row_cache_fill.reset();
+    }
+    if (row_cache_fill != nullptr &&
+        FillRowCacheEntry(options, internal_comparator, t, k, missing,
+                          row_cache_fill.get()) &&
+        row_cache_fill->Replay(projection, ExtractUserKey(k),
+                               ioptions_.splitter, get_context)) {
+      // served from the filled entry
+    } else {
+      row_cache_fill.reset();
+      get_context->SetReplayLog(row_cache_entry);  // nullptr if no cache.
+      s = t->Get(options, k, get_context);
+      get_context->SetReplayLog(nullptr);
+    }
+    /***************************** Shichao ******************************/
     if (handle != nullptr) {
       ReleaseHandle(handle);
     }
@@ -326,18 +407,53 @@ Status TableCache::Get(const ReadOptions& options,
 
 #ifndef VIDARDB_LITE
   // Put the replay log in row cache only if something was found.
-  if (s.ok() && row_cache_entry && !row_cache_entry->empty()) {
+  /***************************** Shichao ******************************/
+  if (s.ok() && row_cache_entry && row_cache_fill == nullptr &&
+      !row_cache_entry->empty()) {
+    row_cache_fill.reset(new RowCacheEntry());
+    if (!row_cache_fill->AddReplayLog(*row_cache_entry, projection,
+                                      ioptions_.splitter)) {
+      row_cache_fill.reset();
+    }
+  }
+  if (s.ok() && row_cache_entry && row_cache_fill != nullptr) {
     size_t charge =
-        row_cache_key.Size() + row_cache_entry->size() + sizeof(std::string);
-    void* row_ptr = new std::string(std::move(*row_cache_entry));
-    ioptions_.row_cache->Insert(row_cache_key.GetKey(), row_ptr, charge,
-                                &DeleteEntry<std::string>);
+        row_cache_key.Size() + row_cache_fill->ApproximateMemoryUsage();
+    // replaces the entry it was copied from, if any
+    ioptions_.row_cache->Insert(row_cache_key.GetKey(),
+                                row_cache_fill.release(), charge,
+                                &DeleteEntry<RowCacheEntry>);
   }
+  /***************************** Shichao ******************************/
 #endif  // VIDARDB_LITE
 
   return s;
 }
 
+/***************************** Shichao ******************************/
+bool TableCache::FillRowCacheEntry(
+    const ReadOptions& options,
+    const InternalKeyComparator& internal_comparator, TableReader* t,
+    const Slice& k, const RowCacheEntry::Projection& missing,
+    RowCacheEntry* entry) {
+  // The operations are replayed into a context of their own, which does not
+  // merge them.
+  ReadOptions ro = options;
+  ro.columns = missing.ReadColumns();
+  MergeContext merge_context;
+  GetContext get_context(internal_comparator.user_comparator(),
+                         ioptions_.merge_operator, ioptions_.info_log,
+                         GetContext::kNotFound, ExtractUserKey(k), nullptr,
+                         nullptr, &merge_context);
+  std::string replay_log;
+  get_context.SetReplayLog(&replay_log);
+  Status s = t->Get(ro, k, &get_context);
+  // The log is empty if no io is allowed and the blocks are not cached
+  return s.ok() && get_context.State() != GetContext::kCorrupt &&
+         entry->AddReplayLog(replay_log, missing, ioptions_.splitter);
+}
+/***************************** Shichao ******************************/
+
 Status TableCache::GetTableProperties(
     const EnvOptions& env_options,
     const InternalKeyComparator& internal_comparator, const FileDescriptor& fd,
@@ -363,6 +479,32 @@ Status TableCache::GetTableProperties(
   return s;
 }
 
+/***************************** Shichao ******************************/
+Status TableCache::GetRangeTombstoneList(
+    const EnvOptions& env_options,
+    const InternalKeyComparator& internal_comparator, const FileDescriptor& fd,
+    std::shared_ptr<const FragmentedRangeTombstoneList>* range_del_list) {
+  Status s;
+  auto table_reader = fd.table_reader;
+  // table already been pre-loaded?
+  if (table_reader) {
+    *range_del_list = table_reader->GetRangeTombstoneList();
+    return s;
+  }
+
+  Cache::Handle* table_handle = nullptr;
+  s = FindTable(env_options, internal_comparator, fd, &table_handle);
+  if (!s.ok()) {
+    return s;
+  }
+  assert(table_handle);
+  auto table = GetTableReaderFromHandle(table_handle);
+  *range_del_list = table->GetRangeTombstoneList();
+  ReleaseHandle(table_handle);
+  return s;
+}
+/***************************** Shichao ******************************/
+
 size_t TableCache::GetMemoryUsageByTableReader(
     const EnvOptions& env_options,
     const InternalKeyComparator& internal_comparator,
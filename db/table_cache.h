@@ -20,6 +20,7 @@
 #include <stdint.h>
 
 #include "db/dbformat.h"
+#include "db/row_cache_entry.h"  // Shichao
 #include "port/port.h"
 #include "vidardb/cache.h"
 #include "vidardb/env.h"
@@ -35,11 +36,15 @@ struct FileDescriptor;
 class GetContext;
 class HistogramImpl;
 class InternalIterator;
+class RangeDelAggregator;  // Shichao
+class TableOpenState;  // Shichao
 
 class TableCache {
  public:
+  // If table_open_state is not nullptr, the table files are opened through it.
   TableCache(const ImmutableCFOptions& ioptions,
-             const EnvOptions& storage_options, Cache* cache);
+             const EnvOptions& storage_options, Cache* cache,
+             TableOpenState* table_open_state = nullptr);  // Shichao
   ~TableCache();
 
   // Return an iterator for the specified file number (the corresponding
@@ -51,12 +56,15 @@ class TableCache {
   // returned iterator is live.
   // @param skip_filters Disables loading/accessing the filter block
   // @param level The level this table is at, -1 for "not set / don't know"
+  // @param range_del_agg If not nullptr, the range tombstones of the table
+  //                      are added to it
   InternalIterator* NewIterator(
       const ReadOptions& options, const EnvOptions& toptions,
       const InternalKeyComparator& internal_comparator,
       const FileDescriptor& file_fd, TableReader** table_reader_ptr = nullptr,
       HistogramImpl* file_read_hist = nullptr, bool for_compaction = false,
-      Arena* arena = nullptr, int level = -1, bool os_cache = true);  // Shichao
+      Arena* arena = nullptr, int level = -1, bool os_cache = true,  // Shichao
+      RangeDelAggregator* range_del_agg = nullptr);                // Shichao
 
   // If a seek to internal key "k" in specified file finds an entry,
   // call (*handle_result)(arg, found_key, found_value) repeatedly until
@@ -100,6 +108,15 @@ class TableCache {
                             std::shared_ptr<const TableProperties>* properties,
                             bool no_io = false);
 
+  /***************************** Shichao ******************************/
+  // Get the fragmented range tombstones of a given table, nullptr if none.
+  Status GetRangeTombstoneList(
+      const EnvOptions& toptions,
+      const InternalKeyComparator& internal_comparator,
+      const FileDescriptor& file_meta,
+      std::shared_ptr<const FragmentedRangeTombstoneList>* range_del_list);
+  /***************************** Shichao ******************************/
+
   // Return total memory usage of the table reader of the file.
   // 0 if table reader of the file is not loaded.
   size_t GetMemoryUsageByTableReader(
@@ -121,10 +138,21 @@ class TableCache {
                         int level = -1, bool os_cache = true,  // Shichao
                         const std::vector<uint32_t>& cols = std::vector<uint32_t>());  // Shichao
 
+  /***************************** Shichao ******************************/
+  // Read the missing columns of the key k from table t into entry, a copy
+  // of a cached row. Return false if the entry is not filled.
+  bool FillRowCacheEntry(const ReadOptions& options,
+                         const InternalKeyComparator& internal_comparator,
+                         TableReader* t, const Slice& k,
+                         const RowCacheEntry::Projection& missing,
+                         RowCacheEntry* entry);
+  /***************************** Shichao ******************************/
+
   const ImmutableCFOptions& ioptions_;
   const EnvOptions& env_options_;
   Cache* const cache_;
   std::string row_cache_id_;
+  TableOpenState* const table_open_state_;  // Shichao
 };
 
 }  // namespace vidardb
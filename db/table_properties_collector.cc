@@ -20,8 +20,11 @@ Status InternalKeyPropertiesCollector::InternalAdd(const Slice& key,
   }
 
   // Note: We count both, deletions and single deletions here.
-  if (ikey.type == ValueType::kTypeDeletion) {
+  if (ikey.type == ValueType::kTypeDeletion ||
+      ikey.type == ValueType::kTypeSingleDeletion) {
     ++deleted_keys_;
+  } else if (ikey.type == ValueType::kTypeMerge) {
+    ++merge_operands_;
   }
 
   return Status::OK();
@@ -62,6 +65,10 @@ EntryType GetEntryType(ValueType value_type) {
       return kEntryPut;
     case kTypeDeletion:
       return kEntryDelete;
+    case kTypeSingleDeletion:
+      return kEntrySingleDelete;
+    case kTypeMerge:
+      return kEntryMerge;
     default:
       return kEntryOther;
   }
@@ -299,6 +299,9 @@ class VersionBuilder::Rep {
       }
     }
 
+    // The threads take the next file as soon as they are done with one, so a
+    // slow one, e.g. a column table with many sub-column files, does not hold
+    // up the others.
     std::atomic<size_t> next_file_meta_idx(0);
     std::function<void()> load_handlers_func = [&]() {
       while (true) {
@@ -322,13 +325,20 @@ class VersionBuilder::Rep {
       }
     };
 
+    /***************************** Shichao ******************************/
+    // no more threads than files, e.g. a flush only adds one file
+    max_threads = static_cast<int>(std::min(
+        files_meta.size(), static_cast<size_t>(std::max(max_threads, 1))));
+    /***************************** Shichao ******************************/
     if (max_threads <= 1) {
       load_handlers_func();
     } else {
       std::vector<std::thread> threads;
-      for (int i = 0; i < max_threads; i++) {
+      // the current thread is one of them
+      for (int i = 1; i < max_threads; i++) {
         threads.emplace_back(load_handlers_func);
       }
+      load_handlers_func();
 
       for (auto& t : threads) {
         t.join();
@@ -126,6 +126,23 @@ struct FileMetaData {
     smallest_seqno = std::min(smallest_seqno, seqno);
     largest_seqno = std::max(largest_seqno, seqno);
   }
+
+  /***************************** Shichao ******************************/
+  // Extend the boundaries to a range tombstone, whose keys are not added in
+  // sorted order.
+  void UpdateRangeBoundaries(const InternalKey& start, const InternalKey& end,
+                             SequenceNumber seqno,
+                             const InternalKeyComparator& icmp) {
+    if (smallest.size() == 0 || icmp.Compare(start, smallest) < 0) {
+      smallest = start;
+    }
+    if (largest.size() == 0 || icmp.Compare(end, largest) > 0) {
+      largest = end;
+    }
+    smallest_seqno = std::min(smallest_seqno, seqno);
+    largest_seqno = std::max(largest_seqno, seqno);
+  }
+  /***************************** Shichao ******************************/
 };
 
 // A compressed copy of file meta data that just contain
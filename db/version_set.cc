@@ -33,6 +33,8 @@
 #include "db/internal_stats.h"
 #include "db/log_reader.h"
 #include "db/log_writer.h"
+#include "db/merge_helper.h"
+#include "db/pinned_iterators_manager.h"  // Shichao
 #include "memtable/memtable.h"
 #include "db/table_cache.h"
 #include "db/version_builder.h"
@@ -559,7 +561,8 @@ class LevelFileIteratorState : public TwoLevelIteratorState {
                          const EnvOptions& env_options,
                          const InternalKeyComparator& icomparator,
                          HistogramImpl* file_read_hist, bool for_compaction,
-                         int level)
+                         int level,
+                         RangeDelAggregator* range_del_agg = nullptr)
       : TwoLevelIteratorState(),
         table_cache_(table_cache),
         read_options_(read_options),
@@ -567,7 +570,8 @@ class LevelFileIteratorState : public TwoLevelIteratorState {
         icomparator_(icomparator),
         file_read_hist_(file_read_hist),
         for_compaction_(for_compaction),
-        level_(level) {}
+        level_(level),
+        range_del_agg_(range_del_agg) {}  // Shichao
 
   InternalIterator* NewSecondaryIterator(const Slice& meta_handle) override {
     if (meta_handle.size() != sizeof(FileDescriptor)) {
@@ -579,10 +583,29 @@ class LevelFileIteratorState : public TwoLevelIteratorState {
       return table_cache_->NewIterator(
           read_options_, env_options_, icomparator_, *fd,
           nullptr /* don't need reference to table*/, file_read_hist_,
-          for_compaction_, nullptr /* arena */, level_);
+          for_compaction_, nullptr /* arena */, level_, true /* os_cache */,
+          range_del_agg_);  // Shichao
     }
   }
 
+  /***************************** Shichao ******************************/
+  // The first level key is the largest key of a file, the next file of the
+  // level starts after it.
+  bool KeyReachedUpperBound(const Slice& largest_key) override {
+    return read_options_.iterate_upper_bound != nullptr &&
+           icomparator_.user_comparator()->Compare(
+               ExtractUserKey(largest_key),
+               *read_options_.iterate_upper_bound) >= 0;
+  }
+
+  bool KeyBeforeLowerBound(const Slice& largest_key) override {
+    return read_options_.iterate_lower_bound != nullptr &&
+           icomparator_.user_comparator()->Compare(
+               ExtractUserKey(largest_key),
+               *read_options_.iterate_lower_bound) < 0;
+  }
+  /***************************** Shichao ******************************/
+
  private:
   TableCache* table_cache_;
   const ReadOptions read_options_;
@@ -591,6 +614,7 @@ class LevelFileIteratorState : public TwoLevelIteratorState {
   HistogramImpl* file_read_hist_;
   bool for_compaction_;
   int level_;
+  RangeDelAggregator* range_del_agg_;  // Shichao
 };
 
 // A wrapper of version builder which references the current version in
@@ -599,10 +623,13 @@ class LevelFileIteratorState : public TwoLevelIteratorState {
 class BaseReferencedVersionBuilder {
  public:
   explicit BaseReferencedVersionBuilder(ColumnFamilyData* cfd)
+      : BaseReferencedVersionBuilder(cfd, cfd->current()) {}
+  // Shichao: build on base instead of the current version
+  BaseReferencedVersionBuilder(ColumnFamilyData* cfd, Version* base)
       : version_builder_(new VersionBuilder(
-            cfd->current()->version_set()->env_options(), cfd->table_cache(),
-            cfd->current()->storage_info(), cfd->ioptions()->info_log)),
-        version_(cfd->current()) {
+            base->version_set()->env_options(), cfd->table_cache(),
+            base->storage_info(), cfd->ioptions()->info_log)),
+        version_(base) {
     version_->Ref();
   }
   ~BaseReferencedVersionBuilder() {
@@ -855,9 +882,29 @@ double VersionStorageInfo::GetEstimatedCompressionRatioAtLevel(
   return static_cast<double>(sum_data_size_bytes) / sum_file_size_bytes;
 }
 
+/***************************** Shichao ******************************/
+bool Version::FileOverlapsBounds(const ReadOptions& read_options,
+                                 const Slice& smallest_key,
+                                 const Slice& largest_key) const {
+  const Comparator* ucmp = cfd_->internal_comparator().user_comparator();
+  if (read_options.iterate_upper_bound != nullptr &&
+      ucmp->Compare(ExtractUserKey(smallest_key),
+                    *read_options.iterate_upper_bound) >= 0) {
+    return false;
+  }
+  if (read_options.iterate_lower_bound != nullptr &&
+      ucmp->Compare(ExtractUserKey(largest_key),
+                    *read_options.iterate_lower_bound) < 0) {
+    return false;
+  }
+  return true;
+}
+/***************************** Shichao ******************************/
+
 void Version::AddIterators(const ReadOptions& read_options,
                            const EnvOptions& soptions,
-                           MergeIteratorBuilder* merge_iter_builder) {
+                           MergeIteratorBuilder* merge_iter_builder,
+                           RangeDelAggregator* range_del_agg) {
   assert(storage_info_.finalized_);
 
   if (storage_info_.num_non_empty_levels() == 0) {
@@ -870,23 +917,33 @@ void Version::AddIterators(const ReadOptions& read_options,
   // Merge all level zero files together since they may overlap
   for (size_t i = 0; i < storage_info_.LevelFilesBrief(0).num_files; i++) {
     const auto& file = storage_info_.LevelFilesBrief(0).files[i];
+    if (!FileOverlapsBounds(read_options, file.smallest_key,
+                            file.largest_key)) {  // Shichao
+      continue;
+    }
     merge_iter_builder->AddIterator(cfd_->table_cache()->NewIterator(
         read_options, soptions, cfd_->internal_comparator(), file.fd, nullptr,
         cfd_->internal_stats()->GetFileReadHist(0), false, arena,
-        false /* skip_filters */, 0 /* level */));
+        false /* skip_filters */, 0 /* level */, range_del_agg));
   }
 
   // For levels > 0, we can use a concatenating iterator that sequentially
   // walks through the non-overlapping files in the level, opening them
   // lazily.
   for (int level = 1; level < storage_info_.num_non_empty_levels(); level++) {
-    if (storage_info_.LevelFilesBrief(level).num_files != 0) {
+    /***************************** Shichao ******************************/
+    const LevelFilesBrief& flevel = storage_info_.LevelFilesBrief(level);
+    if (flevel.num_files != 0 &&
+        FileOverlapsBounds(read_options, flevel.files[0].smallest_key,
+                           flevel.files[flevel.num_files - 1].largest_key)) {
+    /***************************** Shichao ******************************/
       auto* mem = arena->AllocateAligned(sizeof(LevelFileIteratorState));
       auto* state = new (mem)
           LevelFileIteratorState(cfd_->table_cache(), read_options, soptions,
                                  cfd_->internal_comparator(),
                                  cfd_->internal_stats()->GetFileReadHist(level),
-                                 false /* for_compaction */, level);
+                                 false /* for_compaction */, level,
+                                 range_del_agg);  // Shichao
       mem = arena->AllocateAligned(sizeof(LevelFileNumIterator));
       auto* first_level_iter = new (mem) LevelFileNumIterator(
           cfd_->internal_comparator(), &storage_info_.LevelFilesBrief(level));
@@ -946,6 +1003,8 @@ Version::Version(ColumnFamilyData* column_family_data, VersionSet* vset,
       db_statistics_((cfd_ == nullptr) ? nullptr
                                        : cfd_->ioptions()->statistics),
       table_cache_((cfd_ == nullptr) ? nullptr : cfd_->table_cache()),
+      merge_operator_((cfd_ == nullptr) ? nullptr
+                                        : cfd_->ioptions()->merge_operator),
       storage_info_((cfd_ == nullptr) ? nullptr : &cfd_->internal_comparator(),
                     (cfd_ == nullptr) ? nullptr : cfd_->user_comparator(),
                     cfd_ == nullptr ? 0 : cfd_->NumberLevels(),
@@ -961,20 +1020,33 @@ Version::Version(ColumnFamilyData* column_family_data, VersionSet* vset,
       version_number_(version_number) {}
 
 void Version::Get(const ReadOptions& read_options, const LookupKey& k,
-                  std::string* value, Status* status, bool* value_found,
-                  bool* key_exists, SequenceNumber* seq) {
+                  std::string* value, Status* status,
+                  MergeContext* merge_context, bool* value_found,
+                  bool* key_exists, SequenceNumber* seq,
+                  SequenceNumber* max_covering_tombstone_seq) {
   Slice ikey = k.internal_key();
   Slice user_key = k.user_key();
 
-  assert(status->ok());
+  assert(status->ok() || status->IsMergeInProgress());
 
   if (key_exists != nullptr) {
     // will falsify below if not found
     *key_exists = true;
   }
 
-  GetContext get_context(user_comparator(), GetContext::kNotFound, user_key,
-                         value, value_found, seq);
+  /***************************** Shichao ******************************/
+  // the tombstones of the tables are always applied
+  SequenceNumber local_max_covering_tombstone_seq = 0;
+  if (max_covering_tombstone_seq == nullptr) {
+    max_covering_tombstone_seq = &local_max_covering_tombstone_seq;
+  }
+  /***************************** Shichao ******************************/
+
+  GetContext get_context(
+      user_comparator(), merge_operator_, info_log_,
+      status->ok() ? GetContext::kNotFound : GetContext::kMerge, user_key,
+      value, value_found, merge_context, seq,
+      max_covering_tombstone_seq);  // Shichao
 
   FilePicker fp(storage_info_.files_, k, k, &storage_info_.level_files_brief_,
                 storage_info_.num_non_empty_levels_,
@@ -1011,14 +1083,41 @@ void Version::Get(const ReadOptions& read_options, const LookupKey& k,
       case GetContext::kCorrupt:
         *status = Status::Corruption("corrupted key for ", user_key);
         return;
+      case GetContext::kMerge:
+        break;
     }
     f = fp.GetNextFile();
   }
 
-  if (key_exists != nullptr) {
-    *key_exists = false;
+  if (GetContext::kMerge == get_context.State()) {
+    if (!merge_operator_) {
+      *status = Status::InvalidArgument(
+          "merge_operator is not properly initialized.");
+      return;
+    }
+    // merge_operands are in saver and we hit the beginning of the key history
+    // do a final merge of nullptr and operands;
+    if (value != nullptr) {
+      *status = MergeHelper::TimedFullMerge(
+          user_key, nullptr, merge_context->GetOperands(), merge_operator_,
+          db_statistics_, env_, info_log_, value);
+    } else {
+      *status = Status::OK();
+    }
+  } else {
+    /***************************** Shichao ******************************/
+    if (max_covering_tombstone_seq != nullptr &&
+        *max_covering_tombstone_seq > 0) {
+      // deleted by a range tombstone, which is the last write to the key
+      if (seq != nullptr && *seq == kMaxSequenceNumber) {
+        *seq = *max_covering_tombstone_seq;
+      }
+    } else if (key_exists != nullptr) {
+      *key_exists = false;
+    }
+    /***************************** Shichao ******************************/
+    *status = Status::NotFound(); // Use an empty error message for speed
   }
-  *status = Status::NotFound(); // Use an empty error message for speed
 }
 
 /******************************** Shichao ********************************/
@@ -1034,12 +1133,33 @@ void Version::RangeQuery(ReadOptions& read_options,
                 &storage_info_.file_indexer_, user_comparator(),
                 internal_comparator());
 
+  // the range tombstones of the files read are kept along with the query
+  RangeDelAggregator* range_del_agg =
+      read_options.range_query_meta != nullptr
+          ? static_cast<RangeQueryMeta*>(read_options.range_query_meta)
+                ->range_del_agg
+          : nullptr;
+  // the table iterators are pinned along with the blocks they read
+  PinnedIteratorsManager* pinned_iters_mgr =
+      read_options.range_query_meta != nullptr
+          ? static_cast<RangeQueryMeta*>(read_options.range_query_meta)
+                ->pinned_iters_mgr
+          : nullptr;
   FdWithKeyRange* f = fp.GetNextFileForRangeQuery();
   while (f != nullptr) {
-    std::unique_ptr<InternalIterator> iter(
+    InternalIterator* iter =
        table_cache_->NewIterator(read_options, vset_->env_options_,
                                  *internal_comparator(), f->fd, nullptr,
-                                 nullptr, true, nullptr, -1, false));
+                                 nullptr, true, nullptr, -1, false,
+                                 range_del_agg);
+    std::unique_ptr<InternalIterator> iter_guard;
+    if (pinned_iters_mgr != nullptr) {
+      iter->SetPinnedItersMgr(pinned_iters_mgr);
+      pinned_iters_mgr->PinIteratorIfNeeded(iter);
+    } else {
+      iter_guard.reset(iter);
+    }
+    PERF_COUNTER_ADD(range_query_table_iter_count, 1);
     *status = iter->status();
     if (!status->ok()) {
       return;
@@ -2054,10 +2174,11 @@ struct VersionSet::ManifestWriter {
 VersionSet::VersionSet(const std::string& dbname, const DBOptions* db_options,
                        const EnvOptions& storage_options, Cache* table_cache,
                        WriteBuffer* write_buffer,
-                       WriteController* write_controller)
+                       WriteController* write_controller,
+                       TableOpenState* table_open_state)
     : column_family_set_(new ColumnFamilySet(
           dbname, db_options, storage_options, table_cache,
-          write_buffer, write_controller)),
+          write_buffer, write_controller, table_open_state)),  // Shichao
       env_(db_options->env),
       dbname_(dbname),
       db_options_(db_options),
@@ -2068,6 +2189,7 @@ VersionSet::VersionSet(const std::string& dbname, const DBOptions* db_options,
       prev_log_number_(0),
       current_version_number_(0),
       manifest_file_size_(0),
+      manifest_tail_offset_(0),  // Shichao
       env_options_(storage_options),
       env_options_compactions_(env_options_) {}
 
@@ -2214,7 +2336,8 @@ Status VersionSet::LogAndApply(ColumnFamilyData* column_family_data,
       // unlimited table cache. Pre-load table handle now.
       // Need to do it out of the mutex.
       builder_guard->version_builder()->LoadTableHandlers(
-          column_family_data->internal_stats());
+          column_family_data->internal_stats(),
+          db_options_->max_file_opening_threads);  // Shichao
     }
 
     // This is fine because everything inside of this block is serialized --
@@ -2609,6 +2732,10 @@ Status VersionSet::Recover(
         have_last_sequence = true;
       }
     }
+    if (s.ok()) {
+      // a secondary instance tails the manifest from here
+      manifest_tail_offset_ = reader.LastRecordOffset() + 1;  // Shichao
+    }
   }
 
   if (s.ok()) {
@@ -2701,6 +2828,188 @@ Status VersionSet::Recover(
   return s;
 }
 
+/***************************** Shichao ******************************/
+Status VersionSet::TailManifest(
+    InstrumentedMutex* mu,
+    std::unordered_set<ColumnFamilyData*>* cfds_changed) {
+  mu->AssertHeld();
+
+  // The primary may have switched to a new manifest file, and deleted the
+  // one named by CURRENT before it is opened here, then CURRENT is read again
+  std::string manifest_filename;
+  uint64_t manifest_file_number = 0;
+  unique_ptr<SequentialFileReader> manifest_file_reader;
+  Status s;
+  while (manifest_file_reader == nullptr) {
+    std::string current;
+    Status read = ReadFileToString(env_, CurrentFileName(dbname_), &current);
+    if (!read.ok()) {
+      return read;
+    }
+    if (current.empty() || current.back() != '\n') {
+      return Status::Corruption("CURRENT file does not end with newline");
+    }
+    current.resize(current.size() - 1);
+    FileType type;
+    if (!ParseFileName(current, &manifest_file_number, &type) ||
+        type != kDescriptorFile) {
+      return Status::Corruption("CURRENT file corrupted");
+    }
+    if (current == manifest_filename) {
+      return s;  // the same file can not be opened
+    }
+    manifest_filename = current;
+
+    unique_ptr<SequentialFile> manifest_file;
+    s = env_->NewSequentialFile(dbname_ + "/" + manifest_filename,
+                                &manifest_file, env_options_);
+    if (s.ok()) {
+      manifest_file_reader.reset(
+          new SequentialFileReader(std::move(manifest_file)));
+    }
+  }
+  bool switched = manifest_file_number != manifest_file_number_;
+  uint64_t offset = switched ? 0 : manifest_tail_offset_;
+
+  // A new manifest file starts with the whole state, which is applied to
+  // empty versions.
+  std::unordered_map<uint32_t, BaseReferencedVersionBuilder*> builders;
+  if (switched) {
+    for (auto cfd : *column_family_set_) {
+      if (cfd->IsDropped()) {
+        continue;
+      }
+      Version* base = new Version(cfd, this, current_version_number_++);
+      builders.insert(
+          {cfd->GetID(), new BaseReferencedVersionBuilder(cfd, base)});
+    }
+  }
+
+  // The edits are applied to the column families only when all of them are
+  // read.
+  std::unordered_map<ColumnFamilyData*, uint64_t> log_numbers;
+  std::vector<ColumnFamilyData*> dropped;
+  bool have_next_file = false;
+  bool have_last_sequence = false;
+  bool have_prev_log_number = false;
+  uint64_t next_file = 0;
+  uint64_t last_sequence = 0;
+  uint64_t previous_log_number = 0;
+  uint64_t tail_offset = offset;
+  {
+    VersionSet::LogReporter reporter;
+    reporter.status = &s;
+    log::Reader reader(NULL, std::move(manifest_file_reader), &reporter,
+                       true /*checksum*/, offset, 0);
+    Slice record;
+    std::string scratch;
+    while (reader.ReadRecord(&record, &scratch) && s.ok()) {
+      VersionEdit edit;
+      s = edit.DecodeFrom(record);
+      if (!s.ok()) {
+        break;
+      }
+      tail_offset = reader.LastRecordOffset() + 1;
+
+      // the column families not opened are ignored, and so are the ones
+      // added by the primary after the open
+      ColumnFamilyData* cfd =
+          column_family_set_->GetColumnFamily(edit.column_family_);
+      if (cfd != nullptr && !cfd->IsDropped() &&
+          !edit.is_column_family_add_) {
+        if (edit.is_column_family_drop_) {
+          dropped.push_back(cfd);
+        } else {
+          if (edit.max_level_ >=
+              cfd->current()->storage_info()->num_levels()) {
+            s = Status::InvalidArgument(
+                "db has more levels than options.num_levels");
+            break;
+          }
+          auto builder = builders.find(cfd->GetID());
+          if (builder == builders.end()) {
+            builder = builders.insert(
+                {cfd->GetID(), new BaseReferencedVersionBuilder(cfd)}).first;
+          }
+          builder->second->version_builder()->Apply(&edit);
+          if (edit.has_log_number_) {
+            log_numbers[cfd] = edit.log_number_;
+          }
+        }
+      }
+
+      if (edit.has_prev_log_number_) {
+        previous_log_number = edit.prev_log_number_;
+        have_prev_log_number = true;
+      }
+      if (edit.has_next_file_number_) {
+        next_file = edit.next_file_number_;
+        have_next_file = true;
+      }
+      if (edit.has_last_sequence_) {
+        last_sequence = edit.last_sequence_;
+        have_last_sequence = true;
+      }
+    }
+  }
+
+  if (s.ok()) {
+    for (auto cfd : dropped) {
+      auto builder = builders.find(cfd->GetID());
+      if (builder != builders.end()) {
+        delete builder->second;
+        builders.erase(builder);
+      }
+      log_numbers.erase(cfd);
+      cfd->SetDropped();
+      if (cfd->Unref()) {
+        delete cfd;
+      }
+    }
+
+    for (auto& builder : builders) {
+      ColumnFamilyData* cfd = column_family_set_->GetColumnFamily(
+          builder.first);
+      auto* version_builder = builder.second->version_builder();
+      if (db_options_->max_open_files == -1) {
+        // unlimited table cache, the new tables are opened out of the mutex
+        mu->Unlock();
+        version_builder->LoadTableHandlers(
+            cfd->internal_stats(), db_options_->max_file_opening_threads);
+        mu->Lock();
+      }
+      Version* v = new Version(cfd, this, current_version_number_++);
+      version_builder->SaveTo(v->storage_info());
+      v->PrepareApply(*cfd->GetLatestMutableCFOptions(), true);
+      AppendVersion(cfd, v);
+      cfds_changed->insert(cfd);
+    }
+    for (auto& it : log_numbers) {
+      if (it.second > it.first->GetLogNumber()) {
+        it.first->SetLogNumber(it.second);
+      }
+    }
+
+    if (have_next_file && next_file + 1 > next_file_number_.load()) {
+      next_file_number_.store(next_file + 1);
+    }
+    if (have_last_sequence && last_sequence > LastSequence()) {
+      SetLastSequence(last_sequence);
+    }
+    if (have_prev_log_number) {
+      prev_log_number_ = previous_log_number;
+    }
+    manifest_file_number_ = manifest_file_number;
+    manifest_tail_offset_ = tail_offset;
+  }
+
+  for (auto& builder : builders) {
+    delete builder.second;
+  }
+  return s;
+}
+/***************************** Shichao ******************************/
+
 Status VersionSet::ListColumnFamilies(std::vector<std::string>* column_families,
                                       const std::string& dbname, Env* env) {
   // these are just for performance reasons, not correcntes,
@@ -3212,8 +3521,9 @@ uint64_t VersionSet::ApproximateSize(Version* v, const FdWithKeyRange& f,
 
   uint64_t result = 0;
   if (v->cfd_->internal_comparator().Compare(f.largest_key, key) <= 0) {
-    // Entire file is before "key", so just add the file size
-    result = f.fd.GetFileSize();
+    // Entire file is before "key", so just add the file size. Include the
+    // sub column files, as ApproximateOffsetOf() of column tables does.
+    result = f.fd.GetFileSizeTotal();
   } else if (v->cfd_->internal_comparator().Compare(f.smallest_key, key) > 0) {
     // Entire file is after "key", so ignore
     result = 0;
@@ -3268,7 +3578,8 @@ void VersionSet::AddLiveFiles(std::vector<FileDescriptor>* live_list) {
   }
 }
 
-InternalIterator* VersionSet::MakeInputIterator(const Compaction* c) {
+InternalIterator* VersionSet::MakeInputIterator(
+    const Compaction* c, RangeDelAggregator* range_del_agg) {
   auto cfd = c->column_family_data();
   ReadOptions read_options;
   read_options.verify_checksums =
@@ -3281,42 +3592,52 @@ InternalIterator* VersionSet::MakeInputIterator(const Compaction* c) {
   // Level-0 files have to be merged together.  For other levels,
   // we will make a concatenating iterator per level.
   // TODO(opt): use concatenating iterator for level-0 if there is no overlap
-  const size_t space = (c->level() == 0 ? c->input_levels(0)->num_files +
-                                              c->num_input_levels() - 1
-                                        : c->num_input_levels());
-  InternalIterator** list = new InternalIterator* [space];
-  size_t num = 0;
+  std::vector<InternalIterator*> list;  // Shichao
   for (size_t which = 0; which < c->num_input_levels(); which++) {
     if (c->input_levels(which)->num_files != 0) {
-      if (c->level(which) == 0) {
-        const LevelFilesBrief* flevel = c->input_levels(which);
+      /***************************** Shichao ******************************/
+      // The files a range tombstone covers entirely are skipped, then the
+      // other files of the level are merged one by one.
+      const LevelFilesBrief* flevel = c->input_levels(which);
+      std::vector<bool> covered(flevel->num_files, false);
+      bool any_covered = false;
+      if (range_del_agg != nullptr && !range_del_agg->empty()) {
+        for (size_t i = 0; i < flevel->num_files; i++) {
+          const FileMetaData* f = c->input(which, i);
+          covered[i] = range_del_agg->IsRangeCovered(
+              f->smallest.user_key(), f->largest.user_key(),
+              f->smallest_seqno, f->largest_seqno);
+          any_covered |= covered[i];
+        }
+      }
+      if (c->level(which) == 0 || any_covered) {
         for (size_t i = 0; i < flevel->num_files; i++) {
-          list[num++] = cfd->table_cache()->NewIterator(
+          if (covered[i]) {
+            continue;
+          }
+          list.push_back(cfd->table_cache()->NewIterator(
               read_options, env_options_compactions_,
               cfd->internal_comparator(), flevel->files[i].fd, nullptr,
               nullptr, /* no per level latency histogram*/
               true /* for_compaction */, nullptr /* arena */,
-              false /* skip_filters */, (int)which /* level */);
+              false /* skip_filters */, (int)which /* level */));
         }
+      /***************************** Shichao ******************************/
       } else {
         // Create concatenating iterator for the files from this level
-        list[num++] = NewTwoLevelIterator(
+        list.push_back(NewTwoLevelIterator(
             new LevelFileIteratorState(
                 cfd->table_cache(), read_options, env_options_,
                 cfd->internal_comparator(),
                 nullptr /* no per level latency histogram */,
                 true /* for_compaction */, (int)which /* level */),
             new LevelFileNumIterator(cfd->internal_comparator(),
-                                     c->input_levels(which)));
+                                     c->input_levels(which))));
       }
     }
   }
-  assert(num <= space);
-  InternalIterator* result =
-      NewMergingIterator(&c->column_family_data()->internal_comparator(), list,
-                         static_cast<int>(num));
-  delete[] list;
-  return result;
+  return NewMergingIterator(&c->column_family_data()->internal_comparator(),
+                            list.data(), static_cast<int>(list.size()));
 }
 
 // verify that the files listed in this compaction are present
@@ -30,6 +30,7 @@
 #include <memory>
 #include <set>
 #include <string>
+#include <unordered_set>  // Shichao
 #include <utility>
 #include <vector>
 
@@ -42,6 +43,7 @@
 #include "db/compaction_picker.h"
 #include "db/column_family.h"
 #include "db/log_reader.h"
+#include "db/merge_context.h"
 #include "db/file_indexer.h"
 #include "db/write_controller.h"
 #include "vidardb/env.h"
@@ -61,6 +63,7 @@ class MemTable;
 class Version;
 class VersionSet;
 class WriteBuffer;
+class TableOpenState;  // Shichao
 class MergeContext;
 class ColumnFamilyData;
 class ColumnFamilySet;
@@ -429,8 +432,20 @@ class Version {
   // Append to *iters a sequence of iterators that will
   // yield the contents of this Version when merged together.
   // REQUIRES: This version has been saved (see VersionSet::SaveTo)
+  // The range tombstones of the files opened are added to *range_del_agg,
+  // if not nullptr.
   void AddIterators(const ReadOptions&, const EnvOptions& soptions,
-                    MergeIteratorBuilder* merger_iter_builder);
+                    MergeIteratorBuilder* merger_iter_builder,
+                    RangeDelAggregator* range_del_agg = nullptr);  // Shichao
+
+  /***************************** Shichao ******************************/
+  // Whether the key range [smallest_key, largest_key] of a file, or of a
+  // level, may contain user keys between ReadOptions::iterate_lower_bound
+  // and iterate_upper_bound. The files outside are not opened by iterators.
+  bool FileOverlapsBounds(const ReadOptions& read_options,
+                          const Slice& smallest_key,
+                          const Slice& largest_key) const;
+  /***************************** Shichao ******************************/
 
   // Lookup the value for key.  If found, store it in *val and
   // return OK.  Else return a non-OK status.
@@ -446,11 +461,16 @@ class Version {
   //                      *key_exists will be set to false.
   // If seq is non-null, *seq will be set to the sequence number found
   // for the key if a key was found.
+  // If max_covering_tombstone_seq is non-null, it carries the newest range
+  // tombstone covering the key found in the memtables, and is raised by the
+  // ones of the tables; the entries older than it are deleted.
   //
   // REQUIRES: lock is not held
   void Get(const ReadOptions&, const LookupKey& key, std::string* val,
-           Status* status, bool* value_found = nullptr,
-           bool* key_exists = nullptr, SequenceNumber* seq = nullptr);
+           Status* status, MergeContext* merge_context,
+           bool* value_found = nullptr, bool* key_exists = nullptr,
+           SequenceNumber* seq = nullptr,
+           SequenceNumber* max_covering_tombstone_seq = nullptr);
 
   /**************** Shichao *******************/
   void RangeQuery(ReadOptions& read_options, const LookupRange& range,
@@ -554,6 +574,7 @@ class Version {
   Logger* info_log_;
   Statistics* db_statistics_;
   TableCache* table_cache_;
+  const MergeOperator* merge_operator_;
 
   VersionStorageInfo storage_info_;
   VersionSet* vset_;            // VersionSet to which this Version belongs
@@ -578,7 +599,8 @@ class VersionSet {
  public:
   VersionSet(const std::string& dbname, const DBOptions* db_options,
              const EnvOptions& env_options, Cache* table_cache,
-             WriteBuffer* write_buffer, WriteController* write_controller);
+             WriteBuffer* write_buffer, WriteController* write_controller,
+             TableOpenState* table_open_state = nullptr);  // Shichao
   ~VersionSet();
 
   // Apply *edit to the current version to form a new descriptor that
@@ -600,6 +622,19 @@ class VersionSet {
   Status Recover(const std::vector<ColumnFamilyDescriptor>& column_families,
                  bool read_only = false);
 
+  /***************************** Shichao ******************************/
+  // Read the edits the primary appended to the MANIFEST since Recover() or
+  // the last call, and install the new versions of the column families they
+  // change, which are added to *cfds_changed. When the primary switched to
+  // a new MANIFEST, the versions are rebuilt from it. The files of the
+  // replaced versions are not deleted. Used by the secondary instances.
+  // *mu is released while the new tables are opened, so the callers must not
+  // run two calls at the same time.
+  // REQUIRES: *mu is held on entry.
+  Status TailManifest(InstrumentedMutex* mu,
+                      std::unordered_set<ColumnFamilyData*>* cfds_changed);
+  /***************************** Shichao ******************************/
+
   // Reads a manifest file and returns a list of column families in
   // column_families.
   static Status ListColumnFamilies(std::vector<std::string>* column_families,
@@ -673,7 +708,11 @@ class VersionSet {
 
   // Create an iterator that reads over the compaction inputs for "*c".
   // The caller should delete the iterator when no longer needed.
-  InternalIterator* MakeInputIterator(const Compaction* c);
+  // The input files whose entries are all deleted by the range tombstones
+  // of *range_del_agg, if not nullptr, are skipped.
+  InternalIterator* MakeInputIterator(
+      const Compaction* c,
+      RangeDelAggregator* range_del_agg = nullptr);  // Shichao
 
   // Add all files listed in any live version to *live.
   void AddLiveFiles(std::vector<FileDescriptor>* live_list);
@@ -761,6 +800,10 @@ class VersionSet {
   // Current size of manifest file
   uint64_t manifest_file_size_;
 
+  // The offset past the last record read from the manifest file, where
+  // TailManifest() continues.
+  uint64_t manifest_tail_offset_;  // Shichao
+
   std::vector<FileMetaData*> obsolete_files_;
   std::vector<std::string> obsolete_manifests_;
 
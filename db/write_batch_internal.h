@@ -73,6 +73,13 @@ class WriteBatchInternal {
   static void Delete(WriteBatch* batch, uint32_t column_family_id,
                      const Slice& key);
 
+  static void DeleteRange(WriteBatch* batch, uint32_t column_family_id,
+                          const Slice& begin_key,
+                          const Slice& end_key);  // Shichao
+
+  static void Merge(WriteBatch* batch, uint32_t column_family_id,
+                    const Slice& key, const Slice& value);
+
   static void MarkEndPrepare(WriteBatch* batch, const Slice& xid);
 
   static void MarkCommit(WriteBatch* batch, const Slice& xid);
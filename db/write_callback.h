@@ -0,0 +1,26 @@
+// Copyright (c) 2019-present, VidarDB, Inc.  All rights reserved.
+// This source code is licensed under the BSD-style license found in the
+// LICENSE file in the root directory of this source tree. An additional grant
+// of patent rights can be found in the PATENTS file in the same directory.
+
+#pragma once
+
+#include "vidardb/status.h"
+
+namespace vidardb {
+
+class DB;
+
+class WriteCallback {
+ public:
+  virtual ~WriteCallback() {}
+
+  // Will be called while on the write thread before the write executes. If
+  // this function returns a non-OK status, the write will be aborted and this
+  // status will be returned to the caller of the write.
+  //
+  // A write with a callback is never batched with other writes.
+  virtual Status Callback(DB* db) = 0;
+};
+
+}  // namespace vidardb
@@ -280,6 +280,12 @@ size_t WriteThread::EnterAsBatchGroupLeader(
       break;
     }
 
+    if (w->callback != nullptr || leader->callback != nullptr) {
+      // Do not batch writes validated by a callback, the callback must see
+      // the DB exactly as it is right before its own write.
+      break;
+    }
+
     auto batch_size = WriteBatchInternal::ByteSize(w->batch);
     if (size + batch_size > max_size) {
       // Do not make batch too big
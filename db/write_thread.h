@@ -14,6 +14,7 @@
 #include <type_traits>
 #include <vector>
 
+#include "db/write_callback.h"
 #include "vidardb/status.h"
 #include "vidardb/types.h"
 #include "vidardb/write_batch.h"
@@ -76,6 +77,7 @@ class WriteThread {
   // Information kept for every waiting writer.
   struct Writer {
     WriteBatch* batch;
+    WriteCallback* callback;
     bool sync;
     bool disableWAL;
     bool disable_memtable;
@@ -94,6 +96,7 @@ class WriteThread {
 
     Writer()
         : batch(nullptr),
+          callback(nullptr),
           sync(false),
           disableWAL(false),
           disable_memtable(false),
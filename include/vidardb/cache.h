@@ -30,6 +30,7 @@
 namespace vidardb {
 
 class Cache;
+class MemoryAllocator;  // Shichao
 
 // Create a new cache with a fixed size capacity. The cache is sharded
 // to 2^num_shard_bits shards, by hash of the key. The total capacity
@@ -42,6 +43,14 @@ extern std::shared_ptr<Cache> NewLRUCache(size_t capacity, int num_shard_bits);
 extern std::shared_ptr<Cache> NewLRUCache(size_t capacity, int num_shard_bits,
                                           bool strict_capacity_limit);
 
+/***************************** Shichao ******************************/
+// Like above, the uncompressed data blocks cached by the tables are allocated
+// from memory_allocator, e.g. NewHugePageMemoryAllocator().
+extern std::shared_ptr<Cache> NewLRUCache(
+    size_t capacity, int num_shard_bits, bool strict_capacity_limit,
+    std::shared_ptr<MemoryAllocator> memory_allocator);
+/***************************** Shichao ******************************/
+
 class Cache {
  public:
   Cache() {}
@@ -147,6 +156,11 @@ class Cache {
   // Prerequisit: no entry is referenced.
   virtual void EraseUnRefEntries() = 0;
 
+  /***************************** Shichao ******************************/
+  // The allocator of the cached block contents, nullptr for the heap.
+  virtual MemoryAllocator* memory_allocator() const { return nullptr; }
+  /***************************** Shichao ******************************/
+
  private:
   void LRU_Remove(Handle* e);
   void LRU_Append(Handle* e);
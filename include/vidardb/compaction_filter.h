@@ -0,0 +1,109 @@
+//  Copyright (c) 2020-present, VidarDB, Inc.  All rights reserved.
+//  This source code is licensed under the BSD-style license found in the
+//  LICENSE file in the root directory of this source tree. An additional grant
+//  of patent rights can be found in the PATENTS file in the same directory.
+//
+//  Copyright (c) 2011-present, Facebook, Inc.  All rights reserved.
+//  This source code is licensed under the BSD-style license found in the
+//  LICENSE file in the root directory of this source tree. An additional grant
+//  of patent rights can be found in the PATENTS file in the same directory.
+//
+// Copyright (c) 2011 The LevelDB Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file. See the AUTHORS file for names of contributors.
+
+#pragma once
+
+#include <stdint.h>
+#include <memory>
+#include <string>
+
+#include "vidardb/slice.h"
+
+namespace vidardb {
+
+class Env;
+
+// CompactionFilter allows an application to modify/delete a key-value at
+// the time of compaction. The memtable flush does not call it.
+
+class CompactionFilter {
+ public:
+  // Context information of a compaction run
+  struct Context {
+    // Does this compaction run include all data files
+    bool is_full_compaction;
+    // Is this compaction requested by the client (true),
+    // or is it occurring as an automatic compaction process
+    bool is_manual_compaction;
+    // Which column family this compaction is for.
+    uint32_t column_family_id;
+  };
+
+  virtual ~CompactionFilter() {}
+
+  // The compaction process invokes this method for the newest version of
+  // each key-value that is not protected by a snapshot, except in the
+  // column-aware mode below. The value is the whole row, as stitched by
+  // Options::splitter.
+  //
+  // Return true if the key-value should be removed, it is then replaced by
+  // a deletion marker. Return false and set *value_changed to true with the
+  // new row in *new_value to modify the value.
+  //
+  // If multithreaded compaction is being used *and* a single CompactionFilter
+  // instance was supplied via Options::compaction_filter, this method may be
+  // called from different threads concurrently. The application must ensure
+  // that the call is thread-safe.
+  virtual bool Filter(int level, const Slice& key, const Slice& existing_value,
+                      std::string* new_value, bool* value_changed) const {
+    return false;
+  }
+
+  /***************************** Shichao ******************************/
+  // A column-aware filter returns the column it decides on, numbered like
+  // ReadOptions::columns from 1. The row is then split by Options::splitter
+  // and FilterColumn() is called with that column alone instead of Filter(),
+  // so neither the filter nor the compaction stitches or copies the row.
+  // A row without the column is kept.
+  // Default: 0, Filter() sees the whole row
+  virtual uint32_t FilteredColumn() const { return 0; }
+
+  // Return true if the row of the key should be removed, see Filter().
+  virtual bool FilterColumn(int level, const Slice& key,
+                            const Slice& column_value) const {
+    return false;
+  }
+  /***************************** Shichao ******************************/
+
+  // Returns a name that identifies this compaction filter.
+  // The name will be printed to LOG file on start up for diagnosis.
+  virtual const char* Name() const = 0;
+};
+
+// Each compaction will create a new CompactionFilter allowing the
+// application to know about different compactions
+class CompactionFilterFactory {
+ public:
+  virtual ~CompactionFilterFactory() {}
+
+  virtual std::unique_ptr<CompactionFilter> CreateCompactionFilter(
+      const CompactionFilter::Context& context) = 0;
+
+  // Returns a name that identifies this compaction filter factory.
+  virtual const char* Name() const = 0;
+};
+
+/***************************** Shichao ******************************/
+// Return a factory of column-aware filters dropping the rows whose timestamp
+// column has expired, which is a decimal number of seconds since the epoch
+// like the ones of time(). A row expires ttl_seconds after its timestamp;
+// the current time is taken once at the start of each compaction from env,
+// Env::Default() if nullptr. The rows with a malformed timestamp are kept.
+// Expired rows may still be returned by reads until a compaction covers
+// them.
+extern CompactionFilterFactory* NewTTLCompactionFilterFactory(
+    uint32_t timestamp_column, uint64_t ttl_seconds, Env* env = nullptr);
+/***************************** Shichao ******************************/
+
+}  // namespace vidardb
@@ -7,8 +7,25 @@
 #include <stddef.h>
 #include <stdint.h>
 #include <string>
+#include <vector>
 
 namespace vidardb {
+// Statistics of one key range of a compaction that ran in parallel with the
+// other ranges (see DBOptions::max_subcompactions).
+struct SubcompactionJobStats {
+  // the approximate input size planned for this subcompaction in bytes,
+  // including the sub column files of column tables.
+  uint64_t approx_input_bytes = 0;
+  // the elapsed time in micro of this subcompaction.
+  uint64_t elapsed_micros = 0;
+  // the number of input and output records of this subcompaction.
+  uint64_t num_input_records = 0;
+  uint64_t num_output_records = 0;
+  // the number of output files and their total size in bytes.
+  size_t num_output_files = 0;
+  uint64_t total_output_bytes = 0;
+};
+
 struct CompactionJobStats {
   CompactionJobStats() { Reset(); }
   void Reset();
@@ -17,6 +34,9 @@ struct CompactionJobStats {
 
   // the elapsed time in micro of this compaction.
   uint64_t elapsed_micros;
+  // the CPU time in micro of the threads running this compaction, 0 if the
+  // Env can not tell (see Env::NowCPUNanos()).
+  uint64_t cpu_micros;
 
   // the number of compaction input records.
   uint64_t num_input_records;
@@ -81,5 +101,8 @@ struct CompactionJobStats {
 
   std::string smallest_output_key_prefix;
   std::string largest_output_key_prefix;
+
+  // one entry per subcompaction, in increasing key-range order.
+  std::vector<SubcompactionJobStats> subcompactions;
 };
 }  // namespace vidardb
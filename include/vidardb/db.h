@@ -104,6 +104,32 @@ struct RangeQueryKeyVal {
   std::string user_key;
   std::string user_val;
 
+  /***************************** Shichao ******************************/
+  // With ReadOptions::pin_data, a value RangeQuery reads as is from a table
+  // block is not copied and user_val is left EMPTY: pinned_val references it
+  // in the block, which stays pinned as long as pin is held. The pins of a
+  // batch are released with its last RangeQueryKeyVal, before the DB is
+  // closed. Read the values through value(), which returns them either way.
+  Slice pinned_val;
+  std::shared_ptr<Cleanable> pin;
+
+  Slice value() const { return pin ? pinned_val : Slice(user_val); }
+
+  // Copy val to user_val, dropping the pin.
+  void SetValue(const Slice& val) {
+    user_val.assign(val.data(), val.size());
+    pinned_val = Slice();
+    pin.reset();
+  }
+
+  // Reference val in a block pinned by p.
+  void PinValue(const Slice& val, const std::shared_ptr<Cleanable>& p) {
+    user_val.clear();
+    pinned_val = val;
+    pin = p;
+  }
+  /***************************** Shichao ******************************/
+
   RangeQueryKeyVal(const std::string& key, const std::string& val) :
                    user_key(key), user_val(val) { }
 
@@ -111,21 +137,27 @@ struct RangeQueryKeyVal {
                    user_key(std::move(key)), user_val(std::move(val)) { }
 
   RangeQueryKeyVal(const RangeQueryKeyVal& kv) :
-                   user_key(kv.user_key), user_val(kv.user_val) { }
+                   user_key(kv.user_key), user_val(kv.user_val),
+                   pinned_val(kv.pinned_val), pin(kv.pin) { }
 
   RangeQueryKeyVal(RangeQueryKeyVal&& kv) :
                    user_key(std::move(kv.user_key)),
-                   user_val(std::move(kv.user_val)) { }
+                   user_val(std::move(kv.user_val)),
+                   pinned_val(kv.pinned_val), pin(std::move(kv.pin)) { }
 
   RangeQueryKeyVal& operator=(const RangeQueryKeyVal& kv) {
     user_key = kv.user_key;
     user_val = kv.user_val;
+    pinned_val = kv.pinned_val;  // Shichao
+    pin = kv.pin;                // Shichao
     return *this;
   }
 
   RangeQueryKeyVal& operator=(RangeQueryKeyVal&& kv) {
     user_key = std::move(kv.user_key);
     user_val = std::move(kv.user_val);
+    pinned_val = kv.pinned_val;  // Shichao
+    pin = std::move(kv.pin);     // Shichao
     return *this;
   }
 };
@@ -177,6 +209,36 @@ class DB {
       std::vector<ColumnFamilyHandle*>* handles, DB** dbptr,
       bool error_if_log_file_exist = false);
 
+  /***************************** Shichao ******************************/
+  // Open the database as a secondary instance of the primary writing in
+  // name, e.g. from another process of the same host. Like a read only
+  // instance it does not modify the database, but TryCatchUpWithPrimary()
+  // replays what the primary has written since. The instance keeps its own
+  // table cache, and its own block cache as long as options do not share
+  // the table factory of the primary. Its info log is written in
+  // secondary_path rather than in name.
+  //
+  // The primary deletes the files of its obsolete versions, so the reads of
+  // a secondary instance which has not caught up for long may fail, with
+  // max_open_files = -1 less likely, since the tables are opened as soon as
+  // they are seen.
+  //
+  // Not supported in VIDARDB_LITE, in which case the function will
+  // return Status::NotSupported.
+  static Status OpenAsSecondary(const Options& options,
+                                const std::string& name,
+                                const std::string& secondary_path,
+                                DB** dbptr);
+
+  // Open the database as a secondary instance with column families, of
+  // which a subset can be opened as for a read only instance.
+  static Status OpenAsSecondary(
+      const DBOptions& db_options, const std::string& name,
+      const std::string& secondary_path,
+      const std::vector<ColumnFamilyDescriptor>& column_families,
+      std::vector<ColumnFamilyHandle*>* handles, DB** dbptr);
+  /***************************** Shichao ******************************/
+
   // Open DB with column families.
   // db_options specify database specific options
   // column_families is the vector of all column families in the database,
@@ -238,6 +300,35 @@ class DB {
     return Delete(options, DefaultColumnFamily(), key);
   }
 
+  /***************************** Shichao ******************************/
+  // Remove the database entries (if any) for the keys in [begin_key,
+  // end_key) with a single range tombstone, so the cost does not depend on
+  // the number of keys. Returns OK on success, and a non-OK status on error.
+  // It is not an error if no key exists in the range.
+  // Note: consider setting options.sync = true.
+  virtual Status DeleteRange(const WriteOptions& options,
+                             ColumnFamilyHandle* column_family,
+                             const Slice& begin_key, const Slice& end_key) {
+    return Status::NotSupported("DeleteRange() is not implemented.");
+  }
+  virtual Status DeleteRange(const WriteOptions& options,
+                             const Slice& begin_key, const Slice& end_key) {
+    return DeleteRange(options, DefaultColumnFamily(), begin_key, end_key);
+  }
+  /***************************** Shichao ******************************/
+
+  // Merge the database entry for "key" with "value".  Returns OK on success,
+  // and a non-OK status on error. The semantics of this operation is
+  // determined by the user provided merge_operator when opening DB.
+  // Note: consider setting options.sync = true.
+  virtual Status Merge(const WriteOptions& options,
+                       ColumnFamilyHandle* column_family, const Slice& key,
+                       const Slice& value) = 0;
+  virtual Status Merge(const WriteOptions& options, const Slice& key,
+                       const Slice& value) {
+    return Merge(options, DefaultColumnFamily(), key, value);
+  }
+
   // Apply the specified updates to the database.
   // If `updates` contains no update, WAL will still be synced if
   // options.sync=true.
@@ -458,6 +549,16 @@ class DB {
     //      one but only returns the aggregated table properties of the
     //      specified level "N" at the target column family.
     static const std::string kAggregatedTablePropertiesAtLevel;
+
+    //  "vidardb.range-query-stats" - returns a string with the cumulative
+    //      range query stats of the database: batches, keys and bytes
+    //      returned, and the rows trimmed by ReadOptions::batch_capacity.
+    static const std::string kRangeQueryStats;
+
+    //  "vidardb.sampled-perf-stats" - returns a multi-line string with the
+    //      latency breakdown of the operations sampled by
+    //      DBOptions::perf_sample_rate, per operation type.
+    static const std::string kSampledPerfStats;
   };
 #endif /* VIDARDB_LITE */
 
@@ -679,6 +780,16 @@ class DB {
   // The sequence number of the most recent transaction.
   virtual SequenceNumber GetLatestSequenceNumber() const = 0;
 
+  /***************************** Shichao ******************************/
+  // Make a secondary instance see the MANIFEST edits and the WAL records
+  // the primary has written since the open or the last call. The reads
+  // started before see the data as it was. Only supported by the instances
+  // of OpenAsSecondary().
+  virtual Status TryCatchUpWithPrimary() {
+    return Status::NotSupported("Supported only by secondary instances.");
+  }
+  /***************************** Shichao ******************************/
+
 #ifndef VIDARDB_LITE
 
   // Prevent file deletions. Compactions will continue to occur,
@@ -713,6 +824,9 @@ class DB {
   // you still need to call GetSortedWalFiles after GetLiveFiles to compensate
   // for new data that arrived to already-flushed column families while other
   // column families were flushing
+  //
+  // The sub-column files of the column tables, e.g. /000007.sst_1, are listed
+  // along with their table files.
   virtual Status GetLiveFiles(std::vector<std::string>&,
                               uint64_t* manifest_file_size,
                               bool flush_memtable = true) = 0;
@@ -257,7 +257,8 @@ class Env {
   enum IOPriority {
     IO_LOW = 0,
     IO_HIGH = 1,
-    IO_TOTAL = 2
+    IO_TOTAL = 2,
+    IO_USER = 3  // Shichao, reads of user scans, after IO_TOTAL to keep it 2
   };
 
   // Arrange to run "(*function)(arg)" once in a background thread, in
@@ -313,6 +314,13 @@ class Env {
     return NowMicros() * 1000;
   }
 
+  /***************************** Shichao ******************************/
+  // Returns the CPU time used by the calling thread in nano-seconds, or 0 if
+  // the platform can not tell. Only useful for computing deltas of time in
+  // the same thread.
+  virtual uint64_t NowCPUNanos() { return 0; }
+  /***************************** Shichao ******************************/
+
   // Sleep/delay the thread for the perscribed number of micro-seconds.
   virtual void SleepForMicroseconds(int micros) = 0;
 
@@ -922,6 +930,7 @@ class EnvWrapper : public Env {
     return target_->NewLogger(fname, result);
   }
   uint64_t NowMicros() override { return target_->NowMicros(); }
+  uint64_t NowCPUNanos() override { return target_->NowCPUNanos(); }  // Shichao
   void SleepForMicroseconds(int micros) override {
     target_->SleepForMicroseconds(micros);
   }
@@ -35,6 +35,14 @@ struct ImmutableCFOptions {
 
   const Splitter* splitter;
 
+  const MergeOperator* merge_operator;
+
+  /***************************** Shichao ******************************/
+  const CompactionFilter* compaction_filter;
+
+  CompactionFilterFactory* compaction_filter_factory;
+  /***************************** Shichao ******************************/
+
   Logger* info_log;
 
   Statistics* statistics;
@@ -43,6 +51,8 @@ struct ImmutableCFOptions {
 
   Env* env;
 
+  RateLimiter* rate_limiter;  // Shichao
+
   uint64_t delayed_write_rate;
 
   // Allow the OS to mmap file for reading sst tables. Default: false
@@ -55,6 +65,8 @@ struct ImmutableCFOptions {
 
   MemTableRepFactory* memtable_factory;
 
+  const SliceTransform* prefix_extractor;  // Shichao
+
   TableFactory* table_factory;
 
   Options::TablePropertiesCollectorFactories
@@ -0,0 +1,55 @@
+// Copyright (c) 2019-present, VidarDB, Inc.  All rights reserved.
+// This source code is licensed under the BSD-style license found in the
+// LICENSE file in the root directory of this source tree. An additional grant
+// of patent rights can be found in the PATENTS file in the same directory.
+//
+// A MemoryAllocator provides the memory of the block cache contents, i.e. the
+// uncompressed data blocks read from the table files. It is attached to a
+// cache at creation, see NewLRUCache(), and must outlive it.
+
+#ifndef STORAGE_VIDARDB_INCLUDE_MEMORY_ALLOCATOR_H_
+#define STORAGE_VIDARDB_INCLUDE_MEMORY_ALLOCATOR_H_
+
+#include <stddef.h>
+#include <memory>
+
+namespace vidardb {
+
+class MemoryAllocator {
+ public:
+  virtual ~MemoryAllocator() {}
+
+  // Name of the allocator, for logging.
+  virtual const char* Name() const = 0;
+
+  // Allocate a buffer of at least size bytes, throw std::bad_alloc if it
+  // cannot. Thread safe.
+  virtual void* Allocate(size_t size) = 0;
+
+  // Deallocate a buffer returned by Allocate(). Thread safe.
+  virtual void Deallocate(void* p) = 0;
+
+  // Returns the memory actually reserved for the buffer p of allocation_size
+  // bytes, which is charged to the cache.
+  virtual size_t UsableSize(void* p, size_t allocation_size) const {
+    return allocation_size;
+  }
+};
+
+// Create an allocator that carves the buffers from chunks backed by huge
+// pages of huge_page_size bytes, so that iterating cached blocks misses the
+// TLB less. The chunks are taken from the reserved huge pages first, e.g.
+//     sysctl -w vm.nr_hugepages=512
+// and fall back to transparent huge pages. Freed buffers are recycled by
+// size class and the chunks are only returned to the system when the
+// allocator is destroyed.
+//
+// If numa_interleave is true and the library is built with NUMA support
+// (cmake -DWITH_NUMA=ON), the chunks are interleaved across all NUMA nodes,
+// so that a cache shared by all sockets does not pile up on one of them.
+extern std::shared_ptr<MemoryAllocator> NewHugePageMemoryAllocator(
+    size_t huge_page_size = 2 << 20, bool numa_interleave = false);
+
+}  // namespace vidardb
+
+#endif  // STORAGE_VIDARDB_INCLUDE_MEMORY_ALLOCATOR_H_
@@ -28,11 +28,15 @@
 //  - HashSkipListRep: The memtable rep that is best used for keys that are
 //  structured like "prefix:suffix" where iteration within a prefix is
 //  common and iteration across different prefixes is rare. It is backed by
-//  a hash map where each bucket is a skip list.
+//  a hash map where each bucket is a skip list. The prefix is given by
+//  ColumnFamilyOptions::prefix_extractor.
 //  - VectorRep: This is backed by an unordered std::vector. On iteration, the
 // vector is sorted. It is intelligent about sorting; once the MarkReadOnly()
 // has been called, the vector will only be sorted once. It is optimized for
 // random-write-heavy workloads.
+//  - BulkLoadRep: Like VectorRep, but every writer thread appends to its own
+// buffer, and the buffers are sorted and merged in parallel once the memtable
+// is immutable. It is optimized for bulk loading with concurrent writers.
 //
 // The last four implementations are designed for situations in which
 // iteration over the entire collection is rare since doing so requires all the
@@ -52,6 +56,7 @@ class Arena;
 class MemTableAllocator;
 class LookupKey;
 class Slice;
+class SliceTransform;  // Shichao
 class Logger;
 
 typedef void* KeyHandle;
@@ -211,12 +216,20 @@ class MemTableRepFactory {
   virtual ~MemTableRepFactory() {}
   virtual MemTableRep* CreateMemTableRep(const MemTableRep::KeyComparator&,
                                          MemTableAllocator*,
+                                         const SliceTransform*,
                                          Logger* logger) = 0;
   virtual const char* Name() const = 0;
 
   // Return true if the current MemTableRep supports concurrent inserts
   // Default: false
   virtual bool IsInsertConcurrentlySupported() const { return false; }
+
+  /***************************** Shichao ******************************/
+  // Return true if the MemTableRep needs a prefix_extractor to hash the keys,
+  // the column family falls back to SkipListFactory without one.
+  // Default: false
+  virtual bool IsPrefixExtractorRequired() const { return false; }
+  /***************************** Shichao ******************************/
 };
 
 // This uses a skip list to store keys. It is the default.
@@ -232,6 +245,7 @@ class SkipListFactory : public MemTableRepFactory {
 
   virtual MemTableRep* CreateMemTableRep(const MemTableRep::KeyComparator&,
                                          MemTableAllocator*,
+                                         const SliceTransform*,
                                          Logger* logger) override;
   virtual const char* Name() const override { return "SkipListFactory"; }
 
@@ -255,13 +269,64 @@ class VectorRepFactory : public MemTableRepFactory {
   const size_t count_;
 
  public:
-  explicit VectorRepFactory(size_t count = 0) : count_(count) { printf("\nI am here\n"); }
+  explicit VectorRepFactory(size_t count = 0) : count_(count) {}
   virtual MemTableRep* CreateMemTableRep(const MemTableRep::KeyComparator&,
                                          MemTableAllocator*,
+                                         const SliceTransform*,
                                          Logger* logger) override;
   virtual const char* Name() const override {
     return "VectorRepFactory";
   }
+
+  bool IsInsertConcurrentlySupported() const override { return true; }
+};
+
+/******************************* Shichao ***********************************/
+// This creates MemTableReps for bulk loading. Writers append to per-thread
+// buffers without any ordering, so concurrent inserts do not contend. After
+// MarkReadOnly(), the buffers are sorted and merged in parallel by the first
+// read, usually the flush. Reads of a mutable memtable sort a copy of all the
+// entries each time, so it suits write-only load windows.
+//
+// Parameters:
+//   count: Number of entries reserved on initialization, split among the
+//     per-thread buffers.
+//   sort_threads: Max number of threads to sort and merge the buffers with.
+class BulkLoadRepFactory : public MemTableRepFactory {
+  const size_t count_;
+  const size_t sort_threads_;
+
+ public:
+  explicit BulkLoadRepFactory(size_t count = 0, size_t sort_threads = 4)
+      : count_(count), sort_threads_(sort_threads) {}
+  virtual MemTableRep* CreateMemTableRep(const MemTableRep::KeyComparator&,
+                                         MemTableAllocator*,
+                                         const SliceTransform*,
+                                         Logger* logger) override;
+  virtual const char* Name() const override {
+    return "BulkLoadRepFactory";
+  }
+
+  bool IsInsertConcurrentlySupported() const override { return true; }
 };
+/******************************* Shichao ***********************************/
+
+/******************************* Shichao ***********************************/
+// This factory creates memtables bucketed by the key prefix given by
+// ColumnFamilyOptions::prefix_extractor, each bucket being a skip list.
+// A point lookup or a range query whose start and limit share a prefix
+// only searches that prefix's bucket. Iterating or querying across prefixes
+// sorts all the buckets into a new skip list first, so it is expensive.
+// Without a prefix extractor, the skip list rep is used instead.
+//
+// Parameters:
+//   bucket_count: number of fixed array buckets
+//   skiplist_height: the max height of the skiplist
+//   skiplist_branching_factor: probabilistic size ratio between adjacent
+//                              link lists in the skiplist
+extern MemTableRepFactory* NewHashSkipListRepFactory(
+    size_t bucket_count = 1000000, int32_t skiplist_height = 4,
+    int32_t skiplist_branching_factor = 4);
+/******************************* Shichao ***********************************/
 #endif  // VIDARDB_LITE
 }  // namespace vidardb
@@ -0,0 +1,258 @@
+//  Copyright (c) 2019-present, VidarDB, Inc.  All rights reserved.
+//  This source code is licensed under the BSD-style license found in the
+//  LICENSE file in the root directory of this source tree. An additional grant
+//  of patent rights can be found in the PATENTS file in the same directory.
+//
+//  Copyright (c) 2011-present, Facebook, Inc.  All rights reserved.
+//  This source code is licensed under the BSD-style license found in the
+//  LICENSE file in the root directory of this source tree. An additional grant
+//  of patent rights can be found in the PATENTS file in the same directory.
+
+#ifndef STORAGE_VIDARDB_INCLUDE_MERGE_OPERATOR_H_
+#define STORAGE_VIDARDB_INCLUDE_MERGE_OPERATOR_H_
+
+#include <deque>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "vidardb/slice.h"
+#include "vidardb/splitter.h"
+
+namespace vidardb {
+
+class Logger;
+
+// The Merge Operator
+//
+// Essentially, a MergeOperator specifies the SEMANTICS of a merge, which only
+// client knows. It could be numeric addition, list append, string
+// concatenation, edit data structure, ... , anything.
+// The library, on the other hand, is concerned with the exercise of this
+// interface, at the right time (during get, iteration, range query,
+// compaction...)
+//
+// To use merge, the client needs to provide an object implementing one of
+// the following interfaces:
+//  a) AssociativeMergeOperator - for most simple semantics (always take
+//    two values, and merge them into one value, which is then put back
+//    into vidardb); numeric addition and string concatenation are examples;
+//
+//  b) MergeOperator - the generic class for all the more abstract / complex
+//    operations; one method (FullMerge) to merge a Put/Delete value with a
+//    merge operand; and another method (PartialMerge) that merges multiple
+//    operands together. this is especially useful if your key values have
+//    complex structures but you would still like to support client-specific
+//    incremental updates.
+//
+// AssociativeMergeOperator is simpler to implement. MergeOperator is simply
+// more powerful.
+//
+// When ReadOptions::columns is set, the base value and the operands are
+// projected before they are handed to the operator, so an operator used with
+// projected reads must work column by column, as ColumnPatchMergeOperator
+// does. With ColumnTable, every operand must also be a row of
+// ColumnTableOptions::column_count columns, since operands that are not
+// merged away during flush and compaction are stored like ordinary rows.
+//
+// Refer to ColumnPatchMergeOperator below for an example.
+class MergeOperator {
+ public:
+  virtual ~MergeOperator() {}
+
+  // Gives the client a way to express the read -> modify -> write semantics
+  // key:      (IN)    The key that's associated with this merge operation.
+  //                   Client could multiplex the merge operator based on it
+  //                   if the key space is partitioned and different subspaces
+  //                   refer to different types of data which have different
+  //                   merge operation semantics
+  // existing: (IN)    null indicates that the key does not exist before this op
+  // operand_list:(IN) the sequence of merge operations to apply, front() first.
+  // new_value:(OUT)   Client is responsible for filling the merge result here.
+  // The string that new_value is pointing to will be empty.
+  // logger:   (IN)    Client could use this to log errors during merge.
+  //
+  // Return true on success.
+  // All values passed in will be client-specific values. So if this method
+  // returns false, it is because client specified bad data or there was
+  // internal corruption. This will be treated as an error by the library.
+  virtual bool FullMerge(const Slice& key,
+                         const Slice* existing_value,
+                         const std::deque<std::string>& operand_list,
+                         std::string* new_value,
+                         Logger* logger) const = 0;
+
+  // This function performs merge(left_op, right_op)
+  // when both the operands are themselves merge operation types
+  // that you would have passed to a DB::Merge() call in the same order
+  // (i.e.: DB::Merge(key,left_op), followed by DB::Merge(key,right_op)).
+  //
+  // PartialMerge should combine them into a single merge operation that is
+  // saved into *new_value, and then it should return true.
+  // *new_value should be constructed such that a call to
+  // DB::Merge(key, *new_value) would yield the same result as a call
+  // to DB::Merge(key, left_op) followed by DB::Merge(key, right_op).
+  //
+  // The default implementation of PartialMergeMulti will use this function
+  // as a helper, for backward compatibility.  Any successor class of
+  // MergeOperator should either implement PartialMerge or PartialMergeMulti,
+  // although implementing PartialMergeMulti is suggested as it is in general
+  // more effective to merge multiple operands at a time instead of two
+  // operands at a time.
+  //
+  // If it is impossible or infeasible to combine the two operations,
+  // leave new_value unchanged and return false. The library will
+  // internally keep track of the operations, and apply them in the
+  // correct order once a base-value (a Put/Delete/End-of-Database) is seen.
+  virtual bool PartialMerge(const Slice& key,
+                            const Slice& left_operand,
+                            const Slice& right_operand,
+                            std::string* new_value,
+                            Logger* logger) const {
+    return false;
+  }
+
+  // This function performs merge when all the operands are themselves merge
+  // operation types that you would have passed to a DB::Merge() call in the
+  // same order (front() first)
+  // (i.e. DB::Merge(key, operand_list[0]), followed by
+  //  DB::Merge(key, operand_list[1]), ...)
+  //
+  // PartialMergeMulti should combine them into a single merge operation that
+  // is saved into *new_value, and then it should return true.  *new_value
+  // should be constructed such that a call to DB::Merge(key, *new_value)
+  // would yield the same result as subquential individual calls to DB::Merge
+  // (key, operand) for each operand in operand_list from front() to back().
+  //
+  // The PartialMergeMulti function will be called only when there are at
+  // least two operands to combine.
+  //
+  // In the default implementation, PartialMergeMulti will invoke PartialMerge
+  // multiple times, where each time it only merges two operands.  Developers
+  // should either implement PartialMergeMulti, or implement PartialMerge which
+  // is served as the helper function of the default PartialMergeMulti.
+  virtual bool PartialMergeMulti(const Slice& key,
+                                 const std::deque<Slice>& operand_list,
+                                 std::string* new_value, Logger* logger) const;
+
+  // The name of the MergeOperator. Used to check for MergeOperator
+  // mismatches (i.e., a DB created with one MergeOperator is
+  // accessed using a different MergeOperator)
+  //
+  // Names starting with "vidardb." are reserved and should not be used
+  // by any clients of this package.
+  virtual const char* Name() const = 0;
+};
+
+// The simpler, associative merge operator.
+class AssociativeMergeOperator : public MergeOperator {
+ public:
+  virtual ~AssociativeMergeOperator() {}
+
+  // Gives the client a way to express the read -> modify -> write semantics
+  // key:           (IN) The key that's associated with this merge operation.
+  // existing_value:(IN) null indicates the key does not exist before this op
+  // value:         (IN) the value to update/merge the existing_value with
+  // new_value:    (OUT) Client is responsible for filling the merge result
+  // here. The string that new_value is pointing to will be empty.
+  // logger:        (IN) Client could use this to log errors during merge.
+  //
+  // Return true on success.
+  // All values passed in will be client-specific values. So if this method
+  // returns false, it is because client specified bad data or there was
+  // internal corruption. The client should assume that this will be treated
+  // as an error by the library.
+  virtual bool Merge(const Slice& key,
+                     const Slice* existing_value,
+                     const Slice& value,
+                     std::string* new_value,
+                     Logger* logger) const = 0;
+
+ private:
+  // Default implementations of the MergeOperator functions
+  virtual bool FullMerge(const Slice& key,
+                         const Slice* existing_value,
+                         const std::deque<std::string>& operand_list,
+                         std::string* new_value,
+                         Logger* logger) const override;
+
+  virtual bool PartialMerge(const Slice& key,
+                            const Slice& left_operand,
+                            const Slice& right_operand,
+                            std::string* new_value,
+                            Logger* logger) const override;
+};
+
+// A built-in merge operator that treats values as 64-bit unsigned integers
+// in fixed-size little-endian encoding and adds the operands to them, e.g.
+// for read-modify-write counters.  A missing or malformed existing value
+// counts as 0.
+class UInt64AddOperator : public AssociativeMergeOperator {
+ public:
+  UInt64AddOperator() { }
+
+  virtual const char* Name() const override {
+    return "vidardb.UInt64AddOperator";
+  }
+
+  virtual bool Merge(const Slice& key, const Slice* existing_value,
+                     const Slice& value, std::string* new_value,
+                     Logger* logger) const override;
+};
+
+// Create a built-in uint64 add operator.
+extern std::shared_ptr<MergeOperator> NewUInt64AddOperator();
+
+// A built-in merge operator that overwrites selected columns of a row that
+// is split by a Splitter, so a single column can be updated with a blind
+// write instead of Get + Stitch + Put.
+//
+// An operand is a patch row built by EncodePatch(): it has one field for each
+// column of the row, either empty for a column left as it is, or a marker
+// byte followed by the new column value.  The patch row is itself a valid
+// row of the splitter, so it can be stored in ColumnTable and projected like
+// any other row.
+class ColumnPatchMergeOperator : public MergeOperator {
+ public:
+  // column_count is the number of value columns of the rows, i.e.
+  // ColumnTableOptions::column_count.
+  ColumnPatchMergeOperator(const std::shared_ptr<Splitter>& splitter,
+                           uint32_t column_count)
+      : splitter_(splitter), column_count_(column_count) { }
+
+  virtual const char* Name() const override {
+    return "vidardb.ColumnPatchMergeOperator";
+  }
+
+  // Encode a patch operand that sets the given columns.  Column indexes start
+  // from 1, the same as ReadOptions::columns.  Out of range indexes are
+  // ignored.
+  std::string EncodePatch(
+      const std::vector<std::pair<uint32_t, Slice>>& columns) const;
+
+  virtual bool FullMerge(const Slice& key, const Slice* existing_value,
+                         const std::deque<std::string>& operand_list,
+                         std::string* new_value,
+                         Logger* logger) const override;
+
+  virtual bool PartialMergeMulti(const Slice& key,
+                                 const std::deque<Slice>& operand_list,
+                                 std::string* new_value,
+                                 Logger* logger) const override;
+
+ private:
+  // Apply a patch row on the fields of a row.
+  bool ApplyPatch(const Slice& patch, std::vector<Slice>* fields) const;
+
+  std::shared_ptr<Splitter> splitter_;
+  const uint32_t column_count_;
+};
+
+// Create a built-in column patch merge operator.
+extern std::shared_ptr<ColumnPatchMergeOperator> NewColumnPatchMergeOperator(
+    const std::shared_ptr<Splitter>& splitter, uint32_t column_count);
+
+}  // namespace vidardb
+
+#endif  // STORAGE_VIDARDB_INCLUDE_MERGE_OPERATOR_H_
@@ -23,7 +23,10 @@
 #include <unordered_map>
 #include <vector>
 
+#include "vidardb/compaction_filter.h"  // Shichao
+#include "vidardb/env.h"  // Shichao
 #include "vidardb/listener.h"
+#include "vidardb/merge_operator.h"
 #include "vidardb/splitter.h"
 #include "vidardb/version.h"
 
@@ -38,11 +41,13 @@ class Logger;
 class Snapshot;
 class TableFactory;
 class MemTableRepFactory;
+class SliceTransform;  // Shichao
 class TablePropertiesCollectorFactory;
 class Slice;
 class Statistics;
 class InternalKeyComparator;
 class Splitter;
+class RateLimiter;  // Shichao
 
 // DB contents are stored in a set of blocks, each of which holds a
 // sequence of key,value pairs.  Each block may be compressed before
@@ -205,6 +210,47 @@ struct ColumnFamilyOptions {
   // for columnar storage.
   std::shared_ptr<Splitter> splitter;
 
+  // REQUIRES: The client must provide a merge operator if Merge operation
+  // needs to be accessed. Calling Merge on a DB without a merge operator
+  // would result in Status::NotSupported. The client must ensure that the
+  // merge operator supplied here has the same name and *exactly* the same
+  // semantics as the merge operator provided to previous open calls on
+  // the same DB. The only exception is reserved for upgrade, where a DB
+  // previously without a merge operator is introduced to Merge operation
+  // for the first time. It's necessary to specify a merge operator when
+  // opening the DB in this case.
+  // Default: nullptr
+  std::shared_ptr<MergeOperator> merge_operator;
+
+  /***************************** Shichao ******************************/
+  // A single CompactionFilter instance to call into during compaction.
+  // Allows an application to modify/delete a key-value during background
+  // compaction.
+  //
+  // If the client requires a new compaction filter to be used for different
+  // compaction runs, it can specify compaction_filter_factory instead of this
+  // option. The client should specify only one of the two.
+  // compaction_filter takes precedence over compaction_filter_factory if
+  // client specifies both.
+  //
+  // If multithreaded compaction is being used, the supplied CompactionFilter
+  // instance may be used from different threads concurrently and so should be
+  // thread-safe.
+  //
+  // Default: nullptr
+  const CompactionFilter* compaction_filter;
+
+  // This is a factory that provides compaction filter objects which allow
+  // an application to modify/delete a key-value during background compaction.
+  //
+  // A new filter will be created on each compaction run.  If multithreaded
+  // compaction is being used, each created CompactionFilter will only be used
+  // from a single thread and so does not need to be thread-safe.
+  //
+  // Default: nullptr
+  std::shared_ptr<CompactionFilterFactory> compaction_filter_factory;
+  /***************************** Shichao ******************************/
+
   // -------------------
   // Parameters that affect performance
 
@@ -426,6 +472,18 @@ struct ColumnFamilyOptions {
   // Dynamically changeable through SetOptions() API
   bool disable_auto_compactions;
 
+  /***************************** Shichao ******************************/
+  // The share of the background compaction work of this column family
+  // against the other column families of the DB. The automatic compactions
+  // are picked from the column family which has been served the fewest
+  // input bytes divided by its weight, so one busy column family, e.g. one
+  // converting large row tables into column tables, can not keep the
+  // compactions of the others waiting behind it. Has to be positive.
+  //
+  // Default: 1.0
+  double background_job_weight;
+  /***************************** Shichao ******************************/
+
   // The compaction style. Default: kCompactionStyleLevel
   CompactionStyle compaction_style;
 
@@ -450,6 +508,52 @@ struct ColumnFamilyOptions {
   // MemTableRep.
   std::shared_ptr<MemTableRepFactory> memtable_factory;
 
+  /***************************** Shichao ******************************/
+  // If non-nullptr, use the specified function to determine the prefixes
+  // of keys. Hash indexed memtable reps, e.g. NewHashSkipListRepFactory(),
+  // bucket the keys on it, so that point lookups and range queries within
+  // one prefix only touch one bucket. They require a prefix extractor and
+  // fall back to the skip list rep without one.
+  //
+  // Default: nullptr
+  std::shared_ptr<const SliceTransform> prefix_extractor;
+
+  // If > 0, each memtable keeps a dynamic bloom filter of
+  // write_buffer_size * memtable_prefix_bloom_size_ratio bytes, filled on
+  // every insert with the prefix of the key (if prefix_extractor is set and
+  // the key is in its domain) and/or the whole key (if
+  // memtable_whole_key_filtering is true). Get() consults it before
+  // searching the memtable rep, so lookups of absent keys skip the
+  // memtables entirely. The ratio is capped at 0.25.
+  //
+  // Default: 0 (disabled)
+  //
+  // Dynamically changeable through SetOptions() API, the new value applies
+  // to the memtables created afterwards.
+  double memtable_prefix_bloom_size_ratio;
+
+  // Add the whole key to the memtable bloom filter as well, see
+  // memtable_prefix_bloom_size_ratio.
+  //
+  // Default: false
+  //
+  // Dynamically changeable through SetOptions() API
+  bool memtable_whole_key_filtering;
+
+  // Page size for huge page TLB for the memtable arena blocks and the
+  // memtable bloom filter. If <= 0, they are not allocated from huge pages.
+  // Otherwise they are taken from the huge pages reserved by
+  //     sysctl -w vm.nr_hugepages=20
+  // and fall back to malloc when none is left. See linux doc
+  // Documentation/vm/hugetlbpage.txt.
+  //
+  // Default: 0
+  //
+  // Dynamically changeable through SetOptions() API, the new value applies
+  // to the memtables created afterwards.
+  size_t memtable_huge_page_size;
+  /***************************** Shichao ******************************/
+
   // This is a factory that provides TableFactory objects.
   // Default: a block-based table factory that provides a default
   // implementation of TableBuilder and TableReader with default
@@ -534,6 +638,16 @@ struct DBOptions {
   // Default: Env::Default()
   Env* env;
 
+  /***************************** Shichao ******************************/
+  // Use to control the I/O rate of flush and compaction writes, and of the
+  // reads of user scans asking for it (see
+  // ReadOptions::rate_limiter_priority), e.g. to keep large compactions
+  // from saturating the disk. See NewGenericRateLimiter().
+  // If it is nullptr, no I/O is rate limited.
+  // Default: nullptr
+  std::shared_ptr<RateLimiter> rate_limiter;
+  /***************************** Shichao ******************************/
+
   // Use to track SST files and control their file deletion rate.
   //
   // Features:
@@ -571,6 +685,15 @@ struct DBOptions {
   // Default: 16
   int max_file_opening_threads;
 
+  /***************************** Shichao ******************************/
+  // If true, the footer and meta block reads of opening the table files are
+  // persisted in dbname/TABLE_OPEN_STATE on close and served from there by
+  // the next DB::Open, which saves a few random reads per table file and
+  // sub-column file on a warm restart.
+  // Default: false
+  bool persist_table_open_state;
+  /***************************** Shichao ******************************/
+
   // Once write-ahead logs exceed this size, we will start forcing the flush of
   // column families whose memtables are backed by the oldest live WAL file
   // (i.e. the ones that are causing all the space amplification). If set to 0
@@ -665,6 +788,17 @@ struct DBOptions {
   // Default: 1
   int max_background_compactions;
 
+  /***************************** Shichao ******************************/
+  // If positive, a compaction running for longer than this stops holding its
+  // compaction slot, so another job can be scheduled next to it, e.g. the
+  // compaction of a column family starved by a long one, or a flush when
+  // `max_background_flushes` is 0. At most twice the slots are used this
+  // way, so give the LOW priority pool the threads for them, see
+  // Env::SetBackgroundThreads. A compaction is never interrupted.
+  // Default: 0 (disabled)
+  uint64_t background_time_slice_micros;
+  /***************************** Shichao ******************************/
+
   // This value represents the maximum number of threads that will
   // concurrently perform a compaction job by breaking it into multiple,
   // smaller ones that are run simultaneously.
@@ -782,6 +916,16 @@ struct DBOptions {
   // Default: 600 (10 min)
   unsigned int stats_dump_period_sec;
 
+  // If not zero, 1 in perf_sample_rate Get, RangeQuery, Write and iterator
+  // Seek/Next operations are profiled with PerfContext and IOStatsContext at
+  // PerfLevel::kEnableTime, and the time spent in memtables, table files,
+  // block reads, file IO and the DB mutex is aggregated into per-operation
+  // histograms. They are dumped to LOG together with vidardb.stats and are
+  // available through the "vidardb.sampled-perf-stats" property. The other
+  // operations pay a single random number check.
+  // Default: 0 (disabled)
+  uint32_t perf_sample_rate;
+
   // If set true, will hint the underlying file system that the file
   // access pattern is random, when a sst file is opened.
   // Default: true
@@ -946,6 +1090,8 @@ struct DBOptions {
   bool allow_2pc = false;
 
   // A global cache for table-level rows.
+  // The rows are cached per column, so the point reads projecting
+  // ReadOptions::columns share them and only read the columns not cached.
   // Default: nullptr (disabled)
   // Not supported in VIDARDB_LITE mode!
   std::shared_ptr<Cache> row_cache;
@@ -1067,6 +1213,8 @@ struct ReadOptions {
   // BlockBasedTableOptions::use_delta_encoding = false,
   // Iterator's property "vidardb.iterator.is-key-pinned" is guaranteed to
   // return 1.
+  // RangeQuery keeps the table blocks it reads pinned instead, as long as the
+  // results of the batch reference them, see RangeQueryKeyVal::value().
   // Default: false
   bool pin_data;
 
@@ -1100,6 +1248,31 @@ struct ReadOptions {
   size_t result_val_size;
   /***************************** Quanzhao *********************************/
 
+  /***************************** Shichao ******************************/
+  // The priority the table file reads of this request are charged to in
+  // DBOptions::rate_limiter. Set it to Env::IO_USER to throttle a large
+  // RangeQuery or iterator scan, Env::IO_TOTAL means not rate limited.
+  // Default: Env::IO_TOTAL
+  Env::IOPriority rate_limiter_priority;
+
+  // "iterate_upper_bound" defines the extent upto which the forward iterator
+  // can returns entries. Once the bound is reached, Valid() will be false.
+  // "iterate_upper_bound" is exclusive ie the bound value is
+  // not a valid entry. The table files and data blocks entirely beyond the
+  // bound are not read. The Slice it points to must outlive the iterator.
+  // Only iterators honor the bounds, leave them nullptr for RangeQuery.
+  // Default: nullptr
+  const Slice* iterate_upper_bound;
+
+  // "iterate_lower_bound" defines the smallest key the iterator returns.
+  // It is inclusive, Seek() and SeekToFirst() start from it and the backward
+  // iterator becomes invalid before it. The table files and data blocks
+  // entirely before the bound are not read. The Slice it points to must
+  // outlive the iterator.
+  // Default: nullptr
+  const Slice* iterate_lower_bound;
+  /***************************** Shichao ******************************/
+
   ReadOptions();
   ReadOptions(bool cksum, bool cache);
 };
@@ -1169,6 +1342,20 @@ struct CompactionOptions {
 };
 
 // CompactRangeOptions is used by CompactRange() call.
+/***************************** Shichao ******************************/
+// For level based compaction, we can configure if we want to skip/force
+// bottommost level compaction.
+enum class BottommostLevelCompaction {
+  // Skip bottommost level compaction
+  kSkip,
+  // Only compact bottommost level if there is a compaction filter
+  // This is the default option
+  kIfHaveCompactionFilter,
+  // Always compact bottommost level
+  kForce,
+};
+/***************************** Shichao ******************************/
+
 struct CompactRangeOptions {
   // If true, no other compaction will run at the same time as this
   // manual compaction
@@ -1182,6 +1369,10 @@ struct CompactRangeOptions {
   // Compaction outputs will be placed in options.db_paths[target_path_id].
   // Behavior is undefined if target_path_id is out of range.
   uint32_t target_path_id = 0;
+  // By default level based compaction will only compact the bottommost level
+  // if there is a compaction filter
+  BottommostLevelCompaction bottommost_level_compaction =
+      BottommostLevelCompaction::kIfHaveCompactionFilter;  // Shichao
 };
 
 }  // namespace vidardb
@@ -113,6 +113,40 @@ struct PerfContext {
   uint64_t bloom_sst_hit_count;
   // total number of SST table bloom misses
   uint64_t bloom_sst_miss_count;
+
+  /***************************** Shichao ******************************/
+  // total number of range query batches, i.e. calls of DB::RangeQuery()
+  uint64_t range_query_count;
+  // total nanos spent on range querying the active memtable
+  uint64_t range_query_memtable_time;
+  // total nanos spent on range querying the immutable memtables
+  uint64_t range_query_immutable_time;
+  // total nanos spent on range querying the table files
+  uint64_t range_query_sst_time;
+  // total nanos spent after the lookups of a batch, i.e. resolving merged
+  // keys and dropping the deleted or shadowed keys from the result
+  uint64_t range_query_post_process_time;
+  // total nanos spent on trimming the result to ReadOptions::batch_capacity
+  uint64_t range_query_trim_time;
+  // total number of rows dropped by the batch trimming, which are queried
+  // again by the next batch
+  uint64_t range_query_trimmed_count;
+  // total number of table iterators created by range queries
+  uint64_t range_query_table_iter_count;
+  // total number of sub-column data blocks read from ColumnTable files
+  uint64_t column_block_read_count;
+  // total number of bytes of sub-column data blocks read
+  uint64_t column_block_read_byte;
+  // total number of sub-columns opened by ColumnTable iterators, which only
+  // open the columns in ReadOptions::columns
+  uint64_t column_projected_count;
+  // total number of sub-columns of the tables that iterators are opened on
+  uint64_t column_total_count;
+  // total nanos spent on splitting user values into columns
+  uint64_t splitter_split_time;
+  // total nanos spent on stitching columns into user values
+  uint64_t splitter_stitch_time;
+  /***************************** Shichao ******************************/
 };
 
 #if defined(NPERF_CONTEXT) || defined(IOS_CROSS_COMPILE)
@@ -0,0 +1,82 @@
+//  Copyright (c) 2020-present, VidarDB, Inc.  All rights reserved.
+//  This source code is licensed under the BSD-style license found in the
+//  LICENSE file in the root directory of this source tree. An additional grant
+//  of patent rights can be found in the PATENTS file in the same directory.
+//
+//  Copyright (c) 2011-present, Facebook, Inc.  All rights reserved.
+//  This source code is licensed under the BSD-style license found in the
+//  LICENSE file in the root directory of this source tree. An additional grant
+//  of patent rights can be found in the PATENTS file in the same directory.
+
+#pragma once
+
+#include "vidardb/env.h"
+
+namespace vidardb {
+
+class Statistics;
+
+// A RateLimiter limits the bytes per second of the table file I/O of a DB,
+// see DBOptions::rate_limiter. Each request is charged to an Env::IOPriority:
+//   IO_HIGH: flush writes, see Env::IO_HIGH
+//   IO_USER: reads of user scans, see ReadOptions::rate_limiter_priority
+//   IO_LOW:  compaction writes
+// A RateLimiter implementation must be thread-safe.
+class RateLimiter {
+ public:
+  virtual ~RateLimiter() {}
+
+  // This API allows user to dynamically change rate limiter's bytes per second.
+  // REQUIRED: bytes_per_second > 0
+  virtual void SetBytesPerSecond(int64_t bytes_per_second) = 0;
+
+  // Request for token to write bytes. If this request can not be satisfied,
+  // the call is blocked. Caller is responsible to make sure
+  // bytes <= GetSingleBurstBytes(). The time the call is blocked is added to
+  // the ticker of pri in stats, if stats is not nullptr.
+  virtual void Request(const int64_t bytes, const Env::IOPriority pri,
+                       Statistics* stats) = 0;
+
+  // Max bytes can be granted in a single burst
+  virtual int64_t GetSingleBurstBytes() const = 0;
+
+  // Total bytes that go though rate limiter
+  virtual int64_t GetTotalBytesThrough(
+      const Env::IOPriority pri = Env::IO_TOTAL) const = 0;
+
+  // Total # of requests that go though rate limiter
+  virtual int64_t GetTotalRequests(
+      const Env::IOPriority pri = Env::IO_TOTAL) const = 0;
+
+  virtual int64_t GetBytesPerSecond() const = 0;
+
+  // Called by the DB whenever the estimated bytes of pending compaction
+  // change. An auto-tuned limiter adjusts its rate to them, others ignore it.
+  virtual void Tune(uint64_t pending_compaction_bytes) {}
+};
+
+// Create a RateLimiter object, which can be shared among VidarDB instances to
+// control write rate of flush and compaction, and read rate of user scans.
+// @rate_bytes_per_sec: this is the only parameter you want to set most of the
+// time. It controls the total rate of the requests of all priorities. Flushes
+// are served first, then user scans, then compactions.
+// @refill_period_us: this controls how often tokens are refilled. For example,
+// when rate_bytes_per_sec is set to 10MB/s and refill_period_us is set to
+// 100ms, then 1MB is refilled every 100ms internally. Larger value can lead to
+// burstier writes while smaller value introduces more CPU overhead.
+// The default should work for most cases.
+// @fairness: a lower priority is served before the higher ones with a chance
+// of 1/fairness, so compactions are not starved by a steady stream of flushes
+// and scans. The default should work for most cases.
+// @auto_tuned: if true, rate_bytes_per_sec is the upper bound of the rate,
+// which follows the pending compaction bytes reported by Tune(): the rate is
+// rate_bytes_per_sec / 20 with no compaction debt and grows linearly to
+// rate_bytes_per_sec at auto_tune_pending_bytes of debt. An idle DB then
+// leaves most of the disk bandwidth to the user reads, while a DB falling
+// behind compacts at full speed before it stalls the writes.
+extern RateLimiter* NewGenericRateLimiter(
+    int64_t rate_bytes_per_sec, int64_t refill_period_us = 100 * 1000,
+    int32_t fairness = 10, bool auto_tuned = false,
+    uint64_t auto_tune_pending_bytes = 64ull << 30);
+
+}  // namespace vidardb
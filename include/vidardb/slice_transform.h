@@ -0,0 +1,71 @@
+//  Copyright (c) 2019-present, VidarDB, Inc.  All rights reserved.
+//  This source code is licensed under the BSD-style license found in the
+//  LICENSE file in the root directory of this source tree. An additional grant
+//  of patent rights can be found in the PATENTS file in the same directory.
+//
+//  Copyright (c) 2011-present, Facebook, Inc.  All rights reserved.
+//  This source code is licensed under the BSD-style license found in the
+//  LICENSE file in the root directory of this source tree. An additional grant
+//  of patent rights can be found in the PATENTS file in the same directory.
+//
+// Copyright (c) 2012 The LevelDB Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file. See the AUTHORS file for names of contributors.
+//
+// Class for specifying user-defined functions which perform a
+// transformation on a slice.  It is not required that every slice
+// belong to the domain and/or range of a function.  Subclasses should
+// define InDomain and InRange to determine which slices are in either
+// of these sets respectively.
+
+#ifndef STORAGE_VIDARDB_INCLUDE_SLICE_TRANSFORM_H_
+#define STORAGE_VIDARDB_INCLUDE_SLICE_TRANSFORM_H_
+
+#include <string>
+
+namespace vidardb {
+
+class Slice;
+
+class SliceTransform {
+ public:
+  virtual ~SliceTransform() {};
+
+  // Return the name of this transformation.
+  virtual const char* Name() const = 0;
+
+  // Extract a prefix from a specified key. This method is called when
+  // a key is inserted into the memtable, and the returned prefix is used
+  // to pick its bucket in a hash indexed memtable rep.
+  //
+  // REQUIRES: InDomain(key) is true.
+  virtual Slice Transform(const Slice& key) const = 0;
+
+  // Determine whether the specified key is compatible with the logic
+  // specified in the Transform method. Keys out of the domain are hashed
+  // on the whole key instead.
+  //
+  // If the prefix extractor is used together with a comparator other than
+  // BytewiseComparator, all the keys sharing a prefix have to be adjacent
+  // in the comparator order, and every key between two keys sharing a
+  // prefix has to share it too, otherwise prefix range queries on a hash
+  // indexed memtable rep return wrong results.
+  virtual bool InDomain(const Slice& key) const = 0;
+
+  // This is currently not used and remains here for backward compatibility.
+  virtual bool InRange(const Slice& dst) const { return false; }
+};
+
+// Prefix of the first prefix_len bytes, keys shorter than that are out of
+// the domain.
+extern const SliceTransform* NewFixedPrefixTransform(size_t prefix_len);
+
+// Prefix of at most the first cap_len bytes, every key is in the domain.
+extern const SliceTransform* NewCappedPrefixTransform(size_t cap_len);
+
+// The whole key is the prefix.
+extern const SliceTransform* NewNoopTransform();
+
+}  // namespace vidardb
+
+#endif  // STORAGE_VIDARDB_INCLUDE_SLICE_TRANSFORM_H_
@@ -32,10 +32,18 @@ class Splitter {
   // Split a slice to multiple sub-slices.
   virtual std::vector<Slice> Split(const Slice& s) const = 0;
 
+  // Split a slice to multiple sub-slices into res, which is cleared first.
+  // The capacity of res is kept, so a caller splitting many slices can reuse
+  // one vector and avoid an allocation per slice.
+  virtual void Split(const Slice& s, std::vector<Slice>& res) const {
+    res = Split(s);
+  }
+
   // Stitch multiple sub-slices to a string.
   virtual std::string Stitch(const std::vector<Slice>& v) const = 0;
 
-  // Stitch multiple sub-slices to a slice using buf as storage.
+  // Stitch multiple sub-slices to a slice using buf as storage, which is
+  // grown at most once.
   // Note: buf must exist as long as the returned Slice exists.
   virtual Slice Stitch(const std::vector<Slice>& v, std::string& buf) const = 0;
 
@@ -53,6 +61,8 @@ class PipeSplitter : public Splitter {
 
   virtual std::vector<Slice> Split(const Slice& s) const override;
 
+  virtual void Split(const Slice& s, std::vector<Slice>& res) const override;
+
   virtual std::string Stitch(const std::vector<Slice>& v) const override;
 
   virtual Slice Stitch(const std::vector<Slice>& v,
@@ -83,6 +93,8 @@ class EncodingSplitter : public Splitter {
 
   virtual std::vector<Slice> Split(const Slice& s) const override;
 
+  virtual void Split(const Slice& s, std::vector<Slice>& res) const override;
+
   virtual std::string Stitch(const std::vector<Slice>& v) const override;
 
   virtual Slice Stitch(const std::vector<Slice>& v,
@@ -183,6 +183,38 @@ enum Tickers : uint32_t {
   ROW_CACHE_HIT,
   ROW_CACHE_MISS,
 
+  /***************************** Shichao ******************************/
+  // Number of range query batches, i.e. calls of DB::RangeQuery()
+  NUMBER_RANGE_QUERY,
+  // Number of keys and uncompressed bytes returned by range queries
+  NUMBER_RANGE_QUERY_KEYS_READ,
+  RANGE_QUERY_BYTES_READ,
+  // Number of rows dropped by the batch trimming of range queries, which
+  // are queried again by the next batch
+  RANGE_QUERY_ROWS_TRIMMED,
+  // Number and bytes of sub-column data blocks read from ColumnTable files
+  COLUMN_BLOCK_READ,
+  COLUMN_BLOCK_READ_BYTES,
+  // Number of sub-columns opened by ColumnTable iterators after projection,
+  // and the number of sub-columns of the tables they are opened on
+  COLUMNS_PROJECTED,
+  COLUMNS_TOTAL,
+  // Number of sub-column files opened by ColumnTable readers
+  COLUMN_SUB_FILE_OPENS,
+  // Number of table file reads at open served from, or missed by, the
+  // persisted table open state, see DBOptions::persist_table_open_state
+  TABLE_OPEN_STATE_HIT,
+  TABLE_OPEN_STATE_MISS,
+  // Time in microseconds the flush writes, user scan reads and compaction
+  // writes waited for DBOptions::rate_limiter
+  RATE_LIMITER_FLUSH_MICROS,
+  RATE_LIMITER_USER_MICROS,
+  RATE_LIMITER_COMPACTION_MICROS,
+  // Number of row cache lookups finding the row without some of the columns
+  // the read projects, which are read alone from the table
+  ROW_CACHE_PARTIAL_HIT,
+  /***************************** Shichao ******************************/
+
   TICKER_ENUM_MAX
 };
 
@@ -269,6 +301,21 @@ const std::vector<std::pair<Tickers, std::string>> TickersNameMap = {
     {FILTER_OPERATION_TOTAL_TIME, "vidardb.filter.operation.time.nanos"},
     {ROW_CACHE_HIT, "vidardb.row.cache.hit"},
     {ROW_CACHE_MISS, "vidardb.row.cache.miss"},
+    {NUMBER_RANGE_QUERY, "vidardb.number.range.query"},
+    {NUMBER_RANGE_QUERY_KEYS_READ, "vidardb.number.range.query.keys.read"},
+    {RANGE_QUERY_BYTES_READ, "vidardb.range.query.bytes.read"},
+    {RANGE_QUERY_ROWS_TRIMMED, "vidardb.range.query.rows.trimmed"},
+    {COLUMN_BLOCK_READ, "vidardb.column.block.read"},
+    {COLUMN_BLOCK_READ_BYTES, "vidardb.column.block.read.bytes"},
+    {COLUMNS_PROJECTED, "vidardb.columns.projected"},
+    {COLUMNS_TOTAL, "vidardb.columns.total"},
+    {COLUMN_SUB_FILE_OPENS, "vidardb.column.sub.file.opens"},
+    {TABLE_OPEN_STATE_HIT, "vidardb.table.open.state.hit"},
+    {TABLE_OPEN_STATE_MISS, "vidardb.table.open.state.miss"},
+    {RATE_LIMITER_FLUSH_MICROS, "vidardb.rate.limiter.flush.micros"},
+    {RATE_LIMITER_USER_MICROS, "vidardb.rate.limiter.user.micros"},
+    {RATE_LIMITER_COMPACTION_MICROS, "vidardb.rate.limiter.compaction.micros"},
+    {ROW_CACHE_PARTIAL_HIT, "vidardb.row.cache.partial.hit"},
 };
 
 /**
@@ -308,6 +355,9 @@ enum Histograms : uint32_t {
   BYTES_PER_READ,
   BYTES_PER_WRITE,
   BYTES_PER_MULTIGET,
+  // Latency and result size of each range query batch
+  DB_RANGE_QUERY,
+  BYTES_PER_RANGE_QUERY,
   HISTOGRAM_ENUM_MAX,  // TODO(ldemailly): enforce HistogramsNameMap match
 };
 
@@ -338,6 +388,8 @@ const std::vector<std::pair<Histograms, std::string>> HistogramsNameMap = {
     {BYTES_PER_READ, "vidardb.bytes.per.read"},
     {BYTES_PER_WRITE, "vidardb.bytes.per.write"},
     {BYTES_PER_MULTIGET, "vidardb.bytes.per.multiget"},
+    {DB_RANGE_QUERY, "vidardb.db.range.query.micros"},
+    {BYTES_PER_RANGE_QUERY, "vidardb.bytes.per.range.query"},
 };
 
 struct HistogramData {
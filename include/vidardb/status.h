@@ -51,6 +51,7 @@ class Status {
     kNotSupported = 3,
     kInvalidArgument = 4,
     kIOError = 5,
+    kMergeInProgress = 6,
     kIncomplete = 7,
     kShutdownInProgress = 8,
     kTimedOut = 9,
@@ -67,6 +68,7 @@ class Status {
     kMutexTimeout = 1,
     kLockTimeout = 2,
     kLockLimit = 3,
+    kDeadlock = 4,
     kMaxSubCode
   };
 
@@ -108,6 +110,13 @@ class Status {
   }
   static Status IOError(SubCode msg = kNone) { return Status(kIOError, msg); }
 
+  static Status MergeInProgress(const Slice& msg, const Slice& msg2 = Slice()) {
+    return Status(kMergeInProgress, msg, msg2);
+  }
+  static Status MergeInProgress(SubCode msg = kNone) {
+    return Status(kMergeInProgress, msg);
+  }
+
   static Status Incomplete(const Slice& msg, const Slice& msg2 = Slice()) {
     return Status(kIncomplete, msg, msg2);
   }
@@ -165,6 +174,9 @@ class Status {
   // Returns true iff the status indicates an IOError.
   bool IsIOError() const { return code() == kIOError; }
 
+  // Returns true iff the status indicates MergeInProgress.
+  bool IsMergeInProgress() const { return code() == kMergeInProgress; }
+
   // Returns true iff the status indicates Incomplete
   bool IsIncomplete() const { return code() == kIncomplete; }
 
@@ -179,6 +191,10 @@ class Status {
   // temporarily could not be acquired.
   bool IsBusy() const { return code() == kBusy; }
 
+  // Returns true iff the status indicates a deadlock was detected while
+  // acquiring a transaction lock.
+  bool IsDeadlock() const { return code() == kBusy && subcode() == kDeadlock; }
+
   // Returns true iff the status indicated that the operation has Expired.
   bool IsExpired() const { return code() == kExpired; }
 
@@ -79,6 +79,64 @@ struct TableOptions {
 
   // Same as block_restart_interval but used for the index block.
   int index_block_restart_interval = 1;
+
+  // The index type that will be used for this table.
+  enum IndexType : char {
+    // A space efficient index block that is optimized for
+    // binary-search-based index.
+    kBinarySearch,
+
+    // A two-level index implementation. Both levels are binary search
+    // indexes. The top level index is held in memory by the table reader,
+    // while the partitions of the second level are read on demand and cached
+    // in the block cache like data blocks.
+    kTwoLevelIndexSearch,
+  };
+
+  IndexType index_type = kBinarySearch;
+
+  // The target size of an index partition, used by kTwoLevelIndexSearch.
+  uint64_t metadata_block_size = 4096;
+
+  // If true and index_type is kTwoLevelIndexSearch, the index partitions of
+  // the tables in level 0 are read when the table is opened and kept with the
+  // table reader, since level 0 files are searched by every point lookup.
+  bool pin_l0_index_partitions = false;
+
+  // The index type within a data block.
+  enum DataBlockIndexType : char {
+    // Binary search over the restart points of the block.
+    kDataBlockBinarySearch,
+
+    // Additionally a hash index of the user keys in the block, so a point
+    // lookup finds its restart interval with one probe, and falls back to
+    // the binary search on a hash collision. Blocks of more than 253 restart
+    // intervals are not indexed. Only the data blocks of a block based table
+    // and of the main column of a column table are indexed, the sub column
+    // blocks are searched by their positions.
+    kDataBlockBinaryAndHash,
+  };
+
+  DataBlockIndexType data_block_index_type = kDataBlockBinarySearch;
+
+  // The ratio of the user keys to the buckets of the hash index of a data
+  // block, used by kDataBlockBinaryAndHash.
+  double data_block_hash_table_util_ratio = 0.75;
+
+  // The checksum in the trailer of every block, verified by the reads of
+  // ReadOptions::verify_checksums. The table records it in its footer, so
+  // the tables of either type are read whatever this option is.
+  enum ChecksumType : char {
+    // crc32c, computed with the SSE4.2 instruction, interleaved over three
+    // streams merged by carry-less multiplication when supported. The
+    // tables written before this option have it.
+    kCRC32c = 0x0,
+
+    // The lower 32 bits of XXH3 of xxHash, faster without SSE4.2.
+    kXXH3 = 0x1,
+  };
+
+  ChecksumType checksum = kCRC32c;
 };
 
 struct BlockBasedTableOptions : public TableOptions {};
@@ -92,6 +150,12 @@ extern TableFactory* NewBlockBasedTableFactory(
 struct ColumnTableOptions : public TableOptions {
   // Total column number excluding key
   uint32_t column_count = 0;
+
+  // If true, opening a table only opens its main file, and each sub-column
+  // file is opened when the column is first projected. This makes DB::Open
+  // and the table cache misses much cheaper for wide tables of which only a
+  // few columns are queried, at the cost of the first query of a column.
+  bool lazy_open_columns = false;
 };
 
 // Create default column table factory.
@@ -187,6 +251,13 @@ class TableFactory {
   // Developers should use DB::SetOption() instead to dynamically change
   // options while the DB is open.
   virtual void* GetOptions() { return nullptr; }
+
+  /***************************** Shichao ******************************/
+  // The first level whose tables this factory writes in the column format,
+  // the levels above it being written in the row format, or -1 if it
+  // writes every level in one format.
+  virtual int GetKnob() const { return -1; }
+  /***************************** Shichao ******************************/
 };
 
 // Create a special table factory that can open either of the supported
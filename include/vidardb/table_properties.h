@@ -41,6 +41,7 @@ struct TablePropertiesNames {
   static const std::string kRawValueSize;
   static const std::string kNumDataBlocks;
   static const std::string kNumEntries;
+  static const std::string kNumRangeDeletions;  // Shichao
   static const std::string kFormatVersion;
   static const std::string kFixedKeyLen;
   static const std::string kFilterPolicy;
@@ -55,6 +56,7 @@ struct TablePropertiesNames {
 extern const std::string kPropertiesBlock;
 extern const std::string kCompressionDictBlock;
 extern const std::string kColumnBlock;  // Shichao
+extern const std::string kRangeDelBlock;  // Shichao
 
 enum EntryType {
   kEntryPut,
@@ -148,6 +150,8 @@ struct TableProperties {
   uint64_t num_data_blocks = 0;
   // the number of entries in this table
   uint64_t num_entries = 0;
+  // the number of range tombstones in this table, not in num_entries
+  uint64_t num_range_deletions = 0;  // Shichao
   // format version, reserved for backward compatibility
   uint64_t format_version = 0;
   // If 0, key is variable length. Otherwise number of bytes for each key.
@@ -82,6 +82,7 @@ struct ThreadStatus {
     COMPACTION_TOTAL_INPUT_BYTES,
     COMPACTION_BYTES_READ,
     COMPACTION_BYTES_WRITTEN,
+    COMPACTION_CPU_MICROS,  // Shichao, of the thread running the job
     NUM_COMPACTION_PROPERTIES
   };
 
@@ -89,6 +90,7 @@ struct ThreadStatus {
     FLUSH_JOB_ID = 0,
     FLUSH_BYTES_MEMTABLES,
     FLUSH_BYTES_WRITTEN,
+    FLUSH_CPU_MICROS,  // Shichao
     NUM_FLUSH_PROPERTIES
   };
 
@@ -0,0 +1,153 @@
+//  Copyright (c) 2020-present, VidarDB, Inc.  All rights reserved.
+//  This source code is licensed under the BSD-style license found in the
+//  LICENSE file in the root directory of this source tree. An additional grant
+//  of patent rights can be found in the PATENTS file in the same directory.
+//
+// An incremental backup engine. The backups live in one directory:
+//   meta/<id>          the files of backup <id>, their sizes and checksums
+//   shared/<file>      the table files and sub-column files, each copied once
+//                      and referenced by all the backups which contain it
+//   private/<id>/      the MANIFEST, CURRENT and WAL files of backup <id>
+// A new backup only copies the table files which no earlier backup has,
+// recognized by their file numbers.
+
+#pragma once
+#ifndef VIDARDB_LITE
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#include "vidardb/env.h"
+#include "vidardb/status.h"
+
+namespace vidardb {
+
+class DB;
+
+struct BackupEngineOptions {
+  // Where to keep the backup files. Has to be different than dbname.
+  // Best to set this to dbname_ + "/backups"
+  // Required
+  std::string backup_dir;
+
+  // Backup Env object. It will be used for backup file I/O. If it's
+  // nullptr, backups will be written out using DBs Env. If it's
+  // non-nullptr, backup's I/O will be performed using this object.
+  // Default: nullptr
+  Env* backup_env;
+
+  // If share_table_files == true, a table file and its sub-column files are
+  // copied once to shared/ and referenced by the later backups, keyed by
+  // the file number, so a different DB must not be backed up to the same
+  // backup_dir. If false, every backup copies all its table files.
+  // Default: true
+  bool share_table_files;
+
+  // Backup info and error messages will be written to info_log
+  // if non-nullptr.
+  // Default: nullptr
+  Logger* info_log;
+
+  // If sync == true, we can guarantee you'll get consistent backup even
+  // on a machine crash/reboot. Backup process is slower with sync enabled.
+  // If sync == false, we don't guarantee anything on machine reboot. However,
+  // chances are some of the backups are consistent.
+  // Default: true
+  bool sync;
+
+  // If true, it will delete whatever backups there are already
+  // Default: false
+  bool destroy_old_data;
+
+  // If false, we won't backup log files. This option can be useful for backing
+  // up in-memory databases where log file are persisted, but table files are
+  // in memory.
+  // Default: true
+  bool backup_log_files;
+
+  // The number of threads copying the files of a backup or a restore.
+  // Default: 1
+  int max_background_operations;
+
+  explicit BackupEngineOptions(const std::string& _backup_dir,
+                               Env* _backup_env = nullptr,
+                               bool _share_table_files = true,
+                               Logger* _info_log = nullptr,
+                               bool _sync = true,
+                               bool _destroy_old_data = false,
+                               bool _backup_log_files = true,
+                               int _max_background_operations = 1)
+      : backup_dir(_backup_dir),
+        backup_env(_backup_env),
+        share_table_files(_share_table_files),
+        info_log(_info_log),
+        sync(_sync),
+        destroy_old_data(_destroy_old_data),
+        backup_log_files(_backup_log_files),
+        max_background_operations(_max_background_operations) {}
+};
+
+typedef uint32_t BackupID;
+
+struct BackupInfo {
+  BackupID backup_id;
+  int64_t timestamp;
+  // The size of all the files of the backup, the shared ones included.
+  uint64_t size;
+  uint32_t number_files;
+
+  BackupInfo() {}
+  BackupInfo(BackupID _backup_id, int64_t _timestamp, uint64_t _size,
+             uint32_t _number_files)
+      : backup_id(_backup_id), timestamp(_timestamp), size(_size),
+        number_files(_number_files) {}
+};
+
+// The methods of a BackupEngine must not be called concurrently.
+class BackupEngine {
+ public:
+  virtual ~BackupEngine() {}
+
+  // Opens the backups in options.backup_dir, creating the directory if it
+  // does not exist. The files left by a backup which did not finish are
+  // deleted.
+  static Status Open(Env* db_env, const BackupEngineOptions& options,
+                     BackupEngine** backup_engine_ptr);
+
+  // Captures the state of the database in a new backup, while the writes go
+  // on. The file deletions of the DB are disabled meanwhile. If
+  // flush_before_backup is true, the memtables are flushed first, otherwise
+  // the live WAL files are backed up up to their sizes when listed.
+  virtual Status CreateNewBackup(DB* db, bool flush_before_backup = false) = 0;
+
+  // Deletes the oldest backups, keeping num_backups_to_keep of them.
+  virtual Status PurgeOldBackups(uint32_t num_backups_to_keep) = 0;
+
+  // Deletes a backup, and the shared files no other backup references.
+  virtual Status DeleteBackup(BackupID backup_id) = 0;
+
+  // The backups, from the oldest.
+  virtual void GetBackupInfo(std::vector<BackupInfo>* backup_info) = 0;
+
+  // Checks that all the files of the backup exist with the sizes recorded.
+  // If verify_with_checksum is true, the files are read and their checksums
+  // compared too.
+  virtual Status VerifyBackup(BackupID backup_id,
+                              bool verify_with_checksum = false) = 0;
+
+  // Restores the backup into db_dir and wal_dir, which must not be used by
+  // an open DB. The log files already in wal_dir are deleted. The checksum
+  // of every file restored is compared to the one recorded at the backup,
+  // and Status::Corruption is returned on a mismatch.
+  virtual Status RestoreDBFromBackup(BackupID backup_id,
+                                     const std::string& db_dir,
+                                     const std::string& wal_dir) = 0;
+
+  // Restores the latest backup.
+  virtual Status RestoreDBFromLatestBackup(const std::string& db_dir,
+                                           const std::string& wal_dir) = 0;
+};
+
+}  // namespace vidardb
+#endif  // !VIDARDB_LITE
@@ -0,0 +1,37 @@
+//  Copyright (c) 2020-present, VidarDB, Inc.  All rights reserved.
+//  This source code is licensed under the BSD-style license found in the
+//  LICENSE file in the root directory of this source tree. An additional grant
+//  of patent rights can be found in the PATENTS file in the same directory.
+//
+// A checkpoint is an openable snapshot of a database at a point in time.
+
+#pragma once
+#ifndef VIDARDB_LITE
+
+#include <string>
+
+#include "vidardb/status.h"
+
+namespace vidardb {
+
+class DB;
+
+class Checkpoint {
+ public:
+  // Creates a Checkpoint object to be used for creating openable snapshots
+  static Status Create(DB* db, Checkpoint** checkpoint_ptr);
+
+  // Builds an openable snapshot of the DB in checkpoint_dir, which must not
+  // exist yet, without pausing the writes. The live table files and the
+  // sub-column files of the column tables are hard linked when checkpoint_dir
+  // is on the same filesystem as the DB, and copied otherwise. The MANIFEST
+  // is copied up to its size when the live files are listed, and the live
+  // WAL files up to their sizes right after, so the checkpoint recovers the
+  // writes made until then without a flush.
+  virtual Status CreateCheckpoint(const std::string& checkpoint_dir);
+
+  virtual ~Checkpoint() {}
+};
+
+}  // namespace vidardb
+#endif  // !VIDARDB_LITE
@@ -0,0 +1,75 @@
+//  Copyright (c) 2019-present, VidarDB, Inc.  All rights reserved.
+//  This source code is licensed under the BSD-style license found in the
+//  LICENSE file in the root directory of this source tree. An additional grant
+//  of patent rights can be found in the PATENTS file in the same directory.
+
+#pragma once
+#ifndef VIDARDB_LITE
+
+#include <string>
+#include <vector>
+
+#include "vidardb/comparator.h"
+#include "vidardb/db.h"
+#include "vidardb/utilities/stackable_db.h"
+#include "vidardb/utilities/transaction.h"
+
+// Database with optimistic Transaction support.
+//
+// Unlike TransactionDB, no key is locked while the transaction runs. The keys
+// written or read via GetForUpdate() are validated at Commit() instead, which
+// fails with Status::Busy() if any of them has been written outside of the
+// transaction since it was first touched (or since the snapshot, if one is
+// set), or with Status::TryAgain() if the memtable history is not large
+// enough to tell (See max_write_buffer_number_to_maintain).
+//
+// Suited to workloads where conflicts are rare.
+
+namespace vidardb {
+
+struct OptimisticTransactionOptions {
+  // Setting set_snapshot=true is the same as calling
+  // Transaction::SetSnapshot().
+  bool set_snapshot = false;
+};
+
+class OptimisticTransactionDB : public StackableDB {
+ public:
+  // Open an OptimisticTransactionDB similar to DB::Open().
+  static Status Open(const Options& options, const std::string& dbname,
+                     OptimisticTransactionDB** dbptr);
+
+  static Status Open(const DBOptions& db_options, const std::string& dbname,
+                     const std::vector<ColumnFamilyDescriptor>& column_families,
+                     std::vector<ColumnFamilyHandle*>* handles,
+                     OptimisticTransactionDB** dbptr);
+
+  virtual ~OptimisticTransactionDB() {}
+
+  // Starts a new Transaction.
+  //
+  // Caller is responsible for deleting the returned transaction when no
+  // longer needed.
+  //
+  // If old_txn is not null, BeginTransaction will reuse this Transaction
+  // handle instead of allocating a new one. This is an optimization to avoid
+  // extra allocations when repeatedly creating transactions.
+  virtual Transaction* BeginTransaction(
+      const WriteOptions& write_options,
+      const OptimisticTransactionOptions& txn_options =
+          OptimisticTransactionOptions(),
+      Transaction* old_txn = nullptr) = 0;
+
+ protected:
+  // To Create an OptimisticTransactionDB, call Open()
+  explicit OptimisticTransactionDB(DB* db) : StackableDB(db) {}
+
+ private:
+  // No copying allowed
+  OptimisticTransactionDB(const OptimisticTransactionDB&);
+  void operator=(const OptimisticTransactionDB&);
+};
+
+}  // namespace vidardb
+
+#endif  // VIDARDB_LITE
@@ -49,6 +49,16 @@ class StackableDB : public DB {
     return db_->Get(options, column_family, key, value);
   }
 
+  /***************** Shichao **********************/
+  using DB::RangeQuery;
+  virtual bool RangeQuery(ReadOptions& options,
+                          ColumnFamilyHandle* column_family, const Range& range,
+                          std::list<RangeQueryKeyVal>& res,
+                          Status* s = nullptr) override {
+    return db_->RangeQuery(options, column_family, range, res, s);
+  }
+  /***************** Shichao **********************/
+
   using DB::AddFile;
   virtual Status AddFile(ColumnFamilyHandle* column_family,
                          const ExternalSstFileInfo* file_info,
@@ -68,6 +78,21 @@ class StackableDB : public DB {
     return db_->Delete(wopts, column_family, key);
   }
 
+  using DB::DeleteRange;
+  virtual Status DeleteRange(const WriteOptions& wopts,
+                             ColumnFamilyHandle* column_family,
+                             const Slice& begin_key,
+                             const Slice& end_key) override {  // Shichao
+    return db_->DeleteRange(wopts, column_family, begin_key, end_key);
+  }
+
+  using DB::Merge;
+  virtual Status Merge(const WriteOptions& options,
+                       ColumnFamilyHandle* column_family, const Slice& key,
+                       const Slice& value) override {
+    return db_->Merge(options, column_family, key, value);
+  }
+
   virtual Status Write(const WriteOptions& opts, WriteBatch* updates) override {
     return db_->Write(opts, updates);
   }
@@ -204,6 +229,10 @@ class StackableDB : public DB {
     return db_->GetLatestSequenceNumber();
   }
 
+  virtual Status TryCatchUpWithPrimary() override {  // Shichao
+    return db_->TryCatchUpWithPrimary();
+  }
+
   virtual Status GetSortedWalFiles(VectorLogPtr& files) override {
     return db_->GetSortedWalFiles(files);
   }
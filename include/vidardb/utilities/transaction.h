@@ -7,6 +7,7 @@
 
 #ifndef VIDARDB_LITE
 
+#include <list>
 #include <string>
 #include <vector>
 
@@ -170,7 +171,7 @@ class Transaction {
   //
   // If this transaction was created by a TransactionDB, it can return
   // Status::OK() on success,
-  // Status::Busy() if there is a write conflict,
+  // Status::Busy() if there is a write conflict or a deadlock was detected,
   // Status::TimedOut() if a lock could not be acquired,
   // Status::TryAgain() if the memtable history size is not large enough
   //  (See max_write_buffer_number_to_maintain)
@@ -182,6 +183,25 @@ class Transaction {
   virtual Status GetForUpdate(ReadOptions& options, const Slice& key,
                               std::string* value) = 0;
 
+  // Lock the key range [range.start, range.limit] (kRangeQueryMin and
+  // kRangeQueryMax stand for an open end) so that no other transaction can
+  // lock or write any key in it until this transaction is committed or
+  // rolled back. One range lock replaces the point locks a reader would
+  // otherwise take for every key it fetched via RangeQuery().
+  //
+  // Range locks are not released by RollbackToSavePoint().
+  //
+  // Returns the same statuses as GetForUpdate(), or Status::NotSupported()
+  // if this transaction does not lock keys.
+  virtual Status GetRangeLock(ColumnFamilyHandle* column_family,
+                              const Range& range) {
+    return Status::NotSupported("Range locks not supported");
+  }
+
+  virtual Status GetRangeLock(const Range& range) {
+    return GetRangeLock(nullptr, range);
+  }
+
   // Returns an iterator that will iterate on all keys in the default
   // column family including both keys in the DB and uncommitted keys in this
   // transaction.
@@ -200,6 +220,26 @@ class Transaction {
   virtual Iterator* GetIterator(const ReadOptions& read_options,
                                 ColumnFamilyHandle* column_family) = 0;
 
+  // This function is similar to DB::RangeQuery() except it will also apply
+  // the pending changes in this transaction to each returned batch of
+  // results. read_options.columns is honored for both the DB data and the
+  // pending changes.
+  //
+  // If read_options.snapshot is not set and a snapshot has been set in this
+  // transaction (see SetSnapshot()), the DB part is read at that snapshot.
+  // As with Get(), the keys in this transaction are returned regardless of
+  // the snapshot.
+  //
+  // Returns true if there are more results, in which case it should be called
+  // again with the same read_options and range.
+  virtual bool RangeQuery(ReadOptions& read_options,
+                          ColumnFamilyHandle* column_family,
+                          const Range& range, std::list<RangeQueryKeyVal>& res,
+                          Status* s) = 0;
+
+  virtual bool RangeQuery(ReadOptions& read_options, const Range& range,
+                          std::list<RangeQueryKeyVal>& res, Status* s) = 0;
+
   // Put and Delete behave similarly to the corresponding
   // functions in WriteBatch, but will also do conflict checking on the
   // keys being written.
@@ -207,7 +247,7 @@ class Transaction {
   // If this Transaction was created on a TransactionDB, the status returned
   // can be:
   // Status::OK() on success,
-  // Status::Busy() if there is a write conflict,
+  // Status::Busy() if there is a write conflict or a deadlock was detected,
   // Status::TimedOut() if a lock could not be acquired,
   // Status::TryAgain() if the memtable history size is not large enough
   //  (See max_write_buffer_number_to_maintain)
@@ -41,8 +41,8 @@ struct TransactionDBOptions {
   //
   // If 0, no waiting is done if a lock cannot instantly be acquired.
   // If negative, there is no timeout. Not using a timeout is not recommended
-  // as it can lead to deadlocks. Currently, there is no deadlock-detection to
-  // recover from a deadlock.
+  // as it can lead to deadlocks, unless TransactionOptions::deadlock_detect
+  // is set for the transactions involved.
   int64_t transaction_lock_timeout = 1000;  // 1 second
 
   // If positive, specifies the wait timeout in milliseconds when writing a key
@@ -52,11 +52,10 @@ struct TransactionDBOptions {
   // If negative, there is no timeout and will block indefinitely when acquiring
   // a lock.
   //
-  // Not using a timeout can lead to deadlocks. Currently, there
-  // is no deadlock-detection to recover from a deadlock. While DB writes
-  // cannot deadlock with other DB writes, they can deadlock with a transaction.
-  // A negative timeout should only be used if all transactions have a small
-  // expiration set.
+  // Not using a timeout can lead to deadlocks. DB writes do not take part in
+  // deadlock detection. While DB writes cannot deadlock with other DB writes,
+  // they can deadlock with a transaction. A negative timeout should only be
+  // used if all transactions have a small expiration set.
   int64_t default_lock_timeout = 1000;  // 1 second
 
   // If set, the TransactionDB will use this implementation of a mutex and
@@ -70,6 +69,15 @@ struct TransactionOptions {
   // Transaction::SetSnapshot().
   bool set_snapshot = false;
 
+  // Setting to true means that before waiting on a lock held by other
+  // transactions, this transaction checks the wait-for graph and fails with
+  // Status::Busy() (subcode kDeadlock) if waiting would close a cycle.
+  bool deadlock_detect = false;
+
+  // Maximum number of transactions followed in the wait-for graph when
+  // detecting a deadlock. A longer chain is treated as a deadlock.
+  int64_t deadlock_detect_depth = 50;
+
   // If positive, specifies the wait timeout in milliseconds when
   // a transaction attempts to lock a key.
   //
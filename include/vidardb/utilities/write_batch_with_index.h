@@ -12,6 +12,7 @@
 
 #ifndef VIDARDB_LITE
 
+#include <list>
 #include <string>
 
 #include "vidardb/comparator.h"
@@ -28,6 +29,8 @@ class Comparator;
 class DB;
 struct ReadOptions;
 struct DBOptions;
+struct Range;
+struct RangeQueryKeyVal;
 
 enum WriteType {
   kPutRecord,
@@ -163,6 +166,25 @@ class WriteBatchWithIndex : public WriteBatchBase {
                            ColumnFamilyHandle* column_family, const Slice& key,
                            std::string* value);
 
+  // Similar to DB::RangeQuery() but will also apply the writes from this
+  // batch on top of each returned batch of results: keys put in this batch
+  // are added (or override the DB values) and keys deleted in this batch
+  // are removed. read_options.columns is honored for the batch values too.
+  //
+  // As with GetFromBatchAndDB(), read_options.snapshot only affects what is
+  // read from the DB. The batch entries merged into one call are those
+  // whose keys fall between the first key covered by this call and the next
+  // start key of the DB range query, so a multi-call range query sees every
+  // batch entry exactly once. read_options.batch_capacity only bounds the DB
+  // part of each result.
+  bool RangeQueryFromBatchAndDB(DB* db, ReadOptions& read_options,
+                                const Range& range,
+                                std::list<RangeQueryKeyVal>& res, Status* s);
+  bool RangeQueryFromBatchAndDB(DB* db, ReadOptions& read_options,
+                                ColumnFamilyHandle* column_family,
+                                const Range& range,
+                                std::list<RangeQueryKeyVal>& res, Status* s);
+
  private:
   struct Rep;
   Rep* rep;
@@ -56,6 +56,25 @@ class WriteBatch : public WriteBatchBase {
   void Delete(ColumnFamilyHandle* column_family, const Slice& key) override;
   void Delete(const Slice& key) override { Delete(nullptr, key); }
 
+  /***************************** Shichao ******************************/
+  // Erase all the keys in [begin_key, end_key) written before, in the
+  // ordering of the comparator. The range is kept as a single tombstone,
+  // whatever the number of keys it deletes.
+  void DeleteRange(ColumnFamilyHandle* column_family, const Slice& begin_key,
+                   const Slice& end_key);
+  void DeleteRange(const Slice& begin_key, const Slice& end_key) {
+    DeleteRange(nullptr, begin_key, end_key);
+  }
+  /***************************** Shichao ******************************/
+
+  // Merge "value" with the existing value of "key" in the database.
+  // "key->merge(existing, value)"
+  void Merge(ColumnFamilyHandle* column_family, const Slice& key,
+             const Slice& value);
+  void Merge(const Slice& key, const Slice& value) {
+    Merge(nullptr, key, value);
+  }
+
   using WriteBatchBase::PutLogData;
   // Append a blob of arbitrary size to the records in this batch. The blob will
   // be stored in the transaction log but not in any other file. In particular,
@@ -80,7 +99,7 @@ class WriteBatch : public WriteBatchBase {
   // May be called multiple times to set multiple save points.
   void SetSavePoint() override;
 
-  // Remove all entries in this batch (Put, Delete, PutLogData) since the
+  // Remove all entries in this batch (Put, Merge, Delete, PutLogData) since the
   // most recent call to SetSavePoint() and removes the most recent save point.
   // If there is no previous call to SetSavePoint(), Status::NotFound()
   // will be returned.
@@ -118,6 +137,26 @@ class WriteBatch : public WriteBatchBase {
     }
     virtual void Delete(const Slice& key) {}
 
+    virtual Status DeleteRangeCF(uint32_t column_family_id,
+                                 const Slice& begin_key,
+                                 const Slice& end_key) {  // Shichao
+      return Status::InvalidArgument("DeleteRangeCF not implemented");
+    }
+
+    // Merge and LogData are not pure virtual. Otherwise, we would break
+    // existing clients of Handler on a source code level. The default
+    // implementation of Merge does nothing.
+    virtual Status MergeCF(uint32_t column_family_id, const Slice& key,
+                           const Slice& value) {
+      if (column_family_id == 0) {
+        Merge(key, value);
+        return Status::OK();
+      }
+      return Status::InvalidArgument(
+          "non-default column family and MergeCF not implemented");
+    }
+    virtual void Merge(const Slice& key, const Slice& value) {}
+
     // The default implementation of LogData does nothing.
     virtual void LogData(const Slice& blob);
 
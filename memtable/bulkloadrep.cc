@@ -0,0 +1,342 @@
+//  Copyright (c) 2019-present, VidarDB, Inc.  All rights reserved.
+//  This source code is licensed under the BSD-style license found in the
+//  LICENSE file in the root directory of this source tree. An additional grant
+//  of patent rights can be found in the PATENTS file in the same directory.
+//
+#ifndef VIDARDB_LITE
+#include "vidardb/memtablerep.h"
+
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "memtable/memtable.h"
+#include "port/port.h"
+#include "util/arena.h"
+#include "util/mutexlock.h"
+#include "util/random.h"
+
+namespace vidardb {
+namespace {
+
+typedef std::vector<const char*> Bucket;
+
+#ifdef VIDARDB_SUPPORT_THREAD_LOCAL
+// 1 + the append buffer index of this thread, 0 means not picked yet
+__thread uint32_t tls_shard = 0;
+#endif
+std::atomic<uint32_t> next_shard(0);
+
+// Below this many entries per thread, spawning threads costs more than it
+// saves.
+const size_t kMinEntriesPerSortThread = 16 * 1024;
+
+// Sort the bucket with up to max_threads threads: equal chunks are sorted
+// concurrently, then adjacent sorted runs are merged pairwise, also
+// concurrently, until one run is left.
+void ParallelSort(Bucket* bucket, const MemTableRep::KeyComparator& compare,
+                  size_t max_threads) {
+  auto less = [&compare](const char* a, const char* b) {
+    return compare(a, b) < 0;
+  };
+  size_t num_threads =
+      std::min(max_threads, bucket->size() / kMinEntriesPerSortThread);
+  if (num_threads <= 1) {
+    std::sort(bucket->begin(), bucket->end(), less);
+    return;
+  }
+
+  std::vector<size_t> bounds;
+  for (size_t i = 0; i < num_threads; i++) {
+    bounds.push_back(bucket->size() * i / num_threads);
+  }
+  bounds.push_back(bucket->size());
+
+  std::vector<std::thread> threads;
+  for (size_t i = 0; i + 1 < bounds.size(); i++) {
+    threads.emplace_back([&, i]() {
+      std::sort(bucket->begin() + bounds[i], bucket->begin() + bounds[i + 1],
+                less);
+    });
+  }
+  for (auto& t : threads) {
+    t.join();
+  }
+
+  while (bounds.size() > 2) {
+    threads.clear();
+    std::vector<size_t> merged;
+    for (size_t i = 0; i + 1 < bounds.size(); i += 2) {
+      merged.push_back(bounds[i]);
+      if (i + 2 < bounds.size()) {
+        threads.emplace_back([&, i]() {
+          std::inplace_merge(bucket->begin() + bounds[i],
+                             bucket->begin() + bounds[i + 1],
+                             bucket->begin() + bounds[i + 2], less);
+        });
+      }
+    }
+    merged.push_back(bucket->size());
+    for (auto& t : threads) {
+      t.join();
+    }
+    bounds.swap(merged);
+  }
+}
+
+class BulkLoadRep : public MemTableRep {
+ public:
+  BulkLoadRep(const KeyComparator& compare, MemTableAllocator* allocator,
+              size_t count, size_t sort_threads);
+
+  // Appends to the buffer of the calling thread, no ordering is done.
+  virtual void Insert(KeyHandle handle) override;
+
+  virtual void InsertConcurrently(KeyHandle handle) override;
+
+  // Returns true iff an entry that compares equal to key is in the collection.
+  virtual bool Contains(const char* key) const override;
+
+  virtual void MarkReadOnly() override;
+
+  virtual size_t ApproximateMemoryUsage() override;
+
+  virtual void Get(const LookupKey& k, void* callback_args,
+                   bool (*callback_func)(void* arg,
+                                         const char* entry)) override;
+
+  virtual void RangeQuery(const LookupRange& range,
+                          std::list<RangeQueryKeyVal>& res,
+                          void* callback_args,
+                          bool (*callback_func)(void* arg, const char* entry))
+                          override;
+
+  virtual ~BulkLoadRep() override { }
+
+  // Iterates a sorted bucket, which is shared with the memtable once it is
+  // immutable, or a private sorted copy otherwise.
+  class Iterator : public MemTableRep::Iterator {
+   public:
+    Iterator(std::shared_ptr<Bucket> bucket, const KeyComparator& compare)
+        : bucket_(bucket), cit_(bucket_->end()), compare_(compare) {}
+
+    virtual ~Iterator() override { }
+
+    virtual bool Valid() const override { return cit_ != bucket_->end(); }
+
+    virtual const char* key() const override { return *cit_; }
+
+    virtual void Next() override {
+      if (cit_ != bucket_->end()) {
+        ++cit_;
+      }
+    }
+
+    // Going back from the first entry moves past-the-end, as VectorRep does.
+    virtual void Prev() override {
+      if (cit_ == bucket_->begin()) {
+        cit_ = bucket_->end();
+      } else {
+        --cit_;
+      }
+    }
+
+    virtual void Seek(const Slice& user_key,
+                      const char* memtable_key) override {
+      const char* encoded_key =
+          (memtable_key != nullptr) ? memtable_key : EncodeKey(&tmp_, user_key);
+      cit_ = std::lower_bound(bucket_->begin(), bucket_->end(), encoded_key,
+                              [this](const char* a, const char* b) {
+                                return compare_(a, b) < 0;
+                              });
+    }
+
+    virtual void SeekToFirst() override { cit_ = bucket_->begin(); }
+
+    virtual void SeekToLast() override {
+      cit_ = bucket_->end();
+      if (bucket_->size() != 0) {
+        --cit_;
+      }
+    }
+
+   private:
+    std::shared_ptr<Bucket> bucket_;
+    Bucket::const_iterator cit_;
+    const KeyComparator& compare_;
+    std::string tmp_;  // For passing to EncodeKey
+  };
+
+  // Return an iterator over the keys in this representation.
+  virtual MemTableRep::Iterator* GetIterator(Arena* arena) override;
+
+ private:
+  struct Shard {
+    char padding[40];  // keep the locks of shards on separate cache lines
+    mutable SpinMutex mutex;
+    Bucket bucket;
+  };
+
+  Shard* PickShard();
+
+  // Sorted entries to read: merged once after MarkReadOnly(), a sorted copy
+  // of all the buffers before.
+  std::shared_ptr<Bucket> SortedBucket();
+
+  const KeyComparator& compare_;
+  const size_t sort_threads_;
+  size_t index_mask_;
+  std::unique_ptr<Shard[]> shards_;
+  std::atomic<size_t> num_entries_;
+  std::atomic<bool> immutable_;
+
+  port::Mutex sort_mutex_;
+  std::atomic<bool> sorted_;
+  std::shared_ptr<Bucket> sorted_bucket_;  // set once, under sort_mutex_
+};
+
+BulkLoadRep::BulkLoadRep(const KeyComparator& compare,
+                         MemTableAllocator* allocator, size_t count,
+                         size_t sort_threads)
+    : MemTableRep(allocator),
+      compare_(compare),
+      sort_threads_(std::max(sort_threads, static_cast<size_t>(1))),
+      num_entries_(0),
+      immutable_(false),
+      sorted_(false) {
+  // find a power of two >= num_cpus and >= 8, like ConcurrentArena
+  auto num_cpus = std::thread::hardware_concurrency();
+  index_mask_ = 7;
+  while (index_mask_ + 1 < num_cpus) {
+    index_mask_ = index_mask_ * 2 + 1;
+  }
+  shards_.reset(new Shard[index_mask_ + 1]);
+  for (size_t i = 0; i <= index_mask_; i++) {
+    shards_[i].bucket.reserve(count / (index_mask_ + 1));
+  }
+}
+
+BulkLoadRep::Shard* BulkLoadRep::PickShard() {
+#ifdef VIDARDB_SUPPORT_THREAD_LOCAL
+  if (tls_shard == 0) {
+    // round robin, so that up to index_mask_ + 1 writers never share a buffer
+    tls_shard = next_shard.fetch_add(1, std::memory_order_relaxed) + 1;
+  }
+  return &shards_[(tls_shard - 1) & index_mask_];
+#else
+  return &shards_[Random::GetTLSInstance()->Uniform(
+      static_cast<int>(index_mask_) + 1)];
+#endif
+}
+
+void BulkLoadRep::Insert(KeyHandle handle) { InsertConcurrently(handle); }
+
+void BulkLoadRep::InsertConcurrently(KeyHandle handle) {
+  assert(!immutable_.load(std::memory_order_relaxed));
+  Shard* shard = PickShard();
+  {
+    std::lock_guard<SpinMutex> l(shard->mutex);
+    shard->bucket.push_back(static_cast<char*>(handle));
+  }
+  num_entries_.fetch_add(1, std::memory_order_relaxed);
+}
+
+bool BulkLoadRep::Contains(const char* key) const {
+  for (size_t i = 0; i <= index_mask_; i++) {
+    std::lock_guard<SpinMutex> l(shards_[i].mutex);
+    const Bucket& bucket = shards_[i].bucket;
+    if (std::find(bucket.begin(), bucket.end(), key) != bucket.end()) {
+      return true;
+    }
+  }
+  return false;
+}
+
+void BulkLoadRep::MarkReadOnly() {
+  immutable_.store(true, std::memory_order_release);
+}
+
+size_t BulkLoadRep::ApproximateMemoryUsage() {
+  return sizeof(Shard) * (index_mask_ + 1) +
+         num_entries_.load(std::memory_order_relaxed) * sizeof(const char*);
+}
+
+std::shared_ptr<Bucket> BulkLoadRep::SortedBucket() {
+  bool immutable = immutable_.load(std::memory_order_acquire);
+  if (immutable && sorted_.load(std::memory_order_acquire)) {
+    return sorted_bucket_;
+  }
+
+  std::unique_ptr<MutexLock> l;
+  if (immutable) {
+    l.reset(new MutexLock(&sort_mutex_));
+    if (sorted_.load(std::memory_order_relaxed)) {
+      return sorted_bucket_;
+    }
+  }
+
+  // The buffers are no longer written when immutable, they can be moved
+  // from instead of copied.
+  std::shared_ptr<Bucket> bucket(new Bucket());
+  bucket->reserve(num_entries_.load(std::memory_order_relaxed));
+  for (size_t i = 0; i <= index_mask_; i++) {
+    std::lock_guard<SpinMutex> sl(shards_[i].mutex);
+    Bucket& shard_bucket = shards_[i].bucket;
+    bucket->insert(bucket->end(), shard_bucket.begin(), shard_bucket.end());
+    if (immutable) {
+      Bucket().swap(shard_bucket);
+    }
+  }
+  ParallelSort(bucket.get(), compare_, sort_threads_);
+
+  if (immutable) {
+    sorted_bucket_ = bucket;
+    sorted_.store(true, std::memory_order_release);
+  }
+  return bucket;
+}
+
+void BulkLoadRep::Get(const LookupKey& k, void* callback_args,
+                      bool (*callback_func)(void* arg, const char* entry)) {
+  BulkLoadRep::Iterator iter(SortedBucket(), compare_);
+  for (iter.Seek(k.user_key(), k.memtable_key().data());
+       iter.Valid() && callback_func(callback_args, iter.key()); iter.Next()) {
+  }
+}
+
+void BulkLoadRep::RangeQuery(const LookupRange& range,
+                             std::list<RangeQueryKeyVal>& res,
+                             void* callback_args,
+                             bool (*callback_func)(void* arg,
+                                                   const char* entry)) {
+  BulkLoadRep::Iterator iter(SortedBucket(), compare_);
+  if (range.start_->user_key().compare(kRangeQueryMin) == 0) {
+    iter.SeekToFirst();  // Full search
+  } else {
+    iter.Seek(Slice(), range.start_->memtable_key().data());
+  }
+
+  for (; iter.Valid() && callback_func(callback_args, iter.key());
+       iter.Next()) {
+  }
+}
+
+MemTableRep::Iterator* BulkLoadRep::GetIterator(Arena* arena) {
+  std::shared_ptr<Bucket> bucket = SortedBucket();
+  if (arena == nullptr) {
+    return new Iterator(bucket, compare_);
+  }
+  char* mem = arena->AllocateAligned(sizeof(Iterator));
+  return new (mem) Iterator(bucket, compare_);
+}
+}  // anon namespace
+
+MemTableRep* BulkLoadRepFactory::CreateMemTableRep(
+    const MemTableRep::KeyComparator& compare, MemTableAllocator* allocator,
+    const SliceTransform* transform, Logger* logger) {
+  return new BulkLoadRep(compare, allocator, count_, sort_threads_);
+}
+}  // namespace vidardb
+#endif  // VIDARDB_LITE
@@ -21,6 +21,8 @@
 #include <memory>
 
 #include "db/dbformat.h"
+#include "db/merge_context.h"
+#include "db/merge_helper.h"
 #include "db/pinned_iterators_manager.h"
 #include "db/writebuffer.h"
 #include "table/column_table_factory.h"
@@ -36,18 +38,43 @@
 #include "vidardb/comparator.h"
 #include "vidardb/env.h"
 #include "vidardb/iterator.h"
+#include "vidardb/slice_transform.h"
 #include "vidardb/splitter.h"
 #include "vidardb/table.h"
 
 namespace vidardb {
 
+/***************************** Shichao ******************************/
+namespace {
+// The bits of a bloom taking ratio of write_buffer_size, computed in 64 bits
+// and capped below the 32 bits DynamicBloom counts in, leaving room for it
+// to round up to whole cache lines.
+uint32_t MemTableBloomBits(size_t write_buffer_size, double ratio) {
+  const uint64_t kMaxBits =
+      std::numeric_limits<uint32_t>::max() - 2 * CACHE_LINE_SIZE * 8;
+  uint64_t bytes = static_cast<uint64_t>(
+      static_cast<double>(write_buffer_size) * std::min(ratio, 0.25));
+  return static_cast<uint32_t>(std::min(bytes, kMaxBits / 8) * 8);
+}
+}  // anonymous namespace
+/***************************** Shichao ******************************/
+
 MemTableOptions::MemTableOptions(const ImmutableCFOptions& ioptions,
                                  const MutableCFOptions& mutable_cf_options)
     : write_buffer_size(mutable_cf_options.write_buffer_size),
       arena_block_size(mutable_cf_options.arena_block_size),
       statistics(ioptions.statistics),
       info_log(ioptions.info_log),
-      splitter(ioptions.splitter) {}
+      splitter(ioptions.splitter),
+      merge_operator(ioptions.merge_operator),
+      /***************************** Shichao ******************************/
+      memtable_prefix_bloom_bits(MemTableBloomBits(
+          mutable_cf_options.write_buffer_size,
+          mutable_cf_options.memtable_prefix_bloom_size_ratio)),
+      memtable_whole_key_filtering(
+          mutable_cf_options.memtable_whole_key_filtering),
+      memtable_huge_page_size(mutable_cf_options.memtable_huge_page_size) {}
+      /***************************** Shichao ******************************/
 
 MemTable::MemTable(const InternalKeyComparator& cmp,
                    const ImmutableCFOptions& ioptions,
@@ -57,13 +84,17 @@ MemTable::MemTable(const InternalKeyComparator& cmp,
       moptions_(ioptions, mutable_cf_options),
       refs_(0),
       kArenaBlockSize(OptimizeBlockSize(moptions_.arena_block_size)),
-      arena_(moptions_.arena_block_size, 0),
+      arena_(moptions_.arena_block_size,
+             moptions_.memtable_huge_page_size),  // Shichao
       allocator_(&arena_, write_buffer),
       table_(ioptions.memtable_factory->CreateMemTableRep(
-          comparator_, &allocator_, ioptions.info_log)),
+          comparator_, &allocator_, ioptions.prefix_extractor,
+          ioptions.info_log)),
+      prefix_extractor_(ioptions.prefix_extractor),  // Shichao
       data_size_(0),
       num_entries_(0),
       num_deletes_(0),
+      num_range_deletes_(0),  // Shichao
       flush_in_progress_(false),
       flush_completed_(false),
       file_number_(0),
@@ -73,6 +104,18 @@ MemTable::MemTable(const InternalKeyComparator& cmp,
       min_prep_log_referenced_(0),
       flush_state_(FLUSH_NOT_REQUESTED),
       env_(ioptions.env) {
+  /***************************** Shichao ******************************/
+  // Allocated from the memtable allocator, so it counts against
+  // write_buffer_size like the entries do
+  if (moptions_.memtable_prefix_bloom_bits > 0 &&
+      (prefix_extractor_ != nullptr || moptions_.memtable_whole_key_filtering)) {
+    bloom_filter_.reset(new DynamicBloom(
+        &allocator_, moptions_.memtable_prefix_bloom_bits, 1 /* locality */,
+        6 /* num_probes */, nullptr, moptions_.memtable_huge_page_size,
+        ioptions.info_log));
+  }
+  /***************************** Shichao ******************************/
+
   UpdateFlushState();
   // something went wrong if we need to flush before inserting anything
   assert(!ShouldScheduleFlush());
@@ -317,9 +360,91 @@ uint64_t MemTable::ApproximateSize(const Slice& start_ikey,
   return entry_count * (data_size / n);
 }
 
+/***************************** Shichao *****************************/
+void MemTable::AddToBloomFilter(const Slice& key, bool allow_concurrent) {
+  if (prefix_extractor_ != nullptr && prefix_extractor_->InDomain(key)) {
+    if (allow_concurrent) {
+      bloom_filter_->AddConcurrently(prefix_extractor_->Transform(key));
+    } else {
+      bloom_filter_->Add(prefix_extractor_->Transform(key));
+    }
+  }
+  if (moptions_.memtable_whole_key_filtering) {
+    if (allow_concurrent) {
+      bloom_filter_->AddConcurrently(key);
+    } else {
+      bloom_filter_->Add(key);
+    }
+  }
+}
+
+bool MemTable::MayContain(const Slice& key) const {
+  if (moptions_.memtable_whole_key_filtering) {
+    return bloom_filter_->MayContain(key);
+  }
+  // keys out of the domain were not added by prefix, so can't be ruled out
+  if (!prefix_extractor_->InDomain(key)) {
+    return true;
+  }
+  return bloom_filter_->MayContain(prefix_extractor_->Transform(key));
+}
+/***************************** Shichao *****************************/
+
+/***************************** Shichao *****************************/
+void MemTable::AddRangeTombstone(SequenceNumber s, const Slice& key,
+                                 const Slice& value) {
+  const size_t encoded_len = key.size() + value.size();
+  char* buf = allocator_.Allocate(encoded_len);
+  memcpy(buf, key.data(), key.size());
+  memcpy(buf + key.size(), value.data(), value.size());
+  {
+    std::lock_guard<std::mutex> lock(range_del_mutex_);
+    range_tombstones_.emplace_back(Slice(buf, key.size()),
+                                   Slice(buf + key.size(), value.size()), s);
+    range_del_list_.reset();
+  }
+
+  num_entries_.fetch_add(1, std::memory_order_relaxed);
+  num_range_deletes_.fetch_add(1, std::memory_order_relaxed);
+  data_size_.fetch_add(encoded_len, std::memory_order_relaxed);
+
+  uint64_t cur_seq_num = first_seqno_.load(std::memory_order_relaxed);
+  while ((cur_seq_num == 0 || s < cur_seq_num) &&
+         !first_seqno_.compare_exchange_weak(cur_seq_num, s)) {
+  }
+  uint64_t cur_earliest_seqno = earliest_seqno_.load(std::memory_order_relaxed);
+  while (
+      (cur_earliest_seqno == kMaxSequenceNumber || s < cur_earliest_seqno) &&
+      !earliest_seqno_.compare_exchange_weak(cur_earliest_seqno, s)) {
+  }
+
+  UpdateFlushState();
+}
+
+std::shared_ptr<const FragmentedRangeTombstoneList>
+MemTable::GetRangeTombstoneList() {
+  if (num_range_deletes_.load(std::memory_order_relaxed) == 0) {
+    return nullptr;
+  }
+  std::lock_guard<std::mutex> lock(range_del_mutex_);
+  if (range_del_list_ == nullptr) {
+    range_del_list_ = std::make_shared<const FragmentedRangeTombstoneList>(
+        range_tombstones_, comparator_.comparator.user_comparator());
+  }
+  return range_del_list_;
+}
+/***************************** Shichao *****************************/
+
 void MemTable::Add(SequenceNumber s, ValueType type,
                    const Slice& key, /* user key */
                    const Slice& value, bool allow_concurrent) {
+  /***************************** Shichao *****************************/
+  if (type == kTypeRangeDeletion) {
+    AddRangeTombstone(s, key, value);
+    return;
+  }
+  /***************************** Shichao *****************************/
+
   // Format of an entry is concatenation of:
   //  key_size     : varint32 of internal_key.size()
   //  key bytes    : char[internal_key.size()]
@@ -343,6 +468,9 @@ void MemTable::Add(SequenceNumber s, ValueType type,
   p = EncodeVarint32(p, val_size);
   memcpy(p, value.data(), val_size);
   assert((unsigned)(p + val_size - buf) == (unsigned)encoded_len);
+  if (bloom_filter_) {
+    AddToBloomFilter(key, allow_concurrent);  // Shichao
+  }
   if (!allow_concurrent) {
     table_->Insert(handle);
 
@@ -401,10 +529,15 @@ struct Saver {
   const LookupKey* key;
   const LookupRange* range;  // Shichao
   bool* found_final_value;   // Is value set correctly? Used by KeyMayExist
+  bool* merge_in_progress;
   std::string* get_value;    // User value ptr for Get()
   std::list<RangeQueryKeyVal>* res;  // Shichao
   std::map<std::string, SeqTypeVal>::iterator prev_iter;  // Shichao
   SequenceNumber seq;
+  SequenceNumber max_covering_tombstone_seq;  // Shichao
+  const MergeOperator* merge_operator;
+  // the merge operations encountered;
+  MergeContext* merge_context;
   MemTable* mem;
   Logger* logger;
   Statistics* statistics;
@@ -435,6 +568,12 @@ static bool SaveValue(void* arg, const char* entry) {
     const uint64_t tag = DecodeFixed64(key_ptr + key_length - 8);
     ValueType type;
     UnPackSequenceAndType(tag, &s->seq, &type);
+    /***************************** Shichao *****************************/
+    if ((type == kTypeValue || type == kTypeMerge) &&
+        s->seq < s->max_covering_tombstone_seq) {
+      type = kTypeDeletion;  // deleted by a range tombstone
+    }
+    /***************************** Shichao *****************************/
 
     switch (type) {
       case kTypeValue: {
@@ -444,7 +583,14 @@ static bool SaveValue(void* arg, const char* entry) {
                                          s->mem->GetMemTableOptions()->splitter,
                                          buf));
         *(s->status) = Status::OK();
-        if (s->get_value != nullptr) {
+        if (*(s->merge_in_progress)) {
+          if (s->get_value != nullptr) {
+            *(s->status) = MergeHelper::TimedFullMerge(
+                s->key->user_key(), &user_val,
+                s->merge_context->GetOperands(), s->merge_operator,
+                s->statistics, s->env_, s->logger, s->get_value);
+          }
+        } else if (s->get_value != nullptr) {
           s->get_value->assign(user_val.data(), user_val.size());
         }
         *(s->found_final_value) = true;
@@ -452,10 +598,41 @@ static bool SaveValue(void* arg, const char* entry) {
       }
       case kTypeDeletion:
       case kTypeSingleDeletion: {
-        *(s->status) = Status::NotFound();
+        if (*(s->merge_in_progress)) {
+          *(s->status) = Status::OK();
+          if (s->get_value != nullptr) {
+            *(s->status) = MergeHelper::TimedFullMerge(
+                s->key->user_key(), nullptr, s->merge_context->GetOperands(),
+                s->merge_operator, s->statistics, s->env_, s->logger,
+                s->get_value);
+          }
+        } else {
+          *(s->status) = Status::NotFound();
+        }
         *(s->found_final_value) = true;
         return false;
       }
+      case kTypeMerge: {
+        if (!s->merge_operator) {
+          *(s->status) = Status::InvalidArgument(
+              "merge_operator is not properly initialized.");
+          // Normally we continue the loop (return true) when we see a merge
+          // operand.  But in case of an error, we should stop the loop
+          // immediately and pretend we have found the value to stop further
+          // seek.  Otherwise, the later call will override this error status.
+          *(s->found_final_value) = true;
+          return false;
+        }
+        // The operands are projected like the base value, so the merge
+        // works on the requested columns only
+        std::string buf;  // prepare for splitting user value
+        Slice v = GetLengthPrefixedSlice(key_ptr + key_length);
+        *(s->merge_in_progress) = true;
+        s->merge_context->PushOperand(
+            ReformatUserValue(v, s->read_options->columns,
+                              s->mem->GetMemTableOptions()->splitter, buf));
+        return true;
+      }
       default:
         assert(false);
         return true;
@@ -489,6 +666,7 @@ static bool SaveValueForRangeQuery(void* arg, const char* entry) {
   SequenceNumber sequence_num = s->range->SequenceNum();
   switch (type) {
     case kTypeValue:
+    case kTypeMerge:  // resolved by DBImpl::RangeQuery
     case kTypeDeletion:
     case kTypeSingleDeletion: {
       if (s->seq <= sequence_num) {
@@ -516,14 +694,14 @@ static bool SaveValueForRangeQuery(void* arg, const char* entry) {
               meta->del_keys.erase(it->second.seq_);
             }
             assert(s->read_options->result_val_size >=
-                it->second.iter_->user_val.size());
+                it->second.iter_->value().size());
             s->read_options->result_val_size -= 
-                it->second.iter_->user_val.size();
+                it->second.iter_->value().size();
             it->second.seq_ = s->seq;
             it->second.type_ = type;
-            it->second.iter_->user_val = user_val.ToString();
+            it->second.iter_->SetValue(user_val);  // Shichao
             s->read_options->result_val_size += 
-                it->second.iter_->user_val.size();
+                it->second.iter_->value().size();
             if (type == kTypeDeletion) {
               meta->del_keys.insert({s->seq, it->second.iter_});
             }
@@ -559,7 +737,9 @@ static bool SaveValueForRangeQuery(void* arg, const char* entry) {
 /***************************** Shichao *****************************/
 
 bool MemTable::Get(ReadOptions& read_options, const LookupKey& key,
-                   std::string* value, Status* s, SequenceNumber* seq) {
+                   std::string* value, Status* s, MergeContext* merge_context,
+                   SequenceNumber* max_covering_tombstone_seq,
+                   SequenceNumber* seq) {
   // The sequence number is updated synchronously in version_set.h
   if (IsEmpty()) {
     // Avoiding recording stats for speed.
@@ -567,14 +747,44 @@ bool MemTable::Get(ReadOptions& read_options, const LookupKey& key,
   }
   PERF_TIMER_GUARD(get_from_memtable_time);
 
+  /***************************** Shichao *****************************/
+  // The tombstones are checked before the bloom filter, which only knows
+  // the point keys
+  SequenceNumber max_covering_seq = 0;
+  if (max_covering_tombstone_seq != nullptr) {
+    auto range_del_list = GetRangeTombstoneList();
+    if (range_del_list != nullptr) {
+      *max_covering_tombstone_seq = std::max(
+          *max_covering_tombstone_seq,
+          range_del_list->MaxCoveringTombstoneSeqnum(
+              key.user_key(), GetInternalKeySeqno(key.internal_key())));
+    }
+    max_covering_seq = *max_covering_tombstone_seq;
+  }
+
+  if (bloom_filter_ && max_covering_seq == 0) {
+    if (!MayContain(key.user_key())) {
+      PERF_COUNTER_ADD(bloom_memtable_miss_count, 1);
+      *seq = kMaxSequenceNumber;
+      return false;
+    }
+    PERF_COUNTER_ADD(bloom_memtable_hit_count, 1);
+  }
+  /***************************** Shichao *****************************/
+
   bool found_final_value = false;
+  bool merge_in_progress = s->IsMergeInProgress();
 
   Saver saver;
   saver.status = s;
   saver.found_final_value = &found_final_value;
+  saver.merge_in_progress = &merge_in_progress;
   saver.key = &key;
   saver.get_value = value;
   saver.seq = kMaxSequenceNumber;
+  saver.max_covering_tombstone_seq = max_covering_seq;  // Shichao
+  saver.merge_operator = moptions_.merge_operator;
+  saver.merge_context = merge_context;
   saver.mem = this;
   saver.logger = moptions_.info_log;
   saver.statistics = moptions_.statistics;
@@ -584,7 +794,34 @@ bool MemTable::Get(ReadOptions& read_options, const LookupKey& key,
 
   *seq = saver.seq;
 
+  /***************************** Shichao *****************************/
+  // the tombstone is the most recent operation on the key if newer
+  if (max_covering_seq > 0 &&
+      (*seq == kMaxSequenceNumber || *seq < max_covering_seq)) {
+    *seq = max_covering_seq;
+  }
+
+  // The older memtables and tables only have entries older than the
+  // tombstone, so the lookup ends here as if a deletion was met
+  if (!found_final_value && max_covering_seq > 0) {
+    if (merge_in_progress) {
+      if (value != nullptr) {
+        *s = MergeHelper::TimedFullMerge(
+            key.user_key(), nullptr, merge_context->GetOperands(),
+            moptions_.merge_operator, moptions_.statistics, env_,
+            moptions_.info_log, value);
+      }
+    } else {
+      *s = Status::NotFound();
+    }
+    found_final_value = true;
+  }
+  /***************************** Shichao *****************************/
+
   // No change to value, since we have not yet found a Put/Delete
+  if (!found_final_value && merge_in_progress) {
+    *s = Status::MergeInProgress();
+  }
 
   PERF_COUNTER_ADD(get_from_memtable_count, 1);
   return found_final_value;
@@ -17,9 +17,12 @@
 #include <deque>
 #include <functional>
 #include <memory>
+#include <mutex>
 #include <string>
 #include <vector>
 #include "db/dbformat.h"
+#include "db/merge_context.h"
+#include "db/range_del_aggregator.h"  // Shichao
 #include "memtable/skiplist.h"
 #include "db/version_edit.h"
 #include "vidardb/db.h"
@@ -29,6 +32,7 @@
 #include "vidardb/splitter.h"
 #include "memtable/memtable_allocator.h"
 #include "util/concurrent_arena.h"
+#include "util/dynamic_bloom.h"
 #include "util/instrumented_mutex.h"
 #include "util/mutable_cf_options.h"
 
@@ -48,6 +52,10 @@ struct MemTableOptions {
   Statistics* statistics;
   Logger* info_log;
   const Splitter* splitter;
+  const MergeOperator* merge_operator;
+  uint32_t memtable_prefix_bloom_bits;  // Shichao
+  bool memtable_whole_key_filtering;    // Shichao
+  size_t memtable_huge_page_size;       // Shichao
 };
 
 // Note:  Many of the methods in this class have comments indicating that
@@ -159,7 +167,7 @@ class MemTable {
   // in *status and return true.
   // If memtable contains Merge operation as the most recent entry for a key,
   //   and the merge process does not stop (not reaching a value or delete),
-  //   prepend the current merge operand to *operands.
+  //   prepend the current merge operand to merge_context.
   //   store MergeInProgress in s, and return false.
   // Else, return false.
   // If any operation was found, its most recent sequence number
@@ -167,15 +175,31 @@ class MemTable {
   // returned).  Otherwise, *seq will be set to kMaxSequenceNumber.
   // On success, *s may be set to OK, NotFound, or MergeInProgress.  Any other
   // status returned indicates a corruption or other unexpected error.
+  // *max_covering_tombstone_seq is raised to the newest range tombstone
+  // covering key in this memtable; the entries older than it are deleted,
+  // and so are all the ones of the older memtables and tables.
   bool Get(ReadOptions& read_options, const LookupKey& key, std::string* value,
-           Status* s, SequenceNumber* seq);
+           Status* s, MergeContext* merge_context,
+           SequenceNumber* max_covering_tombstone_seq, SequenceNumber* seq);
 
   bool Get(ReadOptions& read_options, const LookupKey& key, std::string* value,
-           Status* s) {
+           Status* s, MergeContext* merge_context,
+           SequenceNumber* max_covering_tombstone_seq = nullptr) {
     SequenceNumber seq;
-    return Get(read_options, key, value, s, &seq);
+    return Get(read_options, key, value, s, merge_context,
+               max_covering_tombstone_seq, &seq);
   }
 
+  /***************************** Shichao ******************************/
+  // Return the fragmented range tombstones of this memtable, nullptr if
+  // none. The list is rebuilt after a DeleteRange, and shared until then.
+  std::shared_ptr<const FragmentedRangeTombstoneList> GetRangeTombstoneList();
+
+  uint64_t num_range_deletes() const {
+    return num_range_deletes_.load(std::memory_order_relaxed);
+  }
+  /***************************** Shichao ******************************/
+
   /******************************* Shichao *******************************/
   // If memtable overlaps with the range including the deleted key, store
   // it in res and return true.
@@ -284,12 +308,26 @@ class MemTable {
   ConcurrentArena arena_;
   MemTableAllocator allocator_;
   unique_ptr<MemTableRep> table_;
+  /***************************** Shichao ******************************/
+  const SliceTransform* const prefix_extractor_;
+  // Prefixes and/or whole user keys of all the entries, nullptr if disabled
+  std::unique_ptr<DynamicBloom> bloom_filter_;
+  /***************************** Shichao ******************************/
 
   // Total data size of all data inserted
   std::atomic<uint64_t> data_size_;
   std::atomic<uint64_t> num_entries_;
   std::atomic<uint64_t> num_deletes_;
 
+  /***************************** Shichao ******************************/
+  // The range tombstones are not in table_, they would hide the point
+  // entries from the seeks. Their keys are allocated from the arena.
+  std::atomic<uint64_t> num_range_deletes_;
+  std::mutex range_del_mutex_;
+  std::vector<RangeTombstone> range_tombstones_;
+  std::shared_ptr<const FragmentedRangeTombstoneList> range_del_list_;
+  /***************************** Shichao ******************************/
+
   // These are used to manage memtable flushes to storage
   bool flush_in_progress_; // started the flush
   bool flush_completed_;   // finished the flush
@@ -323,6 +361,16 @@ class MemTable {
   // Updates flush_state_ using ShouldFlushNow()
   void UpdateFlushState();
 
+  // Adds the prefix and/or the whole user key to bloom_filter_.
+  void AddToBloomFilter(const Slice& key, bool allow_concurrent);  // Shichao
+
+  // Returns false if the bloom filter rules out the user key.
+  bool MayContain(const Slice& key) const;  // Shichao
+
+  // Add a range tombstone deleting [key, value)
+  void AddRangeTombstone(SequenceNumber seq, const Slice& key,
+                         const Slice& value);  // Shichao
+
   // No copying allowed
   MemTable(const MemTable&);
   MemTable& operator=(const MemTable&);
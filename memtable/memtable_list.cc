@@ -106,10 +106,22 @@ int MemTableList::NumFlushed() const {
 // Operands stores the list of merge operations to apply, so far.
 bool MemTableListVersion::Get(ReadOptions& read_options, const LookupKey& key,
                               std::string* value, Status* s,
+                              MergeContext* merge_context,
+                              SequenceNumber* max_covering_tombstone_seq,
                               SequenceNumber* seq) {
-  return GetFromList(read_options, &memlist_, key, value, s, seq);
+  return GetFromList(read_options, &memlist_, key, value, s, merge_context,
+                     max_covering_tombstone_seq, seq);
 }
 
+/******************************* Shichao *******************************/
+void MemTableListVersion::AddRangeTombstones(
+    RangeDelAggregator* range_del_agg) {
+  for (auto& m : memlist_) {
+    range_del_agg->AddTombstones(m->GetRangeTombstoneList());
+  }
+}
+/******************************* Shichao *******************************/
+
 /******************************* Shichao *******************************/
 bool MemTableListVersion::RangeQuery(ReadOptions& read_options,
                                      const LookupRange& range,
@@ -124,23 +136,26 @@ bool MemTableListVersion::RangeQuery(ReadOptions& read_options,
 }
 /******************************* Shichao *******************************/
 
-bool MemTableListVersion::GetFromHistory(ReadOptions& read_options,
-                                         const LookupKey& key,
-                                         std::string* value, Status* s,
-                                         SequenceNumber* seq) {
-  return GetFromList(read_options, &memlist_history_, key, value, s, seq);
+bool MemTableListVersion::GetFromHistory(
+    ReadOptions& read_options, const LookupKey& key, std::string* value,
+    Status* s, MergeContext* merge_context,
+    SequenceNumber* max_covering_tombstone_seq, SequenceNumber* seq) {
+  return GetFromList(read_options, &memlist_history_, key, value, s,
+                     merge_context, max_covering_tombstone_seq, seq);
 }
 
-bool MemTableListVersion::GetFromList(ReadOptions& read_options,
-                                      std::list<MemTable*>* list,
-                                      const LookupKey& key, std::string* value,
-                                      Status* s, SequenceNumber* seq) {
+bool MemTableListVersion::GetFromList(
+    ReadOptions& read_options, std::list<MemTable*>* list,
+    const LookupKey& key, std::string* value, Status* s,
+    MergeContext* merge_context, SequenceNumber* max_covering_tombstone_seq,
+    SequenceNumber* seq) {
   *seq = kMaxSequenceNumber;
 
   for (auto& memtable : *list) {
     SequenceNumber current_seq = kMaxSequenceNumber;
 
-    bool done = memtable->Get(read_options, key, value, s, &current_seq);
+    bool done = memtable->Get(read_options, key, value, s, merge_context,
+                              max_covering_tombstone_seq, &current_seq);
     if (*seq == kMaxSequenceNumber) {
       // Store the most recent sequence number of any operation on this key.
       // Since we only care about the most recent change, we only need to
@@ -153,6 +168,9 @@ bool MemTableListVersion::GetFromList(ReadOptions& read_options,
       assert(*seq != kMaxSequenceNumber);
       return true;
     }
+    if (!done && !s->ok() && !s->IsMergeInProgress() && !s->IsNotFound()) {
+      return false;
+    }
   }
   return false;
 }
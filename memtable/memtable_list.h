@@ -57,14 +57,20 @@ class MemTableListVersion {
   // will be stored in *seq on success (regardless of whether true/false is
   // returned).  Otherwise, *seq will be set to kMaxSequenceNumber.
   bool Get(ReadOptions& read_options, const LookupKey& key, std::string* value,
-           Status* s, SequenceNumber* seq);
+           Status* s, MergeContext* merge_context,
+           SequenceNumber* max_covering_tombstone_seq, SequenceNumber* seq);
 
   bool Get(ReadOptions& read_options, const LookupKey& key, std::string* value,
-           Status* s) {
+           Status* s, MergeContext* merge_context,
+           SequenceNumber* max_covering_tombstone_seq = nullptr) {
     SequenceNumber seq;
-    return Get(read_options, key, value, s, &seq);
+    return Get(read_options, key, value, s, merge_context,
+               max_covering_tombstone_seq, &seq);
   }
 
+  // Add the range tombstones of all the memtables to range_del_agg.
+  void AddRangeTombstones(RangeDelAggregator* range_del_agg);  // Shichao
+
   /******************************* Shichao *******************************/
   bool RangeQuery(ReadOptions& read_options, const LookupRange& range,
                   std::list<RangeQueryKeyVal>& res, Status* s);
@@ -75,11 +81,17 @@ class MemTableListVersion {
   // queries (such as Transaction validation) as the history may contain
   // writes that are also present in the SST files.
   bool GetFromHistory(ReadOptions& read_options, const LookupKey& key,
-                      std::string* value, Status* s, SequenceNumber* seq);
+                      std::string* value, Status* s,
+                      MergeContext* merge_context,
+                      SequenceNumber* max_covering_tombstone_seq,
+                      SequenceNumber* seq);
   bool GetFromHistory(ReadOptions& read_options, const LookupKey& key,
-                      std::string* value, Status* s) {
+                      std::string* value, Status* s,
+                      MergeContext* merge_context,
+                      SequenceNumber* max_covering_tombstone_seq = nullptr) {
     SequenceNumber seq;
-    return GetFromHistory(read_options, key, value, s, &seq);
+    return GetFromHistory(read_options, key, value, s, merge_context,
+                          max_covering_tombstone_seq, &seq);
   }
 
   void AddIterators(const ReadOptions& options,
@@ -111,6 +123,8 @@ class MemTableListVersion {
 
   bool GetFromList(ReadOptions& read_options, std::list<MemTable*>* list,
                    const LookupKey& key, std::string* value, Status* s,
+                   MergeContext* merge_context,
+                   SequenceNumber* max_covering_tombstone_seq,
                    SequenceNumber* seq);
 
   void AddMemTable(MemTable* m);
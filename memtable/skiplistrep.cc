@@ -264,7 +264,7 @@ public:
 
 MemTableRep* SkipListFactory::CreateMemTableRep(
     const MemTableRep::KeyComparator& compare, MemTableAllocator* allocator,
-    Logger* logger) {
+    const SliceTransform* transform, Logger* logger) {
   return new SkipListRep(compare, allocator, lookahead_);
 }
 
@@ -43,6 +43,11 @@ class VectorRep : public MemTableRep {
   // collection.
   virtual void Insert(KeyHandle handle) override;
 
+  // Insert() already takes the write lock, so it is safe concurrently.
+  virtual void InsertConcurrently(KeyHandle handle) override {
+    Insert(handle);
+  }
+
   // Returns true iff an entry that compares equal to key is in the collection.
   virtual bool Contains(const char* key) const override;
 
@@ -294,7 +299,7 @@ MemTableRep::Iterator* VectorRep::GetIterator(Arena* arena) {
 
 MemTableRep* VectorRepFactory::CreateMemTableRep(
     const MemTableRep::KeyComparator& compare, MemTableAllocator* allocator,
-    Logger* logger) {
+    const SliceTransform* transform, Logger* logger) {
   return new VectorRep(compare, allocator, count_);
 }
 } // namespace vidardb
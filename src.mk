@@ -13,6 +13,7 @@ LIB_SOURCES =                                                   \
   db/db_impl.cc                                                 \
   db/db_impl_debug.cc                                           \
   db/db_impl_readonly.cc                                        \
+  db/db_impl_secondary.cc                                       \
   db/db_info_dumper.cc                                          \
   db/db_iter.cc                                                 \
   db/event_helpers.cc                                           \
@@ -24,10 +25,14 @@ LIB_SOURCES =                                                   \
   db/internal_stats.cc                                          \
   db/log_reader.cc                                              \
   db/log_writer.cc                                              \
+  db/merge_helper.cc                                            \
+  db/perf_sampler.cc                                            \
   memtable/memtable_allocator.cc                                \
   memtable/memtable.cc                                          \
   memtable/memtable_list.cc                                     \
+  db/range_del_aggregator.cc                                    \
   db/repair.cc                                                  \
+  db/row_cache_entry.cc                                         \
   db/snapshot_impl.cc                                           \
   db/table_cache.cc                                             \
   db/table_properties_collector.cc                              \
@@ -41,6 +46,8 @@ LIB_SOURCES =                                                   \
   db/write_thread.cc                                            \
   memtable/skiplistrep.cc                                       \
   memtable/vectorrep.cc                                         \
+  memtable/bulkloadrep.cc                                       \
+  memtable/hash_skiplist_rep.cc                                 \
   port/stack_trace.cc                                           \
   port/port_posix.cc                                            \
   table/adaptive_table_factory.cc                               \
@@ -53,13 +60,16 @@ LIB_SOURCES =                                                   \
   table/block_builder.cc                                        \
   table/block.cc                                                \
   table/column_block_builder.cc                                 \
+  table/data_block_hash_index.cc                                \
   table/flush_block_policy.cc                                   \
   table/format.cc                                               \
   table/get_context.cc                                          \
+  table/index_builder.cc                                        \
   table/iterator.cc                                             \
   table/merger.cc                                               \
   table/meta_blocks.cc                                          \
   table/sst_file_writer.cc                                      \
+  table/table_open_state.cc                                     \
   table/table_properties.cc                                     \
   table/two_level_iterator.cc                                   \
   util/arena.cc                                                 \
@@ -68,10 +78,12 @@ LIB_SOURCES =                                                   \
   util/coding.cc                                                \
   util/comparator.cc                                            \
   util/splitter.cc                                              \
+  util/merge_operator.cc                                        \
   util/compaction_job_stats_impl.cc                             \
   util/concurrent_arena.cc                                      \
   util/crc32c.cc                                                \
   util/delete_scheduler.cc                                      \
+  util/dynamic_bloom.cc                                         \
   util/env.cc                                                   \
   util/env_posix.cc                                             \
   util/io_posix.cc                                              \
@@ -86,6 +98,7 @@ LIB_SOURCES =                                                   \
   util/event_logger.cc                                          \
   util/log_buffer.cc                                            \
   util/logging.cc                                               \
+  util/memory_allocator.cc                                      \
   util/murmurhash.cc                                            \
   util/mutable_cf_options.cc                                    \
   util/options.cc                                               \
@@ -95,6 +108,7 @@ LIB_SOURCES =                                                   \
   util/perf_context.cc                                          \
   util/perf_level.cc                                            \
   util/random.cc                                                \
+  util/rate_limiter.cc                                          \
   util/slice.cc                                                 \
   util/statistics.cc                                            \
   util/status.cc                                                \
@@ -107,6 +121,10 @@ LIB_SOURCES =                                                   \
   util/thread_status_updater_debug.cc                           \
   util/thread_status_util.cc                                    \
   util/thread_status_util_debug.cc                              \
+  util/ttl_compaction_filter.cc                                 \
+  util/xxh3.cc                                                  \
+  utilities/backup/backup_engine.cc                             \
+  utilities/checkpoint/checkpoint.cc                            \
   utilities/write_batch_with_index/write_batch_with_index.cc    \
   utilities/write_batch_with_index/write_batch_with_index_internal.cc    \
   utilities/transactions/transaction_db_mutex_impl.cc           \
@@ -115,6 +133,8 @@ LIB_SOURCES =                                                   \
   utilities/transactions/transaction_impl.cc                    \
   utilities/transactions/transaction_lock_mgr.cc                \
   utilities/transactions/transaction_db_impl.cc                 \
+  utilities/transactions/optimistic_transaction_impl.cc         \
+  utilities/transactions/optimistic_transaction_db_impl.cc      \
 
 TOOL_SOURCES = \
 
@@ -160,6 +180,8 @@ TEST_BENCH_SOURCES =                                                         \
   test/db/log_test.cc                                                        \
   test/db/manual_compaction_test.cc                                          \
   tools/memtablerep_bench.cc                                              \
+  tools/splitter_bench.cc                                       \
+  tools/hash_bench.cc                                           \
   test/db/options_file_test.cc                                               \
   test/db/perf_context_test.cc                                               \
   test/db/skiplist_test.cc                                                   \
@@ -182,6 +204,7 @@ TEST_BENCH_SOURCES =                                                         \
   test/util/cache_test.cc                                                    \
   test/util/coding_test.cc                                                   \
   test/util/crc32c_test.cc                                                   \
+  test/util/xxh3_test.cc                                                     \
   test/util/env_test.cc                                                      \
   test/util/filelock_test.cc                                                 \
   test/util/histogram_test.cc                                                \
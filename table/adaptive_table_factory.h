@@ -67,7 +67,7 @@ class AdaptiveTableFactory : public TableFactory {
   void SetOutputLevel(
       const std::string& file_name, int output_level);
 
-  int GetKnob() const { return knob_; }
+  int GetKnob() const override { return knob_; }
   /********************** Shichao **********************/
 
  private:
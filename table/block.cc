@@ -100,6 +100,54 @@ void BlockIter::Seek(const Slice& target) {
   }
 }
 
+/***************************** Shichao ******************************/
+bool BlockIter::SeekForGet(const Slice& target) {
+  if (data_block_hash_index_ == nullptr) {
+    Seek(target);
+    return true;
+  }
+  if (data_ == nullptr) {  // Not init yet
+    return true;
+  }
+
+  Slice user_key = ExtractUserKey(target);
+  uint8_t entry = data_block_hash_index_->Lookup(data_, user_key);
+  if (entry == kCollision) {
+    Seek(target);
+    return true;
+  }
+
+  PERF_TIMER_GUARD(block_seek_nanos);
+  uint32_t index;
+  if (entry == kNoEntry) {
+    // the user key is not in this block, but it might be in the next one if
+    // it is larger than all the keys here, which the last restart interval
+    // tells
+    index = num_restarts_ - 1;
+  } else {
+    index = entry;
+    if (index >= num_restarts_) {
+      CorruptionError();
+      return true;
+    }
+  }
+  SeekToRestartPoint(index);
+  // Linear search (within restart block) for first key >= target
+  while (true) {
+    if (!ParseNextKey() || Compare(key_.GetKey(), target) >= 0) {
+      break;
+    }
+  }
+
+  if (!Valid()) {
+    // at the end of the block, the key might be in the next one
+    return true;
+  }
+  // an entry >= target of another user key, or a false positive of the hash
+  return ExtractUserKey(key_.GetKey()) == user_key;
+}
+/***************************** Shichao ******************************/
+
 void BlockIter::SeekToFirst() {
   if (data_ == nullptr) {  // Not init yet
     return;
@@ -200,7 +248,8 @@ bool BlockIter::BinarySeek(const Slice& target, uint32_t left, uint32_t right,
 
 uint32_t Block::NumRestarts() const {
   assert(size_ >= 2*sizeof(uint32_t));
-  return DecodeFixed32(data_ + size_ - sizeof(uint32_t));
+  return DecodeFixed32(data_ + size_ - sizeof(uint32_t)) &
+         ~kDataBlockHashIndexFlag;  // Shichao
 }
 
 Block::Block(BlockContents&& contents)
@@ -210,13 +259,21 @@ Block::Block(BlockContents&& contents)
   if (size_ < sizeof(uint32_t)) {
     size_ = 0;  // Error marker
   } else {
-    restart_offset_ =
-        static_cast<uint32_t>(size_) - (1 + NumRestarts()) * sizeof(uint32_t);
-    if (restart_offset_ > size_ - sizeof(uint32_t)) {
+    /***************************** Shichao ******************************/
+    uint32_t footer_offset = static_cast<uint32_t>(size_) - sizeof(uint32_t);
+    uint32_t restarts_end = footer_offset;
+    bool ok = true;
+    if (DecodeFixed32(data_ + footer_offset) & kDataBlockHashIndexFlag) {
+      restarts_end = data_block_hash_index_.Initialize(data_, footer_offset);
+      ok = data_block_hash_index_.Valid();
+    }
+    restart_offset_ = restarts_end - NumRestarts() * sizeof(uint32_t);
+    if (!ok || restart_offset_ > restarts_end) {
       // The size is too small for NumRestarts() and therefore
       // restart_offset_ wrapped around.
       size_ = 0;
     }
+    /***************************** Shichao ******************************/
   }
 }
 
@@ -243,15 +300,57 @@ static inline const char* DecodeKeyOrValue(const char* p, const char* limit,
   return p;
 }
 
+/***************************** Shichao ******************************/
+bool ColumnBlockIter::RestartPosition(uint32_t index, uint64_t* pos) {
+  uint32_t key_length;
+  const char* key_ptr = DecodeKeyOrValue(data_ + GetRestartPoint(index),
+                                         data_ + restarts_, &key_length);
+  if (key_ptr == nullptr) {
+    return false;
+  }
+  Slice key(key_ptr, key_length);
+  return GetFixed64BigEndian(&key, pos);
+}
+
+// Every restart interval holds the same number of consecutive positions, so
+// the restart interval of a position is computed from the first two restart
+// points instead of a binary search.
+bool ColumnBlockIter::PositionSeek(uint64_t target_pos, uint32_t* index) {
+  uint64_t first_pos = 0, second_pos = 0;
+  if (num_restarts_ < 2 || !RestartPosition(0, &first_pos) ||
+      !RestartPosition(1, &second_pos) || second_pos <= first_pos) {
+    return false;
+  }
+  if (target_pos <= first_pos) {
+    *index = 0;
+    return true;
+  }
+  uint64_t guess = (target_pos - first_pos) / (second_pos - first_pos);
+  *index = static_cast<uint32_t>(
+      std::min<uint64_t>(guess, num_restarts_ - 1));
+  // verify the guess, in case of a block not built that way
+  uint64_t restart_pos = 0, next_pos = 0;
+  return RestartPosition(*index, &restart_pos) && restart_pos <= target_pos &&
+         (*index + 1 == num_restarts_ ||
+          (RestartPosition(*index + 1, &next_pos) && next_pos > target_pos));
+}
+/***************************** Shichao ******************************/
+
 void ColumnBlockIter::Seek(const Slice& target) {
   PERF_TIMER_GUARD(block_seek_nanos);
   if (data_ == nullptr) {  // Not init yet
     return;
   }
+
+  uint64_t target_pos = 0;
+  GetFixed64BigEndian(&target, &target_pos);
+
   uint32_t index = 0;
-  bool ok = BinarySeek(target, 0, num_restarts_ - 1, &index);
-  if (!ok) {
-    return;
+  if (!PositionSeek(target_pos, &index)) {  // Shichao
+    bool ok = BinarySeek(target, 0, num_restarts_ - 1, &index);
+    if (!ok) {
+      return;
+    }
   }
 
   SeekToRestartPoint(index);
@@ -264,9 +363,6 @@ void ColumnBlockIter::Seek(const Slice& target) {
   uint64_t restart_pos = 0;
   GetFixed64BigEndian(&key, &restart_pos);
 
-  uint64_t target_pos = 0;
-  GetFixed64BigEndian(&target, &target_pos);
-
   uint64_t step = target_pos - restart_pos;
 
   // Linear search (within restart block) for first key >= target
@@ -379,6 +475,9 @@ InternalIterator* Block::NewIterator(const Comparator* cmp, BlockIter* iter,
               new ColumnBlockIter(cmp, data_, restart_offset_, num_restarts):
               new BlockIter(cmp, data_, restart_offset_, num_restarts);
     }
+    if (data_block_hash_index_.Valid()) {  // Shichao
+      iter->InitializeHashIndex(&data_block_hash_index_);
+    }
   }
 
   return iter;
@@ -19,6 +19,7 @@
 #include "vidardb/iterator.h"
 #include "vidardb/options.h"
 #include "table/internal_iterator.h"
+#include "table/data_block_hash_index.h"  // Shichao
 
 #include "format.h"
 
@@ -42,6 +43,12 @@ class Block {
   bool cachable() const { return contents_.cachable; }
 
   size_t usable_size() const {
+    /***************************** Shichao ******************************/
+    MemoryAllocator* allocator = contents_.allocation.get_deleter().allocator;
+    if (allocator != nullptr && contents_.allocation.get() != nullptr) {
+      return allocator->UsableSize(contents_.allocation.get(), size_);
+    }
+    /***************************** Shichao ******************************/
 #ifdef VIDARDB_MALLOC_USABLE_SIZE
     if (contents_.allocation.get() != nullptr) {
       return malloc_usable_size(contents_.allocation.get());
@@ -69,6 +76,7 @@ class Block {
   const char* data_;            // contents_.data.data()
   size_t size_;                 // contents_.data.size()
   uint32_t restart_offset_;     // Offset in data_ of restart array
+  DataBlockHashIndex data_block_hash_index_;  // Shichao
 
   // No copying allowed
   Block(const Block&);
@@ -84,7 +92,8 @@ class BlockIter : public InternalIterator {
         num_restarts_(0),
         current_(0),
         restart_index_(0),
-        status_(Status::OK()) {}
+        status_(Status::OK()),
+        data_block_hash_index_(nullptr) {}
 
   BlockIter(const Comparator* comparator, const char* data, uint32_t restarts,
             uint32_t num_restarts)
@@ -109,6 +118,19 @@ class BlockIter : public InternalIterator {
     status_ = s;
   }
 
+  /***************************** Shichao ******************************/
+  // Called after Initialize() for a block with a hash index.
+  void InitializeHashIndex(const DataBlockHashIndex* data_block_hash_index) {
+    data_block_hash_index_ = data_block_hash_index;
+  }
+
+  // Seek to the first entry >= target of a point lookup, with the hash index
+  // of the block if any. Return false if the user key of target is neither in
+  // this block nor in the following blocks, in which case the iterator is
+  // not necessarily positioned as Seek() does.
+  virtual bool SeekForGet(const Slice& target);
+  /***************************** Shichao ******************************/
+
   virtual bool Valid() const override { return current_ < restarts_; }
 
   virtual Status status() const override { return status_; }
@@ -162,6 +184,7 @@ class BlockIter : public InternalIterator {
   IterKey key_;
   Slice value_;
   Status status_;
+  const DataBlockHashIndex* data_block_hash_index_;  // Shichao
 
   virtual inline int Compare(const Slice& a, const Slice& b) const {
     return comparator_->Compare(a, b);
@@ -212,6 +235,14 @@ class ColumnBlockIter : public BlockIter {
 
   virtual bool BinarySeek(const Slice& target, uint32_t left, uint32_t right,
                           uint32_t* index) override;
+
+  /***************************** Shichao ******************************/
+  // Decode the position of the key of restart point index.
+  bool RestartPosition(uint32_t index, uint64_t* pos);
+
+  // Find the restart interval of target_pos in O(1), false if unable to.
+  bool PositionSeek(uint64_t target_pos, uint32_t* index);
+  /***************************** Shichao ******************************/
 };
 
 }  // namespace vidardb
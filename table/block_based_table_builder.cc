@@ -31,123 +31,20 @@
 #include "table/block_builder.h"
 #include "table/block_based_table_factory.h"
 #include "table/format.h"
+#include "table/index_builder.h"
 #include "table/meta_blocks.h"
 #include "table/table_builder.h"
 
 #include "util/string_util.h"
 #include "util/coding.h"
 #include "util/compression.h"
-#include "util/crc32c.h"
 #include "util/stop_watch.h"
 
 namespace vidardb {
 
-// The interface for building index.
-// Instruction for adding a new concrete IndexBuilder:
-//  1. Create a subclass instantiated from IndexBuilder.
-//  2. Add a new entry associated with that subclass in TableOptions::IndexType.
-//  3. Add a create function for the new subclass in CreateIndexBuilder.
-// Note: we can devise more advanced design to simplify the process for adding
-// new subclass, which will, on the other hand, increase the code complexity and
-// catch unwanted attention from readers. Given that we won't add/change
-// indexes frequently, it makes sense to just embrace a more straightforward
-// design that just works.
-class IndexBuilder {
- public:
-  // Index builder will construct a set of blocks which contain:
-  //  1. One primary index block.
-  struct IndexBlocks {
-    Slice index_block_contents;
-  };
-  explicit IndexBuilder(const Comparator* comparator)
-      : comparator_(comparator) {}
-
-  virtual ~IndexBuilder() {}
-
-  // Add a new index entry to index block.
-  // To allow further optimization, we provide `last_key_in_current_block` and
-  // `first_key_in_next_block`, based on which the specific implementation can
-  // determine the best index key to be used for the index block.
-  // @last_key_in_current_block: this parameter maybe overridden with the value
-  //                             "substitute key".
-  // @first_key_in_next_block: it will be nullptr if the entry being added is
-  //                           the last one in the table
-  //
-  // REQUIRES: Finish() has not yet been called.
-  virtual void AddIndexEntry(std::string* last_key_in_current_block,
-                             const Slice* first_key_in_next_block,
-                             const BlockHandle& block_handle) = 0;
-
-  // This method will be called whenever a key is added. The subclasses may
-  // override OnKeyAdded() if they need to collect additional information.
-  virtual void OnKeyAdded(const Slice& key) {}
-
-  // Inform the index builder that all entries has been written. Block builder
-  // may therefore perform any operation required for block finalization.
-  //
-  // REQUIRES: Finish() has not yet been called.
-  virtual Status Finish(IndexBlocks* index_blocks) = 0;
-
-  // Get the estimated size for index block.
-  virtual size_t EstimatedSize() const = 0;
-
- protected:
-  const Comparator* comparator_;
-};
-
-// This index builder builds space-efficient index block.
-//
-// Optimizations:
-//  1. Made block's `block_restart_interval` to be 1, which will avoid linear
-//     search when doing index lookup (can be disabled by setting
-//     index_block_restart_interval).
-//  2. Shorten the key length for index block. Other than honestly using the
-//     last key in the data block as the index key, we instead find a shortest
-//     substitute key that serves the same function.
-class ShortenedIndexBuilder : public IndexBuilder {
- public:
-  explicit ShortenedIndexBuilder(const Comparator* comparator,
-                                 int index_block_restart_interval)
-      : IndexBuilder(comparator),
-        index_block_builder_(index_block_restart_interval) {}
-
-  virtual void AddIndexEntry(std::string* last_key_in_current_block,
-                             const Slice* first_key_in_next_block,
-                             const BlockHandle& block_handle) override {
-    if (first_key_in_next_block != nullptr) {
-      comparator_->FindShortestSeparator(last_key_in_current_block,
-                                         *first_key_in_next_block);
-    } else {
-      comparator_->FindShortSuccessor(last_key_in_current_block);
-    }
-
-    std::string handle_encoding;
-    block_handle.EncodeTo(&handle_encoding);
-    index_block_builder_.Add(*last_key_in_current_block, handle_encoding);
-  }
-
-  virtual Status Finish(IndexBlocks* index_blocks) override {
-    index_blocks->index_block_contents = index_block_builder_.Finish();
-    return Status::OK();
-  }
-
-  virtual size_t EstimatedSize() const override {
-    return index_block_builder_.CurrentSizeEstimate();
-  }
-
- private:
-  BlockBuilder index_block_builder_;
-};
-
 // Without anonymous namespace here, we fail the warning -Wmissing-prototypes
 namespace {
 
-// Create a index builder based on its type.
-IndexBuilder* CreateIndexBuilder(const Comparator* comparator,
-                                 int index_block_restart_interval) {
-  return new ShortenedIndexBuilder(comparator, index_block_restart_interval);
-}
-
 bool GoodCompressionRatio(size_t compressed_size, size_t raw_size) {
   // Check to see if compressed less than 12.5%
   return compressed_size < raw_size - (raw_size / 8u);
@@ -218,6 +115,7 @@ struct BlockBasedTableBuilder::Rep {
   uint64_t offset = 0;
   Status status;
   BlockBuilder data_block;
+  BlockBuilder range_del_block;  // Shichao
 
   std::unique_ptr<IndexBuilder> index_builder;
 
@@ -253,10 +151,15 @@ struct BlockBasedTableBuilder::Rep {
         table_options(table_opt),
         internal_comparator(icomparator),
         file(f),
-        data_block(table_options.block_restart_interval),
+        data_block(table_options.block_restart_interval,
+                   table_options.data_block_index_type ==
+                       TableOptions::kDataBlockBinaryAndHash,
+                   table_options.data_block_hash_table_util_ratio),
+        range_del_block(1 /* block_restart_interval */),  // Shichao
         index_builder(
-            CreateIndexBuilder(&internal_comparator,
-                               table_options.index_block_restart_interval)),
+            CreateIndexBuilder(table_options.index_type, &internal_comparator,
+                               table_options.index_block_restart_interval,
+                               table_options.metadata_block_size)),
         compression_type(_compression_type),
         compression_opts(_compression_opts),
         compression_dict(_compression_dict),
@@ -298,6 +201,14 @@ void BlockBasedTableBuilder::Add(const Slice& key, const Slice& value) {
   Rep* r = rep_;
   assert(!r->closed);
   if (!ok()) return;
+  /***************************** Shichao ******************************/
+  // the range tombstones are kept in their own meta block
+  if (ExtractValueType(key) == kTypeRangeDeletion) {
+    r->range_del_block.Add(key, value);
+    r->props.num_range_deletions++;
+    return;
+  }
+  /***************************** Shichao ******************************/
   if (r->props.num_entries > 0) {
     assert(r->internal_comparator.Compare(key, Slice(r->last_key)) > 0);
   }
@@ -392,9 +303,10 @@ void BlockBasedTableBuilder::WriteRawBlock(const Slice& block_contents,
     trailer[0] = type;
     char* trailer_without_type = trailer + 1;
 
-    auto crc = crc32c::Value(block_contents.data(), block_contents.size());
-    crc = crc32c::Extend(crc, trailer, 1);  // Extend to cover block type
-    EncodeFixed32(trailer_without_type, crc32c::Mask(crc));
+    EncodeFixed32(trailer_without_type,  // Shichao
+                  ComputeBlockChecksum(r->table_options.checksum,
+                                       block_contents.data(),
+                                       block_contents.size(), type));
 
     r->status = r->file->Append(Slice(trailer, kBlockTrailerSize));
     if (r->status.ok()) {
@@ -427,17 +339,27 @@ Status BlockBasedTableBuilder::Finish() {
 
   IndexBuilder::IndexBlocks index_blocks;
   auto s = r->index_builder->Finish(&index_blocks);
-  if (!s.ok()) {
+  if (!s.ok() && !s.IsIncomplete()) {  // Shichao
     return s;
   }
 
   // Write meta blocks and metaindex block with the following order.
-  //    1. [properties]
-  //    2. [compression_dict]
-  //    3. [meta_index_builder]
-  //    4. [index_blocks]
+  //    1. [range_del]
+  //    2. [properties]
+  //    3. [compression_dict]
+  //    4. [meta_index_builder]
+  //    5. [index_blocks]
   MetaIndexBuilder meta_index_builder;
 
+  /***************************** Shichao ******************************/
+  if (ok() && !r->range_del_block.empty()) {
+    BlockHandle range_del_block_handle;
+    WriteRawBlock(r->range_del_block.Finish(), kNoCompression,
+                  &range_del_block_handle);
+    meta_index_builder.Add(kRangeDelBlock, range_del_block_handle);
+  }
+  /***************************** Shichao ******************************/
+
   if (ok()) {
     // Write properties and compression dictionary blocks.
     {
@@ -466,6 +388,13 @@ Status BlockBasedTableBuilder::Finish() {
 
       // Add basic properties
       property_block_builder.AddTableProperty(r->props);
+      /***************************** Shichao ******************************/
+      if (r->table_options.index_type != TableOptions::kBinarySearch) {
+        property_block_builder.Add(
+            kIndexTypeProperty,
+            static_cast<uint64_t>(r->table_options.index_type));
+      }
+      /***************************** Shichao ******************************/
 
       // Add user collected properties
       NotifyCollectTableCollectorsOnFinish(r->table_properties_collectors,
@@ -492,15 +421,32 @@ Status BlockBasedTableBuilder::Finish() {
     // flush the meta index block
     WriteRawBlock(meta_index_builder.Finish(), kNoCompression,
                   &metaindex_block_handle);
-    WriteBlock(index_blocks.index_block_contents, &index_block_handle, false);
+    /***************************** Shichao ******************************/
+    // a partitioned index writes its partitions before the top level index
+    while (ok() && s.IsIncomplete()) {
+      WriteBlock(index_blocks.index_block_contents, &index_block_handle,
+                 false);
+      if (!ok()) {
+        break;
+      }
+      s = r->index_builder->Finish(&index_blocks, index_block_handle);
+      if (!s.ok() && !s.IsIncomplete()) {
+        return s;
+      }
+    }
+    /***************************** Shichao ******************************/
+    if (ok()) {
+      WriteBlock(index_blocks.index_block_contents, &index_block_handle,
+                 false);
+    }
   }
 
   // Write footer
   if (ok()) {
-    // No need to write out new footer if we're using default checksum.
     Footer footer(kBlockBasedTableMagicNumber);
     footer.set_metaindex_handle(metaindex_block_handle);
     footer.set_index_handle(index_block_handle);
+    footer.set_checksum(r->table_options.checksum);  // Shichao
     std::string footer_encoding;
     footer.EncodeTo(&footer_encoding);
     r->status = r->file->Append(footer_encoding);
@@ -518,7 +464,7 @@ void BlockBasedTableBuilder::Abandon() {
 }
 
 uint64_t BlockBasedTableBuilder::NumEntries() const {
-  return rep_->props.num_entries;
+  return rep_->props.num_entries + rep_->props.num_range_deletions;
 }
 
 uint64_t BlockBasedTableBuilder::FileSize() const {
@@ -13,14 +13,18 @@
 // found in the LICENSE file. See the AUTHORS file for names of contributors.
 #include "table/block_based_table_reader.h"
 
+#include <algorithm>
 #include <string>
+#include <unordered_map>
 #include <utility>
 
 #include "db/dbformat.h"
+#include "db/range_del_aggregator.h"  // Shichao
 #include "table/block.h"
 #include "table/block_based_table_factory.h"
 #include "table/format.h"
 #include "table/get_context.h"
+#include "table/index_builder.h"
 #include "table/internal_iterator.h"
 #include "table/meta_blocks.h"
 #include "table/two_level_iterator.h"
@@ -58,10 +62,12 @@ Status ReadBlockFromFile(RandomAccessFileReader* file, const Footer& footer,
                          const ReadOptions& options, const BlockHandle& handle,
                          std::unique_ptr<Block>* result, Env* env,
                          bool do_uncompress, const Slice& compression_dict,
-                         Logger* info_log) {
+                         Logger* info_log,
+                         MemoryAllocator* memory_allocator = nullptr) {
   BlockContents contents;
   Status s = ReadBlockContents(file, footer, options, handle, &contents, env,
-                               do_uncompress, compression_dict, info_log);
+                               do_uncompress, compression_dict, info_log,
+                               memory_allocator);
   if (s.ok()) {
     result->reset(new Block(std::move(contents)));
   }
@@ -139,8 +145,10 @@ class BlockBasedTable::IndexReader {
 
   // Create an iterator for index access.
   // An iter is passed in, if it is not null, update this one and return it
-  // If it is null, create a new Iterator
-  virtual InternalIterator* NewIterator(BlockIter* iter = nullptr) = 0;
+  // If it is null, create a new Iterator. An index of several blocks may
+  // return a new Iterator anyway, read_options applies to its blocks.
+  virtual InternalIterator* NewIterator(const ReadOptions& read_options,
+                                        BlockIter* iter = nullptr) = 0;
 
   // The size of the index.
   virtual size_t size() const = 0;
@@ -186,7 +194,8 @@ class BinarySearchIndexReader : public IndexReader {
     return s;
   }
 
-  virtual InternalIterator* NewIterator(BlockIter* iter = nullptr) override {
+  virtual InternalIterator* NewIterator(const ReadOptions& read_options,
+                                        BlockIter* iter = nullptr) override {
     return index_block_->NewIterator(comparator_, iter);
   }
 
@@ -273,11 +282,14 @@ struct BlockBasedTable::Rep {
   unique_ptr<IndexReader> index_reader;
 
   std::shared_ptr<const TableProperties> table_properties;
+  int level = -1;  // Shichao
   // Block containing the data for the compression dictionary. We take ownership
   // for the entire block struct, even though we only use its Slice member. This
   // is easier because the Slice member depends on the continued existence of
   // another member ("allocation").
   std::unique_ptr<const BlockContents> compression_dict_block;
+  // the fragmented range tombstones, nullptr if none, Shichao
+  std::shared_ptr<const FragmentedRangeTombstoneList> range_del_list;
 };
 
 // Load the meta-block from the file. On success, return the loaded meta block
@@ -445,7 +457,8 @@ InternalIterator* BlockBasedTable::NewDataBlockIterator(
         s = ReadBlockFromFile(rep->file.get(), rep->footer,
                               read_options, handle, &raw_block,
                               rep->ioptions.env, true, compression_dict,
-                              rep->ioptions.info_log);
+                              rep->ioptions.info_log,
+                              block_cache->memory_allocator());
       }
 
       if (s.ok()) {
@@ -495,6 +508,127 @@ InternalIterator* BlockBasedTable::NewDataBlockIterator(
   return iter;
 }
 
+/***************************** Shichao ******************************/
+// Index of two levels. The top level index is held by the reader, its entries
+// point to the partitions of the index, which are read through the block
+// cache like data blocks, or pinned by the reader for a level 0 table if
+// pin_l0_index_partitions.
+class BlockBasedTable::PartitionIndexReader : public IndexReader {
+ public:
+  static Status Create(BlockBasedTable* table, const BlockHandle& index_handle,
+                       IndexReader** index_reader) {
+    Rep* rep = table->rep_;
+    std::unique_ptr<Block> index_block;
+    auto s = ReadBlockFromFile(rep->file.get(), rep->footer, ReadOptions(),
+                               index_handle, &index_block, rep->ioptions.env,
+                               true /* decompress */,
+                               Slice() /*compression dict*/,
+                               /*info_log*/ nullptr);
+    if (!s.ok()) {
+      return s;
+    }
+
+    std::unique_ptr<PartitionIndexReader> reader(
+        new PartitionIndexReader(table, std::move(index_block)));
+    if (rep->level == 0 && rep->table_options.pin_l0_index_partitions) {
+      s = reader->PinPartitions();
+    }
+    if (s.ok()) {
+      *index_reader = reader.release();
+    }
+    return s;
+  }
+
+  virtual InternalIterator* NewIterator(const ReadOptions& read_options,
+                                        BlockIter* iter = nullptr) override {
+    return NewTwoLevelIterator(
+        new PartitionIteratorState(this, read_options),
+        index_block_->NewIterator(comparator_));
+  }
+
+  virtual size_t size() const override { return index_block_->size(); }
+  virtual size_t usable_size() const override {
+    return index_block_->usable_size() + pinned_usable_size_;
+  }
+
+  virtual size_t ApproximateMemoryUsage() const override {
+    size_t usage = index_block_->ApproximateMemoryUsage();
+    for (const auto& it : partitions_) {
+      usage += it.second->ApproximateMemoryUsage();
+    }
+    return usage;
+  }
+
+ private:
+  class PartitionIteratorState : public TwoLevelIteratorState {
+   public:
+    PartitionIteratorState(PartitionIndexReader* reader,
+                           const ReadOptions& read_options)
+        : reader_(reader), read_options_(read_options) {}
+
+    InternalIterator* NewSecondaryIterator(const Slice& index_value) override {
+      if (!reader_->partitions_.empty()) {
+        BlockHandle handle;
+        Slice input = index_value;
+        if (handle.DecodeFrom(&input).ok()) {
+          auto it = reader_->partitions_.find(handle.offset());
+          if (it != reader_->partitions_.end()) {
+            return it->second->NewIterator(reader_->comparator_);
+          }
+        }
+      }
+      return NewDataBlockIterator(reader_->table_->rep_, read_options_,
+                                  index_value);
+    }
+
+   private:
+    PartitionIndexReader* reader_;
+    const ReadOptions read_options_;
+  };
+
+  PartitionIndexReader(BlockBasedTable* table,
+                       std::unique_ptr<Block>&& index_block)
+      : IndexReader(&table->rep_->internal_comparator,
+                    table->rep_->ioptions.statistics),
+        table_(table),
+        index_block_(std::move(index_block)) {
+    assert(index_block_ != nullptr);
+  }
+
+  Status PinPartitions() {
+    Rep* rep = table_->rep_;
+    std::unique_ptr<InternalIterator> iter(
+        index_block_->NewIterator(comparator_));
+    for (iter->SeekToFirst(); iter->Valid(); iter->Next()) {
+      BlockHandle handle;
+      Slice input = iter->value();
+      Status s = handle.DecodeFrom(&input);
+      if (!s.ok()) {
+        return s;
+      }
+      std::unique_ptr<Block> partition;
+      s = ReadBlockFromFile(rep->file.get(), rep->footer, ReadOptions(),
+                            handle, &partition, rep->ioptions.env,
+                            true /* decompress */,
+                            Slice() /*compression dict*/,
+                            rep->ioptions.info_log);
+      if (!s.ok()) {
+        return s;
+      }
+      pinned_usable_size_ += partition->usable_size();
+      partitions_[handle.offset()] = std::move(partition);
+    }
+    return iter->status();
+  }
+
+  BlockBasedTable* table_;  // not owned
+  std::unique_ptr<Block> index_block_;  // top level index
+  // pinned partitions by their offsets
+  std::unordered_map<uint64_t, std::unique_ptr<Block>> partitions_;
+  size_t pinned_usable_size_ = 0;
+};
+/***************************** Shichao ******************************/
+
 Status BlockBasedTable::CreateIndexReader(IndexReader** index_reader) {
   auto file = rep_->file.get();
   auto env = rep_->ioptions.env;
@@ -502,6 +636,13 @@ Status BlockBasedTable::CreateIndexReader(IndexReader** index_reader) {
   const Footer& footer = rep_->footer;
   Statistics* stats = rep_->ioptions.statistics;
 
+  /***************************** Shichao ******************************/
+  if (GetIndexType(rep_->table_properties.get()) ==
+      TableOptions::kTwoLevelIndexSearch) {
+    return PartitionIndexReader::Create(this, footer.index_handle(),
+                                        index_reader);
+  }
+  /***************************** Shichao ******************************/
   return BinarySearchIndexReader::Create(file, footer, footer.index_handle(),
                                          env, comparator, index_reader, stats);
 }
@@ -511,7 +652,7 @@ InternalIterator* BlockBasedTable::NewIndexIterator(
     CachableEntry<IndexReader>* index_entry) {
   // index reader has already been pre-populated.
   if (rep_->index_reader) {
-    return rep_->index_reader->NewIterator(input_iter);
+    return rep_->index_reader->NewIterator(read_options, input_iter);
   }
 
   PERF_TIMER_GUARD(read_index_block_nanos);
@@ -566,7 +707,7 @@ InternalIterator* BlockBasedTable::NewIndexIterator(
   }
 
   assert(cache_handle);
-  auto* iter = index_reader->NewIterator(input_iter);
+  auto* iter = index_reader->NewIterator(read_options, input_iter);
 
   // the caller would like to take ownership of the index block
   // don't call RegisterCleanup() in this case, the caller will take care of it
@@ -725,6 +866,7 @@ Status BlockBasedTable::Open(const ImmutableCFOptions& ioptions,
                                       internal_comparator);
   rep->file = std::move(file);
   rep->footer = footer;
+  rep->level = level;  // Shichao
   SetupCacheKeyPrefix(rep, file_size);
   unique_ptr<BlockBasedTable> new_table(new BlockBasedTable(rep));
 
@@ -786,6 +928,24 @@ Status BlockBasedTable::Open(const ImmutableCFOptions& ioptions,
     }
   }
 
+  /***************************** Shichao ******************************/
+  // Read the range deletion meta block, the reads are wrong without it
+  bool found_range_del_block;
+  s = SeekToRangeDelBlock(meta_iter.get(), &found_range_del_block);
+  if (s.ok() && found_range_del_block) {
+    s = vidardb::ReadRangeDelBlock(rep->file.get(), file_size,
+                                   kBlockBasedTableMagicNumber, rep->ioptions.env,
+                                   rep->internal_comparator,
+                                   &rep->range_del_list);
+  }
+  if (!s.ok()) {
+    Log(InfoLogLevel::ERROR_LEVEL, rep->ioptions.info_log,
+        "Encountered error while reading range deletion block %s",
+        s.ToString().c_str());
+    return s;
+  }
+  /***************************** Shichao ******************************/
+
   if (prefetch_index) {
     // pre-fetching of blocks is turned on
     // If we don't use block cache for index blocks access, we'll
@@ -820,6 +980,23 @@ class BlockBasedTable::BlockEntryIteratorState : public TwoLevelIteratorState {
     return NewDataBlockIterator(table_->rep_, read_options_, index_value);
   }
 
+  /***************************** Shichao ******************************/
+  // An index key separates its data block from the next one.
+  bool KeyReachedUpperBound(const Slice& index_key) override {
+    return read_options_.iterate_upper_bound != nullptr &&
+           table_->rep_->internal_comparator.user_comparator()->Compare(
+               ExtractUserKey(index_key),
+               *read_options_.iterate_upper_bound) >= 0;
+  }
+
+  bool KeyBeforeLowerBound(const Slice& index_key) override {
+    return read_options_.iterate_lower_bound != nullptr &&
+           table_->rep_->internal_comparator.user_comparator()->Compare(
+               ExtractUserKey(index_key),
+               *read_options_.iterate_lower_bound) < 0;
+  }
+  /***************************** Shichao ******************************/
+
  private:
   // Don't own table_
   BlockBasedTable* table_;
@@ -929,6 +1106,9 @@ class BlockBasedTable::BlockBasedIterator : public InternalIterator {
         value_.clear();  // prepare for splitting user value
         Slice user_val(ReformatUserValue(iter_->value(), read_options.columns,
                                          splitter_, value_));
+        // Shichao: a whole value is referenced in its pinned block
+        bool pinned = meta->pins != nullptr &&
+                      user_val.data() == iter_->value().data();
 
         if (it->second.seq_ < parsed_key.sequence) {
           // replaced
@@ -936,12 +1116,16 @@ class BlockBasedTable::BlockBasedIterator : public InternalIterator {
             meta->del_keys.erase(it->second.seq_);
           }
           assert(read_options.result_val_size >= 
-              it->second.iter_->user_val.size());
-          read_options.result_val_size -= it->second.iter_->user_val.size();
+              it->second.iter_->value().size());
+          read_options.result_val_size -= it->second.iter_->value().size();
           it->second.seq_ = parsed_key.sequence;
           it->second.type_ = parsed_key.type;
-          it->second.iter_->user_val = user_val.ToString();
-          read_options.result_val_size += it->second.iter_->user_val.size();
+          if (pinned) {
+            it->second.iter_->PinValue(user_val, meta->pins);
+          } else {
+            it->second.iter_->SetValue(user_val);
+          }
+          read_options.result_val_size += user_val.size();
           if (parsed_key.type == kTypeDeletion) {
             meta->del_keys.insert({parsed_key.sequence, it->second.iter_});
           }
@@ -949,7 +1133,12 @@ class BlockBasedTable::BlockBasedIterator : public InternalIterator {
           // inserted
           size_t delta_key_size = user_key.size();
           size_t delta_val_size = user_val.size();
-          res.emplace_back(user_key, user_val.ToString());
+          if (pinned) {
+            res.emplace_back(user_key, "");
+            res.back().PinValue(user_val, meta->pins);
+          } else {
+            res.emplace_back(user_key, user_val.ToString());
+          }
           read_options.result_key_size += delta_key_size;
           read_options.result_val_size += delta_val_size;
           it->second.iter_ = --res.end();
@@ -999,13 +1188,19 @@ Status BlockBasedTable::Get(const ReadOptions& read_options, const Slice& key,
                             GetContext* get_context) {
   Status s;
 
-  BlockIter iiter;
-  NewIndexIterator(read_options, &iiter);
+  /***************************** Shichao ******************************/
+  BlockIter iiter_on_stack;
+  InternalIterator* iiter = NewIndexIterator(read_options, &iiter_on_stack);
+  std::unique_ptr<InternalIterator> iiter_unique_ptr;
+  if (iiter != &iiter_on_stack) {
+    iiter_unique_ptr.reset(iiter);
+  }
+  /***************************** Shichao ******************************/
 
   bool done = false;
-  for (iiter.Seek(key); iiter.Valid() && !done; iiter.Next()) {
+  for (iiter->Seek(key); iiter->Valid() && !done; iiter->Next()) {
     BlockIter biter;
-    NewDataBlockIterator(rep_, read_options, iiter.value(), &biter);
+    NewDataBlockIterator(rep_, read_options, iiter->value(), &biter);
 
     if (read_options.read_tier == kBlockCacheTier &&
         biter.status().IsIncomplete()) {
@@ -1021,7 +1216,11 @@ Status BlockBasedTable::Get(const ReadOptions& read_options, const Slice& key,
     }
 
     // Call the *saver function on each entry/block until it returns false
-    for (biter.Seek(key); biter.Valid(); biter.Next()) {
+    if (!biter.SeekForGet(key)) {  // Shichao
+      // neither in this block nor in the following ones
+      done = true;
+    }
+    for (; biter.Valid() && !done; biter.Next()) {
       ParsedInternalKey parsed_key;
       if (!ParseInternalKey(biter.key(), &parsed_key)) {
         s = Status::Corruption(Slice());
@@ -1042,7 +1241,7 @@ Status BlockBasedTable::Get(const ReadOptions& read_options, const Slice& key,
     s = biter.status();
   }
   if (s.ok()) {
-    s = iiter.status();
+    s = iiter->status();
   }
 
   return s;
@@ -1056,21 +1255,27 @@ Status BlockBasedTable::Prefetch(const Slice* const begin,
     return Status::InvalidArgument(*begin, *end);
   }
 
-  BlockIter iiter;
-  NewIndexIterator(ReadOptions(), &iiter);
+  /***************************** Shichao ******************************/
+  BlockIter iiter_on_stack;
+  InternalIterator* iiter = NewIndexIterator(ReadOptions(), &iiter_on_stack);
+  std::unique_ptr<InternalIterator> iiter_unique_ptr;
+  if (iiter != &iiter_on_stack) {
+    iiter_unique_ptr.reset(iiter);
+  }
+  /***************************** Shichao ******************************/
 
-  if (!iiter.status().ok()) {
+  if (!iiter->status().ok()) {
     // error opening index iterator
-    return iiter.status();
+    return iiter->status();
   }
 
   // indicates if we are on the last page that need to be pre-fetched
   bool prefetching_boundary_page = false;
 
-  for (begin ? iiter.Seek(*begin) : iiter.SeekToFirst(); iiter.Valid();
-       iiter.Next()) {
+  for (begin ? iiter->Seek(*begin) : iiter->SeekToFirst(); iiter->Valid();
+       iiter->Next()) {
 
-    if (end && comparator.Compare(iiter.key(), *end) >= 0) {
+    if (end && comparator.Compare(iiter->key(), *end) >= 0) {
       if (prefetching_boundary_page) {
         break;
       }
@@ -1082,7 +1287,7 @@ Status BlockBasedTable::Prefetch(const Slice* const begin,
 
     // Load the block specified by the block_handle into the block cache
     BlockIter biter;
-    Slice block_handle = iiter.value();
+    Slice block_handle = iiter->value();
     NewDataBlockIterator(rep_, ReadOptions(), block_handle, &biter);
 
     if (!biter.status().ok()) {
@@ -1127,6 +1332,39 @@ uint64_t BlockBasedTable::ApproximateOffsetOf(const Slice& key) {
   return result;
 }
 
+Status BlockBasedTable::ApproximateKeyAnchors(const ReadOptions& read_options,
+                                              std::vector<Anchor>& anchors) {
+  unique_ptr<InternalIterator> index_iter(NewIndexIterator(read_options));
+
+  size_t num_blocks = 0;
+  for (index_iter->SeekToFirst(); index_iter->Valid(); index_iter->Next()) {
+    num_blocks++;
+  }
+  if (!index_iter->status().ok()) {
+    return index_iter->status();
+  }
+
+  // Every index entry is the upper bound of its data block, so emitting one
+  // anchor every "step" blocks keeps the range sizes close to each other.
+  const size_t step = std::max(num_blocks / kMaxNumAnchors, size_t(1));
+  size_t count = 0;
+  uint64_t range_size = 0;
+  for (index_iter->SeekToFirst(); index_iter->Valid(); index_iter->Next()) {
+    BlockHandle handle;
+    Slice input = index_iter->value();
+    Status s = handle.DecodeFrom(&input);
+    if (!s.ok()) {
+      return s;
+    }
+    range_size += handle.size() + kBlockTrailerSize;
+    if (++count % step == 0 || count == num_blocks) {
+      anchors.emplace_back(ExtractUserKey(index_iter->key()), range_size);
+      range_size = 0;
+    }
+  }
+  return index_iter->status();
+}
+
 void BlockBasedTable::SetupForCompaction() {
   switch (rep_->ioptions.access_hint_on_compaction_start) {
     case Options::NONE:
@@ -1151,6 +1389,13 @@ std::shared_ptr<const TableProperties> BlockBasedTable::GetTableProperties()
   return rep_->table_properties;
 }
 
+/***************************** Shichao ******************************/
+std::shared_ptr<const FragmentedRangeTombstoneList>
+BlockBasedTable::GetRangeTombstoneList() const {
+  return rep_->range_del_list;
+}
+/***************************** Shichao ******************************/
+
 size_t BlockBasedTable::ApproximateMemoryUsage() const {
   size_t usage = 0;
   if (rep_->index_reader) {
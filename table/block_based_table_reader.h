@@ -100,12 +100,19 @@ class BlockBasedTable : public TableReader {
   // be close to the file length.
   uint64_t ApproximateOffsetOf(const Slice& key) override;
 
+  // Sample the index block to split the table into ranges of similar size.
+  Status ApproximateKeyAnchors(const ReadOptions& read_options,
+                               std::vector<Anchor>& anchors) override;
+
   // Set up the table for Compaction. Might change some parameters with
   // posix_fadvise
   void SetupForCompaction() override;
 
   std::shared_ptr<const TableProperties> GetTableProperties() const override;
 
+  std::shared_ptr<const FragmentedRangeTombstoneList> GetRangeTombstoneList()
+      const override;  // Shichao
+
   size_t ApproximateMemoryUsage() const override;
 
   // convert SST file to a human readable form
@@ -131,6 +138,7 @@ class BlockBasedTable : public TableReader {
 
   class BlockEntryIteratorState;
   class BlockBasedIterator;  // Shichao
+  class PartitionIndexReader;  // Shichao
 
   template <class TValue>
   struct CachableEntry;
@@ -30,6 +30,9 @@
 //     restarts: uint32[num_restarts]
 //     num_restarts: uint32
 // restarts[i] contains the offset within the block of the ith restart point.
+//
+// A data block may also carry a hash index of its user keys between the
+// restart array and num_restarts, see table/data_block_hash_index.h.
 
 #include "table/block_builder.h"
 
@@ -41,13 +44,19 @@
 
 namespace vidardb {
 
-BlockBuilder::BlockBuilder(int block_restart_interval)
+BlockBuilder::BlockBuilder(int block_restart_interval,
+                           bool use_data_block_hash_index,
+                           double data_block_hash_table_util_ratio)
     : block_restart_interval_(block_restart_interval),
       restarts_(),
       counter_(0),
       finished_(false) {
   assert(block_restart_interval_ >= 1);
   restarts_.push_back(0);       // First restart point is at offset 0
+  if (use_data_block_hash_index) {  // Shichao
+    data_block_hash_index_builder_.Initialize(
+        data_block_hash_table_util_ratio);
+  }
 }
 
 void BlockBuilder::Reset() {
@@ -57,12 +66,19 @@ void BlockBuilder::Reset() {
   counter_ = 0;
   finished_ = false;
   last_key_.clear();
+  data_block_hash_index_builder_.Reset();  // Shichao
 }
 
 size_t BlockBuilder::CurrentSizeEstimate() const {
-  return (buffer_.size() +                        // Raw data buffer
-          restarts_.size() * sizeof(uint32_t) +   // Restart array
-          sizeof(uint32_t));                      // Restart array length
+  size_t estimate = (buffer_.size() +                       // Raw data buffer
+                     restarts_.size() * sizeof(uint32_t) +  // Restart array
+                     sizeof(uint32_t));                     // Array length
+  /***************************** Shichao ******************************/
+  if (data_block_hash_index_builder_.Valid()) {
+    estimate += data_block_hash_index_builder_.EstimateSize();
+  }
+  /***************************** Shichao ******************************/
+  return estimate;
 }
 
 size_t BlockBuilder::EstimateSizeAfterKV(const Slice& key, const Slice& value)
@@ -85,7 +101,14 @@ Slice BlockBuilder::Finish() {
   for (size_t i = 0; i < restarts_.size(); i++) {
     PutFixed32(&buffer_, restarts_[i]);
   }
-  PutFixed32(&buffer_, static_cast<uint32_t>(restarts_.size()));
+  /***************************** Shichao ******************************/
+  uint32_t num_restarts = static_cast<uint32_t>(restarts_.size());
+  if (data_block_hash_index_builder_.Valid()) {
+    data_block_hash_index_builder_.Finish(&buffer_);
+    num_restarts |= kDataBlockHashIndexFlag;
+  }
+  PutFixed32(&buffer_, num_restarts);
+  /***************************** Shichao ******************************/
   finished_ = true;
   return Slice(buffer_);
 }
@@ -93,6 +116,20 @@ Slice BlockBuilder::Finish() {
 void BlockBuilder::Add(const Slice& key, const Slice& value) {
   assert(!finished_);
   assert(counter_ <= block_restart_interval_);
+  /***************************** Shichao ******************************/
+  // only the first entry of a user key is indexed, the later ones with
+  // smaller sequence numbers follow it
+  if (data_block_hash_index_builder_.Valid()) {
+    Slice user_key = ExtractUserKey(key);
+    if (buffer_.empty() || user_key != ExtractUserKey(last_key_)) {
+      size_t restart_index = restarts_.size() - 1;
+      if (counter_ >= block_restart_interval_) {
+        restart_index++;  // key starts a new restart interval
+      }
+      data_block_hash_index_builder_.Add(user_key, restart_index);
+    }
+  }
+  /***************************** Shichao ******************************/
   size_t shared = 0;  // number of bytes shared with prev key
   if (counter_ >= block_restart_interval_) {
     // Restart compression
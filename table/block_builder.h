@@ -12,6 +12,7 @@
 
 #include <stdint.h>
 #include "vidardb/slice.h"
+#include "table/data_block_hash_index.h"  // Shichao
 
 namespace vidardb {
 
@@ -20,7 +21,11 @@ class BlockBuilder {
   BlockBuilder(const BlockBuilder&) = delete;
   void operator=(const BlockBuilder&) = delete;
 
-  explicit BlockBuilder(int block_restart_interval);
+  // use_data_block_hash_index: append a hash index of the user keys, see
+  // DataBlockHashIndex. Only for the blocks of internal keys.
+  explicit BlockBuilder(int block_restart_interval,
+                        bool use_data_block_hash_index = false,  // Shichao
+                        double data_block_hash_table_util_ratio = 0.75);
 
   virtual ~BlockBuilder() {}
 
@@ -61,6 +66,7 @@ class BlockBuilder {
   int                   counter_;   // Number of entries emitted since restart
   bool                  finished_;  // Has Finish() been called?
   std::string           last_key_;
+  DataBlockHashIndexBuilder data_block_hash_index_builder_;  // Shichao
 };
 
 }  // namespace vidardb
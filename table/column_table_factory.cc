@@ -7,6 +7,7 @@
 
 #include <memory>
 #include <string>
+#include <inttypes.h>
 #include <stdint.h>
 
 #include "port/port.h"
@@ -58,7 +59,7 @@ Status ColumnTableFactory::NewTableReader(
       table_reader_options.ioptions, table_reader_options.env_options,
       table_options_, table_reader_options.internal_comparator, std::move(file),
       file_size, table_reader, prefetch_enabled, table_reader_options.level,
-      table_reader_options.cols);
+      table_reader_options.cols, table_reader_options.open_state);  // Shichao
 }
 
 TableBuilder* ColumnTableFactory::NewTableBuilder(
@@ -118,6 +119,28 @@ std::string ColumnTableFactory::GetPrintableTableOptions() const {
   snprintf(buffer, kBufferSize, "  index_block_restart_interval: %d\n",
            table_options_.index_block_restart_interval);
   ret.append(buffer);
+  /***************************** Shichao ******************************/
+  snprintf(buffer, kBufferSize, "  index_type: %d\n",
+           table_options_.index_type);
+  ret.append(buffer);
+  snprintf(buffer, kBufferSize, "  metadata_block_size: %" PRIu64 "\n",
+           table_options_.metadata_block_size);
+  ret.append(buffer);
+  snprintf(buffer, kBufferSize, "  pin_l0_index_partitions: %d\n",
+           table_options_.pin_l0_index_partitions);
+  ret.append(buffer);
+  snprintf(buffer, kBufferSize, "  data_block_index_type: %d\n",
+           table_options_.data_block_index_type);
+  ret.append(buffer);
+  snprintf(buffer, kBufferSize, "  data_block_hash_table_util_ratio: %lf\n",
+           table_options_.data_block_hash_table_util_ratio);
+  ret.append(buffer);
+  snprintf(buffer, kBufferSize, "  checksum: %d\n", table_options_.checksum);
+  ret.append(buffer);
+  /***************************** Shichao ******************************/
+  snprintf(buffer, kBufferSize, "  lazy_open_columns: %d\n",
+           table_options_.lazy_open_columns);
+  ret.append(buffer);
   return ret;
 }
 
@@ -5,18 +5,23 @@
 
 #include "table/column_table_reader.h"
 
+#include <algorithm>
+#include <atomic>
 #include <string>
 #include <unordered_map>
 #include <utility>
 
 #include "db/dbformat.h"
+#include "db/range_del_aggregator.h"  // Shichao
 #include "db/filename.h"
 #include "table/block.h"
 #include "table/column_table_factory.h"
 #include "table/format.h"
 #include "table/get_context.h"
+#include "table/index_builder.h"
 #include "table/internal_iterator.h"
 #include "table/meta_blocks.h"
+#include "table/table_open_state.h"
 #include "table/two_level_iterator.h"
 #include "util/coding.h"
 #include "util/file_reader_writer.h"
@@ -52,10 +57,12 @@ Status ReadBlockFromFile(RandomAccessFileReader* file, const Footer& footer,
                          const ReadOptions& options, const BlockHandle& handle,
                          std::unique_ptr<Block>* result, Env* env,
                          bool do_uncompress, const Slice& compression_dict,
-                         Logger* info_log) {
+                         Logger* info_log,
+                         MemoryAllocator* memory_allocator = nullptr) {
   BlockContents contents;
   Status s = ReadBlockContents(file, footer, options, handle, &contents, env,
-                               do_uncompress, compression_dict, info_log);
+                               do_uncompress, compression_dict, info_log,
+                               memory_allocator);
   if (s.ok()) {
     result->reset(new Block(std::move(contents)));
   }
@@ -133,8 +140,10 @@ class ColumnTable::IndexReader {
 
   // Create an iterator for index access.
   // An iter is passed in, if it is not null, update this one and return it
-  // If it is null, create a new Iterator
-  virtual InternalIterator* NewIterator(BlockIter* iter = nullptr) = 0;
+  // If it is null, create a new Iterator. An index of several blocks may
+  // return a new Iterator anyway, read_options applies to its blocks.
+  virtual InternalIterator* NewIterator(const ReadOptions& read_options,
+                                        BlockIter* iter = nullptr) = 0;
 
   // The size of the index.
   virtual size_t size() const = 0;
@@ -180,7 +189,8 @@ class BinarySearchIndexReader : public IndexReader {
     return s;
   }
 
-  virtual InternalIterator* NewIterator(BlockIter* iter = nullptr) override {
+  virtual InternalIterator* NewIterator(const ReadOptions& read_options,
+                                        BlockIter* iter = nullptr) override {
     return index_block_->NewIterator(comparator_, iter);
   }
 
@@ -272,11 +282,108 @@ struct ColumnTable::Rep {
   // is easier because the Slice member depends on the continued existence of
   // another member ("allocation").
   std::unique_ptr<const BlockContents> compression_dict_block;
+  // the fragmented range tombstones, nullptr if none, Shichao
+  std::shared_ptr<const FragmentedRangeTombstoneList> range_del_list;
 
   bool main_column;
   std::vector<unique_ptr<ColumnTable>> tables;  // sub colum tables
+
+  /***************************** Shichao ******************************/
+  // For opening the sub column tables after Open(), when they are first
+  // projected. tables[i] is only read after tables_opened[i] is set.
+  std::unique_ptr<std::atomic<bool>[]> tables_opened;
+  port::Mutex tables_mutex;
+  std::vector<uint64_t> file_sizes;
+  EnvOptions sub_env_options;  // env_options may not outlive Open()
+  bool prefetch_index = true;
+  int level = -1;
+  TableOpenState* open_state = nullptr;
+  /***************************** Shichao ******************************/
 };
 
+/***************************** Shichao ******************************/
+// Open the sub column table of column i, counting from 0.
+// REQUIRES: rep->tables_mutex held, or in Open()
+Status ColumnTable::OpenSubTable(Rep* rep, uint32_t i) {
+  const ImmutableCFOptions& ioptions = rep->ioptions;
+  std::string col_fname =
+      TableSubFileName(rep->file->file()->GetFileName(), i + 1);
+  unique_ptr<RandomAccessFile> col_file;
+  Status s = ioptions.env->NewRandomAccessFile(col_fname, &col_file,
+                                               rep->sub_env_options);
+  if (!s.ok()) {
+    return s;
+  }
+  size_t readahead = rep->file->file()->ReadaheadSize();
+  if (readahead > 0) {
+    col_file = NewReadaheadRandomAccessFile(std::move(col_file), readahead);
+  }
+  TableOpenState::File* state_file = nullptr;
+  if (rep->open_state != nullptr) {
+    auto wrapped = rep->open_state->NewFile(col_fname, rep->file_sizes[i],
+                                            std::move(col_file));
+    state_file = wrapped.get();
+    col_file = std::move(wrapped);
+  }
+  RecordTick(ioptions.statistics, COLUMN_SUB_FILE_OPENS);
+
+  unique_ptr<RandomAccessFileReader> file_reader(
+      new RandomAccessFileReader(std::move(col_file), ioptions.env,
+                                 ioptions.statistics, SST_READ_MICROS,
+                                 nullptr, ioptions.rate_limiter));
+  unique_ptr<TableReader> table;
+  s = Open(ioptions, rep->sub_env_options, rep->table_options,
+           *(rep->column_comparator), std::move(file_reader),
+           rep->file_sizes[i], &table, rep->prefetch_index, rep->level);
+  if (!s.ok()) {
+    return s;
+  }
+  if (state_file != nullptr) {
+    state_file->Finish();
+  }
+  rep->tables[i].reset(dynamic_cast<ColumnTable*>(table.release()));
+  rep->tables_opened[i].store(true, std::memory_order_release);
+  return s;
+}
+
+ColumnTable* ColumnTable::OpenedSubTable(uint32_t i) const {
+  if (!rep_->tables_opened[i].load(std::memory_order_acquire)) {
+    return nullptr;
+  }
+  return rep_->tables[i].get();
+}
+
+Status ColumnTable::GetSubTables(const std::vector<uint32_t>& columns,
+                                 std::vector<ColumnTable*>* tables) {
+  tables->clear();
+  for (const auto& column_index : columns) {
+    if (column_index < 1) {  // only process the value columns
+      continue;
+    }
+    uint32_t i = column_index - 1;
+    if (i >= rep_->tables.size()) {
+      return Status::InvalidArgument("column index out of range");
+    }
+    ColumnTable* table = OpenedSubTable(i);
+    if (table == nullptr) {
+      MutexLock l(&rep_->tables_mutex);
+      if (!rep_->tables_opened[i].load(std::memory_order_relaxed)) {
+        Status s = OpenSubTable(rep_, i);
+        if (!s.ok()) {
+          return s;
+        }
+        if (compaction_optimized_) {
+          rep_->tables[i]->SetupForCompaction();
+        }
+      }
+      table = rep_->tables[i].get();
+    }
+    tables->push_back(table);
+  }
+  return Status::OK();
+}
+/***************************** Shichao ******************************/
+
 // Load the meta-block from the file. On success, return the loaded meta block
 // and its iterator.
 Status ColumnTable::ReadMetaBlock(Rep* rep,
@@ -398,7 +505,7 @@ Status ColumnTable::GetDataBlockFromCache(
 // If input_iter is not null, update this iter and return it
 InternalIterator* ColumnTable::NewDataBlockIterator(
     Rep* rep, const ReadOptions& read_options, const Slice& index_value,
-    BlockIter* input_iter) {
+    BlockIter* input_iter, bool is_index) {
   PERF_TIMER_GUARD(new_table_block_iter_nanos);
 
   BlockHandle handle;
@@ -424,6 +531,7 @@ InternalIterator* ColumnTable::NewDataBlockIterator(
   const bool no_io = (read_options.read_tier == kBlockCacheTier);
   Cache* block_cache = rep->table_options.block_cache.get();
   CachableEntry<Block> block;
+  bool read_from_file = false;
   // If block cache is enabled, we'll try to read from it.
   if (block_cache != nullptr) {
     Statistics* statistics = rep->ioptions.statistics;
@@ -440,8 +548,10 @@ InternalIterator* ColumnTable::NewDataBlockIterator(
         StopWatch sw(rep->ioptions.env, statistics, READ_BLOCK_GET_MICROS);
         s = ReadBlockFromFile(rep->file.get(), rep->footer, read_options,
                               handle, &raw_block, rep->ioptions.env, true,
-                              compression_dict, rep->ioptions.info_log);
+                              compression_dict, rep->ioptions.info_log,
+                              block_cache->memory_allocator());
       }
+      read_from_file = true;
 
       if (s.ok()) {
         s = PutDataBlockToCache(key, block_cache, statistics, &block,
@@ -465,15 +575,25 @@ InternalIterator* ColumnTable::NewDataBlockIterator(
     s = ReadBlockFromFile(rep->file.get(), rep->footer, read_options, handle,
                           &block_value, rep->ioptions.env, true,
                           compression_dict, rep->ioptions.info_log);
+    read_from_file = true;
     if (s.ok()) {
       block.value = block_value.release();
     }
   }
 
+  // The main column is counted by the generic block read counters only
+  if (read_from_file && !rep->main_column && !is_index) {
+    PERF_COUNTER_ADD(column_block_read_count, 1);
+    PERF_COUNTER_ADD(column_block_read_byte, handle.size());
+    RecordTick(rep->ioptions.statistics, COLUMN_BLOCK_READ);
+    RecordTick(rep->ioptions.statistics, COLUMN_BLOCK_READ_BYTES,
+               handle.size());
+  }
+
   InternalIterator* iter;
   if (s.ok() && block.value != nullptr) {
     iter = block.value->NewIterator(&rep->internal_comparator, input_iter,
-                                    !rep->main_column);
+                                    !rep->main_column && !is_index);
     if (block.cache_handle != nullptr) {
       iter->RegisterCleanup(&ReleaseCachedEntry, block_cache,
                             block.cache_handle);
@@ -491,6 +611,127 @@ InternalIterator* ColumnTable::NewDataBlockIterator(
   return iter;
 }
 
+/***************************** Shichao ******************************/
+// Index of two levels. The top level index is held by the reader, its entries
+// point to the partitions of the index, which are read through the block
+// cache like data blocks, or pinned by the reader for a level 0 table if
+// pin_l0_index_partitions.
+class ColumnTable::PartitionIndexReader : public IndexReader {
+ public:
+  static Status Create(ColumnTable* table, const BlockHandle& index_handle,
+                       IndexReader** index_reader) {
+    Rep* rep = table->rep_;
+    std::unique_ptr<Block> index_block;
+    auto s = ReadBlockFromFile(rep->file.get(), rep->footer, ReadOptions(),
+                               index_handle, &index_block, rep->ioptions.env,
+                               true /* decompress */,
+                               Slice() /*compression dict*/,
+                               /*info_log*/ nullptr);
+    if (!s.ok()) {
+      return s;
+    }
+
+    std::unique_ptr<PartitionIndexReader> reader(
+        new PartitionIndexReader(table, std::move(index_block)));
+    if (rep->level == 0 && rep->table_options.pin_l0_index_partitions) {
+      s = reader->PinPartitions();
+    }
+    if (s.ok()) {
+      *index_reader = reader.release();
+    }
+    return s;
+  }
+
+  virtual InternalIterator* NewIterator(const ReadOptions& read_options,
+                                        BlockIter* iter = nullptr) override {
+    return NewTwoLevelIterator(
+        new PartitionIteratorState(this, read_options),
+        index_block_->NewIterator(comparator_));
+  }
+
+  virtual size_t size() const override { return index_block_->size(); }
+  virtual size_t usable_size() const override {
+    return index_block_->usable_size() + pinned_usable_size_;
+  }
+
+  virtual size_t ApproximateMemoryUsage() const override {
+    size_t usage = index_block_->ApproximateMemoryUsage();
+    for (const auto& it : partitions_) {
+      usage += it.second->ApproximateMemoryUsage();
+    }
+    return usage;
+  }
+
+ private:
+  class PartitionIteratorState : public TwoLevelIteratorState {
+   public:
+    PartitionIteratorState(PartitionIndexReader* reader,
+                           const ReadOptions& read_options)
+        : reader_(reader), read_options_(read_options) {}
+
+    InternalIterator* NewSecondaryIterator(const Slice& index_value) override {
+      if (!reader_->partitions_.empty()) {
+        BlockHandle handle;
+        Slice input = index_value;
+        if (handle.DecodeFrom(&input).ok()) {
+          auto it = reader_->partitions_.find(handle.offset());
+          if (it != reader_->partitions_.end()) {
+            return it->second->NewIterator(reader_->comparator_);
+          }
+        }
+      }
+      return NewDataBlockIterator(reader_->table_->rep_, read_options_,
+                                  index_value, nullptr, true /* is_index */);
+    }
+
+   private:
+    PartitionIndexReader* reader_;
+    const ReadOptions read_options_;
+  };
+
+  PartitionIndexReader(ColumnTable* table,
+                       std::unique_ptr<Block>&& index_block)
+      : IndexReader(&table->rep_->internal_comparator,
+                    table->rep_->ioptions.statistics),
+        table_(table),
+        index_block_(std::move(index_block)) {
+    assert(index_block_ != nullptr);
+  }
+
+  Status PinPartitions() {
+    Rep* rep = table_->rep_;
+    std::unique_ptr<InternalIterator> iter(
+        index_block_->NewIterator(comparator_));
+    for (iter->SeekToFirst(); iter->Valid(); iter->Next()) {
+      BlockHandle handle;
+      Slice input = iter->value();
+      Status s = handle.DecodeFrom(&input);
+      if (!s.ok()) {
+        return s;
+      }
+      std::unique_ptr<Block> partition;
+      s = ReadBlockFromFile(rep->file.get(), rep->footer, ReadOptions(),
+                            handle, &partition, rep->ioptions.env,
+                            true /* decompress */,
+                            Slice() /*compression dict*/,
+                            rep->ioptions.info_log);
+      if (!s.ok()) {
+        return s;
+      }
+      pinned_usable_size_ += partition->usable_size();
+      partitions_[handle.offset()] = std::move(partition);
+    }
+    return iter->status();
+  }
+
+  ColumnTable* table_;  // not owned
+  std::unique_ptr<Block> index_block_;  // top level index
+  // pinned partitions by their offsets
+  std::unordered_map<uint64_t, std::unique_ptr<Block>> partitions_;
+  size_t pinned_usable_size_ = 0;
+};
+/***************************** Shichao ******************************/
+
 Status ColumnTable::CreateIndexReader(IndexReader** index_reader) {
   auto file = rep_->file.get();
   auto env = rep_->ioptions.env;
@@ -498,6 +739,13 @@ Status ColumnTable::CreateIndexReader(IndexReader** index_reader) {
   const Footer& footer = rep_->footer;
   Statistics* stats = rep_->ioptions.statistics;
 
+  /***************************** Shichao ******************************/
+  if (GetIndexType(rep_->table_properties.get()) ==
+      TableOptions::kTwoLevelIndexSearch) {
+    return PartitionIndexReader::Create(this, footer.index_handle(),
+                                        index_reader);
+  }
+  /***************************** Shichao ******************************/
   return BinarySearchIndexReader::Create(file, footer, footer.index_handle(),
                                          env, comparator, index_reader, stats);
 }
@@ -507,7 +755,7 @@ InternalIterator* ColumnTable::NewIndexIterator(
     CachableEntry<IndexReader>* index_entry) {
   // index reader has already been pre-populated.
   if (rep_->index_reader) {
-    return rep_->index_reader->NewIterator(input_iter);
+    return rep_->index_reader->NewIterator(read_options, input_iter);
   }
 
   PERF_TIMER_GUARD(read_index_block_nanos);
@@ -562,7 +810,7 @@ InternalIterator* ColumnTable::NewIndexIterator(
   }
 
   assert(cache_handle);
-  auto* iter = index_reader->NewIterator(input_iter);
+  auto* iter = index_reader->NewIterator(read_options, input_iter);
 
   // the caller would like to take ownership of the index block
   // don't call RegisterCleanup() in this case, the caller will take care of it
@@ -706,7 +954,8 @@ Status ColumnTable::Open(const ImmutableCFOptions& ioptions,
                          uint64_t file_size,
                          unique_ptr<TableReader>* table_reader,
                          const bool prefetch_index, const int level,
-                         const std::vector<uint32_t>& cols) {
+                         const std::vector<uint32_t>& cols,
+                         TableOpenState* open_state) {  // Shichao
   table_reader->reset();
 
   Footer footer;
@@ -722,6 +971,7 @@ Status ColumnTable::Open(const ImmutableCFOptions& ioptions,
                                   internal_comparator);
   rep->file = std::move(file);
   rep->footer = footer;
+  rep->level = level;  // Shichao
   SetupCacheKeyPrefix(rep, file_size);
 
   // Read meta index
@@ -745,15 +995,23 @@ Status ColumnTable::Open(const ImmutableCFOptions& ioptions,
     }
 
     uint32_t column_count;
-    std::vector<uint64_t> file_sizes;
     s = ReadMetaColumnBlock(meta_iter->value(), rep->file.get(), rep->footer,
                             ioptions.env, ioptions.info_log, &column_count,
-                            file_sizes);
+                            rep->file_sizes);
     if (!s.ok()) {
       return s;
     }
 
     rep->tables.resize(column_count);
+    /***************************** Shichao ******************************/
+    rep->tables_opened.reset(new std::atomic<bool>[column_count]);
+    for (auto i = 0u; i < column_count; i++) {
+      rep->tables_opened[i].store(false, std::memory_order_relaxed);
+    }
+    rep->sub_env_options = env_options;
+    rep->prefetch_index = prefetch_index;
+    rep->open_state = open_state;
+    /***************************** Shichao ******************************/
     rep->main_column = rep->tables.empty()? false: true;
     if (rep->main_column && column_count != rep->table_options.column_count) {
       return Status::InvalidArgument("table_options.column_count");
@@ -762,36 +1020,20 @@ Status ColumnTable::Open(const ImmutableCFOptions& ioptions,
       rep->column_comparator.reset(new ColumnKeyComparator());
     }
 
-    size_t readahead = rep->file->file()->ReadaheadSize();
-    std::string fname = rep->file->file()->GetFileName();
     for (auto i = 0u; i < column_count; i++) {
       // filter unnecessary columns, cols starts from 0 to MAX_COLUMN_INDEX and
       // index 0 means only querying the user keys, and the value column index
-      // is from 1 to MAX_COLUMN_INDEX
-      if (!cols.empty() &&
-          std::find(cols.begin(), cols.end(), i+1) == cols.end()) {
+      // is from 1 to MAX_COLUMN_INDEX. The filtered and the lazily opened ones
+      // are opened when first projected.
+      if (table_options.lazy_open_columns ||  // Shichao
+          (!cols.empty() &&
+           std::find(cols.begin(), cols.end(), i+1) == cols.end())) {
         continue;
       }
-      std::string col_fname = TableSubFileName(fname, i+1);
-      unique_ptr<RandomAccessFile> col_file;
-      s = rep->ioptions.env->NewRandomAccessFile(col_fname, &col_file,
-                                                 env_options);
-      if (!s.ok()) {
-        return s;
-      }
-      if (readahead > 0) {
-        col_file = NewReadaheadRandomAccessFile(std::move(col_file), readahead);
-      }
-      unique_ptr<RandomAccessFileReader> file_reader(
-          new RandomAccessFileReader(std::move(col_file), ioptions.env));
-      unique_ptr<TableReader> table;
-      s = Open(ioptions, env_options, table_options, *(rep->column_comparator),
-               std::move(file_reader), file_sizes[i], &table, prefetch_index,
-               level);
+      s = OpenSubTable(rep, i);  // Shichao
       if (!s.ok()) {
         return s;
       }
-      rep->tables[i].reset(dynamic_cast<ColumnTable*>(table.release()));
     }
   }
 
@@ -845,6 +1087,24 @@ Status ColumnTable::Open(const ImmutableCFOptions& ioptions,
     }
   }
 
+  /***************************** Shichao ******************************/
+  // Read the range deletion meta block, the reads are wrong without it
+  bool found_range_del_block;
+  s = SeekToRangeDelBlock(meta_iter.get(), &found_range_del_block);
+  if (s.ok() && found_range_del_block) {
+    s = vidardb::ReadRangeDelBlock(rep->file.get(), file_size,
+                                   kColumnTableMagicNumber, rep->ioptions.env,
+                                   rep->internal_comparator,
+                                   &rep->range_del_list);
+  }
+  if (!s.ok()) {
+    Log(InfoLogLevel::ERROR_LEVEL, rep->ioptions.info_log,
+        "Encountered error while reading range deletion block %s",
+        s.ToString().c_str());
+    return s;
+  }
+  /***************************** Shichao ******************************/
+
   unique_ptr<ColumnTable> new_table(new ColumnTable(rep));
   if (prefetch_index) {
     // pre-fetching of blocks is turned on
@@ -871,19 +1131,40 @@ Status ColumnTable::Open(const ImmutableCFOptions& ioptions,
 class ColumnTable::BlockEntryIteratorState : public TwoLevelIteratorState {
  public:
   BlockEntryIteratorState(ColumnTable* table,
-                          const ReadOptions& read_options)
+                          const ReadOptions& read_options,
+                          bool main_column = false)  // Shichao
       : TwoLevelIteratorState(),
         table_(table),
-        read_options_(read_options) {}
+        read_options_(read_options),
+        main_column_(main_column) {}
 
   InternalIterator* NewSecondaryIterator(const Slice& index_value) override {
     return NewDataBlockIterator(table_->rep_, read_options_, index_value);
   }
 
+  /***************************** Shichao ******************************/
+  // Only the index keys of the main column are user keys, the sub columns
+  // follow the main column and are never cut short on their own.
+  bool KeyReachedUpperBound(const Slice& index_key) override {
+    return main_column_ && read_options_.iterate_upper_bound != nullptr &&
+           table_->rep_->internal_comparator.user_comparator()->Compare(
+               ExtractUserKey(index_key),
+               *read_options_.iterate_upper_bound) >= 0;
+  }
+
+  bool KeyBeforeLowerBound(const Slice& index_key) override {
+    return main_column_ && read_options_.iterate_lower_bound != nullptr &&
+           table_->rep_->internal_comparator.user_comparator()->Compare(
+               ExtractUserKey(index_key),
+               *read_options_.iterate_lower_bound) < 0;
+  }
+  /***************************** Shichao ******************************/
+
  private:
   // Don't own table_
   ColumnTable* table_;
   const ReadOptions read_options_;
+  const bool main_column_;  // Shichao
 };
 
 class ColumnTable::ColumnIterator : public InternalIterator {
@@ -1003,6 +1284,16 @@ class ColumnTable::ColumnIterator : public InternalIterator {
     SequenceNumber sequence_num = range.SequenceNum();
     RangeQueryMeta* meta =
         static_cast<RangeQueryMeta*>(read_options.range_query_meta);
+    /***************************** Shichao ******************************/
+    // The value of a single column the splitter does not encode is
+    // referenced in its pinned block rather than appended.
+    bool pinned = false;
+    if (meta->pins != nullptr && columns_.size() == 2) {
+      std::string probe;
+      splitter_->Append(probe, Slice("x"), true);
+      pinned = (probe == "x");
+    }
+    /***************************** Shichao ******************************/
 
     // Range query one by one to improve performance
     for (size_t i = 0u; i < columns_.size(); i++) {
@@ -1058,11 +1349,11 @@ class ColumnTable::ColumnIterator : public InternalIterator {
                 meta->del_keys.erase(it->second.seq_);
               }
               assert(read_options.result_val_size >=
-                  it->second.iter_->user_val.size());
-              read_options.result_val_size -= it->second.iter_->user_val.size();
+                  it->second.iter_->value().size());
+              read_options.result_val_size -= it->second.iter_->value().size();
               it->second.seq_ = parsed_key.sequence;
               it->second.type_ = parsed_key.type;
-              it->second.iter_->user_val = "";
+              it->second.iter_->SetValue(Slice());
               user_vals.push_back(it);
               if (parsed_key.type == kTypeDeletion) {
                 meta->del_keys.insert({parsed_key.sequence, it->second.iter_});
@@ -1111,10 +1402,15 @@ class ColumnTable::ColumnIterator : public InternalIterator {
           }
 
           auto& it = user_vals[user_val_idx++]->second.iter_;
-          size_t prev_val_size = it->user_val.size();
-          splitter_->Append(it->user_val, iter->value(),
-                            i + 1 == columns_.size());
-          size_t delta_val_size = it->user_val.size() - prev_val_size;
+          size_t prev_val_size = it->value().size();
+          if (pinned) {
+            it->PinValue(iter->value(), meta->pins);  // Shichao
+          } else {
+            PERF_TIMER_GUARD(splitter_stitch_time);
+            splitter_->Append(it->user_val, iter->value(),
+                              i + 1 == columns_.size());
+          }
+          size_t delta_val_size = it->value().size() - prev_val_size;
           read_options.result_val_size += delta_val_size;
 
           // check the result size by key and value size
@@ -1164,6 +1460,7 @@ class ColumnTable::ColumnIterator : public InternalIterator {
 
  private:
   inline bool ParseCurrentValue() {
+    PERF_TIMER_GUARD(splitter_stitch_time);
     value_.clear();
     for (auto i = 0u; i < columns_.size(); i++) {
       if (!columns_[i]->Valid()) {
@@ -1211,17 +1508,26 @@ InternalIterator* ColumnTable::NewIterator(const ReadOptions& read_options,
   ReadOptions ro = SanitizeColumnReadOptions(
       rep_->table_options.column_count, read_options);
 
+  std::vector<ColumnTable*> sub_tables;  // Shichao
+  Status s = GetSubTables(ro.columns, &sub_tables);
+  if (!s.ok()) {
+    return NewErrorInternalIterator(s, arena);
+  }
+
   std::vector<InternalIterator*> iters;  // main column
-  iters.push_back(NewTwoLevelIterator(new BlockEntryIteratorState(this, ro),
-                                      NewIndexIterator(ro), arena));
-  for (const auto& column_index : ro.columns) {  // sub column
-    if (column_index < 1) {  // only process the value columns
-      continue;
-    }
+  iters.push_back(NewTwoLevelIterator(
+      new BlockEntryIteratorState(this, ro, true /* main_column */),
+      NewIndexIterator(ro), arena));
+  for (const auto& table : sub_tables) {  // sub column
     iters.push_back(NewTwoLevelIterator(
-        new BlockEntryIteratorState(rep_->tables[column_index-1].get(), ro),
-        rep_->tables[column_index-1]->NewIndexIterator(ro), arena));
-  }
+        new BlockEntryIteratorState(table, ro),
+        table->NewIndexIterator(ro), arena));
+  }
+  PERF_COUNTER_ADD(column_projected_count, iters.size() - 1);
+  PERF_COUNTER_ADD(column_total_count, rep_->table_options.column_count);
+  RecordTick(rep_->ioptions.statistics, COLUMNS_PROJECTED, iters.size() - 1);
+  RecordTick(rep_->ioptions.statistics, COLUMNS_TOTAL,
+             rep_->table_options.column_count);
   return new ColumnIterator(iters, true, rep_->ioptions.splitter,
                             rep_->internal_comparator,
                             rep_->table_properties->num_entries);
@@ -1231,31 +1537,48 @@ Status ColumnTable::Get(const ReadOptions& read_options, const Slice& key,
                         GetContext* get_context) {
   ReadOptions ro = SanitizeColumnReadOptions(
       rep_->table_options.column_count, read_options);
-  BlockIter iiter;
-  NewIndexIterator(ro, &iiter);
+  std::vector<ColumnTable*> sub_tables;  // Shichao
+  Status s = GetSubTables(ro.columns, &sub_tables);
+  if (!s.ok()) {
+    return s;
+  }
+
+  /***************************** Shichao ******************************/
+  BlockIter iiter_on_stack;
+  InternalIterator* iiter = NewIndexIterator(ro, &iiter_on_stack);
+  std::unique_ptr<InternalIterator> iiter_unique_ptr;
+  if (iiter != &iiter_on_stack) {
+    iiter_unique_ptr.reset(iiter);
+  }
+  /***************************** Shichao ******************************/
 
-  Status s;
   bool done = false;
-  for (iiter.Seek(key); iiter.Valid() && !done; iiter.Next()) {
-    std::unique_ptr<InternalIterator> biter;
-    biter.reset(NewDataBlockIterator(rep_, ro, iiter.value()));
-    if (ro.read_tier == kBlockCacheTier && biter->status().IsIncomplete()) {
+  for (iiter->Seek(key); iiter->Valid() && !done; iiter->Next()) {
+    // the key is looked up in the main column block alone, the sub-column
+    // iterators are opened only once it is found
+    BlockIter biter;  // Shichao
+    NewDataBlockIterator(rep_, ro, iiter->value(), &biter);
+    if (ro.read_tier == kBlockCacheTier && biter.status().IsIncomplete()) {
       // couldn't get block from block_cache
       // Update Saver.state to Found because we are only looking for whether
       // we can guarantee the key is not there when "no_io" is set
       get_context->MarkKeyMayExist();
       break;
     }
-    if (!biter->status().ok()) {
-      s = biter->status();
+    if (!biter.status().ok()) {
+      s = biter.status();
       break;
     }
 
     bool isIncomplete = false;
     // Call the *saver function on each entry/block until it returns false
-    for (biter->Seek(key); biter->Valid(); biter->Next()) {
+    if (!biter.SeekForGet(key)) {  // Shichao
+      // neither in this block nor in the following ones
+      done = true;
+    }
+    for (; biter.Valid() && !done; biter.Next()) {
       ParsedInternalKey parsed_key;
-      if (!ParseInternalKey(biter->key(), &parsed_key)) {
+      if (!ParseInternalKey(biter.key(), &parsed_key)) {
         s = Status::Corruption(Slice());
         break;
       }
@@ -1267,13 +1590,10 @@ Status ColumnTable::Get(const ReadOptions& read_options, const Slice& key,
       }
 
       std::vector<InternalIterator*> iters;
-      for (const auto& it : ro.columns) {
-        if (it < 1) {  // only process the value columns
-          continue;
-        }
+      for (const auto& table : sub_tables) {
         iters.push_back(NewTwoLevelIterator(
-            new BlockEntryIteratorState(rep_->tables[it-1].get(), ro),
-            rep_->tables[it-1]->NewIndexIterator(ro)));
+            new BlockEntryIteratorState(table, ro),
+            table->NewIndexIterator(ro)));
       }
 
       ColumnIterator citers(iters, false, rep_->ioptions.splitter,
@@ -1284,7 +1604,7 @@ Status ColumnTable::Get(const ReadOptions& read_options, const Slice& key,
         break;
       }
 
-      citers.Seek(biter->value());
+      citers.Seek(biter.value());
       if (ro.read_tier == kBlockCacheTier && citers.status().IsIncomplete()) {
         isIncomplete = true;
         get_context->MarkKeyMayExist();
@@ -1304,11 +1624,11 @@ Status ColumnTable::Get(const ReadOptions& read_options, const Slice& key,
     if (isIncomplete || !s.ok()) {
       break;
     } else {
-      s = biter->status();
+      s = biter.status();
     }
   }
   if (s.ok()) {
-    s = iiter.status();
+    s = iiter->status();
   }
 
   return s;
@@ -1328,21 +1648,33 @@ Status ColumnTable::Prefetch(const Slice* const begin, const Slice* const end,
     return Status::InvalidArgument(*begin, *end);
   }
 
-  BlockIter iiter;
-  NewIndexIterator(ro, &iiter);
+  std::vector<ColumnTable*> sub_tables;  // Shichao
+  Status s = GetSubTables(ro.columns, &sub_tables);
+  if (!s.ok()) {
+    return s;
+  }
+
+  /***************************** Shichao ******************************/
+  BlockIter iiter_on_stack;
+  InternalIterator* iiter = NewIndexIterator(ro, &iiter_on_stack);
+  std::unique_ptr<InternalIterator> iiter_unique_ptr;
+  if (iiter != &iiter_on_stack) {
+    iiter_unique_ptr.reset(iiter);
+  }
+  /***************************** Shichao ******************************/
 
-  if (!iiter.status().ok()) {
+  if (!iiter->status().ok()) {
     // error opening index iterator
-    return iiter.status();
+    return iiter->status();
   }
 
   // indicates if we are on the last page that need to be pre-fetched
   bool prefetching_boundary_page = false;
 
-  for (begin ? iiter.Seek(*begin) : iiter.SeekToFirst(); iiter.Valid();
-       iiter.Next()) {
+  for (begin ? iiter->Seek(*begin) : iiter->SeekToFirst(); iiter->Valid();
+       iiter->Next()) {
 
-    if (end && comparator.Compare(iiter.key(), *end) >= 0) {
+    if (end && comparator.Compare(iiter->key(), *end) >= 0) {
       if (prefetching_boundary_page) {
         break;
       }
@@ -1354,7 +1686,7 @@ Status ColumnTable::Prefetch(const Slice* const begin, const Slice* const end,
 
     // Load the block specified by the block_handle into the block cache
     std::unique_ptr<InternalIterator> biter;
-    biter.reset(NewDataBlockIterator(rep_, ro, iiter.value()));
+    biter.reset(NewDataBlockIterator(rep_, ro, iiter->value()));
     if (!biter->status().ok()) {
       // there was an unexpected error while pre-fetching
       return biter->status();
@@ -1366,13 +1698,10 @@ Status ColumnTable::Prefetch(const Slice* const begin, const Slice* const end,
     }
 
     std::vector<InternalIterator*> iters;
-    for (const auto& it : ro.columns) {
-      if (it < 1) {  // only process the value columns
-        continue;
-      }
+    for (const auto& table : sub_tables) {
       iters.push_back(NewTwoLevelIterator(
-          new BlockEntryIteratorState(rep_->tables[it-1].get(), ro),
-          rep_->tables[it-1]->NewIndexIterator(ro)));
+          new BlockEntryIteratorState(table, ro),
+          table->NewIndexIterator(ro)));
     }
 
     ColumnIterator citers(iters, false, rep_->ioptions.splitter,
@@ -1433,13 +1762,21 @@ uint64_t ColumnTable::ApproximateOffsetOf(const Slice& key) {
     datablock_iter->SeekToFirst();
     Slice sub_column_key = datablock_iter->value();
 
-    for (const auto& it : rep_->tables) {
+    // the sub columns not opened yet are assumed to be as far as the main
+    // column, rather than opened here
+    uint64_t main_size = rep_->footer.metaindex_handle().offset();
+    double ratio = main_size > 0 ? static_cast<double>(result) / main_size : 0;
+    for (auto i = 0u; i < rep_->tables.size(); i++) {
+      ColumnTable* it = OpenedSubTable(i);
       if (it) {
         result += it->ApproximateOffsetOf(sub_column_key);
+      } else {
+        result += static_cast<uint64_t>(rep_->file_sizes[i] * ratio);
       }
     }
   } else {
-    for (const auto& it : rep_->tables) {
+    for (auto i = 0u; i < rep_->tables.size(); i++) {
+      ColumnTable* it = OpenedSubTable(i);
       if (it) {
         uint64_t sub_result = 0;
         if (it->rep_->table_properties) {
@@ -1450,6 +1787,8 @@ uint64_t ColumnTable::ApproximateOffsetOf(const Slice& key) {
           sub_result = it->rep_->footer.metaindex_handle().offset();
         }
         result += sub_result;
+      } else {
+        result += rep_->file_sizes[i];
       }
     }
   }
@@ -1457,6 +1796,60 @@ uint64_t ColumnTable::ApproximateOffsetOf(const Slice& key) {
   return result;
 }
 
+Status ColumnTable::ApproximateKeyAnchors(const ReadOptions& read_options,
+                                          std::vector<Anchor>& anchors) {
+  unique_ptr<InternalIterator> index_iter(NewIndexIterator(read_options));
+
+  size_t num_blocks = 0;
+  uint64_t main_size = 0;
+  for (index_iter->SeekToFirst(); index_iter->Valid(); index_iter->Next()) {
+    BlockHandle handle;
+    Slice input = index_iter->value();
+    Status s = handle.DecodeFrom(&input);
+    if (!s.ok()) {
+      return s;
+    }
+    main_size += handle.size() + kBlockTrailerSize;
+    num_blocks++;
+  }
+  if (!index_iter->status().ok()) {
+    return index_iter->status();
+  }
+
+  // Sub columns are aligned with the main column row by row, so the bytes of
+  // a key range grow with the main column bytes of the same range.
+  uint64_t total_size = main_size;
+  for (auto i = 0u; i < rep_->tables.size(); i++) {
+    ColumnTable* it = OpenedSubTable(i);
+    if (it == nullptr) {
+      total_size += rep_->file_sizes[i];
+    } else if (it->rep_->table_properties) {
+      total_size += it->rep_->table_properties->data_size;
+    }
+  }
+  const double scale =
+      main_size > 0 ? static_cast<double>(total_size) / main_size : 1.0;
+
+  const size_t step = std::max(num_blocks / kMaxNumAnchors, size_t(1));
+  size_t count = 0;
+  uint64_t range_size = 0;
+  for (index_iter->SeekToFirst(); index_iter->Valid(); index_iter->Next()) {
+    BlockHandle handle;
+    Slice input = index_iter->value();
+    Status s = handle.DecodeFrom(&input);
+    if (!s.ok()) {
+      return s;
+    }
+    range_size += handle.size() + kBlockTrailerSize;
+    if (++count % step == 0 || count == num_blocks) {
+      anchors.emplace_back(ExtractUserKey(index_iter->key()),
+                           static_cast<uint64_t>(range_size * scale));
+      range_size = 0;
+    }
+  }
+  return index_iter->status();
+}
+
 void ColumnTable::SetupForCompaction() {
   switch (rep_->ioptions.access_hint_on_compaction_start) {
     case Options::NONE:
@@ -1468,8 +1861,11 @@ void ColumnTable::SetupForCompaction() {
     default:
       assert(false);
   }
+  // the sub columns opened later are set up by GetSubTables()
+  MutexLock l(&rep_->tables_mutex);
   compaction_optimized_ = true;
-  for (const auto& it : rep_->tables) {
+  for (auto i = 0u; i < rep_->tables.size(); i++) {
+    ColumnTable* it = OpenedSubTable(i);
     if (it) {
       it->SetupForCompaction();
     }
@@ -1480,12 +1876,20 @@ std::shared_ptr<const TableProperties> ColumnTable::GetTableProperties() const {
   return rep_->table_properties;
 }
 
+/***************************** Shichao ******************************/
+std::shared_ptr<const FragmentedRangeTombstoneList>
+ColumnTable::GetRangeTombstoneList() const {
+  return rep_->range_del_list;
+}
+/***************************** Shichao ******************************/
+
 size_t ColumnTable::ApproximateMemoryUsage() const {
   size_t usage = 0;
   if (rep_->index_reader) {
     usage += rep_->index_reader->ApproximateMemoryUsage();
   }
-  for (const auto& it : rep_->tables) {
+  for (auto i = 0u; i < rep_->tables.size(); i++) {
+    ColumnTable* it = OpenedSubTable(i);
     if (it) {
       usage += it->ApproximateMemoryUsage();
     }
@@ -1564,7 +1968,8 @@ void ColumnTable::Close() {
                                 rep_->dummy_index_reader_offset, cache_key);
     rep_->table_options.block_cache.get()->Erase(key);
   }
-  for (const auto& it : rep_->tables) {
+  for (auto i = 0u; i < rep_->tables.size(); i++) {
+    ColumnTable* it = OpenedSubTable(i);
     if (it) {
       it->Close();
     }
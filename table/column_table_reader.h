@@ -30,6 +30,7 @@ class InternalKeyComparator;
 class Iterator;
 class RandomAccessFile;
 class TableCache;
+class TableOpenState;
 class TableReader;
 class WritableFile;
 struct ColumnTableOptions;
@@ -68,7 +69,8 @@ class ColumnTable : public TableReader {
                      uint64_t file_size, unique_ptr<TableReader>* table_reader,
                      bool prefetch_index = true, int level = -1,
                      const std::vector<uint32_t>& cols =
-                             std::vector<uint32_t>());
+                             std::vector<uint32_t>(),
+                     TableOpenState* open_state = nullptr);  // Shichao
 
   // Returns a new iterator over the table contents.
   // The result of NewIterator() is initially invalid (caller must
@@ -95,12 +97,21 @@ class ColumnTable : public TableReader {
   // be close to the file length.
   uint64_t ApproximateOffsetOf(const Slice& key) override;
 
+  // Sample the index block of the main column to split the table into ranges
+  // of similar size. Range sizes are scaled up by the sub column data so that
+  // they reflect the bytes of all the column files.
+  Status ApproximateKeyAnchors(const ReadOptions& read_options,
+                               std::vector<Anchor>& anchors) override;
+
   // Set up the table for Compaction. Might change some parameters with
   // posix_fadvise
   void SetupForCompaction() override;
 
   std::shared_ptr<const TableProperties> GetTableProperties() const override;
 
+  std::shared_ptr<const FragmentedRangeTombstoneList> GetRangeTombstoneList()
+      const override;  // Shichao
+
   size_t ApproximateMemoryUsage() const override;
 
   // TODO: dump all columns
@@ -121,6 +132,7 @@ class ColumnTable : public TableReader {
 
   class BlockEntryIteratorState;
   class ColumnIterator;
+  class PartitionIndexReader;  // Shichao
 
   template <class TValue>
   struct CachableEntry;
@@ -158,9 +170,10 @@ class ColumnTable : public TableReader {
       ColumnTable::CachableEntry<Block>* block);
 
   // input_iter: if it is not null, update this one and return it as Iterator
+  // is_index: the block is an index partition, see PartitionIndexReader
   static InternalIterator* NewDataBlockIterator(
       Rep* rep, const ReadOptions& read_options, const Slice& index_value,
-      BlockIter* input_iter = nullptr);
+      BlockIter* input_iter = nullptr, bool is_index = false);  // Shichao
 
   // Create a index reader based on the index type stored in the table.
   Status CreateIndexReader(IndexReader** index_reader);
@@ -181,6 +194,19 @@ class ColumnTable : public TableReader {
   explicit ColumnTable(Rep* rep)
       : rep_(rep), compaction_optimized_(false) {}
 
+  /***************************** Shichao ******************************/
+  // Open the sub column table of column i, counting from 0.
+  static Status OpenSubTable(Rep* rep, uint32_t i);
+
+  // Returns the sub column table of column i if it is opened, else nullptr.
+  ColumnTable* OpenedSubTable(uint32_t i) const;
+
+  // Collect the sub column tables of the projected value columns, opening
+  // the ones not opened yet.
+  Status GetSubTables(const std::vector<uint32_t>& columns,
+                      std::vector<ColumnTable*>* tables);
+  /***************************** Shichao ******************************/
+
   // Helper functions for DumpTable()
   Status DumpIndexBlock(WritableFile* out_file);
   Status DumpDataBlocks(WritableFile* out_file);
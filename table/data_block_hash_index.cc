@@ -0,0 +1,89 @@
+//  Copyright (c) 2019-present, VidarDB, Inc.  All rights reserved.
+//  This source code is licensed under the BSD-style license found in the
+//  LICENSE file in the root directory of this source tree. An additional grant
+//  of patent rights can be found in the PATENTS file in the same directory.
+
+#include "table/data_block_hash_index.h"
+
+#include <assert.h>
+#include <algorithm>
+
+#include "util/coding.h"
+#include "util/hash.h"
+
+namespace vidardb {
+
+namespace {
+// One byte per bucket is appended to the block, so the count is capped to
+// bound the size of the index of a block, whatever util_ratio is. The
+// restart indexes the buckets can hold are limited by their uint8_t entries
+// instead (kMaxRestartSupportedByHashIndex).
+const uint32_t kMaxNumBuckets = 0xffff;
+
+uint32_t NumBuckets(size_t num_keys, double util_ratio) {
+  double num = static_cast<double>(num_keys) / util_ratio;
+  uint32_t num_buckets = static_cast<uint32_t>(
+      std::min<double>(std::max<double>(num, 1), kMaxNumBuckets));
+  return num_buckets | 1;  // odd for a better spread of the modulo
+}
+}  // anonymous namespace
+
+void DataBlockHashIndexBuilder::Add(const Slice& user_key,
+                                    size_t restart_index) {
+  assert(Valid());
+  if (restart_index > kMaxRestartSupportedByHashIndex) {
+    valid_ = false;
+    return;
+  }
+  hash_and_restart_pairs_.emplace_back(GetSliceHash(user_key),
+                                       static_cast<uint8_t>(restart_index));
+}
+
+void DataBlockHashIndexBuilder::Finish(std::string* buffer) {
+  assert(Valid());
+  uint32_t num_buckets =
+      NumBuckets(hash_and_restart_pairs_.size(), util_ratio_);
+  std::vector<uint8_t> buckets(num_buckets, kNoEntry);
+  for (const auto& it : hash_and_restart_pairs_) {
+    uint8_t& bucket = buckets[it.first % num_buckets];
+    if (bucket == kNoEntry) {
+      bucket = it.second;
+    } else if (bucket != it.second) {
+      bucket = kCollision;
+    }
+  }
+  buffer->append(reinterpret_cast<const char*>(buckets.data()), num_buckets);
+  PutFixed32(buffer, num_buckets);
+}
+
+void DataBlockHashIndexBuilder::Reset() {
+  hash_and_restart_pairs_.clear();
+  valid_ = util_ratio_ > 0;
+}
+
+size_t DataBlockHashIndexBuilder::EstimateSize() const {
+  return NumBuckets(hash_and_restart_pairs_.size(), util_ratio_) +
+         sizeof(uint32_t);
+}
+
+uint32_t DataBlockHashIndex::Initialize(const char* data, uint32_t end) {
+  if (end < sizeof(uint32_t)) {
+    return 0;
+  }
+  uint32_t num_buckets = DecodeFixed32(data + end - sizeof(uint32_t));
+  if (num_buckets == 0 || end - sizeof(uint32_t) < num_buckets) {
+    return 0;
+  }
+  num_buckets_ = num_buckets;
+  buckets_offset_ = end - sizeof(uint32_t) - num_buckets;
+  return buckets_offset_;
+}
+
+uint8_t DataBlockHashIndex::Lookup(const char* data,
+                                   const Slice& user_key) const {
+  assert(Valid());
+  uint32_t idx = GetSliceHash(user_key) % num_buckets_;
+  return static_cast<uint8_t>(data[buckets_offset_ + idx]);
+}
+
+}  // namespace vidardb
@@ -0,0 +1,87 @@
+//  Copyright (c) 2019-present, VidarDB, Inc.  All rights reserved.
+//  This source code is licensed under the BSD-style license found in the
+//  LICENSE file in the root directory of this source tree. An additional grant
+//  of patent rights can be found in the PATENTS file in the same directory.
+//
+// An optional hash index appended to a data block, mapping the hash of each
+// user key in the block to the restart interval holding its first entry, so
+// a point lookup finds its restart interval with one probe instead of a
+// binary search over the restart points.
+//
+// Block layout with the hash index:
+//     entries
+//     restarts: uint32[num_restarts]
+//     buckets: uint8[num_buckets]
+//     num_buckets: uint32
+//     footer: uint32, num_restarts with kDataBlockHashIndexFlag set
+// Each bucket is a restart index, or kNoEntry or kCollision. A block without
+// the flag in its footer is a plain block, so both kinds stay readable.
+
+#pragma once
+
+#include <stdint.h>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "vidardb/slice.h"
+
+namespace vidardb {
+
+const uint8_t kNoEntry = 255;
+const uint8_t kCollision = 254;
+const uint8_t kMaxRestartSupportedByHashIndex = 253;
+
+const uint32_t kDataBlockHashIndexFlag = 1u << 31;
+
+class DataBlockHashIndexBuilder {
+ public:
+  DataBlockHashIndexBuilder() : util_ratio_(0), valid_(false) {}
+
+  // util_ratio is the target ratio of the user keys to the buckets.
+  void Initialize(double util_ratio) {
+    util_ratio_ = util_ratio;
+    valid_ = util_ratio > 0;
+  }
+
+  // False if the block is not indexed, either disabled or having too many
+  // restart intervals.
+  bool Valid() const { return valid_; }
+
+  void Add(const Slice& user_key, size_t restart_index);
+
+  // Append the buckets and their number to buffer.
+  void Finish(std::string* buffer);
+
+  void Reset();
+
+  size_t EstimateSize() const;
+
+ private:
+  double util_ratio_;
+  bool valid_;
+  std::vector<std::pair<uint32_t, uint8_t>> hash_and_restart_pairs_;
+};
+
+class DataBlockHashIndex {
+ public:
+  DataBlockHashIndex() : buckets_offset_(0), num_buckets_(0) {}
+
+  // Parse the hash index ending at end, which is the offset of the block
+  // footer, and return the offset where it starts, i.e. the end of the
+  // restart array, or 0 if the block is too small.
+  uint32_t Initialize(const char* data, uint32_t end);
+
+  // Return the restart index of user_key, kNoEntry or kCollision.
+  uint8_t Lookup(const char* data, const Slice& user_key) const;
+
+  bool Valid() const { return num_buckets_ > 0; }
+
+  size_t ApproximateMemoryUsage() const { return num_buckets_; }
+
+ private:
+  uint32_t buckets_offset_;
+  uint32_t num_buckets_;
+};
+
+}  // namespace vidardb
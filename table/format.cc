@@ -21,6 +21,7 @@
 #include "util/file_reader_writer.h"
 #include "util/perf_context_imp.h"
 #include "util/string_util.h"
+#include "util/xxh3.h"  // Shichao
 
 namespace vidardb {
 
@@ -58,19 +59,22 @@ std::string BlockHandle::ToString(bool hex) const {
 
 const BlockHandle BlockHandle::kNullBlockHandle(0, 0);
 
-// new footer format:
-//    checksum (char, 1 byte)
+// footer format:
 //    metaindex handle (varint64 offset, varint64 size)
 //    index handle     (varint64 offset, varint64 size)
-//    <padding> to make the total size 2 * BlockHandle::kMaxEncodedLength + 1
-//    footer version (4 bytes)
+//    <zero padding> to make the total size 2 * BlockHandle::kMaxEncodedLength
+//    checksum type (char, 1 byte, the last byte of the padding)
 //    table_magic_number (8 bytes)
+// The handles of any real file are too short to reach the checksum type, and
+// the tables written before it have zero there, i.e. kCRC32c.
 void Footer::EncodeTo(std::string* dst) const {
   assert(HasInitializedTableMagicNumber());
   const size_t original_size = dst->size();
   metaindex_handle_.EncodeTo(dst);
   index_handle_.EncodeTo(dst);
+  assert(dst->size() <= original_size + kEncodedLength - 9);
   dst->resize(original_size + kEncodedLength - 8);  // Padding
+  (*dst)[original_size + kEncodedLength - 9] = checksum_;  // Shichao
   PutFixed32(dst, static_cast<uint32_t>(table_magic_number() & 0xffffffffu));
   PutFixed32(dst, static_cast<uint32_t>(table_magic_number() >> 32));
   assert(dst->size() == original_size + kEncodedLength);
@@ -106,6 +110,18 @@ Status Footer::DecodeFrom(Slice* input) {
   if (result.ok()) {
     result = index_handle_.DecodeFrom(input);
   }
+  /***************************** Shichao ******************************/
+  if (result.ok()) {
+    const char* checksum_ptr = magic_ptr - 1;
+    if (input->data() <= checksum_ptr) {
+      checksum_ = static_cast<TableOptions::ChecksumType>(*checksum_ptr);
+    }
+    if (checksum_ != TableOptions::kCRC32c &&
+        checksum_ != TableOptions::kXXH3) {
+      result = Status::Corruption("unknown checksum type");
+    }
+  }
+  /***************************** Shichao ******************************/
   if (result.ok()) {
     // We skip over any leftover data (just padding for now) in "input"
     const char* end = magic_ptr + kMagicNumberLengthByte;
@@ -122,6 +138,8 @@ std::string Footer::ToString() const {
   result.append("index handle: " + index_handle_.ToString() + "\n  ");
   result.append("table_magic_number: " +
                 vidardb::ToString(table_magic_number_) + "\n  ");
+  result.append("checksum: " +
+                vidardb::ToString(static_cast<int>(checksum_)) + "\n  ");
   return result;
 }
 
@@ -158,6 +176,20 @@ Status ReadFooterFromFile(RandomAccessFileReader* file, uint64_t file_size,
   return Status::OK();
 }
 
+/***************************** Shichao ******************************/
+uint32_t ComputeBlockChecksum(TableOptions::ChecksumType checksum,
+                              const char* data, size_t n, char type) {
+  if (checksum == TableOptions::kXXH3) {
+    // XXH3 does not extend, the type is mixed into its lower bits
+    return XXH3Hash32(data, n) ^
+           (static_cast<uint8_t>(type) * 0x6b9083d9u);
+  }
+  uint32_t crc = crc32c::Value(data, n);
+  crc = crc32c::Extend(crc, &type, 1);  // Extend to cover block type
+  return crc32c::Mask(crc);
+}
+/***************************** Shichao ******************************/
+
 // Without anonymous namespace here, we fail the warning -Wmissing-prototypes
 namespace {
 
@@ -172,7 +204,8 @@ Status ReadBlock(RandomAccessFileReader* file, const Footer& footer,
 
   {
     PERF_TIMER_GUARD(block_read_time);
-    s = file->Read(handle.offset(), n + kBlockTrailerSize, contents, buf);
+    s = file->Read(handle.offset(), n + kBlockTrailerSize, contents, buf,
+                   options.rate_limiter_priority);  // Shichao
   }
 
   PERF_COUNTER_ADD(block_read_count, 1);
@@ -190,10 +223,8 @@ Status ReadBlock(RandomAccessFileReader* file, const Footer& footer,
   if (options.verify_checksums) {
     PERF_TIMER_GUARD(block_checksum_time);
     uint32_t value = DecodeFixed32(data + n + 1);
-    uint32_t actual = 0;
-
-    value = crc32c::Unmask(value);
-    actual = crc32c::Value(data, n + 1);
+    uint32_t actual =
+        ComputeBlockChecksum(footer.checksum(), data, n, data[n]);  // Shichao
 
     if (s.ok() && actual != value) {
       s = Status::Corruption("block checksum mismatch");
@@ -212,11 +243,12 @@ Status ReadBlockContents(RandomAccessFileReader* file, const Footer& footer,
                          const BlockHandle& handle, BlockContents* contents,
                          Env* env, bool decompression_requested,
                          const Slice& compression_dict,
-                         Logger* info_log) {
+                         Logger* info_log,
+                         MemoryAllocator* memory_allocator) {
   Status status;
   Slice slice;
   size_t n = static_cast<size_t>(handle.size());
-  std::unique_ptr<char[]> heap_buf;
+  CacheAllocationPtr heap_buf;
   char stack_buf[DefaultStackBufferSize];
   char* used_buf = nullptr;
   vidardb::CompressionType compression_type;
@@ -230,7 +262,7 @@ Status ReadBlockContents(RandomAccessFileReader* file, const Footer& footer,
     // trivially allocated stack buffer instead of needing a full malloc()
     used_buf = &stack_buf[0];
   } else {
-    heap_buf = std::unique_ptr<char[]>(new char[n + kBlockTrailerSize]);
+    heap_buf = AllocateBlock(n + kBlockTrailerSize, memory_allocator);
     used_buf = heap_buf.get();
   }
 
@@ -247,14 +279,14 @@ Status ReadBlockContents(RandomAccessFileReader* file, const Footer& footer,
   if (decompression_requested && compression_type != kNoCompression) {
     // compressed page, uncompress, update cache
     status = UncompressBlockContents(slice.data(), n, contents,
-                                     compression_dict);
+                                     compression_dict, memory_allocator);
   } else if (slice.data() != used_buf) {
     // the slice content is not the buffer provided
     *contents = BlockContents(Slice(slice.data(), n), false, compression_type);
   } else {
     // page is uncompressed, the buffer either stack or heap provided
     if (used_buf == &stack_buf[0]) {
-      heap_buf = std::unique_ptr<char[]>(new char[n]);
+      heap_buf = AllocateBlock(n, memory_allocator);
       memcpy(heap_buf.get(), stack_buf, n);
     }
     *contents = BlockContents(std::move(heap_buf), n, true, compression_type);
@@ -270,10 +302,13 @@ Status ReadBlockContents(RandomAccessFileReader* file, const Footer& footer,
 // buffer is returned via 'result' and it is upto the caller to
 // free this buffer.
 // format_version is the block format as defined in include/vidardb/table.h
+// Only the snappy buffer is taken from memory_allocator, zlib and bzip2 grow
+// theirs on the heap while decompressing.
 Status UncompressBlockContents(const char* data, size_t n,
                                BlockContents* contents,
-                               const Slice& compression_dict) {
-  std::unique_ptr<char[]> ubuf;
+                               const Slice& compression_dict,
+                               MemoryAllocator* memory_allocator) {
+  CacheAllocationPtr ubuf;
   int decompress_size = 0;
   assert(data[n] != kNoCompression);
   switch (data[n]) {
@@ -284,7 +319,7 @@ Status UncompressBlockContents(const char* data, size_t n,
       if (!Snappy_GetUncompressedLength(data, n, &ulength)) {
         return Status::Corruption(snappy_corrupt_msg);
       }
-      ubuf.reset(new char[ulength]);
+      ubuf = AllocateBlock(ulength, memory_allocator);
       if (!Snappy_Uncompress(data, n, ubuf.get())) {
         return Status::Corruption(snappy_corrupt_msg);
       }
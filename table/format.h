@@ -16,6 +16,7 @@
 #include "vidardb/table.h"
 
 #include "port/port.h" // noexcept
+#include "util/memory_allocator.h"  // Shichao
 
 namespace vidardb {
 
@@ -103,6 +104,10 @@ class Footer {
 
   uint64_t table_magic_number() const { return table_magic_number_; }
 
+  // The checksum type of the blocks of the table, Shichao
+  TableOptions::ChecksumType checksum() const { return checksum_; }
+  void set_checksum(TableOptions::ChecksumType c) { checksum_ = c; }
+
   void EncodeTo(std::string* dst) const;
 
   // Set the current footer based on the input slice.
@@ -143,6 +148,7 @@ class Footer {
   BlockHandle metaindex_handle_;
   BlockHandle index_handle_;
   uint64_t table_magic_number_ = 0;
+  TableOptions::ChecksumType checksum_ = TableOptions::kCRC32c;  // Shichao
 };
 
 // Read the footer from file
@@ -155,11 +161,18 @@ Status ReadFooterFromFile(RandomAccessFileReader* file, uint64_t file_size,
 // 1-byte type + 32-bit crc
 static const size_t kBlockTrailerSize = 5;
 
+/***************************** Shichao ******************************/
+// Return the checksum in the trailer of the block of n bytes data followed by
+// its compression type byte, a masked crc32c or the lower bits of XXH3.
+extern uint32_t ComputeBlockChecksum(TableOptions::ChecksumType checksum,
+                                     const char* data, size_t n, char type);
+/***************************** Shichao ******************************/
+
 struct BlockContents {
   Slice data;           // Actual contents of data
   bool cachable;        // True iff data can be cached
   CompressionType compression_type;
-  std::unique_ptr<char[]> allocation;
+  CacheAllocationPtr allocation;  // Shichao
 
   BlockContents() : cachable(false), compression_type(kNoCompression) {}
 
@@ -167,7 +180,7 @@ struct BlockContents {
                 CompressionType _compression_type)
       : data(_data), cachable(_cachable), compression_type(_compression_type) {}
 
-  BlockContents(std::unique_ptr<char[]>&& _data, size_t _size, bool _cachable,
+  BlockContents(CacheAllocationPtr&& _data, size_t _size, bool _cachable,
                 CompressionType _compression_type)
       : data(_data.get(), _size),
         cachable(_cachable),
@@ -192,7 +205,8 @@ extern Status ReadBlockContents(
     const ReadOptions& options, const BlockHandle& handle,
     BlockContents* contents, Env* env, bool do_uncompress = true,
     const Slice& compression_dict = Slice(),
-    Logger* info_log = nullptr);
+    Logger* info_log = nullptr,
+    MemoryAllocator* memory_allocator = nullptr);  // Shichao
 
 // The 'data' points to the raw block contents read in from file.
 // This method allocates a new heap buffer and the raw block
@@ -201,9 +215,11 @@ extern Status ReadBlockContents(
 // free this buffer.
 // For description of compress_format_version and possible values, see
 // util/compression.h
-extern Status UncompressBlockContents(const char* data, size_t n,
-                                      BlockContents* contents,
-                                      const Slice& compression_dict);
+// If memory_allocator is not nullptr, the buffer is allocated from it.
+extern Status UncompressBlockContents(
+    const char* data, size_t n, BlockContents* contents,
+    const Slice& compression_dict,
+    MemoryAllocator* memory_allocator = nullptr);  // Shichao
 
 // Implementation details follow.  Clients should ignore,
 
@@ -4,7 +4,9 @@
 //  of patent rights can be found in the PATENTS file in the same directory.
 
 #include "table/get_context.h"
+#include "db/merge_helper.h"
 #include "vidardb/env.h"
+#include "vidardb/merge_operator.h"
 #include "vidardb/statistics.h"
 #include "util/perf_context_imp.h"
 #include "util/statistics.h"
@@ -29,15 +31,22 @@ void appendToReplayLog(std::string* replay_log, ValueType type, Slice value) {
 
 }  // namespace
 
-GetContext::GetContext(const Comparator* ucmp, GetState init_state,
-                       const Slice& user_key, std::string* ret_value,
-                       bool* value_found, SequenceNumber* seq)
+GetContext::GetContext(const Comparator* ucmp,
+                       const MergeOperator* merge_operator, Logger* logger,
+                       GetState init_state, const Slice& user_key,
+                       std::string* ret_value, bool* value_found,
+                       MergeContext* merge_context, SequenceNumber* seq,
+                       SequenceNumber* max_covering_tombstone_seq)
     : ucmp_(ucmp),
+      merge_operator_(merge_operator),
+      logger_(logger),
       state_(init_state),
       user_key_(user_key),
       value_(ret_value),
       value_found_(value_found),
+      merge_context_(merge_context),
       seq_(seq),
+      max_covering_tombstone_seq_(max_covering_tombstone_seq),  // Shichao
       replay_log_(nullptr) {
   if (seq_) {
     *seq_ = kMaxSequenceNumber;
@@ -59,34 +68,72 @@ void GetContext::MarkKeyMayExist() {
 bool GetContext::SaveValue(const ParsedInternalKey& parsed_key,
                            const Slice& value) {
   if (ucmp_->Equal(parsed_key.user_key, user_key_)) {
-    appendToReplayLog(replay_log_, parsed_key.type, value);
+    /***************************** Shichao ******************************/
+    // an entry older than a covering range tombstone is deleted by it
+    ValueType type = parsed_key.type;
+    SequenceNumber sequence = parsed_key.sequence;
+    if (max_covering_tombstone_seq_ != nullptr &&
+        (type == kTypeValue || type == kTypeMerge) &&
+        sequence < *max_covering_tombstone_seq_) {
+      type = kTypeDeletion;
+      sequence = *max_covering_tombstone_seq_;
+    }
+    /***************************** Shichao ******************************/
+    appendToReplayLog(replay_log_, type, value);
 
     if (seq_ != nullptr) {
       // Set the sequence number if it is uninitialized
       if (*seq_ == kMaxSequenceNumber) {
-        *seq_ = parsed_key.sequence;
+        *seq_ = sequence;
       }
     }
 
     // Key matches. Process it
-    switch (parsed_key.type) {
+    switch (type) {
       case kTypeValue:
-        assert(state_ == kNotFound);
+        assert(state_ == kNotFound || state_ == kMerge);
         if (kNotFound == state_) {
           state_ = kFound;
           if (value_ != nullptr) {
             value_->assign(value.data(), value.size());
           }
+        } else if (kMerge == state_) {
+          state_ = kFound;
+          if (value_ != nullptr) {
+            Status merge_status = MergeHelper::TimedFullMerge(
+                user_key_, &value, merge_context_->GetOperands(),
+                merge_operator_, nullptr, nullptr, logger_, value_);
+            if (!merge_status.ok()) {
+              state_ = kCorrupt;
+            }
+          }
         }
         return false;
 
       case kTypeDeletion:
-        assert(state_ == kNotFound);
+      case kTypeSingleDeletion:
+        assert(state_ == kNotFound || state_ == kMerge);
         if (kNotFound == state_) {
           state_ = kDeleted;
+        } else if (kMerge == state_) {
+          state_ = kFound;
+          if (value_ != nullptr) {
+            Status merge_status = MergeHelper::TimedFullMerge(
+                user_key_, nullptr, merge_context_->GetOperands(),
+                merge_operator_, nullptr, nullptr, logger_, value_);
+            if (!merge_status.ok()) {
+              state_ = kCorrupt;
+            }
+          }
         }
         return false;
 
+      case kTypeMerge:
+        assert(state_ == kNotFound || state_ == kMerge);
+        state_ = kMerge;
+        merge_context_->PushOperand(value);
+        return true;
+
       default:
         assert(false);
         break;
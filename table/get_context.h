@@ -13,9 +13,12 @@
 #include "vidardb/env.h"
 #include "vidardb/types.h"
 #include "db/dbformat.h"
+#include "db/merge_context.h"
 
 namespace vidardb {
 
+class MergeOperator;
+
 class GetContext {
  public:
   enum GetState {
@@ -23,11 +26,14 @@ class GetContext {
     kFound,
     kDeleted,
     kCorrupt,
+    kMerge  // saver contains the current merge result (the operands)
   };
 
-  GetContext(const Comparator* ucmp, GetState init_state, const Slice& user_key,
+  GetContext(const Comparator* ucmp, const MergeOperator* merge_operator,
+             Logger* logger, GetState init_state, const Slice& user_key,
              std::string* ret_value, bool* value_found,
-             SequenceNumber* seq = nullptr);
+             MergeContext* merge_context, SequenceNumber* seq = nullptr,
+             SequenceNumber* max_covering_tombstone_seq = nullptr);
 
   void MarkKeyMayExist();
 
@@ -53,17 +59,28 @@ class GetContext {
   bool IsEqualToUserKey(const ParsedInternalKey& parsed_key) const {
     return ucmp_->Equal(parsed_key.user_key, user_key_);
   }
+
+  // The newest range tombstone met so far covering the key, the tables
+  // raise it before their entries are saved. nullptr if not tracked.
+  SequenceNumber* max_covering_tombstone_seq() {
+    return max_covering_tombstone_seq_;
+  }
   /************************** Shichao *******************************/
 
  private:
   const Comparator* ucmp_;
+  const MergeOperator* merge_operator_;
+  Logger* logger_;
   GetState state_;
   Slice user_key_;
   std::string* value_;
   bool* value_found_;  // Is value set correctly? Used by KeyMayExist
+  // the merge operations encountered;
+  MergeContext* merge_context_;
   // If a key is found, seq_ will be set to the SequenceNumber of most recent
   // write to the key or kMaxSequenceNumber if unknown
   SequenceNumber* seq_;
+  SequenceNumber* max_covering_tombstone_seq_;  // Shichao
   std::string* replay_log_;
 };
 
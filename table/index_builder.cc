@@ -0,0 +1,114 @@
+//  Copyright (c) 2019-present, VidarDB, Inc.  All rights reserved.
+//  This source code is licensed under the BSD-style license found in the
+//  LICENSE file in the root directory of this source tree. An additional grant
+//  of patent rights can be found in the PATENTS file in the same directory.
+//
+//  Copyright (c) 2011-present, Facebook, Inc.  All rights reserved.
+//  This source code is licensed under the BSD-style license found in the
+//  LICENSE file in the root directory of this source tree. An additional grant
+//  of patent rights can be found in the PATENTS file in the same directory.
+
+#include "table/index_builder.h"
+
+#include <assert.h>
+
+#include "vidardb/table_properties.h"
+#include "util/coding.h"
+
+namespace vidardb {
+
+const std::string kIndexTypeProperty = "vidardb.index.type";
+
+TableOptions::IndexType GetIndexType(const TableProperties* props) {
+  if (props == nullptr) {
+    return TableOptions::kBinarySearch;
+  }
+  auto it = props->user_collected_properties.find(kIndexTypeProperty);
+  if (it == props->user_collected_properties.end()) {
+    return TableOptions::kBinarySearch;
+  }
+  Slice input(it->second);
+  uint64_t index_type = 0;
+  if (!GetVarint64(&input, &index_type)) {
+    return TableOptions::kBinarySearch;
+  }
+  return static_cast<TableOptions::IndexType>(index_type);
+}
+
+PartitionedIndexBuilder::PartitionedIndexBuilder(
+    const Comparator* comparator, int index_block_restart_interval,
+    uint64_t partition_size)
+    : IndexBuilder(comparator),
+      index_block_restart_interval_(index_block_restart_interval),
+      partition_size_(partition_size),
+      index_block_builder_(index_block_restart_interval) {}
+
+void PartitionedIndexBuilder::AddIndexEntry(
+    std::string* last_key_in_current_block,
+    const Slice* first_key_in_next_block, const BlockHandle& block_handle) {
+  if (!sub_index_builder_) {
+    sub_index_builder_.reset(
+        new ShortenedIndexBuilder(comparator_, index_block_restart_interval_));
+  }
+  // shortens last_key_in_current_block, which is then a valid separator for
+  // the top level index as well
+  sub_index_builder_->AddIndexEntry(last_key_in_current_block,
+                                    first_key_in_next_block, block_handle);
+  sub_index_last_key_ = *last_key_in_current_block;
+
+  if (first_key_in_next_block == nullptr ||
+      sub_index_builder_->EstimatedSize() >= partition_size_) {
+    partitions_size_ += sub_index_builder_->EstimatedSize();
+    entries_.push_back({sub_index_last_key_, std::move(sub_index_builder_)});
+  }
+}
+
+Status PartitionedIndexBuilder::Finish(
+    IndexBlocks* index_blocks, const BlockHandle& last_partition_block_handle) {
+  if (finishing_) {
+    // the front partition is written
+    std::string handle_encoding;
+    last_partition_block_handle.EncodeTo(&handle_encoding);
+    index_block_builder_.Add(entries_.front().key, handle_encoding);
+    entries_.pop_front();
+  } else {
+    finishing_ = true;
+    if (sub_index_builder_) {
+      partitions_size_ += sub_index_builder_->EstimatedSize();
+      entries_.push_back({sub_index_last_key_, std::move(sub_index_builder_)});
+    }
+  }
+
+  if (entries_.empty()) {
+    index_blocks->index_block_contents = index_block_builder_.Finish();
+    return Status::OK();
+  }
+  Status s = entries_.front().value->Finish(index_blocks);
+  assert(s.ok());
+  return Status::Incomplete();
+}
+
+size_t PartitionedIndexBuilder::EstimatedSize() const {
+  size_t size = partitions_size_ + index_block_builder_.CurrentSizeEstimate();
+  if (sub_index_builder_) {
+    size += sub_index_builder_->EstimatedSize();
+  }
+  return size;
+}
+
+IndexBuilder* CreateIndexBuilder(TableOptions::IndexType index_type,
+                                 const Comparator* comparator,
+                                 int index_block_restart_interval,
+                                 uint64_t metadata_block_size) {
+  switch (index_type) {
+    case TableOptions::kTwoLevelIndexSearch:
+      return new PartitionedIndexBuilder(
+          comparator, index_block_restart_interval, metadata_block_size);
+    case TableOptions::kBinarySearch:
+    default:
+      return new ShortenedIndexBuilder(comparator,
+                                       index_block_restart_interval);
+  }
+}
+
+}  // namespace vidardb
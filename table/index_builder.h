@@ -0,0 +1,190 @@
+//  Copyright (c) 2019-present, VidarDB, Inc.  All rights reserved.
+//  This source code is licensed under the BSD-style license found in the
+//  LICENSE file in the root directory of this source tree. An additional grant
+//  of patent rights can be found in the PATENTS file in the same directory.
+//
+//  Copyright (c) 2011-present, Facebook, Inc.  All rights reserved.
+//  This source code is licensed under the BSD-style license found in the
+//  LICENSE file in the root directory of this source tree. An additional grant
+//  of patent rights can be found in the PATENTS file in the same directory.
+
+#pragma once
+
+#include <list>
+#include <memory>
+#include <string>
+
+#include "vidardb/comparator.h"
+#include "vidardb/status.h"
+#include "vidardb/table.h"
+#include "table/block_builder.h"
+#include "table/format.h"
+
+namespace vidardb {
+
+struct TableProperties;
+
+// The name of the table property telling the index type of a table file,
+// see TableOptions::IndexType. Absent in the files of kBinarySearch.
+extern const std::string kIndexTypeProperty;
+
+// The index type recorded in the properties of a table file.
+extern TableOptions::IndexType GetIndexType(const TableProperties* props);
+
+// The interface for building index.
+// Instruction for adding a new concrete IndexBuilder:
+//  1. Create a subclass instantiated from IndexBuilder.
+//  2. Add a new entry associated with that subclass in TableOptions::IndexType.
+//  3. Add a create function for the new subclass in CreateIndexBuilder.
+// Note: we can devise more advanced design to simplify the process for adding
+// new subclass, which will, on the other hand, increase the code complexity and
+// catch unwanted attention from readers. Given that we won't add/change
+// indexes frequently, it makes sense to just embrace a more straightforward
+// design that just works.
+class IndexBuilder {
+ public:
+  // Index builder will construct a set of blocks which contain:
+  //  1. One primary index block.
+  struct IndexBlocks {
+    Slice index_block_contents;
+  };
+  explicit IndexBuilder(const Comparator* comparator)
+      : comparator_(comparator) {}
+
+  virtual ~IndexBuilder() {}
+
+  // Add a new index entry to index block.
+  // To allow further optimization, we provide `last_key_in_current_block` and
+  // `first_key_in_next_block`, based on which the specific implementation can
+  // determine the best index key to be used for the index block.
+  // @last_key_in_current_block: this parameter maybe overridden with the value
+  //                             "substitute key".
+  // @first_key_in_next_block: it will be nullptr if the entry being added is
+  //                           the last one in the table
+  //
+  // REQUIRES: Finish() has not yet been called.
+  virtual void AddIndexEntry(std::string* last_key_in_current_block,
+                             const Slice* first_key_in_next_block,
+                             const BlockHandle& block_handle) = 0;
+
+  // This method will be called whenever a key is added. The subclasses may
+  // override OnKeyAdded() if they need to collect additional information.
+  virtual void OnKeyAdded(const Slice& key) {}
+
+  // Inform the index builder that all entries has been written. Block builder
+  // may therefore perform any operation required for block finalization.
+  //
+  // An index of several blocks returns Status::Incomplete() with one of its
+  // blocks, which is to be written to the file before Finish() is called
+  // again with the handle of the written block, until the last block is
+  // returned with Status::OK(). The last one goes to the footer.
+  //
+  // REQUIRES: Finish() has not yet been called.
+  Status Finish(IndexBlocks* index_blocks) {
+    // nothing is written before the first call
+    BlockHandle dont_care;
+    return Finish(index_blocks, dont_care);
+  }
+
+  virtual Status Finish(IndexBlocks* index_blocks,
+                        const BlockHandle& last_partition_block_handle) = 0;
+
+  // Get the estimated size for index block.
+  virtual size_t EstimatedSize() const = 0;
+
+ protected:
+  const Comparator* comparator_;
+};
+
+// This index builder builds space-efficient index block.
+//
+// Optimizations:
+//  1. Made block's `block_restart_interval` to be 1, which will avoid linear
+//     search when doing index lookup (can be disabled by setting
+//     index_block_restart_interval).
+//  2. Shorten the key length for index block. Other than honestly using the
+//     last key in the data block as the index key, we instead find a shortest
+//     substitute key that serves the same function.
+class ShortenedIndexBuilder : public IndexBuilder {
+ public:
+  explicit ShortenedIndexBuilder(const Comparator* comparator,
+                                 int index_block_restart_interval)
+      : IndexBuilder(comparator),
+        index_block_builder_(index_block_restart_interval) {}
+
+  virtual void AddIndexEntry(std::string* last_key_in_current_block,
+                             const Slice* first_key_in_next_block,
+                             const BlockHandle& block_handle) override {
+    if (first_key_in_next_block != nullptr) {
+      comparator_->FindShortestSeparator(last_key_in_current_block,
+                                         *first_key_in_next_block);
+    } else {
+      comparator_->FindShortSuccessor(last_key_in_current_block);
+    }
+
+    std::string handle_encoding;
+    block_handle.EncodeTo(&handle_encoding);
+    index_block_builder_.Add(*last_key_in_current_block, handle_encoding);
+  }
+
+  using IndexBuilder::Finish;
+  virtual Status Finish(
+      IndexBlocks* index_blocks,
+      const BlockHandle& last_partition_block_handle) override {
+    index_blocks->index_block_contents = index_block_builder_.Finish();
+    return Status::OK();
+  }
+
+  virtual size_t EstimatedSize() const override {
+    return index_block_builder_.CurrentSizeEstimate();
+  }
+
+ private:
+  BlockBuilder index_block_builder_;
+};
+
+// This index builder cuts the index into partitions of about
+// partition_size bytes, each built by a ShortenedIndexBuilder, and a top
+// level index with the last key of each partition. Only the top level index
+// has to be held in memory by the table reader, the partitions are read on
+// demand like data blocks.
+class PartitionedIndexBuilder : public IndexBuilder {
+ public:
+  PartitionedIndexBuilder(const Comparator* comparator,
+                          int index_block_restart_interval,
+                          uint64_t partition_size);
+
+  virtual void AddIndexEntry(std::string* last_key_in_current_block,
+                             const Slice* first_key_in_next_block,
+                             const BlockHandle& block_handle) override;
+
+  using IndexBuilder::Finish;
+  virtual Status Finish(
+      IndexBlocks* index_blocks,
+      const BlockHandle& last_partition_block_handle) override;
+
+  virtual size_t EstimatedSize() const override;
+
+ private:
+  struct Entry {
+    std::string key;
+    std::unique_ptr<ShortenedIndexBuilder> value;
+  };
+
+  const int index_block_restart_interval_;
+  const uint64_t partition_size_;
+  std::list<Entry> entries_;  // the partitions to be written
+  BlockBuilder index_block_builder_;  // top level index
+  std::unique_ptr<ShortenedIndexBuilder> sub_index_builder_;
+  std::string sub_index_last_key_;
+  size_t partitions_size_ = 0;  // the estimated size of the cut partitions
+  bool finishing_ = false;  // true after the first call of Finish()
+};
+
+// Create a index builder based on its type.
+extern IndexBuilder* CreateIndexBuilder(TableOptions::IndexType index_type,
+                                        const Comparator* comparator,
+                                        int index_block_restart_interval,
+                                        uint64_t metadata_block_size);
+
+}  // namespace vidardb
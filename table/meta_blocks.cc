@@ -12,6 +12,7 @@
 #include <map>
 #include <string>
 
+#include "db/range_del_aggregator.h"  // Shichao
 #include "db/table_properties_collector.h"
 #include "vidardb/table.h"
 #include "vidardb/table_properties.h"
@@ -70,6 +71,8 @@ void PropertyBlockBuilder::AddTableProperty(const TableProperties& props) {
   Add(TablePropertiesNames::kDataSize, props.data_size);
   Add(TablePropertiesNames::kIndexSize, props.index_size);
   Add(TablePropertiesNames::kNumEntries, props.num_entries);
+  Add(TablePropertiesNames::kNumRangeDeletions,
+      props.num_range_deletions);  // Shichao
   Add(TablePropertiesNames::kNumDataBlocks, props.num_data_blocks);
   Add(TablePropertiesNames::kFilterSize, props.filter_size);
   Add(TablePropertiesNames::kFormatVersion, props.format_version);
@@ -213,6 +216,8 @@ Status ReadProperties(const Slice& handle_value, RandomAccessFileReader* file,
       {TablePropertiesNames::kNumDataBlocks,
        &new_table_properties->num_data_blocks},
       {TablePropertiesNames::kNumEntries, &new_table_properties->num_entries},
+      {TablePropertiesNames::kNumRangeDeletions,
+       &new_table_properties->num_range_deletions},  // Shichao
       {TablePropertiesNames::kFormatVersion,
        &new_table_properties->format_version},
       {TablePropertiesNames::kFixedKeyLen,
@@ -441,4 +446,25 @@ Status ReadMetaBlock(RandomAccessFileReader* file, uint64_t file_size,
                            env, false /* decompress */);
 }
 
+/***************************** Shichao ******************************/
+Status ReadRangeDelBlock(
+    RandomAccessFileReader* file, uint64_t file_size,
+    uint64_t table_magic_number, Env* env,
+    const InternalKeyComparator& internal_comparator,
+    std::shared_ptr<const FragmentedRangeTombstoneList>* range_del_list) {
+  BlockContents contents;
+  Status s = ReadMetaBlock(file, file_size, table_magic_number, env,
+                           kRangeDelBlock, &contents);
+  if (!s.ok()) {
+    return s;
+  }
+  Block range_del_block(std::move(contents));
+  std::unique_ptr<InternalIterator> iter(
+      range_del_block.NewIterator(&internal_comparator));
+  *range_del_list = FragmentedRangeTombstoneList::Create(
+      iter.get(), internal_comparator.user_comparator(), &s);
+  return s;
+}
+/***************************** Shichao ******************************/
+
 }  // namespace vidardb
@@ -29,6 +29,7 @@ class BlockBuilder;
 class BlockHandle;
 class Env;
 class Footer;
+class FragmentedRangeTombstoneList;  // Shichao
 class Logger;
 class RandomAccessFile;
 struct TableProperties;
@@ -158,4 +159,14 @@ Status ReadMetaBlock(RandomAccessFileReader* file, uint64_t file_size,
                      const std::string& meta_block_name,
                      BlockContents* contents);
 
+/***************************** Shichao ******************************/
+// Read the range deletion meta block from `file` and fragment its range
+// tombstones into `range_del_list`.
+Status ReadRangeDelBlock(
+    RandomAccessFileReader* file, uint64_t file_size,
+    uint64_t table_magic_number, Env* env,
+    const InternalKeyComparator& internal_comparator,
+    std::shared_ptr<const FragmentedRangeTombstoneList>* range_del_list);
+/***************************** Shichao ******************************/
+
 }  // namespace vidardb
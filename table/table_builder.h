@@ -28,6 +28,7 @@ namespace vidardb {
 
 class Slice;
 class Status;
+class TableOpenState;  // Shichao
 
 struct TableReaderOptions {
   TableReaderOptions(const ImmutableCFOptions& _ioptions,
@@ -47,6 +48,8 @@ struct TableReaderOptions {
   // what level this table/file is on, -1 for "not set, don't know"
   int level;
   std::vector<uint32_t> cols;  // Shichao
+  // the sub-column files are opened through it if not nullptr
+  TableOpenState* open_state = nullptr;  // Shichao
 };
 
 struct TableBuilderOptions {
@@ -0,0 +1,219 @@
+//  Copyright (c) 2019-present, VidarDB, Inc.  All rights reserved.
+//  This source code is licensed under the BSD-style license found in the
+//  LICENSE file in the root directory of this source tree. An additional grant
+//  of patent rights can be found in the PATENTS file in the same directory.
+
+#include "table/table_open_state.h"
+
+#include <map>
+#include <set>
+#include <string.h>
+
+#include "util/coding.h"
+#include "util/crc32c.h"
+#include "util/statistics.h"
+
+namespace vidardb {
+
+namespace {
+// "TOPENST1" in little endian
+const uint64_t kTableOpenStateMagic = 0x3154534e45504f54ull;
+
+void SplitFileName(const std::string& fname, std::string* dir,
+                   std::string* base) {
+  size_t pos = fname.rfind('/');
+  if (pos == std::string::npos) {
+    dir->clear();
+    *base = fname;
+  } else {
+    *dir = fname.substr(0, pos);
+    *base = fname.substr(pos + 1);
+  }
+}
+}  // anonymous namespace
+
+TableOpenState::File::File(TableOpenState* state, const std::string& fname,
+                           uint64_t file_size,
+                           std::shared_ptr<const Entry> entry,
+                           std::unique_ptr<RandomAccessFile>&& file)
+    : RandomAccessFile(fname),
+      state_(state),
+      file_size_(file_size),
+      file_(std::move(file)),
+      active_(true),
+      entry_(std::move(entry)) {
+  if (!entry_) {
+    recorded_.reset(new Entry());
+    recorded_->file_size = file_size_;
+  }
+}
+
+Status TableOpenState::File::Read(uint64_t offset, size_t n, Slice* result,
+                                  char* scratch) const {
+  if (!active_.load(std::memory_order_relaxed)) {
+    return file_->Read(offset, n, result, scratch);
+  }
+
+  if (entry_) {
+    for (const auto& read : entry_->reads) {
+      if (read.offset == offset && read.data.size() == n) {
+        memcpy(scratch, read.data.data(), n);
+        *result = Slice(scratch, n);
+        RecordTick(state_->statistics_, TABLE_OPEN_STATE_HIT);
+        return Status::OK();
+      }
+    }
+    RecordTick(state_->statistics_, TABLE_OPEN_STATE_MISS);
+    return file_->Read(offset, n, result, scratch);
+  }
+
+  for (const auto& read : recorded_->reads) {
+    // the footer is read again by the meta block lookups
+    if (read.offset == offset && read.data.size() == n) {
+      memcpy(scratch, read.data.data(), n);
+      *result = Slice(scratch, n);
+      return Status::OK();
+    }
+  }
+  Status s = file_->Read(offset, n, result, scratch);
+  // a short read is not recorded, it is served by the file next time
+  if (s.ok() && result->size() == n &&
+      recorded_->bytes + n <= kMaxBytesPerFile) {
+    recorded_->reads.push_back({offset, result->ToString()});
+    recorded_->bytes += n;
+  }
+  return s;
+}
+
+void TableOpenState::File::Finish() {
+  active_.store(false, std::memory_order_relaxed);
+  if (recorded_ && !recorded_->reads.empty()) {
+    state_->Add(filename_, std::move(recorded_));
+  }
+  recorded_.reset();
+}
+
+std::unique_ptr<TableOpenState::File> TableOpenState::NewFile(
+    const std::string& fname, uint64_t file_size,
+    std::unique_ptr<RandomAccessFile>&& file) {
+  std::shared_ptr<const Entry> entry;
+  {
+    MutexLock l(&mutex_);
+    auto it = entries_.find(fname);
+    // file numbers are never reused, the size only guards against a table
+    // file replaced behind our back
+    if (it != entries_.end() && it->second->file_size == file_size) {
+      entry = it->second;
+    }
+  }
+  return std::unique_ptr<File>(
+      new File(this, fname, file_size, std::move(entry), std::move(file)));
+}
+
+void TableOpenState::Add(const std::string& fname,
+                         std::unique_ptr<Entry>&& entry) {
+  MutexLock l(&mutex_);
+  entries_[fname] = std::shared_ptr<const Entry>(entry.release());
+}
+
+size_t TableOpenState::NumEntries() const {
+  MutexLock l(&mutex_);
+  return entries_.size();
+}
+
+// Format:
+//   magic: fixed64
+//   entries: (fname: length prefixed, file_size: varint64,
+//             num_reads: varint32, (offset: varint64, data: length prefixed)*)*
+//   checksum: fixed32, masked crc32c of all above
+Status TableOpenState::Load(const std::string& fname) {
+  std::string contents;
+  Status s = ReadFileToString(env_, fname, &contents);
+  if (!s.ok()) {
+    return s;
+  }
+  if (contents.size() < sizeof(uint64_t) + sizeof(uint32_t)) {
+    return Status::Corruption("table open state too short", fname);
+  }
+  size_t body_size = contents.size() - sizeof(uint32_t);
+  uint32_t expected = crc32c::Unmask(DecodeFixed32(&contents[body_size]));
+  if (crc32c::Value(contents.data(), body_size) != expected) {
+    return Status::Corruption("table open state checksum mismatch", fname);
+  }
+  if (DecodeFixed64(contents.data()) != kTableOpenStateMagic) {
+    return Status::Corruption("bad table open state magic", fname);
+  }
+
+  Slice input(contents.data() + sizeof(uint64_t),
+              body_size - sizeof(uint64_t));
+  std::unordered_map<std::string, std::shared_ptr<const Entry>> entries;
+  while (!input.empty()) {
+    Slice name;
+    std::unique_ptr<Entry> entry(new Entry());
+    uint32_t num_reads = 0;
+    if (!GetLengthPrefixedSlice(&input, &name) ||
+        !GetVarint64(&input, &entry->file_size) ||
+        !GetVarint32(&input, &num_reads)) {
+      return Status::Corruption("bad table open state entry", fname);
+    }
+    for (uint32_t i = 0; i < num_reads; i++) {
+      uint64_t offset = 0;
+      Slice data;
+      if (!GetVarint64(&input, &offset) ||
+          !GetLengthPrefixedSlice(&input, &data)) {
+        return Status::Corruption("bad table open state read", fname);
+      }
+      entry->reads.push_back({offset, data.ToString()});
+      entry->bytes += data.size();
+    }
+    entries[name.ToString()] = std::shared_ptr<const Entry>(entry.release());
+  }
+
+  MutexLock l(&mutex_);
+  entries_.swap(entries);
+  return Status::OK();
+}
+
+Status TableOpenState::Save(const std::string& fname) {
+  std::string contents;
+  PutFixed64(&contents, kTableOpenStateMagic);
+  {
+    MutexLock l(&mutex_);
+    // the children of each directory holding table files
+    std::map<std::string, std::set<std::string>> children;
+    std::string dir, base;
+    for (const auto& it : entries_) {
+      SplitFileName(it.first, &dir, &base);
+      auto dir_it = children.find(dir);
+      if (dir_it == children.end()) {
+        std::vector<std::string> names;
+        env_->GetChildren(dir, &names);
+        dir_it = children.emplace(dir, std::set<std::string>(names.begin(),
+                                                             names.end()))
+                     .first;
+      }
+      if (dir_it->second.count(base) == 0) {
+        continue;  // obsolete table file
+      }
+      PutLengthPrefixedSlice(&contents, it.first);
+      PutVarint64(&contents, it.second->file_size);
+      PutVarint32(&contents,
+                  static_cast<uint32_t>(it.second->reads.size()));
+      for (const auto& read : it.second->reads) {
+        PutVarint64(&contents, read.offset);
+        PutLengthPrefixedSlice(&contents, read.data);
+      }
+    }
+  }
+  PutFixed32(&contents,
+             crc32c::Mask(crc32c::Value(contents.data(), contents.size())));
+
+  std::string tmp = fname + ".dbtmp";
+  Status s = WriteStringToFile(env_, contents, tmp, true);
+  if (s.ok()) {
+    s = env_->RenameFile(tmp, fname);
+  }
+  return s;
+}
+
+}  // namespace vidardb
@@ -0,0 +1,111 @@
+//  Copyright (c) 2019-present, VidarDB, Inc.  All rights reserved.
+//  This source code is licensed under the BSD-style license found in the
+//  LICENSE file in the root directory of this source tree. An additional grant
+//  of patent rights can be found in the PATENTS file in the same directory.
+//
+// TableOpenState remembers the reads issued while a table file is opened,
+// i.e. its footer and meta blocks (for a column table also the column block
+// listing the sub-column files), and persists them across restarts. A warm
+// DB::Open then serves these reads from one sequential file instead of a few
+// random reads per table file and sub-column file.
+
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "port/port.h"
+#include "vidardb/env.h"
+#include "vidardb/status.h"
+
+namespace vidardb {
+
+class Statistics;
+
+class TableOpenState {
+ public:
+  // The reads recorded for one table file.
+  struct Entry {
+    struct Read {
+      uint64_t offset;
+      std::string data;
+    };
+    uint64_t file_size = 0;
+    size_t bytes = 0;
+    std::vector<Read> reads;
+  };
+
+  // A file wrapper that serves the reads of opening the table from the entry
+  // of the file, or records them if there is no entry yet. Once the table is
+  // opened, call Finish() and it becomes a plain pass-through.
+  class File : public RandomAccessFile {
+   public:
+    File(TableOpenState* state, const std::string& fname, uint64_t file_size,
+         std::shared_ptr<const Entry> entry,
+         std::unique_ptr<RandomAccessFile>&& file);
+
+    Status Read(uint64_t offset, size_t n, Slice* result,
+                char* scratch) const override;
+
+    bool ShouldForwardRawRequest() const override {
+      return file_->ShouldForwardRawRequest();
+    }
+    void EnableReadAhead() override { file_->EnableReadAhead(); }
+    size_t GetUniqueId(char* id, size_t max_size) const override {
+      return file_->GetUniqueId(id, max_size);
+    }
+    size_t ReadaheadSize() override { return file_->ReadaheadSize(); }
+    void Hint(AccessPattern pattern) override { file_->Hint(pattern); }
+    Status InvalidateCache(size_t offset, size_t length) override {
+      return file_->InvalidateCache(offset, length);
+    }
+
+    // Stop serving and recording reads once the table is opened successfully,
+    // and add the recorded reads to the state.
+    void Finish();
+
+   private:
+    TableOpenState* const state_;
+    const uint64_t file_size_;
+    std::unique_ptr<RandomAccessFile> file_;
+    std::atomic<bool> active_;
+    // loaded or recorded before, or nullptr if the reads go to recorded_
+    std::shared_ptr<const Entry> entry_;
+    // Open is single threaded, but Read() is const
+    mutable std::unique_ptr<Entry> recorded_;
+  };
+
+  // The reads of one file are recorded up to this many bytes, which covers the
+  // meta blocks and small index blocks.
+  static const size_t kMaxBytesPerFile = 16 << 10;
+
+  TableOpenState(Env* env, Statistics* statistics)
+      : env_(env), statistics_(statistics) {}
+
+  // Wrap file, which is the table file fname of file_size bytes about to be
+  // opened.
+  std::unique_ptr<File> NewFile(const std::string& fname, uint64_t file_size,
+                                std::unique_ptr<RandomAccessFile>&& file);
+
+  // Load the snapshot written by Save(). A missing or corrupted snapshot
+  // leaves the state empty, which only costs the reads it would have saved.
+  Status Load(const std::string& fname);
+
+  // Persist the entries of the table files that still exist.
+  Status Save(const std::string& fname);
+
+  size_t NumEntries() const;
+
+ private:
+  void Add(const std::string& fname, std::unique_ptr<Entry>&& entry);
+
+  Env* const env_;
+  Statistics* const statistics_;
+  mutable port::Mutex mutex_;
+  std::unordered_map<std::string, std::shared_ptr<const Entry>> entries_;
+};
+
+}  // namespace vidardb
@@ -70,6 +70,8 @@ std::string TableProperties::ToString(
   AppendProperty(result, "# data blocks", num_data_blocks, prop_delim,
                  kv_delim);
   AppendProperty(result, "# entries", num_entries, prop_delim, kv_delim);
+  AppendProperty(result, "# range deletions", num_range_deletions, prop_delim,
+                 kv_delim);  // Shichao
 
   AppendProperty(result, "raw key size", raw_key_size, prop_delim, kv_delim);
   AppendProperty(result, "raw average key size",
@@ -123,6 +125,7 @@ void TableProperties::Add(const TableProperties& tp) {
   raw_value_size += tp.raw_value_size;
   num_data_blocks += tp.num_data_blocks;
   num_entries += tp.num_entries;
+  num_range_deletions += tp.num_range_deletions;  // Shichao
 }
 
 const std::string TablePropertiesNames::kDataSize  =
@@ -139,6 +142,8 @@ const std::string TablePropertiesNames::kNumDataBlocks =
     "vidardb.num.data.blocks";
 const std::string TablePropertiesNames::kNumEntries =
     "vidardb.num.entries";
+const std::string TablePropertiesNames::kNumRangeDeletions =
+    "vidardb.num.range-deletions";  // Shichao
 const std::string TablePropertiesNames::kFilterPolicy =
     "vidardb.filter.policy";
 const std::string TablePropertiesNames::kFormatVersion =
@@ -161,6 +166,7 @@ extern const std::string kPropertiesBlock = "vidardb.properties";
 extern const std::string kPropertiesBlockOldName = "vidardb.stats";
 extern const std::string kCompressionDictBlock = "vidardb.compression_dict";
 extern const std::string kColumnBlock = "vidardb.column";  // Shichao
+extern const std::string kRangeDelBlock = "vidardb.range_del";  // Shichao
 
 // Seek to the properties block.
 // Return true if it successfully seeks to the properties block.
@@ -184,6 +190,12 @@ Status SeekToCompressionDictBlock(InternalIterator* meta_iter, bool* is_found) {
 Status SeekToColumnBlock(InternalIterator* meta_iter, bool* is_found) {
   return SeekToMetaBlock(meta_iter, kColumnBlock, is_found);
 }
+
+// Seek to the range deletion block.
+// Return true if it successfully seeks to that block.
+Status SeekToRangeDelBlock(InternalIterator* meta_iter, bool* is_found) {
+  return SeekToMetaBlock(meta_iter, kRangeDelBlock, is_found);
+}
 /****************************** Shichao *******************************/
 
 }  // namespace vidardb
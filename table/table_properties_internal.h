@@ -31,5 +31,9 @@ Status SeekToCompressionDictBlock(InternalIterator* meta_iter, bool* is_found);
 // Seek to the column block.
 // Return true if it successfully seeks to that block.
 Status SeekToColumnBlock(InternalIterator* meta_iter, bool* is_found);
+
+// Seek to the range deletion block.
+// Return true if it successfully seeks to that block.
+Status SeekToRangeDelBlock(InternalIterator* meta_iter, bool* is_found);
 /****************************** Shichao *****************************/
 }  // namespace vidardb
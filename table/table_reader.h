@@ -9,6 +9,11 @@
 
 #pragma once
 #include <memory>
+#include <string>
+#include <vector>
+
+#include "vidardb/slice.h"
+#include "vidardb/status.h"
 
 namespace vidardb {
 
@@ -20,6 +25,7 @@ struct ReadOptions;
 struct TableProperties;
 class GetContext;
 class InternalIterator;
+class FragmentedRangeTombstoneList;  // Shichao
 
 // A Table is a sorted map from strings to strings. Tables are
 // immutable and persistent. A Table may be safely accessed from
@@ -69,12 +75,40 @@ class TableReader {
   // be close to the file length.
   virtual uint64_t ApproximateOffsetOf(const Slice& key) = 0;
 
+  // An anchor is a user key sampled from the table, together with the
+  // approximate number of bytes between the previous anchor (or the start of
+  // the table) and this one. The sizes cover every file that belongs to the
+  // table, e.g. the sub column files of a column table.
+  struct Anchor {
+    Anchor(const Slice& _user_key, uint64_t _range_size)
+        : user_key(_user_key.data(), _user_key.size()),
+          range_size(_range_size) {}
+    std::string user_key;
+    uint64_t range_size;
+  };
+
+  // Fill "anchors" with at most about kMaxNumAnchors anchors in increasing
+  // key order that partition the table into ranges of similar size.
+  // Used to plan balanced subcompactions.
+  static const size_t kMaxNumAnchors = 128;
+  virtual Status ApproximateKeyAnchors(const ReadOptions& read_options,
+                                       std::vector<Anchor>& anchors) {
+    return Status::NotSupported("ApproximateKeyAnchors() not supported");
+  }
+
   // Set up the table for Compaction. Might change some parameters with
   // posix_fadvise
   virtual void SetupForCompaction() = 0;
 
   virtual std::shared_ptr<const TableProperties> GetTableProperties() const = 0;
 
+  // Return the fragmented range tombstones of the table, nullptr if none.
+  // They are read once when the table is opened.
+  virtual std::shared_ptr<const FragmentedRangeTombstoneList>
+  GetRangeTombstoneList() const {  // Shichao
+    return nullptr;
+  }
+
   // Prepare work that can be done before the real Get()
   virtual void Prepare(const Slice& target) {}
 
@@ -164,8 +164,10 @@ void TableReaderBenchmark(Options& opts, EnvOptions& env_options,
           uint64_t start_time = Now(env, measured_by_nanosecond);
           if (!through_db) {
             std::string value;
-            GetContext get_context(ioptions.comparator, GetContext::kNotFound,
-                                   Slice(key), &value, nullptr);
+            MergeContext merge_context;
+            GetContext get_context(ioptions.comparator, ioptions.merge_operator,
+                                   ioptions.info_log, GetContext::kNotFound,
+                                   Slice(key), &value, nullptr, &merge_context);
             s = table_reader->Get(read_options, key, &get_context);
           } else {
             s = db->Get(read_options, key, &result);
@@ -157,6 +157,13 @@ void TwoLevelIterator::SkipEmptyDataBlocksForward() {
       SetSecondLevelIterator(nullptr);
       return;
     }
+    /***************************** Shichao ******************************/
+    if (state_->KeyReachedUpperBound(first_level_iter_.key())) {
+      // the next block is entirely beyond the bound
+      SetSecondLevelIterator(nullptr);
+      return;
+    }
+    /***************************** Shichao ******************************/
     first_level_iter_.Next();
     InitDataBlock();
     if (second_level_iter_.iter() != nullptr) {
@@ -175,6 +182,14 @@ void TwoLevelIterator::SkipEmptyDataBlocksBackward() {
       return;
     }
     first_level_iter_.Prev();
+    /***************************** Shichao ******************************/
+    if (first_level_iter_.Valid() &&
+        state_->KeyBeforeLowerBound(first_level_iter_.key())) {
+      // the previous block is entirely before the bound
+      SetSecondLevelIterator(nullptr);
+      return;
+    }
+    /***************************** Shichao ******************************/
     InitDataBlock();
     if (second_level_iter_.iter() != nullptr) {
       second_level_iter_.SeekToLast();
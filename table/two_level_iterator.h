@@ -23,6 +23,23 @@ struct TwoLevelIteratorState {
 
   virtual ~TwoLevelIteratorState() {}
   virtual InternalIterator* NewSecondaryIterator(const Slice& handle) = 0;
+
+  /***************************** Shichao ******************************/
+  // Whether the first level key, which is no less than the keys of its
+  // second level iterator and less than those of the next one, has reached
+  // ReadOptions::iterate_upper_bound. The next second level iterator is then
+  // not created at all.
+  virtual bool KeyReachedUpperBound(const Slice& first_level_key) {
+    return false;
+  }
+
+  // Whether the first level key is before ReadOptions::iterate_lower_bound,
+  // so are all the keys of its second level iterator, which is then not
+  // created at all.
+  virtual bool KeyBeforeLowerBound(const Slice& first_level_key) {
+    return false;
+  }
+  /***************************** Shichao ******************************/
 };
 
 
@@ -457,6 +457,33 @@ class CompactionJobStatsChecker : public EventListener {
     ASSERT_EQ(current_stats.is_manual_compaction,
         stats.is_manual_compaction);
 
+    // per-subcompaction stats add up to the job totals
+    ASSERT_GE(current_stats.subcompactions.size(), 1U);
+    uint64_t sub_output_records = 0;
+    size_t sub_output_files = 0;
+    for (const auto& sub : current_stats.subcompactions) {
+      sub_output_records += sub.num_output_records;
+      sub_output_files += sub.num_output_files;
+    }
+    ASSERT_EQ(sub_output_records, current_stats.num_output_records);
+    ASSERT_EQ(sub_output_files, current_stats.num_output_files);
+
+    // the planned input is spread evenly over the subcompactions, within
+    // the granularity of the sampled key anchors
+    const double kSubcompactionBias = 0.50;
+    if (current_stats.subcompactions.size() > 1) {
+      uint64_t sub_input_bytes = 0;
+      for (const auto& sub : current_stats.subcompactions) {
+        sub_input_bytes += sub.approx_input_bytes;
+      }
+      double mean = static_cast<double>(sub_input_bytes) /
+                    current_stats.subcompactions.size();
+      for (const auto& sub : current_stats.subcompactions) {
+        ASSERT_GE(sub.approx_input_bytes, mean * (1.00 - kSubcompactionBias));
+        ASSERT_LE(sub.approx_input_bytes, mean * (1.00 + kSubcompactionBias));
+      }
+    }
+
     // file size
     double kFileSizeBias = compression_enabled_ ? 0.20 : 0.10;
     ASSERT_GE(current_stats.total_input_bytes * (1.00 + kFileSizeBias),
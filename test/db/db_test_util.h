@@ -178,9 +178,9 @@ class SpecialSkipListFactory : public MemTableRepFactory {
 
   virtual MemTableRep* CreateMemTableRep(
       const MemTableRep::KeyComparator& compare, MemTableAllocator* allocator,
-      Logger* logger) override {
+      const SliceTransform* transform, Logger* logger) override {
     return new SpecialMemTableRep(
-        allocator, factory_.CreateMemTableRep(compare, allocator, 0),
+        allocator, factory_.CreateMemTableRep(compare, allocator, transform, 0),
         num_entries_flush_);
   }
   virtual const char* Name() const override { return "SkipListFactory"; }
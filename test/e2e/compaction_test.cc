@@ -0,0 +1,587 @@
+// Copyright (c) 2020-present, VidarDB, Inc.  All rights reserved.
+// This source code is licensed under the BSD-style license found in the
+// LICENSE file in the root directory of this source tree. An additional grant
+// of patent rights can be found in the PATENTS file in the same directory.
+
+#include <atomic>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+#include "vidardb/compaction_filter.h"
+#include "vidardb/db.h"
+#include "vidardb/env.h"
+#include "vidardb/listener.h"
+#include "vidardb/options.h"
+#include "vidardb/rate_limiter.h"
+#include "vidardb/splitter.h"
+#include "vidardb/statistics.h"
+#include "vidardb/status.h"
+#include "vidardb/table.h"
+#include "vidardb/thread_status.h"
+
+using namespace std;
+using namespace vidardb;
+
+const unsigned int kColumn = 3;
+const int kNumKeys = 1000;
+const uint64_t kTTL = 90 * 24 * 3600;  // 90 days
+const string kDBPath = "/tmp/vidardb_compaction_test";
+const int kRateLimiterKeys = 3000;
+const int kTimeSliceKeys = 1000;
+const uint64_t kSpinMicros = 1000;       // per key of the slow compaction
+const uint64_t kTimeSlice = 200 * 1000;  // 200ms
+const int kSubcompactionKeys = 20000;
+const uint32_t kSubcompactions = 4;
+
+// Drop the rows whose name starts with "drop", rename the "old" ones.
+class RowFilter : public CompactionFilter {
+ public:
+  virtual bool Filter(int level, const Slice& key, const Slice& existing_value,
+                      string* new_value, bool* value_changed) const override {
+    if (existing_value.starts_with("drop")) {
+      return true;
+    }
+    if (existing_value.starts_with("old")) {
+      *new_value = "new" + existing_value.ToString().substr(3);
+      *value_changed = true;
+    }
+    return false;
+  }
+
+  virtual const char* Name() const override { return "RowFilter"; }
+};
+
+// Count the compactions of the TTL filter factory.
+class CountingFactory : public CompactionFilterFactory {
+ public:
+  explicit CountingFactory(CompactionFilterFactory* base) : base_(base) {}
+
+  virtual unique_ptr<CompactionFilter> CreateCompactionFilter(
+      const CompactionFilter::Context& context) override {
+    assert(context.is_manual_compaction);
+    created_++;
+    return base_->CreateCompactionFilter(context);
+  }
+
+  virtual const char* Name() const override { return "CountingFactory"; }
+
+  int created_ = 0;
+
+ private:
+  unique_ptr<CompactionFilterFactory> base_;
+};
+
+Options GetOptions(bool column) {
+  Options options;
+  options.create_if_missing = true;
+  options.disable_auto_compactions = true;
+  options.splitter.reset(NewEncodingSplitter());
+  if (column) {
+    TableFactory* table_factory = NewColumnTableFactory();
+    ColumnTableOptions* opts =
+        static_cast<ColumnTableOptions*>(table_factory->GetOptions());
+    opts->column_count = kColumn;
+    options.table_factory.reset(table_factory);
+  }
+  return options;
+}
+
+void TestFilter() {
+  cout << ">> filter" << endl;
+  int ret = system(string("rm -rf " + kDBPath).c_str());
+
+  RowFilter filter;
+  Options options = GetOptions(false);
+  options.compaction_filter = &filter;
+  DB* db;
+  Status s = DB::Open(options, kDBPath, &db);
+  assert(s.ok());
+
+  WriteOptions wo;
+  s = db->Put(wo, "1", "drop1");
+  assert(s.ok());
+  s = db->Put(wo, "2", "old2");
+  assert(s.ok());
+  s = db->Put(wo, "3", "keep3");
+  assert(s.ok());
+  s = db->Flush(FlushOptions());
+  assert(s.ok());
+
+  // the flush does not filter
+  ReadOptions ro;
+  string val;
+  s = db->Get(ro, "1", &val);
+  assert(s.ok() && val == "drop1");
+
+  s = db->CompactRange(CompactRangeOptions(), nullptr, nullptr);
+  assert(s.ok());
+  s = db->Get(ro, "1", &val);
+  assert(s.IsNotFound());
+  s = db->Get(ro, "2", &val);
+  assert(s.ok() && val == "new2");
+  s = db->Get(ro, "3", &val);
+  assert(s.ok() && val == "keep3");
+
+  delete db;
+  cout << endl;
+}
+
+void TestTTL(bool column) {
+  cout << ">> ttl, " << (column ? "column" : "row") << endl;
+  int ret = system(string("rm -rf " + kDBPath).c_str());
+
+  Options options = GetOptions(column);
+  // the timestamp is the 2nd column
+  CountingFactory* factory =
+      new CountingFactory(NewTTLCompactionFilterFactory(2, kTTL));
+  options.compaction_filter_factory.reset(factory);
+  DB* db;
+  Status s = DB::Open(options, kDBPath, &db);
+  assert(s.ok());
+
+  // one in four rows expired a day ago, one in eight is malformed
+  const uint64_t now = Env::Default()->NowMicros() / 1000000;
+  auto timestamp = [&](int i) -> string {
+    if (i % 8 == 1) {
+      return "n/a";
+    }
+    return to_string(i % 4 == 0 ? now - kTTL - 24 * 3600 : now - i);
+  };
+  WriteOptions wo;
+  for (int f = 0; f < 2; f++) {
+    for (int i = f; i < kNumKeys; i += 2) {
+      string key = to_string(100000 + i);
+      s = db->Put(wo, key, options.splitter->Stitch(
+                               {"name" + key, timestamp(i), "city" + key}));
+      assert(s.ok());
+    }
+    s = db->Flush(FlushOptions());
+    assert(s.ok());
+  }
+
+  // the rows of a snapshot are not filtered
+  const Snapshot* snapshot = db->GetSnapshot();
+  s = db->CompactRange(CompactRangeOptions(), nullptr, nullptr);
+  assert(s.ok());
+  ReadOptions ro;
+  string val;
+  s = db->Get(ro, "100000", &val);
+  assert(s.ok());
+  db->ReleaseSnapshot(snapshot);
+
+  int created = factory->created_;
+  assert(created > 0);
+  s = db->CompactRange(CompactRangeOptions(), nullptr, nullptr);
+  assert(s.ok());
+  assert(factory->created_ > created);
+
+  for (int i = 0; i < kNumKeys; i++) {
+    string key = to_string(100000 + i);
+    s = db->Get(ro, key, &val);
+    if (i % 4 == 0) {
+      assert(s.IsNotFound());
+    } else {
+      assert(s.ok());
+      vector<Slice> vals(options.splitter->Split(val));
+      assert(vals.size() == kColumn && vals[1].ToString() == timestamp(i));
+    }
+  }
+
+  unique_ptr<Iterator> it(db->NewIterator(ro));
+  int count = 0;
+  for (it->SeekToFirst(); it->Valid(); it->Next()) {
+    count++;
+  }
+  assert(it->status().ok());
+  cout << "rows left: " << count << endl;
+  assert(count == kNumKeys - kNumKeys / 4);
+
+  it.reset();
+  delete db;
+  cout << endl;
+}
+
+void TestThrottle() {
+  cout << ">> throttle" << endl;
+  // 10MB/s refilled every 10ms
+  const int64_t kRate = 10 << 20, kBurst = kRate / 100;
+  unique_ptr<RateLimiter> limiter(NewGenericRateLimiter(kRate, 10 * 1000));
+  assert(limiter->GetSingleBurstBytes() == kBurst);
+  shared_ptr<Statistics> stats = CreateDBStatistics();
+
+  Env* env = Env::Default();
+  uint64_t start = env->NowMicros();
+  auto request = [&](Env::IOPriority pri) {
+    for (int i = 0; i < 15; i++) {
+      limiter->Request(kBurst, pri, stats.get());
+    }
+  };
+  thread flush(request, Env::IO_HIGH);
+  thread compaction(request, Env::IO_LOW);
+  thread scan(request, Env::IO_USER);
+  flush.join();
+  compaction.join();
+  scan.join();
+  uint64_t elapsed = env->NowMicros() - start;
+  cout << "elapsed micros: " << elapsed << endl;
+  // 45 bursts at 100 bursts per second
+  assert(elapsed >= 400 * 1000);
+
+  assert(limiter->GetTotalBytesThrough(Env::IO_HIGH) == 15 * kBurst);
+  assert(limiter->GetTotalBytesThrough(Env::IO_LOW) == 15 * kBurst);
+  assert(limiter->GetTotalBytesThrough(Env::IO_USER) == 15 * kBurst);
+  assert(limiter->GetTotalBytesThrough() == 45 * kBurst);
+  assert(limiter->GetTotalRequests() == 45);
+  assert(stats->getTickerCount(RATE_LIMITER_FLUSH_MICROS) > 0);
+  assert(stats->getTickerCount(RATE_LIMITER_USER_MICROS) > 0);
+  assert(stats->getTickerCount(RATE_LIMITER_COMPACTION_MICROS) > 0);
+  // the flushes are served first
+  assert(stats->getTickerCount(RATE_LIMITER_FLUSH_MICROS) <
+         stats->getTickerCount(RATE_LIMITER_COMPACTION_MICROS));
+  cout << endl;
+}
+
+void TestAutoTune() {
+  cout << ">> auto tune" << endl;
+  const int64_t kMaxRate = 100 << 20;
+  unique_ptr<RateLimiter> limiter(
+      NewGenericRateLimiter(kMaxRate, 100 * 1000, 10, true, 1ull << 30));
+  assert(limiter->GetBytesPerSecond() == kMaxRate / 20);
+  limiter->Tune(1ull << 29);
+  assert(limiter->GetBytesPerSecond() == kMaxRate / 2);
+  limiter->Tune(1ull << 32);
+  assert(limiter->GetBytesPerSecond() == kMaxRate);
+  limiter->Tune(0);
+  assert(limiter->GetBytesPerSecond() == kMaxRate / 20);
+  limiter->SetBytesPerSecond(kMaxRate * 2);
+  assert(limiter->GetBytesPerSecond() == kMaxRate / 10);
+
+  // a plain limiter ignores the compaction debt
+  limiter.reset(NewGenericRateLimiter(kMaxRate));
+  limiter->Tune(1ull << 29);
+  assert(limiter->GetBytesPerSecond() == kMaxRate);
+  cout << endl;
+}
+
+void TestRateLimitedDB(bool column) {
+  cout << ">> rate limited db, " << (column ? "column" : "row") << endl;
+  int ret = system(string("rm -rf " + kDBPath).c_str());
+
+  shared_ptr<RateLimiter> limiter(NewGenericRateLimiter(64 << 20));
+  Options options;
+  options.create_if_missing = true;
+  options.rate_limiter = limiter;
+  options.statistics = CreateDBStatistics();
+  options.splitter.reset(NewEncodingSplitter());
+  if (column) {
+    TableFactory* table_factory = NewColumnTableFactory();
+    ColumnTableOptions* opts =
+        static_cast<ColumnTableOptions*>(table_factory->GetOptions());
+    opts->column_count = kColumn;
+    options.table_factory.reset(table_factory);
+  }
+
+  DB* db;
+  Status s = DB::Open(options, kDBPath, &db);
+  assert(s.ok());
+
+  WriteOptions wo;
+  for (int f = 0; f < 2; f++) {
+    for (int i = f; i < kRateLimiterKeys; i += 2) {
+      string key = to_string(100000 + i);
+      s = db->Put(wo, key, options.splitter->Stitch({"name" + key, "2" + key,
+                                                     "city" + key}));
+      assert(s.ok());
+    }
+    s = db->Flush(FlushOptions());
+    assert(s.ok());
+  }
+  assert(limiter->GetTotalBytesThrough(Env::IO_HIGH) > 0);
+  assert(limiter->GetTotalBytesThrough(Env::IO_LOW) == 0);
+
+  s = db->CompactRange(CompactRangeOptions(), nullptr, nullptr);
+  assert(s.ok());
+  assert(limiter->GetTotalBytesThrough(Env::IO_LOW) > 0);
+
+  // only the scans asking for it are charged
+  ReadOptions ro;
+  ro.fill_cache = false;
+  unique_ptr<Iterator> it(db->NewIterator(ro));
+  int count = 0;
+  for (it->SeekToFirst(); it->Valid(); it->Next()) {
+    count++;
+  }
+  assert(count == kRateLimiterKeys);
+  assert(limiter->GetTotalBytesThrough(Env::IO_USER) == 0);
+
+  ro.rate_limiter_priority = Env::IO_USER;
+  it.reset(db->NewIterator(ro));
+  count = 0;
+  for (it->SeekToFirst(); it->Valid(); it->Next()) {
+    count++;
+  }
+  assert(count == kRateLimiterKeys);
+  assert(limiter->GetTotalBytesThrough(Env::IO_USER) > 0);
+  cout << "flush bytes: " << limiter->GetTotalBytesThrough(Env::IO_HIGH)
+       << ", compaction bytes: " << limiter->GetTotalBytesThrough(Env::IO_LOW)
+       << ", user bytes: " << limiter->GetTotalBytesThrough(Env::IO_USER)
+       << endl;
+
+  it.reset();
+  delete db;
+  cout << endl;
+}
+
+// Burns CPU on every key, standing for a heavy row to column conversion.
+class SpinFilter : public CompactionFilter {
+ public:
+  virtual bool Filter(int level, const Slice& key, const Slice& existing_value,
+                      string* new_value, bool* value_changed) const override {
+    started_ = true;
+    uint64_t start = Env::Default()->NowMicros();
+    while (Env::Default()->NowMicros() < start + kSpinMicros) {
+    }
+    return false;
+  }
+
+  virtual const char* Name() const override { return "SpinFilter"; }
+
+  mutable atomic<bool> started_{false};
+};
+
+// Records the order the compactions complete in, and their CPU time.
+class OrderListener : public EventListener {
+ public:
+  virtual void OnCompactionCompleted(DB* db,
+                                     const CompactionJobInfo& ci) override {
+    lock_guard<mutex> l(mu_);
+    order_.push_back(ci.cf_name);
+    if (ci.cf_name == "slow") {
+      slow_cpu_micros_ = ci.stats.cpu_micros;
+    }
+  }
+
+  vector<string> Order() {
+    lock_guard<mutex> l(mu_);
+    return order_;
+  }
+
+  uint64_t slow_cpu_micros_ = 0;
+
+ private:
+  mutex mu_;
+  vector<string> order_;
+};
+
+void PutRange(DB* db, ColumnFamilyHandle* cf, int begin, int end) {
+  for (int i = begin; i < end; i++) {
+    Status s = db->Put(WriteOptions(), cf, to_string(100000 + i),
+                       "value" + to_string(i));
+    assert(s.ok());
+  }
+}
+
+// Two overlapping flushes, so level0_file_num_compaction_trigger compacts
+// them rather than moving them down.
+void LoadOverlapping(DB* db, ColumnFamilyHandle* cf) {
+  for (int i = 0; i < 2; i++) {
+    PutRange(db, cf, 0, kTimeSliceKeys);
+    Status s = db->Flush(FlushOptions(), cf);
+    assert(s.ok());
+  }
+}
+
+// The CPU time the compaction thread reports, 0 if none is running.
+uint64_t CompactionCPUMicros() {
+  vector<ThreadStatus> thread_list;
+  Status s = Env::Default()->GetThreadList(&thread_list);
+  assert(s.ok());
+  for (const auto& ts : thread_list) {
+    if (ts.operation_type == ThreadStatus::OP_COMPACTION) {
+      auto props = ThreadStatus::InterpretOperationProperties(
+          ts.operation_type, ts.op_properties);
+      return props["CPUMicros"];
+    }
+  }
+  return 0;
+}
+
+void TestTimeSlice(bool time_slice) {
+  cout << ">> time slice " << (time_slice ? "on" : "off") << endl;
+  Env::Default()->SetBackgroundThreads(2, Env::LOW);
+  Env::Default()->SetBackgroundThreads(1, Env::HIGH);
+  int ret = system(string("rm -rf " + kDBPath).c_str());
+
+  SpinFilter filter;
+  shared_ptr<OrderListener> listener(new OrderListener);
+  DBOptions db_options;
+  db_options.create_if_missing = true;
+  db_options.create_missing_column_families = true;
+  db_options.max_background_compactions = 1;
+  db_options.max_background_flushes = 1;
+  db_options.background_time_slice_micros = time_slice ? kTimeSlice : 0;
+  db_options.enable_thread_tracking = true;
+  db_options.listeners.push_back(listener);
+
+  ColumnFamilyOptions cf_options;
+  cf_options.level0_file_num_compaction_trigger = 2;
+  ColumnFamilyOptions slow_options = cf_options;
+  slow_options.compaction_filter = &filter;
+  vector<ColumnFamilyDescriptor> cfs = {
+      {kDefaultColumnFamilyName, cf_options},
+      {"slow", slow_options},
+      {"fast", cf_options}};
+  vector<ColumnFamilyHandle*> handles;
+  DB* db;
+  Status s = DB::Open(db_options, kDBPath, cfs, &handles, &db);
+  assert(s.ok());
+  ColumnFamilyHandle* slow = handles[1];
+  ColumnFamilyHandle* fast = handles[2];
+
+  // the slow compaction takes the only slot
+  LoadOverlapping(db, slow);
+  while (!filter.started_) {
+    Env::Default()->SleepForMicroseconds(1000);
+  }
+
+  // the fast compaction is queued within the slow one's time slice, and
+  // nothing is written or flushed after it: the fast one gets the slot
+  // released by the slow one at the end of its time slice, otherwise it
+  // waits for the slow one
+  uint64_t start = Env::Default()->NowMicros();
+  LoadOverlapping(db, fast);
+  assert(Env::Default()->NowMicros() < start + kTimeSlice);
+  string num;
+  do {
+    Env::Default()->SleepForMicroseconds(10000);
+    assert(db->GetProperty(fast, DB::Properties::kNumFilesAtLevelPrefix + "0",
+                           &num));
+  } while (num != "0");
+  vector<string> order;
+  do {
+    Env::Default()->SleepForMicroseconds(10000);
+    order = listener->Order();
+  } while (order.empty() || order.back() != "fast");
+
+  if (time_slice) {
+    assert(order.size() == 1 && order[0] == "fast");
+    // the compaction thread reports its CPU time as it goes
+    uint64_t cpu_micros = 0;
+    while (listener->Order().size() == 1 && cpu_micros == 0) {
+      cpu_micros = CompactionCPUMicros();
+      Env::Default()->SleepForMicroseconds(10000);
+    }
+    cout << "compaction thread CPU micros: " << cpu_micros << endl;
+    assert(cpu_micros > 0 || listener->Order().size() == 2);
+  } else {
+    assert(order.size() == 2 && order[0] == "slow" && order[1] == "fast");
+  }
+
+  do {
+    Env::Default()->SleepForMicroseconds(10000);
+    assert(db->GetProperty(slow, DB::Properties::kNumFilesAtLevelPrefix + "0",
+                           &num));
+  } while (num != "0");
+  while (listener->Order().size() < 2) {
+    Env::Default()->SleepForMicroseconds(10000);
+  }
+  // the filter spun on every key, mostly on the CPU
+  cout << "slow compaction CPU micros: " << listener->slow_cpu_micros_ << endl;
+  assert(listener->slow_cpu_micros_ >= kTimeSliceKeys * kSpinMicros / 2);
+
+  for (auto handle : handles) {
+    delete handle;
+  }
+  delete db;
+  cout << endl;
+}
+
+// Records the subcompactions of the compactions.
+class SubcompactionListener : public EventListener {
+ public:
+  virtual void OnCompactionCompleted(DB* db,
+                                     const CompactionJobInfo& ci) override {
+    lock_guard<mutex> l(mu_);
+    subcompactions_ = ci.stats.subcompactions;
+  }
+
+  vector<SubcompactionJobStats> Subcompactions() {
+    lock_guard<mutex> l(mu_);
+    return subcompactions_;
+  }
+
+ private:
+  mutex mu_;
+  vector<SubcompactionJobStats> subcompactions_;
+};
+
+void TestSubcompactionBalance() {
+  cout << ">> subcompaction balance" << endl;
+  int ret = system(string("rm -rf " + kDBPath).c_str());
+
+  shared_ptr<SubcompactionListener> listener(new SubcompactionListener);
+  Options options = GetOptions(true);
+  options.max_subcompactions = kSubcompactions;
+  options.target_file_size_base = 64 << 10;
+  options.listeners.push_back(listener);
+  DB* db;
+  Status s = DB::Open(options, kDBPath, &db);
+  assert(s.ok());
+
+  // L1 holds every other key, L0 the rest, so the L0 compaction goes into
+  // a non-empty level
+  WriteOptions wo;
+  for (int f = 0; f < 2; f++) {
+    for (int i = f; i < kSubcompactionKeys; i += 2) {
+      string key = to_string(100000 + i);
+      s = db->Put(wo, key, options.splitter->Stitch({"name" + key, "2" + key,
+                                                     "city" + key}));
+      assert(s.ok());
+    }
+    s = db->Flush(FlushOptions());
+    assert(s.ok());
+    if (f == 0) {
+      s = db->CompactRange(CompactRangeOptions(), nullptr, nullptr);
+      assert(s.ok());
+    }
+  }
+  s = db->CompactRange(CompactRangeOptions(), nullptr, nullptr);
+  assert(s.ok());
+
+  // each subcompaction plans about an even share of the input
+  vector<SubcompactionJobStats> subs = listener->Subcompactions();
+  assert(subs.size() > 1 && subs.size() <= kSubcompactions);
+  uint64_t total = 0;
+  for (const auto& sub : subs) {
+    total += sub.approx_input_bytes;
+  }
+  const double mean = static_cast<double>(total) / subs.size();
+  for (const auto& sub : subs) {
+    cout << "approx input bytes: " << sub.approx_input_bytes
+         << ", input records: " << sub.num_input_records << endl;
+    assert(sub.approx_input_bytes >= mean * 0.5 &&
+           sub.approx_input_bytes <= mean * 1.5);
+  }
+
+  delete db;
+  cout << endl;
+}
+
+int main() {
+  TestFilter();
+  TestTTL(false);
+  TestTTL(true);
+
+  TestThrottle();
+  TestAutoTune();
+  TestRateLimitedDB(false);
+  TestRateLimitedDB(true);
+
+  TestTimeSlice(true);
+  TestTimeSlice(false);
+
+  TestSubcompactionBalance();
+  return 0;
+}
@@ -0,0 +1,286 @@
+// Copyright (c) 2019-present, VidarDB, Inc.  All rights reserved.
+// This source code is licensed under the BSD-style license found in the
+// LICENSE file in the root directory of this source tree. An additional grant
+// of patent rights can be found in the PATENTS file in the same directory.
+
+#include <iostream>
+#include <thread>
+#include <vector>
+
+#include "vidardb/convenience.h"
+#include "vidardb/db.h"
+#include "vidardb/memtablerep.h"
+#include "vidardb/options.h"
+#include "vidardb/perf_context.h"
+#include "vidardb/perf_level.h"
+#include "vidardb/slice_transform.h"
+#include "vidardb/status.h"
+
+using namespace std;
+using namespace vidardb;
+
+const string kDBPath = "/tmp/vidardb_memtable_test";
+const int kNumThreads = 4;
+const int kNumKeysPerThread = 5000;
+const int kNumTenants = 10;
+const int kNumRows = 200;
+
+static string Key(int i) {
+  char buf[16];
+  snprintf(buf, sizeof(buf), "%08d", i);
+  return buf;
+}
+
+// 8 bytes tenant prefix, followed by the row id
+static string Key(int tenant, int row) {
+  char buf[32];
+  snprintf(buf, sizeof(buf), "tenant%02d:row%05d", tenant, row);
+  return buf;
+}
+
+static int RangeQueryCount(DB* db, const Range& range) {
+  ReadOptions ro;
+  ro.batch_capacity = 50;  // several batches
+  list<RangeQueryKeyVal> res;
+  Status s;
+  int count = 0;
+  string prev;
+  bool next = true;
+  while (next) {
+    next = db->RangeQuery(ro, range, res, &s);
+    assert(s.ok());
+    for (auto& it : res) {
+      assert(prev < it.user_key);
+      prev = it.user_key;
+      count++;
+    }
+  }
+  return count;
+}
+
+void TestMemTable(MemTableRepFactory* factory) {
+  cout << ">> " << factory->Name() << endl;
+  int ret = system(string("rm -rf " + kDBPath).c_str());
+
+  Options options;
+  options.create_if_missing = true;
+  options.allow_concurrent_memtable_write = true;
+  options.memtable_factory.reset(factory);
+
+  DB* db;
+  Status s = DB::Open(options, kDBPath, &db);
+  assert(s.ok());
+
+  // writers interleave their keys
+  vector<thread> threads;
+  for (int t = 0; t < kNumThreads; t++) {
+    threads.emplace_back([db, t]() {
+      WriteOptions wo;
+      for (int i = 0; i < kNumKeysPerThread; i++) {
+        int k = i * kNumThreads + t;
+        Status s = db->Put(wo, Key(k), "val" + to_string(k));
+        assert(s.ok());
+      }
+    });
+  }
+  for (auto& t : threads) {
+    t.join();
+  }
+
+  const int kNumKeys = kNumThreads * kNumKeysPerThread;
+  ReadOptions ro;
+  string val;
+  for (int k = 0; k < kNumKeys; k += 97) {  // mutable memtable
+    s = db->Get(ro, Key(k), &val);
+    assert(s.ok() && val == "val" + to_string(k));
+  }
+
+  s = db->Flush(FlushOptions());
+  assert(s.ok());
+
+  Iterator* iter = db->NewIterator(ro);
+  int count = 0;
+  for (iter->SeekToFirst(); iter->Valid(); iter->Next(), count++) {
+    assert(iter->key().ToString() == Key(count));
+  }
+  assert(iter->status().ok() && count == kNumKeys);
+  delete iter;
+
+  list<RangeQueryKeyVal> res;
+  Range range(Key(100), Key(200));
+  bool next = true;
+  count = 0;
+  while (next) {
+    next = db->RangeQuery(ro, range, res, &s);
+    assert(s.ok());
+    count += res.size();
+  }
+  assert(count == 101);  // both ends included
+
+  delete db;
+  cout << endl;
+}
+
+void TestHashMemTable(bool flush) {
+  cout << ">> hash skip list, flush: " << flush << endl;
+  int ret = system(string("rm -rf " + kDBPath).c_str());
+
+  Options options;
+  options.create_if_missing = true;
+  // the same as prefix_extractor.reset(NewFixedPrefixTransform(8)) and
+  // memtable_factory.reset(NewHashSkipListRepFactory(1000))
+  Status s = GetColumnFamilyOptionsFromString(
+      options, "prefix_extractor=fixed:8;memtable=prefix_hash:1000",
+      &options);
+  assert(s.ok());
+
+  DB* db;
+  s = DB::Open(options, kDBPath, &db);
+  assert(s.ok());
+
+  WriteOptions wo;
+  for (int row = 0; row < kNumRows; row++) {
+    for (int t = 0; t < kNumTenants; t++) {
+      s = db->Put(wo, Key(t, row), to_string(t * kNumRows + row));
+      assert(s.ok());
+    }
+  }
+  s = db->Delete(wo, Key(3, 7));
+  assert(s.ok());
+  s = db->Put(wo, "short", "out of the prefix domain");
+  assert(s.ok());
+  if (flush) {
+    s = db->Flush(FlushOptions());
+    assert(s.ok());
+  }
+
+  ReadOptions ro;
+  string val;
+  s = db->Get(ro, Key(5, 42), &val);
+  assert(s.ok() && val == to_string(5 * kNumRows + 42));
+  s = db->Get(ro, Key(3, 7), &val);
+  assert(s.IsNotFound());
+  s = db->Get(ro, "short", &val);
+  assert(s.ok());
+  s = db->Get(ro, Key(99, 0), &val);
+  assert(s.IsNotFound());
+
+  // within a tenant
+  assert(RangeQueryCount(db, Range(Key(3, 0), Key(3, kNumRows - 1))) ==
+         kNumRows - 1);
+  assert(RangeQueryCount(db, Range(Key(4, 10), Key(4, 19))) == 10);
+  // across tenants
+  assert(RangeQueryCount(db, Range(Key(1, 100), Key(2, 99))) == kNumRows);
+  assert(RangeQueryCount(db, Range()) == kNumTenants * kNumRows);
+
+  Iterator* iter = db->NewIterator(ro);
+  int count = 0;
+  for (iter->SeekToFirst(); iter->Valid(); iter->Next()) {
+    count++;
+  }
+  assert(iter->status().ok() && count == kNumTenants * kNumRows);
+  delete iter;
+
+  if (!flush) {
+    string start = Key(6, 0), limit = Key(6, kNumRows);
+    Range r(start, limit);
+    uint64_t size;
+    db->GetApproximateSizes(&r, 1, &size, true);
+    assert(size > 0);
+  }
+
+  delete db;
+  cout << endl;
+}
+
+void TestBloom(bool whole_key) {
+  cout << ">> bloom, whole key filtering: " << whole_key << endl;
+  int ret = system(string("rm -rf " + kDBPath).c_str());
+
+  Options options;
+  options.create_if_missing = true;
+  options.memtable_prefix_bloom_size_ratio = 0.1;
+  if (whole_key) {
+    options.memtable_whole_key_filtering = true;
+  } else {
+    options.prefix_extractor.reset(NewFixedPrefixTransform(8));
+  }
+
+  DB* db;
+  Status s = DB::Open(options, kDBPath, &db);
+  assert(s.ok());
+
+  WriteOptions wo;
+  const int kNumKeys = 1000;
+  for (int i = 0; i < kNumKeys; i++) {
+    s = db->Put(wo, Key(i % 4, i), "val" + to_string(i));
+    assert(s.ok());
+  }
+  s = db->Delete(wo, Key(0, 0));
+  assert(s.ok());
+
+  SetPerfLevel(PerfLevel::kEnableCount);
+  perf_context.Reset();
+
+  ReadOptions ro;
+  string val;
+  for (int i = 1; i < kNumKeys; i++) {
+    s = db->Get(ro, Key(i % 4, i), &val);
+    assert(s.ok() && val == "val" + to_string(i));
+  }
+  s = db->Get(ro, Key(0, 0), &val);
+  assert(s.IsNotFound());
+  cout << "present keys, hit: " << perf_context.bloom_memtable_hit_count
+       << ", miss: " << perf_context.bloom_memtable_miss_count << endl;
+  assert(perf_context.bloom_memtable_hit_count == kNumKeys);
+  assert(perf_context.bloom_memtable_miss_count == 0);
+
+  // absent tenants are ruled out in both modes, absent rows of a present
+  // tenant only with whole key filtering
+  perf_context.Reset();
+  for (int i = 0; i < kNumKeys; i++) {
+    s = db->Get(ro, Key(10 + i % 4, i), &val);
+    assert(s.IsNotFound());
+  }
+  cout << "absent tenants, hit: " << perf_context.bloom_memtable_hit_count
+       << ", miss: " << perf_context.bloom_memtable_miss_count << endl;
+  assert(perf_context.bloom_memtable_miss_count > kNumKeys * 9 / 10);
+
+  perf_context.Reset();
+  for (int i = 0; i < kNumKeys; i++) {
+    s = db->Get(ro, Key(i % 4, kNumKeys + i), &val);
+    assert(s.IsNotFound());
+  }
+  cout << "absent rows, hit: " << perf_context.bloom_memtable_hit_count
+       << ", miss: " << perf_context.bloom_memtable_miss_count << endl;
+  if (whole_key) {
+    assert(perf_context.bloom_memtable_miss_count > kNumKeys * 9 / 10);
+  } else {
+    assert(perf_context.bloom_memtable_hit_count == kNumKeys);
+  }
+
+  // the filter is per memtable, flushed keys are still found
+  s = db->Flush(FlushOptions());
+  assert(s.ok());
+  s = db->Put(wo, Key(20, 0), "new");
+  assert(s.ok());
+  s = db->Get(ro, Key(1, 1), &val);
+  assert(s.ok() && val == "val1");
+  s = db->Get(ro, Key(20, 0), &val);
+  assert(s.ok() && val == "new");
+  SetPerfLevel(PerfLevel::kDisable);
+
+  delete db;
+  cout << endl;
+}
+
+int main() {
+  TestMemTable(new SkipListFactory());
+  TestMemTable(new VectorRepFactory());
+  TestMemTable(new BulkLoadRepFactory(kNumThreads * kNumKeysPerThread));
+  TestHashMemTable(false);
+  TestHashMemTable(true);
+  TestBloom(false);
+  TestBloom(true);
+  return 0;
+}
@@ -4,10 +4,17 @@
 // of patent rights can be found in the PATENTS file in the same directory.
 
 #include <iostream>
+#include <map>
+#include <memory>
 
+#include "vidardb/cache.h"
 #include "vidardb/db.h"
+#include "vidardb/merge_operator.h"
 #include "vidardb/options.h"
+#include "vidardb/perf_context.h"
+#include "vidardb/perf_level.h"
 #include "vidardb/splitter.h"
+#include "vidardb/statistics.h"
 #include "vidardb/status.h"
 #include "vidardb/table.h"
 
@@ -16,6 +23,7 @@ using namespace vidardb;
 
 const unsigned int kColumn = 3;
 const string kDBPath = "/tmp/vidardb_range_query_column_test";
+const int kPinNumKeys = 2000;
 
 void TestColumnRangeQuery(bool flush, size_t capacity, vector<uint32_t> cols) {
   cout << ">> capacity: " << capacity << ", cols: { ";
@@ -118,6 +126,393 @@ void TestColumnRangeQuery(bool flush, size_t capacity, vector<uint32_t> cols) {
   cout << endl;
 }
 
+void TestRangeQueryStats() {
+  cout << ">> stats" << endl;
+  int ret = system(string("rm -rf " + kDBPath).c_str());
+
+  Options options;
+  options.create_if_missing = true;
+  options.splitter.reset(NewEncodingSplitter());
+  options.statistics = CreateDBStatistics();
+
+  TableFactory* table_factory = NewColumnTableFactory();
+  ColumnTableOptions* opts =
+      static_cast<ColumnTableOptions*>(table_factory->GetOptions());
+  opts->column_count = kColumn;
+  options.table_factory.reset(table_factory);
+
+  DB* db;
+  Status s = DB::Open(options, kDBPath, &db);
+  assert(s.ok());
+
+  WriteOptions wo;
+  const int kNumKeys = 100;
+  for (int i = 0; i < kNumKeys; i++) {
+    string key = to_string(1000 + i);
+    s = db->Put(wo, key, options.splitter->Stitch({"name" + key, "2" + key,
+                                                   "city" + key}));
+    assert(s.ok());
+  }
+  s = db->Flush(FlushOptions());
+  assert(s.ok());
+
+  SetPerfLevel(PerfLevel::kEnableTime);
+  perf_context.Reset();
+
+  ReadOptions ro;
+  ro.batch_capacity = 200;
+  ro.columns = {1, 3};
+  Range range(kRangeQueryMin, kRangeQueryMax);
+  list<RangeQueryKeyVal> res;
+  uint64_t batches = 0, keys = 0;
+  bool next = true;
+  while (next) {
+    next = db->RangeQuery(ro, range, res, &s);
+    assert(s.ok());
+    batches++;
+    keys += res.size();
+  }
+  assert(keys == kNumKeys);
+  cout << perf_context.ToString(true) << endl;
+
+  assert(perf_context.range_query_count == batches);
+  assert(perf_context.range_query_table_iter_count == batches);
+  assert(perf_context.range_query_trimmed_count > 0);
+  assert(perf_context.range_query_sst_time > 0);
+  assert(perf_context.column_projected_count == 2 * batches);
+  assert(perf_context.column_total_count == kColumn * batches);
+  assert(perf_context.column_block_read_count > 0);
+  assert(perf_context.column_block_read_byte > 0);
+  SetPerfLevel(PerfLevel::kDisable);
+
+  Statistics* stats = options.statistics.get();
+  assert(stats->getTickerCount(NUMBER_RANGE_QUERY) == batches);
+  assert(stats->getTickerCount(NUMBER_RANGE_QUERY_KEYS_READ) == kNumKeys);
+  assert(stats->getTickerCount(RANGE_QUERY_ROWS_TRIMMED) ==
+         perf_context.range_query_trimmed_count);
+  // flush opens an iterator on the new table as well
+  assert(stats->getTickerCount(COLUMNS_PROJECTED) >= 2 * batches);
+  assert(stats->getTickerCount(COLUMN_BLOCK_READ) > 0);
+  HistogramData hist;
+  stats->histogramData(DB_RANGE_QUERY, &hist);
+  assert(hist.average > 0);
+
+  string prop;
+  assert(db->GetProperty(DB::Properties::kRangeQueryStats, &prop));
+  cout << prop;
+  assert(prop.find(to_string(batches) + " batches") != string::npos);
+  assert(db->GetProperty(DB::Properties::kDBStats, &prop));
+  assert(prop.find("Cumulative range queries") != string::npos);
+
+  delete db;
+  cout << endl;
+}
+
+Options PinOptions(bool column, bool pipe, shared_ptr<Cache> cache) {
+  Options options;
+  options.create_if_missing = true;
+  if (pipe) {
+    options.splitter.reset(NewPipeSplitter());
+  } else {
+    options.splitter.reset(NewEncodingSplitter());
+  }
+  TableFactory* table_factory;
+  if (column) {
+    table_factory = NewColumnTableFactory();
+    ColumnTableOptions* opts =
+        static_cast<ColumnTableOptions*>(table_factory->GetOptions());
+    opts->column_count = kColumn;
+    opts->block_cache = cache;
+  } else {
+    table_factory = NewBlockBasedTableFactory();
+    BlockBasedTableOptions* opts =
+        static_cast<BlockBasedTableOptions*>(table_factory->GetOptions());
+    opts->block_cache = cache;
+  }
+  options.table_factory.reset(table_factory);
+  return options;
+}
+
+// Query all the batches, return the number of the pinned values.
+size_t QueryAll(DB* db, ReadOptions ro, vector<RangeQueryKeyVal>* out) {
+  size_t pinned = 0;
+  list<RangeQueryKeyVal> res;
+  Status s;
+  bool next = true;
+  while (next) {
+    next = db->RangeQuery(ro, Range(), res, &s);
+    assert(s.ok());
+    size_t val_size = 0;
+    for (const auto& it : res) {
+      val_size += it.value().size();
+      if (it.pin) {
+        pinned++;
+      }
+    }
+    assert(val_size == ro.result_val_size);
+    out->insert(out->end(), res.begin(), res.end());
+  }
+  return pinned;
+}
+
+void TestPinnedRangeQuery(bool column, bool pipe, size_t capacity,
+                          const vector<uint32_t>& cols, bool expect_pinned) {
+  cout << ">> pinned, " << (column ? "column" : "row")
+       << (pipe ? " pipe" : " encoding") << ", capacity: " << capacity
+       << ", cols: { ";
+  for (auto& col : cols) {
+    cout << col << " ";
+  }
+  cout << "}" << endl;
+  int ret = system(string("rm -rf " + kDBPath).c_str());
+
+  shared_ptr<Cache> cache = NewLRUCache(8 << 20);
+  Options options = PinOptions(column, pipe, cache);
+  DB* db;
+  Status s = DB::Open(options, kDBPath, &db);
+  assert(s.ok());
+
+  WriteOptions wo;
+  for (int i = 0; i < kPinNumKeys; i++) {
+    string n = to_string(i);
+    s = db->Put(wo, to_string(100000 + i),
+                options.splitter->Stitch({"name" + n, "age" + n, "city" + n}));
+    assert(s.ok());
+  }
+  s = db->Flush(FlushOptions());
+  assert(s.ok());
+  // the memtable entries are copied, a deletion and an overwrite
+  s = db->Delete(wo, to_string(100007));
+  assert(s.ok());
+  s = db->Put(wo, to_string(100011), options.splitter->Stitch({"a", "b", "c"}));
+  assert(s.ok());
+
+  ReadOptions ro;
+  ro.batch_capacity = capacity;
+  ro.columns = cols;
+  vector<RangeQueryKeyVal> copied;
+  assert(QueryAll(db, ro, &copied) == 0);
+  assert(cache->GetPinnedUsage() == 0);
+
+  ro.pin_data = true;
+  vector<RangeQueryKeyVal> pinned;
+  size_t count = QueryAll(db, ro, &pinned);
+  assert(pinned.size() == copied.size());
+  assert(pinned.size() == kPinNumKeys - 1);
+  for (size_t i = 0; i < pinned.size(); i++) {
+    assert(pinned[i].user_key == copied[i].user_key);
+    assert(pinned[i].value() == copied[i].value());
+  }
+  if (expect_pinned) {
+    assert(count == kPinNumKeys - 2);
+    assert(cache->GetPinnedUsage() > 0);
+  } else {
+    assert(count == 0);
+  }
+  cout << "pinned values: " << count
+       << ", pinned usage: " << cache->GetPinnedUsage() << endl;
+
+  // the blocks are released with the last result referencing them
+  pinned.clear();
+  assert(cache->GetPinnedUsage() == 0);
+
+  delete db;
+  cout << endl;
+}
+
+static string EncodeCounter(uint64_t v) {
+  string res(sizeof(v), '\0');
+  for (size_t i = 0; i < sizeof(v); i++) {
+    res[i] = static_cast<char>((v >> (8 * i)) & 0xff);
+  }
+  return res;
+}
+
+static uint64_t DecodeCounter(const string& s) {
+  assert(s.size() == sizeof(uint64_t));
+  uint64_t v = 0;
+  for (size_t i = 0; i < sizeof(v); i++) {
+    v |= static_cast<uint64_t>(static_cast<unsigned char>(s[i])) << (8 * i);
+  }
+  return v;
+}
+
+void TestCounter() {
+  cout << ">> counter" << endl;
+  int ret = system(string("rm -rf " + kDBPath).c_str());
+
+  Options options;
+  options.create_if_missing = true;
+  options.merge_operator = NewUInt64AddOperator();
+
+  DB* db;
+  Status s = DB::Open(options, kDBPath, &db);
+  assert(s.ok());
+
+  WriteOptions wo;
+  ReadOptions ro;
+  string val;
+  for (int i = 0; i < 10; i++) {
+    s = db->Merge(wo, "counter", EncodeCounter(1));
+    assert(s.ok());
+  }
+  s = db->Get(ro, "counter", &val);
+  assert(s.ok() && DecodeCounter(val) == 10);
+
+  s = db->Flush(FlushOptions());
+  assert(s.ok());
+  s = db->Merge(wo, "counter", EncodeCounter(5));
+  assert(s.ok());
+  s = db->Get(ro, "counter", &val);
+  assert(s.ok() && DecodeCounter(val) == 15);
+
+  s = db->Put(wo, "counter", EncodeCounter(100));
+  assert(s.ok());
+  s = db->Merge(wo, "counter", EncodeCounter(2));
+  assert(s.ok());
+  s = db->CompactRange(CompactRangeOptions(), nullptr, nullptr);
+  assert(s.ok());
+  s = db->Get(ro, "counter", &val);
+  assert(s.ok() && DecodeCounter(val) == 102);
+
+  delete db;
+  cout << endl;
+}
+
+void TestColumnPatch(int flush_mode) {
+  cout << ">> column patch, flush mode: " << flush_mode << endl;
+  int ret = system(string("rm -rf " + kDBPath).c_str());
+
+  Options options;
+  options.create_if_missing = true;
+  options.splitter.reset(NewEncodingSplitter());
+  shared_ptr<ColumnPatchMergeOperator> patch =
+      NewColumnPatchMergeOperator(options.splitter, kColumn);
+  options.merge_operator = patch;
+
+  TableFactory* table_factory = NewColumnTableFactory();
+  ColumnTableOptions* opts =
+      static_cast<ColumnTableOptions*>(table_factory->GetOptions());
+  opts->column_count = kColumn;
+  options.table_factory.reset(table_factory);
+
+  DB* db;
+  Status s = DB::Open(options, kDBPath, &db);
+  assert(s.ok());
+
+  WriteOptions wo;
+  s = db->Put(wo, "1", options.splitter->Stitch({"chen1", "33", "hangzhou"}));
+  assert(s.ok());
+  s = db->Put(wo, "2", options.splitter->Stitch({"wang2", "32", "wuhan"}));
+  assert(s.ok());
+  s = db->Put(wo, "3", options.splitter->Stitch({"zhao3", "35", "nanjing"}));
+  assert(s.ok());
+
+  if (flush_mode > 0) {  // base rows on disk
+    s = db->Flush(FlushOptions());
+    assert(s.ok());
+  }
+
+  s = db->Merge(wo, "1", patch->EncodePatch({{2, "34"}}));
+  assert(s.ok());
+  s = db->Merge(wo, "1", patch->EncodePatch({{3, "shenzhen"}}));
+  assert(s.ok());
+  s = db->Merge(wo, "2", patch->EncodePatch({{1, "wang22"}, {2, ""}}));
+  assert(s.ok());
+  s = db->Merge(wo, "4", patch->EncodePatch({{1, "liao4"}}));  // no base row
+  assert(s.ok());
+  s = db->Delete(wo, "3");
+  assert(s.ok());
+  s = db->Merge(wo, "3", patch->EncodePatch({{3, "xian"}}));
+  assert(s.ok());
+
+  if (flush_mode > 1) {  // operands on disk as well
+    s = db->Flush(FlushOptions());
+    assert(s.ok());
+  }
+  if (flush_mode > 2) {
+    s = db->CompactRange(CompactRangeOptions(), nullptr, nullptr);
+    assert(s.ok());
+  }
+
+  map<string, vector<string>> expected = {
+      {"1", {"chen1", "34", "shenzhen"}},
+      {"2", {"wang22", "", "wuhan"}},
+      {"3", {"", "", "xian"}},
+      {"4", {"liao4", "", ""}}};
+
+  // Get, full rows and projected
+  ReadOptions ro;
+  for (auto& kv : expected) {
+    string val;
+    s = db->Get(ro, kv.first, &val);
+    assert(s.ok());
+    vector<Slice> vals(options.splitter->Split(val));
+    assert(vals.size() == kColumn);
+    for (size_t i = 0; i < kColumn; i++) {
+      assert(vals[i].ToString() == kv.second[i]);
+    }
+  }
+  ro.columns = {2, 3};
+  for (auto& kv : expected) {
+    string val;
+    s = db->Get(ro, kv.first, &val);
+    assert(s.ok());
+    vector<Slice> vals(options.splitter->Split(val));
+    assert(vals.size() == 2);
+    assert(vals[0].ToString() == kv.second[1]);
+    assert(vals[1].ToString() == kv.second[2]);
+  }
+
+  // Iterator, both directions
+  ro.columns.clear();
+  Iterator* iter = db->NewIterator(ro);
+  size_t count = 0;
+  for (iter->SeekToFirst(); iter->Valid(); iter->Next(), count++) {
+    auto it = expected.find(iter->key().ToString());
+    assert(it != expected.end());
+    vector<Slice> vals(options.splitter->Split(iter->value()));
+    assert(vals.size() == kColumn && vals[0].ToString() == it->second[0] &&
+           vals[1].ToString() == it->second[1] &&
+           vals[2].ToString() == it->second[2]);
+  }
+  assert(iter->status().ok() && count == expected.size());
+  count = 0;
+  for (iter->SeekToLast(); iter->Valid(); iter->Prev(), count++) {
+    auto it = expected.find(iter->key().ToString());
+    assert(it != expected.end());
+    assert(iter->value().ToString() ==
+           options.splitter->Stitch({it->second[0], it->second[1],
+                                     it->second[2]}));
+  }
+  assert(iter->status().ok() && count == expected.size());
+  delete iter;
+
+  // RangeQuery
+  ro.columns = {1, 3};
+  Range range(kRangeQueryMin, kRangeQueryMax);
+  list<RangeQueryKeyVal> res;
+  map<string, string> all;
+  bool next = true;
+  while (next) {
+    next = db->RangeQuery(ro, range, res, &s);
+    assert(s.ok());
+    for (auto it : res) {
+      all[it.user_key] = it.value().ToString();
+    }
+  }
+  assert(all.size() == expected.size());
+  for (auto& kv : expected) {
+    vector<Slice> vals(options.splitter->Split(all[kv.first]));
+    assert(vals.size() == 2);
+    assert(vals[0].ToString() == kv.second[0]);
+    assert(vals[1].ToString() == kv.second[2]);
+  }
+
+  delete db;
+  cout << endl;
+}
+
 int main() {
   TestColumnRangeQuery(false, 0, {1, 3});
   TestColumnRangeQuery(false, 20, {1, 3});
@@ -130,5 +525,21 @@ int main() {
   TestColumnRangeQuery(true, 40, {1, 3});
   TestColumnRangeQuery(true, 100, {1, 3});
   TestColumnRangeQuery(true, 10, {0});
+
+  TestRangeQueryStats();
+
+  TestPinnedRangeQuery(false, false, 0, {}, true);
+  TestPinnedRangeQuery(false, false, 4096, {}, true);
+  TestPinnedRangeQuery(false, false, 0, {1, 3}, false);
+  TestPinnedRangeQuery(true, true, 0, {2}, true);
+  TestPinnedRangeQuery(true, true, 4096, {2}, true);
+  TestPinnedRangeQuery(true, false, 0, {2}, false);
+  TestPinnedRangeQuery(true, true, 0, {1, 2}, false);
+
+  TestCounter();
+  TestColumnPatch(0);
+  TestColumnPatch(1);
+  TestColumnPatch(2);
+  TestColumnPatch(3);
   return 0;
 }
@@ -4,15 +4,24 @@
 // of patent rights can be found in the PATENTS file in the same directory.
 
 #include <iostream>
+#include <memory>
 
 #include "vidardb/db.h"
 #include "vidardb/options.h"
+#include "vidardb/perf_context.h"
+#include "vidardb/perf_level.h"
+#include "vidardb/splitter.h"
 #include "vidardb/status.h"
+#include "vidardb/table.h"
 
 using namespace std;
 using namespace vidardb;
 
 const string kDBPath = "/tmp/vidardb_range_query_row_test";
+const unsigned int kColumn = 3;
+const int kNumFiles = 4;
+const int kKeysPerFile = 1000;
+const int kDeleteRangeKeys = 1000;
 
 void TestRowRangeQuery(bool flush, size_t capacity) {
   cout << ">> capacity: " << capacity << endl;
@@ -87,6 +96,398 @@ void TestRowRangeQuery(bool flush, size_t capacity) {
   cout << endl;
 }
 
+void TestPerfSample() {
+  cout << ">> perf sample" << endl;
+  int ret = system(string("rm -rf " + kDBPath).c_str());
+
+  Options options;
+  options.create_if_missing = true;
+  options.perf_sample_rate = 1;  // profile every operation
+
+  DB* db;
+  Status s = DB::Open(options, kDBPath, &db);
+  assert(s.ok());
+
+  WriteOptions wo;
+  const int kNumKeys = 100;
+  for (int i = 0; i < kNumKeys; i++) {
+    s = db->Put(wo, to_string(1000 + i), "val" + to_string(i));
+    assert(s.ok());
+  }
+  s = db->Flush(FlushOptions());
+  assert(s.ok());
+
+  ReadOptions ro;
+  string val;
+  for (int i = 0; i < kNumKeys; i++) {
+    s = db->Get(ro, to_string(1000 + i), &val);
+    assert(s.ok());
+  }
+
+  Iterator* iter = db->NewIterator(ro);
+  int count = 0;
+  for (iter->Seek("1000"); iter->Valid(); iter->Next()) {
+    count++;
+  }
+  assert(count == kNumKeys);
+  delete iter;
+
+  list<RangeQueryKeyVal> res;
+  Range range(kRangeQueryMin, kRangeQueryMax);
+  bool next = true;
+  while (next) {
+    next = db->RangeQuery(ro, range, res, &s);
+    assert(s.ok());
+  }
+
+  // sampling leaves the perf level of the user untouched
+  assert(GetPerfLevel() == PerfLevel::kEnableCount);
+
+  string prop;
+  assert(db->GetProperty(DB::Properties::kSampledPerfStats, &prop));
+  cout << prop;
+  assert(prop.find("Get: " + to_string(kNumKeys) + " samples") !=
+         string::npos);
+  assert(prop.find("Write: " + to_string(kNumKeys) + " samples") !=
+         string::npos);
+  assert(prop.find("IterSeek: 1 samples") != string::npos);
+  assert(prop.find("IterNext: " + to_string(kNumKeys) + " samples") !=
+         string::npos);
+  assert(prop.find("RangeQuery: ") != string::npos);
+  assert(prop.find("tablefiles") != string::npos);
+
+  delete db;
+  cout << endl;
+}
+
+// The options of the row table, or of the column table of kColumn columns,
+// compacted by hand only.
+Options TestOptions(bool column) {
+  Options options;
+  options.create_if_missing = true;
+  options.splitter.reset(NewEncodingSplitter());
+  options.disable_auto_compactions = true;
+  if (column) {
+    TableFactory* table_factory = NewColumnTableFactory();
+    ColumnTableOptions* opts =
+        static_cast<ColumnTableOptions*>(table_factory->GetOptions());
+    opts->column_count = kColumn;
+    options.table_factory.reset(table_factory);
+  }
+  return options;
+}
+
+string Key(int i) { return to_string(100000 + i); }
+
+string Value(const Options& options, const string& key) {
+  return options.splitter->Stitch({"name" + key, "2" + key, "city" + key});
+}
+
+// Scan [lower, upper) forward and backward, return the data blocks read.
+uint64_t Scan(DB* db, const Options& options, int lower, int upper) {
+  string lower_key = Key(lower), upper_key = Key(upper);
+  Slice lower_bound(lower_key), upper_bound(upper_key);
+  ReadOptions ro;
+  ro.fill_cache = false;
+  ro.iterate_lower_bound = &lower_bound;
+  ro.iterate_upper_bound = &upper_bound;
+
+  perf_context.Reset();
+  unique_ptr<Iterator> it(db->NewIterator(ro));
+  int i = lower;
+  for (it->SeekToFirst(); it->Valid(); it->Next()) {
+    assert(it->key().ToString() == Key(i));
+    assert(it->value().ToString() == Value(options, Key(i)));
+    i++;
+  }
+  assert(it->status().ok());
+  assert(i == upper);
+  uint64_t block_reads = perf_context.block_read_count;
+
+  i = upper - 1;
+  for (it->SeekToLast(); it->Valid(); it->Prev()) {
+    assert(it->key().ToString() == Key(i));
+    i--;
+  }
+  assert(it->status().ok());
+  assert(i == lower - 1);
+
+  // the target is moved to the lower bound
+  it->Seek(Key(0));
+  assert(it->Valid() && it->key().ToString() == Key(lower));
+  it->Seek(Key(lower + 10));
+  assert(it->Valid() && it->key().ToString() == Key(lower + 10));
+  it->Prev();
+  assert(it->Valid() && it->key().ToString() == Key(lower + 9));
+  it->Seek(Key(upper));
+  assert(!it->Valid());
+
+  // a tailing iterator is forward only
+  ro.tailing = true;
+  it.reset(db->NewIterator(ro));
+  i = lower;
+  for (it->Seek(Key(lower)); it->Valid(); it->Next()) {
+    assert(it->key().ToString() == Key(i));
+    i++;
+  }
+  assert(it->status().ok());
+  assert(i == upper);
+  return block_reads;
+}
+
+// The same scan stopped by the caller, return the data blocks read.
+uint64_t ScanUnbounded(DB* db, int lower, int upper) {
+  ReadOptions ro;
+  ro.fill_cache = false;
+  perf_context.Reset();
+  unique_ptr<Iterator> it(db->NewIterator(ro));
+  int i = lower;
+  for (it->Seek(Key(lower)); it->Valid() && it->key().ToString() < Key(upper);
+       it->Next()) {
+    i++;
+  }
+  assert(i == upper);
+  return perf_context.block_read_count;
+}
+
+void TestBounds(bool column) {
+  cout << ">> bounds, " << (column ? "column" : "row") << endl;
+  int ret = system(string("rm -rf " + kDBPath).c_str());
+
+  Options options = TestOptions(column);
+  // several files in L1 after the compaction
+  options.target_file_size_base = 32 << 10;
+  TableOptions* opts =
+      static_cast<TableOptions*>(options.table_factory->GetOptions());
+  opts->block_size = 256;
+  DB* db;
+  Status s = DB::Open(options, kDBPath, &db);
+  assert(s.ok());
+
+  // disjoint L0 files
+  WriteOptions wo;
+  for (int f = 0; f < kNumFiles; f++) {
+    for (int i = f * kKeysPerFile; i < (f + 1) * kKeysPerFile; i++) {
+      s = db->Put(wo, Key(i), Value(options, Key(i)));
+      assert(s.ok());
+    }
+    s = db->Flush(FlushOptions());
+    assert(s.ok());
+  }
+  string num;
+  db->GetProperty("vidardb.num-files-at-level0", &num);
+  assert(num == to_string(kNumFiles));
+
+  SetPerfLevel(PerfLevel::kEnableCount);
+  // within the second file
+  uint64_t bounded = Scan(db, options, 1200, 1300);
+  uint64_t unbounded = ScanUnbounded(db, 1200, 1300);
+  cout << "L0 block reads, bounded: " << bounded
+       << ", unbounded: " << unbounded << endl;
+  // the files after the bound are not read at all
+  assert(bounded < unbounded);
+  // across two files
+  Scan(db, options, 1900, 2100);
+
+  s = db->CompactRange(CompactRangeOptions(), nullptr, nullptr);
+  assert(s.ok());
+  db->GetProperty("vidardb.num-files-at-level1", &num);
+  cout << "L1 files: " << num << endl;
+  assert(stoi(num) > 1);
+
+  bounded = Scan(db, options, 1200, 1300);
+  unbounded = ScanUnbounded(db, 1200, 1300);
+  cout << "L1 block reads, bounded: " << bounded
+       << ", unbounded: " << unbounded << endl;
+  assert(bounded <= unbounded);
+  Scan(db, options, 0, kNumFiles * kKeysPerFile);
+  Scan(db, options, 2500, 3700);
+  SetPerfLevel(PerfLevel::kDisable);
+
+  delete db;
+  cout << endl;
+}
+
+string DeleteRangeValue(const Options& options, int i) {
+  return options.splitter->Stitch({"name" + Key(i), "2", "city" + Key(i)});
+}
+
+// Check the keys in [0, kDeleteRangeKeys) the deleted function tells apart,
+// with Get, forward and reverse iterations and range queries of batches of
+// the capacity.
+template <typename Deleted>
+void CheckDeleted(DB* db, const Options& options, ReadOptions ro,
+                  Deleted deleted, size_t capacity = 0) {
+  int expected = 0;
+  string val;
+  for (int i = 0; i < kDeleteRangeKeys; i++) {
+    Status s = db->Get(ro, Key(i), &val);
+    if (deleted(i)) {
+      assert(s.IsNotFound());
+    } else {
+      assert(s.ok() && val == DeleteRangeValue(options, i));
+      expected++;
+    }
+  }
+
+  unique_ptr<Iterator> it(db->NewIterator(ro));
+  int count = 0;
+  for (it->SeekToFirst(); it->Valid(); it->Next()) {
+    assert(!deleted(stoi(it->key().ToString()) - 100000));
+    count++;
+  }
+  assert(it->status().ok() && count == expected);
+  count = 0;
+  for (it->SeekToLast(); it->Valid(); it->Prev()) {
+    count++;
+  }
+  assert(it->status().ok() && count == expected);
+
+  ReadOptions range_ro = ro;
+  range_ro.batch_capacity = capacity;
+  Range range(kRangeQueryMin, kRangeQueryMax);
+  list<RangeQueryKeyVal> res;
+  Status s;
+  count = 0;
+  bool next = true;
+  while (next) {
+    next = db->RangeQuery(range_ro, range, res, &s);
+    assert(s.ok());
+    for (const auto& it : res) {
+      assert(!deleted(stoi(it.user_key) - 100000));
+      count++;
+    }
+  }
+  assert(count == expected);
+
+  if (ro.snapshot == nullptr) {
+    ReadOptions tailing_ro = ro;
+    tailing_ro.tailing = true;
+    it.reset(db->NewIterator(tailing_ro));
+    count = 0;
+    for (it->Seek(Key(0)); it->Valid(); it->Next()) {
+      count++;
+    }
+    assert(it->status().ok() && count == expected);
+  }
+}
+
+void TestDeleteRange(bool column) {
+  cout << ">> delete range, " << (column ? "column" : "row") << endl;
+  int ret = system(string("rm -rf " + kDBPath).c_str());
+
+  Options options = TestOptions(column);
+  DB* db;
+  Status s = DB::Open(options, kDBPath, &db);
+  assert(s.ok());
+
+  WriteOptions wo;
+  for (int i = 0; i < kDeleteRangeKeys; i++) {
+    s = db->Put(wo, Key(i), DeleteRangeValue(options, i));
+    assert(s.ok());
+  }
+  s = db->Flush(FlushOptions());
+  assert(s.ok());
+
+  ReadOptions ro;
+  const Snapshot* snapshot = db->GetSnapshot();
+  s = db->DeleteRange(wo, db->DefaultColumnFamily(), Key(100), Key(200));
+  assert(s.ok());
+  // overlapping tombstones, and a key written again after them
+  s = db->DeleteRange(wo, db->DefaultColumnFamily(), Key(150), Key(250));
+  assert(s.ok());
+  s = db->Put(wo, Key(180), DeleteRangeValue(options, 180));
+  assert(s.ok());
+  auto deleted = [](int i) { return i >= 100 && i < 250 && i != 180; };
+
+  // the range queries trim the deleted keys across several batches too
+  const vector<size_t> capacities = {0, 4096, 500};
+  cout << "memtable" << endl;
+  ReadOptions snapshot_ro;
+  snapshot_ro.snapshot = snapshot;
+  for (size_t capacity : capacities) {
+    CheckDeleted(db, options, ro, deleted, capacity);
+    CheckDeleted(db, options, snapshot_ro, [](int i) { return false; },
+                 capacity);
+  }
+
+  cout << "flushed" << endl;
+  s = db->Flush(FlushOptions());
+  assert(s.ok());
+  for (size_t capacity : capacities) {
+    CheckDeleted(db, options, ro, deleted, capacity);
+    CheckDeleted(db, options, snapshot_ro, [](int i) { return false; },
+                 capacity);
+  }
+
+  // the snapshot keeps the deleted keys through the compaction
+  cout << "compacted" << endl;
+  s = db->DeleteRange(wo, db->DefaultColumnFamily(), Key(900), Key(2000));
+  assert(s.ok());
+  s = db->Flush(FlushOptions());
+  assert(s.ok());
+  auto deleted_more = [&](int i) { return deleted(i) || i >= 900; };
+  s = db->CompactRange(CompactRangeOptions(), nullptr, nullptr);
+  assert(s.ok());
+  CheckDeleted(db, options, ro, deleted_more);
+  CheckDeleted(db, options, snapshot_ro, [](int i) { return false; });
+
+  db->ReleaseSnapshot(snapshot);
+  s = db->CompactRange(CompactRangeOptions(), nullptr, nullptr);
+  assert(s.ok());
+  CheckDeleted(db, options, ro, deleted_more);
+
+  // the tombstones survive a reopen
+  delete db;
+  s = DB::Open(options, kDBPath, &db);
+  assert(s.ok());
+  CheckDeleted(db, options, ro, deleted_more);
+
+  delete db;
+  cout << endl;
+}
+
+void TestDropFiles(bool column) {
+  cout << ">> drop files, " << (column ? "column" : "row") << endl;
+  int ret = system(string("rm -rf " + kDBPath).c_str());
+
+  Options options = TestOptions(column);
+  DB* db;
+  Status s = DB::Open(options, kDBPath, &db);
+  assert(s.ok());
+
+  WriteOptions wo;
+  for (int f = 0; f < 2; f++) {
+    int half = kDeleteRangeKeys / 2;
+    for (int i = f * half; i < (f + 1) * half; i++) {
+      s = db->Put(wo, Key(i), DeleteRangeValue(options, i));
+      assert(s.ok());
+    }
+    s = db->Flush(FlushOptions());
+    assert(s.ok());
+  }
+  s = db->DeleteRange(wo, db->DefaultColumnFamily(), Key(0),
+                      Key(kDeleteRangeKeys));
+  assert(s.ok());
+  s = db->Flush(FlushOptions());
+  assert(s.ok());
+  string num;
+  db->GetProperty("vidardb.num-files-at-level0", &num);
+  assert(num == "3");
+
+  // nothing is left of the covered files nor of the tombstone
+  s = db->CompactRange(CompactRangeOptions(), nullptr, nullptr);
+  assert(s.ok());
+  db->GetProperty("vidardb.num-files-at-level0", &num);
+  assert(num == "0");
+  db->GetProperty("vidardb.num-files-at-level1", &num);
+  assert(num == "0");
+  CheckDeleted(db, options, ReadOptions(), [](int i) { return true; });
+
+  delete db;
+  cout << endl;
+}
+
 int main() {
   TestRowRangeQuery(false, 0);
   TestRowRangeQuery(false, 10);
@@ -97,5 +498,15 @@ int main() {
   TestRowRangeQuery(true, 10);
   TestRowRangeQuery(true, 20);
   TestRowRangeQuery(true, 50);
+
+  TestPerfSample();
+
+  TestBounds(false);
+  TestBounds(true);
+
+  TestDeleteRange(false);
+  TestDeleteRange(true);
+  TestDropFiles(false);
+  TestDropFiles(true);
   return 0;
 }
@@ -0,0 +1,513 @@
+// Copyright (c) 2020-present, VidarDB, Inc.  All rights reserved.
+// This source code is licensed under the BSD-style license found in the
+// LICENSE file in the root directory of this source tree. An additional grant
+// of patent rights can be found in the PATENTS file in the same directory.
+
+#include <sys/stat.h>
+#include <atomic>
+#include <iostream>
+#include <map>
+#include <thread>
+
+#include "vidardb/db.h"
+#include "vidardb/env.h"
+#include "vidardb/options.h"
+#include "vidardb/splitter.h"
+#include "vidardb/status.h"
+#include "vidardb/table.h"
+#include "vidardb/utilities/backup_engine.h"
+#include "vidardb/utilities/checkpoint.h"
+
+using namespace std;
+using namespace vidardb;
+
+const unsigned int kColumn = 3;
+const int kNumKeys = 1000;
+const string kDBPath = "/tmp/vidardb_replica_test";
+const string kCheckpointPath = "/tmp/vidardb_replica_test_checkpoint";
+const string kBackupPath = "/tmp/vidardb_replica_test_backup";
+const string kRestorePath = "/tmp/vidardb_replica_test_restore";
+const string kSecondaryPath = "/tmp/vidardb_replica_test_2nd";
+
+// The options of the row table, or of the column table of kColumn columns.
+Options ReplicaOptions(bool column) {
+  Options options;
+  options.create_if_missing = true;
+  options.splitter.reset(NewEncodingSplitter());
+  if (column) {
+    TableFactory* table_factory = NewColumnTableFactory();
+    ColumnTableOptions* opts =
+        static_cast<ColumnTableOptions*>(table_factory->GetOptions());
+    opts->column_count = kColumn;
+    options.table_factory.reset(table_factory);
+  }
+  return options;
+}
+
+string Value(const Options& options, int i, int version) {
+  string v = to_string(version) + "_" + to_string(i);
+  return options.splitter->Stitch({"a" + v, "b" + v, "c" + v});
+}
+
+void Put(DB* db, const Options& options, int begin, int end, int version) {
+  for (int i = begin; i < end; i++) {
+    Status s = db->Put(WriteOptions(), to_string(100000 + i),
+                       Value(options, i, version));
+    assert(s.ok());
+  }
+}
+
+void CheckVersion(DB* db, const Options& options, int version) {
+  ReadOptions ro;
+  string val;
+  for (int i = 0; i < kNumKeys; i++) {
+    Status s = db->Get(ro, to_string(100000 + i), &val);
+    assert(s.ok() && val == Value(options, i, version));
+  }
+}
+
+// The number of hard links of the file.
+nlink_t Links(const string& fname) {
+  struct stat st;
+  assert(stat(fname.c_str(), &st) == 0);
+  return st.st_nlink;
+}
+
+void TestCheckpoint() {
+  int ret = system(string("rm -rf " + kDBPath).c_str());
+  ret = system(string("rm -rf " + kCheckpointPath).c_str());
+
+  Options options = ReplicaOptions(true);
+  DB* db;
+  Status s = DB::Open(options, kDBPath, &db);
+  assert(s.ok());
+  Put(db, options, 0, kNumKeys, 1);
+  s = db->Flush(FlushOptions());
+  assert(s.ok());
+  Put(db, options, 0, kNumKeys / 2, 2);  // only in the WAL
+
+  cout << ">> live files" << endl;
+  vector<string> live_files;
+  uint64_t manifest_file_size;
+  s = db->GetLiveFiles(live_files, &manifest_file_size, false);
+  assert(s.ok());
+  string table, sub_column;
+  for (const auto& f : live_files) {
+    cout << f << " ";
+    if (f.find(".sst") != string::npos) {
+      (f.find('_') == string::npos ? table : sub_column) = f;
+    }
+  }
+  cout << endl;
+  assert(live_files.size() == 2 + 1 + kColumn);
+  assert(!table.empty() && sub_column.find(table + "_") == 0);
+
+  cout << ">> checkpoint" << endl;
+  Checkpoint* checkpoint;
+  s = Checkpoint::Create(db, &checkpoint);
+  assert(s.ok());
+  s = checkpoint->CreateCheckpoint(kCheckpointPath);
+  assert(s.ok());
+  s = checkpoint->CreateCheckpoint(kCheckpointPath);
+  assert(s.IsInvalidArgument());
+  delete checkpoint;
+
+  // the table and its sub-column files are hard linked
+  assert(Links(kDBPath + table) == 2);
+  assert(Links(kCheckpointPath + sub_column) == 2);
+
+  // the writes after the checkpoint are not in it
+  Put(db, options, 0, kNumKeys, 3);
+  s = db->Flush(FlushOptions());
+  assert(s.ok());
+  s = db->CompactRange(CompactRangeOptions(), nullptr, nullptr);
+  assert(s.ok());
+  CheckVersion(db, options, 3);
+  delete db;
+
+  DB* checkpoint_db;
+  s = DB::Open(options, kCheckpointPath, &checkpoint_db);
+  assert(s.ok());
+  ReadOptions ro;
+  string val;
+  for (int i = 0; i < kNumKeys; i++) {
+    s = checkpoint_db->Get(ro, to_string(100000 + i), &val);
+    assert(s.ok() && val == Value(options, i, i < kNumKeys / 2 ? 2 : 1));
+  }
+  ro.columns = {3};
+  list<RangeQueryKeyVal> res;
+  checkpoint_db->RangeQuery(ro, Range(), res, &s);
+  assert(s.ok());
+  assert(res.size() == kNumKeys);
+  delete checkpoint_db;
+
+  // the DB is left alone by the checkpoint DB
+  s = DB::Open(options, kDBPath, &db);
+  assert(s.ok());
+  CheckVersion(db, options, 3);
+  delete db;
+  cout << endl;
+}
+
+// The version of key i written last before backup id: 1 for all the keys,
+// 2 for the first half, 3 for the first quarter.
+int Version(BackupID id, int i) {
+  if (id >= 3 && i < kNumKeys / 4) {
+    return 3;
+  }
+  return i < kNumKeys / 2 ? 2 : 1;
+}
+
+// Restore the backup and check its values.
+void CheckRestore(BackupEngine* backup_engine, BackupID id,
+                  const Options& options) {
+  int ret = system(string("rm -rf " + kRestorePath).c_str());
+  Status s = backup_engine->RestoreDBFromBackup(id, kRestorePath,
+                                                kRestorePath);
+  assert(s.ok());
+  DB* db;
+  s = DB::Open(options, kRestorePath, &db);
+  assert(s.ok());
+  ReadOptions ro;
+  string val;
+  for (int i = 0; i < kNumKeys; i++) {
+    s = db->Get(ro, to_string(100000 + i), &val);
+    assert(s.ok() && val == Value(options, i, Version(id, i)));
+  }
+  delete db;
+}
+
+size_t CountFiles(const string& dir) {
+  vector<string> children;
+  Status s = Env::Default()->GetChildren(dir, &children);
+  assert(s.ok());
+  size_t count = 0;
+  for (const auto& child : children) {
+    if (child != "." && child != "..") {
+      count++;
+    }
+  }
+  return count;
+}
+
+void TestBackupEngine() {
+  int ret = system(string("rm -rf " + kDBPath).c_str());
+  ret = system(string("rm -rf " + kBackupPath).c_str());
+
+  Options options = ReplicaOptions(true);
+  DB* db;
+  Status s = DB::Open(options, kDBPath, &db);
+  assert(s.ok());
+  BackupEngine* backup_engine;
+  s = BackupEngine::Open(
+      Env::Default(),
+      BackupEngineOptions(kBackupPath, nullptr, true, nullptr, true, false,
+                          true, 4),
+      &backup_engine);
+  assert(s.ok());
+
+  cout << ">> backups" << endl;
+  // 1: one table, the WAL
+  Put(db, options, 0, kNumKeys, 1);
+  s = db->Flush(FlushOptions());
+  assert(s.ok());
+  Put(db, options, 0, kNumKeys / 2, 2);
+  s = backup_engine->CreateNewBackup(db);
+  assert(s.ok());
+  assert(CountFiles(kBackupPath + "/shared") == 1 + kColumn);
+
+  // 2: the table of 1 is shared, one more table
+  s = db->Flush(FlushOptions());
+  assert(s.ok());
+  s = backup_engine->CreateNewBackup(db, true);
+  assert(s.ok());
+  assert(CountFiles(kBackupPath + "/shared") == 2 * (1 + kColumn));
+
+  // 3: one compacted table
+  Put(db, options, 0, kNumKeys / 4, 3);
+  s = db->CompactRange(CompactRangeOptions(), nullptr, nullptr);
+  assert(s.ok());
+  s = backup_engine->CreateNewBackup(db);
+  assert(s.ok());
+  assert(CountFiles(kBackupPath + "/shared") == 3 * (1 + kColumn));
+  delete db;
+
+  vector<BackupInfo> backup_info;
+  backup_engine->GetBackupInfo(&backup_info);
+  assert(backup_info.size() == 3);
+  for (const auto& info : backup_info) {
+    cout << "backup " << info.backup_id << ": " << info.number_files
+         << " files, " << info.size << " bytes" << endl;
+    s = backup_engine->VerifyBackup(info.backup_id, true);
+    assert(s.ok());
+  }
+
+  cout << ">> restore" << endl;
+  CheckRestore(backup_engine, 1, options);
+  CheckRestore(backup_engine, 2, options);
+  CheckRestore(backup_engine, 3, options);
+
+  cout << ">> reopen, purge" << endl;
+  delete backup_engine;
+  s = BackupEngine::Open(Env::Default(), BackupEngineOptions(kBackupPath),
+                         &backup_engine);
+  assert(s.ok());
+  backup_info.clear();
+  backup_engine->GetBackupInfo(&backup_info);
+  assert(backup_info.size() == 3);
+  s = backup_engine->PurgeOldBackups(1);
+  assert(s.ok());
+  // the tables of the backups deleted are deleted
+  assert(CountFiles(kBackupPath + "/shared") == 1 + kColumn);
+  assert(CountFiles(kBackupPath + "/private") == 1);
+  s = backup_engine->VerifyBackup(1);
+  assert(s.IsNotFound());
+  CheckRestore(backup_engine, 3, options);
+
+  cout << ">> corruption" << endl;
+  vector<string> shared;
+  s = Env::Default()->GetChildren(kBackupPath + "/shared", &shared);
+  assert(s.ok());
+  for (const auto& f : shared) {
+    if (f.find(".sst_2") != string::npos) {
+      // flip the first byte of a sub-column file
+      string fname = kBackupPath + "/shared/" + f;
+      FILE* fp = fopen(fname.c_str(), "r+");
+      int c = fgetc(fp);
+      fseek(fp, 0, SEEK_SET);
+      fputc(c ^ 0xff, fp);
+      fclose(fp);
+    }
+  }
+  s = backup_engine->VerifyBackup(3);
+  assert(s.ok());
+  s = backup_engine->VerifyBackup(3, true);
+  assert(s.IsCorruption());
+  ret = system(string("rm -rf " + kRestorePath).c_str());
+  s = backup_engine->RestoreDBFromLatestBackup(kRestorePath, kRestorePath);
+  assert(s.IsCorruption());
+  delete backup_engine;
+  cout << endl;
+}
+
+string Key(int i) { return to_string(100000 + i); }
+
+// Check the keys [begin, end) have the version, and the others of
+// [first, limit) are absent.
+void CheckSecondary(DB* db, const Options& options, int begin, int end,
+                    int version, int first, int limit) {
+  ReadOptions ro;
+  string val;
+  for (int i = first; i < limit; i++) {
+    Status s = db->Get(ro, Key(i), &val);
+    if (i >= begin && i < end) {
+      assert(s.ok() && val == Value(options, i, version));
+    } else {
+      assert(s.IsNotFound());
+    }
+  }
+
+  // the second column of all the keys in the range
+  ro.columns = {2};
+  list<RangeQueryKeyVal> res;
+  Status s;
+  db->RangeQuery(ro, Range(Key(first), Key(limit)), res, &s);
+  assert(s.ok());
+  assert(res.size() == static_cast<size_t>(end - begin));
+  // the results are not ordered across the memtables and the tables
+  map<string, string> kvs;
+  for (const auto& it : res) {
+    kvs[it.user_key] = it.value().ToString();
+  }
+  assert(kvs.size() == res.size());
+  for (int i = begin; i < end; i++) {
+    string v = to_string(version) + "_" + to_string(i);
+    assert(kvs[Key(i)] == options.splitter->Stitch({"b" + v}));
+  }
+}
+
+void TestCatchUp(bool column) {
+  cout << ">> catch up, " << (column ? "column" : "row") << endl;
+  int ret = system(string("rm -rf " + kDBPath).c_str());
+  ret = system(string("rm -rf " + kSecondaryPath).c_str());
+
+  Options options = ReplicaOptions(column);
+  DB* db;
+  Status s = DB::Open(options, kDBPath, &db);
+  assert(s.ok());
+  Put(db, options, 0, 100, 1);
+  s = db->Flush(FlushOptions());
+  assert(s.ok());
+  Put(db, options, 100, 200, 1);  // only in the WAL
+
+  // the tables and the WAL of the primary at the open
+  DB* secondary;
+  s = DB::OpenAsSecondary(ReplicaOptions(column), kDBPath, kSecondaryPath,
+                          &secondary);
+  assert(s.ok());
+  CheckSecondary(secondary, options, 0, 200, 1, 0, 400);
+  s = secondary->Put(WriteOptions(), Key(0), "x");
+  assert(s.IsNotSupported());
+  s = db->TryCatchUpWithPrimary();
+  assert(s.IsNotSupported());
+
+  // the tail of the WAL
+  Put(db, options, 200, 300, 1);
+  CheckSecondary(secondary, options, 0, 200, 1, 0, 400);
+  s = secondary->TryCatchUpWithPrimary();
+  assert(s.ok());
+  CheckSecondary(secondary, options, 0, 300, 1, 0, 400);
+
+  // the new tables of a flush and a compaction, the memtables recreated
+  Put(db, options, 0, 300, 2);
+  s = db->Flush(FlushOptions());
+  assert(s.ok());
+  s = db->CompactRange(CompactRangeOptions(), nullptr, nullptr);
+  assert(s.ok());
+  s = db->Delete(WriteOptions(), Key(299));
+  assert(s.ok());
+  s = secondary->TryCatchUpWithPrimary();
+  assert(s.ok());
+  CheckSecondary(secondary, options, 0, 299, 2, 0, 400);
+
+  // a new MANIFEST once the primary is reopened
+  delete db;
+  s = DB::Open(options, kDBPath, &db);
+  assert(s.ok());
+  Put(db, options, 0, 100, 3);
+  s = db->Flush(FlushOptions());
+  assert(s.ok());
+  Put(db, options, 0, 100, 4);
+  s = secondary->TryCatchUpWithPrimary();
+  assert(s.ok());
+  CheckSecondary(secondary, options, 0, 100, 4, 0, 100);
+  CheckSecondary(secondary, options, 100, 299, 2, 100, 400);
+
+  delete secondary;
+  delete db;
+  cout << endl;
+}
+
+// The secondary instance catches up while the primary writes.
+void TestConcurrentWrites() {
+  cout << ">> concurrent writes" << endl;
+  int ret = system(string("rm -rf " + kDBPath).c_str());
+  ret = system(string("rm -rf " + kSecondaryPath).c_str());
+
+  const int kNumKeys = 20000;
+  Options options = ReplicaOptions(true);
+  options.write_buffer_size = 64 << 10;
+  DB* db;
+  Status s = DB::Open(options, kDBPath, &db);
+  assert(s.ok());
+  DB* secondary;
+  s = DB::OpenAsSecondary(options, kDBPath, kSecondaryPath, &secondary);
+  assert(s.ok());
+
+  atomic<int> written(0);
+  thread writer([&]() {
+    for (int i = 0; i < kNumKeys; i++) {
+      Status ws = db->Put(WriteOptions(), Key(i), Value(options, i, 1));
+      assert(ws.ok());
+      written.store(i + 1);
+    }
+  });
+
+  // a key is seen once written, then in all the later catch-ups
+  int seen = 0, catch_ups = 0;
+  ReadOptions ro;
+  string val;
+  while (seen < kNumKeys) {
+    int target = written.load();
+    s = secondary->TryCatchUpWithPrimary();
+    assert(s.ok());
+    catch_ups++;
+    for (int i = seen; i < target; i++) {
+      s = secondary->Get(ro, Key(i), &val);
+      assert(s.ok() && val == Value(options, i, 1));
+    }
+    if (seen > 0) {
+      s = secondary->Get(ro, Key(seen / 2), &val);
+      assert(s.ok() && val == Value(options, seen / 2, 1));
+    }
+    seen = target;
+  }
+  writer.join();
+  cout << "catch ups: " << catch_ups << endl;
+
+  delete secondary;
+  delete db;
+  cout << endl;
+}
+
+// Two threads catch up at the same time while the primary flushes: none of
+// them sees a key written before its catch-up go missing.
+void TestConcurrentCatchUps() {
+  cout << ">> concurrent catch ups" << endl;
+  int ret = system(string("rm -rf " + kDBPath).c_str());
+  ret = system(string("rm -rf " + kSecondaryPath).c_str());
+
+  const int kNumKeys = 20000;
+  Options options = ReplicaOptions(true);
+  options.write_buffer_size = 64 << 10;
+  DB* db;
+  Status s = DB::Open(options, kDBPath, &db);
+  assert(s.ok());
+  DB* secondary;
+  s = DB::OpenAsSecondary(options, kDBPath, kSecondaryPath, &secondary);
+  assert(s.ok());
+
+  atomic<int> written(0);
+  thread writer([&]() {
+    for (int i = 0; i < kNumKeys; i++) {
+      Status ws = db->Put(WriteOptions(), Key(i), Value(options, i, 1));
+      assert(ws.ok());
+      written.store(i + 1);
+      if (i % 100 == 99) {
+        ws = db->Flush(FlushOptions());
+        assert(ws.ok());
+      }
+    }
+  });
+
+  atomic<int> catch_ups(0);
+  auto catch_up = [&]() {
+    ReadOptions ro;
+    string val;
+    int target = 0;
+    while (target < kNumKeys) {
+      target = written.load();
+      Status cs = secondary->TryCatchUpWithPrimary();
+      assert(cs.ok());
+      catch_ups++;
+      for (int i = 0; i < target; i += 997) {
+        cs = secondary->Get(ro, Key(i), &val);
+        assert(cs.ok() && val == Value(options, i, 1));
+      }
+      if (target > 0) {
+        cs = secondary->Get(ro, Key(target - 1), &val);
+        assert(cs.ok() && val == Value(options, target - 1, 1));
+      }
+    }
+  };
+  thread catch_up1(catch_up), catch_up2(catch_up);
+  writer.join();
+  catch_up1.join();
+  catch_up2.join();
+  cout << "catch ups: " << catch_ups.load() << endl;
+
+  delete secondary;
+  delete db;
+  cout << endl;
+}
+
+int main() {
+  TestCheckpoint();
+  TestBackupEngine();
+
+  TestCatchUp(false);
+  TestCatchUp(true);
+  TestConcurrentWrites();
+  TestConcurrentCatchUps();
+  return 0;
+}
@@ -0,0 +1,744 @@
+// Copyright (c) 2019-present, VidarDB, Inc.  All rights reserved.
+// This source code is licensed under the BSD-style license found in the
+// LICENSE file in the root directory of this source tree. An additional grant
+// of patent rights can be found in the PATENTS file in the same directory.
+
+#include <fstream>
+#include <iostream>
+#include <memory>
+
+#include "vidardb/cache.h"
+#include "vidardb/db.h"
+#include "vidardb/env.h"
+#include "vidardb/memory_allocator.h"
+#include "vidardb/options.h"
+#include "vidardb/splitter.h"
+#include "vidardb/statistics.h"
+#include "vidardb/status.h"
+#include "vidardb/table.h"
+#include "vidardb/table_properties.h"
+
+using namespace std;
+using namespace vidardb;
+
+const unsigned int kColumn = 3;
+const int kNumFiles = 3;
+const int kNumKeys = 1000;
+const string kDBPath = "/tmp/vidardb_table_test";
+const int kPartitionedIndexKeys = 5000;
+const int kHashIndexKeys = 3000;
+const unsigned int kRowCacheColumn = 4;
+const int kRowCacheKeys = 100;
+
+// The options of the row table, or of the column table of the columns.
+Options TableTestOptions(bool column, unsigned int columns = kColumn) {
+  Options options;
+  options.create_if_missing = true;
+  options.splitter.reset(NewEncodingSplitter());
+  if (column) {
+    TableFactory* table_factory = NewColumnTableFactory();
+    ColumnTableOptions* opts =
+        static_cast<ColumnTableOptions*>(table_factory->GetOptions());
+    opts->column_count = columns;
+    options.table_factory.reset(table_factory);
+  }
+  return options;
+}
+
+// The options of the table factory of the options, row or column.
+TableOptions* GetTableOptions(const Options& options) {
+  return static_cast<TableOptions*>(options.table_factory->GetOptions());
+}
+
+Options LazyOpenOptions() {
+  Options options = TableTestOptions(true);
+  options.statistics = CreateDBStatistics();
+  options.max_file_opening_threads = 4;
+  options.persist_table_open_state = true;
+  options.disable_auto_compactions = true;
+  static_cast<ColumnTableOptions*>(GetTableOptions(options))
+      ->lazy_open_columns = true;
+  return options;
+}
+
+string Value(const Options& options, const string& key) {
+  return options.splitter->Stitch({"name" + key, "2" + key, "city" + key});
+}
+
+void TestLazyOpenLoad() {
+  cout << ">> lazy open, load" << endl;
+  int ret = system(string("rm -rf " + kDBPath).c_str());
+
+  Options options = LazyOpenOptions();
+  DB* db;
+  Status s = DB::Open(options, kDBPath, &db);
+  assert(s.ok());
+
+  WriteOptions wo;
+  for (int f = 0; f < kNumFiles; f++) {
+    for (int i = f; i < kNumKeys; i += kNumFiles) {
+      string key = to_string(100000 + i);
+      s = db->Put(wo, key, Value(options, key));
+      assert(s.ok());
+    }
+    s = db->Flush(FlushOptions());
+    assert(s.ok());
+  }
+  // a flush verifies the new table with all its columns
+  assert(options.statistics->getTickerCount(COLUMN_SUB_FILE_OPENS) ==
+         kNumFiles * kColumn);
+
+  delete db;
+  s = Env::Default()->FileExists(kDBPath + "/TABLE_OPEN_STATE");
+  assert(s.ok());
+  cout << endl;
+}
+
+void TestLazyOpenReopen() {
+  cout << ">> lazy open, reopen" << endl;
+  Options options = LazyOpenOptions();
+  DB* db;
+  Status s = DB::Open(options, kDBPath, &db);
+  assert(s.ok());
+
+  auto stats = options.statistics;
+  uint64_t hits = stats->getTickerCount(TABLE_OPEN_STATE_HIT);
+  cout << "open state hits: " << hits << endl;
+  // the footers and meta blocks of the main files are known
+  assert(hits >= kNumFiles);
+  assert(stats->getTickerCount(COLUMN_SUB_FILE_OPENS) == 0);
+
+  // a projection only opens the sub-column files of its column
+  ReadOptions ro;
+  ro.columns = {2};
+  string val;
+  for (int i = 0; i < kNumKeys; i += 11) {
+    string key = to_string(100000 + i);
+    s = db->Get(ro, key, &val);
+    assert(s.ok());
+    vector<Slice> vals(options.splitter->Split(val));
+    assert(vals.size() == 1 && vals[0].ToString() == "2" + key);
+  }
+  assert(stats->getTickerCount(COLUMN_SUB_FILE_OPENS) == kNumFiles);
+  // the sub-column files were opened by the last run too
+  assert(stats->getTickerCount(TABLE_OPEN_STATE_HIT) > hits);
+
+  // all the columns
+  ro.columns.clear();
+  for (int i = 0; i < kNumKeys; i += 13) {
+    string key = to_string(100000 + i);
+    s = db->Get(ro, key, &val);
+    assert(s.ok());
+    assert(val == Value(options, key));
+  }
+  assert(stats->getTickerCount(COLUMN_SUB_FILE_OPENS) == kNumFiles * kColumn);
+
+  delete db;
+  cout << endl;
+}
+
+Options PartitionedIndexOptions(bool column, bool pin_l0) {
+  Options options = TableTestOptions(column);
+  options.disable_auto_compactions = true;
+  TableOptions* opts = GetTableOptions(options);
+  // small blocks and partitions for many index partitions
+  opts->index_type = TableOptions::kTwoLevelIndexSearch;
+  opts->block_size = 256;
+  opts->metadata_block_size = 128;
+  opts->pin_l0_index_partitions = pin_l0;
+  return options;
+}
+
+void VerifyPartitionedIndex(DB* db, const Options& options) {
+  ReadOptions ro;
+  string val;
+  for (int i = 0; i < kPartitionedIndexKeys; i++) {
+    string key = to_string(100000 + 2 * i);
+    Status s = db->Get(ro, key, &val);
+    assert(s.ok());
+    assert(val == Value(options, key));
+    // between two keys
+    s = db->Get(ro, to_string(100000 + 2 * i + 1), &val);
+    assert(s.IsNotFound());
+  }
+
+  ro.columns = {3};
+  Status s = db->Get(ro, "100010", &val);
+  assert(s.ok());
+  vector<Slice> vals(options.splitter->Split(val));
+  assert(vals.size() == 1 && vals[0].ToString() == "city100010");
+
+  ro.columns.clear();
+  Iterator* it = db->NewIterator(ro);
+  int count = 0;
+  for (it->SeekToFirst(); it->Valid(); it->Next()) {
+    string key = to_string(100000 + 2 * count);
+    assert(it->key().ToString() == key);
+    assert(it->value().ToString() == Value(options, key));
+    count++;
+  }
+  assert(it->status().ok());
+  assert(count == kPartitionedIndexKeys);
+
+  it->Seek("104001");
+  assert(it->Valid() && it->key().ToString() == "104002");
+  delete it;
+}
+
+void TestPartitionedIndex(bool column) {
+  cout << ">> partitioned index, " << (column ? "column" : "row") << endl;
+  int ret = system(string("rm -rf " + kDBPath).c_str());
+
+  Options options = PartitionedIndexOptions(column, false);
+  DB* db;
+  Status s = DB::Open(options, kDBPath, &db);
+  assert(s.ok());
+
+  WriteOptions wo;
+  for (int i = 0; i < kPartitionedIndexKeys; i++) {
+    string key = to_string(100000 + 2 * i);
+    s = db->Put(wo, key, Value(options, key));
+    assert(s.ok());
+  }
+  s = db->Flush(FlushOptions());
+  assert(s.ok());
+
+  TablePropertiesCollection props;
+  s = db->GetPropertiesOfAllTables(&props);
+  assert(s.ok() && props.size() == 1);
+  const auto& user_props = props.begin()->second->user_collected_properties;
+  assert(user_props.count("vidardb.index.type") == 1);
+
+  VerifyPartitionedIndex(db, options);
+  delete db;
+
+  // the table is in level 0, with its index partitions pinned
+  options = PartitionedIndexOptions(column, true);
+  s = DB::Open(options, kDBPath, &db);
+  assert(s.ok());
+  VerifyPartitionedIndex(db, options);
+  delete db;
+  cout << endl;
+}
+
+Options HashIndexOptions(bool column) {
+  Options options = TableTestOptions(column);
+  options.disable_auto_compactions = true;
+  TableOptions* opts = GetTableOptions(options);
+  opts->data_block_index_type = TableOptions::kDataBlockBinaryAndHash;
+  // short restart intervals, so versions of a key span several of them
+  opts->block_restart_interval = 2;
+  return options;
+}
+
+string Value(const Options& options, const string& key, int version) {
+  string v = to_string(version);
+  return options.splitter->Stitch({"name" + key + v, "2" + key, "city" + v});
+}
+
+void TestHashIndex(bool column) {
+  cout << ">> data block hash index, " << (column ? "column" : "row") << endl;
+  int ret = system(string("rm -rf " + kDBPath).c_str());
+
+  Options options = HashIndexOptions(column);
+  DB* db;
+  Status s = DB::Open(options, kDBPath, &db);
+  assert(s.ok());
+
+  WriteOptions wo;
+  for (int i = 0; i < kHashIndexKeys; i++) {
+    string key = to_string(100000 + 2 * i);
+    s = db->Put(wo, key, Value(options, key, 0));
+    assert(s.ok());
+  }
+  // keep the old versions in the flushed table
+  const Snapshot* snapshot = db->GetSnapshot();
+  for (int i = 0; i < kHashIndexKeys; i += 3) {
+    string key = to_string(100000 + 2 * i);
+    s = db->Put(wo, key, Value(options, key, 1));
+    assert(s.ok());
+  }
+  for (int i = 0; i < kHashIndexKeys; i += 7) {
+    s = db->Delete(wo, to_string(100000 + 2 * i));
+    assert(s.ok());
+  }
+  s = db->Flush(FlushOptions());
+  assert(s.ok());
+
+  ReadOptions ro;
+  ReadOptions snap_ro;
+  snap_ro.snapshot = snapshot;
+  string val;
+  for (int i = 0; i < kHashIndexKeys; i++) {
+    string key = to_string(100000 + 2 * i);
+    s = db->Get(ro, key, &val);
+    if (i % 7 == 0) {
+      assert(s.IsNotFound());
+    } else {
+      assert(s.ok());
+      assert(val == Value(options, key, i % 3 == 0 ? 1 : 0));
+    }
+
+    s = db->Get(snap_ro, key, &val);
+    assert(s.ok());
+    assert(val == Value(options, key, 0));
+
+    // absent keys around and beyond the existing ones
+    s = db->Get(ro, to_string(100000 + 2 * i + 1), &val);
+    assert(s.IsNotFound());
+  }
+  s = db->Get(ro, "099999", &val);
+  assert(s.IsNotFound());
+  s = db->Get(ro, "999999", &val);
+  assert(s.IsNotFound());
+
+  // a projection seeks the sub columns by positions
+  ro.columns = {3};
+  s = db->Get(ro, "100010", &val);
+  assert(s.ok());
+  vector<Slice> vals(options.splitter->Split(val));
+  assert(vals.size() == 1 && vals[0].ToString() == "city0");
+
+  ro.columns.clear();
+  Iterator* it = db->NewIterator(ro);
+  it->Seek("100301");
+  assert(it->Valid() && it->key().ToString() == "100302");
+  int count = 0;
+  for (it->SeekToFirst(); it->Valid(); it->Next()) {
+    count++;
+  }
+  assert(it->status().ok());
+  assert(count == kHashIndexKeys - (kHashIndexKeys + 6) / 7);
+  delete it;
+
+  db->ReleaseSnapshot(snapshot);
+  delete db;
+  cout << endl;
+}
+
+// The byte by byte split, a delimiter at the last byte belongs to the last
+// sub-slice.
+vector<string> PipeSplit(const string& s) {
+  vector<string> res;
+  size_t j = 0;
+  for (size_t i = 0; i + 1 < s.size(); i++) {
+    if (s[i] == '|') {
+      res.push_back(s.substr(j, i - j));
+      j = i + 1;
+    }
+  }
+  if (!s.empty()) {
+    res.push_back(s.substr(j));
+  }
+  return res;
+}
+
+void CheckSplit(const Splitter* splitter, const string& s,
+                const vector<string>& expected, vector<Slice>& reused) {
+  vector<Slice> vals(splitter->Split(s));
+  splitter->Split(s, reused);
+  assert(vals.size() == expected.size());
+  assert(reused.size() == expected.size());
+  for (size_t i = 0; i < expected.size(); i++) {
+    assert(vals[i].ToString() == expected[i]);
+    assert(reused[i].ToString() == expected[i]);
+  }
+}
+
+void TestPipeSplitter() {
+  cout << ">> pipe splitter" << endl;
+  unique_ptr<Splitter> splitter(NewPipeSplitter());
+  vector<Slice> reused;
+  CheckSplit(splitter.get(), "", {}, reused);
+  CheckSplit(splitter.get(), "|", {"|"}, reused);
+  CheckSplit(splitter.get(), "a", {"a"}, reused);
+  CheckSplit(splitter.get(), "a||b", {"a", "", "b"}, reused);
+  CheckSplit(splitter.get(), "|a", {"", "a"}, reused);
+  CheckSplit(splitter.get(), "a|", {"a|"}, reused);
+  CheckSplit(splitter.get(), "a||", {"a", "|"}, reused);
+
+  // delimiters around the boundaries of the vectorized chunks
+  for (size_t len = 1; len < 100; len++) {
+    for (size_t pos = 0; pos < len; pos++) {
+      string s(len, 'x');
+      s[pos] = '|';
+      if (pos + 3 < len) {
+        s[pos + 3] = '|';
+      }
+      CheckSplit(splitter.get(), s, PipeSplit(s), reused);
+    }
+    string s(len, '|');
+    CheckSplit(splitter.get(), s, PipeSplit(s), reused);
+  }
+
+  vector<Slice> v = {"abc", "", "defghijklmnopqrstuvwxyz0123456789"};
+  string buf("prefix");
+  Slice stitched = splitter->Stitch(v, buf);
+  assert(stitched.ToString() ==
+         "prefixabc||defghijklmnopqrstuvwxyz0123456789");
+  assert(splitter->Stitch(v) == "abc||defghijklmnopqrstuvwxyz0123456789");
+  assert(splitter->Stitch(vector<Slice>()).empty());
+  cout << endl;
+}
+
+void TestEncodingSplitter() {
+  cout << ">> encoding splitter" << endl;
+  unique_ptr<Splitter> splitter(NewEncodingSplitter());
+  vector<Slice> reused;
+  vector<string> fields = {"", "a|b", string(300, 'x'), "c"};
+  vector<Slice> v(fields.begin(), fields.end());
+  string s(splitter->Stitch(v));
+  CheckSplit(splitter.get(), s, fields, reused);
+  CheckSplit(splitter.get(), "", {}, reused);
+
+  string buf;
+  for (const auto& f : v) {
+    splitter->Append(buf, f, false);
+  }
+  assert(buf == s);
+  buf.clear();
+  assert(splitter->Stitch(v, buf).ToString() == s);
+  cout << endl;
+}
+
+Options RowCacheOptions(bool column) {
+  Options options = TableTestOptions(column, kRowCacheColumn);
+  options.row_cache = NewLRUCache(1 << 20);
+  options.statistics = CreateDBStatistics();
+  return options;
+}
+
+string Column(int i, uint32_t column) {
+  return "c" + to_string(column) + "_" + to_string(i);
+}
+
+// The value of the key i projected to columns, all of them if empty.
+string Expected(const Options& options, int i,
+                const vector<uint32_t>& columns) {
+  vector<string> vals;
+  if (columns.empty()) {
+    for (uint32_t c = 1; c <= kRowCacheColumn; c++) {
+      vals.push_back(Column(i, c));
+    }
+  } else if (columns.size() == 1 && columns[0] == 0) {
+    return "";
+  } else {
+    for (auto c : columns) {
+      vals.push_back(Column(i, c));
+    }
+  }
+  vector<Slice> slices(vals.begin(), vals.end());
+  return options.splitter->Stitch(slices);
+}
+
+// Get all the keys with columns, return the row cache hits.
+uint64_t GetAll(DB* db, const Options& options, ReadOptions ro,
+                const vector<uint32_t>& columns) {
+  uint64_t hits = options.statistics->getTickerCount(ROW_CACHE_HIT);
+  ro.columns = columns;
+  string val;
+  for (int i = 0; i < kRowCacheKeys; i++) {
+    Status s = db->Get(ro, to_string(100000 + i), &val);
+    assert(s.ok() && val == Expected(options, i, columns));
+  }
+  return options.statistics->getTickerCount(ROW_CACHE_HIT) - hits;
+}
+
+void TestRowCacheProjection(bool column) {
+  cout << ">> row cache projection, " << (column ? "column" : "row") << endl;
+  int ret = system(string("rm -rf " + kDBPath).c_str());
+
+  Options options = RowCacheOptions(column);
+  DB* db;
+  Status s = DB::Open(options, kDBPath, &db);
+  assert(s.ok());
+
+  WriteOptions wo;
+  for (int i = 0; i < kRowCacheKeys; i++) {
+    vector<string> vals;
+    for (uint32_t c = 1; c <= kRowCacheColumn; c++) {
+      vals.push_back(Column(i, c));
+    }
+    vector<Slice> slices(vals.begin(), vals.end());
+    s = db->Put(wo, to_string(100000 + i), options.splitter->Stitch(slices));
+    assert(s.ok());
+  }
+  s = db->Flush(FlushOptions());
+  assert(s.ok());
+
+  auto stats = options.statistics;
+  ReadOptions ro;
+  assert(GetAll(db, options, ro, {2, 4}) == 0);
+  assert(stats->getTickerCount(ROW_CACHE_MISS) == kRowCacheKeys);
+
+  // a subset of the cached columns, in another order
+  uint64_t blocks = stats->getTickerCount(COLUMN_BLOCK_READ);
+  assert(GetAll(db, options, ro, {4}) == kRowCacheKeys);
+  assert(GetAll(db, options, ro, {4, 2}) == kRowCacheKeys);
+  assert(GetAll(db, options, ro, {0}) == kRowCacheKeys);
+  assert(stats->getTickerCount(COLUMN_BLOCK_READ) == blocks);
+
+  // the missing column is read alone and added
+  assert(GetAll(db, options, ro, {1, 2}) == 0);
+  assert(stats->getTickerCount(ROW_CACHE_PARTIAL_HIT) == kRowCacheKeys);
+  assert(GetAll(db, options, ro, {1, 2, 4}) == kRowCacheKeys);
+
+  // the whole rows
+  assert(GetAll(db, options, ro, {}) == 0);
+  assert(stats->getTickerCount(ROW_CACHE_PARTIAL_HIT) == 2 * kRowCacheKeys);
+  blocks = stats->getTickerCount(COLUMN_BLOCK_READ);
+  assert(GetAll(db, options, ro, {}) == kRowCacheKeys);
+  assert(GetAll(db, options, ro, {3}) == kRowCacheKeys);
+  assert(stats->getTickerCount(COLUMN_BLOCK_READ) == blocks);
+
+  // the snapshot reads are cached apart
+  ro.snapshot = db->GetSnapshot();
+  assert(GetAll(db, options, ro, {3}) == 0);
+  assert(GetAll(db, options, ro, {3}) == kRowCacheKeys);
+  db->ReleaseSnapshot(ro.snapshot);
+
+  delete db;
+  cout << endl;
+}
+
+void TestRowCacheOverwrite(bool column) {
+  cout << ">> row cache overwrite, " << (column ? "column" : "row") << endl;
+  int ret = system(string("rm -rf " + kDBPath).c_str());
+
+  Options options = RowCacheOptions(column);
+  DB* db;
+  Status s = DB::Open(options, kDBPath, &db);
+  assert(s.ok());
+
+  WriteOptions wo;
+  const string key = "key";
+  s = db->Put(wo, key, options.splitter->Stitch({"a1", "b1", "c1", "d1"}));
+  assert(s.ok());
+  s = db->Flush(FlushOptions());
+  assert(s.ok());
+  ReadOptions ro;
+  ro.columns = {1, 3};
+  string val;
+  s = db->Get(ro, key, &val);
+  assert(s.ok() && val == options.splitter->Stitch({"a1", "c1"}));
+
+  // the rows are cached by file, a newer file is read instead
+  s = db->Put(wo, key, options.splitter->Stitch({"a2", "b2", "c2", "d2"}));
+  assert(s.ok());
+  s = db->Flush(FlushOptions());
+  assert(s.ok());
+  s = db->Get(ro, key, &val);
+  assert(s.ok() && val == options.splitter->Stitch({"a2", "c2"}));
+
+  s = db->Delete(wo, key);
+  assert(s.ok());
+  s = db->Flush(FlushOptions());
+  assert(s.ok());
+  for (int i = 0; i < 2; i++) {
+    s = db->Get(ro, key, &val);
+    assert(s.IsNotFound());
+  }
+
+  delete db;
+  cout << endl;
+}
+
+Options ChecksumOptions(bool column, TableOptions::ChecksumType checksum) {
+  Options options = TableTestOptions(column);
+  GetTableOptions(options)->checksum = checksum;
+  return options;
+}
+
+string ChecksumValue(const Options& options, int i) {
+  string s = to_string(i);
+  return options.splitter->Stitch({"a" + s, "b" + s, "c" + s});
+}
+
+void ReadAllVerified(const Options& options) {
+  DB* db;
+  Status s = DB::Open(options, kDBPath, &db);
+  assert(s.ok());
+
+  ReadOptions ro;
+  ro.verify_checksums = true;
+  string val;
+  for (int i = 0; i < kNumKeys; i++) {
+    s = db->Get(ro, to_string(100000 + i), &val);
+    assert(s.ok() && val == ChecksumValue(options, i));
+  }
+  Iterator* it = db->NewIterator(ro);
+  int count = 0;
+  for (it->SeekToFirst(); it->Valid(); it->Next()) {
+    count++;
+  }
+  assert(it->status().ok() && count == kNumKeys);
+  delete it;
+  delete db;
+}
+
+// Flip a byte of the first data block of every table file.
+void CorruptTables() {
+  vector<string> files;
+  Status s = Env::Default()->GetChildren(kDBPath, &files);
+  assert(s.ok());
+  for (const auto& file : files) {
+    if (file.size() < 4 || file.substr(file.size() - 4) != ".sst") {
+      continue;
+    }
+    fstream f(kDBPath + "/" + file, ios::in | ios::out | ios::binary);
+    f.seekg(10);
+    char c;
+    f.read(&c, 1);
+    c ^= 0x10;
+    f.seekp(10);
+    f.write(&c, 1);
+  }
+}
+
+void TestChecksum(bool column, TableOptions::ChecksumType checksum) {
+  cout << ">> checksum " << static_cast<int>(checksum) << ", "
+       << (column ? "column" : "row") << endl;
+  int ret = system(string("rm -rf " + kDBPath).c_str());
+
+  Options options = ChecksumOptions(column, checksum);
+  DB* db;
+  Status s = DB::Open(options, kDBPath, &db);
+  assert(s.ok());
+  WriteOptions wo;
+  for (int i = 0; i < kNumKeys; i++) {
+    s = db->Put(wo, to_string(100000 + i), ChecksumValue(options, i));
+    assert(s.ok());
+  }
+  s = db->Flush(FlushOptions());
+  assert(s.ok());
+  delete db;
+
+  // the checksum type is read from the footers, whatever the options are
+  ReadAllVerified(options);
+  ReadAllVerified(ChecksumOptions(column, TableOptions::kCRC32c));
+  ReadAllVerified(ChecksumOptions(column, TableOptions::kXXH3));
+
+  // a new factory, so the blocks are not in its block cache
+  CorruptTables();
+  s = DB::Open(ChecksumOptions(column, checksum), kDBPath, &db);
+  assert(s.ok());
+  ReadOptions ro;
+  ro.verify_checksums = true;
+  string val;
+  s = db->Get(ro, to_string(100000), &val);
+  assert(s.IsCorruption());
+  delete db;
+  cout << endl;
+}
+
+void TestHugePageAllocator() {
+  cout << ">> huge page allocator" << endl;
+  shared_ptr<MemoryAllocator> allocator = NewHugePageMemoryAllocator();
+  vector<void*> bufs;
+  for (size_t size = 1; size < (8 << 20); size = size * 3 + 1) {
+    void* p = allocator->Allocate(size);
+    assert(p != nullptr);
+    assert(reinterpret_cast<uintptr_t>(p) % sizeof(void*) == 0);
+    assert(allocator->UsableSize(p, size) >= size);
+    memset(p, 'x', size);
+    bufs.push_back(p);
+  }
+  for (auto p : bufs) {
+    allocator->Deallocate(p);
+  }
+  // recycled by size class
+  void* p = allocator->Allocate(4000);
+  void* q = allocator->Allocate(4000);
+  allocator->Deallocate(q);
+  assert(allocator->Allocate(4000) == q);
+  allocator->Deallocate(p);
+  allocator->Deallocate(q);
+  cout << endl;
+}
+
+void TestHugePageBlockCache() {
+  cout << ">> huge page block cache" << endl;
+  int ret = system(string("rm -rf " + kDBPath).c_str());
+
+  Options options;
+  options.create_if_missing = true;
+  options.splitter.reset(NewEncodingSplitter());
+  options.memtable_huge_page_size = 2 << 20;
+
+  TableFactory* table_factory = NewColumnTableFactory();
+  ColumnTableOptions* opts =
+      static_cast<ColumnTableOptions*>(table_factory->GetOptions());
+  opts->column_count = kColumn;
+  opts->block_cache =
+      NewLRUCache(8 << 20, 4, false, NewHugePageMemoryAllocator());
+  options.table_factory.reset(table_factory);
+
+  DB* db;
+  Status s = DB::Open(options, kDBPath, &db);
+  assert(s.ok());
+
+  WriteOptions wo;
+  const int kNumKeys = 10000;
+  for (int i = 0; i < kNumKeys; i++) {
+    string key = to_string(100000 + i);
+    s = db->Put(wo, key, options.splitter->Stitch({"name" + key, "2" + key,
+                                                   "city" + key}));
+    assert(s.ok());
+  }
+  s = db->Flush(FlushOptions());
+  assert(s.ok());
+
+  ReadOptions ro;
+  string val;
+  for (int i = 0; i < kNumKeys; i += 7) {
+    string key = to_string(100000 + i);
+    s = db->Get(ro, key, &val);
+    assert(s.ok());
+    assert(val == options.splitter->Stitch({"name" + key, "2" + key,
+                                            "city" + key}));
+  }
+
+  ro.columns = {3};
+  Range range(kRangeQueryMin, kRangeQueryMax);
+  list<RangeQueryKeyVal> res;
+  size_t count = 0;
+  bool next = true;
+  while (next) {
+    next = db->RangeQuery(ro, range, res, &s);
+    assert(s.ok());
+    for (auto& it : res) {
+      vector<Slice> vals(options.splitter->Split(it.value()));
+      assert(vals.size() == 1 && vals[0].ToString() == "city" + it.user_key);
+    }
+    count += res.size();
+  }
+  assert(count == kNumKeys);
+  cout << "block cache usage: " << opts->block_cache->GetUsage() << endl;
+  assert(opts->block_cache->GetUsage() > 0);
+
+  delete db;
+  cout << endl;
+}
+
+int main() {
+  TestLazyOpenLoad();
+  TestLazyOpenReopen();
+  TestLazyOpenReopen();
+  TestPartitionedIndex(false);
+  TestPartitionedIndex(true);
+  TestHashIndex(false);
+  TestHashIndex(true);
+  TestPipeSplitter();
+  TestEncodingSplitter();
+  TestRowCacheProjection(false);
+  TestRowCacheProjection(true);
+  TestRowCacheOverwrite(false);
+  TestRowCacheOverwrite(true);
+  TestChecksum(false, TableOptions::kCRC32c);
+  TestChecksum(false, TableOptions::kXXH3);
+  TestChecksum(true, TableOptions::kCRC32c);
+  TestChecksum(true, TableOptions::kXXH3);
+  TestHugePageAllocator();
+  TestHugePageBlockCache();
+  return 0;
+}
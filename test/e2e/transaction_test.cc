@@ -0,0 +1,407 @@
+// Copyright (c) 2019-present, VidarDB, Inc.  All rights reserved.
+// This source code is licensed under the BSD-style license found in the
+// LICENSE file in the root directory of this source tree. An additional grant
+// of patent rights can be found in the PATENTS file in the same directory.
+
+#include <chrono>
+#include <iostream>
+#include <map>
+#include <thread>
+
+#include "vidardb/db.h"
+#include "vidardb/options.h"
+#include "vidardb/splitter.h"
+#include "vidardb/status.h"
+#include "vidardb/table.h"
+#include "vidardb/utilities/optimistic_transaction_db.h"
+#include "vidardb/utilities/transaction.h"
+#include "vidardb/utilities/transaction_db.h"
+
+using namespace std;
+using namespace vidardb;
+
+const unsigned int kColumn = 3;
+const string kDBPath = "/tmp/vidardb_transaction_test";
+
+void TestTransactionRangeQuery(bool flush, size_t capacity,
+                               vector<uint32_t> cols) {
+  cout << ">> capacity: " << capacity << ", cols: { ";
+  for (auto& col : cols) {
+    cout << col << " ";
+  }
+  cout << "}" << endl;
+
+  int ret = system(string("rm -rf " + kDBPath).c_str());
+
+  Options options;
+  options.create_if_missing = true;
+  options.splitter.reset(NewEncodingSplitter());
+
+  TableFactory* table_factory = NewColumnTableFactory();
+  ColumnTableOptions* opts =
+      static_cast<ColumnTableOptions*>(table_factory->GetOptions());
+  opts->column_count = kColumn;
+  options.table_factory.reset(table_factory);
+
+  TransactionDB* db;
+  Status s = TransactionDB::Open(options, TransactionDBOptions(), kDBPath, &db);
+  assert(s.ok());
+
+  WriteOptions wo;
+  s = db->Put(wo, "1", options.splitter->Stitch({"chen1", "33", "hangzhou"}));
+  assert(s.ok());
+  s = db->Put(wo, "2", options.splitter->Stitch({"wang2", "32", "wuhan"}));
+  assert(s.ok());
+  s = db->Put(wo, "3", options.splitter->Stitch({"zhao3", "35", "nanjing"}));
+  assert(s.ok());
+  s = db->Put(wo, "4", options.splitter->Stitch({"liao4", "28", "beijing"}));
+  assert(s.ok());
+  s = db->Put(wo, "5", options.splitter->Stitch({"jiang5", "30", "shanghai"}));
+  assert(s.ok());
+
+  if (flush) {  // flush to disk
+    s = db->Flush(FlushOptions());
+    assert(s.ok());
+  }
+
+  TransactionOptions txn_options;
+  txn_options.set_snapshot = true;
+  Transaction* txn = db->BeginTransaction(wo, txn_options);
+  assert(txn);
+
+  // Written after the transaction snapshot, must not be visible
+  s = db->Put(wo, "6", options.splitter->Stitch({"lian6", "30", "changsha"}));
+  assert(s.ok());
+
+  // Pending changes of the transaction
+  s = txn->Put("0", options.splitter->Stitch({"sun0", "40", "xian"}));
+  assert(s.ok());
+  s = txn->Delete("2");
+  assert(s.ok());
+  s = txn->Put("3", options.splitter->Stitch({"zhao333", "35", "nanjing"}));
+  assert(s.ok());
+  s = txn->Put("4", options.splitter->Stitch({"liao444", "28", "beijing"}));
+  assert(s.ok());
+  s = txn->Put("4", options.splitter->Stitch({"liao4444", "28", "beijing"}));
+  assert(s.ok());
+
+  map<string, vector<string>> expected = {
+      {"1", {"chen1", "33", "hangzhou"}},
+      {"3", {"zhao333", "35", "nanjing"}},
+      {"4", {"liao4444", "28", "beijing"}},
+      {"5", {"jiang5", "30", "shanghai"}}};
+
+  ReadOptions ro;
+  ro.batch_capacity = capacity;
+  ro.columns = cols;
+
+  Range range("1", "6");
+
+  list<RangeQueryKeyVal> res;
+  map<string, string> all;
+  bool next = true;
+  while (next) {
+    size_t total_key_size = 0, total_val_size = 0;
+    next = txn->RangeQuery(ro, range, res, &s);
+    assert(s.ok());
+
+    cout << "{ ";
+    for (auto it : res) {
+      total_key_size += it.user_key.size();
+      total_val_size += it.user_val.size();
+      cout << it.user_key << "=[";
+      vector<Slice> vals(options.splitter->Split(it.user_val));
+      for (auto i = 0u; i < vals.size(); i++) {
+        cout << vals[i].ToString();
+        if (i < vals.size() - 1) {
+          cout << ", ";
+        }
+      }
+      cout << "] ";
+      assert(all.find(it.user_key) == all.end());  // no duplicate
+      all[it.user_key] = it.user_val;
+    }
+    cout << "} key_size=" << ro.result_key_size;
+    cout << ", val_size=" << ro.result_val_size << endl;
+
+    assert(total_key_size == ro.result_key_size);
+    assert(total_val_size == ro.result_val_size);
+  }
+
+  assert(all.size() == expected.size());
+  for (auto& kv : expected) {
+    auto it = all.find(kv.first);
+    assert(it != all.end());
+    vector<Slice> vals(options.splitter->Split(it->second));
+    size_t i = 0;
+    for (auto col : cols) {
+      if (col > 0) {
+        assert(vals[i++].ToString() == kv.second[col - 1]);
+      }
+    }
+    if (cols.empty()) {
+      assert(vals.size() == kColumn);
+      for (i = 0; i < kColumn; i++) {
+        assert(vals[i].ToString() == kv.second[i]);
+      }
+    }
+  }
+
+  delete txn;
+  delete db;
+  cout << endl;
+}
+
+TransactionDB* OpenTransactionDB() {
+  int ret = system(string("rm -rf " + kDBPath).c_str());
+
+  Options options;
+  options.create_if_missing = true;
+
+  TransactionDB* db;
+  Status s = TransactionDB::Open(options, TransactionDBOptions(), kDBPath, &db);
+  assert(s.ok());
+  return db;
+}
+
+void TestDeadlockDetect() {
+  cout << ">> deadlock detect" << endl;
+  TransactionDB* db = OpenTransactionDB();
+
+  WriteOptions wo;
+  TransactionOptions txn_options;
+  txn_options.deadlock_detect = true;
+  txn_options.lock_timeout = 5000;  // long enough to be a real deadlock
+  Transaction* txn1 = db->BeginTransaction(wo, txn_options);
+  Transaction* txn2 = db->BeginTransaction(wo, txn_options);
+
+  Status s = txn1->Put("a", "1");
+  assert(s.ok());
+  s = txn2->Put("b", "2");
+  assert(s.ok());
+
+  // txn1 waits on txn2 in the background
+  Status s1;
+  thread t([&]() { s1 = txn1->Put("b", "1"); });
+  this_thread::sleep_for(chrono::milliseconds(200));
+
+  // txn2 waiting on txn1 would close the cycle
+  auto start = chrono::steady_clock::now();
+  s = txn2->Put("a", "2");
+  auto elapsed = chrono::duration_cast<chrono::milliseconds>(
+      chrono::steady_clock::now() - start);
+  cout << s.ToString() << " in " << elapsed.count() << "ms" << endl;
+  assert(s.IsDeadlock());
+  assert(elapsed.count() < 1000);
+
+  // Releasing txn2 lets txn1 go on
+  s = txn2->Rollback();
+  assert(s.ok());
+  t.join();
+  assert(s1.ok());
+  s = txn1->Commit();
+  assert(s.ok());
+
+  delete txn1;
+  delete txn2;
+  delete db;
+  cout << endl;
+}
+
+void TestRangeLock() {
+  cout << ">> range lock" << endl;
+  TransactionDB* db = OpenTransactionDB();
+
+  WriteOptions wo;
+  TransactionOptions txn_options;
+  txn_options.lock_timeout = 0;
+  Transaction* txn1 = db->BeginTransaction(wo, txn_options);
+  Transaction* txn2 = db->BeginTransaction(wo, txn_options);
+
+  Status s = txn2->Put("a", "2");
+  assert(s.ok());
+
+  // Overlaps the point lock of txn2
+  s = txn1->GetRangeLock(Range(kRangeQueryMin, "b"));
+  cout << s.ToString() << endl;
+  assert(s.IsTimedOut());
+
+  s = txn1->GetRangeLock(Range("b", "d"));
+  assert(s.ok());
+  s = txn1->Put("c", "1");  // own range
+  assert(s.ok());
+
+  // Point locks and range locks of others inside [b, d] are refused
+  s = txn2->Put("c", "2");
+  cout << s.ToString() << endl;
+  assert(s.IsTimedOut());
+  s = txn2->Put("d", "2");
+  assert(s.IsTimedOut());
+  s = txn2->GetRangeLock(Range("d", kRangeQueryMax));
+  assert(s.IsTimedOut());
+  ReadOptions ro;
+  string value;
+  s = txn2->GetForUpdate(ro, "b", &value);
+  assert(s.IsTimedOut());
+
+  // Keys outside of it are not
+  s = txn2->Put("e", "2");
+  assert(s.ok());
+  s = txn2->GetRangeLock(Range("da", "z"));
+  assert(s.ok());
+
+  // Non-transactional writes respect range locks too
+  s = db->Put(wo, "bb", "3");
+  assert(s.IsTimedOut());
+
+  // Committing releases the range
+  s = txn1->Commit();
+  assert(s.ok());
+  s = txn2->Put("c", "2");
+  assert(s.ok());
+  s = txn2->Commit();
+  assert(s.ok());
+  s = db->Get(ro, "c", &value);
+  assert(s.ok() && value == "2");
+
+  delete txn1;
+  delete txn2;
+  delete db;
+  cout << endl;
+}
+
+OptimisticTransactionDB* OpenOptimisticTransactionDB() {
+  int ret = system(string("rm -rf " + kDBPath).c_str());
+
+  Options options;
+  options.create_if_missing = true;
+
+  OptimisticTransactionDB* db;
+  Status s = OptimisticTransactionDB::Open(options, kDBPath, &db);
+  assert(s.ok());
+  return db;
+}
+
+void TestWriteConflict() {
+  cout << ">> write conflict" << endl;
+  OptimisticTransactionDB* db = OpenOptimisticTransactionDB();
+
+  WriteOptions wo;
+  ReadOptions ro;
+  string value;
+  Status s = db->Put(wo, "a", "0");
+  assert(s.ok());
+
+  Transaction* txn = db->BeginTransaction(wo);
+  s = txn->GetForUpdate(ro, "a", &value);
+  assert(s.ok() && value == "0");
+  s = txn->Put("a", "1");
+  assert(s.ok());
+
+  // Does not block, the conflict is only found at commit time
+  s = db->Put(wo, "a", "2");
+  assert(s.ok());
+
+  s = txn->Commit();
+  cout << s.ToString() << endl;
+  assert(s.IsBusy());
+  s = db->Get(ro, "a", &value);
+  assert(s.ok() && value == "2");
+
+  delete txn;
+  delete db;
+  cout << endl;
+}
+
+void TestNoConflict() {
+  cout << ">> no conflict" << endl;
+  OptimisticTransactionDB* db = OpenOptimisticTransactionDB();
+
+  WriteOptions wo;
+  ReadOptions ro;
+  string value;
+  Transaction* txn1 = db->BeginTransaction(wo);
+  Transaction* txn2 = db->BeginTransaction(wo);
+
+  Status s = txn1->Put("a", "1");
+  assert(s.ok());
+  s = txn2->Put("b", "2");
+  assert(s.ok());
+  s = db->Put(wo, "c", "3");
+  assert(s.ok());
+
+  s = txn1->Commit();
+  assert(s.ok());
+  s = txn2->Commit();
+  assert(s.ok());
+
+  s = db->Get(ro, "a", &value);
+  assert(s.ok() && value == "1");
+  s = db->Get(ro, "b", &value);
+  assert(s.ok() && value == "2");
+
+  delete txn1;
+  delete txn2;
+  delete db;
+  cout << endl;
+}
+
+void TestSnapshotConflict() {
+  cout << ">> snapshot conflict" << endl;
+  OptimisticTransactionDB* db = OpenOptimisticTransactionDB();
+
+  WriteOptions wo;
+  OptimisticTransactionOptions txn_options;
+  txn_options.set_snapshot = true;
+  Transaction* txn1 = db->BeginTransaction(wo, txn_options);
+  Transaction* txn2 = db->BeginTransaction(wo, txn_options);
+
+  // Both write the same key, the first committer wins
+  Status s = txn1->Put("a", "1");
+  assert(s.ok());
+  s = txn2->Put("a", "2");
+  assert(s.ok());
+
+  s = txn2->Commit();
+  assert(s.ok());
+  s = txn1->Commit();
+  cout << s.ToString() << endl;
+  assert(s.IsBusy());
+
+  // A transaction can be reused after an abort
+  txn1 = db->BeginTransaction(wo, txn_options, txn1);
+  s = txn1->Put("a", "3");
+  assert(s.ok());
+  s = txn1->Commit();
+  assert(s.ok());
+
+  ReadOptions ro;
+  string value;
+  s = db->Get(ro, "a", &value);
+  assert(s.ok() && value == "3");
+
+  delete txn1;
+  delete txn2;
+  delete db;
+  cout << endl;
+}
+
+int main() {
+  TestTransactionRangeQuery(false, 0, {});
+  TestTransactionRangeQuery(false, 0, {1, 3});
+  TestTransactionRangeQuery(false, 20, {2});
+  TestTransactionRangeQuery(false, 50, {1, 2, 3});
+
+  TestTransactionRangeQuery(true, 0, {});
+  TestTransactionRangeQuery(true, 0, {1, 3});
+  TestTransactionRangeQuery(true, 20, {2});
+  TestTransactionRangeQuery(true, 50, {1, 2, 3});
+
+  TestDeadlockDetect();
+  TestRangeLock();
+
+  TestWriteConflict();
+  TestNoConflict();
+  TestSnapshotConflict();
+  return 0;
+}
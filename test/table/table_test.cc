@@ -1979,6 +1979,28 @@ TEST_F(HarnessTest, FooterTests) {
     ASSERT_EQ(decoded_footer.metaindex_handle().size(), meta_index.size());
     ASSERT_EQ(decoded_footer.index_handle().offset(), index.offset());
     ASSERT_EQ(decoded_footer.index_handle().size(), index.size());
+    ASSERT_EQ(decoded_footer.checksum(), TableOptions::kCRC32c);
+  }
+  {
+    // checksum type in the padding
+    std::string encoded;
+    Footer footer(kBlockBasedTableMagicNumber);
+    BlockHandle meta_index(10, 5), index(20, 15);
+    footer.set_metaindex_handle(meta_index);
+    footer.set_index_handle(index);
+    footer.set_checksum(TableOptions::kXXH3);
+    footer.EncodeTo(&encoded);
+    Footer decoded_footer;
+    Slice encoded_slice(encoded);
+    ASSERT_OK(decoded_footer.DecodeFrom(&encoded_slice));
+    ASSERT_EQ(decoded_footer.table_magic_number(), kBlockBasedTableMagicNumber);
+    ASSERT_EQ(decoded_footer.index_handle().offset(), index.offset());
+    ASSERT_EQ(decoded_footer.checksum(), TableOptions::kXXH3);
+
+    encoded[Footer::kEncodedLength - kMagicNumberLengthByte - 1] = 0x7f;
+    Footer bad_footer;
+    encoded_slice = Slice(encoded);
+    ASSERT_TRUE(bad_footer.DecodeFrom(&encoded_slice).IsCorruption());
   }
 }
 
@@ -296,8 +296,8 @@ TEST_F(CacheTest, EvictionPolicyRef) {
   Insert(302, 103);
   Insert(303, 104);
 
-  // Insert entries much more than Cache capacity
-  for (int i = 0; i < kCacheSize + 100; i++) {
+  // Insert entries much more than Cache capacity, enough to fill every shard
+  for (int i = 0; i < 2 * kCacheSize; i++) {
     Insert(1000 + i, 2000 + i);
   }
 
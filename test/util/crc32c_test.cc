@@ -61,6 +61,27 @@ TEST(CRC, Extend) {
             Extend(Value("hello ", 6), "world", 5));
 }
 
+TEST(CRC, LongBuffers) {
+  // Long enough for the 3-way streams, from every alignment
+  std::string buf(3 * 1024 * 3 + 777, '\0');
+  uint32_t x = 0x12345678;
+  for (size_t i = 0; i < buf.size(); i++) {
+    x = x * 1103515245 + 12345;
+    buf[i] = static_cast<char>(x >> 16);
+  }
+  for (size_t offset = 0; offset < 8; offset++) {
+    for (size_t n : {0, 1, 7, 8, 255, 256, 767, 768, 769, 3072, 3073, 9000,
+                     9216}) {
+      if (offset + n > buf.size()) {
+        continue;
+      }
+      const char* data = buf.data() + offset;
+      ASSERT_EQ(ExtendPortable(0, data, n), Value(data, n));
+      ASSERT_EQ(ExtendPortable(0x1234, data, n), Extend(0x1234, data, n));
+    }
+  }
+}
+
 TEST(CRC, Mask) {
   uint32_t crc = Value("foo", 3);
   ASSERT_NE(crc, Mask(crc));
@@ -0,0 +1,63 @@
+//  Copyright (c) 2020-present, VidarDB, Inc.  All rights reserved.
+//  This source code is licensed under the BSD-style license found in the
+//  LICENSE file in the root directory of this source tree. An additional grant
+//  of patent rights can be found in the PATENTS file in the same directory.
+
+#include "util/xxh3.h"
+
+#include <string>
+
+#include "util/testharness.h"
+
+namespace vidardb {
+
+class XXH3 { };
+
+TEST(XXH3, StandardResults) {
+  // The sanity buffer of xxHash, the hashes of XXH3_64bits() with seed 0.
+  // They can be regenerated with the python xxhash package (xxHash 0.8.x):
+  //   buf, gen = bytearray(), 2654435761
+  //   for _ in range(5000):
+  //       buf.append(gen >> 56); gen = gen * 11400714785074694797 % 2**64
+  //   print(hex(xxhash.xxh3_64_intdigest(bytes(buf[:n]))))
+  std::string buf(5000, '\0');
+  uint64_t byte_gen = 2654435761ULL;
+  for (size_t i = 0; i < buf.size(); i++) {
+    buf[i] = static_cast<char>(byte_gen >> 56);
+    byte_gen *= 11400714785074694797ULL;
+  }
+
+  const std::pair<size_t, uint64_t> expected[] = {
+      {0, 0x2D06800538D394C2ULL},    {1, 0xC44BDFF4074EECDBULL},
+      {3, 0x54247382A8D6B94DULL},    {4, 0xE5DC74BC51848A51ULL},
+      {8, 0x24CCC9ACAA9F65E4ULL},    {9, 0x14D5001C15DD3F2BULL},
+      {16, 0x981B17D36C7498C9ULL},   {17, 0x796F5ACD3A60F862ULL},
+      {128, 0xFCFF24126754D861ULL},  {129, 0x98F1B0A679A2CA29ULL},
+      {240, 0x81C3C2B67F568CCFULL},  {241, 0xC5A639ECD2030E5EULL},
+      {1024, 0xDD85C9B5C1109C5CULL}, {1025, 0xD870C0FA13211C6AULL},
+      {4096, 0xE91206429D1F48F9ULL}, {4999, 0xF92A85A6EA06D646ULL},
+  };
+  for (const auto& e : expected) {
+    ASSERT_EQ(e.second, XXH3Hash64(buf.data(), e.first));
+    ASSERT_EQ(static_cast<uint32_t>(e.second),
+              XXH3Hash32(buf.data(), e.first));
+  }
+}
+
+TEST(XXH3, Unaligned) {
+  std::string buf(2048 + 8, 'x');
+  for (size_t i = 0; i < buf.size(); i++) {
+    buf[i] = static_cast<char>(i * 7);
+  }
+  for (size_t n : {5, 15, 100, 200, 300, 2048}) {
+    std::string copy = buf.substr(3, n);
+    ASSERT_EQ(XXH3Hash64(copy.data(), n), XXH3Hash64(buf.data() + 3, n));
+  }
+}
+
+}  // namespace vidardb
+
+int main(int argc, char** argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
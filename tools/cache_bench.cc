@@ -17,11 +17,13 @@ int main() {
 #include <inttypes.h>
 #include <sys/types.h>
 #include <stdio.h>
+#include <string.h>
 #include <gflags/gflags.h>
 
 #include "vidardb/db.h"
 #include "vidardb/cache.h"
 #include "vidardb/env.h"
+#include "vidardb/memory_allocator.h"
 #include "port/port.h"
 #include "util/mutexlock.h"
 #include "util/random.h"
@@ -46,12 +48,41 @@ DEFINE_int32(lookup_percent, 50,
 DEFINE_int32(erase_percent, 10,
              "Ratio of erase to total workload (expressed as a percentage)");
 
+DEFINE_int32(value_bytes, 10,
+             "Size of each cached value, which is charged 1 as before.");
+DEFINE_bool(read_value, false,
+            "Read the whole value on every lookup hit, as a block iterator "
+            "would.");
+DEFINE_bool(use_huge_page_allocator, false,
+            "Allocate the cached values from huge pages.");
+DEFINE_int64(huge_page_size, 2 * KB * KB,
+             "Huge page size of the huge page allocator.");
+DEFINE_bool(numa_interleave, false,
+            "Interleave the huge page allocator memory across NUMA nodes, "
+            "needs a library built with NUMA support.");
+
 namespace vidardb {
 
 class CacheBench;
 namespace {
+// allocator of the cached values, nullptr for the heap
+MemoryAllocator* value_allocator = nullptr;
+
+char* NewValue() {
+  char* value = value_allocator != nullptr
+                    ? reinterpret_cast<char*>(
+                          value_allocator->Allocate(FLAGS_value_bytes))
+                    : new char[FLAGS_value_bytes];
+  memset(value, 'v', FLAGS_value_bytes);
+  return value;
+}
+
 void deleter(const Slice& key, void* value) {
-    delete reinterpret_cast<char *>(value);
+  if (value_allocator != nullptr) {
+    value_allocator->Deallocate(value);
+  } else {
+    delete[] reinterpret_cast<char*>(value);
+  }
 }
 
 // State shared by all concurrent executions of the same benchmark.
@@ -121,17 +152,25 @@ struct ThreadState {
   uint32_t tid;
   Random rnd;
   SharedState* shared;
+  uint64_t checksum;  // keeps the value reads
 
   ThreadState(uint32_t index, SharedState* _shared)
-      : tid(index), rnd(1000 + index), shared(_shared) {}
+      : tid(index), rnd(1000 + index), shared(_shared), checksum(0) {}
 };
 }  // namespace
 
 class CacheBench {
  public:
-  CacheBench() :
-      cache_(NewLRUCache(FLAGS_cache_size, FLAGS_num_shard_bits)),
-      num_threads_(FLAGS_threads) {}
+  CacheBench() : num_threads_(FLAGS_threads) {
+    std::shared_ptr<MemoryAllocator> allocator;
+    if (FLAGS_use_huge_page_allocator) {
+      allocator = NewHugePageMemoryAllocator(FLAGS_huge_page_size,
+                                             FLAGS_numa_interleave);
+    }
+    cache_ = NewLRUCache(FLAGS_cache_size, FLAGS_num_shard_bits, false,
+                         allocator);
+    value_allocator = cache_->memory_allocator();
+  }
 
   ~CacheBench() {}
 
@@ -142,7 +181,7 @@ class CacheBench {
       // Cast uint64* to be char*, data would be copied to cache
       Slice key(reinterpret_cast<char*>(&rand_key), 8);
       // do insert
-      cache_->Insert(key, new char[10], 1, &deleter);
+      cache_->Insert(key, NewValue(), 1, &deleter);
     }
   }
 
@@ -220,12 +259,19 @@ class CacheBench {
       int32_t prob_op = thread->rnd.Uniform(100);
       if (prob_op >= 0 && prob_op < FLAGS_insert_percent) {
         // do insert
-        cache_->Insert(key, new char[10], 1, &deleter);
+        cache_->Insert(key, NewValue(), 1, &deleter);
       } else if (prob_op -= FLAGS_insert_percent &&
                  prob_op < FLAGS_lookup_percent) {
         // do lookup
         auto handle = cache_->Lookup(key);
         if (handle) {
+          if (FLAGS_read_value) {
+            const char* value =
+                reinterpret_cast<const char*>(cache_->Value(handle));
+            for (int32_t j = 0; j < FLAGS_value_bytes; j++) {
+              thread->checksum += value[j];
+            }
+          }
           cache_->Release(handle);
         }
       } else if (prob_op -= FLAGS_lookup_percent &&
@@ -247,6 +293,10 @@ class CacheBench {
     printf("Insert percentage   : %d%%\n", FLAGS_insert_percent);
     printf("Lookup percentage   : %d%%\n", FLAGS_lookup_percent);
     printf("Erase percentage    : %d%%\n", FLAGS_erase_percent);
+    printf("Value bytes         : %d\n", FLAGS_value_bytes);
+    printf("Read value          : %d\n", FLAGS_read_value);
+    printf("Value allocator     : %s\n",
+           value_allocator ? value_allocator->Name() : "heap");
     printf("----------------------------\n");
   }
 };
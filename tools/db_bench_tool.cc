@@ -46,6 +46,9 @@
 #include "vidardb/perf_context.h"
 #include "vidardb/slice.h"
 #include "vidardb/write_batch.h"
+#include "vidardb/utilities/optimistic_transaction_db.h"
+#include "vidardb/utilities/transaction.h"
+#include "vidardb/utilities/transaction_db.h"
 #include "util/compression.h"
 #include "util/crc32c.h"
 #include "util/histogram.h"
@@ -1006,6 +1009,9 @@ static void AppendWithSpace(std::string* str, Slice msg) {
 struct DBWithColumnFamilies {
   std::vector<ColumnFamilyHandle*> cfh;
   DB* db;
+#ifndef VIDARDB_LITE
+  OptimisticTransactionDB* opt_txn_db;
+#endif  // VIDARDB_LITE
   std::atomic<size_t> num_created;  // Need to be updated after all the
                                     // new entries in cfh are set.
   size_t num_hot;  // Number of column families to be queried at each moment.
@@ -1015,6 +1021,9 @@ struct DBWithColumnFamilies {
 
   DBWithColumnFamilies()
       : db(nullptr)
+#ifndef VIDARDB_LITE
+      , opt_txn_db(nullptr)
+#endif  // VIDARDB_LITE
   {
     cfh.clear();
     num_created = 0;
@@ -1024,6 +1033,9 @@ struct DBWithColumnFamilies {
   DBWithColumnFamilies(const DBWithColumnFamilies& other)
       : cfh(other.cfh),
         db(other.db),
+#ifndef VIDARDB_LITE
+        opt_txn_db(other.opt_txn_db),
+#endif  // VIDARDB_LITE
         num_created(other.num_created.load()),
         num_hot(other.num_hot) {}
 
@@ -1031,7 +1043,16 @@ struct DBWithColumnFamilies {
     std::for_each(cfh.begin(), cfh.end(),
                   [](ColumnFamilyHandle* cfhi) { delete cfhi; });
     cfh.clear();
+#ifndef VIDARDB_LITE
+    if (opt_txn_db) {
+      delete opt_txn_db;
+      opt_txn_db = nullptr;
+    } else {
+      delete db;
+    }
+#else
     delete db;
+#endif  // VIDARDB_LITE
     db = nullptr;
   }
 
@@ -1964,6 +1985,11 @@ class Benchmark {
       } else if (name == "randomreplacekeys") {
         fresh_db = true;
         method = &Benchmark::RandomReplaceKeys;
+#ifndef VIDARDB_LITE
+      } else if (name == "randomtransaction") {
+        method = &Benchmark::RandomTransaction;
+        post_process_method = &Benchmark::RandomTransactionVerify;
+#endif  // VIDARDB_LITE
       } else if (name == "stats") {
         PrintStats("vidardb.stats");
       } else if (name == "levelstats") {
@@ -2444,6 +2470,18 @@ class Benchmark {
 #ifndef VIDARDB_LITE
     } else if (FLAGS_readonly) {
       s = DB::OpenForReadOnly(options, db_name, &db->db);
+    } else if (FLAGS_optimistic_transaction_db) {
+      s = OptimisticTransactionDB::Open(options, db_name, &db->opt_txn_db);
+      if (s.ok()) {
+        db->db = db->opt_txn_db->GetBaseDB();
+      }
+    } else if (FLAGS_transaction_db) {
+      TransactionDB* ptr;
+      TransactionDBOptions txn_db_options;
+      s = TransactionDB::Open(options, txn_db_options, db_name, &ptr);
+      if (s.ok()) {
+        db->db = ptr;
+      }
 #endif  // VIDARDB_LITE
     } else {
       s = DB::Open(options, db_name, &db->db);
@@ -3364,6 +3402,129 @@ class Benchmark {
     thread->stats.AddMessage(msg);
   }
 
+#ifndef VIDARDB_LITE
+  // Each transaction adds the same random amount to one random key in each of
+  // FLAGS_transaction_sets key sets, so every set keeps the same total as long
+  // as transactions are atomic and isolated. Run with --transaction_db for
+  // pessimistic locking or --optimistic_transaction_db for validation at
+  // commit time.
+  void RandomTransaction(ThreadState* thread) {
+    ReadOptions options(FLAGS_verify_checksum, true);
+    Duration duration(FLAGS_duration, readwrites_);
+    uint64_t transactions_done = 0;
+    uint64_t transactions_aborted = 0;
+    std::string value;
+
+    if (!FLAGS_transaction_db && !FLAGS_optimistic_transaction_db) {
+      fprintf(stderr, "randomtransaction requires --transaction_db or "
+                      "--optimistic_transaction_db\n");
+      exit(1);
+    }
+    if (FLAGS_transaction_sets == 0 || FLAGS_transaction_sets > 9999) {
+      fprintf(stderr, "invalid value for transaction_sets\n");
+      exit(1);
+    }
+    if (FLAGS_num_multi_db > 1) {
+      fprintf(stderr, "randomtransaction does not support num_multi_db > 1\n");
+      exit(1);
+    }
+
+    TransactionOptions txn_options;
+    txn_options.lock_timeout = FLAGS_transaction_lock_timeout;
+    txn_options.set_snapshot = FLAGS_transaction_set_snapshot;
+    OptimisticTransactionOptions opt_txn_options;
+    opt_txn_options.set_snapshot = FLAGS_transaction_set_snapshot;
+
+    Transaction* txn = nullptr;
+    while (!duration.Done(1)) {
+      if (FLAGS_optimistic_transaction_db) {
+        txn = db_.opt_txn_db->BeginTransaction(write_options_,
+                                               opt_txn_options, txn);
+      } else {
+        TransactionDB* txn_db = static_cast<TransactionDB*>(db_.db);
+        txn = txn_db->BeginTransaction(write_options_, txn_options, txn);
+      }
+
+      uint64_t increment = thread->rand.Uniform(100) + 1;
+      Status s;
+      for (uint64_t set_i = 0; s.ok() && set_i < FLAGS_transaction_sets;
+           set_i++) {
+        char key[32];
+        snprintf(key, sizeof(key), "%04" PRIu64 "%016" PRIu64, set_i,
+                 thread->rand.Next() % FLAGS_num);
+        s = txn->GetForUpdate(options, key, &value);
+        uint64_t counter = 0;
+        if (s.ok()) {
+          counter = std::stoull(value);
+        } else if (s.IsNotFound()) {
+          s = Status::OK();
+        }
+        if (s.ok() && FLAGS_transaction_sleep > 0) {
+          FLAGS_env->SleepForMicroseconds(
+              static_cast<int>(thread->rand.Uniform(FLAGS_transaction_sleep)));
+        }
+        if (s.ok()) {
+          s = txn->Put(key, ToString(counter + increment));
+        }
+      }
+      if (s.ok()) {
+        s = txn->Commit();
+      }
+
+      if (s.ok()) {
+        transactions_done++;
+      } else if (s.IsBusy() || s.IsTimedOut() || s.IsTryAgain() ||
+                 s.IsDeadlock()) {
+        // Conflict detected at lock time or at commit time
+        txn->Rollback();
+        transactions_aborted++;
+      } else {
+        fprintf(stderr, "Transaction failed: %s\n", s.ToString().c_str());
+        exit(1);
+      }
+
+      thread->stats.FinishedOps(nullptr, db_.db, 1, kOthers);
+    }
+    delete txn;
+
+    char msg[100];
+    snprintf(msg, sizeof(msg),
+             "( transactions:%" PRIu64 " aborts:%" PRIu64 ")",
+             transactions_done, transactions_aborted);
+    thread->stats.AddMessage(msg);
+  }
+
+  // Checks that all the key sets written by RandomTransaction() add up to the
+  // same total.
+  void RandomTransactionVerify() {
+    ReadOptions options;
+    std::unique_ptr<Iterator> iter(db_.db->NewIterator(options));
+    uint64_t prev_total = 0;
+    for (uint64_t set_i = 0; set_i < FLAGS_transaction_sets; set_i++) {
+      char prefix[8];
+      snprintf(prefix, sizeof(prefix), "%04" PRIu64, set_i);
+      uint64_t total = 0;
+      for (iter->Seek(prefix); iter->Valid() && iter->key().starts_with(prefix);
+           iter->Next()) {
+        total += std::stoull(iter->value().ToString());
+      }
+      if (!iter->status().ok()) {
+        fprintf(stderr, "RandomTransactionVerify failed: %s\n",
+                iter->status().ToString().c_str());
+        exit(1);
+      }
+      if (set_i > 0 && total != prev_total) {
+        fprintf(stderr, "RandomTransactionVerify failed: set %" PRIu64
+                " sums to %" PRIu64 ", expected %" PRIu64 "\n",
+                set_i, total, prev_total);
+        exit(1);
+      }
+      prev_total = total;
+    }
+    fprintf(stdout, "RandomTransactionVerify Success.\n");
+  }
+#endif  // VIDARDB_LITE
+
   void Compact(ThreadState* thread) {
     DB* db = SelectDB(thread);
     db->CompactRange(CompactRangeOptions(), nullptr, nullptr);
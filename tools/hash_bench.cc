@@ -0,0 +1,153 @@
+//  Copyright (c) 2020-present, VidarDB, Inc.  All rights reserved.
+//  This source code is licensed under the BSD-style license found in the
+//  LICENSE file in the root directory of this source tree. An additional grant
+//  of patent rights can be found in the PATENTS file in the same directory.
+
+#ifndef __STDC_FORMAT_MACROS
+#define __STDC_FORMAT_MACROS
+#endif
+#ifndef GFLAGS
+#include <cstdio>
+int main() {
+  fprintf(stderr, "Please install gflags to run vidardb tools\n");
+  return 1;
+}
+#else
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <gflags/gflags.h>
+
+#include <string>
+#include <vector>
+
+#include "vidardb/env.h"
+#include "port/port.h"
+#include "util/crc32c.h"
+#include "util/hash.h"
+#include "util/random.h"
+#include "util/xxh3.h"
+
+using GFLAGS::ParseCommandLineFlags;
+
+DEFINE_int32(block_size, 4096,
+             "The bytes of the blocks checksummed, like the table blocks.");
+DEFINE_int32(num_blocks, 4096, "Number of distinct blocks.");
+DEFINE_int32(key_size, 16,
+             "The bytes of the keys hashed, like the block cache keys.");
+DEFINE_int32(num_keys, 1000000, "Number of distinct keys.");
+DEFINE_int32(iterations, 20, "Number of passes over all the data.");
+DEFINE_int32(seed, 301, "Seed of the random generator.");
+
+namespace vidardb {
+namespace {
+class HashBench {
+ public:
+  HashBench() : rnd_(FLAGS_seed) {
+    // one buffer, the blocks start at every alignment
+    blocks_.resize(static_cast<size_t>(FLAGS_num_blocks) * FLAGS_block_size +
+                   FLAGS_num_blocks);
+    for (auto& c : blocks_) {
+      c = static_cast<char>(rnd_.Uniform(256));
+    }
+    keys_.resize(static_cast<size_t>(FLAGS_num_keys) * FLAGS_key_size);
+    for (auto& c : keys_) {
+      c = static_cast<char>(rnd_.Uniform(256));
+    }
+  }
+
+  void Run() {
+    PrintHeader();
+    MeasureBlocks("crc32c_portable", [](const char* data, size_t n) {
+      return crc32c::ExtendPortable(0, data, n);
+    });
+    MeasureBlocks("crc32c", [](const char* data, size_t n) {
+      return crc32c::Value(data, n);
+    });
+    MeasureBlocks("xxh3", [](const char* data, size_t n) {
+      return XXH3Hash32(data, n);
+    });
+    MeasureKeys("hash", [](const char* data, size_t n) {
+      return Hash(data, n, 0);
+    });
+    MeasureKeys("xxh3_key", [](const char* data, size_t n) {
+      return XXH3Hash32(data, n);
+    });
+  }
+
+ private:
+  template <typename F>
+  void MeasureBlocks(const char* name, F f) {
+    size_t block_size = static_cast<size_t>(FLAGS_block_size);
+    Measure(name, static_cast<uint64_t>(FLAGS_num_blocks), block_size,
+            [this, &f, block_size]() {
+              uint32_t check = 0;
+              for (int i = 0; i < FLAGS_num_blocks; i++) {
+                check ^= f(blocks_.data() + i * (block_size + 1), block_size);
+              }
+              return check;
+            });
+  }
+
+  template <typename F>
+  void MeasureKeys(const char* name, F f) {
+    size_t key_size = static_cast<size_t>(FLAGS_key_size);
+    Measure(name, static_cast<uint64_t>(FLAGS_num_keys), key_size,
+            [this, &f, key_size]() {
+              uint32_t check = 0;
+              for (int i = 0; i < FLAGS_num_keys; i++) {
+                check ^= f(keys_.data() + i * key_size, key_size);
+              }
+              return check;
+            });
+  }
+
+  template <typename F>
+  void Measure(const char* name, uint64_t num, size_t size, F f) {
+    Env* env = Env::Default();
+    uint32_t check = 0;
+    uint64_t start = env->NowMicros();
+    for (int i = 0; i < FLAGS_iterations; i++) {
+      check += f();
+    }
+    uint64_t elapsed = env->NowMicros() - start;
+    double secs = elapsed / 1000000.0;
+    uint64_t ops = num * FLAGS_iterations;
+    fprintf(stdout, "%-16s: %8.3f ns/op %10.1f MB/s (%08x)\n", name,
+            elapsed * 1000.0 / ops, ops * size / 1048576.0 / secs, check);
+  }
+
+  void PrintHeader() const {
+    printf("Fast CRC32 supported  : %d\n", crc32c::IsFastCrc32Supported());
+    printf("3-way CRC32 supported : %d\n",
+           crc32c::IsThreeWayCrc32Supported());
+    printf("Block size            : %d\n", FLAGS_block_size);
+    printf("Blocks                : %d\n", FLAGS_num_blocks);
+    printf("Key size              : %d\n", FLAGS_key_size);
+    printf("Keys                  : %d\n", FLAGS_num_keys);
+    printf("Iterations            : %d\n", FLAGS_iterations);
+    printf("----------------------------\n");
+  }
+
+  Random rnd_;
+  std::string blocks_;
+  std::string keys_;
+};
+}  // anonymous namespace
+}  // namespace vidardb
+
+int main(int argc, char** argv) {
+  ParseCommandLineFlags(&argc, &argv, true);
+
+  if (FLAGS_block_size <= 0 || FLAGS_num_blocks <= 0 || FLAGS_key_size <= 0 ||
+      FLAGS_num_keys <= 0 || FLAGS_iterations <= 0) {
+    fprintf(stderr, "all the sizes and counts must be positive\n");
+    exit(1);
+  }
+
+  vidardb::HashBench bench;
+  bench.Run();
+  return 0;
+}
+
+#endif  // GFLAGS
@@ -34,7 +34,9 @@ int main() {
 #include "vidardb/comparator.h"
 #include "vidardb/memtablerep.h"
 #include "vidardb/options.h"
+#include "vidardb/slice_transform.h"
 #include "util/arena.h"
+#include "util/concurrent_arena.h"
 #include "util/mutexlock.h"
 #include "util/stop_watch.h"
 #include "util/testutil.h"
@@ -47,6 +49,8 @@ DEFINE_string(benchmarks, "fillrandom",
               "Comma-separated list of benchmarks to run. Options:\n"
               "\tfillrandom             -- write N random values\n"
               "\tfillseq                -- write N values in sequential order\n"
+              "\tfillconcurrent         -- N threads write unique random values\n"
+              "\t                          concurrently, then sort them once\n"
               "\treadrandom             -- read N values in random order\n"
               "\treadseq                -- scan the DB\n"
               "\treadwrite              -- 1 thread writes while N - 1 threads "
@@ -61,6 +65,7 @@ DEFINE_string(memtablerep, "skiplist",
               "  more details. Options:\n"
               "\tskiplist            -- backed by a skiplist\n"
               "\tvector              -- backed by an std::vector\n"
+              "\tbulkload            -- backed by per-thread std::vectors\n"
               "\thashskiplist        -- backed by a hash skip list\n"
               "\thashlinklist        -- backed by a hash linked list\n"
               "\tcuckoo              -- backed by a cuckoo hash table");
@@ -77,9 +82,10 @@ DEFINE_int32(
     hashskiplist_branching_factor, 4,
     "branching_factor parameter to pass into NewHashSkiplistRepFactory");
 
-DEFINE_int32(
-    huge_page_tlb_size, 0,
-    "huge_page_tlb_size parameter to pass into NewHashLinkListRepFactory");
+DEFINE_int32(huge_page_tlb_size, 0,
+             "Huge page size of the arena blocks the entries are allocated "
+             "from, 0 to allocate them from the heap. Needs reserved huge "
+             "pages, e.g. sysctl -w vm.nr_hugepages=512");
 
 DEFINE_int32(bucket_entries_logging_threshold, 4096,
              "bucket_entries_logging_threshold parameter to pass into "
@@ -127,6 +133,10 @@ DEFINE_int32(prefix_length, 8,
 DEFINE_int64(vectorrep_count, 0,
              "Number of entries to reserve on VectorRep initialization");
 
+/* BulkLoadRep settings */
+DEFINE_int32(bulkload_sort_threads, 4,
+             "Max number of threads to sort a BulkLoadRep with");
+
 DEFINE_int64(seed, 0,
              "Seed base for random number generators. "
              "When 0 it is deterministic.");
@@ -244,7 +254,9 @@ class FillBenchmarkThread : public BenchmarkThread {
       : BenchmarkThread(table, key_gen, bytes_written, bytes_read, sequence,
                         num_ops, read_hits) {}
 
-  void FillOne() {
+  void FillOne() { FillOne(key_gen_->Next(), ++(*sequence_), false); }
+
+  void FillOne(uint64_t key, uint64_t sequence, bool concurrently) {
     char* buf = nullptr;
     auto internal_key_size = 16;
     auto encoded_len =
@@ -252,16 +264,19 @@ class FillBenchmarkThread : public BenchmarkThread {
     KeyHandle handle = table_->Allocate(encoded_len, &buf);
     assert(buf != nullptr);
     char* p = EncodeVarint32(buf, internal_key_size);
-    auto key = key_gen_->Next();
     EncodeFixed64(p, key);
     p += 8;
-    EncodeFixed64(p, ++(*sequence_));
+    EncodeFixed64(p, sequence);
     p += 8;
     Slice bytes = generator_.Generate(FLAGS_item_size);
     memcpy(p, bytes.data(), FLAGS_item_size);
     p += FLAGS_item_size;
     assert(p == buf + encoded_len);
-    table_->Insert(handle);
+    if (concurrently) {
+      table_->InsertConcurrently(handle);
+    } else {
+      table_->Insert(handle);
+    }
     *bytes_written_ += encoded_len;
   }
 
@@ -296,6 +311,28 @@ class ConcurrentFillBenchmarkThread : public FillBenchmarkThread {
   std::atomic_int* threads_done_;
 };
 
+// Each writer owns the keys equal to its id modulo the number of writers, so
+// writers never insert the same key.
+class MultiWriterFillBenchmarkThread : public FillBenchmarkThread {
+ public:
+  MultiWriterFillBenchmarkThread(MemTableRep* table, KeyGenerator* key_gen,
+                                 uint64_t* bytes_written, uint64_t num_ops,
+                                 uint32_t thread_id)
+      : FillBenchmarkThread(table, key_gen, bytes_written, nullptr, nullptr,
+                            num_ops, nullptr),
+        thread_id_(thread_id) {}
+
+  void operator()() override {
+    for (unsigned int i = 0; i < num_ops_; ++i) {
+      uint64_t key = key_gen_->Next() * FLAGS_num_threads + thread_id_;
+      FillOne(key, key + 1, true);
+    }
+  }
+
+ private:
+  uint32_t thread_id_;
+};
+
 class ReadBenchmarkThread : public BenchmarkThread {
  public:
   ReadBenchmarkThread(MemTableRep* table, KeyGenerator* key_gen,
@@ -485,6 +522,52 @@ class FillBenchmark : public Benchmark {
   }
 };
 
+class MultiWriterFillBenchmark : public Benchmark {
+ public:
+  explicit MultiWriterFillBenchmark(MemTableRep* table, Random64* rng,
+                                    uint64_t* sequence)
+      : Benchmark(table, nullptr, sequence, FLAGS_num_threads) {
+    num_write_ops_per_thread_ = FLAGS_num_operations / FLAGS_num_threads;
+    for (int i = 0; i < FLAGS_num_threads; ++i) {
+      key_gens_.emplace_back(
+          new KeyGenerator(rng, UNIQUE_RANDOM, num_write_ops_per_thread_));
+    }
+  }
+
+  void Run() override {
+    Benchmark::Run();
+
+    // The memtable becomes immutable and the first reader, i.e. the flush,
+    // pays for the sort.
+    StopWatchNano timer(Env::Default(), true);
+    table_->MarkReadOnly();
+    std::unique_ptr<MemTableRep::Iterator> iter(table_->GetIterator());
+    iter->SeekToFirst();
+    std::cout << "Sort after MarkReadOnly: " << timer.ElapsedNanos() / 1000
+              << " us" << std::endl;
+  }
+
+  void RunThreads(std::vector<std::thread>* threads, uint64_t* bytes_written,
+                  uint64_t* bytes_read, bool write,
+                  uint64_t* read_hits) override {
+    std::vector<uint64_t> thread_bytes(FLAGS_num_threads, 0);
+    for (int i = 0; i < FLAGS_num_threads; ++i) {
+      threads->emplace_back(MultiWriterFillBenchmarkThread(
+          table_, key_gens_[i].get(), &thread_bytes[i],
+          num_write_ops_per_thread_, i));
+    }
+    for (auto& thread : *threads) {
+      thread.join();
+    }
+    for (auto bytes : thread_bytes) {
+      *bytes_written += bytes;
+    }
+  }
+
+ private:
+  std::vector<std::unique_ptr<KeyGenerator>> key_gens_;
+};
+
 class ReadBenchmark : public Benchmark {
  public:
   explicit ReadBenchmark(MemTableRep* table, KeyGenerator* key_gen,
@@ -587,8 +670,21 @@ int main(int argc, char** argv) {
   vidardb::Options options;
 
   std::unique_ptr<vidardb::MemTableRepFactory> factory;
+  std::unique_ptr<const vidardb::SliceTransform> transform;
   if (FLAGS_memtablerep == "skiplist") {
     factory.reset(new vidardb::SkipListFactory);
+#ifndef VIDARDB_LITE
+  } else if (FLAGS_memtablerep == "vector") {
+    factory.reset(new vidardb::VectorRepFactory(FLAGS_vectorrep_count));
+  } else if (FLAGS_memtablerep == "hashskiplist") {
+    factory.reset(vidardb::NewHashSkipListRepFactory(
+        FLAGS_bucket_count, FLAGS_hashskiplist_height,
+        FLAGS_hashskiplist_branching_factor));
+    transform.reset(vidardb::NewFixedPrefixTransform(FLAGS_prefix_length));
+  } else if (FLAGS_memtablerep == "bulkload") {
+    factory.reset(new vidardb::BulkLoadRepFactory(
+        FLAGS_vectorrep_count, FLAGS_bulkload_sort_threads));
+#endif  // VIDARDB_LITE
   } else {
     fprintf(stdout, "Unknown memtablerep: %s\n", FLAGS_memtablerep.c_str());
     exit(1);
@@ -597,13 +693,16 @@ int main(int argc, char** argv) {
   vidardb::InternalKeyComparator internal_key_comp(
       vidardb::BytewiseComparator());
   vidardb::MemTable::KeyComparator key_comp(internal_key_comp);
-  vidardb::Arena arena;
+  // Concurrent, as fillconcurrent allocates from several threads
+  vidardb::ConcurrentArena arena(vidardb::Arena::kMinBlockSize,
+                                 FLAGS_huge_page_tlb_size);
   vidardb::WriteBuffer wb(FLAGS_write_buffer_size);
   vidardb::MemTableAllocator memtable_allocator(&arena, &wb);
   uint64_t sequence;
   auto createMemtableRep = [&] {
     sequence = 0;
     return factory->CreateMemTableRep(key_comp, &memtable_allocator,
+                                      transform.get(),
                                       options.info_log.get());
   };
   std::unique_ptr<vidardb::MemTableRep> memtablerep;
@@ -633,6 +732,15 @@ int main(int argc, char** argv) {
                                               FLAGS_num_operations));
       benchmark.reset(new vidardb::FillBenchmark(memtablerep.get(),
                                                  key_gen.get(), &sequence));
+    } else if (name == vidardb::Slice("fillconcurrent")) {
+      if (!factory->IsInsertConcurrentlySupported()) {
+        fprintf(stdout, "%s does not support concurrent inserts\n",
+                factory->Name());
+        exit(1);
+      }
+      memtablerep.reset(createMemtableRep());
+      benchmark.reset(new vidardb::MultiWriterFillBenchmark(
+          memtablerep.get(), &rng, &sequence));
     } else if (name == vidardb::Slice("readrandom")) {
       key_gen.reset(new vidardb::KeyGenerator(&rng, vidardb::RANDOM,
                                               FLAGS_num_operations));
@@ -0,0 +1,170 @@
+//  Copyright (c) 2020-present, VidarDB, Inc.  All rights reserved.
+//  This source code is licensed under the BSD-style license found in the
+//  LICENSE file in the root directory of this source tree. An additional grant
+//  of patent rights can be found in the PATENTS file in the same directory.
+
+#ifndef __STDC_FORMAT_MACROS
+#define __STDC_FORMAT_MACROS
+#endif
+#ifndef GFLAGS
+#include <cstdio>
+int main() {
+  fprintf(stderr, "Please install gflags to run vidardb tools\n");
+  return 1;
+}
+#else
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <gflags/gflags.h>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "vidardb/env.h"
+#include "vidardb/splitter.h"
+#include "port/port.h"
+#include "util/random.h"
+
+using GFLAGS::ParseCommandLineFlags;
+
+DEFINE_string(table, "lineitem",
+              "The TPC-H table whose rows are split and stitched, lineitem "
+              "or orders.");
+DEFINE_string(splitter, "pipe", "The splitter to use, pipe or encoding.");
+DEFINE_int32(num_rows, 100000, "Number of distinct rows.");
+DEFINE_int32(iterations, 20, "Number of passes over all the rows.");
+DEFINE_int32(seed, 301, "Seed of the random generator.");
+
+namespace vidardb {
+namespace {
+// The average widths of the columns as generated by dbgen.
+const std::vector<int> kLineitemWidths = {7,  6,  5,  1,  2,  8,  4,  4,
+                                          1,  1,  10, 10, 10, 12, 4,  27};
+const std::vector<int> kOrdersWidths = {7, 6, 1, 9, 10, 8, 15, 1, 49};
+
+class SplitterBench {
+ public:
+  SplitterBench() : rnd_(FLAGS_seed) {
+    if (FLAGS_splitter == "encoding") {
+      splitter_.reset(NewEncodingSplitter());
+    } else {
+      splitter_.reset(NewPipeSplitter());
+    }
+    const std::vector<int>& widths =
+        FLAGS_table == "orders" ? kOrdersWidths : kLineitemWidths;
+
+    rows_.reserve(FLAGS_num_rows);
+    std::vector<std::string> fields(widths.size());
+    std::vector<Slice> slices(widths.size());
+    for (int i = 0; i < FLAGS_num_rows; i++) {
+      for (size_t c = 0; c < widths.size(); c++) {
+        // vary the width by up to a half, the fields are never empty
+        int n = widths[c] + static_cast<int>(rnd_.Uniform(widths[c] + 1)) -
+                widths[c] / 2;
+        fields[c].clear();
+        for (int k = 0; k < n; k++) {
+          fields[c].push_back(static_cast<char>('a' + rnd_.Uniform(26)));
+        }
+        slices[c] = fields[c];
+      }
+      rows_.push_back(splitter_->Stitch(slices));
+      bytes_ += rows_.back().size();
+    }
+    columns_ = widths.size();
+  }
+
+  void Run() {
+    PrintHeader();
+    Measure("split", [this]() {
+      size_t n = 0;
+      for (const auto& row : rows_) {
+        n += splitter_->Split(row).size();
+      }
+      return n;
+    });
+    Measure("split_reuse", [this]() {
+      size_t n = 0;
+      std::vector<Slice> vals;
+      for (const auto& row : rows_) {
+        splitter_->Split(row, vals);
+        n += vals.size();
+      }
+      return n;
+    });
+
+    std::vector<std::vector<Slice>> splits(rows_.size());
+    for (size_t i = 0; i < rows_.size(); i++) {
+      splitter_->Split(rows_[i], splits[i]);
+    }
+    Measure("stitch", [this, &splits]() {
+      size_t n = 0;
+      for (const auto& vals : splits) {
+        n += splitter_->Stitch(vals).size();
+      }
+      return n;
+    });
+    Measure("stitch_reuse", [this, &splits]() {
+      size_t n = 0;
+      std::string buf;
+      for (const auto& vals : splits) {
+        buf.clear();
+        n += splitter_->Stitch(vals, buf).size();
+      }
+      return n;
+    });
+  }
+
+ private:
+  template <typename F>
+  void Measure(const char* name, F f) {
+    Env* env = Env::Default();
+    size_t check = 0;
+    uint64_t start = env->NowMicros();
+    for (int i = 0; i < FLAGS_iterations; i++) {
+      check += f();
+    }
+    uint64_t elapsed = env->NowMicros() - start;
+    double secs = elapsed / 1000000.0;
+    uint64_t rows = static_cast<uint64_t>(rows_.size()) * FLAGS_iterations;
+    fprintf(stdout,
+            "%-13s: %8.3f ns/row %8.1f MB/s (%" VIDARDB_PRIszt ")\n", name,
+            elapsed * 1000.0 / rows,
+            bytes_ * FLAGS_iterations / 1048576.0 / secs, check);
+  }
+
+  void PrintHeader() const {
+    printf("Table               : %s\n", FLAGS_table.c_str());
+    printf("Splitter            : %s\n", splitter_->Name());
+    printf("Columns             : %" VIDARDB_PRIszt "\n", columns_);
+    printf("Rows                : %" VIDARDB_PRIszt "\n", rows_.size());
+    printf("Average row bytes   : %.1f\n",
+           static_cast<double>(bytes_) / rows_.size());
+    printf("Iterations          : %d\n", FLAGS_iterations);
+    printf("----------------------------\n");
+  }
+
+  Random rnd_;
+  std::unique_ptr<Splitter> splitter_;
+  std::vector<std::string> rows_;
+  size_t columns_ = 0;
+  uint64_t bytes_ = 0;
+};
+}  // anonymous namespace
+}  // namespace vidardb
+
+int main(int argc, char** argv) {
+  ParseCommandLineFlags(&argc, &argv, true);
+
+  if (FLAGS_num_rows <= 0 || FLAGS_iterations <= 0) {
+    fprintf(stderr, "num_rows and iterations must be positive\n");
+    exit(1);
+  }
+
+  vidardb::SplitterBench bench;
+  bench.Run();
+  return 0;
+}
+
+#endif  // GFLAGS
@@ -14,7 +14,8 @@
 
 #include "port/port.h"
 #include "vidardb/cache.h"
-#include "util/hash.h"
+#include "vidardb/memory_allocator.h"
+#include "util/xxh3.h"  // Shichao
 #include "util/lru_cache_handle.h"
 #include "util/mutexlock.h"
 
@@ -473,9 +474,11 @@ class ShardedLRUCache : public Cache {
   int num_shard_bits_;
   size_t capacity_;
   bool strict_capacity_limit_;
+  std::shared_ptr<MemoryAllocator> memory_allocator_;  // Shichao
 
+  // The cache keys are short, which XXH3 hashes in a few multiplications.
   static inline uint32_t HashSlice(const Slice& s) {
-    return Hash(s.data(), s.size(), 0);
+    return XXH3Hash32(s.data(), s.size());  // Shichao
   }
 
   uint32_t Shard(uint32_t hash) {
@@ -485,11 +488,13 @@ class ShardedLRUCache : public Cache {
 
  public:
   ShardedLRUCache(size_t capacity, int num_shard_bits,
-                  bool strict_capacity_limit)
+                  bool strict_capacity_limit,
+                  std::shared_ptr<MemoryAllocator> memory_allocator)
       : last_id_(0),
         num_shard_bits_(num_shard_bits),
         capacity_(capacity),
-        strict_capacity_limit_(strict_capacity_limit) {
+        strict_capacity_limit_(strict_capacity_limit),
+        memory_allocator_(memory_allocator) {
     int num_shards = 1 << num_shard_bits_;
     shards_ = new LRUCache[num_shards];
     const size_t per_shard = (capacity + (num_shards - 1)) / num_shards;
@@ -587,6 +592,10 @@ class ShardedLRUCache : public Cache {
       shards_[s].EraseUnRefEntries();
     }
   }
+
+  virtual MemoryAllocator* memory_allocator() const override {
+    return memory_allocator_.get();
+  }
 };
 
 }  // end anonymous namespace
@@ -601,11 +610,18 @@ std::shared_ptr<Cache> NewLRUCache(size_t capacity, int num_shard_bits) {
 
 std::shared_ptr<Cache> NewLRUCache(size_t capacity, int num_shard_bits,
                                    bool strict_capacity_limit) {
+  return NewLRUCache(capacity, num_shard_bits, strict_capacity_limit, nullptr);
+}
+
+std::shared_ptr<Cache> NewLRUCache(
+    size_t capacity, int num_shard_bits, bool strict_capacity_limit,
+    std::shared_ptr<MemoryAllocator> memory_allocator) {
   if (num_shard_bits >= 20) {
     return nullptr;  // the cache cannot be sharded into too many fine pieces
   }
   return std::make_shared<ShardedLRUCache>(capacity, num_shard_bits,
-                                           strict_capacity_limit);
+                                           strict_capacity_limit,
+                                           memory_allocator);
 }
 
 }  // namespace vidardb
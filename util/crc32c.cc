@@ -16,6 +16,9 @@
 #ifdef __SSE4_2__
 #include <nmmintrin.h>
 #endif
+#ifdef __PCLMUL__
+#include <wmmintrin.h>  // Shichao
+#endif
 #include "util/coding.h"
 
 namespace vidardb {
@@ -374,21 +377,147 @@ uint32_t ExtendImpl(uint32_t crc, const char* buf, size_t size) {
   return static_cast<uint32_t>(l ^ 0xffffffffu);
 }
 
-// Detect if SS42 or not.
-static bool isSSE42() {
+/***************************** Shichao ******************************/
+// The feature flags in ecx of cpuid leaf 1. cpuid writes all of eax, ebx,
+// ecx and edx, which must be told to the compiler, else it may keep a value
+// in eax across the instruction.
+static uint32_t CpuIdFeatures() {
 #if defined(__GNUC__) && defined(__x86_64__) && !defined(IOS_CROSS_COMPILE)
-  uint32_t c_;
-  uint32_t d_;
-  __asm__("cpuid" : "=c"(c_), "=d"(d_) : "a"(1) : "ebx");
-  return c_ & (1U << 20);  // copied from CpuId.h in Folly.
+  uint32_t a_, b_, c_, d_;
+  __asm__("cpuid" : "=a"(a_), "=b"(b_), "=c"(c_), "=d"(d_) : "a"(1), "c"(0));
+  return c_;
 #else
-  return false;
+  return 0;
 #endif
 }
+/***************************** Shichao ******************************/
+
+// Detect if SS42 or not.
+static bool isSSE42() {
+  return CpuIdFeatures() & (1U << 20);  // copied from CpuId.h in Folly.
+}
+
+/***************************** Shichao ******************************/
+// Detect if the carry-less multiplication is supported or not.
+static bool isPCLMUL() {
+  return CpuIdFeatures() & (1U << 1);
+}
+
+#if defined(__SSE4_2__) && defined(__PCLMUL__) && defined(__LP64__)
+// The crc32 instruction has a latency of 3 cycles but a throughput of 1 per
+// cycle, so a long buffer is cut into 3 blocks whose crcs are computed
+// together. They are merged by a carry-less multiplication of the crcs of
+// the first two with x^n, n being the number of bits following them, which
+// is reduced by the crc32 instruction again.
+
+// The crc32c polynomial, reflected.
+static const uint32_t kPoly = 0x82f63b78u;
+
+// Return a * b modulo the polynomial, both reflected.
+static uint32_t MultModP(uint32_t a, uint32_t b) {
+  uint32_t m = 1u << 31;
+  uint32_t p = 0;
+  for (;;) {
+    if (a & m) {
+      p ^= b;
+      if ((a & (m - 1)) == 0) {
+        break;
+      }
+    }
+    m >>= 1;
+    b = (b & 1) ? (b >> 1) ^ kPoly : b >> 1;
+  }
+  return p;
+}
+
+// Return x^n modulo the polynomial, reflected.
+static uint32_t XPowModP(uint64_t n) {
+  uint32_t result = 1u << 31;  // x^0
+  uint32_t square = 1u << 30;  // x^1
+  for (; n > 0; n >>= 1) {
+    if (n & 1) {
+      result = MultModP(result, square);
+    }
+    square = MultModP(square, square);
+  }
+  return result;
+}
+
+// The crc of a block of 3 * kBlock bytes is merged from those of its
+// thirds, the first one shifted by 2 * kBlock bytes and the second one by
+// kBlock. The 64 bits product and its reduction by the crc32 instruction
+// multiply by x^33 more, which the multipliers leave out.
+template <size_t kBlock>
+struct Crc32cShifts {
+  const uint64_t by_one = XPowModP(kBlock * 8 - 33);
+  const uint64_t by_two = XPowModP(kBlock * 16 - 33);
+};
+
+static const size_t kLongBlock = 1024;
+static const size_t kShortBlock = 256;
+static const Crc32cShifts<kLongBlock> long_shifts;
+static const Crc32cShifts<kShortBlock> short_shifts;
+
+static inline uint64_t ShiftCrc(uint64_t crc, uint64_t k) {
+  __m128i product =
+      _mm_clmulepi64_si128(_mm_cvtsi64_si128(static_cast<int64_t>(crc)),
+                           _mm_cvtsi64_si128(static_cast<int64_t>(k)), 0);
+  return _mm_crc32_u64(0, static_cast<uint64_t>(_mm_cvtsi128_si64(product)));
+}
+
+template <size_t kBlock>
+static inline void ThreeWay_CRC32(uint64_t* l, uint8_t const** p,
+                                  const Crc32cShifts<kBlock>& shifts) {
+  const uint8_t* p0 = *p;
+  uint64_t c0 = *l;
+  uint64_t c1 = 0;
+  uint64_t c2 = 0;
+  for (size_t i = 0; i < kBlock; i += 8) {
+    c0 = _mm_crc32_u64(c0, LE_LOAD64(p0 + i));
+    c1 = _mm_crc32_u64(c1, LE_LOAD64(p0 + kBlock + i));
+    c2 = _mm_crc32_u64(c2, LE_LOAD64(p0 + 2 * kBlock + i));
+  }
+  *l = ShiftCrc(c0, shifts.by_two) ^ ShiftCrc(c1, shifts.by_one) ^ c2;
+  *p += 3 * kBlock;
+}
+
+static uint32_t ExtendThreeWay(uint32_t crc, const char* buf, size_t size) {
+  const uint8_t* p = reinterpret_cast<const uint8_t*>(buf);
+  const uint8_t* e = p + size;
+  uint64_t l = crc ^ 0xffffffffu;
+
+  // Process bytes until p is 8-byte aligned
+  while (p != e && (reinterpret_cast<uintptr_t>(p) & 7) != 0) {
+    l = _mm_crc32_u8(static_cast<uint32_t>(l), *p++);
+  }
+  while (static_cast<size_t>(e - p) >= 3 * kLongBlock) {
+    ThreeWay_CRC32<kLongBlock>(&l, &p, long_shifts);
+  }
+  while (static_cast<size_t>(e - p) >= 3 * kShortBlock) {
+    ThreeWay_CRC32<kShortBlock>(&l, &p, short_shifts);
+  }
+  // Process bytes 8 at a time
+  while ((e - p) >= 8) {
+    l = _mm_crc32_u64(l, LE_LOAD64(p));
+    p += 8;
+  }
+  // Process the last few bytes
+  while (p != e) {
+    l = _mm_crc32_u8(static_cast<uint32_t>(l), *p++);
+  }
+  return static_cast<uint32_t>(l ^ 0xffffffffu);
+}
+#endif
+/***************************** Shichao ******************************/
 
 typedef uint32_t (*Function)(uint32_t, const char*, size_t);
 
 static inline Function Choose_Extend() {
+#if defined(__SSE4_2__) && defined(__PCLMUL__) && defined(__LP64__)
+  if (isSSE42() && isPCLMUL()) {  // Shichao
+    return ExtendThreeWay;
+  }
+#endif
   return isSSE42() ? ExtendImpl<Fast_CRC32> : ExtendImpl<Slow_CRC32>;
 }
 
@@ -400,6 +529,20 @@ bool IsFastCrc32Supported() {
 #endif
 }
 
+/***************************** Shichao ******************************/
+bool IsThreeWayCrc32Supported() {
+#if defined(__SSE4_2__) && defined(__PCLMUL__) && defined(__LP64__)
+  return isSSE42() && isPCLMUL();
+#else
+  return false;
+#endif
+}
+
+uint32_t ExtendPortable(uint32_t crc, const char* buf, size_t size) {
+  return ExtendImpl<Slow_CRC32>(crc, buf, size);
+}
+/***************************** Shichao ******************************/
+
 Function ChosenExtend = Choose_Extend();
 
 uint32_t Extend(uint32_t crc, const char* buf, size_t size) {
@@ -16,6 +16,16 @@ namespace crc32c {
 
 extern bool IsFastCrc32Supported();
 
+/***************************** Shichao ******************************/
+// Return true if Extend() computes the crcs of long buffers in 3 streams
+// merged by carry-less multiplications.
+extern bool IsThreeWayCrc32Supported();
+
+// Extend() with the table based implementation, whatever the cpu supports,
+// to check and to measure the accelerated ones.
+extern uint32_t ExtendPortable(uint32_t init_crc, const char* data, size_t n);
+/***************************** Shichao ******************************/
+
 // Return the crc32c of concat(A, data[0,n-1]) where init_crc is the
 // crc32c of some string A.  Extend() is often used to maintain the
 // crc32c of a stream of data.
@@ -603,6 +603,16 @@ class PosixEnv : public Env {
 #endif
   }
 
+  /***************************** Shichao ******************************/
+#if defined(OS_LINUX) || defined(OS_FREEBSD)
+  virtual uint64_t NowCPUNanos() override {
+    struct timespec ts;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return static_cast<uint64_t>(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+  }
+#endif
+  /***************************** Shichao ******************************/
+
   virtual void SleepForMicroseconds(int micros) override { usleep(micros); }
 
   virtual Status GetHostName(char* name, uint64_t len) override {
@@ -22,6 +22,7 @@
 #include "util/iostats_context_imp.h"
 #include "util/random.h"
 #include "util/sync_point.h"
+#include "vidardb/rate_limiter.h"  // Shichao
 
 namespace vidardb {
 
@@ -34,9 +35,43 @@ Status SequentialFileReader::Read(size_t n, Slice* result, char* scratch) {
 Status SequentialFileReader::Skip(uint64_t n) { return file_->Skip(n); }
 
 Status RandomAccessFileReader::Read(uint64_t offset, size_t n, Slice* result,
-                                    char* scratch) const {
+                                    char* scratch,
+                                    Env::IOPriority pri) const {
   Status s;
   uint64_t elapsed = 0;
+  /***************************** Shichao ******************************/
+  if (rate_limiter_ != nullptr && pri != Env::IO_TOTAL) {
+    // read in pieces of at most one burst into scratch
+    size_t pos = 0;
+    while (s.ok() && pos < n) {
+      size_t allowed = std::min(
+          n - pos, static_cast<size_t>(rate_limiter_->GetSingleBurstBytes()));
+      rate_limiter_->Request(allowed, pri, stats_);
+      Slice piece;
+      uint64_t piece_elapsed = 0;
+      {
+        StopWatch sw(env_, stats_, hist_type_,
+                     (stats_ != nullptr) ? &piece_elapsed : nullptr);
+        IOSTATS_TIMER_GUARD(read_nanos);
+        s = file_->Read(offset + pos, allowed, &piece, scratch + pos);
+        IOSTATS_ADD_IF_POSITIVE(bytes_read, piece.size());
+      }
+      elapsed += piece_elapsed;
+      if (s.ok() && piece.data() != scratch + pos) {
+        memcpy(scratch + pos, piece.data(), piece.size());
+      }
+      pos += piece.size();
+      if (piece.size() < allowed) {
+        break;  // end of file
+      }
+    }
+    *result = Slice(scratch, s.ok() ? pos : 0);
+    if (stats_ != nullptr && file_read_hist_ != nullptr) {
+      file_read_hist_->Add(elapsed);
+    }
+    return s;
+  }
+  /***************************** Shichao ******************************/
   {
     StopWatch sw(env_, stats_, hist_type_,
                  (stats_ != nullptr) ? &elapsed : nullptr);
@@ -257,6 +292,21 @@ Status WritableFileWriter::RangeSync(uint64_t offset, uint64_t nbytes) {
 }
 
 size_t WritableFileWriter::RequestToken(size_t bytes, bool align) {
+  Env::IOPriority io_priority;
+  if (rate_limiter_ != nullptr &&
+      (io_priority = writable_file_->GetIOPriority()) < Env::IO_TOTAL) {
+    bytes = std::min(
+        bytes, static_cast<size_t>(rate_limiter_->GetSingleBurstBytes()));
+
+    if (align) {
+      // Here we may actually require more than burst and block
+      // but we can not write less than one page at a time on unbuffered
+      // thus we may want not to use ratelimiter s
+      size_t alignment = buf_.Alignment();
+      bytes = std::max(alignment, TruncateToPageBoundary(alignment, bytes));
+    }
+    rate_limiter_->Request(bytes, io_priority, stats_);
+  }
   return bytes;
 }
 
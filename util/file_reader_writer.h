@@ -16,6 +16,7 @@ namespace vidardb {
 
 class Statistics;
 class HistogramImpl;
+class RateLimiter;  // Shichao
 
 std::unique_ptr<RandomAccessFile> NewReadaheadRandomAccessFile(
   std::unique_ptr<RandomAccessFile>&& file, size_t readahead_size);
@@ -54,18 +55,21 @@ class RandomAccessFileReader {
   Statistics*     stats_;
   uint32_t        hist_type_;
   HistogramImpl*  file_read_hist_;
+  RateLimiter*    rate_limiter_;  // Shichao
 
  public:
   explicit RandomAccessFileReader(std::unique_ptr<RandomAccessFile>&& raf,
                                   Env* env = nullptr,
                                   Statistics* stats = nullptr,
                                   uint32_t hist_type = 0,
-                                  HistogramImpl* file_read_hist = nullptr)
+                                  HistogramImpl* file_read_hist = nullptr,
+                                  RateLimiter* rate_limiter = nullptr)
       : file_(std::move(raf)),
         env_(env),
         stats_(stats),
         hist_type_(hist_type),
-        file_read_hist_(file_read_hist) {}
+        file_read_hist_(file_read_hist),
+        rate_limiter_(rate_limiter) {}
 
   RandomAccessFileReader(RandomAccessFileReader&& o) VIDARDB_NOEXCEPT {
     *this = std::move(o);
@@ -77,15 +81,21 @@ class RandomAccessFileReader {
     stats_ = std::move(o.stats_);
     hist_type_ = std::move(o.hist_type_);
     file_read_hist_ = std::move(o.file_read_hist_);
+    rate_limiter_ = std::move(o.rate_limiter_);
     return *this;
   }
 
   RandomAccessFileReader(const RandomAccessFileReader&) = delete;
   RandomAccessFileReader& operator=(const RandomAccessFileReader&) = delete;
 
-  Status Read(uint64_t offset, size_t n, Slice* result, char* scratch) const;
+  // The read is charged to pri in the rate limiter, if any, see
+  // ReadOptions::rate_limiter_priority.
+  Status Read(uint64_t offset, size_t n, Slice* result, char* scratch,
+              Env::IOPriority pri = Env::IO_TOTAL) const;
 
   RandomAccessFile* file() { return file_.get(); }
+
+  RateLimiter* rate_limiter() const { return rate_limiter_; }  // Shichao
 };
 
 // Use posix write to write data to a file.
@@ -107,10 +117,16 @@ class WritableFileWriter {
   const bool              use_os_buffer_;
   uint64_t                last_sync_size_;
   uint64_t                bytes_per_sync_;
+  RateLimiter*            rate_limiter_;  // Shichao
+  Statistics*             stats_;         // Shichao
 
  public:
+  // The writes are charged to the IOPriority of file in rate_limiter, if
+  // any. The time they are throttled is recorded in stats.
   WritableFileWriter(std::unique_ptr<WritableFile>&& file,
-                     const EnvOptions& options)
+                     const EnvOptions& options,
+                     RateLimiter* rate_limiter = nullptr,
+                     Statistics* stats = nullptr)
       : writable_file_(std::move(file)),
         buf_(),
         max_buffer_size_(options.writable_file_max_buffer_size),
@@ -121,7 +137,9 @@ class WritableFileWriter {
         direct_io_(writable_file_->UseDirectIO()),
         use_os_buffer_(writable_file_->UseOSBuffer()),
         last_sync_size_(0),
-        bytes_per_sync_(options.bytes_per_sync) {
+        bytes_per_sync_(options.bytes_per_sync),
+        rate_limiter_(rate_limiter),
+        stats_(stats) {
 
     buf_.Alignment(writable_file_->GetRequiredBufferAlignment());
     buf_.AllocateNewBuffer(65536);
@@ -154,6 +172,9 @@ class WritableFileWriter {
 
   WritableFile* writable_file() const { return writable_file_.get(); }
 
+  RateLimiter* rate_limiter() const { return rate_limiter_; }  // Shichao
+  Statistics* stats() const { return stats_; }                 // Shichao
+
  private:
   // Used when os buffering is OFF and we are writing
   // DMA such as in Windows unbuffered mode
@@ -0,0 +1,213 @@
+//  Copyright (c) 2019-present, VidarDB, Inc.  All rights reserved.
+//  This source code is licensed under the BSD-style license found in the
+//  LICENSE file in the root directory of this source tree. An additional grant
+//  of patent rights can be found in the PATENTS file in the same directory.
+
+#include "util/memory_allocator.h"
+
+#ifndef OS_WIN
+#include <sys/mman.h>
+#endif
+#ifdef NUMA
+#include <numa.h>
+#endif
+
+#include <stdlib.h>
+#include <algorithm>
+#include <new>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "port/port.h"
+#include "util/mutexlock.h"
+
+namespace vidardb {
+
+namespace {
+
+class HugePageMemoryAllocator : public MemoryAllocator {
+ public:
+  HugePageMemoryAllocator(size_t huge_page_size, bool numa_interleave)
+      : huge_page_size_(huge_page_size > 0 ? huge_page_size : 2 << 20),
+        chunk_size_(huge_page_size_ * kPagesPerChunk),
+        numa_interleave_(numa_interleave),
+        chunk_ptr_(nullptr),
+        chunk_remaining_(0) {}
+
+  virtual ~HugePageMemoryAllocator() {
+    for (const auto& chunk : chunks_) {
+      Unmap(chunk.first, chunk.second);
+    }
+  }
+
+  virtual const char* Name() const override {
+    return "HugePageMemoryAllocator";
+  }
+
+  virtual void* Allocate(size_t size) override;
+
+  virtual void Deallocate(void* p) override;
+
+  virtual size_t UsableSize(void* p, size_t allocation_size) const override {
+    return GetHeader(p)->size;
+  }
+
+ private:
+  static const size_t kPagesPerChunk = 8;
+  static const size_t kMinClassSize = 64;
+
+  enum Source : size_t { kChunk, kMapping, kHeap };
+
+  // In front of every buffer, keeps the buffers 16 bytes aligned
+  struct Header {
+    size_t size;    // usable bytes after the header
+    Source source;  // where the buffer was taken from
+  };
+
+  static Header* GetHeader(void* p) {
+    return reinterpret_cast<Header*>(p) - 1;
+  }
+
+  // Size classes grow by a quarter of the power of two below them, so at
+  // most 25% of a buffer is wasted.
+  static size_t ClassSize(size_t size) {
+    size_t pow2 = kMinClassSize;
+    while (pow2 < size) {
+      pow2 <<= 1;
+    }
+    size_t granularity = std::max(pow2 / 4, kMinClassSize);
+    return (size + granularity - 1) / granularity * granularity;
+  }
+
+  char* Map(size_t bytes);
+  void Unmap(void* addr, size_t bytes);
+
+  const size_t huge_page_size_;
+  const size_t chunk_size_;
+  const bool numa_interleave_;
+
+  port::Mutex mutex_;
+  std::unordered_map<size_t, std::vector<char*>> free_lists_;
+  std::vector<std::pair<char*, size_t>> chunks_;
+  char* chunk_ptr_;
+  size_t chunk_remaining_;
+};
+
+char* HugePageMemoryAllocator::Map(size_t bytes) {
+#ifndef OS_WIN
+  void* addr = MAP_FAILED;
+#ifdef MAP_HUGETLB
+  addr = mmap(nullptr, bytes, PROT_READ | PROT_WRITE,
+              MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+#endif
+  if (addr == MAP_FAILED) {
+    // no reserved huge pages left, ask for transparent ones
+    addr = mmap(nullptr, bytes, PROT_READ | PROT_WRITE,
+                MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (addr == MAP_FAILED) {
+      return nullptr;
+    }
+#ifdef MADV_HUGEPAGE
+    madvise(addr, bytes, MADV_HUGEPAGE);
+#endif
+  }
+  if (numa_interleave_) {
+#ifdef NUMA
+    // before the pages are touched, so that they are placed accordingly
+    if (numa_available() >= 0) {
+      numa_interleave_memory(addr, bytes, numa_all_nodes_ptr);
+    }
+#endif
+  }
+  return reinterpret_cast<char*>(addr);
+#else
+  return nullptr;
+#endif
+}
+
+void HugePageMemoryAllocator::Unmap(void* addr, size_t bytes) {
+#ifndef OS_WIN
+  munmap(addr, bytes);
+#endif
+}
+
+void* HugePageMemoryAllocator::Allocate(size_t size) {
+  size_t class_size = ClassSize(size);
+  size_t bytes = sizeof(Header) + class_size;
+  char* raw = nullptr;
+  Source source = kChunk;
+
+  if (bytes > chunk_size_ / 4) {
+    // too big to share a chunk, gets a mapping of its own
+    bytes = (bytes + huge_page_size_ - 1) / huge_page_size_ * huge_page_size_;
+    raw = Map(bytes);
+    source = kMapping;
+    class_size = bytes - sizeof(Header);
+  } else {
+    MutexLock l(&mutex_);
+    auto& free_list = free_lists_[class_size];
+    if (!free_list.empty()) {
+      raw = free_list.back();
+      free_list.pop_back();
+    } else {
+      if (chunk_remaining_ < bytes) {
+        // the tail of the current chunk is wasted, at most a quarter of it
+        char* chunk = Map(chunk_size_);
+        if (chunk != nullptr) {
+          chunks_.emplace_back(chunk, chunk_size_);
+          chunk_ptr_ = chunk;
+          chunk_remaining_ = chunk_size_;
+        }
+      }
+      if (chunk_remaining_ >= bytes) {
+        raw = chunk_ptr_;
+        chunk_ptr_ += bytes;
+        chunk_remaining_ -= bytes;
+      }
+    }
+  }
+
+  if (raw == nullptr) {
+    raw = reinterpret_cast<char*>(malloc(bytes));
+    if (raw == nullptr) {
+      // as the new[] of the default allocation does
+      throw std::bad_alloc();
+    }
+    source = kHeap;
+  }
+  Header* header = reinterpret_cast<Header*>(raw);
+  header->size = class_size;
+  header->source = source;
+  return header + 1;
+}
+
+void HugePageMemoryAllocator::Deallocate(void* p) {
+  if (p == nullptr) {
+    return;
+  }
+  Header* header = GetHeader(p);
+  switch (header->source) {
+    case kChunk: {
+      MutexLock l(&mutex_);
+      free_lists_[header->size].push_back(reinterpret_cast<char*>(header));
+      break;
+    }
+    case kMapping:
+      Unmap(header, sizeof(Header) + header->size);
+      break;
+    case kHeap:
+      free(header);
+      break;
+  }
+}
+
+}  // anonymous namespace
+
+std::shared_ptr<MemoryAllocator> NewHugePageMemoryAllocator(
+    size_t huge_page_size, bool numa_interleave) {
+  return std::make_shared<HugePageMemoryAllocator>(huge_page_size,
+                                                   numa_interleave);
+}
+
+}  // namespace vidardb
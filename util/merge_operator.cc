@@ -0,0 +1,215 @@
+//  Copyright (c) 2019-present, VidarDB, Inc.  All rights reserved.
+//  This source code is licensed under the BSD-style license found in the
+//  LICENSE file in the root directory of this source tree. An additional grant
+//  of patent rights can be found in the PATENTS file in the same directory.
+//
+//  Copyright (c) 2011-present, Facebook, Inc.  All rights reserved.
+//  This source code is licensed under the BSD-style license found in the
+//  LICENSE file in the root directory of this source tree. An additional grant
+//  of patent rights can be found in the PATENTS file in the same directory.
+
+#include "vidardb/merge_operator.h"
+
+#include <assert.h>
+
+#include "port/port.h"
+#include "util/coding.h"
+#include "util/logging.h"
+#include "vidardb/env.h"
+
+namespace vidardb {
+
+// The default implementation of PartialMergeMulti, which invokes
+// PartialMerge multiple times internally and merges two operands at
+// a time.
+bool MergeOperator::PartialMergeMulti(const Slice& key,
+                                      const std::deque<Slice>& operand_list,
+                                      std::string* new_value,
+                                      Logger* logger) const {
+  assert(operand_list.size() >= 2);
+  // Simply loop through the operands
+  Slice temp_slice(operand_list[0]);
+
+  for (size_t i = 1; i < operand_list.size(); ++i) {
+    auto& operand = operand_list[i];
+    std::string temp_value;
+    if (!PartialMerge(key, temp_slice, operand, &temp_value, logger)) {
+      return false;
+    }
+    swap(temp_value, *new_value);
+    temp_slice = Slice(*new_value);
+  }
+
+  // The result will be in *new_value. All merges succeeded.
+  return true;
+}
+
+// Given a "real" merge from the library, call the user's
+// associative merge function one-by-one on each of the operands.
+// NOTE: It is assumed that the client's merge-operator will handle any errors.
+bool AssociativeMergeOperator::FullMerge(
+    const Slice& key,
+    const Slice* existing_value,
+    const std::deque<std::string>& operand_list,
+    std::string* new_value,
+    Logger* logger) const {
+
+  // Simply loop through the operands
+  Slice temp_existing;
+  for (const auto& operand : operand_list) {
+    Slice value(operand);
+    std::string temp_value;
+    if (!Merge(key, existing_value, value, &temp_value, logger)) {
+      return false;
+    }
+    swap(temp_value, *new_value);
+    temp_existing = Slice(*new_value);
+    existing_value = &temp_existing;
+  }
+
+  // The result will be in *new_value. All merges succeeded.
+  return true;
+}
+
+// Call the user defined simple merge on the operands;
+// NOTE: It is assumed that the client's merge-operator will handle any errors.
+bool AssociativeMergeOperator::PartialMerge(
+    const Slice& key,
+    const Slice& left_operand,
+    const Slice& right_operand,
+    std::string* new_value,
+    Logger* logger) const {
+  return Merge(key, &left_operand, right_operand, new_value, logger);
+}
+
+bool UInt64AddOperator::Merge(const Slice& key, const Slice* existing_value,
+                              const Slice& value, std::string* new_value,
+                              Logger* logger) const {
+  uint64_t orig_value = 0;
+  if (existing_value != nullptr) {
+    if (existing_value->size() == sizeof(uint64_t)) {
+      orig_value = DecodeFixed64(existing_value->data());
+    } else {
+      Log(InfoLogLevel::ERROR_LEVEL, logger,
+          "uint64 value corruption, size: %" VIDARDB_PRIszt
+          " != %" VIDARDB_PRIszt,
+          existing_value->size(), sizeof(uint64_t));
+    }
+  }
+
+  uint64_t operand = 0;
+  if (value.size() == sizeof(uint64_t)) {
+    operand = DecodeFixed64(value.data());
+  } else {
+    Log(InfoLogLevel::ERROR_LEVEL, logger,
+        "uint64 operand corruption, size: %" VIDARDB_PRIszt
+        " != %" VIDARDB_PRIszt,
+        value.size(), sizeof(uint64_t));
+  }
+
+  assert(new_value != nullptr);
+  new_value->clear();
+  PutFixed64(new_value, orig_value + operand);
+  return true;  // Return true always since corruption will be treated as 0
+}
+
+std::shared_ptr<MergeOperator> NewUInt64AddOperator() {
+  return std::make_shared<UInt64AddOperator>();
+}
+
+namespace {
+// Leads a patch field that sets its column, so that an empty column value
+// can be told apart from a column that is left as it is.
+const char kColumnPatchSet = '\x01';
+}  // namespace
+
+std::string ColumnPatchMergeOperator::EncodePatch(
+    const std::vector<std::pair<uint32_t, Slice>>& columns) const {
+  std::vector<std::string> fields(column_count_);
+  for (const auto& column : columns) {
+    if (column.first < 1 || column.first > column_count_) {
+      continue;
+    }
+    std::string& field = fields[column.first - 1];
+    field.assign(1, kColumnPatchSet);
+    field.append(column.second.data(), column.second.size());
+  }
+  return splitter_->Stitch(std::vector<Slice>(fields.begin(), fields.end()));
+}
+
+bool ColumnPatchMergeOperator::ApplyPatch(const Slice& patch,
+                                          std::vector<Slice>* fields) const {
+  std::vector<Slice> patch_fields(splitter_->Split(patch));
+  if (fields->empty()) {
+    // No base row, the columns that are not patched stay empty
+    fields->resize(patch_fields.size());
+  }
+  if (patch_fields.size() != fields->size()) {
+    return false;
+  }
+
+  for (size_t i = 0; i < patch_fields.size(); i++) {
+    if (!patch_fields[i].empty()) {
+      if (patch_fields[i][0] != kColumnPatchSet) {
+        return false;
+      }
+      (*fields)[i] = Slice(patch_fields[i].data() + 1,
+                           patch_fields[i].size() - 1);
+    }
+  }
+  return true;
+}
+
+bool ColumnPatchMergeOperator::FullMerge(
+    const Slice& key, const Slice* existing_value,
+    const std::deque<std::string>& operand_list, std::string* new_value,
+    Logger* logger) const {
+  std::vector<Slice> fields;
+  if (existing_value != nullptr && !existing_value->empty()) {
+    fields = splitter_->Split(*existing_value);
+  }
+
+  for (const auto& operand : operand_list) {
+    if (!ApplyPatch(operand, &fields)) {
+      Log(InfoLogLevel::ERROR_LEVEL, logger,
+          "column patch does not match the row");
+      return false;
+    }
+  }
+
+  new_value->clear();
+  splitter_->Stitch(fields, *new_value);
+  return true;
+}
+
+bool ColumnPatchMergeOperator::PartialMergeMulti(
+    const Slice& key, const std::deque<Slice>& operand_list,
+    std::string* new_value, Logger* logger) const {
+  // Later patches win column by column, keep the marker of each field
+  std::vector<Slice> fields;
+  for (const auto& operand : operand_list) {
+    std::vector<Slice> patch_fields(splitter_->Split(operand));
+    if (fields.empty()) {
+      fields.resize(patch_fields.size());
+    }
+    if (patch_fields.size() != fields.size()) {
+      return false;
+    }
+    for (size_t i = 0; i < patch_fields.size(); i++) {
+      if (!patch_fields[i].empty()) {
+        fields[i] = patch_fields[i];
+      }
+    }
+  }
+
+  new_value->clear();
+  splitter_->Stitch(fields, *new_value);
+  return true;
+}
+
+std::shared_ptr<ColumnPatchMergeOperator> NewColumnPatchMergeOperator(
+    const std::shared_ptr<Splitter>& splitter, uint32_t column_count) {
+  return std::make_shared<ColumnPatchMergeOperator>(splitter, column_count);
+}
+
+}  // namespace vidardb
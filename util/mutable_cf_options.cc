@@ -68,6 +68,12 @@ void MutableCFOptions::Dump(Logger* log) const {
       max_write_buffer_number);
   Log(log, "                         arena_block_size: %" VIDARDB_PRIszt,
       arena_block_size);
+  Log(log, "         memtable_prefix_bloom_size_ratio: %f",
+      memtable_prefix_bloom_size_ratio);  // Shichao
+  Log(log, "             memtable_whole_key_filtering: %d",
+      memtable_whole_key_filtering);  // Shichao
+  Log(log, "                  memtable_huge_page_size: %" VIDARDB_PRIszt,
+      memtable_huge_page_size);  // Shichao
   Log(log, "                 disable_auto_compactions: %d",
       disable_auto_compactions);
   Log(log, "       level0_file_num_compaction_trigger: %d",
@@ -17,6 +17,11 @@ struct MutableCFOptions {
       : write_buffer_size(options.write_buffer_size),
         max_write_buffer_number(options.max_write_buffer_number),
         arena_block_size(options.arena_block_size),
+        memtable_prefix_bloom_size_ratio(
+            options.memtable_prefix_bloom_size_ratio),  // Shichao
+        memtable_whole_key_filtering(
+            options.memtable_whole_key_filtering),  // Shichao
+        memtable_huge_page_size(options.memtable_huge_page_size),  // Shichao
         disable_auto_compactions(options.disable_auto_compactions),
         level0_file_num_compaction_trigger(
             options.level0_file_num_compaction_trigger),
@@ -42,6 +47,9 @@ struct MutableCFOptions {
       : write_buffer_size(0),
         max_write_buffer_number(0),
         arena_block_size(0),
+        memtable_prefix_bloom_size_ratio(0),  // Shichao
+        memtable_whole_key_filtering(false),  // Shichao
+        memtable_huge_page_size(0),  // Shichao
         disable_auto_compactions(false),
         level0_file_num_compaction_trigger(0),
         compaction_pri(kByCompensatedSize),
@@ -82,6 +90,9 @@ struct MutableCFOptions {
   size_t write_buffer_size;
   int max_write_buffer_number;
   size_t arena_block_size;
+  double memtable_prefix_bloom_size_ratio;  // Shichao
+  bool memtable_whole_key_filtering;  // Shichao
+  size_t memtable_huge_page_size;  // Shichao
 
   // Compaction related options
   bool disable_auto_compactions;
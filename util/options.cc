@@ -28,6 +28,7 @@
 #include "vidardb/sst_file_manager.h"
 #include "vidardb/memtablerep.h"
 #include "vidardb/slice.h"
+#include "vidardb/slice_transform.h"  // Shichao
 #include "vidardb/table.h"
 #include "vidardb/table_properties.h"
 #include "table/block_based_table_factory.h"
@@ -41,14 +42,20 @@ ImmutableCFOptions::ImmutableCFOptions(const Options& options)
       compaction_options_fifo(options.compaction_options_fifo),
       comparator(options.comparator),
       splitter(options.splitter.get()),
+      merge_operator(options.merge_operator.get()),
+      compaction_filter(options.compaction_filter),  // Shichao
+      compaction_filter_factory(
+          options.compaction_filter_factory.get()),  // Shichao
       info_log(options.info_log.get()),
       statistics(options.statistics.get()),
       env(options.env),
+      rate_limiter(options.rate_limiter.get()),  // Shichao
       delayed_write_rate(options.delayed_write_rate),
       allow_mmap_reads(options.allow_mmap_reads),
       allow_mmap_writes(options.allow_mmap_writes),
       db_paths(options.db_paths),
       memtable_factory(options.memtable_factory.get()),
+      prefix_extractor(options.prefix_extractor.get()),  // Shichao
       table_factory(options.table_factory.get()),
       table_properties_collector_factories(
           options.table_properties_collector_factories),
@@ -69,6 +76,10 @@ ImmutableCFOptions::ImmutableCFOptions(const Options& options)
 ColumnFamilyOptions::ColumnFamilyOptions()
     : comparator(BytewiseComparator()),
       splitter(nullptr),  // compatible with row store
+      merge_operator(nullptr),
+      compaction_filter(nullptr),  // Shichao
+      compaction_filter_factory(
+          std::shared_ptr<CompactionFilterFactory>(nullptr)),  // Shichao
       write_buffer_size(512 << 20),
       max_write_buffer_number(2),
       min_write_buffer_number_to_merge(1),
@@ -87,10 +98,17 @@ ColumnFamilyOptions::ColumnFamilyOptions()
       max_grandparent_overlap_factor(10),
       arena_block_size(0),
       disable_auto_compactions(false),
+      background_job_weight(1.0),  // Shichao
       compaction_style(kCompactionStyleLevel),
       compaction_pri(kByCompensatedSize),
       verify_checksums_in_compaction(true),
       memtable_factory(std::shared_ptr<SkipListFactory>(new SkipListFactory)),
+      /***************************** Shichao ******************************/
+      prefix_extractor(nullptr),
+      memtable_prefix_bloom_size_ratio(0.0),
+      memtable_whole_key_filtering(false),
+      memtable_huge_page_size(0),
+      /***************************** Shichao ******************************/
       table_factory(
           std::shared_ptr<TableFactory>(new BlockBasedTableFactory())),
       paranoid_file_checks(false),
@@ -101,6 +119,9 @@ ColumnFamilyOptions::ColumnFamilyOptions()
 ColumnFamilyOptions::ColumnFamilyOptions(const Options& options)
     : comparator(options.comparator),
       splitter(options.splitter),
+      merge_operator(options.merge_operator),
+      compaction_filter(options.compaction_filter),  // Shichao
+      compaction_filter_factory(options.compaction_filter_factory),  // Shichao
       write_buffer_size(options.write_buffer_size),
       max_write_buffer_number(options.max_write_buffer_number),
       min_write_buffer_number_to_merge(
@@ -125,11 +146,19 @@ ColumnFamilyOptions::ColumnFamilyOptions(const Options& options)
       max_grandparent_overlap_factor(options.max_grandparent_overlap_factor),
       arena_block_size(options.arena_block_size),
       disable_auto_compactions(options.disable_auto_compactions),
+      background_job_weight(options.background_job_weight),  // Shichao
       compaction_style(options.compaction_style),
       compaction_pri(options.compaction_pri),
       verify_checksums_in_compaction(options.verify_checksums_in_compaction),
       compaction_options_fifo(options.compaction_options_fifo),
       memtable_factory(options.memtable_factory),
+      /***************************** Shichao ******************************/
+      prefix_extractor(options.prefix_extractor),
+      memtable_prefix_bloom_size_ratio(
+          options.memtable_prefix_bloom_size_ratio),
+      memtable_whole_key_filtering(options.memtable_whole_key_filtering),
+      memtable_huge_page_size(options.memtable_huge_page_size),
+      /***************************** Shichao ******************************/
       table_factory(options.table_factory),
       table_properties_collector_factories(
           options.table_properties_collector_factories),
@@ -148,6 +177,7 @@ DBOptions::DBOptions()
       error_if_exists(false),
       paranoid_checks(true),
       env(Env::Default()),
+      rate_limiter(nullptr),  // Shichao
       sst_file_manager(nullptr),
       info_log(nullptr),
 #ifdef NDEBUG
@@ -157,6 +187,7 @@ DBOptions::DBOptions()
 #endif  // NDEBUG
       max_open_files(-1),
       max_file_opening_threads(16),
+      persist_table_open_state(false),  // Shichao
       max_total_wal_size(0),
       statistics(nullptr),
       disableDataSync(false),
@@ -166,6 +197,7 @@ DBOptions::DBOptions()
       delete_obsolete_files_period_micros(6ULL * 60 * 60 * 1000000),
       base_background_compactions(1),
       max_background_compactions(1),
+      background_time_slice_micros(0),  // Shichao
       max_subcompactions(1),
       max_background_flushes(1),
       max_log_file_size(0),
@@ -183,6 +215,7 @@ DBOptions::DBOptions()
       allow_fallocate(true),
       is_fd_close_on_exec(true),
       stats_dump_period_sec(600),
+      perf_sample_rate(0),
       advise_random_on_open(true),
       db_write_buffer_size(0),
       access_hint_on_compaction_start(NORMAL),
@@ -213,11 +246,13 @@ DBOptions::DBOptions(const Options& options)
       error_if_exists(options.error_if_exists),
       paranoid_checks(options.paranoid_checks),
       env(options.env),
+      rate_limiter(options.rate_limiter),  // Shichao
       sst_file_manager(options.sst_file_manager),
       info_log(options.info_log),
       info_log_level(options.info_log_level),
       max_open_files(options.max_open_files),
       max_file_opening_threads(options.max_file_opening_threads),
+      persist_table_open_state(options.persist_table_open_state),  // Shichao
       max_total_wal_size(options.max_total_wal_size),
       statistics(options.statistics),
       disableDataSync(options.disableDataSync),
@@ -229,6 +264,8 @@ DBOptions::DBOptions(const Options& options)
           options.delete_obsolete_files_period_micros),
       base_background_compactions(options.base_background_compactions),
       max_background_compactions(options.max_background_compactions),
+      background_time_slice_micros(  // Shichao
+          options.background_time_slice_micros),
       max_subcompactions(options.max_subcompactions),
       max_background_flushes(options.max_background_flushes),
       max_log_file_size(options.max_log_file_size),
@@ -246,6 +283,7 @@ DBOptions::DBOptions(const Options& options)
       allow_fallocate(options.allow_fallocate),
       is_fd_close_on_exec(options.is_fd_close_on_exec),
       stats_dump_period_sec(options.stats_dump_period_sec),
+      perf_sample_rate(options.perf_sample_rate),
       advise_random_on_open(options.advise_random_on_open),
       db_write_buffer_size(options.db_write_buffer_size),
       access_hint_on_compaction_start(options.access_hint_on_compaction_start),
@@ -280,10 +318,13 @@ void DBOptions::Dump(Logger* log) const {
     Header(log, "       Options.create_if_missing: %d", create_if_missing);
     Header(log, "         Options.paranoid_checks: %d", paranoid_checks);
     Header(log, "                     Options.env: %p", env);
+    Header(log, "            Options.rate_limiter: %p", rate_limiter.get());
     Header(log, "                Options.info_log: %p", info_log.get());
     Header(log, "          Options.max_open_files: %d", max_open_files);
     Header(log,
         "Options.max_file_opening_threads: %d", max_file_opening_threads);
+    Header(log,
+        "Options.persist_table_open_state: %d", persist_table_open_state);
     Header(log,
         "      Options.max_total_wal_size: %" PRIu64, max_total_wal_size);
     Header(log, "       Options.disableDataSync: %d", disableDataSync);
@@ -316,6 +357,8 @@ void DBOptions::Dump(Logger* log) const {
            base_background_compactions);
     Header(log, "             Options.max_background_compactions: %d",
         max_background_compactions);
+    Header(log, "           Options.background_time_slice_micros: %" PRIu64,
+           background_time_slice_micros);
     Header(log, "                     Options.max_subcompactions: %" PRIu32,
         max_subcompactions);
     Header(log, "                 Options.max_background_flushes: %d",
@@ -337,6 +380,8 @@ void DBOptions::Dump(Logger* log) const {
         is_fd_close_on_exec);
     Header(log, "                   Options.stats_dump_period_sec: %u",
         stats_dump_period_sec);
+    Header(log, "                        Options.perf_sample_rate: %" PRIu32,
+        perf_sample_rate);
     Header(log, "                   Options.advise_random_on_open: %d",
         advise_random_on_open);
     Header(log,
@@ -390,7 +435,18 @@ void ColumnFamilyOptions::Dump(Logger* log) const {
   if (splitter) {
     Header(log, "              Options.splitter: %s", splitter->Name());
   }
+  Header(log, "          Options.merge_operator: %s",
+         merge_operator ? merge_operator->Name() : "None");
+  /***************************** Shichao ******************************/
+  Header(log, "       Options.compaction_filter: %s",
+         compaction_filter ? compaction_filter->Name() : "None");
+  Header(log, "       Options.compaction_filter_factory: %s",
+         compaction_filter_factory ? compaction_filter_factory->Name()
+                                   : "None");
+  /***************************** Shichao ******************************/
   Header(log, "        Options.memtable_factory: %s", memtable_factory->Name());
+  Header(log, "        Options.prefix_extractor: %s",
+         prefix_extractor == nullptr ? "nullptr" : prefix_extractor->Name());
   Header(log, "           Options.table_factory: %s", table_factory->Name());
   Header(log, "           table_factory options: %s",
       table_factory->GetPrintableTableOptions().c_str());
@@ -451,8 +507,19 @@ void ColumnFamilyOptions::Dump(Logger* log) const {
     Header(log,
          "                       Options.arena_block_size: %" VIDARDB_PRIszt,
          arena_block_size);
+    /***************************** Shichao ******************************/
+    Header(log, "       Options.memtable_prefix_bloom_size_ratio: %f",
+           memtable_prefix_bloom_size_ratio);
+    Header(log, "           Options.memtable_whole_key_filtering: %d",
+           memtable_whole_key_filtering);
+    Header(log,
+           "                Options.memtable_huge_page_size: %" VIDARDB_PRIszt,
+           memtable_huge_page_size);
+    /***************************** Shichao ******************************/
     Header(log, "               Options.disable_auto_compactions: %d",
         disable_auto_compactions);
+    Header(log, "                  Options.background_job_weight: %f",
+           background_job_weight);
     Header(log, "          Options.verify_checksums_in_compaction: %d",
         verify_checksums_in_compaction);
     Header(log, "                        Options.compaction_style: %d",
@@ -638,7 +705,10 @@ ReadOptions::ReadOptions()
       batch_capacity(0),
       range_query_meta(nullptr),
       result_key_size(0),
-      result_val_size(0) {}
+      result_val_size(0),
+      rate_limiter_priority(Env::IO_TOTAL),  // Shichao
+      iterate_upper_bound(nullptr),          // Shichao
+      iterate_lower_bound(nullptr) {}        // Shichao
 
 ReadOptions::ReadOptions(bool cksum, bool cache)
     : verify_checksums(cksum),
@@ -652,6 +722,9 @@ ReadOptions::ReadOptions(bool cksum, bool cache)
       batch_capacity(0),
       range_query_meta(nullptr),
       result_key_size(0),
-      result_val_size(0) {}
+      result_val_size(0),
+      rate_limiter_priority(Env::IO_TOTAL),  // Shichao
+      iterate_upper_bound(nullptr),          // Shichao
+      iterate_lower_bound(nullptr) {}        // Shichao
 
 }  // namespace vidardb
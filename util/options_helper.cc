@@ -13,6 +13,7 @@
 #include "vidardb/convenience.h"
 #include "vidardb/memtablerep.h"
 #include "vidardb/options.h"
+#include "vidardb/slice_transform.h"  // Shichao
 #include "vidardb/table.h"
 #include "table/block_based_table_factory.h"
 #include "util/logging.h"
@@ -221,6 +222,45 @@ double ParseDouble(const std::string& value) {
 #endif
 }
 
+/***************************** Shichao ******************************/
+// Accepts "fixed:<len>", "capped:<len>", "nullptr" and the names of the
+// built-in transforms, e.g. "vidardb.FixedPrefix.<len>", so that a
+// serialized prefix_extractor can be parsed back.
+bool ParseSliceTransformHelper(
+    const std::string& kFixedPrefixName, const std::string& kCappedPrefixName,
+    const std::string& value,
+    std::shared_ptr<const SliceTransform>* slice_transform) {
+  if (value.size() > kFixedPrefixName.size() &&
+      value.compare(0, kFixedPrefixName.size(), kFixedPrefixName) == 0) {
+    size_t prefix_length = ParseSizeT(value.substr(kFixedPrefixName.size()));
+    slice_transform->reset(NewFixedPrefixTransform(prefix_length));
+  } else if (value.size() > kCappedPrefixName.size() &&
+             value.compare(0, kCappedPrefixName.size(), kCappedPrefixName) ==
+                 0) {
+    size_t prefix_length = ParseSizeT(value.substr(kCappedPrefixName.size()));
+    slice_transform->reset(NewCappedPrefixTransform(prefix_length));
+  } else if (value == "nullptr") {
+    slice_transform->reset();
+  } else {
+    return false;
+  }
+  return true;
+}
+
+bool ParseSliceTransform(
+    const std::string& value,
+    std::shared_ptr<const SliceTransform>* slice_transform) {
+  // the short names, used in option strings
+  if (ParseSliceTransformHelper("fixed:", "capped:", value, slice_transform)) {
+    return true;
+  }
+  // the names of the transforms, used in options files
+  return ParseSliceTransformHelper("vidardb.FixedPrefix.",
+                                   "vidardb.CappedPrefix.", value,
+                                   slice_transform);
+}
+/***************************** Shichao ******************************/
+
 bool ParseVectorCompressionType(
     const std::string& value,
     std::vector<CompressionType>* compression_per_level) {
@@ -301,6 +341,22 @@ bool ParseOptionHelper(char* opt_address, const OptionType& opt_type,
       return ParseEnum<InfoLogLevel>(
           info_log_level_string_map, value,
           reinterpret_cast<InfoLogLevel*>(opt_address));
+    case OptionType::kTableIndexType:  // Shichao
+      return ParseEnum<TableOptions::IndexType>(
+          table_index_type_string_map, value,
+          reinterpret_cast<TableOptions::IndexType*>(opt_address));
+    case OptionType::kDataBlockIndexType:  // Shichao
+      return ParseEnum<TableOptions::DataBlockIndexType>(
+          data_block_index_type_string_map, value,
+          reinterpret_cast<TableOptions::DataBlockIndexType*>(opt_address));
+    case OptionType::kChecksumType:  // Shichao
+      return ParseEnum<TableOptions::ChecksumType>(
+          checksum_type_string_map, value,
+          reinterpret_cast<TableOptions::ChecksumType*>(opt_address));
+    case OptionType::kSliceTransform:  // Shichao
+      return ParseSliceTransform(
+          value, reinterpret_cast<std::shared_ptr<const SliceTransform>*>(
+                     opt_address));
     default:
       return false;
   }
@@ -383,6 +439,15 @@ bool SerializeSingleOptionHelper(const char* opt_address,
       *value = ptr->get() ? ptr->get()->Name() : kNullptrString;
       break;
     }
+    /***************************** Shichao ******************************/
+    case OptionType::kSliceTransform: {
+      const auto* ptr =
+          reinterpret_cast<const std::shared_ptr<const SliceTransform>*>(
+              opt_address);
+      *value = ptr->get() ? ptr->get()->Name() : kNullptrString;
+      break;
+    }
+    /***************************** Shichao ******************************/
     case OptionType::kFlushBlockPolicyFactory: {
       const auto* ptr =
           reinterpret_cast<const std::shared_ptr<FlushBlockPolicyFactory>*>(
@@ -402,6 +467,22 @@ bool SerializeSingleOptionHelper(const char* opt_address,
       return SerializeEnum<InfoLogLevel>(
           info_log_level_string_map,
           *reinterpret_cast<const InfoLogLevel*>(opt_address), value);
+    case OptionType::kTableIndexType:  // Shichao
+      return SerializeEnum<TableOptions::IndexType>(
+          table_index_type_string_map,
+          *reinterpret_cast<const TableOptions::IndexType*>(opt_address),
+          value);
+    case OptionType::kDataBlockIndexType:  // Shichao
+      return SerializeEnum<TableOptions::DataBlockIndexType>(
+          data_block_index_type_string_map,
+          *reinterpret_cast<const TableOptions::DataBlockIndexType*>(
+              opt_address),
+          value);
+    case OptionType::kChecksumType:  // Shichao
+      return SerializeEnum<TableOptions::ChecksumType>(
+          checksum_type_string_map,
+          *reinterpret_cast<const TableOptions::ChecksumType*>(opt_address),
+          value);
     default:
       return false;
   }
@@ -418,6 +499,14 @@ bool ParseMemtableOptions(const std::string& name, const std::string& value,
     new_options->arena_block_size = ParseSizeT(value);
   } else if (name == "max_write_buffer_number") {
     new_options->max_write_buffer_number = ParseInt(value);
+  /***************************** Shichao ******************************/
+  } else if (name == "memtable_prefix_bloom_size_ratio") {
+    new_options->memtable_prefix_bloom_size_ratio = ParseDouble(value);
+  } else if (name == "memtable_whole_key_filtering") {
+    new_options->memtable_whole_key_filtering = ParseBoolean(name, value);
+  } else if (name == "memtable_huge_page_size") {
+    new_options->memtable_huge_page_size = ParseSizeT(value);
+  /***************************** Shichao ******************************/
   } else {
     return false;
   }
@@ -977,6 +1066,17 @@ Status GetMemTableRepFactoryFromString(const std::string& opts_str,
     } else if (1 == len) {
       mem_factory = new SkipListFactory();
     }
+  /***************************** Shichao ******************************/
+  } else if (opts_list[0] == "prefix_hash") {
+    // Expecting format
+    // prefix_hash:<hash_bucket_count>
+    if (2 == len) {
+      size_t hash_bucket_count = ParseSizeT(opts_list[1]);
+      mem_factory = NewHashSkipListRepFactory(hash_bucket_count);
+    } else if (1 == len) {
+      mem_factory = NewHashSkipListRepFactory();
+    }
+  /***************************** Shichao ******************************/
   } else {
     return Status::InvalidArgument("Unrecognized memtable_factory option ",
                                    opts_str);
@@ -1143,6 +1243,12 @@ ColumnFamilyOptions BuildColumnFamilyOptions(
   cf_opts.write_buffer_size = mutable_cf_options.write_buffer_size;
   cf_opts.max_write_buffer_number = mutable_cf_options.max_write_buffer_number;
   cf_opts.arena_block_size = mutable_cf_options.arena_block_size;
+  cf_opts.memtable_prefix_bloom_size_ratio =
+      mutable_cf_options.memtable_prefix_bloom_size_ratio;  // Shichao
+  cf_opts.memtable_whole_key_filtering =
+      mutable_cf_options.memtable_whole_key_filtering;  // Shichao
+  cf_opts.memtable_huge_page_size =
+      mutable_cf_options.memtable_huge_page_size;  // Shichao
 
   // Compaction related options
   cf_opts.disable_auto_compactions =
@@ -84,11 +84,15 @@ enum class OptionType {
   kTableFactory,
   kComparator,
   kMemTableRepFactory,
+  kSliceTransform,  // Shichao
   kFlushBlockPolicyFactory,
   kEncodingType,
   kWALRecoveryMode,
   kAccessHint,
   kInfoLogLevel,
+  kTableIndexType,  // Shichao
+  kDataBlockIndexType,  // Shichao
+  kChecksumType,  // Shichao
   kUnknown
 };
 
@@ -217,12 +221,18 @@ static std::unordered_map<std::string, OptionTypeInfo> db_options_type_info = {
     {"base_background_compactions",
      {offsetof(struct DBOptions, base_background_compactions), OptionType::kInt,
       OptionVerificationType::kNormal}},
+    {"background_time_slice_micros",
+     {offsetof(struct DBOptions, background_time_slice_micros),
+      OptionType::kUInt64T, OptionVerificationType::kNormal}},
     {"max_background_flushes",
      {offsetof(struct DBOptions, max_background_flushes), OptionType::kInt,
       OptionVerificationType::kNormal}},
     {"max_file_opening_threads",
      {offsetof(struct DBOptions, max_file_opening_threads), OptionType::kInt,
       OptionVerificationType::kNormal}},
+    {"persist_table_open_state",
+     {offsetof(struct DBOptions, persist_table_open_state),
+      OptionType::kBoolean, OptionVerificationType::kNormal}},
     {"max_open_files",
      {offsetof(struct DBOptions, max_open_files), OptionType::kInt,
       OptionVerificationType::kNormal}},
@@ -283,6 +293,9 @@ static std::unordered_map<std::string, OptionTypeInfo> db_options_type_info = {
     {"stats_dump_period_sec",
      {offsetof(struct DBOptions, stats_dump_period_sec), OptionType::kUInt,
       OptionVerificationType::kNormal}},
+    {"perf_sample_rate",
+     {offsetof(struct DBOptions, perf_sample_rate), OptionType::kUInt32T,
+      OptionVerificationType::kNormal}},
     {"fail_if_options_file_error",
      {offsetof(struct DBOptions, fail_if_options_file_error),
       OptionType::kBoolean, OptionVerificationType::kNormal}},
@@ -328,6 +341,9 @@ static std::unordered_map<std::string, OptionTypeInfo> cf_options_type_info = {
     {"disable_auto_compactions",
      {offsetof(struct ColumnFamilyOptions, disable_auto_compactions),
       OptionType::kBoolean, OptionVerificationType::kNormal}},
+    {"background_job_weight",
+     {offsetof(struct ColumnFamilyOptions, background_job_weight),
+      OptionType::kDouble, OptionVerificationType::kNormal}},
     {"paranoid_file_checks",
      {offsetof(struct ColumnFamilyOptions, paranoid_file_checks),
       OptionType::kBoolean, OptionVerificationType::kNormal}},
@@ -367,6 +383,15 @@ static std::unordered_map<std::string, OptionTypeInfo> cf_options_type_info = {
     {"arena_block_size",
      {offsetof(struct ColumnFamilyOptions, arena_block_size),
       OptionType::kSizeT, OptionVerificationType::kNormal}},
+    {"memtable_prefix_bloom_size_ratio",
+     {offsetof(struct ColumnFamilyOptions, memtable_prefix_bloom_size_ratio),
+      OptionType::kDouble, OptionVerificationType::kNormal}},  // Shichao
+    {"memtable_whole_key_filtering",
+     {offsetof(struct ColumnFamilyOptions, memtable_whole_key_filtering),
+      OptionType::kBoolean, OptionVerificationType::kNormal}},  // Shichao
+    {"memtable_huge_page_size",
+     {offsetof(struct ColumnFamilyOptions, memtable_huge_page_size),
+      OptionType::kSizeT, OptionVerificationType::kNormal}},  // Shichao
     {"write_buffer_size",
      {offsetof(struct ColumnFamilyOptions, write_buffer_size),
       OptionType::kSizeT, OptionVerificationType::kNormal}},
@@ -391,6 +416,9 @@ static std::unordered_map<std::string, OptionTypeInfo> cf_options_type_info = {
     {"memtable_factory",
      {offsetof(struct ColumnFamilyOptions, memtable_factory),
       OptionType::kMemTableRepFactory, OptionVerificationType::kByName}},
+    {"prefix_extractor",
+     {offsetof(struct ColumnFamilyOptions, prefix_extractor),
+      OptionType::kSliceTransform, OptionVerificationType::kByNameAllowNull}},
     {"table_factory",
      {offsetof(struct ColumnFamilyOptions, table_factory),
       OptionType::kTableFactory, OptionVerificationType::kByName}},
@@ -422,7 +450,47 @@ static std::unordered_map<std::string, OptionTypeInfo>
           OptionType::kInt, OptionVerificationType::kNormal}},
         {"index_block_restart_interval",
          {offsetof(struct BlockBasedTableOptions, index_block_restart_interval),
-          OptionType::kInt, OptionVerificationType::kNormal}}};
+          OptionType::kInt, OptionVerificationType::kNormal}},
+        /***************************** Shichao ******************************/
+        {"index_type",
+         {offsetof(struct BlockBasedTableOptions, index_type),
+          OptionType::kTableIndexType, OptionVerificationType::kNormal}},
+        {"metadata_block_size",
+         {offsetof(struct BlockBasedTableOptions, metadata_block_size),
+          OptionType::kUInt64T, OptionVerificationType::kNormal}},
+        {"pin_l0_index_partitions",
+         {offsetof(struct BlockBasedTableOptions, pin_l0_index_partitions),
+          OptionType::kBoolean, OptionVerificationType::kNormal}},
+        {"data_block_index_type",
+         {offsetof(struct BlockBasedTableOptions, data_block_index_type),
+          OptionType::kDataBlockIndexType, OptionVerificationType::kNormal}},
+        {"data_block_hash_table_util_ratio",
+         {offsetof(struct BlockBasedTableOptions,
+                   data_block_hash_table_util_ratio),
+          OptionType::kDouble, OptionVerificationType::kNormal}},
+        {"checksum",
+         {offsetof(struct BlockBasedTableOptions, checksum),
+          OptionType::kChecksumType, OptionVerificationType::kNormal}}};
+        /***************************** Shichao ******************************/
+
+/***************************** Shichao ******************************/
+static std::unordered_map<std::string, TableOptions::IndexType>
+    table_index_type_string_map = {
+        {"kBinarySearch", TableOptions::IndexType::kBinarySearch},
+        {"kTwoLevelIndexSearch", TableOptions::IndexType::kTwoLevelIndexSearch}};
+
+static std::unordered_map<std::string, TableOptions::DataBlockIndexType>
+    data_block_index_type_string_map = {
+        {"kDataBlockBinarySearch",
+         TableOptions::DataBlockIndexType::kDataBlockBinarySearch},
+        {"kDataBlockBinaryAndHash",
+         TableOptions::DataBlockIndexType::kDataBlockBinaryAndHash}};
+
+static std::unordered_map<std::string, TableOptions::ChecksumType>
+    checksum_type_string_map = {
+        {"kCRC32c", TableOptions::ChecksumType::kCRC32c},
+        {"kXXH3", TableOptions::ChecksumType::kXXH3}};
+/***************************** Shichao ******************************/
 
 static std::unordered_map<std::string, CompressionType>
     compression_type_string_map = {
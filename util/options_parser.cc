@@ -558,6 +558,16 @@ bool AreEqualOptions(
     case OptionType::kInfoLogLevel:
       return (*reinterpret_cast<const InfoLogLevel*>(offset1) ==
               *reinterpret_cast<const InfoLogLevel*>(offset2));
+    case OptionType::kTableIndexType:  // Shichao
+      return (*reinterpret_cast<const TableOptions::IndexType*>(offset1) ==
+              *reinterpret_cast<const TableOptions::IndexType*>(offset2));
+    case OptionType::kDataBlockIndexType:  // Shichao
+      return (
+          *reinterpret_cast<const TableOptions::DataBlockIndexType*>(offset1) ==
+          *reinterpret_cast<const TableOptions::DataBlockIndexType*>(offset2));
+    case OptionType::kChecksumType:  // Shichao
+      return (*reinterpret_cast<const TableOptions::ChecksumType*>(offset1) ==
+              *reinterpret_cast<const TableOptions::ChecksumType*>(offset2));
     default:
       if (type_info.verification == OptionVerificationType::kByName ||
           type_info.verification == OptionVerificationType::kByNameAllowNull) {
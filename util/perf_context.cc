@@ -58,6 +58,20 @@ void PerfContext::Reset() {
   bloom_memtable_miss_count = 0;
   bloom_sst_hit_count = 0;
   bloom_sst_miss_count = 0;
+  range_query_count = 0;
+  range_query_memtable_time = 0;
+  range_query_immutable_time = 0;
+  range_query_sst_time = 0;
+  range_query_post_process_time = 0;
+  range_query_trim_time = 0;
+  range_query_trimmed_count = 0;
+  range_query_table_iter_count = 0;
+  column_block_read_count = 0;
+  column_block_read_byte = 0;
+  column_projected_count = 0;
+  column_total_count = 0;
+  splitter_split_time = 0;
+  splitter_stitch_time = 0;
 #endif
 }
 
@@ -109,6 +123,20 @@ std::string PerfContext::ToString(bool exclude_zero_counters) const {
   PERF_CONTEXT_OUTPUT(bloom_memtable_miss_count);
   PERF_CONTEXT_OUTPUT(bloom_sst_hit_count);
   PERF_CONTEXT_OUTPUT(bloom_sst_miss_count);
+  PERF_CONTEXT_OUTPUT(range_query_count);
+  PERF_CONTEXT_OUTPUT(range_query_memtable_time);
+  PERF_CONTEXT_OUTPUT(range_query_immutable_time);
+  PERF_CONTEXT_OUTPUT(range_query_sst_time);
+  PERF_CONTEXT_OUTPUT(range_query_post_process_time);
+  PERF_CONTEXT_OUTPUT(range_query_trim_time);
+  PERF_CONTEXT_OUTPUT(range_query_trimmed_count);
+  PERF_CONTEXT_OUTPUT(range_query_table_iter_count);
+  PERF_CONTEXT_OUTPUT(column_block_read_count);
+  PERF_CONTEXT_OUTPUT(column_block_read_byte);
+  PERF_CONTEXT_OUTPUT(column_projected_count);
+  PERF_CONTEXT_OUTPUT(column_total_count);
+  PERF_CONTEXT_OUTPUT(splitter_split_time);
+  PERF_CONTEXT_OUTPUT(splitter_stitch_time);
   return ss.str();
 #endif
 }
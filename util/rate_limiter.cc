@@ -0,0 +1,267 @@
+//  Copyright (c) 2020-present, VidarDB, Inc.  All rights reserved.
+//  This source code is licensed under the BSD-style license found in the
+//  LICENSE file in the root directory of this source tree. An additional grant
+//  of patent rights can be found in the PATENTS file in the same directory.
+//
+//  Copyright (c) 2011-present, Facebook, Inc.  All rights reserved.
+//  This source code is licensed under the BSD-style license found in the
+//  LICENSE file in the root directory of this source tree. An additional grant
+//  of patent rights can be found in the PATENTS file in the same directory.
+//
+// Copyright (c) 2011 The LevelDB Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file. See the AUTHORS file for names of contributors.
+
+#include "util/rate_limiter.h"
+
+#include <time.h>
+
+#include "util/statistics.h"
+
+namespace vidardb {
+
+namespace {
+// The rate of an auto-tuned limiter with no compaction debt is this fraction
+// of its upper bound.
+const int64_t kAutoTuneMinRatio = 20;
+
+// The order the queues are served in by Refill().
+const Env::IOPriority kServeOrder[] = {Env::IO_HIGH, Env::IO_USER,
+                                       Env::IO_LOW};
+const int kNumServed = sizeof(kServeOrder) / sizeof(kServeOrder[0]);
+
+Tickers WaitTicker(Env::IOPriority pri) {
+  switch (pri) {
+    case Env::IO_HIGH:
+      return RATE_LIMITER_FLUSH_MICROS;
+    case Env::IO_USER:
+      return RATE_LIMITER_USER_MICROS;
+    default:
+      return RATE_LIMITER_COMPACTION_MICROS;
+  }
+}
+}  // anonymous namespace
+
+// Pending request
+struct GenericRateLimiter::Req {
+  explicit Req(int64_t _bytes, port::Mutex* _mu)
+      : request_bytes(_bytes), bytes(_bytes), cv(_mu), granted(false) {}
+  int64_t request_bytes;  // not granted yet
+  int64_t bytes;
+  port::CondVar cv;
+  bool granted;
+};
+
+GenericRateLimiter::GenericRateLimiter(int64_t rate_bytes_per_sec,
+                                       int64_t refill_period_us,
+                                       int32_t fairness, bool auto_tuned,
+                                       uint64_t auto_tune_pending_bytes)
+    : refill_period_us_(refill_period_us),
+      rate_bytes_per_sec_(rate_bytes_per_sec),
+      refill_bytes_per_period_(
+          CalculateRefillBytesPerPeriod(rate_bytes_per_sec)),
+      env_(Env::Default()),
+      auto_tuned_(auto_tuned),
+      auto_tune_pending_bytes_(auto_tune_pending_bytes),
+      max_bytes_per_sec_(rate_bytes_per_sec),
+      pending_compaction_bytes_(0),
+      stop_(false),
+      exit_cv_(&request_mutex_),
+      requests_to_wait_(0),
+      available_bytes_(0),
+      next_refill_us_(env_->NowMicros()),
+      fairness_(fairness > 100 ? 100 : fairness),
+      rnd_(static_cast<uint32_t>(time(nullptr))),
+      leader_(nullptr) {
+  for (int i = 0; i < kNumPriorities; ++i) {
+    total_requests_[i] = 0;
+    total_bytes_through_[i] = 0;
+  }
+  if (auto_tuned_) {
+    MutexLock g(&request_mutex_);
+    TuneLocked();
+  }
+}
+
+GenericRateLimiter::~GenericRateLimiter() {
+  MutexLock g(&request_mutex_);
+  stop_ = true;
+  for (auto& queue : queue_) {
+    for (auto* r : queue) {
+      r->cv.Signal();
+    }
+  }
+  while (requests_to_wait_ > 0) {
+    exit_cv_.Wait();
+  }
+}
+
+void GenericRateLimiter::SetBytesPerSecond(int64_t bytes_per_second) {
+  assert(bytes_per_second > 0);
+  MutexLock g(&request_mutex_);
+  max_bytes_per_sec_ = bytes_per_second;
+  if (auto_tuned_) {
+    TuneLocked();
+  } else {
+    SetRate(bytes_per_second);
+  }
+}
+
+void GenericRateLimiter::Tune(uint64_t pending_compaction_bytes) {
+  if (!auto_tuned_) {
+    return;
+  }
+  MutexLock g(&request_mutex_);
+  pending_compaction_bytes_ = pending_compaction_bytes;
+  TuneLocked();
+}
+
+void GenericRateLimiter::TuneLocked() {
+  double ratio = 1.0;
+  if (pending_compaction_bytes_ < auto_tune_pending_bytes_) {
+    ratio = static_cast<double>(pending_compaction_bytes_) /
+            auto_tune_pending_bytes_;
+  }
+  int64_t rate = static_cast<int64_t>(max_bytes_per_sec_ * ratio);
+  SetRate(std::max(rate, std::max<int64_t>(1, max_bytes_per_sec_ /
+                                                  kAutoTuneMinRatio)));
+}
+
+void GenericRateLimiter::SetRate(int64_t rate_bytes_per_sec) {
+  rate_bytes_per_sec_.store(rate_bytes_per_sec, std::memory_order_relaxed);
+  refill_bytes_per_period_.store(
+      CalculateRefillBytesPerPeriod(rate_bytes_per_sec),
+      std::memory_order_relaxed);
+}
+
+void GenericRateLimiter::Request(int64_t bytes, const Env::IOPriority pri,
+                                 Statistics* stats) {
+  assert(pri != Env::IO_TOTAL && pri < kNumPriorities);
+  MutexLock g(&request_mutex_);
+  if (stop_) {
+    return;
+  }
+  // the burst may have shrunk since the caller asked for it
+  bytes = std::min(bytes, refill_bytes_per_period_.load(
+                              std::memory_order_relaxed));
+  ++total_requests_[pri];
+
+  if (available_bytes_ >= bytes) {
+    // the quota left over by the last refill
+    available_bytes_ -= bytes;
+    total_bytes_through_[pri] += bytes;
+    return;
+  }
+
+  // Request cannot be satisfied at this moment, enqueue
+  uint64_t start = env_->NowMicros();
+  Req r(bytes, &request_mutex_);
+  queue_[pri].push_back(&r);
+  ++requests_to_wait_;
+
+  do {
+    if (leader_ == nullptr) {
+      // Sleep until the next refill, whose grants include the leader's own
+      // request sooner or later.
+      leader_ = &r;
+      if (env_->NowMicros() < next_refill_us_) {
+        r.cv.TimedWait(next_refill_us_);
+      }
+      if (!stop_ && env_->NowMicros() >= next_refill_us_) {
+        Refill();
+      }
+      leader_ = nullptr;
+      if (r.granted) {
+        // hand the leadership over to a request still waiting
+        for (auto& queue : queue_) {
+          if (!queue.empty()) {
+            queue.front()->cv.Signal();
+            break;
+          }
+        }
+      }
+    } else {
+      // wait until granted, or elected as the leader
+      r.cv.Wait();
+    }
+  } while (!r.granted && !stop_);
+
+  if (--requests_to_wait_ == 0 && stop_) {
+    exit_cv_.Signal();
+  }
+  RecordTick(stats, WaitTicker(pri), env_->NowMicros() - start);
+}
+
+void GenericRateLimiter::Refill() {
+  next_refill_us_ = env_->NowMicros() + refill_period_us_;
+  // Carry over the left over quota from the last period
+  auto refill_bytes_per_period =
+      refill_bytes_per_period_.load(std::memory_order_relaxed);
+  if (available_bytes_ < refill_bytes_per_period) {
+    available_bytes_ += refill_bytes_per_period;
+  }
+
+  // the lower priorities go first with a chance of 1/fairness
+  bool reverse = fairness_ > 1 && rnd_.OneIn(fairness_);
+  for (int i = 0; i < kNumServed && available_bytes_ > 0; ++i) {
+    Env::IOPriority pri = kServeOrder[reverse ? kNumServed - 1 - i : i];
+    auto* queue = &queue_[pri];
+    while (!queue->empty()) {
+      auto* next_req = queue->front();
+      if (available_bytes_ < next_req->request_bytes) {
+        // the rest of the request is granted by the next refills
+        next_req->request_bytes -= available_bytes_;
+        available_bytes_ = 0;
+        break;
+      }
+      available_bytes_ -= next_req->request_bytes;
+      next_req->request_bytes = 0;
+      total_bytes_through_[pri] += next_req->bytes;
+      queue->pop_front();
+
+      next_req->granted = true;
+      if (next_req != leader_) {
+        // Quota granted, signal the thread
+        next_req->cv.Signal();
+      }
+    }
+  }
+}
+
+int64_t GenericRateLimiter::GetTotalBytesThrough(
+    const Env::IOPriority pri) const {
+  MutexLock g(&request_mutex_);
+  if (pri == Env::IO_TOTAL) {
+    int64_t total = 0;
+    for (int i = 0; i < kNumPriorities; ++i) {
+      total += total_bytes_through_[i];
+    }
+    return total;
+  }
+  return total_bytes_through_[pri];
+}
+
+int64_t GenericRateLimiter::GetTotalRequests(const Env::IOPriority pri) const {
+  MutexLock g(&request_mutex_);
+  if (pri == Env::IO_TOTAL) {
+    int64_t total = 0;
+    for (int i = 0; i < kNumPriorities; ++i) {
+      total += total_requests_[i];
+    }
+    return total;
+  }
+  return total_requests_[pri];
+}
+
+RateLimiter* NewGenericRateLimiter(int64_t rate_bytes_per_sec,
+                                   int64_t refill_period_us, int32_t fairness,
+                                   bool auto_tuned,
+                                   uint64_t auto_tune_pending_bytes) {
+  assert(rate_bytes_per_sec > 0);
+  assert(refill_period_us > 0);
+  assert(fairness > 0);
+  return new GenericRateLimiter(rate_bytes_per_sec, refill_period_us, fairness,
+                                auto_tuned, auto_tune_pending_bytes);
+}
+
+}  // namespace vidardb
@@ -0,0 +1,115 @@
+//  Copyright (c) 2020-present, VidarDB, Inc.  All rights reserved.
+//  This source code is licensed under the BSD-style license found in the
+//  LICENSE file in the root directory of this source tree. An additional grant
+//  of patent rights can be found in the PATENTS file in the same directory.
+//
+//  Copyright (c) 2011-present, Facebook, Inc.  All rights reserved.
+//  This source code is licensed under the BSD-style license found in the
+//  LICENSE file in the root directory of this source tree. An additional grant
+//  of patent rights can be found in the PATENTS file in the same directory.
+//
+// Copyright (c) 2011 The LevelDB Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file. See the AUTHORS file for names of contributors.
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <deque>
+
+#include "port/port.h"
+#include "util/mutexlock.h"
+#include "util/random.h"
+#include "vidardb/env.h"
+#include "vidardb/rate_limiter.h"
+
+namespace vidardb {
+
+// A token bucket refilled every refill_period_us. A request which does not
+// fit the bucket waits in the queue of its priority. One of the waiting
+// requests, the leader, sleeps until the next refill and grants the queued
+// requests in priority order.
+class GenericRateLimiter : public RateLimiter {
+ public:
+  GenericRateLimiter(int64_t rate_bytes_per_sec, int64_t refill_period_us,
+                     int32_t fairness, bool auto_tuned,
+                     uint64_t auto_tune_pending_bytes);
+
+  virtual ~GenericRateLimiter();
+
+  // This API allows user to dynamically change rate limiter's bytes per second.
+  // For an auto-tuned limiter it changes the upper bound of the rate.
+  virtual void SetBytesPerSecond(int64_t bytes_per_second) override;
+
+  // Request for token to write bytes. If this request can not be satisfied,
+  // the call is blocked. Caller is responsible to make sure
+  // bytes <= GetSingleBurstBytes()
+  virtual void Request(const int64_t bytes, const Env::IOPriority pri,
+                       Statistics* stats) override;
+
+  virtual int64_t GetSingleBurstBytes() const override {
+    return refill_bytes_per_period_.load(std::memory_order_relaxed);
+  }
+
+  virtual int64_t GetTotalBytesThrough(
+      const Env::IOPriority pri = Env::IO_TOTAL) const override;
+
+  virtual int64_t GetTotalRequests(
+      const Env::IOPriority pri = Env::IO_TOTAL) const override;
+
+  virtual int64_t GetBytesPerSecond() const override {
+    return rate_bytes_per_sec_.load(std::memory_order_relaxed);
+  }
+
+  virtual void Tune(uint64_t pending_compaction_bytes) override;
+
+ private:
+  struct Req;
+
+  // The per priority arrays are indexed by Env::IOPriority, IO_USER coming
+  // after IO_TOTAL, whose slot is unused.
+  static const int kNumPriorities = Env::IO_USER + 1;
+
+  void Refill();
+  // Set the rate of an auto-tuned limiter from pending_compaction_bytes_.
+  // REQUIRES: request_mutex_ held
+  void TuneLocked();
+  // REQUIRES: request_mutex_ held
+  void SetRate(int64_t rate_bytes_per_sec);
+  int64_t CalculateRefillBytesPerPeriod(int64_t rate_bytes_per_sec) {
+    return std::max<int64_t>(1, rate_bytes_per_sec * refill_period_us_ /
+                                    1000000);
+  }
+
+  // This mutex guard all internal states
+  mutable port::Mutex request_mutex_;
+
+  const int64_t refill_period_us_;
+  std::atomic<int64_t> rate_bytes_per_sec_;
+  std::atomic<int64_t> refill_bytes_per_period_;
+  Env* const env_;
+
+  // the upper bound of the rate of an auto-tuned limiter
+  const bool auto_tuned_;
+  const uint64_t auto_tune_pending_bytes_;
+  int64_t max_bytes_per_sec_;
+  uint64_t pending_compaction_bytes_;
+
+  bool stop_;
+  port::CondVar exit_cv_;
+  int32_t requests_to_wait_;
+
+  int64_t total_requests_[kNumPriorities];
+  int64_t total_bytes_through_[kNumPriorities];
+  int64_t available_bytes_;
+  uint64_t next_refill_us_;
+
+  int32_t fairness_;
+  Random rnd_;
+
+  Req* leader_;
+  std::deque<Req*> queue_[kNumPriorities];
+};
+
+}  // namespace vidardb
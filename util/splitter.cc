@@ -6,6 +6,11 @@
 #include "vidardb/splitter.h"
 
 #include <string.h>
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
 
 #include <string>
 #include <vector>
@@ -15,38 +20,93 @@
 
 namespace vidardb {
 
-std::vector<Slice> PipeSplitter::Split(const Slice& s) const {
-  const char* p = s.data();
-  std::vector<Slice> res;
-  for (auto i = 0u, j = 0u; i < s.size();) {
-    if (s[i] != delim && i + 1 < s.size()) {
-      i++;
-      continue;
+namespace {
+// Call f(i) for each position i of delim in [0, n), in ascending order. The
+// bytes are compared 32 (AVX2) or 16 (SSE2) at a time where available, with a
+// scalar loop for the tail.
+template <typename F>
+inline void ForEachDelim(const char* p, size_t n, char delim, F f) {
+  size_t i = 0;
+#if defined(__AVX2__)
+  const __m256i d32 = _mm256_set1_epi8(delim);
+  for (; i + 32 <= n; i += 32) {
+    __m256i chunk =
+        _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + i));
+    uint32_t mask = static_cast<uint32_t>(
+        _mm256_movemask_epi8(_mm256_cmpeq_epi8(chunk, d32)));
+    while (mask) {
+      f(i + __builtin_ctz(mask));
+      mask &= mask - 1;
     }
-
-    size_t n = i - j;
-    if (i + 1 == s.size()) {
-      n = i + 1 - j;  // last
+  }
+#endif
+#if defined(__SSE2__)
+  const __m128i d16 = _mm_set1_epi8(delim);
+  for (; i + 16 <= n; i += 16) {
+    __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + i));
+    uint32_t mask = static_cast<uint32_t>(
+        _mm_movemask_epi8(_mm_cmpeq_epi8(chunk, d16)));
+    while (mask) {
+      f(i + __builtin_ctz(mask));
+      mask &= mask - 1;
+    }
+  }
+#endif
+  for (; i < n; i++) {
+    if (p[i] == delim) {
+      f(i);
     }
-
-    res.emplace_back(Slice(p + j, n));
-    j = ++i;
   }
+}
+}  // anonymous namespace
+
+std::vector<Slice> PipeSplitter::Split(const Slice& s) const {
+  std::vector<Slice> res;
+  Split(s, res);
   return res;
 }
 
+void PipeSplitter::Split(const Slice& s, std::vector<Slice>& res) const {
+  res.clear();
+  if (s.empty()) {
+    return;
+  }
+
+  // a delimiter at the last byte belongs to the last sub-slice
+  const char* p = s.data();
+  size_t j = 0;
+  ForEachDelim(p, s.size() - 1, delim, [&](size_t i) {
+    res.emplace_back(p + j, i - j);
+    j = i + 1;
+  });
+  res.emplace_back(p + j, s.size() - j);  // last
+}
+
 std::string PipeSplitter::Stitch(const std::vector<Slice>& v) const {
   std::string res;  // RVO/NRVO/move
-  for (auto i = 0u; i < v.size(); i++) {
-    Append(res, v[i], i + 1 == v.size());
-  }
+  Stitch(v, res);
   return res;
 }
 
 Slice PipeSplitter::Stitch(const std::vector<Slice>& v,
                            std::string& buf) const {
+  if (v.empty()) {
+    return buf;
+  }
+  // size buf once and copy the sub-slices into place
+  size_t n = v.size() - 1;
+  for (const auto& s : v) {
+    n += s.size();
+  }
+  size_t offset = buf.size();
+  buf.resize(offset + n);
+  char* dst = &buf[offset];
   for (auto i = 0u; i < v.size(); i++) {
-    Append(buf, v[i], i + 1 == v.size());
+    memcpy(dst, v[i].data_, v[i].size_);
+    dst += v[i].size_;
+    if (i + 1 < v.size()) {
+      *dst++ = delim;
+    }
   }
   return buf;
 }
@@ -61,26 +121,41 @@ void PipeSplitter::Append(std::string& ss, const Slice& s, bool last) const {
 Splitter* NewPipeSplitter() { return new PipeSplitter(); }
 
 std::vector<Slice> EncodingSplitter::Split(const Slice& s) const {
-  Slice val, ss(s.data_, s.size_);
   std::vector<Slice> res;
+  Split(s, res);
+  return res;
+}
+
+void EncodingSplitter::Split(const Slice& s, std::vector<Slice>& res) const {
+  // the lengths are not known before they are decoded, there is nothing to
+  // scan for
+  res.clear();
+  Slice val, ss(s.data_, s.size_);
   while (GetLengthPrefixedSlice(&ss, &val)) {
     res.emplace_back(val);
   }
-  return res;
 }
 
 std::string EncodingSplitter::Stitch(const std::vector<Slice>& v) const {
   std::string res;  // RVO/NRVO/move
-  for (const auto& s: v) {
-    Append(res, s, false);
-  }
+  Stitch(v, res);
   return res;
 }
 
 Slice EncodingSplitter::Stitch(const std::vector<Slice>& v,
                                std::string& buf) const {
+  // size buf once and encode the sub-slices into place
+  size_t n = 0;
+  for (const auto& s : v) {
+    n += VarintLength(s.size()) + s.size();
+  }
+  size_t offset = buf.size();
+  buf.resize(offset + n);
+  char* dst = &buf[offset];
   for (const auto& s : v) {
-    Append(buf, s, false);
+    dst = EncodeVarint32(dst, static_cast<uint32_t>(s.size_));
+    memcpy(dst, s.data_, s.size_);
+    dst += s.size_;
   }
   return buf;
 }
@@ -101,12 +101,14 @@ static OperationProperty compaction_operation_properties[] = {
   {ThreadStatus::COMPACTION_TOTAL_INPUT_BYTES, "TotalInputBytes"},
   {ThreadStatus::COMPACTION_BYTES_READ, "BytesRead"},
   {ThreadStatus::COMPACTION_BYTES_WRITTEN, "BytesWritten"},
+  {ThreadStatus::COMPACTION_CPU_MICROS, "CPUMicros"},  // Shichao
 };
 
 static OperationProperty flush_operation_properties[] = {
   {ThreadStatus::FLUSH_JOB_ID, "JobID"},
   {ThreadStatus::FLUSH_BYTES_MEMTABLES, "BytesMemtables"},
-  {ThreadStatus::FLUSH_BYTES_WRITTEN, "BytesWritten"}
+  {ThreadStatus::FLUSH_BYTES_WRITTEN, "BytesWritten"},
+  {ThreadStatus::FLUSH_CPU_MICROS, "CPUMicros"}  // Shichao
 };
 
 #else
@@ -0,0 +1,86 @@
+//  Copyright (c) 2020-present, VidarDB, Inc.  All rights reserved.
+//  This source code is licensed under the BSD-style license found in the
+//  LICENSE file in the root directory of this source tree. An additional grant
+//  of patent rights can be found in the PATENTS file in the same directory.
+
+#include <memory>
+
+#include "vidardb/compaction_filter.h"
+#include "vidardb/env.h"
+
+namespace vidardb {
+
+namespace {
+// Parse a decimal number of seconds, return false if it is malformed.
+bool ParseTimestamp(const Slice& s, uint64_t* ts) {
+  if (s.empty() || s.size() > 19) {  // at most 19 digits fit in 64 bits
+    return false;
+  }
+  uint64_t v = 0;
+  for (size_t i = 0; i < s.size(); i++) {
+    const char c = s[i];
+    if (c < '0' || c > '9') {
+      return false;
+    }
+    v = v * 10 + static_cast<uint64_t>(c - '0');
+  }
+  *ts = v;
+  return true;
+}
+
+class TTLCompactionFilter : public CompactionFilter {
+ public:
+  TTLCompactionFilter(uint32_t timestamp_column, uint64_t ttl_seconds,
+                      uint64_t now_seconds)
+      : timestamp_column_(timestamp_column),
+        // the rows stamped before the cutoff are expired
+        cutoff_(now_seconds > ttl_seconds ? now_seconds - ttl_seconds : 0) {}
+
+  virtual uint32_t FilteredColumn() const override {
+    return timestamp_column_;
+  }
+
+  virtual bool FilterColumn(int level, const Slice& key,
+                            const Slice& column_value) const override {
+    uint64_t ts;
+    return ParseTimestamp(column_value, &ts) && ts < cutoff_;
+  }
+
+  virtual const char* Name() const override { return "TTLCompactionFilter"; }
+
+ private:
+  const uint32_t timestamp_column_;
+  const uint64_t cutoff_;
+};
+
+class TTLCompactionFilterFactory : public CompactionFilterFactory {
+ public:
+  TTLCompactionFilterFactory(uint32_t timestamp_column, uint64_t ttl_seconds,
+                             Env* env)
+      : timestamp_column_(timestamp_column),
+        ttl_seconds_(ttl_seconds),
+        env_(env != nullptr ? env : Env::Default()) {}
+
+  virtual std::unique_ptr<CompactionFilter> CreateCompactionFilter(
+      const CompactionFilter::Context& context) override {
+    return std::unique_ptr<CompactionFilter>(new TTLCompactionFilter(
+        timestamp_column_, ttl_seconds_, env_->NowMicros() / 1000000));
+  }
+
+  virtual const char* Name() const override {
+    return "TTLCompactionFilterFactory";
+  }
+
+ private:
+  const uint32_t timestamp_column_;
+  const uint64_t ttl_seconds_;
+  Env* const env_;
+};
+}  // anonymous namespace
+
+CompactionFilterFactory* NewTTLCompactionFilterFactory(
+    uint32_t timestamp_column, uint64_t ttl_seconds, Env* env) {
+  return new TTLCompactionFilterFactory(timestamp_column, ttl_seconds, env);
+}
+
+}  // namespace vidardb
@@ -0,0 +1,339 @@
+//  Copyright (c) 2020-present, VidarDB, Inc.  All rights reserved.
+//  This source code is licensed under the BSD-style license found in the
+//  LICENSE file in the root directory of this source tree. An additional grant
+//  of patent rights can be found in the PATENTS file in the same directory.
+
+#include "util/xxh3.h"
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#include "util/coding.h"
+
+namespace vidardb {
+
+namespace {
+const uint32_t kPrime32_1 = 0x9E3779B1U;
+const uint32_t kPrime32_2 = 0x85EBCA77U;
+const uint32_t kPrime32_3 = 0xC2B2AE3DU;
+const uint64_t kPrime64_1 = 0x9E3779B185EBCA87ULL;
+const uint64_t kPrime64_2 = 0xC2B2AE3D27D4EB4FULL;
+const uint64_t kPrime64_3 = 0x165667B19E3779F9ULL;
+const uint64_t kPrime64_4 = 0x85EBCA77C2B2AE63ULL;
+const uint64_t kPrime64_5 = 0x27D4EB2F165667C5ULL;
+const uint64_t kPrimeMx1 = 0x165667919E3779F9ULL;
+const uint64_t kPrimeMx2 = 0x9FB21C651E98DF25ULL;
+
+const size_t kSecretSize = 192;
+const size_t kStripeLen = 64;
+const size_t kSecretConsumeRate = 8;
+const size_t kAccNb = kStripeLen / sizeof(uint64_t);
+const size_t kSecretLastAccStart = 7;
+const size_t kSecretMergeAccsStart = 11;
+const size_t kMidSizeMax = 240;
+const size_t kMidSizeStartOffset = 3;
+const size_t kMidSizeLastOffset = 17;
+const size_t kSecretSizeMin = 136;
+
+alignas(64) const uint8_t kSecret[kSecretSize] = {
+    0xb8, 0xfe, 0x6c, 0x39, 0x23, 0xa4, 0x4b, 0xbe, 0x7c, 0x01, 0x81, 0x2c,
+    0xf7, 0x21, 0xad, 0x1c, 0xde, 0xd4, 0x6d, 0xe9, 0x83, 0x90, 0x97, 0xdb,
+    0x72, 0x40, 0xa4, 0xa4, 0xb7, 0xb3, 0x67, 0x1f, 0xcb, 0x79, 0xe6, 0x4e,
+    0xcc, 0xc0, 0xe5, 0x78, 0x82, 0x5a, 0xd0, 0x7d, 0xcc, 0xff, 0x72, 0x21,
+    0xb8, 0x08, 0x46, 0x74, 0xf7, 0x43, 0x24, 0x8e, 0xe0, 0x35, 0x90, 0xe6,
+    0x81, 0x3a, 0x26, 0x4c, 0x3c, 0x28, 0x52, 0xbb, 0x91, 0xc3, 0x00, 0xcb,
+    0x88, 0xd0, 0x65, 0x8b, 0x1b, 0x53, 0x2e, 0xa3, 0x71, 0x64, 0x48, 0x97,
+    0xa2, 0x0d, 0xf9, 0x4e, 0x38, 0x19, 0xef, 0x46, 0xa9, 0xde, 0xac, 0xd8,
+    0xa8, 0xfa, 0x76, 0x3f, 0xe3, 0x9c, 0x34, 0x3f, 0xf9, 0xdc, 0xbb, 0xc7,
+    0xc7, 0x0b, 0x4f, 0x1d, 0x8a, 0x51, 0xe0, 0x4b, 0xcd, 0xb4, 0x59, 0x31,
+    0xc8, 0x9f, 0x7e, 0xc9, 0xd9, 0x78, 0x73, 0x64, 0xea, 0xc5, 0xac, 0x83,
+    0x34, 0xd3, 0xeb, 0xc3, 0xc5, 0x81, 0xa0, 0xff, 0xfa, 0x13, 0x63, 0xeb,
+    0x17, 0x0d, 0xdd, 0x51, 0xb7, 0xf0, 0xda, 0x49, 0xd3, 0x16, 0x55, 0x26,
+    0x29, 0xd4, 0x68, 0x9e, 0x2b, 0x16, 0xbe, 0x58, 0x7d, 0x47, 0xa1, 0xfc,
+    0x8f, 0xf8, 0xb8, 0xd1, 0x7a, 0xd0, 0x31, 0xce, 0x45, 0xcb, 0x3a, 0x8f,
+    0x95, 0x16, 0x04, 0x28, 0xaf, 0xd7, 0xfb, 0xca, 0xbb, 0x4b, 0x40, 0x7e,
+};
+
+inline uint64_t Read64(const uint8_t* p) {
+  return DecodeFixed64(reinterpret_cast<const char*>(p));
+}
+
+inline uint32_t Read32(const uint8_t* p) {
+  return DecodeFixed32(reinterpret_cast<const char*>(p));
+}
+
+inline uint64_t Rotl64(uint64_t x, int r) { return (x << r) | (x >> (64 - r)); }
+
+inline uint32_t Swap32(uint32_t x) { return __builtin_bswap32(x); }
+
+inline uint64_t Swap64(uint64_t x) { return __builtin_bswap64(x); }
+
+// The lower and the upper halves of the 128 bits product xor-ed.
+inline uint64_t Mul128Fold64(uint64_t lhs, uint64_t rhs) {
+#if defined(__SIZEOF_INT128__)
+  unsigned __int128 product = static_cast<unsigned __int128>(lhs) * rhs;
+  return static_cast<uint64_t>(product) ^
+         static_cast<uint64_t>(product >> 64);
+#else
+  uint64_t lo_lo = (lhs & 0xFFFFFFFF) * (rhs & 0xFFFFFFFF);
+  uint64_t hi_lo = (lhs >> 32) * (rhs & 0xFFFFFFFF);
+  uint64_t lo_hi = (lhs & 0xFFFFFFFF) * (rhs >> 32);
+  uint64_t hi_hi = (lhs >> 32) * (rhs >> 32);
+  uint64_t cross = (lo_lo >> 32) + (hi_lo & 0xFFFFFFFF) + lo_hi;
+  uint64_t upper = (hi_lo >> 32) + (cross >> 32) + hi_hi;
+  uint64_t lower = (cross << 32) | (lo_lo & 0xFFFFFFFF);
+  return lower ^ upper;
+#endif
+}
+
+inline uint64_t XXH64Avalanche(uint64_t h) {
+  h ^= h >> 33;
+  h *= kPrime64_2;
+  h ^= h >> 29;
+  h *= kPrime64_3;
+  h ^= h >> 32;
+  return h;
+}
+
+inline uint64_t Avalanche(uint64_t h) {
+  h ^= h >> 37;
+  h *= kPrimeMx1;
+  h ^= h >> 32;
+  return h;
+}
+
+inline uint64_t Rrmxmx(uint64_t h, uint64_t len) {
+  h ^= Rotl64(h, 49) ^ Rotl64(h, 24);
+  h *= kPrimeMx2;
+  h ^= (h >> 35) + len;
+  h *= kPrimeMx2;
+  h ^= h >> 28;
+  return h;
+}
+
+inline uint64_t Len1To3(const uint8_t* input, size_t len) {
+  const uint8_t c1 = input[0];
+  const uint8_t c2 = input[len >> 1];
+  const uint8_t c3 = input[len - 1];
+  const uint32_t combined = (static_cast<uint32_t>(c1) << 16) |
+                            (static_cast<uint32_t>(c2) << 24) |
+                            (static_cast<uint32_t>(c3) << 0) |
+                            (static_cast<uint32_t>(len) << 8);
+  const uint64_t bitflip = Read32(kSecret) ^ Read32(kSecret + 4);
+  return XXH64Avalanche(static_cast<uint64_t>(combined) ^ bitflip);
+}
+
+inline uint64_t Len4To8(const uint8_t* input, size_t len) {
+  const uint32_t input1 = Read32(input);
+  const uint32_t input2 = Read32(input + len - 4);
+  const uint64_t bitflip = Read64(kSecret + 8) ^ Read64(kSecret + 16);
+  const uint64_t input64 = input2 + (static_cast<uint64_t>(input1) << 32);
+  return Rrmxmx(input64 ^ bitflip, len);
+}
+
+inline uint64_t Len9To16(const uint8_t* input, size_t len) {
+  const uint64_t bitflip1 = Read64(kSecret + 24) ^ Read64(kSecret + 32);
+  const uint64_t bitflip2 = Read64(kSecret + 40) ^ Read64(kSecret + 48);
+  const uint64_t input_lo = Read64(input) ^ bitflip1;
+  const uint64_t input_hi = Read64(input + len - 8) ^ bitflip2;
+  const uint64_t acc = len + Swap64(input_lo) + input_hi +
+                       Mul128Fold64(input_lo, input_hi);
+  return Avalanche(acc);
+}
+
+inline uint64_t Len0To16(const uint8_t* input, size_t len) {
+  if (len > 8) {
+    return Len9To16(input, len);
+  }
+  if (len >= 4) {
+    return Len4To8(input, len);
+  }
+  if (len > 0) {
+    return Len1To3(input, len);
+  }
+  return XXH64Avalanche(Read64(kSecret + 56) ^ Read64(kSecret + 64));
+}
+
+inline uint64_t Mix16B(const uint8_t* input, const uint8_t* secret) {
+  return Mul128Fold64(Read64(input) ^ Read64(secret),
+                      Read64(input + 8) ^ Read64(secret + 8));
+}
+
+inline uint64_t Len17To128(const uint8_t* input, size_t len) {
+  uint64_t acc = len * kPrime64_1;
+  if (len > 32) {
+    if (len > 64) {
+      if (len > 96) {
+        acc += Mix16B(input + 48, kSecret + 96);
+        acc += Mix16B(input + len - 64, kSecret + 112);
+      }
+      acc += Mix16B(input + 32, kSecret + 64);
+      acc += Mix16B(input + len - 48, kSecret + 80);
+    }
+    acc += Mix16B(input + 16, kSecret + 32);
+    acc += Mix16B(input + len - 32, kSecret + 48);
+  }
+  acc += Mix16B(input, kSecret);
+  acc += Mix16B(input + len - 16, kSecret + 16);
+  return Avalanche(acc);
+}
+
+uint64_t Len129To240(const uint8_t* input, size_t len) {
+  uint64_t acc = len * kPrime64_1;
+  const size_t nb_rounds = len / 16;
+  for (size_t i = 0; i < 8; i++) {
+    acc += Mix16B(input + 16 * i, kSecret + 16 * i);
+  }
+  acc = Avalanche(acc);
+  for (size_t i = 8; i < nb_rounds; i++) {
+    acc += Mix16B(input + 16 * i, kSecret + 16 * (i - 8) + kMidSizeStartOffset);
+  }
+  acc += Mix16B(input + len - 16,
+                kSecret + kSecretSizeMin - kMidSizeLastOffset);
+  return Avalanche(acc);
+}
+
+// Accumulate a stripe of 64 bytes, each lane adds the product of the halves
+// of its keyed input and the input of its neighbour.
+inline void Accumulate512(uint64_t* acc, const uint8_t* input,
+                          const uint8_t* secret) {
+#if defined(__AVX2__)
+  __m256i* xacc = reinterpret_cast<__m256i*>(acc);
+  for (size_t i = 0; i < kStripeLen / sizeof(__m256i); i++) {
+    __m256i data_vec = _mm256_loadu_si256(
+        reinterpret_cast<const __m256i*>(input) + i);
+    __m256i key_vec = _mm256_loadu_si256(
+        reinterpret_cast<const __m256i*>(secret) + i);
+    __m256i data_key = _mm256_xor_si256(data_vec, key_vec);
+    __m256i data_key_lo = _mm256_srli_epi64(data_key, 32);
+    __m256i product = _mm256_mul_epu32(data_key, data_key_lo);
+    __m256i data_swap = _mm256_shuffle_epi32(data_vec, _MM_SHUFFLE(1, 0, 3, 2));
+    __m256i sum = _mm256_add_epi64(_mm256_load_si256(xacc + i), data_swap);
+    _mm256_store_si256(xacc + i, _mm256_add_epi64(product, sum));
+  }
+#elif defined(__SSE2__)
+  __m128i* xacc = reinterpret_cast<__m128i*>(acc);
+  for (size_t i = 0; i < kStripeLen / sizeof(__m128i); i++) {
+    __m128i data_vec =
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(input) + i);
+    __m128i key_vec =
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(secret) + i);
+    __m128i data_key = _mm_xor_si128(data_vec, key_vec);
+    __m128i data_key_lo = _mm_shuffle_epi32(data_key, _MM_SHUFFLE(0, 3, 0, 1));
+    __m128i product = _mm_mul_epu32(data_key, data_key_lo);
+    __m128i data_swap = _mm_shuffle_epi32(data_vec, _MM_SHUFFLE(1, 0, 3, 2));
+    __m128i sum = _mm_add_epi64(_mm_load_si128(xacc + i), data_swap);
+    _mm_store_si128(xacc + i, _mm_add_epi64(product, sum));
+  }
+#else
+  for (size_t i = 0; i < kAccNb; i++) {
+    const uint64_t data_val = Read64(input + 8 * i);
+    const uint64_t data_key = data_val ^ Read64(secret + 8 * i);
+    acc[i ^ 1] += data_val;
+    acc[i] += (data_key & 0xFFFFFFFF) * (data_key >> 32);
+  }
+#endif
+}
+
+inline void ScrambleAcc(uint64_t* acc, const uint8_t* secret) {
+#if defined(__AVX2__)
+  __m256i* xacc = reinterpret_cast<__m256i*>(acc);
+  const __m256i prime32 = _mm256_set1_epi32(static_cast<int>(kPrime32_1));
+  for (size_t i = 0; i < kStripeLen / sizeof(__m256i); i++) {
+    __m256i acc_vec = _mm256_load_si256(xacc + i);
+    __m256i shifted = _mm256_srli_epi64(acc_vec, 47);
+    __m256i data_vec = _mm256_xor_si256(acc_vec, shifted);
+    __m256i key_vec = _mm256_loadu_si256(
+        reinterpret_cast<const __m256i*>(secret) + i);
+    __m256i data_key = _mm256_xor_si256(data_vec, key_vec);
+    __m256i data_key_hi = _mm256_srli_epi64(data_key, 32);
+    __m256i prod_lo = _mm256_mul_epu32(data_key, prime32);
+    __m256i prod_hi = _mm256_mul_epu32(data_key_hi, prime32);
+    _mm256_store_si256(
+        xacc + i, _mm256_add_epi64(prod_lo, _mm256_slli_epi64(prod_hi, 32)));
+  }
+#elif defined(__SSE2__)
+  __m128i* xacc = reinterpret_cast<__m128i*>(acc);
+  const __m128i prime32 = _mm_set1_epi32(static_cast<int>(kPrime32_1));
+  for (size_t i = 0; i < kStripeLen / sizeof(__m128i); i++) {
+    __m128i acc_vec = _mm_load_si128(xacc + i);
+    __m128i shifted = _mm_srli_epi64(acc_vec, 47);
+    __m128i data_vec = _mm_xor_si128(acc_vec, shifted);
+    __m128i key_vec =
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(secret) + i);
+    __m128i data_key = _mm_xor_si128(data_vec, key_vec);
+    __m128i data_key_hi = _mm_shuffle_epi32(data_key, _MM_SHUFFLE(0, 3, 0, 1));
+    __m128i prod_lo = _mm_mul_epu32(data_key, prime32);
+    __m128i prod_hi = _mm_mul_epu32(data_key_hi, prime32);
+    _mm_store_si128(xacc + i,
+                    _mm_add_epi64(prod_lo, _mm_slli_epi64(prod_hi, 32)));
+  }
+#else
+  for (size_t i = 0; i < kAccNb; i++) {
+    uint64_t acc64 = acc[i];
+    acc64 ^= acc64 >> 47;
+    acc64 ^= Read64(secret + 8 * i);
+    acc64 *= kPrime32_1;
+    acc[i] = acc64;
+  }
+#endif
+}
+
+inline void Accumulate(uint64_t* acc, const uint8_t* input,
+                       const uint8_t* secret, size_t nb_stripes) {
+  for (size_t n = 0; n < nb_stripes; n++) {
+    Accumulate512(acc, input + n * kStripeLen,
+                  secret + n * kSecretConsumeRate);
+  }
+}
+
+inline uint64_t Mix2Accs(const uint64_t* acc, const uint8_t* secret) {
+  return Mul128Fold64(acc[0] ^ Read64(secret), acc[1] ^ Read64(secret + 8));
+}
+
+uint64_t HashLong(const uint8_t* input, size_t len) {
+  alignas(32) uint64_t acc[kAccNb] = {kPrime32_3, kPrime64_1, kPrime64_2,
+                                      kPrime64_3, kPrime64_4, kPrime32_2,
+                                      kPrime64_5, kPrime32_1};
+  const size_t nb_stripes_per_block =
+      (kSecretSize - kStripeLen) / kSecretConsumeRate;
+  const size_t block_len = kStripeLen * nb_stripes_per_block;
+  const size_t nb_blocks = (len - 1) / block_len;
+
+  for (size_t n = 0; n < nb_blocks; n++) {
+    Accumulate(acc, input + n * block_len, kSecret, nb_stripes_per_block);
+    ScrambleAcc(acc, kSecret + kSecretSize - kStripeLen);
+  }
+
+  // the last partial block, then the last stripe
+  const size_t nb_stripes = ((len - 1) - block_len * nb_blocks) / kStripeLen;
+  Accumulate(acc, input + nb_blocks * block_len, kSecret, nb_stripes);
+  Accumulate512(acc, input + len - kStripeLen,
+                kSecret + kSecretSize - kStripeLen - kSecretLastAccStart);
+
+  uint64_t result = len * kPrime64_1;
+  for (size_t i = 0; i < 4; i++) {
+    result += Mix2Accs(acc + 2 * i, kSecret + kSecretMergeAccsStart + 16 * i);
+  }
+  return Avalanche(result);
+}
+}  // anonymous namespace
+
+uint64_t XXH3Hash64(const char* data, size_t n) {
+  const uint8_t* input = reinterpret_cast<const uint8_t*>(data);
+  if (n <= 16) {
+    return Len0To16(input, n);
+  }
+  if (n <= 128) {
+    return Len17To128(input, n);
+  }
+  if (n <= kMidSizeMax) {
+    return Len129To240(input, n);
+  }
+  return HashLong(input, n);
+}
+
+}  // namespace vidardb
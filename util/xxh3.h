@@ -0,0 +1,25 @@
+//  Copyright (c) 2020-present, VidarDB, Inc.  All rights reserved.
+//  This source code is licensed under the BSD-style license found in the
+//  LICENSE file in the root directory of this source tree. An additional grant
+//  of patent rights can be found in the PATENTS file in the same directory.
+//
+// XXH3, the 64 bits hash of xxHash 0.8 (https://github.com/Cyan4973/xxHash,
+// BSD 2-Clause License, Copyright (c) 2012-2020 Yann Collet), with its
+// default secret and seed 0. The stripes of long inputs are accumulated with
+// AVX2 or SSE2 when the compiler targets them.
+
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+
+namespace vidardb {
+
+// Return the same hash as XXH3_64bits(data, n) of xxHash.
+extern uint64_t XXH3Hash64(const char* data, size_t n);
+
+// Return the lower 32 bits of XXH3Hash64(data, n).
+inline uint32_t XXH3Hash32(const char* data, size_t n) {
+  return static_cast<uint32_t>(XXH3Hash64(data, n));
+}
+
+}  // namespace vidardb
@@ -0,0 +1,972 @@
+//  Copyright (c) 2020-present, VidarDB, Inc.  All rights reserved.
+//  This source code is licensed under the BSD-style license found in the
+//  LICENSE file in the root directory of this source tree. An additional grant
+//  of patent rights can be found in the PATENTS file in the same directory.
+
+#ifndef VIDARDB_LITE
+
+#include "vidardb/utilities/backup_engine.h"
+
+#ifndef __STDC_FORMAT_MACROS
+#define __STDC_FORMAT_MACROS
+#endif
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <algorithm>
+#include <atomic>
+#include <limits>
+#include <map>
+#include <memory>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "db/filename.h"
+#include "port/port.h"
+#include "util/crc32c.h"
+#include "util/logging.h"
+#include "util/string_util.h"
+#include "vidardb/db.h"
+#include "vidardb/transaction_log.h"
+
+namespace vidardb {
+
+namespace {
+
+const std::string kMetaDirName = "meta";
+const std::string kSharedDirName = "shared";
+const std::string kPrivateDirName = "private";
+const std::string kTmpSuffix = ".tmp";
+
+const size_t kCopyBufferSize = 1 << 20;
+
+bool EndsWith(const std::string& s, const std::string& suffix) {
+  return s.size() >= suffix.size() &&
+         s.compare(s.size() - suffix.size(), suffix.size(), suffix) == 0;
+}
+
+Slice GetSliceUntil(Slice* slice, char delimiter) {
+  uint32_t i = 0;
+  for (i = 0; i < slice->size(); ++i) {
+    if ((*slice)[i] == delimiter) {
+      break;
+    }
+  }
+  Slice ret(slice->data(), i);
+  slice->remove_prefix(i + ((i < slice->size()) ? 1 : 0));
+  return ret;
+}
+
+// A file of the backups, referenced by the backups which contain it.
+struct FileInfo {
+  FileInfo(const std::string& _filename, uint64_t _size, uint32_t _checksum)
+      : refs(0), filename(_filename), size(_size), checksum_value(_checksum) {}
+
+  int refs;
+  const std::string filename;  // relative to backup_dir
+  const uint64_t size;
+  const uint32_t checksum_value;
+};
+
+typedef std::unordered_map<std::string, std::shared_ptr<FileInfo>> FileInfos;
+
+// The files of a backup, stored in meta/<id> as:
+//   <timestamp>
+//   <sequence number>
+//   <number of files>
+//   <file name> <size> <crc32c>
+//   ...
+class BackupMeta {
+ public:
+  BackupMeta(const std::string& meta_filename, FileInfos* file_infos,
+             Env* env)
+      : timestamp_(0), sequence_number_(0), size_(0),
+        meta_filename_(meta_filename), file_infos_(file_infos), env_(env) {}
+
+  ~BackupMeta() {}
+
+  void RecordTimestamp(int64_t timestamp) { timestamp_ = timestamp; }
+  int64_t GetTimestamp() const { return timestamp_; }
+  uint64_t GetSize() const { return size_; }
+  uint32_t GetNumberFiles() const {
+    return static_cast<uint32_t>(files_.size());
+  }
+  void SetSequenceNumber(uint64_t sequence_number) {
+    sequence_number_ = sequence_number;
+  }
+  uint64_t GetSequenceNumber() const { return sequence_number_; }
+
+  const std::vector<std::shared_ptr<FileInfo>>& GetFiles() const {
+    return files_;
+  }
+
+  // Reference the file, which is added to the files of the backups if it is
+  // not there yet.
+  Status AddFile(std::shared_ptr<FileInfo> file_info) {
+    auto itr = file_infos_->find(file_info->filename);
+    if (itr == file_infos_->end()) {
+      itr = file_infos_->insert({file_info->filename, file_info}).first;
+    } else if (itr->second->checksum_value != file_info->checksum_value ||
+               itr->second->size != file_info->size) {
+      return Status::Corruption("Checksum mismatch for existing backup file",
+                                file_info->filename);
+    }
+    ++itr->second->refs;
+    size_ += file_info->size;
+    files_.push_back(itr->second);
+    return Status::OK();
+  }
+
+  // Drop the references of the files, and the meta file if delete_meta.
+  Status Delete(bool delete_meta = true) {
+    for (const auto& file : files_) {
+      --file->refs;
+    }
+    files_.clear();
+    Status s;
+    if (delete_meta) {
+      s = env_->FileExists(meta_filename_);
+      if (s.ok()) {
+        s = env_->DeleteFile(meta_filename_);
+      } else if (s.IsNotFound()) {
+        s = Status::OK();  // nothing to delete
+      }
+    }
+    timestamp_ = 0;
+    return s;
+  }
+
+  Status LoadFromFile() {
+    assert(files_.empty());
+    std::string data;
+    Status s = ReadFileToString(env_, meta_filename_, &data);
+    if (!s.ok()) {
+      return s;
+    }
+
+    Slice input(data);
+    uint64_t timestamp = 0;
+    uint64_t num_files = 0;
+    if (!ConsumeDecimalNumber(&input, &timestamp) ||
+        !GetSliceUntil(&input, '\n').empty() ||
+        !ConsumeDecimalNumber(&input, &sequence_number_) ||
+        !GetSliceUntil(&input, '\n').empty() ||
+        !ConsumeDecimalNumber(&input, &num_files) ||
+        !GetSliceUntil(&input, '\n').empty()) {
+      return Status::Corruption("Corrupted backup meta file header",
+                                meta_filename_);
+    }
+    timestamp_ = static_cast<int64_t>(timestamp);
+
+    std::vector<std::shared_ptr<FileInfo>> files;
+    for (uint64_t i = 0; i < num_files; ++i) {
+      Slice line = GetSliceUntil(&input, '\n');
+      std::string filename = GetSliceUntil(&line, ' ').ToString();
+      uint64_t size = 0;
+      uint64_t checksum = 0;
+      if (filename.empty() || !ConsumeDecimalNumber(&line, &size) ||
+          !GetSliceUntil(&line, ' ').empty() ||
+          !ConsumeDecimalNumber(&line, &checksum) || !line.empty() ||
+          checksum > std::numeric_limits<uint32_t>::max()) {
+        return Status::Corruption("Corrupted backup meta file entry",
+                                  meta_filename_);
+      }
+      files.emplace_back(new FileInfo(filename, size,
+                                      static_cast<uint32_t>(checksum)));
+    }
+    if (!input.empty()) {
+      return Status::Corruption("Corrupted backup meta file tail",
+                                meta_filename_);
+    }
+
+    for (const auto& file_info : files) {
+      s = AddFile(file_info);
+      if (!s.ok()) {
+        Delete(false);
+        return s;
+      }
+    }
+    return Status::OK();
+  }
+
+  // Written to a temporary file, renamed once complete.
+  Status StoreToFile(bool sync) {
+    std::string data;
+    char buf[64];
+    snprintf(buf, sizeof(buf), "%" PRId64 "\n%" PRIu64 "\n%" VIDARDB_PRIszt
+             "\n", timestamp_, sequence_number_, files_.size());
+    data.append(buf);
+    for (const auto& file : files_) {
+      snprintf(buf, sizeof(buf), " %" PRIu64 " %u\n", file->size,
+               file->checksum_value);
+      data.append(file->filename).append(buf);
+    }
+
+    unique_ptr<WritableFile> backup_meta_file;
+    EnvOptions env_options;
+    env_options.use_mmap_writes = false;
+    Status s = env_->NewWritableFile(meta_filename_ + kTmpSuffix,
+                                     &backup_meta_file, env_options);
+    if (s.ok()) {
+      s = backup_meta_file->Append(Slice(data));
+    }
+    if (s.ok() && sync) {
+      s = backup_meta_file->Sync();
+    }
+    if (s.ok()) {
+      s = backup_meta_file->Close();
+    }
+    if (s.ok()) {
+      s = env_->RenameFile(meta_filename_ + kTmpSuffix, meta_filename_);
+    }
+    return s;
+  }
+
+ private:
+  int64_t timestamp_;
+  // sequence number is only approximate, should not be used
+  // by clients
+  uint64_t sequence_number_;
+  uint64_t size_;
+  const std::string meta_filename_;
+  // files with relative paths (without "/" prefix!!)
+  std::vector<std::shared_ptr<FileInfo>> files_;
+  FileInfos* file_infos_;
+  Env* env_;
+
+  // No copying allowed
+  BackupMeta(const BackupMeta&);
+  void operator=(const BackupMeta&);
+};
+
+}  // namespace
+
+class BackupEngineImpl : public BackupEngine {
+ public:
+  BackupEngineImpl(Env* db_env, const BackupEngineOptions& options);
+  virtual ~BackupEngineImpl() {}
+
+  Status Initialize();
+
+  virtual Status CreateNewBackup(DB* db,
+                                 bool flush_before_backup = false) override;
+  virtual Status PurgeOldBackups(uint32_t num_backups_to_keep) override;
+  virtual Status DeleteBackup(BackupID backup_id) override;
+  virtual void GetBackupInfo(std::vector<BackupInfo>* backup_info) override;
+  virtual Status VerifyBackup(BackupID backup_id,
+                              bool verify_with_checksum = false) override;
+  virtual Status RestoreDBFromBackup(BackupID backup_id,
+                                     const std::string& db_dir,
+                                     const std::string& wal_dir) override;
+  virtual Status RestoreDBFromLatestBackup(
+      const std::string& db_dir, const std::string& wal_dir) override {
+    return RestoreDBFromBackup(latest_backup_id_, db_dir, wal_dir);
+  }
+
+ private:
+  // A file to copy, and its size and checksum once copied.
+  struct CopyWorkItem {
+    std::string src_path;
+    std::string dst_path;
+    Env* src_env;
+    Env* dst_env;
+    uint64_t size_limit;
+    bool sync;
+    uint64_t size;
+    uint32_t checksum_value;
+    Status status;
+
+    CopyWorkItem(const std::string& _src_path, const std::string& _dst_path,
+                 Env* _src_env, Env* _dst_env, uint64_t _size_limit,
+                 bool _sync)
+        : src_path(_src_path), dst_path(_dst_path), src_env(_src_env),
+          dst_env(_dst_env), size_limit(_size_limit), sync(_sync), size(0),
+          checksum_value(0) {}
+  };
+
+  // Copies the files with max_background_operations threads, returns the
+  // first error.
+  Status CopyFiles(std::vector<CopyWorkItem>* items);
+
+  // Copies up to size_limit bytes, computing the crc32c of the bytes copied.
+  static Status CopyWithChecksum(CopyWorkItem* item);
+
+  Status CalculateChecksum(const std::string& src, Env* src_env,
+                           uint64_t* size, uint32_t* checksum_value);
+
+  // Deletes the files no backup references: the shared ones, the private
+  // directories of the backups deleted or not finished, and the temporary
+  // meta files.
+  void GarbageCollect();
+
+  // Deletes the files of the directory, then the directory.
+  void DeleteDirRecursively(const std::string& dir);
+
+  inline std::string GetAbsolutePath(
+      const std::string& relative_path = "") const {
+    assert(relative_path.size() == 0 || relative_path[0] != '/');
+    return options_.backup_dir + "/" + relative_path;
+  }
+  inline std::string GetPrivateDirRel() const {
+    return kPrivateDirName;
+  }
+  inline std::string GetSharedDirRel() const {
+    return kSharedDirName;
+  }
+  inline std::string GetPrivateFileRel(BackupID backup_id,
+                                       bool tmp = false,
+                                       const std::string& file = "") const {
+    assert(file.size() == 0 || file[0] != '/');
+    return GetPrivateDirRel() + "/" + ToString(backup_id) +
+           (tmp ? kTmpSuffix : "") + "/" + file;
+  }
+  inline std::string GetSharedFileRel(const std::string& file = "",
+                                      bool tmp = false) const {
+    assert(file.size() == 0 || file[0] != '/');
+    return GetSharedDirRel() + "/" + file + (tmp ? kTmpSuffix : "");
+  }
+  inline std::string GetBackupMetaDir() const {
+    return GetAbsolutePath(kMetaDirName);
+  }
+  inline std::string GetBackupMetaFile(BackupID backup_id) const {
+    return GetBackupMetaDir() + "/" + ToString(backup_id);
+  }
+
+  Env* db_env_;
+  Env* backup_env_;
+  BackupEngineOptions options_;
+
+  std::map<BackupID, unique_ptr<BackupMeta>> backups_;
+  FileInfos backuped_file_infos_;
+  BackupID latest_backup_id_;
+
+  // No copying allowed
+  BackupEngineImpl(const BackupEngineImpl&);
+  void operator=(const BackupEngineImpl&);
+};
+
+Status BackupEngine::Open(Env* env, const BackupEngineOptions& options,
+                          BackupEngine** backup_engine_ptr) {
+  *backup_engine_ptr = nullptr;
+  BackupEngineImpl* backup_engine = new BackupEngineImpl(env, options);
+  Status s = backup_engine->Initialize();
+  if (!s.ok()) {
+    delete backup_engine;
+    return s;
+  }
+  *backup_engine_ptr = backup_engine;
+  return Status::OK();
+}
+
+BackupEngineImpl::BackupEngineImpl(Env* db_env,
+                                   const BackupEngineOptions& options)
+    : db_env_(db_env),
+      backup_env_(options.backup_env != nullptr ? options.backup_env
+                                                : db_env_),
+      options_(options),
+      latest_backup_id_(0) {}
+
+Status BackupEngineImpl::Initialize() {
+  if (options_.destroy_old_data) {
+    Log(options_.info_log,
+        "Backup Engine started with destroy_old_data == true, "
+        "deleting all backups");
+  }
+
+  // create all the dirs we need
+  for (const auto& dir : {GetAbsolutePath(), GetAbsolutePath(kMetaDirName),
+                          GetAbsolutePath(GetSharedDirRel()),
+                          GetAbsolutePath(GetPrivateDirRel())}) {
+    Status s = backup_env_->CreateDirIfMissing(dir);
+    if (!s.ok()) {
+      return s;
+    }
+  }
+
+  std::vector<std::string> backup_meta_files;
+  Status s = backup_env_->GetChildren(GetBackupMetaDir(),
+                                      &backup_meta_files);
+  if (!s.ok()) {
+    return s;
+  }
+  // create backups_ structure
+  for (auto& file : backup_meta_files) {
+    if (file == "." || file == ".." || EndsWith(file, kTmpSuffix)) {
+      continue;
+    }
+    Slice rest(file);
+    uint64_t backup_id = 0;
+    if (!ConsumeDecimalNumber(&rest, &backup_id) || !rest.empty() ||
+        backup_id == 0 || backup_id > std::numeric_limits<BackupID>::max()) {
+      Log(options_.info_log, "Unrecognized meta file %s, ignoring",
+          file.c_str());
+      continue;
+    }
+    BackupID id = static_cast<BackupID>(backup_id);
+    unique_ptr<BackupMeta> backup(new BackupMeta(
+        GetBackupMetaFile(id), &backuped_file_infos_, backup_env_));
+    if (options_.destroy_old_data) {
+      s = backup_env_->DeleteFile(GetBackupMetaFile(id));
+    } else {
+      s = backup->LoadFromFile();
+      if (s.ok()) {
+        latest_backup_id_ = std::max(latest_backup_id_, id);
+        backups_.insert(std::make_pair(id, std::move(backup)));
+      }
+    }
+    if (!s.ok()) {
+      Log(options_.info_log, "Backup %u: %s", id, s.ToString().c_str());
+      return s;
+    }
+  }
+
+  // the files of the backups not finished, or deleted by destroy_old_data
+  GarbageCollect();
+
+  Log(options_.info_log, "Initialized BackupEngine, the latest backup is %u",
+      latest_backup_id_);
+  return Status::OK();
+}
+
+Status BackupEngineImpl::CreateNewBackup(DB* db, bool flush_before_backup) {
+  Status s;
+  std::vector<std::string> live_files;
+  VectorLogPtr live_wal_files;
+  uint64_t manifest_file_size = 0;
+  uint64_t sequence_number = db->GetLatestSequenceNumber();
+
+  s = db->DisableFileDeletions();
+  if (s.ok()) {
+    // this will return live_files prefixed with "/", the sub-column files
+    // included
+    s = db->GetLiveFiles(live_files, &manifest_file_size, flush_before_backup);
+  }
+  // if we didn't flush before backup, we need to also get WAL files
+  if (s.ok() && !flush_before_backup && options_.backup_log_files) {
+    // returns file names prefixed with "/"
+    s = db->GetSortedWalFiles(live_wal_files);
+  }
+  if (!s.ok()) {
+    db->EnableFileDeletions(false);
+    return s;
+  }
+
+  BackupID new_backup_id = latest_backup_id_ + 1;
+  unique_ptr<BackupMeta> new_backup(new BackupMeta(
+      GetBackupMetaFile(new_backup_id), &backuped_file_infos_, backup_env_));
+  int64_t timestamp = 0;
+  db_env_->GetCurrentTime(&timestamp);
+  new_backup->RecordTimestamp(timestamp);
+  new_backup->SetSequenceNumber(sequence_number);
+
+  Log(options_.info_log, "Started the backup process -- creating backup %u",
+      new_backup_id);
+
+  // create temporary private dir
+  s = backup_env_->CreateDir(
+      GetAbsolutePath(GetPrivateFileRel(new_backup_id, true)));
+
+  // The files to copy, and their names in the backup. The table files
+  // another backup has are only referenced.
+  std::vector<CopyWorkItem> items;
+  std::vector<std::string> item_names;
+  std::vector<bool> item_shared;
+  std::string manifest_fname;
+  for (size_t i = 0; s.ok() && i < live_files.size(); ++i) {
+    uint64_t number;
+    FileType type;
+    bool ok = ParseFileName(live_files[i], &number, &type);
+    if (!ok) {
+      assert(false);
+      s = Status::Corruption("Can't parse file name. This is very bad");
+      break;
+    }
+    // we should only get sst, sub column, manifest and current files here
+    assert(type == kTableFile || type == kTableSubFile ||
+           type == kDescriptorFile || type == kCurrentFile);
+    std::string fname = live_files[i].substr(1);
+    if (type == kCurrentFile) {
+      // written from the name of the MANIFEST, which the primary may have
+      // switched since
+      continue;
+    }
+    if (type == kDescriptorFile) {
+      manifest_fname = fname;
+    }
+
+    bool shared = options_.share_table_files &&
+                  (type == kTableFile || type == kTableSubFile);
+    std::string src_path = db->GetName() + live_files[i];
+    if (shared) {
+      auto itr = backuped_file_infos_.find(GetSharedFileRel(fname));
+      if (itr != backuped_file_infos_.end()) {
+        // the file numbers are never reused by a DB, but the size is
+        // checked against a different DB backed up here
+        uint64_t size = 0;
+        s = db_env_->GetFileSize(src_path, &size);
+        if (s.ok() && size != itr->second->size) {
+          s = Status::Corruption(
+              "A different file of the same name is in the backups",
+              fname);
+        }
+        if (s.ok()) {
+          Log(options_.info_log, "%s already present", fname.c_str());
+          s = new_backup->AddFile(itr->second);
+        }
+        continue;
+      }
+    }
+    std::string dst = shared ? GetSharedFileRel(fname, true)
+                             : GetPrivateFileRel(new_backup_id, true, fname);
+    items.emplace_back(src_path, GetAbsolutePath(dst), db_env_, backup_env_,
+                       type == kDescriptorFile ? manifest_file_size
+                                               : port::kMaxUint64,
+                       options_.sync);
+    item_names.push_back(shared ? GetSharedFileRel(fname)
+                                : GetPrivateFileRel(new_backup_id, false,
+                                                    fname));
+    item_shared.push_back(shared);
+  }
+  if (s.ok() && manifest_fname.empty()) {
+    s = Status::Corruption("no MANIFEST among the live files");
+  }
+
+  // the WAL files are being written, hence copied up to their sizes
+  for (size_t i = 0; s.ok() && i < live_wal_files.size(); ++i) {
+    if (live_wal_files[i]->Type() != kAliveLogFile) {
+      continue;
+    }
+    std::string fname = live_wal_files[i]->PathName().substr(1);
+    items.emplace_back(
+        db->GetDBOptions().wal_dir + live_wal_files[i]->PathName(),
+        GetAbsolutePath(GetPrivateFileRel(new_backup_id, true, fname)),
+        db_env_, backup_env_, live_wal_files[i]->SizeFileBytes(),
+        options_.sync);
+    item_names.push_back(GetPrivateFileRel(new_backup_id, false, fname));
+    item_shared.push_back(false);
+  }
+
+  if (s.ok()) {
+    s = CopyFiles(&items);
+  }
+  // we copied all the files, enable file deletions
+  db->EnableFileDeletions(false);
+
+  for (size_t i = 0; s.ok() && i < items.size(); ++i) {
+    if (item_shared[i]) {
+      s = backup_env_->RenameFile(items[i].dst_path,
+                                  GetAbsolutePath(item_names[i]));
+    }
+    if (s.ok()) {
+      s = new_backup->AddFile(std::make_shared<FileInfo>(
+          item_names[i], items[i].size, items[i].checksum_value));
+    }
+  }
+
+  if (s.ok()) {
+    std::string current = manifest_fname + "\n";
+    unique_ptr<WritableFile> current_file;
+    EnvOptions env_options;
+    env_options.use_mmap_writes = false;
+    s = backup_env_->NewWritableFile(
+        GetAbsolutePath(GetPrivateFileRel(new_backup_id, true, "CURRENT")),
+        &current_file, env_options);
+    if (s.ok()) {
+      s = current_file->Append(current);
+    }
+    if (s.ok() && options_.sync) {
+      s = current_file->Sync();
+    }
+    if (s.ok()) {
+      s = current_file->Close();
+    }
+    if (s.ok()) {
+      s = new_backup->AddFile(std::make_shared<FileInfo>(
+          GetPrivateFileRel(new_backup_id, false, "CURRENT"), current.size(),
+          crc32c::Value(current.data(), current.size())));
+    }
+  }
+
+  if (s.ok()) {
+    // move tmp private backup to real backup folder
+    s = backup_env_->RenameFile(
+        GetAbsolutePath(GetPrivateFileRel(new_backup_id, true)),
+        GetAbsolutePath(GetPrivateFileRel(new_backup_id, false)));
+  }
+  if (s.ok()) {
+    s = new_backup->StoreToFile(options_.sync);
+  }
+  if (s.ok() && options_.sync) {
+    unique_ptr<Directory> backup_private_directory;
+    backup_env_->NewDirectory(
+        GetAbsolutePath(GetPrivateFileRel(new_backup_id, false)),
+        &backup_private_directory);
+    for (const auto& dir : {GetAbsolutePath(kMetaDirName),
+                            GetAbsolutePath(GetSharedDirRel()),
+                            GetAbsolutePath(GetPrivateDirRel())}) {
+      unique_ptr<Directory> directory;
+      backup_env_->NewDirectory(dir, &directory);
+      if (s.ok() && directory != nullptr) {
+        s = directory->Fsync();
+      }
+    }
+    if (s.ok() && backup_private_directory != nullptr) {
+      s = backup_private_directory->Fsync();
+    }
+  }
+
+  if (!s.ok()) {
+    // clean all the files we might have created
+    Log(options_.info_log, "Backup failed -- %s", s.ToString().c_str());
+    new_backup->Delete();
+    GarbageCollect();
+    return s;
+  }
+
+  // here we know that we succeeded and installed the new backup
+  // in the meta file
+  latest_backup_id_ = new_backup_id;
+  Log(options_.info_log, "Backup DONE. All is good");
+  Log(options_.info_log, "Backup %u: %" VIDARDB_PRIszt " files copied, %u "
+      "files, %" PRIu64 " bytes", new_backup_id, items.size(),
+      new_backup->GetNumberFiles(), new_backup->GetSize());
+  backups_.insert(std::make_pair(new_backup_id, std::move(new_backup)));
+  return s;
+}
+
+Status BackupEngineImpl::PurgeOldBackups(uint32_t num_backups_to_keep) {
+  Log(options_.info_log, "Purging old backups, keeping %u",
+      num_backups_to_keep);
+  while (backups_.size() > num_backups_to_keep) {
+    Status s = DeleteBackup(backups_.begin()->first);
+    if (!s.ok()) {
+      return s;
+    }
+  }
+  return Status::OK();
+}
+
+Status BackupEngineImpl::DeleteBackup(BackupID backup_id) {
+  Log(options_.info_log, "Deleting backup %u", backup_id);
+  auto backup = backups_.find(backup_id);
+  if (backup == backups_.end()) {
+    return Status::NotFound("Backup not found");
+  }
+  Status s = backup->second->Delete();
+  if (!s.ok()) {
+    return s;
+  }
+  backups_.erase(backup);
+
+  // the private files, and the shared ones no other backup references
+  GarbageCollect();
+  return Status::OK();
+}
+
+void BackupEngineImpl::GetBackupInfo(std::vector<BackupInfo>* backup_info) {
+  backup_info->reserve(backups_.size());
+  for (auto& backup : backups_) {
+    backup_info->push_back(BackupInfo(
+        backup.first, backup.second->GetTimestamp(),
+        backup.second->GetSize(), backup.second->GetNumberFiles()));
+  }
+}
+
+Status BackupEngineImpl::VerifyBackup(BackupID backup_id,
+                                      bool verify_with_checksum) {
+  auto backup = backups_.find(backup_id);
+  if (backup == backups_.end()) {
+    return Status::NotFound("Backup not found");
+  }
+  Log(options_.info_log, "Verifying backup id %u", backup_id);
+
+  for (const auto& file_info : backup->second->GetFiles()) {
+    const std::string abs_path = GetAbsolutePath(file_info->filename);
+    uint64_t size = 0;
+    uint32_t checksum_value = 0;
+    Status s;
+    if (verify_with_checksum) {
+      s = CalculateChecksum(abs_path, backup_env_, &size, &checksum_value);
+    } else {
+      s = backup_env_->GetFileSize(abs_path, &size);
+    }
+    if (!s.ok()) {
+      return s;
+    }
+    if (size != file_info->size) {
+      return Status::Corruption("File corrupted: size mismatch", abs_path);
+    }
+    if (verify_with_checksum && checksum_value != file_info->checksum_value) {
+      return Status::Corruption("File corrupted: checksum mismatch",
+                                abs_path);
+    }
+  }
+  return Status::OK();
+}
+
+Status BackupEngineImpl::RestoreDBFromBackup(BackupID backup_id,
+                                             const std::string& db_dir,
+                                             const std::string& wal_dir) {
+  auto backup_itr = backups_.find(backup_id);
+  if (backup_itr == backups_.end()) {
+    return Status::NotFound("Backup not found");
+  }
+  auto& backup = backup_itr->second;
+
+  Log(options_.info_log, "Restoring backup id %u\n", backup_id);
+
+  // just in case. Ignore errors
+  db_env_->CreateDirIfMissing(db_dir);
+  db_env_->CreateDirIfMissing(wal_dir);
+
+  // delete log files that might have been already in wal_dir, else they
+  // are replayed over the backup
+  std::vector<std::string> wal_dir_children;
+  db_env_->GetChildren(wal_dir, &wal_dir_children);
+  for (auto f : wal_dir_children) {
+    uint64_t number;
+    FileType type;
+    if (ParseFileName(f, &number, &type) && type == kLogFile) {
+      Status s = db_env_->DeleteFile(wal_dir + "/" + f);
+      Log(options_.info_log, "Deleting log file %s -- %s", f.c_str(),
+          s.ToString().c_str());
+    }
+  }
+
+  std::vector<CopyWorkItem> items;
+  for (const auto& file_info : backup->GetFiles()) {
+    const std::string& file = file_info->filename;
+    std::string dst;
+    // 1. extract the filename
+    size_t slash = file.find_last_of('/');
+    // file will either be shared/<file> or private/<number>/<file>
+    assert(slash != std::string::npos);
+    dst = file.substr(slash + 1);
+
+    // 2. find the filetype
+    uint64_t number;
+    FileType type;
+    bool ok = ParseFileName(dst, &number, &type);
+    if (!ok) {
+      return Status::Corruption("Backup corrupted");
+    }
+    // 3. Construct the final path
+    // kLogFile lives in wal_dir and all the rest live in db_dir
+    dst = ((type == kLogFile) ? wal_dir : db_dir) + "/" + dst;
+
+    // the file may be a hard link of a checkpoint, truncating it in place
+    // would change the checkpoint too
+    db_env_->DeleteFile(dst);
+    Log(options_.info_log, "Restoring %s to %s\n", file.c_str(),
+        dst.c_str());
+    items.emplace_back(GetAbsolutePath(file), dst, backup_env_, db_env_,
+                       port::kMaxUint64, false);
+  }
+
+  Status s = CopyFiles(&items);
+  for (size_t i = 0; s.ok() && i < items.size(); ++i) {
+    const auto& file_info = backup->GetFiles()[i];
+    if (items[i].size != file_info->size ||
+        items[i].checksum_value != file_info->checksum_value) {
+      s = Status::Corruption("Checksum check failed", file_info->filename);
+    }
+  }
+
+  Log(options_.info_log, "Restoring done -- %s\n", s.ToString().c_str());
+  return s;
+}
+
+Status BackupEngineImpl::CopyFiles(std::vector<CopyWorkItem>* items) {
+  std::atomic<size_t> next(0);
+  std::atomic<bool> failed(false);
+  auto work = [&]() {
+    for (size_t i = next.fetch_add(1); i < items->size() && !failed.load();
+         i = next.fetch_add(1)) {
+      CopyWorkItem& item = (*items)[i];
+      item.status = CopyWithChecksum(&item);
+      if (!item.status.ok()) {
+        failed.store(true);
+      }
+    }
+  };
+
+  size_t num_threads = std::min(
+      static_cast<size_t>(std::max(options_.max_background_operations, 1)),
+      items->size());
+  std::vector<std::thread> threads;
+  for (size_t i = 1; i < num_threads; i++) {
+    threads.emplace_back(work);
+  }
+  work();
+  for (auto& thread : threads) {
+    thread.join();
+  }
+
+  for (const auto& item : *items) {
+    if (!item.status.ok()) {
+      Log(options_.info_log, "Copying %s failed -- %s",
+          item.src_path.c_str(), item.status.ToString().c_str());
+      return item.status;
+    }
+  }
+  return Status::OK();
+}
+
+Status BackupEngineImpl::CopyWithChecksum(CopyWorkItem* item) {
+  assert(item->src_path != item->dst_path);
+  item->size = 0;
+  item->checksum_value = 0;
+
+  EnvOptions env_options;
+  env_options.use_mmap_writes = false;
+  env_options.use_os_buffer = false;
+
+  unique_ptr<WritableFile> dst_file;
+  unique_ptr<SequentialFile> src_file;
+  Status s = item->dst_env->NewWritableFile(item->dst_path, &dst_file,
+                                            env_options);
+  if (s.ok()) {
+    s = item->src_env->NewSequentialFile(item->src_path, &src_file,
+                                         env_options);
+  }
+  if (!s.ok()) {
+    return s;
+  }
+
+  unique_ptr<char[]> buf(new char[kCopyBufferSize]);
+  Slice data;
+  uint64_t size_limit = item->size_limit;
+  while (size_limit > 0) {
+    size_t buffer_to_read = (kCopyBufferSize < size_limit)
+                                ? kCopyBufferSize
+                                : static_cast<size_t>(size_limit);
+    s = src_file->Read(buffer_to_read, &data, buf.get());
+    if (!s.ok() || data.size() == 0) {
+      break;
+    }
+    size_limit -= data.size();
+    item->size += data.size();
+    item->checksum_value =
+        crc32c::Extend(item->checksum_value, data.data(), data.size());
+    s = dst_file->Append(data);
+    if (!s.ok()) {
+      break;
+    }
+  }
+
+  if (s.ok() && item->sync) {
+    s = dst_file->Sync();
+  }
+  if (s.ok()) {
+    s = dst_file->Close();
+  }
+  return s;
+}
+
+Status BackupEngineImpl::CalculateChecksum(const std::string& src,
+                                           Env* src_env, uint64_t* size,
+                                           uint32_t* checksum_value) {
+  *size = 0;
+  *checksum_value = 0;
+
+  EnvOptions env_options;
+  env_options.use_os_buffer = false;
+
+  unique_ptr<SequentialFile> src_file;
+  Status s = src_env->NewSequentialFile(src, &src_file, env_options);
+  if (!s.ok()) {
+    return s;
+  }
+
+  unique_ptr<char[]> buf(new char[kCopyBufferSize]);
+  Slice data;
+  do {
+    s = src_file->Read(kCopyBufferSize, &data, buf.get());
+    if (!s.ok()) {
+      return s;
+    }
+    *size += data.size();
+    *checksum_value = crc32c::Extend(*checksum_value, data.data(),
+                                     data.size());
+  } while (data.size() > 0);
+  return s;
+}
+
+void BackupEngineImpl::DeleteDirRecursively(const std::string& dir) {
+  std::vector<std::string> children;
+  backup_env_->GetChildren(dir, &children);
+  for (const auto& child : children) {
+    if (child == "." || child == "..") {
+      continue;
+    }
+    Status s = backup_env_->DeleteFile(dir + "/" + child);
+    Log(options_.info_log, "Deleting %s/%s -- %s", dir.c_str(),
+        child.c_str(), s.ToString().c_str());
+  }
+  Status s = backup_env_->DeleteDir(dir);
+  Log(options_.info_log, "Deleting dir %s -- %s", dir.c_str(),
+      s.ToString().c_str());
+}
+
+void BackupEngineImpl::GarbageCollect() {
+  Log(options_.info_log, "Starting garbage collection");
+
+  // the shared files no backup references
+  for (auto itr = backuped_file_infos_.begin();
+       itr != backuped_file_infos_.end();) {
+    if (itr->second->refs == 0) {
+      itr = backuped_file_infos_.erase(itr);
+    } else {
+      ++itr;
+    }
+  }
+  std::vector<std::string> shared_children;
+  backup_env_->GetChildren(GetAbsolutePath(GetSharedDirRel()),
+                           &shared_children);
+  for (const auto& child : shared_children) {
+    if (child == "." || child == "..") {
+      continue;
+    }
+    std::string rel_fname = GetSharedFileRel(child);
+    if (backuped_file_infos_.find(rel_fname) == backuped_file_infos_.end()) {
+      Status s = backup_env_->DeleteFile(GetAbsolutePath(rel_fname));
+      Log(options_.info_log, "Deleting %s -- %s", rel_fname.c_str(),
+          s.ToString().c_str());
+    }
+  }
+
+  // the private directories of the backups deleted or not finished
+  std::vector<std::string> private_children;
+  backup_env_->GetChildren(GetAbsolutePath(GetPrivateDirRel()),
+                           &private_children);
+  for (const auto& child : private_children) {
+    if (child == "." || child == "..") {
+      continue;
+    }
+    Slice rest(child);
+    uint64_t backup_id = 0;
+    bool live = ConsumeDecimalNumber(&rest, &backup_id) && rest.empty() &&
+                backups_.find(static_cast<BackupID>(backup_id)) !=
+                    backups_.end();
+    if (!live) {
+      DeleteDirRecursively(GetAbsolutePath(GetPrivateDirRel() + "/" + child));
+    }
+  }
+
+  // the meta files not finished
+  std::vector<std::string> meta_children;
+  backup_env_->GetChildren(GetBackupMetaDir(), &meta_children);
+  for (const auto& child : meta_children) {
+    if (EndsWith(child, kTmpSuffix)) {
+      Status s = backup_env_->DeleteFile(GetBackupMetaDir() + "/" + child);
+      Log(options_.info_log, "Deleting %s -- %s", child.c_str(),
+          s.ToString().c_str());
+    }
+  }
+}
+
+}  // namespace vidardb
+
+#endif  // VIDARDB_LITE
@@ -0,0 +1,216 @@
+//  Copyright (c) 2020-present, VidarDB, Inc.  All rights reserved.
+//  This source code is licensed under the BSD-style license found in the
+//  LICENSE file in the root directory of this source tree. An additional grant
+//  of patent rights can be found in the PATENTS file in the same directory.
+
+#ifndef VIDARDB_LITE
+
+#include "vidardb/utilities/checkpoint.h"
+
+#ifndef __STDC_FORMAT_MACROS
+#define __STDC_FORMAT_MACROS
+#endif
+
+#include <inttypes.h>
+#include <string>
+#include <vector>
+
+#include "db/filename.h"
+#include "port/port.h"
+#include "util/file_util.h"
+#include "vidardb/db.h"
+#include "vidardb/env.h"
+#include "vidardb/transaction_log.h"
+
+namespace vidardb {
+
+class CheckpointImpl : public Checkpoint {
+ public:
+  // Creates a Checkpoint object to be used for creating openable snapshots
+  explicit CheckpointImpl(DB* db) : db_(db) {}
+
+  // Builds an openable snapshot of VidarDB on the same disk, which
+  // accepts an output directory on the same disk, and under the directory
+  // (1) hard-linked SST files and sub-column files pointing to the existing
+  // live ones, copied if output directory is on a different filesystem
+  // (2) a copied manifest file, WAL files and other files
+  // The directory should not already exist and will be created by this API.
+  // The directory will be an absolute path
+  using Checkpoint::CreateCheckpoint;
+  virtual Status CreateCheckpoint(const std::string& checkpoint_dir) override;
+
+ private:
+  DB* db_;
+};
+
+Status Checkpoint::Create(DB* db, Checkpoint** checkpoint_ptr) {
+  *checkpoint_ptr = new CheckpointImpl(db);
+  return Status::OK();
+}
+
+Status Checkpoint::CreateCheckpoint(const std::string& checkpoint_dir) {
+  return Status::NotSupported("");
+}
+
+// Builds an openable snapshot of VidarDB
+Status CheckpointImpl::CreateCheckpoint(const std::string& checkpoint_dir) {
+  Status s;
+  std::vector<std::string> live_files;
+  uint64_t manifest_file_size = 0;
+  uint64_t sequence_number = db_->GetLatestSequenceNumber();
+  bool same_fs = true;
+  VectorLogPtr live_wal_files;
+  Env* env = db_->GetEnv();
+  const DBOptions& db_options = db_->GetDBOptions();
+
+  s = env->FileExists(checkpoint_dir);
+  if (s.ok()) {
+    return Status::InvalidArgument("Directory exists");
+  } else if (!s.IsNotFound()) {
+    assert(s.IsIOError());
+    return s;
+  }
+
+  s = db_->DisableFileDeletions();
+  if (s.ok()) {
+    // this will return live_files prefixed with "/", the sub-column files
+    // included
+    s = db_->GetLiveFiles(live_files, &manifest_file_size, false);
+  }
+  // the WAL files written since the MANIFEST, up to their sizes now
+  if (s.ok()) {
+    s = db_->GetSortedWalFiles(live_wal_files);
+  }
+  if (!s.ok()) {
+    db_->EnableFileDeletions(false);
+    return s;
+  }
+
+  Log(InfoLogLevel::INFO_LEVEL, db_options.info_log,
+      "Started the snapshot process -- creating snapshot in directory %s",
+      checkpoint_dir.c_str());
+
+  std::string full_private_path = checkpoint_dir + ".tmp";
+
+  // create snapshot directory
+  s = env->CreateDir(full_private_path);
+
+  // copy/hard link live_files
+  std::string manifest_fname;
+  for (size_t i = 0; s.ok() && i < live_files.size(); ++i) {
+    uint64_t number;
+    FileType type;
+    bool ok = ParseFileName(live_files[i], &number, &type);
+    if (!ok) {
+      s = Status::Corruption("Can't parse file name. This is very bad");
+      break;
+    }
+    // we should only get sst, sub column, manifest and current files here
+    assert(type == kTableFile || type == kTableSubFile ||
+           type == kDescriptorFile || type == kCurrentFile);
+    assert(live_files[i].size() > 0 && live_files[i][0] == '/');
+    std::string src_fname = live_files[i];
+
+    if (type == kCurrentFile) {
+      // written below from the name of the MANIFEST copied, as the primary
+      // may have switched to a newer one since
+      continue;
+    }
+    if (type == kDescriptorFile) {
+      manifest_fname = src_fname;
+    }
+
+    // rules:
+    // * if it's kTableFile or kTableSubFile, then it's shared
+    // * if it's kDescriptorFile, limit the size to manifest_file_size
+    // * always copy if cross-device link
+    if ((type == kTableFile || type == kTableSubFile) && same_fs) {
+      Log(InfoLogLevel::INFO_LEVEL, db_options.info_log,
+          "Hard Linking %s", src_fname.c_str());
+      s = env->LinkFile(db_->GetName() + src_fname,
+                        full_private_path + src_fname);
+      if (s.IsNotSupported()) {
+        same_fs = false;
+        s = Status::OK();
+      }
+    }
+    if ((type != kTableFile && type != kTableSubFile) || !same_fs) {
+      Log(InfoLogLevel::INFO_LEVEL, db_options.info_log,
+          "Copying %s", src_fname.c_str());
+      s = CopyFile(env, db_->GetName() + src_fname,
+                   full_private_path + src_fname,
+                   (type == kDescriptorFile) ? manifest_file_size : 0);
+    }
+  }
+  if (s.ok() && manifest_fname.empty()) {
+    s = Status::Corruption("no MANIFEST among the live files");
+  }
+  if (s.ok()) {
+    s = CreateFile(env, full_private_path + "/CURRENT",
+                   manifest_fname.substr(1) + "\n");
+  }
+  Log(InfoLogLevel::INFO_LEVEL, db_options.info_log,
+      "Number of log files %" VIDARDB_PRIszt, live_wal_files.size());
+
+  // Copy the live WAL files up to their sizes when listed, as the writes
+  // into them go on
+  for (size_t i = 0; s.ok() && i < live_wal_files.size(); ++i) {
+    if (live_wal_files[i]->Type() != kAliveLogFile) {
+      continue;
+    }
+    Log(InfoLogLevel::INFO_LEVEL, db_options.info_log,
+        "Copying %s", live_wal_files[i]->PathName().c_str());
+    s = CopyFile(env, db_options.wal_dir + live_wal_files[i]->PathName(),
+                 full_private_path + live_wal_files[i]->PathName(),
+                 live_wal_files[i]->SizeFileBytes());
+  }
+
+  // we copied all the files, enable file deletions
+  db_->EnableFileDeletions(false);
+
+  if (s.ok()) {
+    // move tmp private backup to real snapshot directory
+    s = env->RenameFile(full_private_path, checkpoint_dir);
+  }
+  if (s.ok()) {
+    unique_ptr<Directory> checkpoint_directory;
+    env->NewDirectory(checkpoint_dir, &checkpoint_directory);
+    if (checkpoint_directory != nullptr) {
+      s = checkpoint_directory->Fsync();
+    }
+  }
+
+  if (!s.ok()) {
+    // clean all the files we might have created
+    Log(InfoLogLevel::INFO_LEVEL, db_options.info_log,
+        "Snapshot failed -- %s", s.ToString().c_str());
+    // we have to delete the dir and all its children
+    std::vector<std::string> subchildren;
+    env->GetChildren(full_private_path, &subchildren);
+    for (auto& subchild : subchildren) {
+      Status s1 = env->DeleteFile(full_private_path + "/" + subchild);
+      if (s1.ok()) {
+        Log(InfoLogLevel::INFO_LEVEL, db_options.info_log,
+            "Deleted %s", (full_private_path + "/" + subchild).c_str());
+      }
+    }
+    // finally delete the private dir
+    Status s1 = env->DeleteDir(full_private_path);
+    Log(InfoLogLevel::INFO_LEVEL, db_options.info_log,
+        "Deleted dir %s -- %s", full_private_path.c_str(),
+        s1.ToString().c_str());
+    return s;
+  }
+
+  // here we know that we succeeded and installed the new snapshot
+  Log(InfoLogLevel::INFO_LEVEL, db_options.info_log,
+      "Snapshot DONE. All is good");
+  Log(InfoLogLevel::INFO_LEVEL, db_options.info_log,
+      "Snapshot sequence number: %" PRIu64, sequence_number);
+
+  return s;
+}
+
+}  // namespace vidardb
+
+#endif  // VIDARDB_LITE
@@ -0,0 +1,33 @@
+//  Copyright (c) 2019-present, VidarDB, Inc.  All rights reserved.
+//  This source code is licensed under the BSD-style license found in the
+//  LICENSE file in the root directory of this source tree. An additional grant
+//  of patent rights can be found in the PATENTS file in the same directory.
+
+#pragma once
+#ifndef VIDARDB_LITE
+
+#include "vidardb/db.h"
+#include "vidardb/options.h"
+#include "vidardb/utilities/optimistic_transaction_db.h"
+
+namespace vidardb {
+
+class OptimisticTransactionDBImpl : public OptimisticTransactionDB {
+ public:
+  explicit OptimisticTransactionDBImpl(DB* db) : OptimisticTransactionDB(db) {}
+
+  ~OptimisticTransactionDBImpl() {}
+
+  Transaction* BeginTransaction(const WriteOptions& write_options,
+                                const OptimisticTransactionOptions& txn_options,
+                                Transaction* old_txn) override;
+
+ private:
+  void ReinitializeTransaction(Transaction* txn,
+                               const WriteOptions& write_options,
+                               const OptimisticTransactionOptions& txn_options =
+                                   OptimisticTransactionOptions());
+};
+
+}  //  namespace vidardb
+#endif  // VIDARDB_LITE
@@ -0,0 +1,114 @@
+//  Copyright (c) 2019-present, VidarDB, Inc.  All rights reserved.
+//  This source code is licensed under the BSD-style license found in the
+//  LICENSE file in the root directory of this source tree. An additional grant
+//  of patent rights can be found in the PATENTS file in the same directory.
+
+#ifndef VIDARDB_LITE
+
+#include "utilities/transactions/optimistic_transaction_impl.h"
+
+#include <string>
+
+#include "db/column_family.h"
+#include "db/db_impl.h"
+#include "utilities/transactions/transaction_util.h"
+#include "vidardb/comparator.h"
+#include "vidardb/db.h"
+#include "vidardb/status.h"
+#include "vidardb/utilities/optimistic_transaction_db.h"
+
+namespace vidardb {
+
+OptimisticTransactionImpl::OptimisticTransactionImpl(
+    OptimisticTransactionDB* txn_db, const WriteOptions& write_options,
+    const OptimisticTransactionOptions& txn_options)
+    : TransactionBaseImpl(txn_db->GetBaseDB(), write_options) {
+  Initialize(txn_options);
+}
+
+void OptimisticTransactionImpl::Initialize(
+    const OptimisticTransactionOptions& txn_options) {
+  if (txn_options.set_snapshot) {
+    SetSnapshot();
+  }
+}
+
+void OptimisticTransactionImpl::Reinitialize(
+    OptimisticTransactionDB* txn_db, const WriteOptions& write_options,
+    const OptimisticTransactionOptions& txn_options) {
+  TransactionBaseImpl::Reinitialize(txn_db->GetBaseDB(), write_options);
+  Initialize(txn_options);
+}
+
+OptimisticTransactionImpl::~OptimisticTransactionImpl() {}
+
+Status OptimisticTransactionImpl::Prepare() {
+  return Status::InvalidArgument(
+      "Two phase commit not supported for optimistic transactions.");
+}
+
+Status OptimisticTransactionImpl::Commit() {
+  // Set up callback which will call CheckTransactionForConflicts() to
+  // check whether this transaction is safe to be committed.
+  OptimisticTransactionCallback callback(this);
+
+  Status s = dbimpl_->WriteImpl(write_options_,
+                                GetWriteBatch()->GetWriteBatch(), &callback);
+
+  if (s.ok()) {
+    Clear();
+  }
+
+  return s;
+}
+
+Status OptimisticTransactionImpl::Rollback() {
+  Clear();
+  return Status::OK();
+}
+
+// Record this key so that we can check it for conflicts at commit time.
+Status OptimisticTransactionImpl::TryLock(ColumnFamilyHandle* column_family,
+                                          const Slice& key, bool read_only,
+                                          bool untracked) {
+  if (untracked) {
+    return Status::OK();
+  }
+  uint32_t cfh_id = GetColumnFamilyID(column_family);
+
+  SetSnapshotIfNeeded();
+
+  SequenceNumber seq;
+  if (snapshot_) {
+    seq = snapshot_->GetSequenceNumber();
+  } else {
+    seq = db_->GetLatestSequenceNumber();
+  }
+
+  std::string key_str = key.ToString();
+
+  TrackKey(cfh_id, key_str, seq, read_only);
+
+  // Always return OK. Conflict checking will happen at commit time.
+  return Status::OK();
+}
+
+Status OptimisticTransactionImpl::CheckTransactionForConflicts(DB* db) {
+  assert(dynamic_cast<DBImpl*>(db) != nullptr);
+  auto db_impl = reinterpret_cast<DBImpl*>(db);
+
+  // Since we are on the write thread and do not want to block other writers,
+  // we will do a cache-only conflict check. This can result in TryAgain
+  // getting returned if there is not sufficient memtable history to check
+  // for conflicts.
+  return TransactionUtil::CheckKeysForConflicts(db_impl, GetTrackedKeys(),
+                                                true /* cache_only */);
+}
+
+Status OptimisticTransactionImpl::SetName(const TransactionName& name) {
+  return Status::InvalidArgument("Optimistic transactions cannot be named.");
+}
+
+}  // namespace vidardb
+
+#endif  // VIDARDB_LITE
@@ -135,6 +135,22 @@ Status TransactionBaseImpl::Get(ReadOptions& read_options,
                                         value);
 }
 
+bool TransactionBaseImpl::RangeQuery(ReadOptions& read_options,
+                                     ColumnFamilyHandle* column_family,
+                                     const Range& range,
+                                     std::list<RangeQueryKeyVal>& res,
+                                     Status* s) {
+  // The snapshot is only consulted when the range query starts
+  const Snapshot* user_snapshot = read_options.snapshot;
+  if (user_snapshot == nullptr && snapshot_) {
+    read_options.snapshot = snapshot_.get();
+  }
+  bool next_query = write_batch_.RangeQueryFromBatchAndDB(
+      db_, read_options, column_family, range, res, s);
+  read_options.snapshot = user_snapshot;
+  return next_query;
+}
+
 Status TransactionBaseImpl::GetForUpdate(ReadOptions& read_options,
                                          ColumnFamilyHandle* column_family,
                                          const Slice& key, std::string* value) {
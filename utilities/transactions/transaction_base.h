@@ -7,6 +7,7 @@
 
 #ifndef VIDARDB_LITE
 
+#include <list>
 #include <stack>
 #include <string>
 #include <vector>
@@ -66,6 +67,14 @@ class TransactionBaseImpl : public Transaction {
   Iterator* GetIterator(const ReadOptions& read_options,
                         ColumnFamilyHandle* column_family) override;
 
+  bool RangeQuery(ReadOptions& read_options, ColumnFamilyHandle* column_family,
+                  const Range& range, std::list<RangeQueryKeyVal>& res,
+                  Status* s) override;
+  bool RangeQuery(ReadOptions& read_options, const Range& range,
+                  std::list<RangeQueryKeyVal>& res, Status* s) override {
+    return RangeQuery(read_options, db_->DefaultColumnFamily(), range, res, s);
+  }
+
   Status Put(ColumnFamilyHandle* column_family, const Slice& key,
              const Slice& value) override;
   Status Put(const Slice& key, const Slice& value) override {
@@ -146,6 +146,16 @@ Status TransactionDBImpl::Delete(const WriteOptions& wopts,
   return s;
 }
 
+Status TransactionDBImpl::Merge(const WriteOptions& options,
+                                ColumnFamilyHandle* column_family,
+                                const Slice& key, const Slice& value) {
+  // Transactions have no merge of their own, so the merge goes through
+  // Write() to lock the key like any other non-transactional write.
+  WriteBatch batch;
+  batch.Merge(column_family, key, value);
+  return Write(options, &batch);
+}
+
 Status TransactionDBImpl::Write(const WriteOptions& opts, WriteBatch* updates) {
   // Need to lock all keys in this batch to prevent write conflicts with
   // concurrent transactions.
@@ -173,7 +183,7 @@ Status TransactionDBImpl::CreateColumnFamily(
 
   Status s = db_->CreateColumnFamily(options, column_family_name, handle);
   if (s.ok()) {
-    lock_mgr_.AddColumnFamily((*handle)->GetID());
+    AddColumnFamily(*handle);
   }
 
   return s;
@@ -195,7 +205,8 @@ Status TransactionDBImpl::DropColumnFamily(ColumnFamilyHandle* column_family) {
 // Let TransactionLockMgr know that this column family exists so it can
 // allocate a LockMap for it.
 void TransactionDBImpl::AddColumnFamily(const ColumnFamilyHandle* handle) {
-  lock_mgr_.AddColumnFamily(handle->GetID());
+  auto cfh = reinterpret_cast<const ColumnFamilyHandleImpl*>(handle);
+  lock_mgr_.AddColumnFamily(cfh->GetID(), cfh->user_comparator());
 }
 
 TransactionDBOptions TransactionDBImpl::ValidateTxnDBOptions(
@@ -224,6 +235,16 @@ void TransactionDBImpl::UnLock(TransactionImpl* txn, uint32_t cfh_id,
   lock_mgr_.UnLock(txn, cfh_id, key, GetEnv());
 }
 
+Status TransactionDBImpl::TryRangeLock(TransactionImpl* txn, uint32_t cfh_id,
+                                       const std::string& start,
+                                       const std::string& limit) {
+  return lock_mgr_.TryRangeLock(txn, cfh_id, start, limit, GetEnv());
+}
+
+void TransactionDBImpl::UnLockRanges(TransactionImpl* txn, uint32_t cfh_id) {
+  lock_mgr_.UnLockRanges(txn, cfh_id, GetEnv());
+}
+
 void TransactionDBImpl::InsertExpirableTransaction(TransactionID tx_id,
                                                    TransactionImpl* tx) {
   assert(tx->GetExpirationTime() > 0);
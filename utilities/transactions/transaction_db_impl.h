@@ -46,6 +46,11 @@ class TransactionDBImpl : public TransactionDB {
                         ColumnFamilyHandle* column_family,
                         const Slice& key) override;
 
+  using StackableDB::Merge;
+  virtual Status Merge(const WriteOptions& options,
+                       ColumnFamilyHandle* column_family, const Slice& key,
+                       const Slice& value) override;
+
   using StackableDB::Write;
   virtual Status Write(const WriteOptions& opts, WriteBatch* updates) override;
 
@@ -71,6 +76,11 @@ class TransactionDBImpl : public TransactionDB {
   void UnLock(TransactionImpl* txn, const TransactionKeyMap* keys);
   void UnLock(TransactionImpl* txn, uint32_t cfh_id, const std::string& key);
 
+  Status TryRangeLock(TransactionImpl* txn, uint32_t cfh_id,
+                      const std::string& start, const std::string& limit);
+
+  void UnLockRanges(TransactionImpl* txn, uint32_t cfh_id);
+
   void InsertExpirableTransaction(TransactionID tx_id, TransactionImpl* tx);
   void RemoveExpirableTransaction(TransactionID tx_id);
 
@@ -46,6 +46,9 @@ void TransactionImpl::Initialize(const TransactionOptions& txn_options) {
         txn_db_impl_->GetTxnDBOptions().transaction_lock_timeout * 1000;
   }
 
+  deadlock_detect_ = txn_options.deadlock_detect;
+  deadlock_detect_depth_ = txn_options.deadlock_detect_depth;
+
   if (txn_options.expiration >= 0) {
     expiration_time_ = start_time_ + txn_options.expiration * 1000;
   } else {
@@ -68,7 +71,9 @@ TransactionImpl::TransactionImpl(TransactionDB* txn_db,
       txn_db_impl_(nullptr),
       txn_id_(0),
       expiration_time_(0),
-      lock_timeout_(0) {
+      lock_timeout_(0),
+      deadlock_detect_(false),
+      deadlock_detect_depth_(0) {
   txn_db_impl_ = dynamic_cast<TransactionDBImpl*>(txn_db);
   assert(txn_db_impl_);
 
@@ -80,6 +85,7 @@ TransactionImpl::TransactionImpl(TransactionDB* txn_db,
 
 TransactionImpl::~TransactionImpl() {
   txn_db_impl_->UnLock(this, &GetTrackedKeys());
+  UnLockRanges();
   if (expiration_time_ > 0) {
     txn_db_impl_->RemoveExpirableTransaction(txn_id_);
   }
@@ -156,9 +162,28 @@ Status TransactionImpl::Prepare() {
 
 void TransactionImpl::Clear() {
   txn_db_impl_->UnLock(this, &GetTrackedKeys());
+  UnLockRanges();
   TransactionBaseImpl::Clear();
 }
 
+void TransactionImpl::UnLockRanges() {
+  for (uint32_t cfh_id : range_locked_cfs_) {
+    txn_db_impl_->UnLockRanges(this, cfh_id);
+  }
+  range_locked_cfs_.clear();
+}
+
+Status TransactionImpl::GetRangeLock(ColumnFamilyHandle* column_family,
+                                     const Range& range) {
+  uint32_t cfh_id = GetColumnFamilyID(column_family);
+  Status s = txn_db_impl_->TryRangeLock(this, cfh_id, range.start.ToString(),
+                                        range.limit.ToString());
+  if (s.ok()) {
+    range_locked_cfs_.insert(cfh_id);
+  }
+  return s;
+}
+
 Status TransactionImpl::Commit() {
   Status s;
   bool commit_single = false;
@@ -281,6 +306,12 @@ Status TransactionImpl::LockBatch(WriteBatch* batch,
       RecordKey(column_family_id, key);
       return Status::OK();
     }
+
+    virtual Status MergeCF(uint32_t column_family_id, const Slice& key,
+                           const Slice& value) override {
+      RecordKey(column_family_id, key);
+      return Status::OK();
+    }
   };
 
   // Iterating on this handler will add all keys in this batch into keys
@@ -8,6 +8,7 @@
 #ifndef VIDARDB_LITE
 
 #include <atomic>
+#include <set>
 #include <stack>
 #include <string>
 #include <unordered_map>
@@ -56,6 +57,16 @@ class TransactionImpl : public TransactionBaseImpl {
     lock_timeout_ = timeout * 1000;
   }
 
+  // Returns true if this transaction checks for deadlocks before waiting on
+  // a lock.
+  bool IsDeadlockDetect() const { return deadlock_detect_; }
+
+  int64_t GetDeadlockDetectDepth() const { return deadlock_detect_depth_; }
+
+  using TransactionBaseImpl::GetRangeLock;
+  Status GetRangeLock(ColumnFamilyHandle* column_family,
+                      const Range& range) override;
+
   void Reinitialize(TransactionDB* txn_db, const WriteOptions& write_options,
                     const TransactionOptions& txn_options);
 
@@ -93,6 +104,15 @@ class TransactionImpl : public TransactionBaseImpl {
   // Timeout in microseconds when locking a key or -1 if there is no timeout.
   int64_t lock_timeout_;
 
+  // Whether to detect deadlocks before waiting on a lock
+  bool deadlock_detect_;
+
+  // Maximum length of the wait-for chain followed by deadlock detection
+  int64_t deadlock_detect_depth_;
+
+  // Column families in which this transaction holds range locks
+  std::set<uint32_t> range_locked_cfs_;
+
   void Initialize(const TransactionOptions& txn_options);
 
   // returns true if this transaction has an expiration_time and has expired.
@@ -100,6 +120,8 @@ class TransactionImpl : public TransactionBaseImpl {
 
   void Clear() override;
 
+  void UnLockRanges();
+
   Status LockBatch(WriteBatch* batch, TransactionKeyMap* keys_to_unlock);
 
   Status ValidateSnapshot(ColumnFamilyHandle* column_family, const Slice& key,
@@ -23,6 +23,8 @@
 #include "util/murmurhash.h"
 #include "util/thread_local.h"
 #include "utilities/transactions/transaction_db_impl.h"
+#include "vidardb/comparator.h"
+#include "vidardb/db.h"
 #include "vidardb/slice.h"
 #include "vidardb/utilities/transaction_db_mutex.h"
 
@@ -38,6 +40,18 @@ struct LockInfo {
       : txn_id(id), expiration_time(time) {}
   LockInfo(const LockInfo& lock_info)
       : txn_id(lock_info.txn_id), expiration_time(lock_info.expiration_time) {}
+  LockInfo& operator=(const LockInfo& lock_info) = default;
+};
+
+struct RangeLockInfo : public LockInfo {
+  // Locked keys are in [start, limit], kRangeQueryMin and kRangeQueryMax
+  // stand for an open end.
+  std::string start;
+  std::string limit;
+
+  RangeLockInfo(const LockInfo& lock_info, const std::string& s,
+                const std::string& l)
+      : LockInfo(lock_info), start(s), limit(l) {}
 };
 
 struct LockMapStripe {
@@ -61,13 +75,18 @@ struct LockMapStripe {
 // Map of #num_stripes LockMapStripes
 struct LockMap {
   explicit LockMap(size_t num_stripes,
-                   std::shared_ptr<TransactionDBMutexFactory> factory)
-      : num_stripes_(num_stripes) {
+                   std::shared_ptr<TransactionDBMutexFactory> factory,
+                   const Comparator* cmp)
+      : num_stripes_(num_stripes), comparator(cmp) {
     lock_map_stripes_.reserve(num_stripes);
     for (size_t i = 0; i < num_stripes; i++) {
       LockMapStripe* stripe = new LockMapStripe(factory);
       lock_map_stripes_.push_back(stripe);
     }
+    range_mutex = factory->AllocateMutex();
+    range_cv = factory->AllocateCondVar();
+    assert(range_mutex);
+    assert(range_cv);
   }
 
   ~LockMap() {
@@ -85,12 +104,60 @@ struct LockMap {
 
   std::vector<LockMapStripe*> lock_map_stripes_;
 
+  // Orders the keys of range locks
+  const Comparator* comparator;
+
+  // Range locks held in this column family. Only modified while holding all
+  // the stripe mutexes, so holding any one of them is enough to read it.
+  std::vector<RangeLockInfo> range_locks;
+
+  // Serializes range lock requests. Transactions waiting for a range lock
+  // wait on range_cv, which is signaled whenever a lock is released while
+  // range_waiters is positive.
+  std::shared_ptr<TransactionDBMutex> range_mutex;
+  std::shared_ptr<TransactionDBCondVar> range_cv;
+  std::atomic<int> range_waiters{0};
+
   size_t GetStripe(const std::string& key) const {
     assert(num_stripes_ > 0);
     static murmur_hash hash;
     size_t stripe = hash(key) % num_stripes_;
     return stripe;
   }
+
+  // Lock all the stripes in order. The range lock path is the only one
+  // holding more than one stripe mutex at a time.
+  void LockAllStripes() {
+    for (auto stripe : lock_map_stripes_) {
+      Status s = stripe->stripe_mutex->Lock();
+      assert(s.ok());
+    }
+  }
+
+  void UnLockAllStripes() {
+    for (auto it = lock_map_stripes_.rbegin(); it != lock_map_stripes_.rend();
+         ++it) {
+      (*it)->stripe_mutex->UnLock();
+    }
+  }
+
+  bool KeyInRange(const Slice& key, const std::string& start,
+                  const std::string& limit) const {
+    return (kRangeQueryMin.compare(start) == 0 ||
+            comparator->Compare(key, start) >= 0) &&
+           (kRangeQueryMax.compare(limit) == 0 ||
+            comparator->Compare(key, limit) <= 0);
+  }
+
+  bool RangesOverlap(const std::string& start1, const std::string& limit1,
+                     const std::string& start2, const std::string& limit2) {
+    return (kRangeQueryMax.compare(limit1) == 0 ||
+            kRangeQueryMin.compare(start2) == 0 ||
+            comparator->Compare(limit1, start2) >= 0) &&
+           (kRangeQueryMax.compare(limit2) == 0 ||
+            kRangeQueryMin.compare(start1) == 0 ||
+            comparator->Compare(limit2, start1) >= 0);
+  }
 };
 
 namespace {
@@ -116,13 +183,14 @@ TransactionLockMgr::TransactionLockMgr(
 
 TransactionLockMgr::~TransactionLockMgr() {}
 
-void TransactionLockMgr::AddColumnFamily(uint32_t column_family_id) {
+void TransactionLockMgr::AddColumnFamily(uint32_t column_family_id,
+                                         const Comparator* comparator) {
   InstrumentedMutexLock l(&lock_map_mutex_);
 
   if (lock_maps_.find(column_family_id) == lock_maps_.end()) {
     lock_maps_.emplace(column_family_id,
-                       std::shared_ptr<LockMap>(
-                           new LockMap(default_num_stripes_, mutex_factory_)));
+                       std::shared_ptr<LockMap>(new LockMap(
+                           default_num_stripes_, mutex_factory_, comparator)));
   } else {
     // column_family already exists in lock map
     assert(false);
@@ -213,12 +281,26 @@ bool TransactionLockMgr::IsLockExpired(const LockInfo& lock_info, Env* env,
 // Sets *expire_time to the expiration time in microseconds
 // or 0 if no expiration.
 // REQUIRED: Stripe mutex must be held.
+// Sets *txn_ids to the transactions holding the conflicting locks, if any.
+// REQUIRED: Stripe mutex must be held.
 Status TransactionLockMgr::AcquireLocked(LockMap* lock_map,
                                          LockMapStripe* stripe,
                                          const std::string& key, Env* env,
                                          const LockInfo& txn_lock_info,
-                                         uint64_t* expire_time) {
+                                         uint64_t* expire_time,
+                                         std::vector<TransactionID>* txn_ids) {
   Status result;
+  // Check if this key is covered by a range lock of another txn. An expired
+  // range lock no longer conflicts, it is dropped by the next range locker.
+  for (const auto& range_lock : lock_map->range_locks) {
+    if (range_lock.txn_id != txn_lock_info.txn_id &&
+        lock_map->KeyInRange(key, range_lock.start, range_lock.limit) &&
+        !IsLockExpired(range_lock, env, expire_time)) {
+      txn_ids->push_back(range_lock.txn_id);
+      return Status::TimedOut(Status::SubCode::kLockTimeout);
+    }
+  }
+
   // Check if this key is already locked
   if (stripe->keys.find(key) != stripe->keys.end()) {
     // Lock already held
@@ -232,6 +314,7 @@ Status TransactionLockMgr::AcquireLocked(LockMap* lock_map,
         lock_info.expiration_time = txn_lock_info.expiration_time;
         // lock_cnt does not change
       } else {
+        txn_ids->push_back(lock_info.txn_id);
         result = Status::TimedOut(Status::SubCode::kLockTimeout);
       }
     }
@@ -254,8 +337,50 @@ Status TransactionLockMgr::AcquireLocked(LockMap* lock_map,
   return result;
 }
 
+// Try to lock this key range after we have acquired all the stripe mutexes.
+// Sets *expire_time like AcquireLocked() and *txn_ids to the transactions
+// holding the conflicting locks, if any.
+// REQUIRED: All the stripe mutexes must be held.
+Status TransactionLockMgr::AcquireRangeLocked(
+    LockMap* lock_map, const std::string& start, const std::string& limit,
+    Env* env, const LockInfo& txn_lock_info, uint64_t* expire_time,
+    std::vector<TransactionID>* txn_ids) {
+  // Drop the expired range locks of other txns, then check the live ones
+  auto& range_locks = lock_map->range_locks;
+  for (auto it = range_locks.begin(); it != range_locks.end();) {
+    if (it->txn_id != txn_lock_info.txn_id &&
+        lock_map->RangesOverlap(start, limit, it->start, it->limit)) {
+      if (IsLockExpired(*it, env, expire_time)) {
+        it = range_locks.erase(it);
+        continue;
+      }
+      txn_ids->push_back(it->txn_id);
+    }
+    ++it;
+  }
+
+  for (auto stripe : lock_map->lock_map_stripes_) {
+    for (const auto& key_iter : stripe->keys) {
+      const LockInfo& lock_info = key_iter.second;
+      if (lock_info.txn_id != txn_lock_info.txn_id &&
+          lock_map->KeyInRange(key_iter.first, start, limit) &&
+          !IsLockExpired(lock_info, env, expire_time)) {
+        txn_ids->push_back(lock_info.txn_id);
+      }
+    }
+  }
+
+  if (!txn_ids->empty()) {
+    return Status::TimedOut(Status::SubCode::kLockTimeout);
+  }
+
+  range_locks.emplace_back(txn_lock_info, start, limit);
+  return Status::OK();
+}
+
 // Helper function for TryLock().
-Status TransactionLockMgr::AcquireWithTimeout(LockMap* lock_map,
+Status TransactionLockMgr::AcquireWithTimeout(const TransactionImpl* txn,
+                                              LockMap* lock_map,
                                               LockMapStripe* stripe,
                                               const std::string& key, Env* env,
                                               int64_t timeout,
@@ -282,8 +407,9 @@ Status TransactionLockMgr::AcquireWithTimeout(LockMap* lock_map,
 
   // Acquire lock if we are able to
   uint64_t expire_time_hint = 0;
-  result =
-      AcquireLocked(lock_map, stripe, key, env, lock_info, &expire_time_hint);
+  std::vector<TransactionID> wait_ids;
+  result = AcquireLocked(lock_map, stripe, key, env, lock_info,
+                         &expire_time_hint, &wait_ids);
 
   if (!result.ok() && timeout != 0) {
     // If we weren't able to acquire the lock, we will keep retrying as long
@@ -302,6 +428,13 @@ Status TransactionLockMgr::AcquireWithTimeout(LockMap* lock_map,
         cv_end_time = end_time;
       }
 
+      // Refuse to wait if that would close a cycle in the wait-for graph
+      bool deadlock_detect = txn->IsDeadlockDetect() && !wait_ids.empty();
+      if (deadlock_detect && IncrementWaiters(txn, wait_ids)) {
+        result = Status::Busy(Status::SubCode::kDeadlock);
+        break;
+      }
+
       if (cv_end_time < 0) {
         // Wait indefinitely
         result = stripe->stripe_cv->Wait(stripe->stripe_mutex);
@@ -313,6 +446,10 @@ Status TransactionLockMgr::AcquireWithTimeout(LockMap* lock_map,
         }
       }
 
+      if (deadlock_detect) {
+        DecrementWaiters(txn, wait_ids);
+      }
+
       if (result.IsTimedOut()) {
         timed_out = true;
         // Even though we timed out, we will still make one more attempt to
@@ -321,8 +458,9 @@ Status TransactionLockMgr::AcquireWithTimeout(LockMap* lock_map,
       }
 
       if (result.ok() || result.IsTimedOut()) {
+        wait_ids.clear();
         result = AcquireLocked(lock_map, stripe, key, env, lock_info,
-                               &expire_time_hint);
+                               &expire_time_hint, &wait_ids);
       }
     } while (!result.ok() && !timed_out);
   }
@@ -354,7 +492,215 @@ Status TransactionLockMgr::TryLock(const TransactionImpl* txn,
   LockInfo lock_info(txn->GetTxnID(), txn->GetExpirationTime());
   int64_t timeout = txn->GetLockTimeout();
 
-  return AcquireWithTimeout(lock_map, stripe, key, env, timeout, lock_info);
+  return AcquireWithTimeout(txn, lock_map, stripe, key, env, timeout,
+                            lock_info);
+}
+
+Status TransactionLockMgr::TryRangeLock(const TransactionImpl* txn,
+                                        uint32_t column_family_id,
+                                        const std::string& start,
+                                        const std::string& limit, Env* env) {
+  // Lookup lock map for this column family id
+  std::shared_ptr<LockMap> lock_map_ptr = GetLockMap(column_family_id);
+  LockMap* lock_map = lock_map_ptr.get();
+  if (lock_map == nullptr) {
+    char msg[255];
+    snprintf(msg, sizeof(msg), "Column family id not found: %" PRIu32,
+             column_family_id);
+
+    return Status::InvalidArgument(msg);
+  }
+
+  LockInfo lock_info(txn->GetTxnID(), txn->GetExpirationTime());
+  int64_t timeout = txn->GetLockTimeout();
+
+  Status result;
+  uint64_t end_time = 0;
+
+  if (timeout > 0) {
+    uint64_t start_time = env->NowMicros();
+    end_time = start_time + timeout;
+  }
+
+  if (timeout < 0) {
+    // If timeout is negative, we wait indefinitely to acquire the lock
+    result = lock_map->range_mutex->Lock();
+  } else {
+    result = lock_map->range_mutex->TryLockFor(timeout);
+  }
+
+  if (!result.ok()) {
+    // failed to acquire mutex
+    return result;
+  }
+
+  // Announce ourselves before checking the locks, so that no release between
+  // the check and the wait below can be missed.
+  lock_map->range_waiters++;
+
+  bool timed_out = false;
+  std::vector<TransactionID> wait_ids;
+  while (true) {
+    uint64_t expire_time_hint = 0;
+    wait_ids.clear();
+    lock_map->LockAllStripes();
+    result = AcquireRangeLocked(lock_map, start, limit, env, lock_info,
+                                &expire_time_hint, &wait_ids);
+    lock_map->UnLockAllStripes();
+
+    if (result.ok() || timeout == 0 || timed_out) {
+      break;
+    }
+
+    // Decide how long to wait, same as AcquireWithTimeout()
+    int64_t cv_end_time = -1;
+    if (expire_time_hint > 0 &&
+        (timeout < 0 || (timeout > 0 && expire_time_hint < end_time))) {
+      cv_end_time = expire_time_hint;
+    } else if (timeout >= 0) {
+      cv_end_time = end_time;
+    }
+
+    bool deadlock_detect = txn->IsDeadlockDetect() && !wait_ids.empty();
+    if (deadlock_detect && IncrementWaiters(txn, wait_ids)) {
+      result = Status::Busy(Status::SubCode::kDeadlock);
+      break;
+    }
+
+    Status wait_status;
+    if (cv_end_time < 0) {
+      // Wait indefinitely
+      wait_status = lock_map->range_cv->Wait(lock_map->range_mutex);
+    } else {
+      uint64_t now = env->NowMicros();
+      if (static_cast<uint64_t>(cv_end_time) > now) {
+        wait_status = lock_map->range_cv->WaitFor(lock_map->range_mutex,
+                                                  cv_end_time - now);
+      } else {
+        wait_status = Status::TimedOut(Status::SubCode::kLockTimeout);
+      }
+    }
+
+    if (deadlock_detect) {
+      DecrementWaiters(txn, wait_ids);
+    }
+
+    if (wait_status.IsTimedOut()) {
+      // Make one more attempt, the lock may have expired unsignaled
+      timed_out = true;
+    } else if (!wait_status.ok()) {
+      result = wait_status;
+      break;
+    }
+  }
+
+  lock_map->range_waiters--;
+  lock_map->range_mutex->UnLock();
+
+  return result;
+}
+
+void TransactionLockMgr::UnLockRanges(const TransactionImpl* txn,
+                                      uint32_t column_family_id, Env* env) {
+  std::shared_ptr<LockMap> lock_map_ptr = GetLockMap(column_family_id);
+  LockMap* lock_map = lock_map_ptr.get();
+  if (lock_map == nullptr) {
+    // Column Family must have been dropped.
+    return;
+  }
+
+  TransactionID txn_id = txn->GetTxnID();
+
+  lock_map->LockAllStripes();
+  auto& range_locks = lock_map->range_locks;
+  range_locks.erase(
+      std::remove_if(range_locks.begin(), range_locks.end(),
+                     [txn_id](const RangeLockInfo& range_lock) {
+                       return range_lock.txn_id == txn_id;
+                     }),
+      range_locks.end());
+  lock_map->UnLockAllStripes();
+
+  // Signal waiting threads to retry locking
+  for (auto stripe : lock_map->lock_map_stripes_) {
+    stripe->stripe_cv->NotifyAll();
+  }
+  NotifyRangeWaiters(lock_map);
+}
+
+void TransactionLockMgr::NotifyRangeWaiters(LockMap* lock_map) {
+  if (lock_map->range_waiters.load() > 0) {
+    lock_map->range_mutex->Lock();
+    lock_map->range_cv->NotifyAll();
+    lock_map->range_mutex->UnLock();
+  }
+}
+
+bool TransactionLockMgr::IncrementWaiters(
+    const TransactionImpl* txn, const std::vector<TransactionID>& wait_ids) {
+  TransactionID id = txn->GetTxnID();
+  size_t depth = static_cast<size_t>(std::max<int64_t>(
+      txn->GetDeadlockDetectDepth(), 1));
+  std::vector<TransactionID> queue;
+  queue.reserve(depth);
+
+  std::lock_guard<std::mutex> lock(wait_txn_map_mutex_);
+  assert(wait_txn_map_.find(id) == wait_txn_map_.end());
+  wait_txn_map_[id] = wait_ids;
+  for (auto wait_id : wait_ids) {
+    rev_wait_txn_map_[wait_id]++;
+  }
+
+  // No deadlock if nobody is waiting on self
+  if (rev_wait_txn_map_.find(id) == rev_wait_txn_map_.end()) {
+    return false;
+  }
+
+  // Breadth-first search of the transactions we transitively wait on
+  const std::vector<TransactionID>* next_ids = &wait_ids;
+  for (size_t head = 0; head < depth; head++) {
+    if (next_ids != nullptr) {
+      for (size_t i = 0; i < next_ids->size() && queue.size() < depth; i++) {
+        queue.push_back((*next_ids)[i]);
+      }
+    }
+
+    // No more transactions to follow, meaning no deadlock
+    if (head == queue.size()) {
+      return false;
+    }
+
+    TransactionID next = queue[head];
+    if (next == id) {
+      DecrementWaitersImpl(txn, wait_ids);
+      return true;
+    }
+
+    auto iter = wait_txn_map_.find(next);
+    next_ids = iter == wait_txn_map_.end() ? nullptr : &iter->second;
+  }
+
+  // Wait chain is too long, assume a deadlock
+  DecrementWaitersImpl(txn, wait_ids);
+  return true;
+}
+
+void TransactionLockMgr::DecrementWaiters(
+    const TransactionImpl* txn, const std::vector<TransactionID>& wait_ids) {
+  std::lock_guard<std::mutex> lock(wait_txn_map_mutex_);
+  DecrementWaitersImpl(txn, wait_ids);
+}
+
+void TransactionLockMgr::DecrementWaitersImpl(
+    const TransactionImpl* txn, const std::vector<TransactionID>& wait_ids) {
+  wait_txn_map_.erase(txn->GetTxnID());
+  for (auto wait_id : wait_ids) {
+    auto iter = rev_wait_txn_map_.find(wait_id);
+    assert(iter != rev_wait_txn_map_.end());
+    if (--iter->second == 0) {
+      rev_wait_txn_map_.erase(iter);
+    }
+  }
 }
 
 void TransactionLockMgr::UnLock(TransactionImpl* txn, uint32_t column_family_id,
@@ -395,6 +741,7 @@ void TransactionLockMgr::UnLock(TransactionImpl* txn, uint32_t column_family_id,
 
   // Signal waiting threads to retry locking
   stripe->stripe_cv->NotifyAll();
+  NotifyRangeWaiters(lock_map);
 }
 
 void TransactionLockMgr::UnLock(const TransactionImpl* txn,
@@ -457,6 +804,7 @@ void TransactionLockMgr::UnLock(const TransactionImpl* txn,
       // Signal waiting threads to retry locking
       stripe->stripe_cv->NotifyAll();
     }
+    NotifyRangeWaiters(lock_map);
   }
 }
 
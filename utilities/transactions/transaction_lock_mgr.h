@@ -7,6 +7,7 @@
 #ifndef VIDARDB_LITE
 
 #include <chrono>
+#include <mutex>
 #include <string>
 #include <unordered_map>
 #include <vector>
@@ -19,6 +20,7 @@
 namespace vidardb {
 
 class ColumnFamilyHandle;
+class Comparator;
 struct LockInfo;
 struct LockMap;
 struct LockMapStripe;
@@ -35,8 +37,10 @@ class TransactionLockMgr {
   ~TransactionLockMgr();
 
   // Creates a new LockMap for this column family. Caller should guarantee
-  // that this column family does not already exist.
-  void AddColumnFamily(uint32_t column_family_id);
+  // that this column family does not already exist. comparator orders the
+  // keys of range locks.
+  void AddColumnFamily(uint32_t column_family_id,
+                       const Comparator* comparator);
 
   // Deletes the LockMap for this column family. Caller should guarantee that
   // this column family is no longer in use.
@@ -54,6 +58,18 @@ class TransactionLockMgr {
   void UnLock(const TransactionImpl* txn, const TransactionKeyMap* keys,
               Env* env);
 
+  // Attempt to lock the key range [start, limit], where kRangeQueryMin and
+  // kRangeQueryMax stand for an open end. The range conflicts with every
+  // point lock and range lock of another transaction that overlaps it. If OK
+  // status is returned, the caller is responsible for calling UnLockRanges().
+  Status TryRangeLock(const TransactionImpl* txn, uint32_t column_family_id,
+                      const std::string& start, const std::string& limit,
+                      Env* env);
+
+  // Unlock all the ranges locked by txn in this column family.
+  void UnLockRanges(const TransactionImpl* txn, uint32_t column_family_id,
+                    Env* env);
+
  private:
   TransactionDBImpl* txn_db_impl_;
 
@@ -77,18 +93,49 @@ class TransactionLockMgr {
   // to avoid acquiring a mutex in order to look up a LockMap
   std::unique_ptr<ThreadLocalPtr> lock_maps_cache_;
 
+  // Wait-for graph used by deadlock detection. Maps a waiting transaction to
+  // the transactions holding the lock it waits on.
+  std::unordered_map<TransactionID, std::vector<TransactionID>> wait_txn_map_;
+
+  // Number of transactions waiting on each lock holder
+  std::unordered_map<TransactionID, int> rev_wait_txn_map_;
+
+  // Must be held when accessing/modifying wait_txn_map_ and rev_wait_txn_map_
+  std::mutex wait_txn_map_mutex_;
+
   std::shared_ptr<LockMap> GetLockMap(uint32_t column_family_id);
 
   bool IsLockExpired(const LockInfo& lock_info, Env* env, uint64_t* wait_time);
 
   Status AcquireLocked(LockMap* lock_map, LockMapStripe* stripe,
                        const std::string& key, Env* env,
-                       const LockInfo& lock_info, uint64_t* wait_time);
+                       const LockInfo& lock_info, uint64_t* wait_time,
+                       std::vector<TransactionID>* txn_ids);
+
+  Status AcquireRangeLocked(LockMap* lock_map, const std::string& start,
+                            const std::string& limit, Env* env,
+                            const LockInfo& lock_info, uint64_t* wait_time,
+                            std::vector<TransactionID>* txn_ids);
 
-  Status AcquireWithTimeout(LockMap* lock_map, LockMapStripe* stripe,
-                            const std::string& key, Env* env, int64_t timeout,
+  Status AcquireWithTimeout(const TransactionImpl* txn, LockMap* lock_map,
+                            LockMapStripe* stripe, const std::string& key,
+                            Env* env, int64_t timeout,
                             const LockInfo& lock_info);
 
+  // Wakes up the transactions waiting for a range lock, if any.
+  void NotifyRangeWaiters(LockMap* lock_map);
+
+  // Records that txn waits on wait_ids. Returns true, leaving the graph
+  // unchanged, if this closes a cycle or the chain exceeds the detection
+  // depth of txn.
+  bool IncrementWaiters(const TransactionImpl* txn,
+                        const std::vector<TransactionID>& wait_ids);
+  void DecrementWaiters(const TransactionImpl* txn,
+                        const std::vector<TransactionID>& wait_ids);
+  // REQUIRED: wait_txn_map_mutex_ must be held.
+  void DecrementWaitersImpl(const TransactionImpl* txn,
+                            const std::vector<TransactionID>& wait_ids);
+
   // No copying allowed
   TransactionLockMgr(const TransactionLockMgr&);
   void operator=(const TransactionLockMgr&);
@@ -11,10 +11,12 @@
 #include <memory>
 
 #include "db/column_family.h"
+#include "db/dbformat.h"
 #include "memtable/skiplist.h"
 #include "util/arena.h"
 #include "utilities/write_batch_with_index/write_batch_with_index_internal.h"
 #include "vidardb/comparator.h"
+#include "vidardb/db.h"
 #include "vidardb/iterator.h"
 
 namespace vidardb {
@@ -491,6 +493,9 @@ Status WriteBatchWithIndex::Rep::ReBuildIndex() {
       case kTypeRollbackXID:
       case kTypeNoop:
         break;
+      case kTypeColumnFamilyRangeDeletion:  // Shichao
+      case kTypeRangeDeletion:  // Shichao
+        return Status::NotSupported("DeleteRange is not indexed");
       default:
         return Status::Corruption("unknown WriteBatch tag");
     }
@@ -623,5 +628,118 @@ Status WriteBatchWithIndex::GetFromBatchAndDB(DB* db, ReadOptions& read_options,
   return s;
 }
 
+/***************************** Shichao ******************************/
+bool WriteBatchWithIndex::RangeQueryFromBatchAndDB(
+    DB* db, ReadOptions& read_options, const Range& range,
+    std::list<RangeQueryKeyVal>& res, Status* s) {
+  return RangeQueryFromBatchAndDB(db, read_options, db->DefaultColumnFamily(),
+                                  range, res, s);
+}
+
+bool WriteBatchWithIndex::RangeQueryFromBatchAndDB(
+    DB* db, ReadOptions& read_options, ColumnFamilyHandle* column_family,
+    const Range& range, std::list<RangeQueryKeyVal>& res, Status* s) {
+  // The batch entries belonging to this call start where the DB range query
+  // resumes, and end right before where the next call will resume.
+  std::string lower_key;
+  if (read_options.range_query_meta == nullptr) {
+    lower_key.assign(range.start.data(), range.start.size());
+  } else {
+    lower_key = static_cast<RangeQueryMeta*>(
+        read_options.range_query_meta)->next_start_key;
+  }
+
+  bool next_query = db->RangeQuery(read_options, column_family, range, res, s);
+  if (!s->ok()) {
+    return false;
+  }
+
+  std::string upper_key;
+  if (next_query) {
+    upper_key = static_cast<RangeQueryMeta*>(
+        read_options.range_query_meta)->next_start_key;
+  } else {
+    upper_key.assign(range.limit.data(), range.limit.size());
+  }
+  bool lower_unbounded = Slice(lower_key).compare(kRangeQueryMin) == 0;
+  bool upper_unbounded =
+      !next_query && Slice(upper_key).compare(kRangeQueryMax) == 0;
+
+  std::shared_ptr<Splitter> splitter;
+  if (!read_options.columns.empty()) {
+    splitter = db->GetOptions(column_family).splitter;
+  }
+
+  uint32_t cf_id = GetColumnFamilyID(column_family);
+  const WriteBatchEntryComparator& cmp = rep->comparator;
+  std::unique_ptr<WBWIIterator> iter(NewIterator(column_family));
+  if (lower_unbounded) {
+    iter->SeekToFirst();
+  } else {
+    iter->Seek(lower_key);
+  }
+
+  // Both the batch index and res are sorted by user key, merge them in one
+  // pass.
+  auto res_iter = res.begin();
+  while (iter->Valid()) {
+    const WriteEntry entry = iter->Entry();
+    if (!upper_unbounded) {
+      int c = cmp.CompareKey(cf_id, entry.key, upper_key);
+      if (c > 0 || (c == 0 && next_query)) {
+        break;
+      }
+    }
+
+    // Only the latest write of a key is visible
+    iter->Next();
+    if (iter->Valid() &&
+        cmp.CompareKey(cf_id, iter->Entry().key, entry.key) == 0) {
+      continue;
+    }
+
+    while (res_iter != res.end() &&
+           cmp.CompareKey(cf_id, res_iter->user_key, entry.key) < 0) {
+      ++res_iter;
+    }
+    bool in_db = res_iter != res.end() &&
+                 cmp.CompareKey(cf_id, res_iter->user_key, entry.key) == 0;
+
+    switch (entry.type) {
+      case kPutRecord: {
+        std::string buf;  // prepare for splitting user value
+        Slice user_val(ReformatUserValue(entry.value, read_options.columns,
+                                         splitter.get(), buf));
+        if (in_db) {
+          assert(read_options.result_val_size >= res_iter->value().size());
+          read_options.result_val_size -= res_iter->value().size();
+          res_iter->SetValue(user_val);
+          ++res_iter;
+        } else {
+          res.emplace(res_iter, entry.key.ToString(), user_val.ToString());
+          read_options.result_key_size += entry.key.size();
+        }
+        read_options.result_val_size += user_val.size();
+        break;
+      }
+      case kDeleteRecord: {
+        if (in_db) {
+          assert(read_options.result_key_size >= res_iter->user_key.size());
+          assert(read_options.result_val_size >= res_iter->value().size());
+          read_options.result_key_size -= res_iter->user_key.size();
+          read_options.result_val_size -= res_iter->value().size();
+          res_iter = res.erase(res_iter);
+        }
+        break;
+      }
+      default:
+        break;
+    }
+  }
+
+  return next_query;
+}
+/***************************** Shichao ******************************/
+
 }  // namespace vidardb
 #endif  // !VIDARDB_LITE